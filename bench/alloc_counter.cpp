@@ -0,0 +1,36 @@
+#include "alloc_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace sqlplusplus {
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+
+} // namespace
+
+uint64_t allocationCount() noexcept {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+} // namespace sqlplusplus
+
+// The array and nothrow forms go through these in libstdc++ and libc++; the aligned ones
+// are left alone, since nothing being measured uses them.
+void* operator new(std::size_t size) {
+    sqlplusplus::allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+namespace sqlplusplus {
+
+// Heap allocations made through operator new since the benchmark started, on every
+// thread. alloc_counter.cpp replaces the global operator new and delete to count them, so
+// a benchmark can check a path allocates nothing by reading this around it.
+uint64_t allocationCount() noexcept;
+
+} // namespace sqlplusplus
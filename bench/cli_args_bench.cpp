@@ -0,0 +1,45 @@
+#include "cli_args.h"
+
+#include "benchmark/benchmark.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace {
+
+using sqlplusplus::CliArgument;
+using sqlplusplus::CliArgumentParser;
+using sqlplusplus::CliFlag;
+
+// A parser with as many options as the real one has, parsing a typical command line.
+void BM_CliArgumentParserParse(benchmark::State& state) {
+    static constexpr const char* kArgv[] = {
+        "sqlplusplus", "-c", "dbhost:1521/orclpdb1", "-u", "scott", "--password=tiger",
+        "--fetchArraySize", "500", "--prefetchRows=100", "--noPool", "--output-format", "csv",
+        "--historyFile", "/tmp/history",
+    };
+    static constexpr std::string_view kArgumentNames[] = {
+        "historyFile", "maxHistorySize", "fetchArraySize", "prefetchRows", "stmtCacheSize",
+        "poolMinSessions", "poolMaxSessions", "poolSessionIncrement", "poolGetMode",
+        "poolWaitTimeout", "poolPingInterval", "poolTimeout", "poolMaxLifetime",
+        "output-format", "module", "action", "clientIdentifier", "stats-json", "trace",
+    };
+    for (auto _ : state) {
+        CliArgumentParser parser;
+        CliArgument connString(parser, "connectionString", 'c');
+        CliArgument username(parser, "username", 'u');
+        CliArgument password(parser, "password", 'p');
+        std::deque<CliArgument> arguments;
+        for (auto name : kArgumentNames) {
+            arguments.emplace_back(parser, name);
+        }
+        CliFlag noPool(parser, "noPool");
+        CliFlag help(parser, "help", 'h');
+        auto result = parser.parse(static_cast<int>(std::size(kArgv)), const_cast<const char**>(kArgv));
+        benchmark::DoNotOptimize(result.unmatched_arguments.data());
+    }
+}
+BENCHMARK(BM_CliArgumentParserParse);
+
+} // namespace
@@ -0,0 +1,94 @@
+#include "completion.h"
+
+#include "benchmark/benchmark.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+// Stands in for V$RESERVED_WORDS, which has a couple of thousand entries: real keywords plus
+// made up ones sharing their prefixes.
+tsl::htrie_set<char> reservedWords() {
+    static constexpr std::string_view kKeywords[] = {
+        "select", "from", "where", "group", "order", "by", "having", "insert", "into", "values",
+        "update", "set", "delete", "merge", "create", "table", "index", "view", "sequence",
+        "synonym", "procedure", "function", "package", "body", "trigger", "type", "alter",
+        "drop", "truncate", "grant", "revoke", "commit", "rollback", "savepoint", "union",
+        "intersect", "minus", "distinct", "exists", "between", "like", "null", "not", "and",
+        "or", "join", "inner", "outer", "left", "right", "full", "cross", "natural", "using",
+        "partition", "subpartition", "session", "system", "schema", "sysdate", "systimestamp",
+    };
+    static constexpr std::string_view kSuffixes[] = {
+        "", "_all", "_any", "_by", "_id", "_info", "_list", "_mode", "_name", "_stats",
+        "_time", "_type", "_value", "s", "ed", "ing", "ion", "able", "er", "or", "ary",
+        "_limit", "_size", "_count", "_map", "_set", "_of", "_on", "_off", "_to", "_max",
+        "_min", "_sum", "_avg",
+    };
+    tsl::htrie_set<char> words;
+    for (auto keyword : kKeywords) {
+        for (auto suffix : kSuffixes) {
+            words.insert(std::string(keyword).append(suffix));
+        }
+    }
+    return words;
+}
+
+void BM_CompleteReservedWord(benchmark::State& state, std::string_view line) {
+    const auto words = reservedWords();
+    std::vector<std::string> completions;
+    for (auto _ : state) {
+        completions.clear();
+        const auto wordStart = sqlplusplus::completionWordStart(line, " (),.@");
+        sqlplusplus::addPrefixCompletions(line, wordStart, words, completions);
+        benchmark::DoNotOptimize(completions.data());
+    }
+    state.counters["matches"] = static_cast<double>(completions.size());
+}
+BENCHMARK_CAPTURE(BM_CompleteReservedWord, one_letter, std::string_view("s"));
+BENCHMARK_CAPTURE(BM_CompleteReservedWord, short_prefix, std::string_view("sel"));
+BENCHMARK_CAPTURE(BM_CompleteReservedWord, long_line,
+        std::string_view("select owner, object_name from all_objects where object_type in (parti"));
+BENCHMARK_CAPTURE(BM_CompleteReservedWord, no_match, std::string_view("select * from qqq"));
+
+// The same words ranked, keeping the best 64 the way the REPL does.
+void BM_RankReservedWord(benchmark::State& state, std::string_view line) {
+    const auto words = reservedWords();
+    sqlplusplus::WordFrequencies frequencies;
+    frequencies.addStatement("select owner, object_name from all_objects where object_type = 'TABLE' order by 1");
+    std::vector<std::string> completions;
+    for (auto _ : state) {
+        sqlplusplus::CompletionLexer lexer;
+        const auto& point = lexer.update(line);
+        sqlplusplus::CompletionRanker ranker(point.context, &frequencies, 64);
+        ranker.offerPrefixMatches(words, line.substr(point.wordStart), sqlplusplus::CompletionSource::Keyword);
+        completions = ranker.take(line.substr(0, point.wordStart));
+        benchmark::DoNotOptimize(completions.data());
+    }
+    state.counters["matches"] = static_cast<double>(completions.size());
+}
+BENCHMARK_CAPTURE(BM_RankReservedWord, one_letter, std::string_view("s"));
+BENCHMARK_CAPTURE(BM_RankReservedWord, short_prefix, std::string_view("sel"));
+BENCHMARK_CAPTURE(BM_RankReservedWord, long_line,
+        std::string_view("select owner, object_name from all_objects where object_type in (parti"));
+
+// A keystroke at the end of a long line only lexes the word it extends.
+void BM_LexKeystroke(benchmark::State& state) {
+    const std::string statement = "select owner, object_name, object_type from all_objects o join all_tab_columns c "
+                       "on c.owner = o.owner where o.object_type in ('TABLE', 'VIEW') and c.column_name like ";
+    std::string line = statement;
+    sqlplusplus::CompletionLexer lexer;
+    lexer.update(line);
+    size_t typed = 0;
+    for (auto _ : state) {
+        if (line.size() > 2 * statement.size()) {
+            line = statement;
+        }
+        line.push_back(typed++ % 8 == 7 ? ' ' : 'x');
+        benchmark::DoNotOptimize(lexer.update(line).wordStart);
+    }
+}
+BENCHMARK(BM_LexKeystroke);
+
+} // namespace
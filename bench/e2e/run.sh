@@ -0,0 +1,129 @@
+#!/usr/bin/env bash
+# End-to-end performance suite: runs fetch, render, export, load and copy workloads
+# through the real sqlplusplus binary against a schema built by schema.sql, and writes
+# their timings and client counters as JSON that can be compared across commits.
+#
+#   bench/e2e/run.sh --container --binary _gate_build/src/sqlplusplus --report e2e.json
+#
+# With --container it starts an Oracle Database Free container (gvenzl/oracle-free) with
+# a "perf" account and removes it afterwards; otherwise point it at a database with
+# --connect and --username, and the password in SQLPLUSPLUS_PASSWORD. The schema is
+# rebuilt unless --skip-schema is given. Each workload runs --repeat times, after its
+# untimed <name>.setup.sql if there is one, and is timed from exec to exit.
+set -euo pipefail
+
+here=$(cd "$(dirname "$0")" && pwd)
+binary=sqlplusplus
+connect=localhost:1521/FREEPDB1
+username=perf
+password=${SQLPLUSPLUS_PASSWORD:-perf}
+repeat=3
+report=
+container=
+skip_schema=
+image=gvenzl/oracle-free:slim
+
+usage() {
+    echo "usage: $0 [--binary <path>] [--connect <string>] [--username <user>] [--repeat <n>]" \
+         "[--report <file>] [--container] [--image <image>] [--skip-schema]" >&2
+    exit 2
+}
+
+while [[ $# -gt 0 ]]; do
+    case $1 in
+        --binary) binary=$2; shift 2 ;;
+        --connect) connect=$2; shift 2 ;;
+        --username) username=$2; shift 2 ;;
+        --repeat) repeat=$2; shift 2 ;;
+        --report) report=$2; shift 2 ;;
+        --container) container=1; shift ;;
+        --image) image=$2; shift 2 ;;
+        --skip-schema) skip_schema=1; shift ;;
+        *) usage ;;
+    esac
+done
+# Absolute, since the client runs from the work directory.
+if [[ $binary == */* ]]; then
+    binary=$(realpath "$binary")
+else
+    binary=$(command -v "$binary")
+fi
+
+workdir=$(mktemp -d)
+container_id=
+cleanup() {
+    if [[ -n $container_id ]]; then
+        docker rm -f "$container_id" >/dev/null
+    fi
+    rm -rf "$workdir"
+}
+trap cleanup EXIT
+
+if [[ -n $container ]]; then
+    container_id=$(docker run -d -p 1521 -e ORACLE_RANDOM_PASSWORD=yes \
+        -e APP_USER="$username" -e APP_USER_PASSWORD="$password" "$image")
+    port=$(docker port "$container_id" 1521/tcp | head -n 1 | sed 's/.*://')
+    connect=localhost:$port/FREEPDB1
+    echo "Waiting for the database in $image..." >&2
+    until docker logs "$container_id" 2>&1 | grep -q "DATABASE IS READY TO USE"; do
+        if ! docker inspect -f '{{.State.Running}}' "$container_id" | grep -q true; then
+            docker logs "$container_id" >&2
+            exit 1
+        fi
+        sleep 5
+    done
+fi
+
+# The client is run from the work directory, where the exports land and the loads read.
+run_client() {
+    (cd "$workdir" && "$binary" -c "$connect" -u "$username" -p "$password" "$@" >/dev/null)
+}
+
+if [[ -z $skip_schema ]]; then
+    echo "Building the schema..." >&2
+    run_client --file "$here/schema.sql"
+fi
+
+now_ns() {
+    date +%s%N
+}
+
+# name, then the client's output flags. Later workloads may read what earlier ones wrote.
+workloads=(
+    "fetch_tall --output-format csv"
+    "fetch_wide --output-format csv"
+    "fetch_lob --output-format ndjson"
+    "render_mixed --output-format table"
+    "export_tall_csv"
+    "export_tall_parquet"
+    "load_tall"
+    "copy_tall"
+)
+
+results=()
+for entry in "${workloads[@]}"; do
+    read -r name flags <<<"$entry"
+    seconds=()
+    for ((run = 0; run < repeat; ++run)); do
+        if [[ -f $here/workloads/$name.setup.sql ]]; then
+            run_client --file "$here/workloads/$name.setup.sql"
+        fi
+        start=$(now_ns)
+        # shellcheck disable=SC2086
+        run_client $flags --stats-json "$workdir/stats.json" --file "$here/workloads/$name.sql"
+        end=$(now_ns)
+        seconds+=("$(awk -v ns=$((end - start)) 'BEGIN { printf "%.3f", ns / 1e9 }')")
+    done
+    median=$(printf '%s\n' "${seconds[@]}" | sort -n | awk '{ v[NR] = $1 } END { print v[int((NR + 1) / 2)] }')
+    echo "$name: median ${median}s of ${seconds[*]}" >&2
+    # The counters are the last run's.
+    results+=("{\"name\":\"$name\",\"seconds\":[$(IFS=,; echo "${seconds[*]}")],\"median_seconds\":$median,\"client\":$(cat "$workdir/stats.json")}")
+done
+
+commit=$(git -C "$here" rev-parse HEAD 2>/dev/null || echo unknown)
+json="{\"commit\":\"$commit\",\"date\":\"$(date -u +%Y-%m-%dT%H:%M:%SZ)\",\"repeat\":$repeat,\"workloads\":[$(IFS=,; echo "${results[*]}")]}"
+if [[ -n $report ]]; then
+    echo "$json" >"$report"
+else
+    echo "$json"
+fi
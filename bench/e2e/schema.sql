@@ -0,0 +1,72 @@
+-- The tables the end-to-end workloads run against, dropped and filled afresh. Their rows
+-- come from .generate with a fixed seed, so every run of the suite sees the same data.
+
+BEGIN
+    FOR t IN (SELECT table_name FROM user_tables WHERE table_name LIKE 'PERF\_%' ESCAPE '\') LOOP
+        EXECUTE IMMEDIATE 'DROP TABLE ' || t.table_name || ' PURGE';
+    END LOOP;
+END;
+/
+
+-- Tall and narrow: many rows, few bytes each, so round trips and per-row costs dominate.
+CREATE TABLE perf_tall (
+    id NUMBER(12) PRIMARY KEY,
+    account_id NUMBER(9),
+    amount NUMBER(12, 2),
+    created DATE,
+    status VARCHAR2(10)
+);
+
+-- Wide: a hundred columns of a few kinds, so per-column costs dominate.
+DECLARE
+    ddl VARCHAR2(32767) := 'CREATE TABLE perf_wide (id NUMBER(12) PRIMARY KEY';
+BEGIN
+    FOR idx IN 1 .. 33 LOOP
+        ddl := ddl || ', n' || idx || ' NUMBER(12, 2), s' || idx || ' VARCHAR2(40), d' || idx || ' DATE';
+    END LOOP;
+    EXECUTE IMMEDIATE ddl || ')';
+END;
+/
+
+-- LOB-heavy: documents and payloads that are fetched through LOB locators.
+CREATE TABLE perf_lob (
+    id NUMBER(12) PRIMARY KEY,
+    title VARCHAR2(200),
+    body CLOB,
+    payload BLOB
+);
+
+-- Every type the fetch path decodes differently.
+CREATE TABLE perf_mixed (
+    id NUMBER(12) PRIMARY KEY,
+    small_int NUMBER(4),
+    big_decimal NUMBER(38, 10),
+    native_double BINARY_DOUBLE,
+    native_float BINARY_FLOAT,
+    label VARCHAR2(100),
+    national_label NVARCHAR2(50),
+    fixed_code CHAR(8),
+    raw_bytes RAW(32),
+    created DATE,
+    updated TIMESTAMP(6),
+    updated_tz TIMESTAMP(6) WITH TIME ZONE,
+    duration INTERVAL DAY TO SECOND
+);
+
+-- Targets for the load and copy workloads, refilled by their setup scripts.
+CREATE TABLE perf_load AS SELECT * FROM perf_tall WHERE 1 = 0;
+CREATE TABLE perf_copy AS SELECT * FROM perf_tall WHERE 1 = 0;
+
+.set loadbatchsize 5000
+.set loadcommitrows 100000
+.generate perf_tall rows 1000000 --parallel 4 --seed 1
+.generate perf_wide rows 50000 --parallel 4 --nulls 5 --seed 2
+.generate perf_lob rows 20000 --parallel 4 --seed 3
+.generate perf_mixed rows 200000 --parallel 4 --nulls 10 --seed 4
+
+BEGIN
+    FOR t IN (SELECT table_name FROM user_tables WHERE table_name LIKE 'PERF\_%' ESCAPE '\') LOOP
+        DBMS_STATS.GATHER_TABLE_STATS(USER, t.table_name);
+    END LOOP;
+END;
+/
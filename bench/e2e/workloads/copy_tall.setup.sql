@@ -0,0 +1,4 @@
+-- A fresh 200,000 rows to copy, untimed.
+TRUNCATE TABLE perf_copy;
+INSERT /*+ APPEND */ INTO perf_copy SELECT * FROM perf_tall WHERE ROWNUM <= 200000;
+COMMIT;
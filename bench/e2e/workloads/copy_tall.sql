@@ -0,0 +1,5 @@
+-- Copies the table onto itself through a second session: 200,000 rows read and
+-- 200,000 written, without going through text. The read sees the table as it was when
+-- the copy started.
+.set loadbatchsize 5000
+.copy FROM . TO . perf_copy
@@ -0,0 +1,2 @@
+-- Rows to a CSV file, which load_tall reads back in.
+.export csv perf_tall.csv perf_tall
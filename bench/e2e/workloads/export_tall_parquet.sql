@@ -0,0 +1,2 @@
+-- Rows to Parquet, four connections at a time.
+.export --parallel 4 parquet perf_tall.parquet perf_tall
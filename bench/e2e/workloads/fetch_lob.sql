@@ -0,0 +1,2 @@
+-- LOB locators and their reads, written as NDJSON.
+SELECT * FROM perf_lob;
@@ -0,0 +1,2 @@
+-- Fetch only: every row written as CSV to /dev/null.
+SELECT * FROM perf_tall;
@@ -0,0 +1,2 @@
+-- Per-column decoding across a hundred columns.
+SELECT * FROM perf_wide;
@@ -0,0 +1,2 @@
+-- Starts from an empty table, untimed.
+TRUNCATE TABLE perf_load;
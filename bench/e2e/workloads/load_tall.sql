@@ -0,0 +1,3 @@
+-- The CSV export_tall_csv wrote, array-bound in batches.
+.set loadbatchsize 5000
+.load perf_tall.csv INTO perf_load
@@ -0,0 +1,2 @@
+-- The table renderer: column widths, alignment and every type's text form.
+SELECT * FROM perf_mixed;
@@ -0,0 +1,79 @@
+#include "work_stealing.h"
+
+#include "benchmark/benchmark.h"
+
+#include <atomic>
+#include <future>
+#include <vector>
+
+namespace {
+
+using sqlplusplus::WorkStealingExecutor;
+
+constexpr size_t kTasks = 256;
+
+// A few hundred nanoseconds of work, about what formatting a column range of a small
+// block or one step of a load costs.
+uint64_t spin(uint64_t seed) {
+    for (int idx = 0; idx < 200; ++idx) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+    }
+    return seed;
+}
+
+// Every benchmark thread stands for a feature running batches of small tasks at once, all
+// of them on the shared executor.
+void BM_ExecutorRunAll(benchmark::State& state) {
+    auto& executor = WorkStealingExecutor::shared();
+    std::vector<uint64_t> results(kTasks);
+    for (auto _ : state) {
+        executor.runAll(kTasks, [&](size_t idx) { results[idx] = spin(idx + 1); });
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.SetItemsProcessed(state.iterations() * kTasks);
+}
+BENCHMARK(BM_ExecutorRunAll)->Threads(1)->Threads(4)->Threads(16)->UseRealTime();
+
+// The same tasks submitted one by one from each benchmark thread, as waiting on futures.
+void BM_ExecutorSubmit(benchmark::State& state) {
+    auto& executor = WorkStealingExecutor::shared();
+    std::vector<std::future<uint64_t>> futures(kTasks);
+    for (auto _ : state) {
+        for (size_t idx = 0; idx < kTasks; ++idx) {
+            futures[idx] = executor.submit([idx] { return spin(idx + 1); });
+        }
+        for (auto& future : futures) {
+            benchmark::DoNotOptimize(executor.wait(future));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kTasks);
+}
+BENCHMARK(BM_ExecutorSubmit)->Threads(1)->Threads(4)->Threads(16)->UseRealTime();
+
+// What each feature did before: threads of its own for every batch, with as many features
+// at once oversubscribing the cores.
+void BM_AsyncPerBatch(benchmark::State& state) {
+    const auto numThreads = sqlplusplus::sharedExecutorThreads();
+    std::vector<uint64_t> results(kTasks);
+    for (auto _ : state) {
+        std::atomic<size_t> next{0};
+        std::vector<std::future<void>> running;
+        for (uint32_t thread = 0; thread < numThreads; ++thread) {
+            running.push_back(std::async(std::launch::async, [&] {
+                for (auto idx = next++; idx < kTasks; idx = next++) {
+                    results[idx] = spin(idx + 1);
+                }
+            }));
+        }
+        for (auto& future : running) {
+            future.get();
+        }
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.SetItemsProcessed(state.iterations() * kTasks);
+}
+BENCHMARK(BM_AsyncPerBatch)->Threads(1)->Threads(4)->Threads(16)->UseRealTime();
+
+} // namespace
@@ -0,0 +1,289 @@
+#include "alloc_counter.h"
+#include "buffered_writer.h"
+#include "delimited_writer.h"
+#include "fetch_bench.h"
+#include "fetch_pipeline.h"
+#include "ndjson_writer.h"
+#include "synthetic_results.h"
+#include "table.h"
+#include "typed_rows.h"
+#include "value_format.h"
+
+#include "benchmark/benchmark.h"
+
+#include <optional>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+using namespace sqlplusplus;
+using Column = SyntheticResultSource::Column;
+
+constexpr uint64_t kRows = 100'000;
+
+enum Shape {
+    kNarrowNumeric,
+    kMixed,
+    kWideText,
+};
+
+std::vector<Column> columnsFor(int64_t shape) {
+    switch (shape) {
+    case kNarrowNumeric:
+        return {
+            {"ID", DPI_NATIVE_TYPE_INT64, DPI_ORACLE_TYPE_NUMBER},
+            {"QUANTITY", DPI_NATIVE_TYPE_INT64, DPI_ORACLE_TYPE_NUMBER},
+            {"PRICE", DPI_NATIVE_TYPE_DOUBLE, DPI_ORACLE_TYPE_NATIVE_DOUBLE},
+            {"FLAGS", DPI_NATIVE_TYPE_INT64, DPI_ORACLE_TYPE_NUMBER, 0, 10},
+        };
+    case kMixed:
+        return {
+            {"ID", DPI_NATIVE_TYPE_INT64, DPI_ORACLE_TYPE_NUMBER},
+            {"NAME", DPI_NATIVE_TYPE_BYTES, DPI_ORACLE_TYPE_VARCHAR, 24},
+            {"CREATED", DPI_NATIVE_TYPE_TIMESTAMP, DPI_ORACLE_TYPE_TIMESTAMP},
+            {"AMOUNT", DPI_NATIVE_TYPE_DOUBLE, DPI_ORACLE_TYPE_NATIVE_DOUBLE},
+            {"NOTES", DPI_NATIVE_TYPE_BYTES, DPI_ORACLE_TYPE_VARCHAR, 200, 5},
+        };
+    default: {
+        std::vector<Column> columns;
+        for (int idx = 0; idx < 20; ++idx) {
+            columns.push_back({"COL" + std::to_string(idx), DPI_NATIVE_TYPE_BYTES, DPI_ORACLE_TYPE_VARCHAR, 64});
+        }
+        return columns;
+    }
+    }
+}
+
+void shapes(benchmark::internal::Benchmark* bench) {
+    bench->ArgName("shape")->Arg(kNarrowNumeric)->Arg(kMixed)->Arg(kWideText)->Unit(benchmark::kMillisecond);
+}
+
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int ch) override {
+        return ch;
+    }
+    std::streamsize xsputn(const char*, std::streamsize count) override {
+        return count;
+    }
+};
+
+class DevNull {
+public:
+    DevNull() : _fd(::open("/dev/null", O_WRONLY | O_CLOEXEC)) {}
+    DevNull(const DevNull&) = delete;
+    DevNull& operator=(const DevNull&) = delete;
+    ~DevNull() {
+        ::close(_fd);
+    }
+    int fd() const noexcept {
+        return _fd;
+    }
+
+private:
+    int _fd;
+};
+
+void BM_FetchToCsv(benchmark::State& state) {
+    SyntheticResultSource source(columnsFor(state.range(0)), kRows);
+    DevNull devNull;
+    BufferedFdWriter out(devNull.fd());
+    for (auto _ : state) {
+        source.rewind();
+        DelimitedWriter writer(out, DelimitedFormat::Csv);
+        benchmark::DoNotOptimize(writeDelimitedResults(source, writer));
+    }
+    state.SetItemsProcessed(state.iterations() * kRows);
+}
+BENCHMARK(BM_FetchToCsv)->Apply(shapes);
+
+void BM_FetchToNdjson(benchmark::State& state) {
+    SyntheticResultSource source(columnsFor(state.range(0)), kRows);
+    DevNull devNull;
+    BufferedFdWriter out(devNull.fd());
+    for (auto _ : state) {
+        source.rewind();
+        benchmark::DoNotOptimize(writeNdjsonResults(source, out));
+    }
+    state.SetItemsProcessed(state.iterations() * kRows);
+}
+BENCHMARK(BM_FetchToNdjson)->Apply(shapes);
+
+// Each block formatted straight into a streaming table and flushed, all on one thread.
+void BM_FetchToTable(benchmark::State& state) {
+    SyntheticResultSource source(columnsFor(state.range(0)), kRows);
+    NullBuffer nullBuffer;
+    std::ostream out(&nullBuffer);
+    const auto numColumns = source.numColumns();
+    for (auto _ : state) {
+        source.rewind();
+        Table table(numColumns);
+        table.beginStreaming(out);
+        table.addRow();
+        for (uint32_t col = 1; col <= numColumns; ++col) {
+            table.setColumnValue(0, col - 1, source.getColumnInfo(col).name());
+        }
+        auto formatters = makeColumnFormatters(source);
+        for (;;) {
+            auto block = source.fetchBlock(source.fetchArraySize());
+            const auto firstRow = table.numRows;
+            for (uint32_t row = 0; row < block.numRows(); ++row) {
+                table.addRow();
+            }
+            for (uint32_t col = 1; col <= numColumns; ++col) {
+                const auto& formatter = formatters[col - 1];
+                const auto columnData = block.columnData(col);
+                for (uint32_t row = 0; row < block.numRows(); ++row) {
+                    const auto& data = columnData[row];
+                    table.emplaceColumnValue(firstRow + row, col - 1, formatter.sizeBound(data), [&](char* ptr) {
+                        return formatter.format(data, ptr);
+                    });
+                }
+            }
+            table.flush();
+            if (!block.moreRows()) {
+                break;
+            }
+        }
+        table.endStreaming();
+    }
+    state.SetItemsProcessed(state.iterations() * kRows);
+}
+BENCHMARK(BM_FetchToTable)->Apply(shapes);
+
+// The table path fetchAndPrintResults takes: blocks fetched and formatted on the pipeline's
+// thread while the last one is copied into the table and flushed. Synthetic fetches cost
+// nothing, so this measures the pipeline's overhead rather than any overlap.
+void BM_FetchToTablePipelined(benchmark::State& state) {
+    SyntheticResultSource source(columnsFor(state.range(0)), kRows);
+    NullBuffer nullBuffer;
+    std::ostream out(&nullBuffer);
+    const auto numColumns = source.numColumns();
+    for (auto _ : state) {
+        source.rewind();
+        Table table(numColumns);
+        table.beginStreaming(out);
+        table.addRow();
+        for (uint32_t col = 1; col <= numColumns; ++col) {
+            table.setColumnValue(0, col - 1, source.getColumnInfo(col).name());
+        }
+        FetchPipeline pipeline(source, kRows);
+        while (auto batch = pipeline.next()) {
+            const auto firstRow = table.numRows;
+            for (uint32_t row = 0; row < batch->numRows; ++row) {
+                table.addRow();
+            }
+            auto cell = batch->cells.begin();
+            for (uint32_t row = 0; row < batch->numRows; ++row) {
+                for (uint32_t col = 0; col < numColumns; ++col) {
+                    table.setColumnValue(firstRow + row, col, *cell++);
+                }
+            }
+            pipeline.recycle(std::move(batch));
+            table.flush();
+        }
+        table.endStreaming();
+    }
+    state.SetItemsProcessed(state.iterations() * kRows);
+}
+BENCHMARK(BM_FetchToTablePipelined)->Apply(shapes);
+
+// What .fetchbench measures: the blocks drained with nothing decoded, the floor under
+// every other path here.
+void BM_FetchDrainOnly(benchmark::State& state) {
+    SyntheticResultSource source(columnsFor(state.range(0)), kRows);
+    for (auto _ : state) {
+        source.rewind();
+        benchmark::DoNotOptimize(drainResults(source).bytes);
+    }
+    state.SetItemsProcessed(state.iterations() * kRows);
+}
+BENCHMARK(BM_FetchDrainOnly)->Apply(shapes);
+
+// Just the pipeline's fetch and format of 160 mixed columns in blocks of 1000 rows, wide
+// enough for the formatting to be split across threads.
+void BM_PipelineWideFormat(benchmark::State& state) {
+    std::vector<Column> columns;
+    for (int idx = 0; idx < 160; ++idx) {
+        const auto name = "COL" + std::to_string(idx);
+        if (idx % 2 == 0) {
+            columns.push_back({name, DPI_NATIVE_TYPE_DOUBLE, DPI_ORACLE_TYPE_NATIVE_DOUBLE});
+        } else {
+            columns.push_back({name, DPI_NATIVE_TYPE_BYTES, DPI_ORACLE_TYPE_VARCHAR, 24, 7});
+        }
+    }
+    constexpr uint64_t kWideRows = 20'000;
+    SyntheticResultSource source(std::move(columns), kWideRows, 1000);
+    for (auto _ : state) {
+        source.rewind();
+        FetchPipeline pipeline(source, kWideRows);
+        while (auto batch = pipeline.next()) {
+            benchmark::DoNotOptimize(batch->cells.data());
+            pipeline.recycle(std::move(batch));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kWideRows * 160);
+}
+BENCHMARK(BM_PipelineWideFormat)->Unit(benchmark::kMillisecond);
+
+// The mixed shape read value by value through OracleData::as<T>(), against the same rows
+// decoded by forEachRow() with the types checked once a block. The heap allocations the
+// values' as<T>() calls make are counted, leaving out the fetches, and reported a cell;
+// anything but none fails the benchmark.
+void BM_DecodeDynamic(benchmark::State& state) {
+    constexpr uint64_t kColumns = 5;
+    SyntheticResultSource source(columnsFor(kMixed), kRows);
+    uint64_t cellAllocations = 0;
+    for (auto _ : state) {
+        source.rewind();
+        int64_t sum = 0;
+        for (;;) {
+            auto block = source.fetchBlock(source.fetchArraySize());
+            const auto allocationsBefore = allocationCount();
+            for (uint32_t row = 0; row < block.numRows(); ++row) {
+                sum += block.value(1, row).as<int64_t>();
+                sum += block.value(2, row).as<std::string_view>().size();
+                sum += block.value(3, row).as<dpiTimestamp*>()->day;
+                sum += static_cast<int64_t>(block.value(4, row).as<double>());
+                auto notes = block.value(5, row);
+                sum += notes.isNull() ? 0 : notes.as<std::string_view>().size();
+            }
+            cellAllocations += allocationCount() - allocationsBefore;
+            if (!block.moreRows()) {
+                break;
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * kRows);
+    state.counters["allocs_per_cell"] = benchmark::Counter(
+            static_cast<double>(cellAllocations) / static_cast<double>(state.iterations() * kRows * kColumns));
+    if (cellAllocations != 0) {
+        state.SkipWithError("OracleData::as<T>() allocated");
+    }
+}
+BENCHMARK(BM_DecodeDynamic)->Unit(benchmark::kMillisecond);
+
+void BM_DecodeTyped(benchmark::State& state) {
+    SyntheticResultSource source(columnsFor(kMixed), kRows);
+    for (auto _ : state) {
+        source.rewind();
+        int64_t sum = 0;
+        forEachRow<int64_t, std::string_view, dpiTimestamp, double, std::optional<std::string_view>>(
+            source, [&](int64_t id, std::string_view name, const dpiTimestamp& created, double amount, auto notes) {
+            sum += id + name.size() + created.day + static_cast<int64_t>(amount) + (notes ? notes->size() : 0);
+        });
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * kRows);
+}
+BENCHMARK(BM_DecodeTyped)->Unit(benchmark::kMillisecond);
+
+} // namespace
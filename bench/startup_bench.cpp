@@ -0,0 +1,239 @@
+#include "cli_args.h"
+#include "keyword_cache.h"
+#include "oracle_helpers.h"
+#include "typed_rows.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+// Cold start, measured the way an interactive user pays for it: every run is a fresh
+// process, so the client libraries are loaded and the login made from scratch each time.
+// The driver re-executes itself once per run and the child times each stage of getting from
+// exec to the first row of a trivial query, which it reports back on a pipe. The driver
+// writes the runs and each stage's min, median and max as JSON.
+//
+// The REPL's prompt needs nothing past process_start, since the client libraries and the
+// login are put off until the first statement; the stages after it are what that first
+// statement waits for.
+//
+//   sqlplusplus_startup_bench -u scott -p tiger -c //db/orclpdb --runs 20 --report startup.json
+
+namespace {
+
+using namespace sqlplusplus;
+using Clock = std::chrono::steady_clock;
+
+constexpr std::array<std::string_view, 5> kStageNames = {
+    "process_start", "oci_load", "connect", "keywords", "first_row",
+};
+
+struct Run {
+    std::array<int64_t, kStageNames.size()> nanos{};
+    // Whether the keywords came from the on-disk cache or V$RESERVED_WORDS.
+    std::string keywordsFrom;
+};
+
+int64_t nanosSince(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+// The child: runs the stages and writes their times to stdout on one line.
+int runChild(int64_t spawnedAtNanos, const OracleConnectionOptions& opts, bool keywordQuery) {
+    Run run;
+    // steady_clock is CLOCK_MONOTONIC, the same in both processes.
+    run.nanos[0] = Clock::now().time_since_epoch().count() - spawnedAtNanos;
+
+    auto start = Clock::now();
+    auto ctx = OracleContext::make();
+    run.nanos[1] = nanosSince(start);
+
+    start = Clock::now();
+    auto conn = OracleConnection::make(ctx.get(), opts);
+    run.nanos[2] = nanosSince(start);
+
+    start = Clock::now();
+    std::optional<tsl::htrie_set<char>> keywords;
+    if (!keywordQuery) {
+        keywords = loadKeywordCache(keywordCachePath(conn.serverVersion()));
+    }
+    run.keywordsFrom = keywords ? "cache" : "query";
+    if (!keywords) {
+        keywords = fetchReservedKeywords(conn);
+    }
+    run.nanos[3] = nanosSince(start);
+
+    start = Clock::now();
+    auto stmt = conn.prepareStatement("SELECT 'x' FROM dual");
+    stmt.execute();
+    forEachRow<std::string_view>(stmt, [](std::string_view) {});
+    run.nanos[4] = nanosSince(start);
+
+    for (const auto nanos : run.nanos) {
+        std::cout << nanos << ' ';
+    }
+    std::cout << run.keywordsFrom << std::endl;
+    return 0;
+}
+
+// Runs one child with args, the driver's own less --runs and --report, and parses its line.
+Run spawnChild(const std::vector<std::string>& args) {
+    int fds[2];
+    if (::pipe2(fds, O_CLOEXEC) == -1) {
+        throw std::system_error(errno, std::generic_category(), "error creating pipe");
+    }
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+
+    std::vector<std::string> childArgs = {"/proc/self/exe", "--child",
+                                          std::to_string(Clock::now().time_since_epoch().count())};
+    childArgs.insert(childArgs.end(), args.begin(), args.end());
+    std::vector<char*> argv;
+    for (auto& arg : childArgs) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+    pid_t pid = 0;
+    const int rc = ::posix_spawn(&pid, "/proc/self/exe", &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    ::close(fds[1]);
+    if (rc != 0) {
+        ::close(fds[0]);
+        throw std::system_error(rc, std::generic_category(), "error starting a run");
+    }
+
+    std::string output;
+    char buffer[256];
+    for (;;) {
+        const auto count = ::read(fds[0], buffer, sizeof(buffer));
+        if (count > 0) {
+            output.append(buffer, static_cast<size_t>(count));
+        } else if (count == 0 || errno != EINTR) {
+            break;
+        }
+    }
+    ::close(fds[0]);
+    int status = 0;
+    while (::waitpid(pid, &status, 0) == -1 && errno == EINTR) {
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        // The child has already said why on stderr.
+        throw std::runtime_error("a run failed");
+    }
+
+    Run run;
+    std::istringstream line(output);
+    for (auto& nanos : run.nanos) {
+        line >> nanos;
+    }
+    line >> run.keywordsFrom;
+    if (!line) {
+        throw std::runtime_error(fmt::format("unexpected output from a run: \"{}\"", output));
+    }
+    return run;
+}
+
+double millis(int64_t nanos) {
+    return nanos / 1e6;
+}
+
+std::string report(const std::vector<Run>& runs) {
+    fmt::memory_buffer out;
+    fmt::format_to(out, "{{\"runs\":{},\"stages\":{{", runs.size());
+    for (size_t stage = 0; stage <= kStageNames.size(); ++stage) {
+        // The last one is the total, from exec to the first row.
+        std::vector<int64_t> nanos;
+        for (const auto& run : runs) {
+            nanos.push_back(stage < kStageNames.size() ? run.nanos[stage]
+                    : std::accumulate(run.nanos.begin(), run.nanos.end(), int64_t{0}));
+        }
+        std::sort(nanos.begin(), nanos.end());
+        fmt::format_to(out, "{}\"{}\":{{\"min_ms\":{:.3f},\"median_ms\":{:.3f},\"max_ms\":{:.3f}}}",
+                stage == 0 ? "" : ",", stage < kStageNames.size() ? kStageNames[stage] : "total",
+                millis(nanos.front()), millis(nanos[nanos.size() / 2]), millis(nanos.back()));
+    }
+    fmt::format_to(out, "}},\"samples\":[");
+    for (size_t idx = 0; idx < runs.size(); ++idx) {
+        fmt::format_to(out, "{}{{", idx == 0 ? "" : ",");
+        for (size_t stage = 0; stage < kStageNames.size(); ++stage) {
+            fmt::format_to(out, "\"{}_ms\":{:.3f},", kStageNames[stage], millis(runs[idx].nanos[stage]));
+        }
+        fmt::format_to(out, "\"keywords_from\":\"{}\"}}", runs[idx].keywordsFrom);
+    }
+    fmt::format_to(out, "]}}\n");
+    return fmt::to_string(out);
+}
+
+} // namespace
+
+int main(int argc, const char** argv) try {
+    CliArgumentParser parser;
+    CliArgument connStringArg(parser, "connectionString", 'c');
+    CliArgument usernameArg(parser, "username", 'u');
+    CliArgument passwordArg(parser, "password", 'p');
+    CliArgument runsArg(parser, "runs");
+    CliArgument reportArg(parser, "report");
+    CliFlag keywordQueryFlag(parser, "keyword-query");
+    CliArgument childArg(parser, "child");
+    parser.parse(argc, argv);
+
+    OracleConnectionOptions opts;
+    opts.connString = connStringArg.as<std::string>();
+    opts.username = usernameArg.as<std::string>();
+    opts.password = passwordArg.as<std::string>();
+    if (childArg) {
+        return runChild(childArg.as<int64_t>(), opts, static_cast<bool>(keywordQueryFlag));
+    }
+
+    // What the children get: the connection and how to load the keywords.
+    std::vector<std::string> childArgs = {"-c", opts.connString, "-u", opts.username, "-p", opts.password};
+    if (keywordQueryFlag) {
+        childArgs.emplace_back("--keyword-query");
+    }
+    const auto runCount = runsArg ? std::max<int64_t>(runsArg.as<int64_t>(), 1) : 10;
+    std::vector<Run> runs;
+    for (int64_t idx = 0; idx < runCount; ++idx) {
+        runs.push_back(spawnChild(childArgs));
+    }
+
+    const auto text = report(runs);
+    if (reportArg) {
+        std::ofstream out(reportArg.as<std::string>());
+        out << text;
+        if (!out.flush()) {
+            throw std::runtime_error(fmt::format("error writing {}", reportArg.value()));
+        }
+    } else {
+        std::cout << text;
+    }
+    return 0;
+} catch (const OracleException& e) {
+    std::cerr << "Error " << e.context() << ": " << e.what() << std::endl;
+    return 1;
+} catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+}
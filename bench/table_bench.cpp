@@ -0,0 +1,121 @@
+#include "display_width.h"
+#include "table.h"
+
+#include "benchmark/benchmark.h"
+
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace {
+
+using sqlplusplus::Table;
+
+// Throws away whatever's rendered, so only building the text is measured.
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int ch) override {
+        return ch;
+    }
+    std::streamsize xsputn(const char*, std::streamsize count) override {
+        return count;
+    }
+};
+
+std::vector<std::string> cellValues(bool multiLine) {
+    std::vector<std::string> values;
+    for (int idx = 0; idx < 64; ++idx) {
+        auto value = std::string("value ") + std::to_string(idx * 7919);
+        if (multiLine && idx % 4 == 0) {
+            value += "\nsecond line of the cell\nthird";
+        }
+        values.push_back(std::move(value));
+    }
+    return values;
+}
+
+void fillTable(Table& table, uint32_t numRows, const std::vector<std::string>& values) {
+    const auto numColumns = static_cast<uint32_t>(table.columns.size());
+    size_t next = 0;
+    for (uint32_t row = 0; row < numRows; ++row) {
+        auto rowIndex = table.addRow();
+        for (uint32_t col = 0; col < numColumns; ++col) {
+            table.setColumnValue(rowIndex, col, values[next++ % values.size()]);
+        }
+    }
+}
+
+// Args: columns, rows, multi-line cells.
+void tableShapes(benchmark::internal::Benchmark* bench) {
+    bench->ArgNames({"columns", "rows", "multiLine"});
+    bench->Args({4, 1000, 0});   // narrow and tall
+    bench->Args({64, 100, 0});   // wide
+    bench->Args({8, 1000, 1});   // multi-line cells
+}
+
+void BM_TableSetColumnValue(benchmark::State& state) {
+    const auto numColumns = static_cast<uint32_t>(state.range(0));
+    const auto numRows = static_cast<uint32_t>(state.range(1));
+    const auto values = cellValues(state.range(2) != 0);
+    for (auto _ : state) {
+        Table table(numColumns);
+        fillTable(table, numRows, values);
+        benchmark::DoNotOptimize(table.cells.data());
+    }
+    state.SetItemsProcessed(state.iterations() * numRows * numColumns);
+}
+BENCHMARK(BM_TableSetColumnValue)->Apply(tableShapes);
+
+void BM_TableRender(benchmark::State& state) {
+    const auto numColumns = static_cast<uint32_t>(state.range(0));
+    const auto numRows = static_cast<uint32_t>(state.range(1));
+    Table table(numColumns);
+    fillTable(table, numRows, cellValues(state.range(2) != 0));
+    NullBuffer nullBuffer;
+    std::ostream out(&nullBuffer);
+    for (auto _ : state) {
+        table.render(out);
+    }
+    state.SetItemsProcessed(state.iterations() * numRows);
+}
+BENCHMARK(BM_TableRender)->Apply(tableShapes);
+
+// The streaming path fetchAndPrintResults uses: a block of rows at a time, then flush().
+void BM_TableStreamingFlush(benchmark::State& state) {
+    const auto numColumns = static_cast<uint32_t>(state.range(0));
+    const auto numRows = static_cast<uint32_t>(state.range(1));
+    const auto values = cellValues(state.range(2) != 0);
+    constexpr uint32_t kBlockRows = 100;
+    NullBuffer nullBuffer;
+    std::ostream out(&nullBuffer);
+    for (auto _ : state) {
+        Table table(numColumns);
+        table.beginStreaming(out);
+        for (uint32_t done = 0; done < numRows; done += kBlockRows) {
+            fillTable(table, std::min(kBlockRows, numRows - done), values);
+            table.flush();
+        }
+        table.endStreaming();
+    }
+    state.SetItemsProcessed(state.iterations() * numRows);
+}
+BENCHMARK(BM_TableStreamingFlush)->Apply(tableShapes);
+
+// Cell widths for the common all-ASCII case, which the SIMD check settles, and for text
+// that needs every character's width looked up.
+void BM_DisplayWidth(benchmark::State& state, std::string_view unit) {
+    std::string text;
+    while (text.size() < 64) {
+        text.append(unit);
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sqlplusplus::displayWidth(text));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+BENCHMARK_CAPTURE(BM_DisplayWidth, ascii, std::string_view("customer name "));
+BENCHMARK_CAPTURE(BM_DisplayWidth, latin, std::string_view("José Müller "));
+BENCHMARK_CAPTURE(BM_DisplayWidth, cjk, std::string_view("東京都千代田区 "));
+
+} // namespace
@@ -0,0 +1,92 @@
+#include "json_text.h"
+#include "table.h"
+#include "value_format.h"
+
+#include "benchmark/benchmark.h"
+#include "dpi.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+using sqlplusplus::ColumnFormatter;
+using sqlplusplus::Table;
+
+constexpr uint32_t kBlockRows = 100;
+
+// A block's worth of values of one type, every tenth one null.
+std::vector<dpiData> makeBlock(dpiNativeTypeNum nativeType, std::vector<std::string>& text) {
+    std::vector<dpiData> block(kBlockRows);
+    text.resize(kBlockRows);
+    for (uint32_t row = 0; row < kBlockRows; ++row) {
+        auto& data = block[row];
+        std::memset(&data, 0, sizeof(data));
+        data.isNull = row % 10 == 9;
+        switch (nativeType) {
+        case DPI_NATIVE_TYPE_INT64:
+            data.value.asInt64 = static_cast<int64_t>(row) * 1'000'003 - 50'000'000;
+            break;
+        case DPI_NATIVE_TYPE_DOUBLE:
+            data.value.asDouble = row * 3.14159265358979 / 7.0;
+            break;
+        case DPI_NATIVE_TYPE_BYTES:
+            text[row] = "some varchar2 text " + std::to_string(row);
+            data.value.asBytes.ptr = text[row].data();
+            data.value.asBytes.length = static_cast<uint32_t>(text[row].size());
+            break;
+        case DPI_NATIVE_TYPE_TIMESTAMP:
+            data.value.asTimestamp = dpiTimestamp{2021, 3, 14, 15, 9, 26, 535897000, 0, 0};
+            break;
+        default:
+            break;
+        }
+    }
+    return block;
+}
+
+// The inner loop of fetchAndPrintResults: each value formatted straight into a table cell.
+void BM_FormatIntoTable(benchmark::State& state) {
+    const auto nativeType = static_cast<dpiNativeTypeNum>(state.range(0));
+    std::vector<std::string> text;
+    const auto block = makeBlock(nativeType, text);
+    const ColumnFormatter formatter(nativeType);
+    for (auto _ : state) {
+        Table table(1);
+        for (uint32_t row = 0; row < kBlockRows; ++row) {
+            table.addRow();
+        }
+        for (uint32_t row = 0; row < kBlockRows; ++row) {
+            const auto& data = block[row];
+            table.emplaceColumnValue(row, 0, formatter.sizeBound(data), [&](char* out) {
+                return formatter.format(data, out);
+            });
+        }
+        benchmark::DoNotOptimize(table.cells.data());
+    }
+    state.SetItemsProcessed(state.iterations() * kBlockRows);
+}
+BENCHMARK(BM_FormatIntoTable)
+    ->ArgName("nativeType")
+    ->Arg(DPI_NATIVE_TYPE_INT64)
+    ->Arg(DPI_NATIVE_TYPE_DOUBLE)
+    ->Arg(DPI_NATIVE_TYPE_BYTES)
+    ->Arg(DPI_NATIVE_TYPE_TIMESTAMP);
+
+// NDJSON export's string values: escaped every 1 in range(0) bytes, or never for 0.
+void BM_WriteJsonString(benchmark::State& state) {
+    const auto escapeEvery = static_cast<size_t>(state.range(0));
+    std::string value;
+    for (size_t idx = 0; idx < 4096; ++idx) {
+        value += escapeEvery != 0 && idx % escapeEvery == escapeEvery - 1 ? '"' : static_cast<char>('a' + idx % 26);
+    }
+    std::vector<char> out(sqlplusplus::jsonStringSizeBound(value.size()));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sqlplusplus::writeJsonString(value, out.data()));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(value.size()));
+}
+BENCHMARK(BM_WriteJsonString)->ArgName("escapeEvery")->Arg(0)->Arg(64)->Arg(8);
+
+} // namespace
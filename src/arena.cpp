@@ -0,0 +1,76 @@
+#include "arena.h"
+
+#include <cstring>
+
+namespace sqlplusplus {
+
+char* StringArena::allocate(size_t size) {
+    _bytesUsed += size;
+    if (size > _blockSize) {
+        Block block;
+        block.data = std::make_unique<char[]>(size);
+        block.size = size;
+        block.used = size;
+        ++_blocksAllocated;
+        _largeBlocks.push_back(std::move(block));
+        _lastAllocation = &_largeBlocks.back();
+        return _lastAllocation->data.get();
+    }
+
+    for (; _currentBlock < _blocks.size(); ++_currentBlock) {
+        auto& block = _blocks[_currentBlock];
+        if (block.size - block.used >= size) {
+            auto ptr = block.data.get() + block.used;
+            block.used += size;
+            _lastAllocation = &block;
+            return ptr;
+        }
+    }
+
+    Block block;
+    block.data = std::make_unique<char[]>(_blockSize);
+    block.size = _blockSize;
+    block.used = size;
+    ++_blocksAllocated;
+    _blocks.push_back(std::move(block));
+    _currentBlock = _blocks.size() - 1;
+    _lastAllocation = &_blocks.back();
+    return _lastAllocation->data.get();
+}
+
+void StringArena::shrinkLast(size_t unusedBytes) noexcept {
+    if (_lastAllocation == nullptr) {
+        return;
+    }
+    _lastAllocation->used -= unusedBytes;
+    _bytesUsed -= unusedBytes;
+}
+
+std::string_view StringArena::append(std::string_view value) {
+    if (value.empty()) {
+        return std::string_view{};
+    }
+    auto ptr = allocate(value.size());
+    std::memcpy(ptr, value.data(), value.size());
+    return std::string_view(ptr, value.size());
+}
+
+void StringArena::reset() {
+    for (auto& block : _blocks) {
+        block.used = 0;
+    }
+    _largeBlocks.clear();
+    _lastAllocation = nullptr;
+    _currentBlock = 0;
+    _bytesUsed = 0;
+}
+
+size_t StringArena::bytesReserved() const noexcept {
+    size_t total = _blocks.size() * _blockSize;
+    for (const auto& block : _largeBlocks) {
+        total += block.size;
+    }
+    return total;
+}
+
+} // namespace sqlplusplus
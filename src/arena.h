@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+// Append-only storage for lots of small strings. Bytes are carved out of fixed size blocks
+// so storing a value never allocates on its own, and views returned by append() stay valid
+// until reset(). reset() keeps the regular blocks around so a reused arena stops touching
+// the allocator once it has grown to its working size.
+class StringArena {
+public:
+    static constexpr size_t kDefaultBlockSize = 64 * 1024;
+
+    explicit StringArena(size_t blockSize = kDefaultBlockSize) : _blockSize(blockSize) {}
+
+    StringArena(StringArena&&) noexcept = default;
+    StringArena& operator=(StringArena&&) noexcept = default;
+
+    // Returns size bytes of uninitialized storage.
+    char* allocate(size_t size);
+    // Gives back the last unused bytes of the most recent allocation, for callers that
+    // allocate an upper bound and then write less.
+    void shrinkLast(size_t unusedBytes) noexcept;
+    std::string_view append(std::string_view value);
+
+    void reset();
+
+    size_t bytesUsed() const noexcept {
+        return _bytesUsed;
+    }
+    size_t bytesReserved() const noexcept;
+    // Blocks taken from the allocator over the arena's lifetime, large ones included.
+    size_t blocksAllocated() const noexcept {
+        return _blocksAllocated;
+    }
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size = 0;
+        size_t used = 0;
+    };
+
+    size_t _blockSize;
+    size_t _currentBlock = 0;
+    size_t _bytesUsed = 0;
+    size_t _blocksAllocated = 0;
+    Block* _lastAllocation = nullptr;
+    std::vector<Block> _blocks;
+    // Values bigger than a block get a block of their own, and are freed on reset().
+    std::vector<Block> _largeBlocks;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,198 @@
+#include "async_output.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <system_error>
+#include <utility>
+
+#include <sys/uio.h>
+
+namespace sqlplusplus {
+namespace {
+
+// Spare chunks kept past this are let go of, so one burst of output doesn't hold on to
+// its memory.
+constexpr size_t kMaxSpareChunks = 4;
+
+// Writes every chunk out, in order, as few writev(2) calls as the kernel takes them in.
+// Returns 0, or the errno of the write that failed.
+int writeChunks(int fd, const std::vector<std::string>& chunks) {
+    std::vector<iovec> iovecs;
+    iovecs.reserve(chunks.size());
+    for (const auto& chunk : chunks) {
+        iovecs.push_back({const_cast<char*>(chunk.data()), chunk.size()});
+    }
+    auto next = iovecs.begin();
+    while (next != iovecs.end()) {
+        const auto count = static_cast<int>(std::min<ptrdiff_t>(iovecs.end() - next, IOV_MAX));
+        const auto rc = ::writev(fd, &*next, count);
+        if (rc == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        // Past what was written in full, then into the chunk it stopped part way through.
+        auto written = static_cast<size_t>(rc);
+        while (next != iovecs.end() && written >= next->iov_len) {
+            written -= next->iov_len;
+            ++next;
+        }
+        if (written > 0) {
+            next->iov_base = static_cast<char*>(next->iov_base) + written;
+            next->iov_len -= written;
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+AsyncOutputBuffer::AsyncOutputBuffer(int fd, size_t maxQueuedBytes) :
+    _fd(fd),
+    _chunk(kChunkSize, '\0'),
+    _maxQueuedBytes(maxQueuedBytes)
+{
+    setp(_chunk.data(), _chunk.data() + _chunk.size());
+    _thread = std::thread([this] { _run(); });
+}
+
+AsyncOutputBuffer::~AsyncOutputBuffer() {
+    try {
+        drain();
+    } catch(const std::exception&) {
+        // Nowhere to report it from a destructor.
+    }
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _stopping = true;
+    }
+    _cv.notify_all();
+    _thread.join();
+}
+
+void AsyncOutputBuffer::setMaxQueuedBytes(size_t maxQueuedBytes) {
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _maxQueuedBytes = maxQueuedBytes;
+    }
+    _cv.notify_all();
+}
+
+size_t AsyncOutputBuffer::queuedBytes() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    return _queuedBytes;
+}
+
+void AsyncOutputBuffer::drain() {
+    _handOff();
+    std::unique_lock<std::mutex> lk(_mutex);
+    _cv.wait(lk, [this] { return _queued.empty() && !_writing; });
+    if (_error != 0) {
+        throw std::system_error(std::exchange(_error, 0), std::generic_category(), "error writing output");
+    }
+}
+
+int AsyncOutputBuffer::overflow(int ch) {
+    _handOff();
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+        return traits_type::not_eof(ch);
+    }
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+std::streamsize AsyncOutputBuffer::xsputn(const char* data, std::streamsize size) {
+    auto remaining = static_cast<size_t>(size);
+    while (remaining > 0) {
+        if (pptr() == epptr()) {
+            _handOff();
+        }
+        const auto chunk = std::min(remaining, static_cast<size_t>(epptr() - pptr()));
+        std::memcpy(pptr(), data, chunk);
+        pbump(static_cast<int>(chunk));
+        data += chunk;
+        remaining -= chunk;
+    }
+    return size;
+}
+
+int AsyncOutputBuffer::sync() {
+    _handOff();
+    return 0;
+}
+
+void AsyncOutputBuffer::_handOff() {
+    const auto used = static_cast<size_t>(pptr() - pbase());
+    if (used == 0) {
+        return;
+    }
+    _chunk.resize(used);
+    {
+        std::unique_lock<std::mutex> lk(_mutex);
+        // One chunk is always let through, so a bound smaller than a chunk still writes.
+        _cv.wait(lk, [this, used] {
+            return _error != 0 || (_queued.empty() && !_writing) || _queuedBytes + used <= _maxQueuedBytes;
+        });
+        if (_error == 0) {
+            _queued.push_back(std::move(_chunk));
+            _queuedBytes += used;
+        }
+        // After a failed write there's nothing to queue it for; drain() reports why.
+        if (!_spare.empty()) {
+            _chunk = std::move(_spare.back());
+            _spare.pop_back();
+        } else {
+            _chunk = std::string();
+        }
+    }
+    _cv.notify_all();
+    _chunk.resize(kChunkSize);
+    setp(_chunk.data(), _chunk.data() + _chunk.size());
+}
+
+void AsyncOutputBuffer::_run() {
+    std::vector<std::string> batch;
+    std::unique_lock<std::mutex> lk(_mutex);
+    for (;;) {
+        _cv.wait(lk, [this] { return _stopping || !_queued.empty(); });
+        if (_queued.empty()) {
+            return;
+        }
+        size_t batchBytes = 0;
+        for (auto& chunk : _queued) {
+            batchBytes += chunk.size();
+            batch.push_back(std::move(chunk));
+        }
+        _queued.clear();
+        _writing = true;
+        lk.unlock();
+
+        const int error = writeChunks(_fd, batch);
+
+        lk.lock();
+        _writing = false;
+        _queuedBytes -= batchBytes;
+        if (error != 0 && _error == 0) {
+            _error = error;
+            // What was queued behind it would only be written with a gap in the output.
+            for (const auto& chunk : _queued) {
+                _queuedBytes -= chunk.size();
+            }
+            _queued.clear();
+        }
+        for (auto& chunk : batch) {
+            if (_spare.size() < kMaxSpareChunks) {
+                chunk.clear();
+                _spare.push_back(std::move(chunk));
+            }
+        }
+        batch.clear();
+        _cv.notify_all();
+    }
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sqlplusplus {
+
+// A streambuf that writes to an fd from a thread of its own, so whoever's writing to it,
+// such as a result table being streamed while the next block is fetched, carries on while
+// a slow terminal over SSH, or a file on NFS, catches up. A flush hands the buffered
+// bytes to the writer thread rather than waiting for them to be written, and the
+// writer gathers everything that has queued up by the time it gets to it into one
+// writev(2). Once maxQueuedBytes are waiting to be written, the writer holds up the next
+// hand-off until it has caught up, so memory stays bounded however stalled the fd is.
+//
+// drain() is what waits for the writes, and has to come before anything else writes to
+// the fd, or reads from a terminal it's shown on. A failed write is rethrown from it as a
+// std::system_error, and whatever was still queued is dropped.
+class AsyncOutputBuffer : public std::streambuf {
+public:
+    static constexpr size_t kChunkSize = 256 * 1024;
+
+    AsyncOutputBuffer(int fd, size_t maxQueuedBytes);
+    AsyncOutputBuffer(const AsyncOutputBuffer&) = delete;
+    AsyncOutputBuffer& operator=(const AsyncOutputBuffer&) = delete;
+    // Drains what's queued; errors are dropped, so callers that care drain() first.
+    ~AsyncOutputBuffer() override;
+
+    void setMaxQueuedBytes(size_t maxQueuedBytes);
+    // Bytes handed off and not yet written: how far behind the fd is.
+    size_t queuedBytes();
+    // Writes out everything streamed so far, then rethrows the first error since the last
+    // drain(), if there was one.
+    void drain();
+
+protected:
+    int overflow(int ch) override;
+    std::streamsize xsputn(const char* data, std::streamsize size) override;
+    int sync() override;
+
+private:
+    // Queues the put area to be written, waiting while too much already is, and starts a
+    // fresh one.
+    void _handOff();
+    void _run();
+
+    const int _fd;
+    std::string _chunk;
+
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    // Guarded by _mutex, like everything after it.
+    size_t _maxQueuedBytes;
+    std::deque<std::string> _queued;
+    size_t _queuedBytes = 0;
+    // The writer thread has taken chunks off the queue and isn't done writing them.
+    bool _writing = false;
+    // Written chunks, kept for their capacity.
+    std::vector<std::string> _spare;
+    int _error = 0;
+    bool _stopping = false;
+    std::thread _thread;
+};
+
+} // namespace sqlplusplus
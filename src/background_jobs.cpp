@@ -0,0 +1,224 @@
+#include "background_jobs.h"
+
+#include "result_metadata.h"
+#include "value_format.h"
+
+#include "fmt/format.h"
+
+#include <chrono>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace sqlplusplus {
+namespace {
+
+constexpr uint32_t kFetchArraySize = 1000;
+// Rows past the memory budget are spilled in batches of about this many bytes, and mapped
+// back one batch at a time.
+constexpr size_t kSpillBatchBytes = 1024 * 1024;
+// Distinct values interned per column of the rows kept in memory, and the longest one.
+constexpr uint32_t kMaxInternedValues = 64 * 1024;
+constexpr size_t kMaxInternedValueBytes = 64;
+
+std::string errorMessage(const std::exception& e) {
+    if (auto oracleError = dynamic_cast<const OracleException*>(&e)) {
+        return fmt::format("{}: {}", oracleError->context(), oracleError->what());
+    }
+    return e.what();
+}
+
+} // namespace
+
+BackgroundJob::BackgroundJob(std::function<OracleConnection()> newConnection, std::string sql, size_t memoryBytes)
+    : _newConnection(std::move(newConnection)),
+      _sql(std::move(sql)),
+      _memoryBudget(memoryBytes),
+      _thread([this] { _run(); })
+{}
+
+BackgroundJob::~BackgroundJob() {
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _cancelled = true;
+        if (_conn && _state == State::Running) {
+            try {
+                _conn->breakExecution();
+            } catch(const std::exception&) {
+                // The job is being thrown away either way.
+            }
+        }
+    }
+    _thread.join();
+}
+
+BackgroundJob::Status BackgroundJob::status() const {
+    std::lock_guard<std::mutex> lk(_mutex);
+    Status ret;
+    ret.state = _state;
+    ret.rows = _rows;
+    ret.seconds = _seconds;
+    ret.message = _message;
+    ret.bufferedBytes = _bufferedBytes;
+    ret.spilled = _spilled;
+    return ret;
+}
+
+void BackgroundJob::wait() {
+    std::unique_lock<std::mutex> lk(_mutex);
+    _finished.wait(lk, [this] { return _state != State::Running; });
+}
+
+void BackgroundJob::_flushSpill() {
+    if (_spillBatch.empty()) {
+        return;
+    }
+    _spillExtents.push_back(_spillFile->append(_spillBatch));
+    _spillBatch.clear();
+}
+
+void BackgroundJob::_appendRow(const std::vector<std::string_view>& cells) {
+    // Once rows start going to disk they all do, so they read back in order.
+    if (!_spillFile) {
+        // Priced as if every value were new, and interned, so the budget holds either way.
+        size_t size = 0;
+        for (auto cell : cells) {
+            size += 2 * sizeof(uint32_t) + 2 * cell.size();
+        }
+        if (_memoryBytes + size <= _memoryBudget) {
+            for (size_t col = 0; col < cells.size(); ++col) {
+                auto& values = _memoryValues[col];
+                const auto before = values.bytes();
+                _memoryIds.push_back(values.add(cells[col]));
+                _memoryBytes += sizeof(uint32_t) + values.bytes() - before;
+            }
+            return;
+        }
+        _spillFile = std::make_unique<SpillFile>("job");
+    }
+    _spillBatch.addRow(cells.data());
+    if (_spillBatch.bytes() >= kSpillBatchBytes) {
+        _flushSpill();
+    }
+}
+
+void BackgroundJob::_run() {
+    const auto start = std::chrono::steady_clock::now();
+    State state = State::Done;
+    std::string message;
+    try {
+        auto conn = _newConnection();
+        {
+            std::lock_guard<std::mutex> lk(_mutex);
+            if (_cancelled) {
+                throw std::runtime_error("cancelled");
+            }
+            _conn.emplace(conn.share());
+        }
+        auto stmt = conn.prepareStatement(_sql);
+        stmt.setFetchArraySize(kFetchArraySize);
+        stmt.execute();
+        if (stmt.isQuery()) {
+            const auto numColumns = stmt.numColumns();
+            _columnNames = stmt.metadata()->names();
+            _memoryValues.assign(numColumns, StringDictionary(kMaxInternedValues, kMaxInternedValueBytes));
+            _spillBatch = SpillBatchBuilder(numColumns);
+            auto formatters = makeColumnFormatters(stmt);
+            std::string values;
+            std::vector<size_t> ends(numColumns);
+            std::vector<std::string_view> cells(numColumns);
+            for (;;) {
+                auto block = stmt.fetchBlock(kFetchArraySize);
+                for (uint32_t row = 0; row < block.numRows(); ++row) {
+                    values.clear();
+                    for (uint32_t col = 1; col <= numColumns; ++col) {
+                        auto& formatter = formatters[col - 1];
+                        if (formatter.nativeType() != block.nativeType(col)) {
+                            formatter = ColumnFormatter(block.nativeType(col), formatter.oracleType());
+                        }
+                        const auto& data = block.columnData(col)[row];
+                        const auto used = values.size();
+                        values.resize(used + formatter.sizeBound(data));
+                        auto end = formatter.format(data, values.data() + used);
+                        values.resize(static_cast<size_t>(end - values.data()));
+                        ends[col - 1] = values.size();
+                    }
+                    for (uint32_t col = 0; col < numColumns; ++col) {
+                        const auto begin = col == 0 ? 0 : ends[col - 1];
+                        cells[col] = std::string_view(values).substr(begin, ends[col] - begin);
+                    }
+                    _appendRow(cells);
+                }
+                {
+                    std::lock_guard<std::mutex> lk(_mutex);
+                    _rows += block.numRows();
+                    _bufferedBytes = _memoryBytes + _spillBatch.bytes() + (_spillFile ? _spillFile->bytes() : 0);
+                    _spilled = _spillFile != nullptr;
+                }
+                if (!block.moreRows()) {
+                    break;
+                }
+            }
+            if (_spillFile) {
+                _flushSpill();
+            }
+        } else {
+            const auto rows = stmt.isDML() ? stmt.rowCount() : 0;
+            conn.commit();
+            message = stmt.isDML() ? fmt::format("{} {} affected", rows, rows == 1 ? "row" : "rows")
+                : "Statement executed";
+        }
+    } catch(const std::exception& e) {
+        state = State::Failed;
+        message = errorMessage(e);
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::lock_guard<std::mutex> lk(_mutex);
+    _conn.reset();
+    _state = state;
+    _message = std::move(message);
+    _seconds = elapsed.count();
+    _finished.notify_all();
+}
+
+void BackgroundJob::forEachRow(const std::function<void(const std::vector<std::string_view>&)>& onRow) const {
+    const auto numColumns = _columnNames.size();
+    if (numColumns == 0) {
+        return;
+    }
+    std::vector<std::string_view> cells(numColumns);
+    for (size_t idx = 0; idx < _memoryIds.size(); idx += numColumns) {
+        for (size_t col = 0; col < numColumns; ++col) {
+            cells[col] = _memoryValues[col].value(_memoryIds[idx + col]);
+        }
+        onRow(cells);
+    }
+    for (const auto& extent : _spillExtents) {
+        const auto batch = _spillFile->map(extent);
+        for (uint32_t row = 0; row < batch.numRows(); ++row) {
+            for (uint32_t col = 0; col < numColumns; ++col) {
+                cells[col] = batch.cell(row, col);
+            }
+            onRow(cells);
+        }
+    }
+}
+
+uint32_t BackgroundJobs::start(std::function<OracleConnection()> newConnection, std::string sql, size_t memoryBytes) {
+    const auto id = _nextId++;
+    _jobs.emplace(id, std::make_unique<BackgroundJob>(std::move(newConnection), std::move(sql), memoryBytes));
+    return id;
+}
+
+std::unique_ptr<BackgroundJob> BackgroundJobs::take(uint32_t id) {
+    auto it = id == 0 ? (_jobs.empty() ? _jobs.end() : std::prev(_jobs.end())) : _jobs.find(id);
+    if (it == _jobs.end()) {
+        throw std::runtime_error(id == 0 ? "no background jobs" : fmt::format("no background job {}", id));
+    }
+    auto job = std::move(it->second);
+    _jobs.erase(it);
+    return job;
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "oracle_helpers.h"
+#include "spill_file.h"
+#include "string_dictionary.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace sqlplusplus {
+
+// A statement run to completion on its own connection while the REPL carries on. A query's
+// rows are formatted as they're fetched and buffered in memory up to a byte budget, each
+// column's repeated values stored once in a StringDictionary; rows past it are spilled in batches to a SpillFile and mapped back a batch at a time, so a
+// big result costs disk rather than RAM. Anything else commits when it succeeds, since its connection goes away with
+// the job.
+class BackgroundJob {
+public:
+    enum class State { Running, Done, Failed };
+    struct Status {
+        State state = State::Running;
+        uint64_t rows = 0;
+        double seconds = 0;
+        // Rows affected for DML, the error for a failed job.
+        std::string message;
+        // Of formatted rows, in memory and on disk.
+        uint64_t bufferedBytes = 0;
+        bool spilled = false;
+    };
+
+    // The job connects through newConnection on its own thread, so the caller doesn't wait
+    // for that either.
+    BackgroundJob(std::function<OracleConnection()> newConnection, std::string sql, size_t memoryBytes);
+    BackgroundJob(const BackgroundJob&) = delete;
+    BackgroundJob& operator=(const BackgroundJob&) = delete;
+    // Breaks a running statement and waits for the job's thread.
+    ~BackgroundJob();
+
+    const std::string& sql() const noexcept {
+        return _sql;
+    }
+    Status status() const;
+
+    // Blocks until the job has finished.
+    void wait();
+    // After wait(): the query's column names, empty if it wasn't a query.
+    const std::vector<std::string>& columnNames() const noexcept {
+        return _columnNames;
+    }
+    // After wait(): hands every buffered row to onRow in the order they were fetched. The
+    // views are only valid during the call.
+    void forEachRow(const std::function<void(const std::vector<std::string_view>&)>& onRow) const;
+
+private:
+    void _run();
+    void _appendRow(const std::vector<std::string_view>& cells);
+    void _flushSpill();
+
+    const std::function<OracleConnection()> _newConnection;
+    const std::string _sql;
+    const size_t _memoryBudget;
+    std::vector<std::string> _columnNames;
+    // Rows kept in memory, as the id of every cell's value in its column's dictionary.
+    std::vector<uint32_t> _memoryIds;
+    std::vector<StringDictionary> _memoryValues;
+    size_t _memoryBytes = 0;
+    std::unique_ptr<SpillFile> _spillFile;
+    SpillBatchBuilder _spillBatch{0};
+    std::vector<SpillFile::Extent> _spillExtents;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _finished;
+    State _state = State::Running;
+    uint64_t _rows = 0;
+    uint64_t _bufferedBytes = 0;
+    bool _spilled = false;
+    double _seconds = 0;
+    std::string _message;
+    // Set while the statement runs, so the destructor can break it.
+    std::optional<OracleConnection> _conn;
+    bool _cancelled = false;
+    std::thread _thread;
+};
+
+// The REPL's jobs, numbered from 1 in the order they were started.
+class BackgroundJobs {
+public:
+    uint32_t start(std::function<OracleConnection()> newConnection, std::string sql, size_t memoryBytes);
+
+    // Jobs by number, oldest first.
+    const std::map<uint32_t, std::unique_ptr<BackgroundJob>>& jobs() const noexcept {
+        return _jobs;
+    }
+    // Removes and returns job id, or the newest job when id is 0. Throws std::runtime_error
+    // when there's no such job.
+    std::unique_ptr<BackgroundJob> take(uint32_t id);
+    // Breaks and drops every job.
+    void clear() {
+        _jobs.clear();
+    }
+
+private:
+    std::map<uint32_t, std::unique_ptr<BackgroundJob>> _jobs;
+    uint32_t _nextId = 1;
+};
+
+} // namespace sqlplusplus
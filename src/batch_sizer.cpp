@@ -0,0 +1,51 @@
+#include "batch_sizer.h"
+
+#include <algorithm>
+
+namespace sqlplusplus {
+namespace {
+
+// Batches rejecting more than this share of their rows shrink.
+constexpr double kMaxRejectedShare = 0.01;
+// Weight of the latest batch in the running average row size.
+constexpr double kRowBytesWeight = 0.5;
+
+} // namespace
+
+BatchSizer::BatchSizer(const Options& opts) : _opts(opts) {
+    _opts.minRows = std::max<uint32_t>(_opts.minRows, 1);
+    _opts.maxRows = std::max(_opts.maxRows, _opts.minRows);
+    _rows = _clamp(_opts.initialRows);
+}
+
+uint32_t BatchSizer::_clamp(double rows) const noexcept {
+    auto limit = static_cast<double>(_opts.maxRows);
+    if (_bytesPerRow > 0) {
+        limit = std::min(limit, static_cast<double>(_opts.targetBytes) / _bytesPerRow);
+    }
+    if (_opts.commitRows != 0) {
+        limit = std::min(limit, static_cast<double>(_opts.commitRows));
+    }
+    rows = std::min(rows, limit);
+    return static_cast<uint32_t>(std::max(rows, static_cast<double>(_opts.minRows)));
+}
+
+void BatchSizer::record(uint32_t rows, uint64_t bytes, double seconds, uint64_t rowsRejected) {
+    if (rows == 0) {
+        return;
+    }
+    const auto rowBytes = static_cast<double>(bytes) / rows;
+    _bytesPerRow = _bytesPerRow == 0 ? rowBytes : _bytesPerRow + kRowBytesWeight * (rowBytes - _bytesPerRow);
+
+    auto next = static_cast<double>(_rows);
+    if (rowsRejected > rows * kMaxRejectedShare || seconds > 2 * _opts.targetSeconds) {
+        next = rows / 2.0;
+    } else if (rowsRejected == 0 && seconds < _opts.targetSeconds / 2 && rows >= _rows) {
+        // Only a batch as big as asked for says anything about a bigger one; the last one
+        // of a load is usually short.
+        next = _rows * 2.0;
+    }
+    _rows = _clamp(next);
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+namespace sqlplusplus {
+
+// Picks how many rows each executeMany of a load sends, from how the batches before it
+// went. Too few rows a batch and a load is bound by round trips; too many and each batch
+// holds on to more memory and undo, and takes longer to redo when it fails. So the size
+// doubles while batches come back well under the target latency and halves when they
+// take well over it or reject more than a few of their rows, and it's capped by a target
+// of bound bytes a batch, from the average size of the rows so far, and by the commit
+// interval, so a batch never holds more undo than a commit was asked to.
+class BatchSizer {
+public:
+    struct Options {
+        uint32_t initialRows = 1000;
+        uint32_t minRows = 16;
+        uint32_t maxRows = 100000;
+        // Bytes of bound values a batch aims for.
+        uint64_t targetBytes = 4 * 1024 * 1024;
+        // Seconds an executeMany aims to take.
+        double targetSeconds = 0.5;
+        // Rows between commits, 0 for none; batches stay within it.
+        uint64_t commitRows = 0;
+    };
+
+    explicit BatchSizer(const Options& opts);
+
+    // Rows for the next batch.
+    uint32_t rows() const noexcept {
+        return _rows;
+    }
+
+    // Records how a batch of rows, with bytes of bound values, went: how long its
+    // executeMany took and how many of its rows the server rejected.
+    void record(uint32_t rows, uint64_t bytes, double seconds, uint64_t rowsRejected);
+
+private:
+    uint32_t _clamp(double rows) const noexcept;
+
+    Options _opts;
+    uint32_t _rows;
+    double _bytesPerRow = 0;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,229 @@
+#include "bind_variables.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+#include <utility>
+
+namespace sqlplusplus {
+namespace {
+
+// The largest VARCHAR2 a SQL statement takes without extended data types.
+constexpr uint32_t kDefaultTextSize = 4000;
+
+std::string upper(std::string_view text) {
+    std::string out(text);
+    std::transform(out.begin(), out.end(), out.begin(), [](unsigned char ch) { return std::toupper(ch); });
+    return out;
+}
+
+std::string_view trim(std::string_view text) {
+    text.remove_prefix(std::min(text.find_first_not_of(" \t"), text.size()));
+    text.remove_suffix(text.size() - std::min(text.find_last_not_of(" \t") + 1, text.size()));
+    return text;
+}
+
+bool isIdentifier(std::string_view name) {
+    return !name.empty() && std::isalpha(static_cast<unsigned char>(name.front())) &&
+        std::all_of(name.begin(), name.end(), [](unsigned char ch) {
+            return std::isalnum(ch) || ch == '_' || ch == '$' || ch == '#';
+        });
+}
+
+// Placeholders come back upper-cased, or as written when they were quoted.
+std::string variableName(std::string_view name) {
+    if (name.size() >= 2 && name.front() == '"' && name.back() == '"') {
+        return std::string(name.substr(1, name.size() - 2));
+    }
+    return upper(name);
+}
+
+bool isNumber(std::string_view text) {
+    if (text.empty() || text.find_first_not_of("0123456789+-.eE") != std::string_view::npos) {
+        return false;
+    }
+    double parsed = 0;
+    auto res = std::from_chars(text.data(), text.data() + text.size(), parsed);
+    return res.ec == std::errc() && res.ptr == text.data() + text.size();
+}
+
+// A 'quoted' string with '' for a quote, null, or anything else as it's written.
+std::optional<std::string> parseLiteral(std::string_view literal) {
+    literal = trim(literal);
+    if (upper(literal) == "NULL") {
+        return std::nullopt;
+    }
+    if (literal.empty() || literal.front() != '\'') {
+        return std::string(literal);
+    }
+    std::string value;
+    for (size_t pos = 1;; ++pos) {
+        if (pos == literal.size()) {
+            throw std::runtime_error("string is missing its closing quote");
+        }
+        if (literal[pos] == '\'') {
+            if (pos + 1 < literal.size() && literal[pos + 1] == '\'') {
+                ++pos;
+            } else if (pos + 1 == literal.size()) {
+                return value;
+            } else {
+                throw std::runtime_error("unexpected text after the closing quote");
+            }
+        }
+        value.push_back(literal[pos]);
+    }
+}
+
+} // namespace
+
+void BindVariables::declare(OracleConnection& conn, std::string_view name, std::string_view type) {
+    if (!isIdentifier(name)) {
+        throw std::runtime_error(fmt::format("\"{}\" isn't a valid variable name", name));
+    }
+    std::string spec;
+    for (const auto ch : upper(type)) {
+        if (!std::isspace(static_cast<unsigned char>(ch)) || (!spec.empty() && spec.back() != ' ')) {
+            spec += std::isspace(static_cast<unsigned char>(ch)) ? ' ' : ch;
+        }
+    }
+    spec = std::string(trim(spec));
+
+    OracleConnection::VariableOpts opts;
+    opts.maxArraySize = 1;
+    opts.opts = OracleConnection::VariableOpts::ByteBufferOpts{0, true};
+    std::string typeName;
+    const auto open = spec.find('(');
+    const auto base = std::string(trim(std::string_view(spec).substr(0, open)));
+    if (base == "NUMBER" && open == std::string::npos) {
+        // As text, so values come and go at full precision.
+        opts.dbTypeNum = DPI_ORACLE_TYPE_NUMBER;
+        opts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+        typeName = base;
+    } else if (base == "BINARY_DOUBLE" && open == std::string::npos) {
+        opts.dbTypeNum = DPI_ORACLE_TYPE_NATIVE_DOUBLE;
+        opts.nativeTypeNum = DPI_NATIVE_TYPE_DOUBLE;
+        typeName = base;
+    } else if (base == "VARCHAR2" || base == "NVARCHAR2" || base == "CHAR") {
+        opts.dbTypeNum = base == "VARCHAR2" ? DPI_ORACLE_TYPE_VARCHAR :
+            base == "NVARCHAR2" ? DPI_ORACLE_TYPE_NVARCHAR : DPI_ORACLE_TYPE_CHAR;
+        opts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+        uint32_t size = kDefaultTextSize;
+        bool sizeIsBytes = true;
+        if (open != std::string::npos) {
+            const auto close = spec.find(')', open);
+            if (close == std::string::npos || close + 1 != spec.size()) {
+                throw std::runtime_error(fmt::format("can't read the size of {}", type));
+            }
+            auto inner = trim(std::string_view(spec).substr(open + 1, close - open - 1));
+            const auto space = inner.find(' ');
+            const auto semantics = space == std::string_view::npos ? std::string_view() : trim(inner.substr(space));
+            inner = inner.substr(0, space);
+            auto res = std::from_chars(inner.data(), inner.data() + inner.size(), size);
+            if (res.ec != std::errc() || res.ptr != inner.data() + inner.size() || size == 0 ||
+                (!semantics.empty() && semantics != "BYTE" && semantics != "CHAR")) {
+                throw std::runtime_error(fmt::format("can't read the size of {}", type));
+            }
+            sizeIsBytes = semantics != "CHAR";
+        }
+        opts.opts = OracleConnection::VariableOpts::ByteBufferOpts{size, sizeIsBytes};
+        typeName = fmt::format("{}({}{})", base, size, sizeIsBytes ? "" : " CHAR");
+    } else {
+        throw std::runtime_error(fmt::format(
+                "unsupported variable type \"{}\"; use NUMBER, BINARY_DOUBLE, VARCHAR2(n), NVARCHAR2(n) or CHAR(n)", type));
+    }
+
+    auto var = conn.newArrayVariable(opts);
+    _variables.insert_or_assign(upper(name), Variable{std::move(typeName), opts, conn.share(), std::move(var)});
+}
+
+void BindVariables::assign(std::string_view name, std::string_view literal) {
+    auto it = _variables.find(variableName(name));
+    if (it == _variables.end()) {
+        throw std::runtime_error(fmt::format("bind variable :{} isn't declared; declare it with .var", name));
+    }
+    auto value = parseLiteral(literal);
+    const bool numeric = it->second.opts.dbTypeNum == DPI_ORACLE_TYPE_NUMBER ||
+        it->second.opts.dbTypeNum == DPI_ORACLE_TYPE_NATIVE_DOUBLE;
+    if (value && numeric && !isNumber(*value)) {
+        throw std::runtime_error(fmt::format("\"{}\" isn't a number", *value));
+    }
+    _setValue(it->second, value);
+}
+
+size_t BindVariables::bindInto(OracleConnection& conn, OracleStatement& stmt) {
+    const auto names = stmt.bindNames();
+    std::vector<Variable*> variables;
+    variables.reserve(names.size());
+    // Every placeholder is checked before any is bound, so a typo doesn't leave the
+    // statement half bound.
+    for (const auto& name : names) {
+        auto it = _variables.find(variableName(name));
+        if (it == _variables.end()) {
+            throw std::runtime_error(fmt::format("bind variable :{} isn't declared; declare it with .var", name));
+        }
+        variables.push_back(&it->second);
+    }
+    for (size_t idx = 0; idx < names.size(); ++idx) {
+        auto& variable = *variables[idx];
+        if (!variable.conn.isSameSession(conn)) {
+            auto value = _value(variable);
+            variable.var = conn.newArrayVariable(variable.opts);
+            variable.conn = conn.share();
+            _setValue(variable, value);
+        }
+        stmt.bindByName(names[idx], variable.var);
+    }
+    return names.size();
+}
+
+std::vector<BindVariables::Declared> BindVariables::list(const std::vector<std::string>& names) const {
+    std::vector<Declared> out;
+    if (names.empty()) {
+        for (const auto& [name, variable] : _variables) {
+            out.push_back({name, variable.type, _value(variable)});
+        }
+        return out;
+    }
+    for (const auto& name : names) {
+        const auto key = variableName(name);
+        const auto& variable = _find(key);
+        out.push_back({key, variable.type, _value(variable)});
+    }
+    return out;
+}
+
+std::optional<std::string> BindVariables::_value(const Variable& variable) {
+    const auto& data = variable.var.allocatedData().front();
+    if (data.isNull()) {
+        return std::nullopt;
+    }
+    if (variable.opts.nativeTypeNum == DPI_NATIVE_TYPE_DOUBLE) {
+        return fmt::format("{}", data.as<double>());
+    }
+    return std::string(data.as<std::string_view>());
+}
+
+void BindVariables::_setValue(Variable& variable, const std::optional<std::string>& value) {
+    if (!value) {
+        variable.var.setNull(0);
+    } else if (variable.opts.nativeTypeNum == DPI_NATIVE_TYPE_DOUBLE) {
+        double parsed = 0;
+        std::from_chars(value->data(), value->data() + value->size(), parsed);
+        variable.var.setFrom(0, parsed);
+    } else {
+        variable.var.setFrom(0, std::string_view(*value));
+    }
+}
+
+const BindVariables::Variable& BindVariables::_find(const std::string& name) const {
+    auto it = _variables.find(name);
+    if (it == _variables.end()) {
+        throw std::runtime_error(fmt::format("bind variable :{} isn't declared", name));
+    }
+    return it->second;
+}
+
+} // namespace sqlplusplus
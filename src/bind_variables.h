@@ -0,0 +1,65 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+// The REPL's bind variables, declared with .var like sqlplus's VARIABLE and referenced as
+// :name in any statement typed after. Each is a one-element OracleVariable bound by name
+// into every statement that mentions it, so queries that differ only in a value share one
+// cursor on the server, and the statement cache one prepared statement, instead of each
+// being parsed from scratch. PL/SQL blocks bind them in and out, which is how .exec
+// :name := value sets them.
+class BindVariables {
+public:
+    struct Declared {
+        std::string name;
+        std::string type;
+        // Null values are nullopt.
+        std::optional<std::string> value;
+    };
+
+    // Declares name, upper-cased, as NUMBER, BINARY_DOUBLE, or VARCHAR2, NVARCHAR2 or
+    // CHAR with an optional (size [BYTE | CHAR]); text defaults to 4000 bytes. A
+    // redeclared variable starts over null. Throws std::runtime_error for a name or type
+    // it doesn't take.
+    void declare(OracleConnection& conn, std::string_view name, std::string_view type);
+    // Sets a declared variable from a number or a 'quoted' string without a round trip;
+    // null sets it null.
+    void assign(std::string_view name, std::string_view literal);
+
+    // Binds each of stmt's placeholders to the variable of that name, first recreating
+    // any variable that was made on another session with its value carried over, since a
+    // variable can only be bound on the connection it belongs to. Throws
+    // std::runtime_error naming the first placeholder that isn't declared. Returns how
+    // many were bound.
+    size_t bindInto(OracleConnection& conn, OracleStatement& stmt);
+
+    // In name order. With names, just those, throwing for one that isn't declared.
+    std::vector<Declared> list(const std::vector<std::string>& names = {}) const;
+    bool empty() const noexcept {
+        return _variables.empty();
+    }
+
+private:
+    struct Variable {
+        std::string type;
+        OracleConnection::VariableOpts opts;
+        OracleConnection conn;
+        OracleVariable var;
+    };
+
+    static std::optional<std::string> _value(const Variable& variable);
+    static void _setValue(Variable& variable, const std::optional<std::string>& value);
+    const Variable& _find(const std::string& name) const;
+
+    std::map<std::string, Variable> _variables;
+};
+
+} // namespace sqlplusplus
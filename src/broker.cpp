@@ -0,0 +1,315 @@
+#include "broker.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pwd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace sqlplusplus {
+namespace {
+
+// The first line of every request, for telling an old client from a new broker apart.
+constexpr std::string_view kProtocolLine = "sqlplusplus-broker 1\n";
+constexpr size_t kMaxHeaderBytes = 4096;
+
+sockaddr_un socketAddress(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error(fmt::format("broker socket path \"{}\" is too long", path));
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+class FdCloser {
+public:
+    explicit FdCloser(int fd) noexcept : _fd(fd) {}
+    FdCloser(const FdCloser&) = delete;
+    FdCloser& operator=(const FdCloser&) = delete;
+    ~FdCloser() {
+        if (_fd != -1) {
+            ::close(_fd);
+        }
+    }
+
+private:
+    int _fd;
+};
+
+bool sendAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const auto rc = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (rc == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(rc));
+    }
+    return true;
+}
+
+// Appends up to want more bytes to out; false once the other end has gone.
+bool receiveSome(int fd, std::string& out, size_t want) {
+    char buffer[64 * 1024];
+    for (;;) {
+        const auto rc = ::recv(fd, buffer, std::min(want, sizeof(buffer)), 0);
+        if (rc > 0) {
+            out.append(buffer, static_cast<size_t>(rc));
+            return true;
+        }
+        if (rc == 0 || errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+// Parses "<protocol line><format>\n<script bytes>\n" from the start of request, leaving
+// request holding whatever of the script came with it.
+bool parseHeader(std::string& request, std::string& format, size_t& scriptBytes) {
+    if (request.compare(0, kProtocolLine.size(), kProtocolLine) != 0) {
+        return false;
+    }
+    const auto formatEnd = request.find('\n', kProtocolLine.size());
+    const auto lengthEnd = formatEnd == std::string::npos ? formatEnd : request.find('\n', formatEnd + 1);
+    if (lengthEnd == std::string::npos) {
+        return false;
+    }
+    format = request.substr(kProtocolLine.size(), formatEnd - kProtocolLine.size());
+    const auto length = request.substr(formatEnd + 1, lengthEnd - formatEnd - 1);
+    char* end = nullptr;
+    errno = 0;
+    scriptBytes = std::strtoull(length.c_str(), &end, 10);
+    if (length.empty() || *end != '\0' || errno == ERANGE) {
+        return false;
+    }
+    request.erase(0, lengthEnd + 1);
+    return true;
+}
+
+} // namespace
+
+BrokerServer::BrokerServer(std::string path, BrokerRunFn run, bool shared) :
+    _path(std::move(path)),
+    _runScript(std::move(run)),
+    _shared(shared)
+{
+    const auto address = socketAddress(_path);
+    // A socket that's there but that nothing accepts on is a broker that's gone.
+    {
+        const int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        FdCloser closer(probe);
+        if (probe != -1 &&
+                ::connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+            throw std::runtime_error(fmt::format("a broker is already listening at {}", _path));
+        }
+        struct stat info{};
+        if (::lstat(_path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+            ::unlink(_path.c_str());
+        }
+    }
+    _listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (_listenFd == -1) {
+        throw std::system_error(errno, std::generic_category(), "error creating the broker socket");
+    }
+    // Created without access for anyone else, rather than narrowed after it's there; a
+    // shared broker's is open to everyone, who connecting to it takes write access for.
+    const auto oldMask = ::umask(_shared ? 0 : 0077);
+    const int bindRc = ::bind(_listenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+    const int bindErr = errno;
+    ::umask(oldMask);
+    if (bindRc == -1 || ::listen(_listenFd, 64) == -1) {
+        const int err = bindRc == -1 ? bindErr : errno;
+        ::close(_listenFd);
+        throw std::system_error(err, std::generic_category(), fmt::format("error listening at {}", _path));
+    }
+    if (::pipe2(_wakeFds, O_CLOEXEC) == -1) {
+        const int err = errno;
+        ::close(_listenFd);
+        ::unlink(_path.c_str());
+        throw std::system_error(err, std::generic_category(), "error creating pipe");
+    }
+    _thread = std::thread([this] { _run(); });
+}
+
+BrokerServer::~BrokerServer() {
+    while (::write(_wakeFds[1], "x", 1) == -1 && errno == EINTR) {
+    }
+    _thread.join();
+    ::close(_listenFd);
+    ::unlink(_path.c_str());
+    std::list<Client> clients;
+    {
+        std::lock_guard<std::mutex> lk(_clientsMutex);
+        clients.swap(_clients);
+    }
+    for (auto& client : clients) {
+        client.thread.join();
+    }
+    ::close(_wakeFds[0]);
+    ::close(_wakeFds[1]);
+}
+
+void BrokerServer::_run() {
+    for (;;) {
+        pollfd fds[2] = {{_listenFd, POLLIN, 0}, {_wakeFds[0], POLLIN, 0}};
+        if (::poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (fds[1].revents != 0) {
+            return;
+        }
+        const int fd = ::accept4(_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd == -1) {
+            continue;
+        }
+        ucred peer{};
+        socklen_t peerSize = sizeof(peer);
+        if (::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &peerSize) != 0 || (!_shared && peer.uid != ::getuid())) {
+            ::close(fd);
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lk(_clientsMutex);
+        for (auto it = _clients.begin(); it != _clients.end();) {
+            if (it->done) {
+                it->thread.join();
+                it = _clients.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        auto& client = _clients.emplace_back();
+        client.thread = std::thread([this, fd, uid = peer.uid, &client] {
+            _serve(fd, uid);
+            ::close(fd);
+            std::lock_guard<std::mutex> doneLk(_clientsMutex);
+            client.done = true;
+        });
+    }
+}
+
+void BrokerServer::_serve(int fd, uid_t uid) {
+    // The client's stdout and stderr come with the first bytes of the request.
+    std::string request(kMaxHeaderBytes, '\0');
+    iovec iov{request.data(), request.size()};
+    alignas(cmsghdr) char control[CMSG_SPACE(2 * sizeof(int))];
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    ssize_t received = 0;
+    do {
+        received = ::recvmsg(fd, &message, MSG_CMSG_CLOEXEC);
+    } while (received == -1 && errno == EINTR);
+    if (received <= 0) {
+        return;
+    }
+    request.resize(static_cast<size_t>(received));
+    int outFd = -1;
+    int errFd = -1;
+    if (auto* cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr && cmsg->cmsg_level == SOL_SOCKET &&
+            cmsg->cmsg_type == SCM_RIGHTS && cmsg->cmsg_len == CMSG_LEN(2 * sizeof(int))) {
+        int fds[2];
+        std::memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+        outFd = fds[0];
+        errFd = fds[1];
+    }
+    FdCloser outCloser(outFd);
+    FdCloser errCloser(errFd);
+    if (outFd == -1) {
+        return;
+    }
+
+    std::string format;
+    size_t scriptBytes = 0;
+    while (!parseHeader(request, format, scriptBytes)) {
+        if (request.size() >= kMaxHeaderBytes || !receiveSome(fd, request, kMaxHeaderBytes - request.size())) {
+            return;
+        }
+    }
+    while (request.size() < scriptBytes) {
+        if (!receiveSome(fd, request, scriptBytes - request.size())) {
+            return;
+        }
+    }
+    request.resize(scriptBytes);
+
+    BrokerClient client;
+    client.uid = uid;
+    passwd entry{};
+    passwd* found = nullptr;
+    std::string buffer(16384, '\0');
+    if (::getpwuid_r(uid, &entry, buffer.data(), buffer.size(), &found) == 0 && found != nullptr) {
+        client.userName = found->pw_name;
+    }
+
+    const int32_t exitCode = _runScript(client, request, format, outFd, errFd);
+    sendAll(fd, std::string_view(reinterpret_cast<const char*>(&exitCode), sizeof(exitCode)));
+}
+
+int attachToBroker(const std::string& path, std::string_view format, std::string_view script) {
+    const auto address = socketAddress(path);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        throw std::system_error(errno, std::generic_category(), "error creating socket");
+    }
+    FdCloser closer(fd);
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1) {
+        throw std::system_error(errno, std::generic_category(), fmt::format("no broker at {}", path));
+    }
+
+    auto header = fmt::format("{}{}\n{}\n", kProtocolLine, format, script.size());
+    iovec iov{header.data(), header.size()};
+    alignas(cmsghdr) char control[CMSG_SPACE(2 * sizeof(int))] = {};
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    auto* cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(2 * sizeof(int));
+    const int fds[2] = {STDOUT_FILENO, STDERR_FILENO};
+    std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    ssize_t sent = 0;
+    do {
+        sent = ::sendmsg(fd, &message, MSG_NOSIGNAL);
+    } while (sent == -1 && errno == EINTR);
+    if (sent == -1 || !sendAll(fd, std::string_view(header).substr(static_cast<size_t>(sent))) ||
+            !sendAll(fd, script)) {
+        throw std::system_error(errno, std::generic_category(), "error sending the script to the broker");
+    }
+
+    std::string reply;
+    while (reply.size() < sizeof(int32_t)) {
+        if (!receiveSome(fd, reply, sizeof(int32_t) - reply.size())) {
+            throw std::runtime_error("the broker went away before the script finished");
+        }
+    }
+    int32_t exitCode = 0;
+    std::memcpy(&exitCode, reply.data(), sizeof(exitCode));
+    return exitCode;
+}
+
+} // namespace sqlplusplus
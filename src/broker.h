@@ -0,0 +1,75 @@
+#pragma once
+
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <sys/types.h>
+
+namespace sqlplusplus {
+
+// A long-running sqlplusplus that scripts attach to over a Unix socket, so a cron job that
+// runs a statement or two doesn't pay for loading the client libraries, logging in and
+// warming caches every time. The attaching process sends its stdout and stderr along with
+// the script, and the broker writes the results straight to them, so output goes where the
+// caller redirected it without passing back through the socket; all that comes back is the
+// script's exit code.
+//
+// By default the socket is only accessible to its owner, and only processes of the broker's
+// own user are served, since it runs them with the broker's credentials. A shared broker,
+// e.g. on a jump host, serves every local user, and it's up to the run function to run
+// each one's scripts with credentials of their own.
+
+// Who attached, as the kernel vouches for it rather than as the client says.
+struct BrokerClient {
+    uid_t uid = 0;
+    // The login name uid maps to, empty if it has none.
+    std::string userName;
+};
+
+// What the broker runs a script with: who sent it, the script's text, the output format the
+// caller asked for, and its stdout and stderr. Returns the exit code. Called on a thread of
+// the client's own, so it has to be safe to run for several clients at once.
+using BrokerRunFn = std::function<int(const BrokerClient& client, std::string_view script, std::string_view format,
+                                      int outFd, int errFd)>;
+
+// Listens at path and hands each client that attaches to run, on a thread of its own; with
+// shared, clients of any user. Throws std::runtime_error if something is already listening
+// there; a socket left by a broker that has gone is replaced.
+class BrokerServer {
+public:
+    BrokerServer(std::string path, BrokerRunFn run, bool shared = false);
+    BrokerServer(const BrokerServer&) = delete;
+    BrokerServer& operator=(const BrokerServer&) = delete;
+    // Stops listening, removes the socket and waits for the clients being served.
+    ~BrokerServer();
+
+private:
+    void _run();
+    void _serve(int fd, uid_t uid);
+
+    std::string _path;
+    BrokerRunFn _runScript;
+    bool _shared;
+    int _listenFd = -1;
+    // Written to on destruction to wake the thread out of poll().
+    int _wakeFds[2] = {-1, -1};
+    std::thread _thread;
+
+    struct Client {
+        std::thread thread;
+        bool done = false;
+    };
+    // Finished clients' threads are joined as the next one attaches.
+    std::mutex _clientsMutex;
+    std::list<Client> _clients;
+};
+
+// Runs script on the broker listening at path with this process's stdout and stderr, and
+// returns its exit code. Throws std::system_error if there's no broker there.
+int attachToBroker(const std::string& path, std::string_view format, std::string_view script);
+
+} // namespace sqlplusplus
@@ -0,0 +1,191 @@
+#include "buffered_writer.h"
+
+#include "compressed_output.h"
+#include "uring_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sqlplusplus {
+
+BufferedFdWriter BufferedFdWriter::open(const std::string& path, const OutputCompression& compression,
+                                         const FileWriteOptions& fileWrite) {
+    const bool uring = !compression.enabled() && (fileWrite.queueDepth > 0 || fileWrite.direct);
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    int fd = -1;
+    bool direct = false;
+    if (uring && fileWrite.direct) {
+        fd = ::open(path.c_str(), flags | O_DIRECT, 0666);
+        direct = fd != -1;
+    }
+    // Not every filesystem takes O_DIRECT, e.g. tmpfs, so it's only asked for.
+    if (fd == -1) {
+        fd = ::open(path.c_str(), flags, 0666);
+    }
+    if (fd == -1) {
+        throw std::system_error(errno, std::generic_category(), "error opening " + path);
+    }
+    BufferedFdWriter out(fd, true);
+    if (compression.enabled()) {
+        out._gzip = std::make_unique<GzipPipeline>(fd, compression);
+    } else if (uring) {
+        out._uring = std::make_unique<UringFileWriter>(fd, fileWrite.queueDepth, direct);
+        auto buffer = UringFileWriter::allocate(kBufferSize);
+        out._buffer = std::move(buffer.storage);
+        out._data = buffer.data;
+    }
+    return out;
+}
+
+BufferedFdWriter::BufferedFdWriter(int fd, bool ownsFd) :
+    _fd(fd),
+    _ownsFd(ownsFd),
+    _buffer(std::make_unique<char[]>(kBufferSize)),
+    _data(_buffer.get()),
+    _capacity(kBufferSize)
+{}
+
+BufferedFdWriter::BufferedFdWriter(BufferedFdWriter&& other) noexcept :
+    _fd(std::exchange(other._fd, -1)),
+    _ownsFd(std::exchange(other._ownsFd, false)),
+    _buffer(std::move(other._buffer)),
+    _data(std::exchange(other._data, nullptr)),
+    _capacity(std::exchange(other._capacity, 0)),
+    _used(std::exchange(other._used, 0)),
+    _gzip(std::move(other._gzip)),
+    _uring(std::move(other._uring))
+{}
+
+BufferedFdWriter& BufferedFdWriter::operator=(BufferedFdWriter&& other) noexcept {
+    _close();
+    _fd = std::exchange(other._fd, -1);
+    _ownsFd = std::exchange(other._ownsFd, false);
+    _buffer = std::move(other._buffer);
+    _data = std::exchange(other._data, nullptr);
+    _capacity = std::exchange(other._capacity, 0);
+    _used = std::exchange(other._used, 0);
+    _gzip = std::move(other._gzip);
+    _uring = std::move(other._uring);
+    return *this;
+}
+
+BufferedFdWriter::~BufferedFdWriter() {
+    _close();
+}
+
+void BufferedFdWriter::_close() noexcept {
+    if (_fd == -1) {
+        return;
+    }
+    try {
+        flush();
+    } catch(const std::exception&) {
+        // Nowhere to report it from a destructor; callers that care flush() first.
+    }
+    // The pipeline's threads, and the ring's writes, have to be done with the fd before
+    // it's closed.
+    _gzip.reset();
+    _uring.reset();
+    if (_ownsFd) {
+        ::close(_fd);
+    }
+    _fd = -1;
+}
+
+void BufferedFdWriter::flush() {
+    _emit();
+    if (_gzip) {
+        _gzip->finish();
+    }
+    if (_uring) {
+        _uring->finish();
+    }
+}
+
+void BufferedFdWriter::_emit() {
+    if (_gzip) {
+        if (_used > 0) {
+            auto next = _gzip->submit({std::move(_buffer), _capacity}, _used, kBufferSize);
+            _buffer = std::move(next.data);
+            _data = _buffer.get();
+            _capacity = next.capacity;
+            _used = 0;
+        }
+        return;
+    }
+    if (_uring) {
+        if (_used > 0) {
+            UringFileWriter::Buffer next;
+            try {
+                next = _uring->submit({std::move(_buffer), _data, _capacity, _used}, kBufferSize);
+            } catch(...) {
+                // The buffer went with the write that failed; what's appended next needs one.
+                next = UringFileWriter::allocate(kBufferSize);
+                _used = 0;
+                _buffer = std::move(next.storage);
+                _data = next.data;
+                _capacity = next.capacity;
+                throw;
+            }
+            _buffer = std::move(next.storage);
+            _data = next.data;
+            _capacity = next.capacity;
+            // Whatever of it O_DIRECT couldn't take yet.
+            _used = next.size;
+        }
+        return;
+    }
+    size_t written = 0;
+    while (written < _used) {
+        auto rc = ::write(_fd, _data + written, _used - written);
+        if (rc == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "error writing output");
+        }
+        written += static_cast<size_t>(rc);
+    }
+    _used = 0;
+}
+
+void BufferedFdWriter::append(std::string_view data) {
+    while (!data.empty()) {
+        if (_used == _capacity) {
+            _emit();
+        }
+        auto chunk = std::min(data.size(), _capacity - _used);
+        std::memcpy(_data + _used, data.data(), chunk);
+        _used += chunk;
+        data.remove_prefix(chunk);
+    }
+}
+
+char* BufferedFdWriter::reserve(size_t size) {
+    if (_capacity - _used < size) {
+        _emit();
+        // Whatever _emit() had to leave in the buffer comes along into the bigger one.
+        if (_capacity - _used < size) {
+            if (_uring) {
+                auto grown = UringFileWriter::allocate(_used + size);
+                std::memcpy(grown.data, _data, _used);
+                _buffer = std::move(grown.storage);
+                _data = grown.data;
+                _capacity = grown.capacity;
+            } else {
+                _buffer = std::make_unique<char[]>(size);
+                _data = _buffer.get();
+                _capacity = size;
+            }
+        }
+    }
+    return _data + _used;
+}
+
+} // namespace sqlplusplus
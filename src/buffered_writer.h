@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace sqlplusplus {
+
+class GzipPipeline;
+class UringFileWriter;
+
+struct OutputCompression {
+    // 0 writes the output as is; 1 to 9 gzip it at that zlib level.
+    int level = 0;
+    // Buffers compressed at once.
+    uint32_t threads = 1;
+
+    bool enabled() const noexcept {
+        return level > 0;
+    }
+};
+
+struct FileWriteOptions {
+    // Buffers written at once through io_uring; 0 writes each with write(2) as it fills.
+    uint32_t queueDepth = 0;
+    // Opens the file with O_DIRECT, so an export doesn't push everything else out of the
+    // page cache, where the filesystem allows it. It implies a queueDepth of at least 1.
+    bool direct = false;
+};
+
+// Output to a file descriptor through one large buffer that's handed to write(2) in big
+// chunks, so exports cost a syscall per megabyte rather than per row. Throws
+// std::system_error if a write fails.
+//
+// With compression each full buffer goes to a GzipPipeline instead, and writing carries on
+// into a fresh one while it's compressed and written in the background. Without it, a
+// file opened with a queueDepth hands its full buffers to a UringFileWriter the same way.
+class BufferedFdWriter {
+public:
+    static constexpr size_t kBufferSize = 1024 * 1024;
+
+    // Creates or truncates path. fileWrite only applies without compression.
+    static BufferedFdWriter open(const std::string& path, const OutputCompression& compression = {},
+                                 const FileWriteOptions& fileWrite = {});
+    // Writes to an fd the caller keeps ownership of, e.g. stdout.
+    explicit BufferedFdWriter(int fd) : BufferedFdWriter(fd, false) {}
+
+    BufferedFdWriter(const BufferedFdWriter&) = delete;
+    BufferedFdWriter& operator=(const BufferedFdWriter&) = delete;
+    BufferedFdWriter(BufferedFdWriter&& other) noexcept;
+    BufferedFdWriter& operator=(BufferedFdWriter&& other) noexcept;
+    ~BufferedFdWriter();
+
+    void append(std::string_view data);
+    void append(char ch) {
+        if (_used == _capacity) {
+            _emit();
+        }
+        _data[_used++] = ch;
+    }
+
+    // Returns room for at least size contiguous bytes; commit() then takes the end of what
+    // was written there. The buffer grows for values bigger than it.
+    char* reserve(size_t size);
+    void commit(char* end) noexcept {
+        _used = static_cast<size_t>(end - _data);
+    }
+
+    // Writes out everything appended so far, waiting for it to be compressed and written
+    // when there's compression.
+    void flush();
+
+private:
+    BufferedFdWriter(int fd, bool ownsFd);
+
+    // Hands the buffer off to be written, without waiting for compression to catch up.
+    void _emit();
+    void _close() noexcept;
+
+    int _fd = -1;
+    bool _ownsFd = false;
+    std::unique_ptr<char[]> _buffer;
+    // Where in _buffer writing starts, which is aligned for O_DIRECT with _uring.
+    char* _data = nullptr;
+    size_t _capacity = 0;
+    size_t _used = 0;
+    std::unique_ptr<GzipPipeline> _gzip;
+    std::unique_ptr<UringFileWriter> _uring;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,214 @@
+#include "bulk_dml.h"
+
+#include "arena.h"
+#include "mapped_file.h"
+#include "session_executor.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <array>
+#include <future>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+namespace sqlplusplus {
+namespace {
+
+// Longest key bound, as for CSV loads.
+constexpr uint32_t kMaxKeySize = 32767;
+constexpr uint32_t kMinKeySize = 64;
+
+struct KeyBatch {
+    std::vector<std::optional<OracleVariable>> vars;
+    std::vector<uint32_t> keySizes;
+    std::vector<uint64_t> lines;
+    uint32_t numKeys = 0;
+};
+
+struct KeyBatchOutcome {
+    uint64_t rowsAffected = 0;
+    uint64_t keysUnmatched = 0;
+    std::vector<CsvLoadError> errors;
+};
+
+// "... WHERE k1 = :1 AND k2 = :2".
+std::string keyPredicate(const std::vector<std::string>& keyColumns) {
+    fmt::memory_buffer sql;
+    fmt::format_to(sql, " WHERE ");
+    for (size_t idx = 0; idx < keyColumns.size(); ++idx) {
+        fmt::format_to(sql, "{}{} = :{}", idx == 0 ? "" : " AND ",
+                normalizeIdentifier(keyColumns[idx], false), idx + 1);
+    }
+    return std::string(sql.data(), sql.size());
+}
+
+KeyDmlResult runByKeys(OracleConnection& conn,
+                       const std::string& path,
+                       const std::string& sql,
+                       uint32_t numKeyColumns,
+                       const KeyDmlOptions& opts) {
+    if (numKeyColumns == 0) {
+        throw std::runtime_error("at least one key column is needed");
+    }
+    const auto batchSize = std::max<uint32_t>(opts.batchSize, 1);
+    MappedFile file(path);
+    file.adviseSequential();
+    CsvReader reader(file.contents());
+    auto stmt = conn.prepareStatement(sql);
+
+    KeyDmlResult result;
+    uint64_t keysSinceCommit = 0;
+    // Runs on the executor; one batch at a time, so the statement is never shared.
+    auto runBatch = [&](KeyBatch& batch) {
+        for (uint32_t col = 0; col < numKeyColumns; ++col) {
+            stmt.bindByPos(col + 1, *batch.vars[col]);
+        }
+        stmt.executeMany(batch.numKeys, static_cast<dpiExecMode>(
+            DPI_MODE_EXEC_BATCH_ERRORS | DPI_MODE_EXEC_ARRAY_DML_ROWCOUNTS));
+        KeyBatchOutcome outcome;
+        for (auto count : stmt.rowCounts()) {
+            outcome.rowsAffected += count;
+            outcome.keysUnmatched += count == 0;
+        }
+        for (auto& error : stmt.batchErrors()) {
+            outcome.errors.push_back(CsvLoadError{batch.lines.at(error.offset), std::move(error.message)});
+        }
+        // Rejected keys have a row count of 0 too; they're counted as rejected instead.
+        outcome.keysUnmatched -= std::min<uint64_t>(outcome.keysUnmatched, outcome.errors.size());
+        keysSinceCommit += batch.numKeys;
+        if (opts.commitInterval != 0 && keysSinceCommit >= opts.commitInterval) {
+            conn.commit();
+            keysSinceCommit = 0;
+        }
+        return outcome;
+    };
+    auto collect = [&](std::future<KeyBatchOutcome>& inFlight) {
+        auto outcome = inFlight.get();
+        result.rowsAffected += outcome.rowsAffected;
+        result.keysUnmatched += outcome.keysUnmatched;
+        result.keysRejected += outcome.errors.size();
+        for (auto& error : outcome.errors) {
+            if (result.errors.size() < opts.maxReportedErrors) {
+                result.errors.push_back(std::move(error));
+            }
+        }
+    };
+
+    std::array<KeyBatch, 2> batches;
+    for (auto& batch : batches) {
+        batch.vars.resize(numKeyColumns);
+        batch.keySizes.resize(numKeyColumns, 0);
+    }
+    StringArena scratch;
+    std::vector<std::string_view> fields;
+    std::vector<std::string_view> keys;
+    keys.reserve(static_cast<size_t>(batchSize) * numKeyColumns);
+    std::array<std::future<KeyBatchOutcome>, 2> inFlight;
+    size_t current = 0;
+    // Declared after everything its tasks touch, so it's done with them before they go.
+    SessionExecutor executor;
+    try {
+        bool moreInput = true;
+        while (moreInput) {
+            auto& batch = batches[current];
+            // The batch that last used this set has to be done with it first.
+            if (inFlight[current].valid()) {
+                collect(inFlight[current]);
+            }
+            batch.numKeys = 0;
+            batch.lines.clear();
+            keys.clear();
+            scratch.reset();
+            while (batch.numKeys < batchSize) {
+                if (!reader.nextRecord(fields, scratch)) {
+                    moreInput = false;
+                    break;
+                }
+                if (fields.size() != numKeyColumns) {
+                    throw std::runtime_error(fmt::format("line {} of {} has {} fields, expected {}",
+                            reader.recordLine(), path, fields.size(), numKeyColumns));
+                }
+                keys.insert(keys.end(), fields.begin(), fields.end());
+                batch.lines.push_back(reader.recordLine());
+                ++batch.numKeys;
+            }
+            if (batch.numKeys == 0) {
+                break;
+            }
+            result.keysRead += batch.numKeys;
+
+            for (uint32_t col = 0; col < numKeyColumns; ++col) {
+                size_t longest = 0;
+                for (uint32_t row = 0; row < batch.numKeys; ++row) {
+                    longest = std::max(longest, keys[row * numKeyColumns + col].size());
+                }
+                if (longest > kMaxKeySize) {
+                    throw std::runtime_error(fmt::format(
+                            "a key in column {} is longer than {} bytes", col + 1, kMaxKeySize));
+                }
+                auto& var = batch.vars[col];
+                if (!var || longest > batch.keySizes[col]) {
+                    auto size = std::max(batch.keySizes[col], kMinKeySize);
+                    while (size < longest) {
+                        size = std::min(size * 2, kMaxKeySize);
+                    }
+                    OracleConnection::VariableOpts varopts;
+                    varopts.dbTypeNum = DPI_ORACLE_TYPE_VARCHAR;
+                    varopts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+                    varopts.opts = OracleConnection::VariableOpts::ByteBufferOpts{size, true};
+                    varopts.maxArraySize = batchSize;
+                    var = conn.newArrayVariable(varopts);
+                    batch.keySizes[col] = size;
+                }
+                for (uint32_t row = 0; row < batch.numKeys; ++row) {
+                    var->setFrom(row, keys[row * numKeyColumns + col]);
+                }
+            }
+            inFlight[current] = executor.submit([&runBatch, &batch] { return runBatch(batch); });
+            current ^= 1;
+        }
+        for (auto& pending : inFlight) {
+            if (pending.valid()) {
+                collect(pending);
+            }
+        }
+    } catch (...) {
+        for (auto& pending : inFlight) {
+            if (pending.valid()) {
+                pending.wait();
+            }
+        }
+        throw;
+    }
+    conn.commit();
+    return result;
+}
+
+} // namespace
+
+KeyDmlResult deleteByKeys(OracleConnection& conn,
+                          const std::string& path,
+                          std::string_view tableName,
+                          const std::vector<std::string>& keyColumns,
+                          const KeyDmlOptions& opts) {
+    const auto sql = fmt::format("DELETE FROM {}{}", normalizeIdentifier(tableName, true), keyPredicate(keyColumns));
+    return runByKeys(conn, path, sql, static_cast<uint32_t>(keyColumns.size()), opts);
+}
+
+KeyDmlResult updateByKeys(OracleConnection& conn,
+                          const std::string& path,
+                          std::string_view tableName,
+                          std::string_view setClause,
+                          const std::vector<std::string>& keyColumns,
+                          const KeyDmlOptions& opts) {
+    if (setClause.empty()) {
+        throw std::runtime_error("an update needs a SET clause");
+    }
+    const auto sql = fmt::format("UPDATE {} SET {}{}", normalizeIdentifier(tableName, true), setClause,
+            keyPredicate(keyColumns));
+    return runByKeys(conn, path, sql, static_cast<uint32_t>(keyColumns.size()), opts);
+}
+
+} // namespace sqlplusplus
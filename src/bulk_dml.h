@@ -0,0 +1,55 @@
+#pragma once
+
+#include "csv_load.h"
+#include "oracle_helpers.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+struct KeyDmlOptions {
+    // Keys bound per executeMany round trip.
+    uint32_t batchSize = 1000;
+    // Commit after at least this many keys; 0 commits once at the end.
+    uint64_t commitInterval = 0;
+    // Rejected keys beyond this many are counted but not kept in the result.
+    size_t maxReportedErrors = 20;
+};
+
+struct KeyDmlResult {
+    uint64_t keysRead = 0;
+    // Rows the statement deleted or updated, over all the keys.
+    uint64_t rowsAffected = 0;
+    // Keys that matched no row.
+    uint64_t keysUnmatched = 0;
+    uint64_t keysRejected = 0;
+    std::vector<CsvLoadError> errors;
+};
+
+// Deletes the rows of tableName whose keyColumns equal each key in a key file: a line per
+// key, with a field per key column in CSV, and no header. Keys are bound as text in
+// arrays, a batch per executeMany, and the server converts them to the columns' types.
+// While a batch runs on a SessionExecutor the next is read into a second set of arrays.
+// Keys the server rejects, like ones that don't convert or a delete a constraint stops,
+// are reported with their lines instead of stopping the run. Anything else throws; what
+// the commit interval committed stays committed.
+KeyDmlResult deleteByKeys(OracleConnection& conn,
+                          const std::string& path,
+                          std::string_view tableName,
+                          const std::vector<std::string>& keyColumns,
+                          const KeyDmlOptions& opts);
+
+// Runs UPDATE tableName SET setClause for the rows matching each key of a key file, as
+// deleteByKeys() does. setClause is SQL, like "status = 'PURGED'", and can't have binds
+// of its own, since the keys are bound by position.
+KeyDmlResult updateByKeys(OracleConnection& conn,
+                          const std::string& path,
+                          std::string_view tableName,
+                          std::string_view setClause,
+                          const std::vector<std::string>& keyColumns,
+                          const KeyDmlOptions& opts);
+
+} // namespace sqlplusplus
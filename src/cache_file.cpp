@@ -0,0 +1,25 @@
+#include "cache_file.h"
+
+#include "fmt/format.h"
+
+#include <fstream>
+
+#include <unistd.h>
+
+namespace sqlplusplus {
+
+void replaceCacheFile(const std::filesystem::path& path, std::string_view data) {
+    std::filesystem::create_directories(path.parent_path());
+    auto tmpPath = path;
+    tmpPath += fmt::format(".tmp{}", ::getpid());
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!out) {
+            throw std::runtime_error(fmt::format("error writing cache file {}", tmpPath.string()));
+        }
+    }
+    std::filesystem::rename(tmpPath, path);
+}
+
+} // namespace sqlplusplus
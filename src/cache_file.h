@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace sqlplusplus {
+
+// What tsl::htrie_set's and htrie_map's serialize() and deserialize() take, for the caches
+// that are written to disk and memory-mapped back in. Values are copied as their bytes, so
+// a cache is only read back on the kind of machine that wrote it.
+class CacheSerializer {
+public:
+    template <typename U>
+    void operator()(const U& value) {
+        _out.append(reinterpret_cast<const char*>(&value), sizeof(U));
+    }
+
+    void operator()(const char* value, std::size_t valueSize) {
+        _out.append(value, valueSize);
+    }
+
+    const std::string& data() const noexcept {
+        return _out;
+    }
+
+private:
+    std::string _out;
+};
+
+// Reads from a view into a mapped cache file. Throws std::runtime_error if it runs past
+// the end.
+class CacheDeserializer {
+public:
+    explicit CacheDeserializer(std::string_view in) : _in(in) {}
+
+    template <typename U>
+    U operator()() {
+        U value;
+        _read(reinterpret_cast<char*>(&value), sizeof(U));
+        return value;
+    }
+
+    void operator()(char* valueOut, std::size_t valueSize) {
+        _read(valueOut, valueSize);
+    }
+
+    std::string_view remaining() const noexcept {
+        return _in;
+    }
+
+private:
+    void _read(char* out, size_t size) {
+        if (size > _in.size()) {
+            throw std::runtime_error("cache file is truncated");
+        }
+        std::memcpy(out, _in.data(), size);
+        _in.remove_prefix(size);
+    }
+
+    std::string_view _in;
+};
+
+// Writes data to a file next to path and renames it over path, creating its directory if
+// need be, so a process mapping path sees either the old file or the new one, whole, without
+// taking a lock. Throws on I/O errors.
+void replaceCacheFile(const std::filesystem::path& path, std::string_view data);
+
+} // namespace sqlplusplus
@@ -0,0 +1,138 @@
+#include "change_events.h"
+
+#include "json_text.h"
+
+#include <string_view>
+#include <utility>
+
+namespace sqlplusplus {
+namespace {
+
+std::string_view eventName(dpiEventType type) noexcept {
+    switch (type) {
+    case DPI_EVENT_STARTUP:
+        return "startup";
+    case DPI_EVENT_SHUTDOWN:
+        return "shutdown";
+    case DPI_EVENT_SHUTDOWN_ANY:
+        return "shutdown_any";
+    case DPI_EVENT_DEREG:
+        return "dereg";
+    case DPI_EVENT_OBJCHANGE:
+        return "objchange";
+    case DPI_EVENT_QUERYCHANGE:
+        return "querychange";
+    case DPI_EVENT_AQ:
+        return "aq";
+    default:
+        return "unknown";
+    }
+}
+
+void appendString(std::string& out, std::string_view value) {
+    const auto start = out.size();
+    out.resize(start + jsonStringSizeBound(value.size()));
+    const auto end = writeJsonString(value, out.data() + start);
+    out.resize(static_cast<size_t>(end - out.data()));
+}
+
+void appendOperations(std::string& out, dpiOpCode operation) {
+    constexpr std::pair<dpiOpCode, std::string_view> kOperations[] = {
+        {DPI_OPCODE_INSERT, "insert"}, {DPI_OPCODE_UPDATE, "update"}, {DPI_OPCODE_DELETE, "delete"},
+        {DPI_OPCODE_ALTER, "alter"}, {DPI_OPCODE_DROP, "drop"}, {DPI_OPCODE_UNKNOWN, "unknown"},
+    };
+    out.append("\"operations\":[");
+    bool first = true;
+    // ALL_ROWS means the rows weren't listed, e.g. because there were too many.
+    if (operation & DPI_OPCODE_ALL_ROWS) {
+        out.append("\"all_rows\"");
+        first = false;
+    }
+    for (const auto& [code, name] : kOperations) {
+        if (operation & code) {
+            if (!first) {
+                out.push_back(',');
+            }
+            out.push_back('"');
+            out.append(name);
+            out.push_back('"');
+            first = false;
+        }
+    }
+    out.push_back(']');
+}
+
+void appendTables(std::string& out, const dpiSubscrMessageTable* tables, uint32_t numTables) {
+    out.append("\"tables\":[");
+    for (uint32_t idx = 0; idx < numTables; ++idx) {
+        const auto& table = tables[idx];
+        out.append(idx == 0 ? "{\"table\":" : ",{\"table\":");
+        appendString(out, std::string_view(table.name, table.nameLength));
+        out.push_back(',');
+        appendOperations(out, table.operation);
+        if (table.numRows > 0) {
+            out.append(",\"rows\":[");
+            for (uint32_t row = 0; row < table.numRows; ++row) {
+                out.append(row == 0 ? "{\"rowid\":" : ",{\"rowid\":");
+                appendString(out, std::string_view(table.rows[row].rowid, table.rows[row].rowidLength));
+                out.push_back(',');
+                appendOperations(out, table.rows[row].operation);
+                out.push_back('}');
+            }
+            out.push_back(']');
+        }
+        out.push_back('}');
+    }
+    out.push_back(']');
+}
+
+} // namespace
+
+void appendChangeEventJson(const dpiSubscrMessage& message, std::string& out) {
+    out.append("{\"event\":\"");
+    out.append(eventName(message.eventType));
+    out.append("\",\"database\":");
+    appendString(out, std::string_view(message.dbName, message.dbNameLength));
+    if (message.errorInfo != nullptr) {
+        out.append(",\"error\":");
+        appendString(out, std::string_view(message.errorInfo->message, message.errorInfo->messageLength));
+    }
+    if (message.eventType == DPI_EVENT_OBJCHANGE) {
+        out.push_back(',');
+        appendTables(out, message.tables, message.numTables);
+    } else if (message.eventType == DPI_EVENT_QUERYCHANGE) {
+        out.append(",\"queries\":[");
+        for (uint32_t idx = 0; idx < message.numQueries; ++idx) {
+            const auto& query = message.queries[idx];
+            out.append(idx == 0 ? "{\"id\":" : ",{\"id\":");
+            out.append(std::to_string(query.id));
+            out.push_back(',');
+            appendTables(out, query.tables, query.numTables);
+            out.push_back('}');
+        }
+        out.push_back(']');
+    }
+    out.append("}\n");
+}
+
+void ChangeEventQueue::push(const dpiSubscrMessage& message) {
+    // Formatted before taking the lock, so the reader is held up for a copy at most.
+    std::string line;
+    appendChangeEventJson(message, line);
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _pending.append(line);
+        ++_numPending;
+    }
+    _cv.notify_one();
+}
+
+size_t ChangeEventQueue::take(std::string& batch, std::chrono::milliseconds timeout) {
+    batch.clear();
+    std::unique_lock<std::mutex> lk(_mutex);
+    _cv.wait_for(lk, timeout, [this] { return _numPending > 0; });
+    batch.swap(_pending);
+    return std::exchange(_numPending, 0);
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "dpi.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+namespace sqlplusplus {
+
+// Appends a change notification as one line of NDJSON, e.g.
+//
+//   {"event":"objchange","database":"ORCL","tables":[{"table":"HR.EMP","operations":["update"],
+//    "rows":[{"rowid":"AAAR3sAAEAAAACXAAA","operations":["update"]}]}]}
+//
+// Query change notifications list "queries", each with its "id" and tables, instead.
+void appendChangeEventJson(const dpiSubscrMessage& message, std::string& out);
+
+// Hands change notifications from ODPI's callback thread to whoever shows them. The
+// callback only formats the event and appends it under a lock, so it never waits on a
+// terminal or pipe; the reader takes everything that piled up since its last take() in
+// one go, so under load events go out in batches rather than a write each.
+class ChangeEventQueue {
+public:
+    // For the subscription callback.
+    void push(const dpiSubscrMessage& message);
+    // Waits up to timeout for an event, then swaps every pending one into batch, which
+    // is cleared first. Returns how many there were.
+    size_t take(std::string& batch, std::chrono::milliseconds timeout);
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::string _pending;
+    size_t _numPending = 0;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,207 @@
+#include "checkpoint.h"
+
+#include "fmt/format.h"
+
+#include <cerrno>
+#include <charconv>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sqlplusplus {
+namespace {
+
+constexpr std::string_view kHeader = "sqlplusplus-checkpoint 1";
+
+// The checkpoint's lines, one "key fields..." record each, after its header.
+std::optional<std::vector<std::string>> readLines(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        return std::nullopt;
+    }
+    std::string line;
+    if (!std::getline(in, line) || line != kHeader) {
+        throw std::runtime_error(fmt::format("{} isn't a checkpoint file", path));
+    }
+    std::vector<std::string> lines;
+    while (std::getline(in, line)) {
+        if (!line.empty()) {
+            lines.push_back(std::move(line));
+        }
+    }
+    return lines;
+}
+
+// Splits a record into its key and fields; the last field takes the rest of the line, so
+// it may hold spaces, as a quoted table or partition name can.
+std::vector<std::string_view> splitFields(std::string_view line, size_t numFields) {
+    std::vector<std::string_view> fields;
+    while (fields.size() + 1 < numFields) {
+        const auto space = line.find(' ');
+        if (space == std::string_view::npos) {
+            break;
+        }
+        fields.push_back(line.substr(0, space));
+        line.remove_prefix(space + 1);
+    }
+    fields.push_back(line);
+    return fields;
+}
+
+template <typename T>
+T parseNumber(const std::string& path, std::string_view text) {
+    T value = 0;
+    auto res = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (res.ec != std::errc() || res.ptr != text.data() + text.size()) {
+        throw std::runtime_error(fmt::format("{} has a bad number \"{}\"", path, text));
+    }
+    return value;
+}
+
+std::string_view expectKind(const std::string& path, const std::vector<std::string>& lines) {
+    if (lines.empty() || lines.front().rfind("kind ", 0) != 0) {
+        throw std::runtime_error(fmt::format("{} doesn't say what it's a checkpoint of", path));
+    }
+    return std::string_view(lines.front()).substr(5);
+}
+
+void writeAtomically(const std::string& path, const std::string& contents) {
+    const auto tmpPath = path + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        throw std::system_error(errno, std::generic_category(), "error opening " + tmpPath);
+    }
+    size_t written = 0;
+    while (written < contents.size()) {
+        auto rc = ::write(fd, contents.data() + written, contents.size() - written);
+        if (rc == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            const auto err = errno;
+            ::close(fd);
+            ::unlink(tmpPath.c_str());
+            throw std::system_error(err, std::generic_category(), "error writing " + tmpPath);
+        }
+        written += static_cast<size_t>(rc);
+    }
+    if (::fsync(fd) == -1 || ::close(fd) == -1 || ::rename(tmpPath.c_str(), path.c_str()) == -1) {
+        const auto err = errno;
+        ::unlink(tmpPath.c_str());
+        throw std::system_error(err, std::generic_category(), "error saving checkpoint " + path);
+    }
+}
+
+} // namespace
+
+std::string checkpointPath(const std::string& path) {
+    return path + ".checkpoint";
+}
+
+std::optional<LoadCheckpoint> readLoadCheckpoint(const std::string& path) {
+    auto lines = readLines(path);
+    if (!lines) {
+        return std::nullopt;
+    }
+    if (expectKind(path, *lines) != "load") {
+        throw std::runtime_error(fmt::format("{} isn't the checkpoint of a load", path));
+    }
+    LoadCheckpoint checkpoint;
+    for (size_t idx = 1; idx < lines->size(); ++idx) {
+        const auto fields = splitFields((*lines)[idx], 6);
+        if (fields[0] == "range" && fields.size() == 6) {
+            checkpoint.ranges.push_back({parseNumber<uint64_t>(path, fields[1]), parseNumber<uint64_t>(path, fields[2]),
+                                         parseNumber<uint64_t>(path, fields[3]), parseNumber<uint64_t>(path, fields[4]),
+                                         parseNumber<uint64_t>(path, fields[5])});
+            continue;
+        }
+        const auto keyed = splitFields((*lines)[idx], 2);
+        if (keyed[0] == "table" && keyed.size() == 2) {
+            checkpoint.table = std::string(keyed[1]);
+        } else if (keyed[0] == "size" && keyed.size() == 2) {
+            checkpoint.fileSize = parseNumber<uint64_t>(path, keyed[1]);
+        } else {
+            throw std::runtime_error(fmt::format("{} has an unexpected line \"{}\"", path, (*lines)[idx]));
+        }
+    }
+    return checkpoint;
+}
+
+std::optional<ExportCheckpoint> readExportCheckpoint(const std::string& path) {
+    auto lines = readLines(path);
+    if (!lines) {
+        return std::nullopt;
+    }
+    if (expectKind(path, *lines) != "export") {
+        throw std::runtime_error(fmt::format("{} isn't the checkpoint of an export", path));
+    }
+    ExportCheckpoint checkpoint;
+    for (size_t idx = 1; idx < lines->size(); ++idx) {
+        const auto keyed = splitFields((*lines)[idx], 2);
+        if (keyed.size() != 2) {
+            throw std::runtime_error(fmt::format("{} has an unexpected line \"{}\"", path, (*lines)[idx]));
+        }
+        if (keyed[0] == "range" || keyed[0] == "partition") {
+            // done rows size first [last]
+            const auto fields = splitFields(keyed[1], keyed[0] == "range" ? 5 : 4);
+            if (fields.size() != (keyed[0] == "range" ? 5u : 4u)) {
+                throw std::runtime_error(fmt::format("{} has an unexpected line \"{}\"", path, (*lines)[idx]));
+            }
+            ExportCheckpoint::Shard shard;
+            shard.done = fields[0] == "done";
+            shard.rows = parseNumber<uint64_t>(path, fields[1]);
+            shard.size = parseNumber<uint64_t>(path, fields[2]);
+            shard.first = std::string(fields[3]);
+            if (keyed[0] == "range") {
+                shard.last = std::string(fields[4]);
+            }
+            checkpoint.byPartition = keyed[0] == "partition";
+            checkpoint.shards.push_back(std::move(shard));
+        } else if (keyed[0] == "table") {
+            checkpoint.table = std::string(keyed[1]);
+        } else if (keyed[0] == "format") {
+            checkpoint.format = std::string(keyed[1]);
+        } else if (keyed[0] == "parallel") {
+            checkpoint.parallel = parseNumber<uint32_t>(path, keyed[1]);
+        } else {
+            throw std::runtime_error(fmt::format("{} has an unexpected line \"{}\"", path, (*lines)[idx]));
+        }
+    }
+    return checkpoint;
+}
+
+void writeCheckpoint(const std::string& path, const LoadCheckpoint& checkpoint) {
+    auto out = fmt::format("{}\nkind load\nsize {}\n", kHeader, checkpoint.fileSize);
+    for (const auto& range : checkpoint.ranges) {
+        out += fmt::format("range {} {} {} {} {}\n", range.begin, range.end, range.next, range.nextLine, range.rowsLoaded);
+    }
+    // Last, being free text.
+    out += fmt::format("table {}\n", checkpoint.table);
+    writeAtomically(path, out);
+}
+
+void writeCheckpoint(const std::string& path, const ExportCheckpoint& checkpoint) {
+    auto out = fmt::format("{}\nkind export\nformat {}\nparallel {}\n", kHeader, checkpoint.format, checkpoint.parallel);
+    for (const auto& shard : checkpoint.shards) {
+        const auto state = shard.done ? "done" : "todo";
+        if (checkpoint.byPartition) {
+            out += fmt::format("partition {} {} {} {}\n", state, shard.rows, shard.size, shard.first);
+        } else {
+            out += fmt::format("range {} {} {} {} {}\n", state, shard.rows, shard.size, shard.first, shard.last);
+        }
+    }
+    out += fmt::format("table {}\n", checkpoint.table);
+    writeAtomically(path, out);
+}
+
+void removeCheckpoint(const std::string& path) {
+    if (::unlink(path.c_str()) == -1 && errno != ENOENT) {
+        throw std::system_error(errno, std::generic_category(), "error removing checkpoint " + path);
+    }
+}
+
+} // namespace sqlplusplus
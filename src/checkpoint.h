@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace sqlplusplus {
+
+// How far a .load got: for each byte range of the file being loaded in parallel, where
+// the records after its last commit start. Everything before next is in the table.
+struct LoadCheckpoint {
+    struct Range {
+        uint64_t begin = 0;
+        uint64_t end = 0;
+        uint64_t next = 0;
+        // The line the record at next starts on.
+        uint64_t nextLine = 0;
+        uint64_t rowsLoaded = 0;
+    };
+
+    std::string table;
+    // The input's size when the load started, to catch a file that changed since.
+    uint64_t fileSize = 0;
+    std::vector<Range> ranges;
+};
+
+// How far a parallel .export got: the ROWID ranges or partitions it was split into, so a
+// resumed export splits the table the same way however its extents have changed, and
+// which of their files were written in full.
+struct ExportCheckpoint {
+    struct Shard {
+        // The range's first and last ROWIDs, or the partition's name and nothing.
+        std::string first;
+        std::string last;
+        // What the partition was scheduled by; 0 for ranges.
+        uint64_t size = 0;
+        bool done = false;
+        uint64_t rows = 0;
+    };
+
+    std::string table;
+    std::string format;
+    uint32_t parallel = 0;
+    bool byPartition = false;
+    std::vector<Shard> shards;
+};
+
+// Where the checkpoint of a job reading or writing path goes.
+std::string checkpointPath(const std::string& path);
+
+// Read back what write*Checkpoint() left; nullopt when there's no checkpoint. Throws
+// std::runtime_error for one that can't be read, or is of the other kind.
+std::optional<LoadCheckpoint> readLoadCheckpoint(const std::string& path);
+std::optional<ExportCheckpoint> readExportCheckpoint(const std::string& path);
+
+// Written to a temporary file, synced and renamed over path, so a crash part way through
+// leaves the last checkpoint whole. Throws std::system_error if it can't be written.
+void writeCheckpoint(const std::string& path, const LoadCheckpoint& checkpoint);
+void writeCheckpoint(const std::string& path, const ExportCheckpoint& checkpoint);
+
+// Once the job is done. A checkpoint that's already gone is fine.
+void removeCheckpoint(const std::string& path);
+
+} // namespace sqlplusplus
@@ -1,6 +1,8 @@
 #include "cli_args.h"
 
+#include <algorithm>
 #include <cerrno>
+#include <cstdlib>
 #include <string>
 
 namespace sqlplusplus {
@@ -66,12 +68,15 @@ std::string CliArgument::as<std::string>() const
 template <>
 int64_t CliArgument::as<int64_t>() const
 {
-    int64_t val = std::strtol(m_value.data(), nullptr, 10);
+    std::string valueStr(m_value);
+    char* parseEnd = nullptr;
+    errno = 0;
+    int64_t val = std::strtoll(valueStr.c_str(), &parseEnd, 10);
     if (errno == ERANGE) {
         throw CliParseException("parsing integer argument produced an integer out-of-range");
     }
-    if (val == 0 && m_value.size() != 0) {
-        throw CliParseException("integer argument parsed to zero, but argument was more than 1 character");
+    if (valueStr.empty() || *parseEnd != '\0') {
+        throw CliParseException("integer argument contained non-numeric characters");
     }
     return val;
 }
@@ -1,5 +1,8 @@
-#include <vector>
+#pragma once
+
+#include <stdexcept>
 #include <string_view>
+#include <vector>
 
 namespace sqlplusplus {
 
@@ -0,0 +1,141 @@
+#include "client_counters.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sqlplusplus {
+
+ClientCounters clientCounters;
+
+namespace {
+
+uint64_t bucketUpperMicros(size_t bucket) noexcept {
+    return uint64_t{1} << bucket;
+}
+
+} // namespace
+
+void LatencyHistogram::record(std::chrono::steady_clock::duration elapsed) noexcept {
+    const auto micros = static_cast<uint64_t>(std::max<int64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count(), 0));
+    size_t bucket = 0;
+    for (auto remaining = micros; remaining != 0 && bucket < kNumBuckets - 1; remaining >>= 1) {
+        ++bucket;
+    }
+    _buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _totalMicros.fetch_add(micros, std::memory_order_relaxed);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const noexcept {
+    Snapshot snapshot;
+    for (size_t idx = 0; idx < kNumBuckets; ++idx) {
+        snapshot.buckets[idx] = _buckets[idx].load(std::memory_order_relaxed);
+    }
+    snapshot.count = _count.load(std::memory_order_relaxed);
+    snapshot.totalMicros = _totalMicros.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+uint64_t LatencyHistogram::Snapshot::quantileMicros(double quantile) const noexcept {
+    // Counted from the buckets rather than count, which may have moved on since.
+    uint64_t total = 0;
+    for (auto bucketCount : buckets) {
+        total += bucketCount;
+    }
+    if (total == 0) {
+        return 0;
+    }
+    const auto rank = std::max<uint64_t>(
+            static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(total))), 1);
+    uint64_t seen = 0;
+    for (size_t idx = 0; idx < kNumBuckets; ++idx) {
+        seen += buckets[idx];
+        if (seen >= rank) {
+            return bucketUpperMicros(idx);
+        }
+    }
+    return bucketUpperMicros(kNumBuckets - 1);
+}
+
+std::string ClientCounters::summary() const {
+    fmt::memory_buffer out;
+    for (size_t idx = 0; idx < kCounterNames.size(); ++idx) {
+        fmt::format_to(out, "{}{}: {}", idx == 0 ? "" : "\n", kCounterNames[idx],
+                _counters[idx].load(std::memory_order_relaxed));
+    }
+    const auto rowsFetched = value(ClientCounter::RowsFetched);
+    if (rowsFetched != 0) {
+        fmt::format_to(out, "\nbytes decoded per row: {:.1f}",
+                static_cast<double>(value(ClientCounter::BytesDecoded)) / rowsFetched);
+    }
+    for (size_t idx = 0; idx < kLatencyNames.size(); ++idx) {
+        const auto snapshot = _latencies[idx].snapshot();
+        fmt::format_to(out, "\n{} latency: {} calls", kLatencyNames[idx], snapshot.count);
+        if (snapshot.count != 0) {
+            fmt::format_to(out, ", mean {:.0f} us, p50 < {} us, p99 < {} us",
+                    static_cast<double>(snapshot.totalMicros) / snapshot.count,
+                    snapshot.quantileMicros(0.5), snapshot.quantileMicros(0.99));
+        }
+    }
+    return fmt::to_string(out);
+}
+
+std::string ClientCounters::toJson() const {
+    fmt::memory_buffer out;
+    fmt::format_to(out, "{{\"counters\":{{");
+    for (size_t idx = 0; idx < kCounterNames.size(); ++idx) {
+        fmt::format_to(out, "{}\"{}\":{}", idx == 0 ? "" : ",", kCounterNames[idx],
+                _counters[idx].load(std::memory_order_relaxed));
+    }
+    fmt::format_to(out, "}},\"latencies\":{{");
+    for (size_t idx = 0; idx < kLatencyNames.size(); ++idx) {
+        const auto snapshot = _latencies[idx].snapshot();
+        fmt::format_to(out, "{}\"{}\":{{\"count\":{},\"total_us\":{},\"p50_us\":{},\"p99_us\":{},"
+                "\"buckets_us\":{{", idx == 0 ? "" : ",", kLatencyNames[idx], snapshot.count,
+                snapshot.totalMicros, snapshot.quantileMicros(0.5), snapshot.quantileMicros(0.99));
+        // Only the buckets with anything in them, keyed by their upper bound.
+        bool first = true;
+        for (size_t bucket = 0; bucket < LatencyHistogram::kNumBuckets; ++bucket) {
+            if (snapshot.buckets[bucket] == 0) {
+                continue;
+            }
+            fmt::format_to(out, "{}\"{}\":{}", first ? "" : ",", bucketUpperMicros(bucket),
+                    snapshot.buckets[bucket]);
+            first = false;
+        }
+        fmt::format_to(out, "}}}}");
+    }
+    fmt::format_to(out, "}}}}");
+    return fmt::to_string(out);
+}
+
+std::string ClientCounters::toOpenMetrics() const {
+    fmt::memory_buffer out;
+    for (size_t idx = 0; idx < kCounterNames.size(); ++idx) {
+        fmt::format_to(out, "# TYPE sqlplusplus_{0} counter\nsqlplusplus_{0}_total {1}\n", kCounterNames[idx],
+                _counters[idx].load(std::memory_order_relaxed));
+    }
+    for (size_t idx = 0; idx < kLatencyNames.size(); ++idx) {
+        const auto snapshot = _latencies[idx].snapshot();
+        const auto name = kLatencyNames[idx];
+        fmt::format_to(out, "# TYPE sqlplusplus_{}_latency_seconds histogram\n# UNIT sqlplusplus_{}_latency_seconds seconds\n",
+                name, name);
+        // Buckets are cumulative; the last one takes everything past the one before it,
+        // so it's only +Inf.
+        uint64_t cumulative = 0;
+        for (size_t bucket = 0; bucket + 1 < LatencyHistogram::kNumBuckets; ++bucket) {
+            cumulative += snapshot.buckets[bucket];
+            fmt::format_to(out, "sqlplusplus_{}_latency_seconds_bucket{{le=\"{}\"}} {}\n", name,
+                    static_cast<double>(bucketUpperMicros(bucket)) / 1e6, cumulative);
+        }
+        fmt::format_to(out, "sqlplusplus_{0}_latency_seconds_bucket{{le=\"+Inf\"}} {1}\n"
+                "sqlplusplus_{0}_latency_seconds_sum {2}\nsqlplusplus_{0}_latency_seconds_count {1}\n",
+                name, snapshot.count, static_cast<double>(snapshot.totalMicros) / 1e6);
+    }
+    return fmt::to_string(out);
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace sqlplusplus {
+
+// Process-wide counters for the client's hot paths, so the client's own overhead per row
+// can be tracked from one release to the next. Every update is a relaxed atomic add, so
+// they're cheap enough to leave on everywhere and safe to bump from the background threads.
+enum class ClientCounter {
+    Executes,
+    // Single row dpiStmt_fetch calls.
+    RowFetches,
+    // dpiStmt_fetchRows calls, one per round trip or buffered block.
+    BlockFetches,
+    RowsFetched,
+    QueryValueLookups,
+    // Bytes taken out of the define buffers: the length of variable length values and the
+    // size of the value union for everything else.
+    BytesDecoded,
+    RowsRendered,
+    // Heap allocations made while building result tables: cell vector growth and new arena
+    // blocks.
+    TableAllocations,
+    // Iterations of array DML sent with executeMany, a row each.
+    ArrayDmlRows,
+    // Calls into ODPI that failed, whether the server or the client raised the error.
+    OracleErrors,
+    // Executes of queries with a RESULT_CACHE hint, which the client result cache can
+    // answer without a round trip.
+    ResultCacheExecutes,
+};
+
+enum class ClientLatency {
+    Execute,
+    BlockFetch,
+};
+
+// Latencies bucketed by powers of two microseconds: bucket 0 holds everything under 1 us
+// and bucket n holds [2^(n-1), 2^n) us.
+class LatencyHistogram {
+public:
+    static constexpr size_t kNumBuckets = 32;
+
+    struct Snapshot {
+        std::array<uint64_t, kNumBuckets> buckets{};
+        uint64_t count = 0;
+        uint64_t totalMicros = 0;
+
+        // Upper bound of the bucket the quantile (0 to 1) falls in, in microseconds.
+        uint64_t quantileMicros(double quantile) const noexcept;
+    };
+
+    void record(std::chrono::steady_clock::duration elapsed) noexcept;
+    Snapshot snapshot() const noexcept;
+
+private:
+    std::array<std::atomic<uint64_t>, kNumBuckets> _buckets{};
+    std::atomic<uint64_t> _count{0};
+    std::atomic<uint64_t> _totalMicros{0};
+};
+
+class ClientCounters {
+public:
+    static constexpr std::array<std::string_view, 11> kCounterNames = {
+        "executes",
+        "row_fetches",
+        "block_fetches",
+        "rows_fetched",
+        "query_value_lookups",
+        "bytes_decoded",
+        "rows_rendered",
+        "table_allocations",
+        "array_dml_rows",
+        "oracle_errors",
+        "result_cache_executes",
+    };
+    static constexpr std::array<std::string_view, 2> kLatencyNames = {
+        "execute",
+        "block_fetch",
+    };
+
+    void add(ClientCounter counter, uint64_t amount = 1) noexcept {
+        _counters[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    uint64_t value(ClientCounter counter) const noexcept {
+        return _counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+    }
+
+    void record(ClientLatency latency, std::chrono::steady_clock::duration elapsed) noexcept {
+        _latencies[static_cast<size_t>(latency)].record(elapsed);
+    }
+
+    LatencyHistogram::Snapshot latency(ClientLatency latency) const noexcept {
+        return _latencies[static_cast<size_t>(latency)].snapshot();
+    }
+
+    // One line per counter and histogram, for .stats.
+    std::string summary() const;
+    // Everything as a single JSON object, histogram buckets included.
+    std::string toJson() const;
+    // Everything as OpenMetrics text, counters as sqlplusplus_<name>_total and latencies
+    // as histograms in seconds, without the closing "# EOF" so more can follow.
+    std::string toOpenMetrics() const;
+
+private:
+    std::array<std::atomic<uint64_t>, kCounterNames.size()> _counters{};
+    std::array<LatencyHistogram, kLatencyNames.size()> _latencies;
+};
+
+extern ClientCounters clientCounters;
+
+} // namespace sqlplusplus
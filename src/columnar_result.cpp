@@ -0,0 +1,670 @@
+#include "columnar_result.h"
+
+#include "buffered_writer.h"
+#include "mapped_file.h"
+#include "result_metadata.h"
+#include "substring_search.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace sqlplusplus {
+namespace {
+
+ColumnarResult::ColumnType columnTypeFor(dpiNativeTypeNum nativeType) noexcept {
+    switch (nativeType) {
+    case DPI_NATIVE_TYPE_INT64:
+        return ColumnarResult::ColumnType::Int64;
+    case DPI_NATIVE_TYPE_DOUBLE:
+    case DPI_NATIVE_TYPE_FLOAT:
+        return ColumnarResult::ColumnType::Double;
+    default:
+        return ColumnarResult::ColumnType::Text;
+    }
+}
+
+void setBit(std::vector<uint64_t>& bits, uint32_t row, bool value) {
+    if (row / 64 >= bits.size()) {
+        bits.push_back(0);
+    }
+    bits[row / 64] |= uint64_t{value} << (row % 64);
+}
+
+template <typename T>
+bool compare(const T& a, const T& b, CompareOp op) noexcept {
+    switch (op) {
+    case CompareOp::Equal:
+        return a == b;
+    case CompareOp::NotEqual:
+        return a != b;
+    case CompareOp::Less:
+        return a < b;
+    case CompareOp::LessOrEqual:
+        return a <= b;
+    case CompareOp::Greater:
+        return a > b;
+    case CompareOp::GreaterOrEqual:
+        return a >= b;
+    }
+    return false;
+}
+
+// Keeps the rows of view whose value passes, writing every index and only advancing past
+// the ones that match, so there's no branch on the comparison for the compiler to keep.
+template <CompareOp Op, typename Values, typename T>
+size_t filterKernel(const Values& values, const std::vector<uint64_t>& nulls, std::vector<uint32_t>& view, T operand) {
+    size_t kept = 0;
+    for (const auto row : view) {
+        const bool isNull = (nulls[row / 64] >> (row % 64)) & 1;
+        view[kept] = row;
+        kept += static_cast<size_t>(!isNull & compare<T>(static_cast<T>(values[row]), operand, Op));
+    }
+    return kept;
+}
+
+template <typename Values, typename T>
+size_t filterValues(const Values& values, const std::vector<uint64_t>& nulls, std::vector<uint32_t>& view,
+                    CompareOp op, T operand) {
+    switch (op) {
+    case CompareOp::Equal:
+        return filterKernel<CompareOp::Equal>(values, nulls, view, operand);
+    case CompareOp::NotEqual:
+        return filterKernel<CompareOp::NotEqual>(values, nulls, view, operand);
+    case CompareOp::Less:
+        return filterKernel<CompareOp::Less>(values, nulls, view, operand);
+    case CompareOp::LessOrEqual:
+        return filterKernel<CompareOp::LessOrEqual>(values, nulls, view, operand);
+    case CompareOp::Greater:
+        return filterKernel<CompareOp::Greater>(values, nulls, view, operand);
+    case CompareOp::GreaterOrEqual:
+        return filterKernel<CompareOp::GreaterOrEqual>(values, nulls, view, operand);
+    }
+    return view.size();
+}
+
+// A text column's values as views, indexed by row, for the kernels to read like an array.
+class TextValues {
+public:
+    explicit TextValues(const ColumnarResult::Column& column) : _column(column) {}
+    std::string_view operator[](uint32_t row) const noexcept {
+        const auto begin = row == 0 ? 0 : _column.ends[row - 1];
+        return std::string_view(_column.text).substr(begin, _column.ends[row] - begin);
+    }
+
+private:
+    const ColumnarResult::Column& _column;
+};
+
+std::string_view unquoted(std::string_view value) noexcept {
+    if (value.size() >= 2 && value.front() == '\'' && value.back() == '\'') {
+        return value.substr(1, value.size() - 2);
+    }
+    return value;
+}
+
+double parseDouble(std::string_view value, std::string_view column) {
+    const std::string text(value);
+    char* end = nullptr;
+    const auto parsed = std::strtod(text.c_str(), &end);
+    if (text.empty() || end != text.c_str() + text.size()) {
+        throw std::runtime_error(fmt::format("{} is numeric and {} isn't a number", column, value));
+    }
+    return parsed;
+}
+
+// Sorts the rows of view by their keys, with the nulls after them, keeping ties in the order they had.
+template <typename Key>
+void sortView(std::vector<uint32_t>& view, const std::vector<Key>& keys, const std::vector<uint64_t>& nulls,
+              bool descending) {
+    auto firstNull = std::stable_partition(view.begin(), view.end(), [&](uint32_t row) {
+        return !((nulls[row / 64] >> (row % 64)) & 1);
+    });
+    std::vector<std::pair<Key, uint32_t>> pairs;
+    pairs.reserve(static_cast<size_t>(firstNull - view.begin()));
+    for (auto it = view.begin(); it != firstNull; ++it) {
+        pairs.emplace_back(keys[*it], *it);
+    }
+    if (descending) {
+        std::stable_sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    } else {
+        std::stable_sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    }
+    for (size_t idx = 0; idx < pairs.size(); ++idx) {
+        view[idx] = pairs[idx].second;
+    }
+    // Oracle puts nulls first when sorting descending.
+    if (descending) {
+        std::rotate(view.begin(), view.begin() + static_cast<ptrdiff_t>(pairs.size()), view.end());
+    }
+}
+
+dpiNativeTypeNum sourceNativeType(ColumnarResult::ColumnType type) noexcept {
+    switch (type) {
+    case ColumnarResult::ColumnType::Int64:
+        return DPI_NATIVE_TYPE_INT64;
+    case ColumnarResult::ColumnType::Double:
+        return DPI_NATIVE_TYPE_DOUBLE;
+    case ColumnarResult::ColumnType::Text:
+        break;
+    }
+    return DPI_NATIVE_TYPE_BYTES;
+}
+
+constexpr std::string_view kSnapshotHeader = "sqlplusplus-result 1\n";
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "snapshots are written in the host's byte order");
+
+template <typename T>
+void putValue(BufferedFdWriter& out, T value) {
+    out.append(std::string_view(reinterpret_cast<const char*>(&value), sizeof(value)));
+}
+
+template <typename T>
+void putArray(BufferedFdWriter& out, const std::vector<T>& values) {
+    out.append(std::string_view(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T)));
+}
+
+// Reads a snapshot's fields in order, throwing once it runs out of file.
+class SnapshotReader {
+public:
+    SnapshotReader(std::string_view data, const std::string& path) : _data(data), _path(path) {}
+
+    std::string_view bytes(size_t size) {
+        if (size > _data.size()) {
+            throw std::runtime_error(fmt::format("{} is cut short", _path));
+        }
+        const auto value = _data.substr(0, size);
+        _data.remove_prefix(size);
+        return value;
+    }
+
+    template <typename T>
+    T value() {
+        T value;
+        std::memcpy(&value, bytes(sizeof(T)).data(), sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    std::vector<T> array(size_t count) {
+        if (count > _data.size() / sizeof(T)) {
+            throw std::runtime_error(fmt::format("{} is cut short", _path));
+        }
+        std::vector<T> values(count);
+        std::memcpy(values.data(), bytes(count * sizeof(T)).data(), count * sizeof(T));
+        return values;
+    }
+
+private:
+    std::string_view _data;
+    const std::string& _path;
+};
+
+} // namespace
+
+CompareOp parseCompareOp(std::string_view op) {
+    if (op == "=") {
+        return CompareOp::Equal;
+    } else if (op == "!=" || op == "<>") {
+        return CompareOp::NotEqual;
+    } else if (op == "<") {
+        return CompareOp::Less;
+    } else if (op == "<=") {
+        return CompareOp::LessOrEqual;
+    } else if (op == ">") {
+        return CompareOp::Greater;
+    } else if (op == ">=") {
+        return CompareOp::GreaterOrEqual;
+    }
+    throw std::runtime_error(fmt::format("{} isn't one of =, !=, <>, <, <=, > or >=", op));
+}
+
+ColumnarResult ColumnarResult::fetch(OracleResultSource& source, uint64_t maxRows) {
+    ColumnarResult result;
+    const auto metadata = source.metadata();
+    auto formatters = metadata->formatters();
+    for (uint32_t col = 1; col <= metadata->numColumns(); ++col) {
+        Column column;
+        column.name = std::string(metadata->column(col).name);
+        column.nativeType = formatters[col - 1].nativeType();
+        column.oracleType = formatters[col - 1].oracleType();
+        column.type = columnTypeFor(column.nativeType);
+        column.quoted = column.nativeType == DPI_NATIVE_TYPE_BYTES && column.oracleType != DPI_ORACLE_TYPE_NUMBER;
+        result._columns.push_back(std::move(column));
+    }
+    for (;;) {
+        auto wanted = source.fetchArraySize();
+        if (maxRows != 0) {
+            if (result._numRows >= maxRows) {
+                result._truncated = true;
+                break;
+            }
+            wanted = static_cast<uint32_t>(std::min<uint64_t>(wanted, maxRows - result._numRows));
+        }
+        auto block = source.fetchBlock(wanted);
+        result._append(block, formatters);
+        if (!block.moreRows()) {
+            break;
+        }
+    }
+    result.reset();
+    return result;
+}
+
+void ColumnarResult::_append(const OracleFetchBlock& block, std::vector<ColumnFormatter>& formatters) {
+    fmt::memory_buffer text;
+    for (uint32_t col = 0; col < numColumns(); ++col) {
+        auto& column = _columns[col];
+        auto& formatter = formatters[col];
+        const auto nativeType = block.nativeType(col + 1);
+        if (formatter.nativeType() != nativeType) {
+            formatter = ColumnFormatter(nativeType, formatter.oracleType());
+            if (columnTypeFor(nativeType) != column.type) {
+                throw std::runtime_error(fmt::format("{} changed type part way through the result", column.name));
+            }
+        }
+        // Strings kept bare so far get their quotes back once something else shows up.
+        if (column.quoted && nativeType != DPI_NATIVE_TYPE_BYTES) {
+            std::string requoted;
+            std::vector<uint32_t> ends;
+            TextValues values(column);
+            for (uint32_t row = 0; row < _numRows; ++row) {
+                if (!isNull(col, row)) {
+                    fmt::format_to(std::back_inserter(requoted), "\"{}\"", values[row]);
+                }
+                ends.push_back(static_cast<uint32_t>(requoted.size()));
+            }
+            column.text = std::move(requoted);
+            column.ends = std::move(ends);
+            column.quoted = false;
+        }
+
+        const auto* data = block.columnData(col + 1);
+        for (uint32_t row = 0; row < block.numRows(); ++row) {
+            const auto& value = data[row];
+            const auto resultRow = _numRows + row;
+            setBit(column.nulls, resultRow, value.isNull);
+            switch (column.type) {
+            case ColumnType::Int64:
+                column.ints.push_back(value.isNull ? 0 : value.value.asInt64);
+                break;
+            case ColumnType::Double:
+                column.doubles.push_back(value.isNull ? 0
+                        : nativeType == DPI_NATIVE_TYPE_FLOAT ? value.value.asFloat : value.value.asDouble);
+                break;
+            case ColumnType::Text:
+                if (!value.isNull) {
+                    if (column.quoted) {
+                        column.text.append(value.value.asBytes.ptr, value.value.asBytes.length);
+                    } else {
+                        text.clear();
+                        formatter.format(value, text);
+                        column.text.append(text.data(), text.size());
+                    }
+                }
+                if (column.text.size() > std::numeric_limits<uint32_t>::max()) {
+                    throw std::runtime_error(fmt::format("{} has more than 4GB of text", column.name));
+                }
+                column.ends.push_back(static_cast<uint32_t>(column.text.size()));
+                break;
+            }
+        }
+    }
+    _numRows += block.numRows();
+}
+
+size_t ColumnarResult::bytes() const noexcept {
+    size_t total = _view.size() * sizeof(uint32_t);
+    for (const auto& column : _columns) {
+        total += column.ints.size() * sizeof(int64_t) + column.doubles.size() * sizeof(double)
+            + column.ends.size() * sizeof(uint32_t) + column.text.size() + column.nulls.size() * sizeof(uint64_t);
+    }
+    return total;
+}
+
+uint32_t ColumnarResult::findColumn(std::string_view name) const {
+    for (uint32_t col = 0; col < numColumns(); ++col) {
+        const auto& columnName = _columns[col].name;
+        if (columnName.size() == name.size() && std::equal(name.begin(), name.end(), columnName.begin(),
+                [](char a, char b) {
+                    return std::toupper(static_cast<unsigned char>(a)) == std::toupper(static_cast<unsigned char>(b));
+                })) {
+            return col;
+        }
+    }
+    uint32_t position = 0;
+    const auto parsed = std::from_chars(name.data(), name.data() + name.size(), position);
+    if (parsed.ec == std::errc() && parsed.ptr == name.data() + name.size() && position >= 1
+            && position <= numColumns()) {
+        return position - 1;
+    }
+    throw std::runtime_error(fmt::format("the result has no column {}", name));
+}
+
+void ColumnarResult::formatCell(uint32_t col, uint32_t row, fmt::memory_buffer& out) const {
+    const auto& column = _columns[col];
+    if (isNull(col, row)) {
+        out.append(ColumnFormatter::kNullText.data(), ColumnFormatter::kNullText.data() + ColumnFormatter::kNullText.size());
+        return;
+    }
+    dpiData data{};
+    switch (column.type) {
+    case ColumnType::Int64:
+        data.value.asInt64 = column.ints[row];
+        ColumnFormatter(DPI_NATIVE_TYPE_INT64).format(data, out);
+        return;
+    case ColumnType::Double:
+        data.value.asDouble = column.doubles[row];
+        ColumnFormatter(DPI_NATIVE_TYPE_DOUBLE).format(data, out);
+        return;
+    case ColumnType::Text: {
+        const auto value = TextValues(column)[row];
+        if (column.quoted) {
+            fmt::format_to(out, "\"{}\"", value);
+        } else {
+            out.append(value.data(), value.data() + value.size());
+        }
+        return;
+    }
+    }
+}
+
+void ColumnarResult::reset() {
+    _view.resize(_numRows);
+    for (uint32_t row = 0; row < _numRows; ++row) {
+        _view[row] = row;
+    }
+}
+
+void ColumnarResult::sortBy(uint32_t col, bool descending) {
+    const auto& column = _columns[col];
+    switch (column.type) {
+    case ColumnType::Int64:
+        sortView(_view, column.ints, column.nulls, descending);
+        break;
+    case ColumnType::Double:
+        sortView(_view, column.doubles, column.nulls, descending);
+        break;
+    case ColumnType::Text: {
+        TextValues values(column);
+        std::vector<std::string_view> keys(_numRows);
+        for (const auto row : _view) {
+            keys[row] = values[row];
+        }
+        sortView(_view, keys, column.nulls, descending);
+        break;
+    }
+    }
+}
+
+void ColumnarResult::filter(uint32_t col, CompareOp op, std::string_view value) {
+    const auto& column = _columns[col];
+    value = unquoted(value);
+    size_t kept = 0;
+    switch (column.type) {
+    case ColumnType::Int64: {
+        int64_t operand = 0;
+        const auto parsed = std::from_chars(value.data(), value.data() + value.size(), operand);
+        if (parsed.ec == std::errc() && parsed.ptr == value.data() + value.size()) {
+            kept = filterValues(column.ints, column.nulls, _view, op, operand);
+        } else {
+            kept = filterValues(column.ints, column.nulls, _view, op, parseDouble(value, column.name));
+        }
+        break;
+    }
+    case ColumnType::Double:
+        kept = filterValues(column.doubles, column.nulls, _view, op, parseDouble(value, column.name));
+        break;
+    case ColumnType::Text:
+        kept = filterValues(TextValues(column), column.nulls, _view, op, value);
+        break;
+    }
+    _view.resize(kept);
+}
+
+void ColumnarResult::grep(std::optional<uint32_t> col, std::string_view pattern) {
+    if (pattern.empty()) {
+        return;
+    }
+    std::vector<uint64_t> matched((_numRows + 63) / 64);
+    auto searchColumn = [&](uint32_t idx) {
+        const auto& column = _columns[idx];
+        if (column.type != ColumnType::Text) {
+            fmt::memory_buffer cell;
+            for (const auto row : _view) {
+                cell.clear();
+                if (!isNull(idx, row)) {
+                    formatCell(idx, row, cell);
+                    if (findSubstring(std::string_view(cell.data(), cell.size()), pattern) != std::string_view::npos) {
+                        setBit(matched, row, true);
+                    }
+                }
+            }
+            return;
+        }
+        // Every row's value is in text back to back, so a match's row is the first whose
+        // value ends past where it starts; once a row has matched, the search goes on from
+        // the next one's value.
+        const std::string_view text(column.text);
+        for (auto at = findSubstring(text, pattern); at != std::string_view::npos;) {
+            const auto row = static_cast<uint32_t>(
+                    std::upper_bound(column.ends.begin(), column.ends.end(), at) - column.ends.begin());
+            if (at + pattern.size() <= column.ends[row]) {
+                setBit(matched, row, true);
+                at = findSubstring(text, pattern, column.ends[row]);
+            } else {
+                at = findSubstring(text, pattern, at + 1);
+            }
+        }
+    };
+    if (col) {
+        searchColumn(*col);
+    } else {
+        for (uint32_t idx = 0; idx < numColumns(); ++idx) {
+            searchColumn(idx);
+        }
+    }
+    _view.erase(std::remove_if(_view.begin(), _view.end(), [&](uint32_t row) {
+        return !((matched[row / 64] >> (row % 64)) & 1);
+    }), _view.end());
+}
+
+void ColumnarResult::top(uint32_t n, uint32_t col) {
+    // Nulls are left out of the biggest values rather than counted as them.
+    _view.erase(std::remove_if(_view.begin(), _view.end(), [&](uint32_t row) { return isNull(col, row); }),
+                _view.end());
+    sortBy(col, true);
+    if (_view.size() > n) {
+        _view.resize(n);
+    }
+}
+
+void ColumnarResult::save(const std::string& path) const {
+    auto out = BufferedFdWriter::open(path);
+    out.append(kSnapshotHeader);
+    const auto numRows = static_cast<uint32_t>(_view.size());
+    putValue(out, numColumns());
+    putValue(out, numRows);
+    putValue(out, static_cast<uint8_t>(_truncated));
+    for (const auto& column : _columns) {
+        putValue(out, static_cast<uint16_t>(column.name.size()));
+        out.append(column.name);
+        putValue(out, static_cast<uint8_t>(column.type));
+        putValue(out, static_cast<uint32_t>(column.nativeType));
+        putValue(out, static_cast<uint32_t>(column.oracleType));
+        putValue(out, static_cast<uint8_t>(column.quoted));
+    }
+    // Each column is gathered in view order, so the file has the rows as they were shown.
+    for (uint32_t col = 0; col < numColumns(); ++col) {
+        const auto& column = _columns[col];
+        std::vector<uint64_t> nulls((numRows + 63) / 64);
+        for (uint32_t row = 0; row < numRows; ++row) {
+            nulls[row / 64] |= uint64_t{isNull(col, _view[row])} << (row % 64);
+        }
+        putArray(out, nulls);
+        switch (column.type) {
+        case ColumnType::Int64: {
+            std::vector<int64_t> ints(numRows);
+            for (uint32_t row = 0; row < numRows; ++row) {
+                ints[row] = column.ints[_view[row]];
+            }
+            putArray(out, ints);
+            break;
+        }
+        case ColumnType::Double: {
+            std::vector<double> doubles(numRows);
+            for (uint32_t row = 0; row < numRows; ++row) {
+                doubles[row] = column.doubles[_view[row]];
+            }
+            putArray(out, doubles);
+            break;
+        }
+        case ColumnType::Text: {
+            const TextValues values(column);
+            std::vector<uint32_t> ends(numRows);
+            uint64_t textBytes = 0;
+            for (uint32_t row = 0; row < numRows; ++row) {
+                textBytes += values[_view[row]].size();
+                ends[row] = static_cast<uint32_t>(textBytes);
+            }
+            putArray(out, ends);
+            putValue(out, textBytes);
+            for (uint32_t row = 0; row < numRows; ++row) {
+                out.append(values[_view[row]]);
+            }
+            break;
+        }
+        }
+    }
+    out.flush();
+}
+
+ColumnarResult ColumnarResult::load(const std::string& path) {
+    MappedFile file(path);
+    const auto data = file.contents();
+    if (data.substr(0, kSnapshotHeader.size()) != kSnapshotHeader) {
+        throw std::runtime_error(fmt::format("{} isn't a saved result", path));
+    }
+    SnapshotReader reader(data.substr(kSnapshotHeader.size()), path);
+    ColumnarResult result;
+    const auto numColumns = reader.value<uint32_t>();
+    result._numRows = reader.value<uint32_t>();
+    result._truncated = reader.value<uint8_t>() != 0;
+    for (uint32_t col = 0; col < numColumns; ++col) {
+        Column column;
+        column.name = std::string(reader.bytes(reader.value<uint16_t>()));
+        const auto type = reader.value<uint8_t>();
+        if (type > static_cast<uint8_t>(ColumnType::Text)) {
+            throw std::runtime_error(fmt::format("{} has a column of unknown type {}", path, type));
+        }
+        column.type = static_cast<ColumnType>(type);
+        column.nativeType = static_cast<dpiNativeTypeNum>(reader.value<uint32_t>());
+        column.oracleType = static_cast<dpiOracleTypeNum>(reader.value<uint32_t>());
+        column.quoted = reader.value<uint8_t>() != 0;
+        result._columns.push_back(std::move(column));
+    }
+    for (auto& column : result._columns) {
+        column.nulls = reader.array<uint64_t>((static_cast<size_t>(result._numRows) + 63) / 64);
+        switch (column.type) {
+        case ColumnType::Int64:
+            column.ints = reader.array<int64_t>(result._numRows);
+            break;
+        case ColumnType::Double:
+            column.doubles = reader.array<double>(result._numRows);
+            break;
+        case ColumnType::Text: {
+            column.ends = reader.array<uint32_t>(result._numRows);
+            const auto textBytes = reader.value<uint64_t>();
+            if (!column.ends.empty() && column.ends.back() != textBytes) {
+                throw std::runtime_error(fmt::format("{} has a column whose text doesn't add up", path));
+            }
+            column.text = std::string(reader.bytes(textBytes));
+            break;
+        }
+        }
+    }
+    result.reset();
+    return result;
+}
+
+ColumnarResultSource::ColumnarResultSource(const ColumnarResult& result, uint32_t fetchArraySize) :
+    _result(result),
+    _fetchArraySize(std::max<uint32_t>(fetchArraySize, 1)),
+    _buffers(result.numColumns())
+{
+    _metadata = std::make_shared<const ResultMetadata>(*this);
+}
+
+OracleColumnInfo ColumnarResultSource::getColumnInfo(uint32_t pos) const {
+    const auto& column = _result.column(pos - 1);
+    dpiQueryInfo info;
+    std::memset(&info, 0, sizeof(info));
+    info.name = column.name.c_str();
+    info.nameLength = static_cast<uint32_t>(column.name.size());
+    info.nullOk = 1;
+    info.typeInfo.defaultNativeTypeNum = sourceNativeType(column.type);
+    switch (column.type) {
+    case ColumnarResult::ColumnType::Int64:
+        info.typeInfo.oracleTypeNum = DPI_ORACLE_TYPE_NUMBER;
+        break;
+    case ColumnarResult::ColumnType::Double:
+        info.typeInfo.oracleTypeNum = DPI_ORACLE_TYPE_NATIVE_DOUBLE;
+        break;
+    case ColumnarResult::ColumnType::Text:
+        // Strings are kept bare and get their quotes from the formatter; anything else is
+        // kept as the text it was shown as, which the formatter for NUMBER text copies as is.
+        info.typeInfo.oracleTypeNum = column.quoted ? DPI_ORACLE_TYPE_VARCHAR : DPI_ORACLE_TYPE_NUMBER;
+        break;
+    }
+    return OracleColumnInfo(info);
+}
+
+OracleFetchBlock ColumnarResultSource::fetchBlock(uint32_t maxRows) {
+    const auto& view = _result.view();
+    const auto numRows = static_cast<uint32_t>(std::min<size_t>({maxRows, _fetchArraySize, view.size() - _next}));
+    std::vector<OracleFetchBlock::Column> columns;
+    columns.reserve(_buffers.size());
+    for (uint32_t col = 0; col < _result.numColumns(); ++col) {
+        const auto& column = _result.column(col);
+        auto& buffer = _buffers[col];
+        buffer.resize(numRows);
+        for (uint32_t idx = 0; idx < numRows; ++idx) {
+            const auto row = view[_next + idx];
+            auto& data = buffer[idx];
+            data.isNull = _result.isNull(col, row);
+            switch (column.type) {
+            case ColumnarResult::ColumnType::Int64:
+                data.value.asInt64 = column.ints[row];
+                break;
+            case ColumnarResult::ColumnType::Double:
+                data.value.asDouble = column.doubles[row];
+                break;
+            case ColumnarResult::ColumnType::Text: {
+                const auto begin = row == 0 ? 0 : column.ends[row - 1];
+                // The formatters only read through the pointer.
+                data.value.asBytes.ptr = const_cast<char*>(column.text.data()) + begin;
+                data.value.asBytes.length = column.ends[row] - begin;
+                data.value.asBytes.encoding = nullptr;
+                break;
+            }
+            }
+        }
+        columns.push_back({sourceNativeType(column.type), buffer.data()});
+    }
+    _next += numRows;
+    return OracleFetchBlock(std::move(columns), numRows, 0, _next < view.size());
+}
+
+const dpiJsonNode& ColumnarResultSource::jsonValue(const dpiData&, uint32_t) const {
+    throw std::logic_error("kept results have no JSON columns");
+}
+
+} // namespace sqlplusplus
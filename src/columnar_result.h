@@ -0,0 +1,159 @@
+#pragma once
+
+#include "oracle_helpers.h"
+#include "value_format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+enum class CompareOp { Equal, NotEqual, Less, LessOrEqual, Greater, GreaterOrEqual };
+
+// Parses =, != or <>, <, <=, > and >=. Throws std::runtime_error for anything else.
+CompareOp parseCompareOp(std::string_view op);
+
+// A fetched result kept on the client column by column, so it can be sorted, filtered and
+// cut down again without going back to the server. Integers and floating point values are
+// kept as arrays of int64_t and double, everything else as its text, back to back in one
+// buffer with an offset per row, and each column has a null bitmap. Values are sliced
+// through a view, a list of row indexes in the order they're shown: sorting and filtering
+// rearrange or narrow the view, leaving the columns alone, and reset() brings back every
+// row in fetch order.
+//
+// The kernels scan a column's array directly rather than going a row at a time through a
+// generic cell, so the compiler can vectorize the comparisons.
+class ColumnarResult {
+public:
+    enum class ColumnType { Int64, Double, Text };
+
+    struct Column {
+        std::string name;
+        ColumnType type = ColumnType::Text;
+        // How the values came back, so cells are shown the way the table shows them.
+        dpiNativeTypeNum nativeType = DPI_NATIVE_TYPE_BYTES;
+        dpiOracleTypeNum oracleType = DPI_ORACLE_TYPE_NONE;
+        std::vector<int64_t> ints;
+        std::vector<double> doubles;
+        // For text, where each row's value ends in text; a null is empty.
+        std::vector<uint32_t> ends;
+        std::string text;
+        // Bit row % 64 of word row / 64 is set for a null.
+        std::vector<uint64_t> nulls;
+        // Text values that all came back as strings are kept without the quotes the table
+        // puts around them, so they compare as themselves.
+        bool quoted = false;
+    };
+
+    // Fetches the rest of source, or its next maxRows rows when maxRows isn't 0.
+    static ColumnarResult fetch(OracleResultSource& source, uint64_t maxRows);
+
+    uint32_t numColumns() const noexcept {
+        return static_cast<uint32_t>(_columns.size());
+    }
+    const Column& column(uint32_t col) const noexcept {
+        return _columns[col];
+    }
+    // Rows fetched, whatever the view has.
+    uint32_t numRows() const noexcept {
+        return _numRows;
+    }
+    // Whether fetch() stopped at maxRows with rows left.
+    bool truncated() const noexcept {
+        return _truncated;
+    }
+    size_t bytes() const noexcept;
+
+    // Row indexes in the order they're shown.
+    const std::vector<uint32_t>& view() const noexcept {
+        return _view;
+    }
+
+    // The column named name, ignoring case, or numbered so from 1. Throws std::runtime_error
+    // when there's neither.
+    uint32_t findColumn(std::string_view name) const;
+
+    bool isNull(uint32_t col, uint32_t row) const noexcept {
+        return (_columns[col].nulls[row / 64] >> (row % 64)) & 1;
+    }
+    // Appends a cell's text as the table shows it to out.
+    void formatCell(uint32_t col, uint32_t row, fmt::memory_buffer& out) const;
+
+    // Every row again, in fetch order.
+    void reset();
+    // Reorders the view by a column, keeping the order rows that tie had; nulls sort
+    // last, or first when descending, as they do in Oracle. Text sorts by its bytes.
+    void sortBy(uint32_t col, bool descending);
+    // Keeps only the rows of the view whose value compares true against value, parsed as
+    // the column's type. Nulls never match. Throws std::runtime_error for a value that
+    // isn't a number on a numeric column.
+    void filter(uint32_t col, CompareOp op, std::string_view value);
+    // Keeps only the rows of the view with pattern in a column's text, or in any column's
+    // when col is empty; numbers are searched as the table shows them. Text columns are
+    // searched in one pass over their buffer rather than a value at a time, and a match
+    // that runs from one value into the next doesn't count. Nulls never match, and case
+    // matters.
+    void grep(std::optional<uint32_t> col, std::string_view pattern);
+    // Narrows the view to its n rows with the largest values of a column, largest first.
+    void top(uint32_t n, uint32_t col);
+
+    // Writes the rows of the view, in its order, to path as a snapshot that load() reads
+    // back without a database: a header with each column's name and types, then each
+    // column's null bitmap and values as they're kept here, little-endian. Throws
+    // std::system_error if path can't be written.
+    void save(const std::string& path) const;
+    // Reads a snapshot save() wrote, with every row in the view. Throws
+    // std::runtime_error for a file that isn't one or is cut short.
+    static ColumnarResult load(const std::string& path);
+
+private:
+    void _append(const OracleFetchBlock& block, std::vector<ColumnFormatter>& formatters);
+
+    std::vector<Column> _columns;
+    uint32_t _numRows = 0;
+    bool _truncated = false;
+    std::vector<uint32_t> _view;
+};
+
+// Hands the rows of a ColumnarResult's view out as fetched blocks, in the view's order, so
+// a kept or loaded result can be shown in the pager like a query that's still open.
+// Numbers come back as themselves; text comes back as bytes described so the value
+// formatters show it the way the result does, quoting strings and leaving the text of
+// dates and the like alone. result must outlive the source and stay as it is meanwhile.
+class ColumnarResultSource : public OracleResultSource {
+public:
+    explicit ColumnarResultSource(const ColumnarResult& result, uint32_t fetchArraySize = 500);
+
+    uint32_t numColumns() const override {
+        return _result.numColumns();
+    }
+    OracleColumnInfo getColumnInfo(uint32_t pos) const override;
+    std::shared_ptr<const ResultMetadata> metadata() const override {
+        return _metadata;
+    }
+    uint32_t fetchArraySize() const override {
+        return _fetchArraySize;
+    }
+    OracleFetchBlock fetchBlock(uint32_t maxRows) override;
+    // There are no JSON columns; throws std::logic_error.
+    const dpiJsonNode& jsonValue(const dpiData& data, uint32_t options) const override;
+    const OracleContext* context() const noexcept override {
+        return nullptr;
+    }
+
+private:
+    const ColumnarResult& _result;
+    uint32_t _fetchArraySize;
+    std::shared_ptr<const ResultMetadata> _metadata;
+    // The next index into the view.
+    size_t _next = 0;
+    // dpiData for the block handed out last, column by column.
+    std::vector<std::vector<dpiData>> _buffers;
+};
+
+} // namespace sqlplusplus
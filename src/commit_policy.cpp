@@ -0,0 +1,26 @@
+#include "commit_policy.h"
+
+namespace sqlplusplus {
+
+dpiExecMode CommitPolicy::modeFor(const Limits& limits, uint32_t statements) const noexcept {
+    const bool commit = limits.autocommit ||
+        (limits.statements != 0 && _pendingStatements + statements >= limits.statements) ||
+        (limits.rows != 0 && _pendingRows >= limits.rows);
+    return commit ? DPI_MODE_EXEC_COMMIT_ON_SUCCESS : DPI_MODE_EXEC_DEFAULT;
+}
+
+void CommitPolicy::executed(dpiExecMode mode, uint32_t statements, uint64_t rows) noexcept {
+    if ((mode & DPI_MODE_EXEC_COMMIT_ON_SUCCESS) != 0) {
+        ended();
+        return;
+    }
+    _pendingStatements += statements;
+    _pendingRows += rows;
+}
+
+void CommitPolicy::ended() noexcept {
+    _pendingStatements = 0;
+    _pendingRows = 0;
+}
+
+} // namespace sqlplusplus
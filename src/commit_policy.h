@@ -0,0 +1,43 @@
+#pragma once
+
+#include "dpi.h"
+
+#include <cstdint>
+
+namespace sqlplusplus {
+
+// When the changes a session makes get committed without an explicit COMMIT. With
+// autocommit every change commits, and otherwise a script may commit every so many
+// statements or rows. Either way the commit goes with the execute that reaches the limit,
+// as DPI_MODE_EXEC_COMMIT_ON_SUCCESS, rather than costing a round trip of its own. The row
+// count is only known once a statement has run, so a row limit commits with the change
+// after the one that reached it, or when the script ends.
+class CommitPolicy {
+public:
+    struct Limits {
+        bool autocommit = false;
+        // 0 is no limit; with neither, changes wait for a COMMIT.
+        uint32_t statements = 0;
+        uint64_t rows = 0;
+    };
+
+    // How to execute a change of statements statements, e.g. an executeMany of that many
+    // rows, under limits.
+    dpiExecMode modeFor(const Limits& limits, uint32_t statements) const noexcept;
+    // A change executed with mode, which committed it along with everything before it if
+    // mode has DPI_MODE_EXEC_COMMIT_ON_SUCCESS.
+    void executed(dpiExecMode mode, uint32_t statements, uint64_t rows) noexcept;
+    // COMMIT, ROLLBACK or DDL ended the transaction.
+    void ended() noexcept;
+
+    // Whether there are changes made since the last commit this knows of.
+    bool hasPending() const noexcept {
+        return _pendingStatements != 0;
+    }
+
+private:
+    uint64_t _pendingStatements = 0;
+    uint64_t _pendingRows = 0;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,353 @@
+#include "completion.h"
+
+#include <algorithm>
+#include <cctype>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+
+namespace sqlplusplus {
+namespace {
+
+// Base scores by context and source, in CompletionSource order. Commands only ever match a
+// line starting with a dot, so they rank ahead of everything.
+constexpr int32_t kCommandScore = 1000;
+constexpr int32_t kContextScores[][5] = {
+    // StatementStart
+    {kCommandScore, 400, 100, 100, 100},
+    // Relation
+    {kCommandScore, 100, 400, 50, 150},
+    // Column
+    {kCommandScore, 200, 150, 400, 200},
+    // Other
+    {kCommandScore, 200, 200, 200, 200},
+};
+
+// Each doubling of a word's use moves it up this much, to at most kMaxFrequencyScore, so
+// habit can lift a word over one its context favours but a single use can't.
+constexpr int32_t kFrequencyStep = 60;
+constexpr int32_t kMaxFrequencyScore = 300;
+
+bool isWordChar(char ch) {
+    return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_' || ch == '$' || ch == '#';
+}
+
+bool equalsLower(std::string_view word, std::string_view lower) {
+    return word.size() == lower.size() && std::equal(word.begin(), word.end(), lower.begin(), [](char left, char right) {
+        return std::tolower(static_cast<unsigned char>(left)) == right;
+    });
+}
+
+bool isAnyOf(std::string_view word, std::initializer_list<std::string_view> keywords) {
+    return std::any_of(keywords.begin(), keywords.end(), [word](std::string_view keyword) {
+        return equalsLower(word, keyword);
+    });
+}
+
+// The context after word, a keyword or any other complete word.
+CompletionContext contextAfterWord(CompletionContext context, std::string_view word) {
+    if (isAnyOf(word, {"from", "join", "into", "update", "table", "describe", "desc"})) {
+        return CompletionContext::Relation;
+    }
+    if (isAnyOf(word, {"select", "where", "and", "or", "by", "set", "on", "having", "when", "then", "else",
+                       "distinct"})) {
+        return CompletionContext::Column;
+    }
+    if (context == CompletionContext::StatementStart ||
+        isAnyOf(word, {"values", "as", "begin", "declare", "exec", "execute", "call"})) {
+        return CompletionContext::Other;
+    }
+    return context;
+}
+
+} // namespace
+
+size_t completionWordStart(std::string_view line, std::string_view boundaries) {
+    auto lastWordBoundary = line.find_last_of(boundaries);
+    if (lastWordBoundary == std::string_view::npos || lastWordBoundary == 0) {
+        return 0;
+    }
+    return lastWordBoundary + 1;
+}
+
+void addPrefixCompletions(std::string_view line, size_t wordStart, const tsl::htrie_set<char>& words,
+        std::vector<std::string>& out) {
+    const auto head = line.substr(0, wordStart);
+    auto prefixRange = words.equal_prefix_range(line.substr(wordStart));
+    std::string key;
+    for (auto it = prefixRange.first; it != prefixRange.second; ++it) {
+        it.key(key);
+        auto& completion = out.emplace_back();
+        completion.reserve(head.size() + key.size());
+        completion.append(head);
+        completion.append(key);
+    }
+}
+
+const CompletionPoint& CompletionLexer::update(std::string_view line) {
+    const auto common = static_cast<size_t>(
+        std::mismatch(line.begin(), line.end(), _line.begin(), _line.end()).first - line.begin());
+    // A token's state also depends on the character that ended the token before it, which
+    // can be its own first one, so it only survives when that character is unchanged too.
+    while (!_checkpoints.empty() && _checkpoints.back().pos >= common) {
+        _checkpoints.pop_back();
+    }
+    State state;
+    if (!_checkpoints.empty()) {
+        state = _checkpoints.back();
+        _checkpoints.pop_back();
+    }
+    _line.assign(line);
+    _lex(line, state);
+    return _point;
+}
+
+void CompletionLexer::_lex(std::string_view line, State state) {
+    constexpr auto npos = std::string_view::npos;
+    auto& pos = state.pos;
+    while (pos < line.size()) {
+        const char ch = line[pos];
+        if (std::isspace(static_cast<unsigned char>(ch))) {
+            ++pos;
+            state.nameStart = state.nameEnd = state.colonEnd = npos;
+            state.afterDot = false;
+            continue;
+        }
+        _checkpoints.push_back(state);
+        const auto start = pos;
+        const bool atLineStart = std::exchange(state.atLineStart, false);
+        // Anything but a word or a dot ends a dotted name, and anything but a word a bind.
+        auto endName = [&] {
+            state.nameStart = state.nameEnd = state.colonEnd = npos;
+            state.afterDot = false;
+        };
+
+        if (atLineStart && (ch == '.' || ch == '@')) {
+            while (pos < line.size() && !std::isspace(static_cast<unsigned char>(line[pos]))) {
+                ++pos;
+            }
+            if (pos == line.size()) {
+                return _finish(line, _checkpoints.back(), start);
+            }
+            state.context = CompletionContext::Other;
+            endName();
+        } else if (isWordChar(ch)) {
+            while (pos < line.size() && isWordChar(line[pos])) {
+                ++pos;
+            }
+            if (pos == line.size()) {
+                return _finish(line, _checkpoints.back(), start);
+            }
+            const auto word = line.substr(start, pos - start);
+            if (std::isdigit(static_cast<unsigned char>(ch))) {
+                endName();
+            } else if (state.afterDot && state.nameEnd == start) {
+                state.nameEnd = pos;
+                state.afterDot = false;
+            } else {
+                if (state.colonEnd != start) {
+                    state.context = contextAfterWord(state.context, word);
+                }
+                state.nameStart = start;
+                state.nameEnd = pos;
+                state.afterDot = false;
+                state.colonEnd = npos;
+            }
+        } else if (ch == '\'' || ch == '"') {
+            const auto close = line.find(ch, pos + 1);
+            if (close == npos) {
+                return _finish(line, _checkpoints.back(), start);
+            }
+            pos = close + 1;
+            endName();
+        } else if ((ch == '-' || ch == '/') && pos + 1 == line.size()) {
+            // Might be the start of a comment.
+            return _finish(line, _checkpoints.back(), start);
+        } else if (ch == '-' && line[pos + 1] == '-') {
+            const auto newline = line.find('\n', pos + 2);
+            if (newline == npos) {
+                return _finish(line, _checkpoints.back(), start);
+            }
+            pos = newline;
+            endName();
+        } else if (ch == '/' && line[pos + 1] == '*') {
+            const auto close = line.find("*/", pos + 2);
+            if (close == npos) {
+                return _finish(line, _checkpoints.back(), start);
+            }
+            pos = close + 2;
+            endName();
+        } else if (ch == '.' && state.nameEnd == pos && !state.afterDot) {
+            state.nameEnd = ++pos;
+            state.afterDot = true;
+        } else if (ch == ':') {
+            endName();
+            state.colonEnd = ++pos;
+        } else {
+            if (ch == ';') {
+                state.context = CompletionContext::StatementStart;
+            }
+            ++pos;
+            endName();
+        }
+    }
+    _finish(line, state, line.size());
+}
+
+void CompletionLexer::_finish(std::string_view line, const State& state, size_t tailStart) {
+    using Kind = CompletionPoint::Kind;
+    _point.context = state.context;
+    _point.wordStart = tailStart;
+    _point.nameStart = tailStart;
+    const auto tail = line.substr(tailStart);
+    if (!tail.empty() && state.atLineStart && (tail.front() == '.' || tail.front() == '@')) {
+        _point.kind = Kind::Command;
+    } else if (!tail.empty() && (!isWordChar(tail.front()) || std::isdigit(static_cast<unsigned char>(tail.front())))) {
+        _point.kind = Kind::None;
+    } else if (state.afterDot && state.nameEnd == tailStart) {
+        _point.kind = Kind::QualifiedName;
+        _point.nameStart = state.nameStart;
+    } else if (state.colonEnd == tailStart) {
+        _point.kind = Kind::Bind;
+    } else {
+        _point.kind = Kind::Word;
+    }
+}
+
+void WordFrequencies::addStatement(std::string_view statement) {
+    for (size_t pos = 0; pos < statement.size();) {
+        if (!isWordChar(statement[pos]) && statement[pos] != '.') {
+            ++pos;
+            continue;
+        }
+        const auto start = pos;
+        while (pos < statement.size() && (isWordChar(statement[pos]) || statement[pos] == '.')) {
+            ++pos;
+        }
+        auto word = statement.substr(start, pos - start);
+        // A dot-command keeps its leading dot; a trailing one is just punctuation.
+        while (!word.empty() && word.back() == '.') {
+            word.remove_suffix(1);
+        }
+        if (word.empty() || std::isdigit(static_cast<unsigned char>(word.front()))) {
+            continue;
+        }
+        _add(word);
+        if (word.find('.', 1) == std::string_view::npos) {
+            continue;
+        }
+        for (size_t partStart = word.front() == '.' ? 1 : 0; partStart < word.size();) {
+            const auto partEnd = std::min(word.find('.', partStart), word.size());
+            if (partEnd > partStart) {
+                _add(word.substr(partStart, partEnd - partStart));
+            }
+            partStart = partEnd + 1;
+        }
+    }
+}
+
+void WordFrequencies::_add(std::string_view word) {
+    _lowered.clear();
+    std::transform(word.begin(), word.end(), std::back_inserter(_lowered), [](char ch) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+    });
+    ++_counts[_lowered];
+}
+
+uint32_t WordFrequencies::count(std::string_view word) const {
+    auto it = _counts.find(word);
+    return it == _counts.end() ? 0 : it.value();
+}
+
+CompletionRanker::CompletionRanker(CompletionContext context, const WordFrequencies* frequencies, size_t maxResults)
+    : _context(context),
+      _frequencies(frequencies),
+      _maxResults(std::max<size_t>(maxResults, 1))
+{
+    _heap.reserve(_maxResults);
+}
+
+void CompletionRanker::reset(CompletionContext context) {
+    _context = context;
+    _heap.clear();
+    _words.reset();
+}
+
+bool CompletionRanker::_better(int32_t leftScore,
+                               std::string_view leftWord,
+                               int32_t rightScore,
+                               std::string_view rightWord) {
+    if (leftScore != rightScore) {
+        return leftScore > rightScore;
+    }
+    if (leftWord.size() != rightWord.size()) {
+        return leftWord.size() < rightWord.size();
+    }
+    return leftWord < rightWord;
+}
+
+int32_t CompletionRanker::_score(std::string_view word, CompletionSource source) const {
+    auto score = kContextScores[static_cast<size_t>(_context)][static_cast<size_t>(source)];
+    if (_frequencies != nullptr) {
+        int32_t bonus = 0;
+        for (auto uses = _frequencies->count(word); uses > 0 && bonus < kMaxFrequencyScore; uses >>= 1) {
+            bonus += kFrequencyStep;
+        }
+        score += std::min(bonus, kMaxFrequencyScore);
+    }
+    return score;
+}
+
+void CompletionRanker::offer(std::string_view word, CompletionSource source) {
+    const auto score = _score(word, source);
+    auto worse = [](const Candidate& left, const Candidate& right) {
+        return _better(left.score, left.word, right.score, right.word);
+    };
+    if (_heap.size() == _maxResults && !_better(score, word, _heap.front().score, _heap.front().word)) {
+        return;
+    }
+    // The same word can come from more than one source; it's kept once, at its best.
+    auto existing = std::find_if(_heap.begin(), _heap.end(), [word](const Candidate& kept) {
+        return kept.word == word;
+    });
+    if (existing != _heap.end()) {
+        if (score > existing->score) {
+            existing->score = score;
+            std::make_heap(_heap.begin(), _heap.end(), worse);
+        }
+        return;
+    }
+    if (_heap.size() == _maxResults) {
+        std::pop_heap(_heap.begin(), _heap.end(), worse);
+        _heap.pop_back();
+    }
+    _heap.push_back({score, _words.append(word)});
+    std::push_heap(_heap.begin(), _heap.end(), worse);
+}
+
+void CompletionRanker::offerPrefixMatches(const tsl::htrie_set<char>& words,
+                                          std::string_view prefix,
+                                          CompletionSource source) {
+    auto prefixRange = words.equal_prefix_range(prefix);
+    std::string key;
+    size_t scanned = 0;
+    for (auto it = prefixRange.first; it != prefixRange.second && scanned < kMaxScannedPerSource; ++it, ++scanned) {
+        it.key(key);
+        offer(key, source);
+    }
+}
+
+void CompletionRanker::_sortBestFirst() {
+    std::sort(_heap.begin(), _heap.end(), [](const Candidate& left, const Candidate& right) {
+        return _better(left.score, left.word, right.score, right.word);
+    });
+}
+
+std::vector<std::string> CompletionRanker::take(std::string_view head) {
+    std::vector<std::string> out;
+    out.reserve(_heap.size());
+    take(head, [&out](std::string_view completion) { out.emplace_back(completion); });
+    return out;
+}
+
+} // namespace sqlplusplus
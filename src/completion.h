@@ -0,0 +1,180 @@
+#pragma once
+
+#include "arena.h"
+
+#include "tsl/htrie_map.h"
+#include "tsl/htrie_set.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+// Where the word being completed starts in line: just past the last of boundaries, or 0 when
+// there isn't one.
+size_t completionWordStart(std::string_view line, std::string_view boundaries);
+
+// Appends line with its word from wordStart on replaced by each of words that has it as a
+// prefix.
+void addPrefixCompletions(std::string_view line, size_t wordStart, const tsl::htrie_set<char>& words,
+        std::vector<std::string>& out);
+
+// What the statement expects at the word being completed, going by the last clause keyword
+// before it: a table after FROM, JOIN, INTO or UPDATE, a column after SELECT, WHERE, BY and
+// the like, a keyword at the start of a statement.
+enum class CompletionContext : uint8_t {
+    StatementStart,
+    Relation,
+    Column,
+    Other,
+};
+
+// What's being completed at the end of the buffer, and where it starts.
+struct CompletionPoint {
+    enum class Kind : uint8_t {
+        // A dot-command at the start of the line.
+        Command,
+        // A bare word, which may be empty right after a space or punctuation.
+        Word,
+        // The last part of a dotted name, e.g. "hr.emp" or "employees.".
+        QualifiedName,
+        // A :name bind placeholder.
+        Bind,
+        // Inside a quote, a comment or a number, where nothing completes.
+        None,
+    };
+
+    Kind kind = Kind::Word;
+    CompletionContext context = CompletionContext::StatementStart;
+    size_t wordStart = 0;
+    // Where the whole dotted name starts for a QualifiedName, wordStart otherwise.
+    size_t nameStart = 0;
+};
+
+// Tokenizes the line being edited as it's typed. The lexer's state is kept at the start of
+// every token, so when a keystroke only changes the end of the line, update() resumes from
+// the token it changed rather than rescanning the whole line: typing a character costs the
+// length of the word it's part of. Quotes and comments are skipped over, dotted names and bind
+// placeholders are recognized, and a ; starts the next statement.
+class CompletionLexer {
+public:
+    const CompletionPoint& update(std::string_view line);
+
+private:
+    struct State {
+        // Where the token this state is the start of begins.
+        size_t pos = 0;
+        CompletionContext context = CompletionContext::StatementStart;
+        // The dotted name the last tokens made up, when the last of them was a word or a
+        // dot with nothing between them.
+        size_t nameStart = std::string_view::npos;
+        size_t nameEnd = std::string_view::npos;
+        bool afterDot = false;
+        // End of the last token when it was a :.
+        size_t colonEnd = std::string_view::npos;
+        bool atLineStart = true;
+    };
+
+    // Lexes line from state on. Stops at the end or at a token the end of the line cuts
+    // short, which is left to _finish().
+    void _lex(std::string_view line, State state);
+    void _finish(std::string_view line, const State& state, size_t tailStart);
+
+    std::string _line;
+    // Lexer state at the start of each token of _line, in order.
+    std::vector<State> _checkpoints;
+    CompletionPoint _point;
+};
+
+// Where a completion comes from, which decides how it ranks in each context.
+enum class CompletionSource : uint8_t {
+    Command,
+    Keyword,
+    // Tables, views and synonyms.
+    Relation,
+    Column,
+    // Sequences, packages, procedures and the rest.
+    OtherObject,
+};
+
+// How often each word has been used in past statements, so the ones typed all the time
+// rank first. Words are identifiers, dot-commands and dotted names, lower-cased; a dotted
+// name counts for each of its parts as well.
+class WordFrequencies {
+public:
+    void addStatement(std::string_view statement);
+    // word must be lower-case.
+    uint32_t count(std::string_view word) const;
+
+private:
+    void _add(std::string_view word);
+
+    tsl::htrie_map<char, uint32_t> _counts;
+    std::string _lowered;
+};
+
+// Collects the best completions for one word out of however many candidates are offered.
+// Candidates are scored by their source in the context and how often they've been used,
+// and only the top maxResults are kept, in a heap, so a one letter prefix over a huge
+// schema index copies out a handful of strings rather than all of its matches. Ties go to
+// the shorter word, then the one first alphabetically.
+class CompletionRanker {
+public:
+    // How many matches of one source are looked at, which bounds the time a completion
+    // takes however big the index behind it is.
+    static constexpr size_t kMaxScannedPerSource = 4000;
+
+    CompletionRanker(CompletionContext context, const WordFrequencies* frequencies, size_t maxResults);
+
+    // Empties the ranker for the next completion, in context. A ranker that's reset rather
+    // than made afresh keeps its storage, so completing stops allocating once it's warm.
+    void reset(CompletionContext context);
+
+    // word is only read during the call.
+    void offer(std::string_view word, CompletionSource source);
+    // Offers the words starting with prefix, up to kMaxScannedPerSource of them.
+    void offerPrefixMatches(const tsl::htrie_set<char>& words, std::string_view prefix, CompletionSource source);
+
+    // Calls emit with each kept word, best first, appended to head. The completion is
+    // built in a buffer of the ranker's and null terminated, and only valid until emit
+    // returns. Leaves the ranker empty.
+    template <typename EmitFn>
+    void take(std::string_view head, EmitFn&& emit) {
+        _sortBestFirst();
+        for (const auto& candidate : _heap) {
+            _completion.assign(head.data(), head.size());
+            _completion.append(candidate.word.data(), candidate.word.size());
+            emit(std::string_view(_completion));
+        }
+        reset(_context);
+    }
+    // The same, copied out.
+    std::vector<std::string> take(std::string_view head);
+
+private:
+    struct Candidate {
+        int32_t score;
+        // Points into _words.
+        std::string_view word;
+    };
+    // Whether left ranks ahead of right.
+    static bool _better(int32_t leftScore, std::string_view leftWord, int32_t rightScore, std::string_view rightWord);
+
+    int32_t _score(std::string_view word, CompletionSource source) const;
+    void _sortBestFirst();
+
+    CompletionContext _context;
+    const WordFrequencies* _frequencies;
+    const size_t _maxResults;
+    // A heap with the worst kept candidate on top.
+    std::vector<Candidate> _heap;
+    // The words offered and kept, including ones pushed out of the heap since, until the
+    // next reset.
+    StringArena _words;
+    std::string _completion;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,209 @@
+#include "compressed_output.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <unistd.h>
+#include <zlib.h>
+
+namespace sqlplusplus {
+namespace {
+
+// Buffers queued per compressor; enough that one is always waiting when a thread frees up.
+constexpr size_t kBuffersPerThread = 2;
+
+// One compressor thread's deflate state, reset rather than reallocated for every buffer.
+class GzipStream {
+public:
+    explicit GzipStream(int level) {
+        // 16 over the window bits asks for a gzip header and trailer rather than zlib's.
+        if (deflateInit2(&_stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error(fmt::format("can't start gzip at level {}", level));
+        }
+    }
+    GzipStream(const GzipStream&) = delete;
+    GzipStream& operator=(const GzipStream&) = delete;
+    ~GzipStream() {
+        deflateEnd(&_stream);
+    }
+
+    // Compresses data into a gzip member of its own.
+    std::string compress(const char* data, size_t size) {
+        deflateReset(&_stream);
+        std::string out(deflateBound(&_stream, size), '\0');
+        _stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        _stream.avail_in = static_cast<uInt>(size);
+        _stream.next_out = reinterpret_cast<Bytef*>(out.data());
+        _stream.avail_out = static_cast<uInt>(out.size());
+        if (deflate(&_stream, Z_FINISH) != Z_STREAM_END) {
+            throw std::runtime_error(fmt::format("gzip failed: {}", _stream.msg ? _stream.msg : "out of space"));
+        }
+        out.resize(_stream.total_out);
+        return out;
+    }
+
+private:
+    z_stream _stream = {};
+};
+
+} // namespace
+
+GzipPipeline::GzipPipeline(int fd, const OutputCompression& compression) :
+    _fd(fd),
+    _level(std::clamp(compression.level, 1, 9)),
+    _maxInFlight(std::max<uint32_t>(compression.threads, 1) * kBuffersPerThread)
+{
+    try {
+        for (uint32_t idx = 0; idx < std::max<uint32_t>(compression.threads, 1); ++idx) {
+            _threads.emplace_back([this] { _compress(); });
+        }
+        _threads.emplace_back([this] { _write(); });
+    } catch(...) {
+        _stop();
+        throw;
+    }
+}
+
+GzipPipeline::~GzipPipeline() {
+    _stop();
+}
+
+GzipPipeline::Buffer GzipPipeline::submit(Buffer buffer, size_t size, size_t minCapacity) {
+    std::unique_lock<std::mutex> lk(_mutex);
+    _cv.wait(lk, [&] { return _error || _blocks.size() < _maxInFlight; });
+    _rethrowLocked();
+
+    auto block = std::make_shared<Block>();
+    block->input = std::move(buffer);
+    block->size = size;
+    _blocks.push_back(std::move(block));
+    _cv.notify_all();
+
+    auto reusable = std::find_if(_freeBuffers.begin(), _freeBuffers.end(), [&](const auto& free) {
+        return free.capacity >= minCapacity;
+    });
+    if (reusable != _freeBuffers.end()) {
+        auto next = std::move(*reusable);
+        _freeBuffers.erase(reusable);
+        return next;
+    }
+    lk.unlock();
+    return Buffer{std::make_unique<char[]>(minCapacity), minCapacity};
+}
+
+void GzipPipeline::finish() {
+    std::unique_lock<std::mutex> lk(_mutex);
+    _cv.wait(lk, [&] { return _error || _blocks.empty(); });
+    _rethrowLocked();
+}
+
+void GzipPipeline::_compress() {
+    std::unique_ptr<GzipStream> stream;
+    std::unique_lock<std::mutex> lk(_mutex);
+    for (;;) {
+        std::shared_ptr<Block> block;
+        _cv.wait(lk, [&] {
+            auto it = std::find_if(_blocks.begin(), _blocks.end(), [](const auto& b) { return !b->started; });
+            if (it != _blocks.end()) {
+                block = *it;
+                return true;
+            }
+            return _stopping;
+        });
+        if (!block) {
+            return;
+        }
+        block->started = true;
+        // After a failure the rest are only passed along to be dropped.
+        const bool failed = static_cast<bool>(_error);
+        lk.unlock();
+
+        std::string output;
+        std::exception_ptr error;
+        if (!failed) {
+            try {
+                if (!stream) {
+                    stream = std::make_unique<GzipStream>(_level);
+                }
+                output = stream->compress(block->input.data.get(), block->size);
+            } catch(...) {
+                error = std::current_exception();
+            }
+        }
+
+        lk.lock();
+        if (error) {
+            _fail(error);
+        }
+        block->output = std::move(output);
+        block->compressed = true;
+        _freeBuffers.push_back(std::move(block->input));
+        _cv.notify_all();
+    }
+}
+
+void GzipPipeline::_write() {
+    std::unique_lock<std::mutex> lk(_mutex);
+    for (;;) {
+        _cv.wait(lk, [&] { return (!_blocks.empty() && _blocks.front()->compressed) || (_stopping && _blocks.empty()); });
+        if (_blocks.empty()) {
+            return;
+        }
+        auto block = _blocks.front();
+        const bool failed = static_cast<bool>(_error);
+        lk.unlock();
+
+        std::exception_ptr error;
+        size_t written = 0;
+        while (!failed && !error && written < block->output.size()) {
+            auto rc = ::write(_fd, block->output.data() + written, block->output.size() - written);
+            if (rc == -1) {
+                if (errno != EINTR) {
+                    error = std::make_exception_ptr(
+                            std::system_error(errno, std::generic_category(), "error writing output"));
+                }
+                continue;
+            }
+            written += static_cast<size_t>(rc);
+        }
+
+        lk.lock();
+        if (error) {
+            _fail(error);
+        }
+        _blocks.pop_front();
+        _cv.notify_all();
+    }
+}
+
+void GzipPipeline::_fail(std::exception_ptr error) {
+    if (!_error) {
+        _error = std::move(error);
+    }
+}
+
+// Errors stick, since nothing after a lost buffer can be written without corrupting the file.
+void GzipPipeline::_rethrowLocked() {
+    if (_error) {
+        std::rethrow_exception(_error);
+    }
+}
+
+void GzipPipeline::_stop() noexcept {
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _stopping = true;
+    }
+    _cv.notify_all();
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+    _threads.clear();
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "buffered_writer.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sqlplusplus {
+
+// Gzips a stream of buffers into an fd off the caller's thread, the way pigz does: each
+// buffer is compressed on its own by the first free compressor thread into a gzip member
+// of its own, and a writer thread writes the members in order, one after another, which
+// gunzip and zcat read back as one stream. So filling the next buffer, compressing the
+// last few and writing the ones before all overlap. At most a couple of buffers per thread
+// are in flight, after which submit() blocks, so a slow disk or NFS link holds back the
+// fetch rather than letting memory grow.
+//
+// Errors, like a failed write, are rethrown from the next submit() or finish().
+class GzipPipeline {
+public:
+    struct Buffer {
+        std::unique_ptr<char[]> data;
+        size_t capacity = 0;
+    };
+
+    GzipPipeline(int fd, const OutputCompression& compression);
+    GzipPipeline(const GzipPipeline&) = delete;
+    GzipPipeline& operator=(const GzipPipeline&) = delete;
+    // Finishes what's in flight; errors are dropped, so callers that care finish() first.
+    ~GzipPipeline();
+
+    // Queues size bytes of buffer to be compressed and written, and returns an empty
+    // buffer to fill next, one done with earlier if there is one, of at least
+    // minCapacity bytes.
+    Buffer submit(Buffer buffer, size_t size, size_t minCapacity);
+    // Waits until everything submitted is written.
+    void finish();
+
+private:
+    struct Block {
+        Buffer input;
+        size_t size = 0;
+        bool started = false;
+        bool compressed = false;
+        std::string output;
+    };
+
+    void _compress();
+    void _write();
+    void _fail(std::exception_ptr error);
+    void _rethrowLocked();
+    void _stop() noexcept;
+
+    const int _fd;
+    const int _level;
+    const size_t _maxInFlight;
+
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    // In the order they were submitted; the writer pops them off the front.
+    std::deque<std::shared_ptr<Block>> _blocks;
+    std::vector<Buffer> _freeBuffers;
+    std::exception_ptr _error;
+    bool _stopping = false;
+    std::vector<std::thread> _threads;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,160 @@
+#include "connect_string.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace sqlplusplus {
+namespace {
+
+constexpr uint32_t kMinSdu = 512;
+constexpr uint32_t kMaxSdu = 2097152;
+
+std::string lowered(std::string_view text) {
+    std::string result(text);
+    std::transform(result.begin(), result.end(), result.begin(), [](const auto ch) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+    });
+    return result;
+}
+
+bool isSpace(char ch) noexcept {
+    return std::isspace(static_cast<unsigned char>(ch)) != 0;
+}
+
+// Where the value of the first "(name =" in a lowered descriptor starts, or npos.
+size_t descriptorValue(std::string_view descriptor, std::string_view name, size_t from = 0) {
+    for (auto pos = descriptor.find('(', from); pos != std::string_view::npos; pos = descriptor.find('(', pos + 1)) {
+        auto at = pos + 1;
+        while (at < descriptor.size() && isSpace(descriptor[at])) {
+            ++at;
+        }
+        if (descriptor.substr(at, name.size()) != name) {
+            continue;
+        }
+        at += name.size();
+        while (at < descriptor.size() && isSpace(descriptor[at])) {
+            ++at;
+        }
+        if (at < descriptor.size() && descriptor[at] == '=') {
+            return at + 1;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// Whether a lowered Easy Connect query, what follows the ?, has name in it.
+bool hasQueryParameter(std::string_view query, std::string_view name) {
+    for (size_t start = 0; start <= query.size();) {
+        const auto end = std::min(query.find('&', start), query.size());
+        auto parameter = query.substr(start, end - start);
+        parameter = parameter.substr(0, parameter.find('='));
+        while (!parameter.empty() && isSpace(parameter.back())) {
+            parameter.remove_suffix(1);
+        }
+        while (!parameter.empty() && isSpace(parameter.front())) {
+            parameter.remove_prefix(1);
+        }
+        if (parameter == name) {
+            return true;
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+// Lower-case names, as Easy Connect has them; descriptors take them in any case.
+std::vector<std::pair<std::string_view, std::string>> tuningParameters(const NetworkTuning& tuning) {
+    std::vector<std::pair<std::string_view, std::string>> parameters;
+    if (tuning.sdu) {
+        if (*tuning.sdu < kMinSdu || *tuning.sdu > kMaxSdu) {
+            throw std::runtime_error(fmt::format("the SDU has to be from {} to {} bytes", kMinSdu, kMaxSdu));
+        }
+        parameters.emplace_back("sdu", std::to_string(*tuning.sdu));
+    }
+    if (tuning.expireTime) {
+        parameters.emplace_back("expire_time", std::to_string(*tuning.expireTime));
+    }
+    if (tuning.connectTimeout) {
+        parameters.emplace_back("connect_timeout", std::to_string(*tuning.connectTimeout));
+    }
+    if (tuning.transportConnectTimeout) {
+        parameters.emplace_back("transport_connect_timeout", std::to_string(*tuning.transportConnectTimeout));
+    }
+    if (tuning.retryCount) {
+        parameters.emplace_back("retry_count", std::to_string(*tuning.retryCount));
+    }
+    if (tuning.compression) {
+        parameters.emplace_back("compression", "on");
+    }
+    return parameters;
+}
+
+} // namespace
+
+std::string tunedConnectString(std::string_view connString, const NetworkTuning& tuning) {
+    const auto parameters = tuningParameters(tuning);
+    if (parameters.empty()) {
+        return std::string(connString);
+    }
+    const auto lower = lowered(connString);
+    std::string result(connString);
+
+    if (lower.find('(') != std::string::npos) {
+        std::string added;
+        for (const auto& [name, value] : parameters) {
+            if (descriptorValue(lower, name) == std::string::npos) {
+                added += fmt::format("({}={})", name, value);
+            }
+        }
+        // Upper-cased like the rest of a typical descriptor.
+        std::transform(added.begin(), added.end(), added.begin(), [](const auto ch) {
+            return static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+        });
+        if (added.empty()) {
+            return result;
+        }
+        // From the end, so the positions found in lower still hold for result.
+        std::vector<size_t> insertAt;
+        for (auto at = descriptorValue(lower, "description"); at != std::string::npos;
+                at = descriptorValue(lower, "description", at)) {
+            insertAt.push_back(at);
+        }
+        if (insertAt.empty()) {
+            throw std::runtime_error("network settings need a connect descriptor with a DESCRIPTION in it");
+        }
+        for (auto it = insertAt.rbegin(); it != insertAt.rend(); ++it) {
+            result.insert(*it, added);
+        }
+        return result;
+    }
+
+    if (lower.find_first_of(":/") == std::string::npos) {
+        throw std::runtime_error(fmt::format(
+                "network settings need an Easy Connect string or a connect descriptor; \"{}\" looks like a "
+                "tnsnames.ora alias, whose entry they'd have to go in", connString));
+    }
+    const auto queryStart = lower.find('?');
+    const auto query = queryStart == std::string::npos ? std::string_view() : std::string_view(lower).substr(queryStart + 1);
+    char separator = queryStart == std::string::npos ? '?' : '&';
+    if (queryStart != std::string::npos && (query.empty() || query.back() == '&')) {
+        separator = '\0';
+    }
+    for (const auto& [name, value] : parameters) {
+        if (hasQueryParameter(query, name)) {
+            continue;
+        }
+        if (separator != '\0') {
+            result += separator;
+        }
+        result += fmt::format("{}={}", name, value);
+        separator = '&';
+    }
+    return result;
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace sqlplusplus {
+
+// Oracle Net settings carried in the connect string rather than in sqlnet.ora, so they
+// apply to this client's connections alone.
+struct NetworkTuning {
+    // Bytes of session data per network packet, 512 to 2097152. Bigger ones mean fewer
+    // packets, and fewer round trips' worth of waiting, for every fetch over a slow link.
+    std::optional<uint32_t> sdu;
+    // Minutes between the probes that keep an idle connection open through firewalls and
+    // notice a peer that's gone.
+    std::optional<uint32_t> expireTime;
+    // Seconds to connect in, the login included.
+    std::optional<uint32_t> connectTimeout;
+    // Seconds for the TCP connect to each address.
+    std::optional<uint32_t> transportConnectTimeout;
+    // Times the whole address list is tried again before the connect fails.
+    std::optional<uint32_t> retryCount;
+    // Compresses what's sent both ways, when the server allows it too.
+    bool compression = false;
+
+    bool empty() const noexcept {
+        return !sdu && !expireTime && !connectTimeout && !transportConnectTimeout && !retryCount && !compression;
+    }
+};
+
+// connString with tuning's settings added: as Easy Connect Plus parameters, e.g.
+// host:1521/service?sdu=65535&compression=on, or into every DESCRIPTION of a connect
+// descriptor. Whatever connString sets already is left as it is. Throws
+// std::runtime_error for a tnsnames.ora alias, which has nowhere to put them, or for an
+// SDU out of range.
+std::string tunedConnectString(std::string_view connString, const NetworkTuning& tuning);
+
+} // namespace sqlplusplus
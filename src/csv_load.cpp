@@ -0,0 +1,1059 @@
+#include "csv_load.h"
+
+#include "batch_sizer.h"
+#include "checkpoint.h"
+#include "mapped_file.h"
+#include "result_metadata.h"
+#include "typed_bind.h"
+#include "typed_rows.h"
+#include "work_stealing.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace sqlplusplus {
+namespace {
+
+// Bit i is set when data[base + i] ends an unquoted field: a comma, a CR or a LF. Bits
+// past the end of data are set too, so a scan stops there.
+uint64_t fieldEndMask(std::string_view data, size_t base) {
+    const auto size = data.size();
+    uint64_t mask = 0;
+#if defined(__SSE2__)
+    if (base + 64 <= size) {
+        const __m128i comma = _mm_set1_epi8(',');
+        const __m128i cr = _mm_set1_epi8('\r');
+        const __m128i lf = _mm_set1_epi8('\n');
+        for (size_t idx = 0; idx < 64; idx += 16) {
+            const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data.data() + base + idx));
+            auto hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, comma), _mm_cmpeq_epi8(chunk, cr));
+            hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, lf));
+            mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(hits))) << idx;
+        }
+        return mask;
+    }
+#endif
+    for (size_t idx = 0; idx < 64; ++idx) {
+        if (base + idx >= size) {
+            mask |= ~uint64_t{0} << idx;
+            break;
+        }
+        const auto ch = data[base + idx];
+        if (ch == ',' || ch == '\r' || ch == '\n') {
+            mask |= uint64_t{1} << idx;
+        }
+    }
+    return mask;
+}
+
+// Bind buffers start at this many bytes per value and grow as longer values show up.
+constexpr uint32_t kMinValueSize = 64;
+// Longest value a VARCHAR2 bind can carry with extended string sizes.
+constexpr uint32_t kMaxValueSize = 32767;
+
+// How a column's values are bound with CsvLoadOptions::nativeBinds.
+enum class BindType { Text, Int64, Double, Date, Timestamp };
+
+BindType bindTypeFor(const dpiDataTypeInfo& info) {
+    switch (info.oracleTypeNum) {
+    case DPI_ORACLE_TYPE_NUMBER:
+        // The integers ODPI would fetch as int64; anything with a scale stays text, since a
+        // double can't carry every decimal exactly.
+        return info.defaultNativeTypeNum == DPI_NATIVE_TYPE_INT64 ? BindType::Int64 : BindType::Text;
+    case DPI_ORACLE_TYPE_NATIVE_FLOAT:
+    case DPI_ORACLE_TYPE_NATIVE_DOUBLE:
+        return BindType::Double;
+    case DPI_ORACLE_TYPE_DATE:
+        return BindType::Date;
+    case DPI_ORACLE_TYPE_TIMESTAMP:
+        return BindType::Timestamp;
+    default:
+        return BindType::Text;
+    }
+}
+
+// The bind type of each of columns of table, described without a round trip through rows.
+std::vector<BindType> bindTypesFor(OracleConnection& conn, std::string_view table, const std::vector<std::string>& columns) {
+    fmt::memory_buffer sql;
+    fmt::format_to(sql, "SELECT ");
+    for (size_t col = 0; col < columns.size(); ++col) {
+        fmt::format_to(sql, "{}{}", col == 0 ? "" : ", ", columns[col]);
+    }
+    fmt::format_to(sql, " FROM {} WHERE 1 = 0", table);
+    auto stmt = conn.prepareStatement(std::string_view(sql.data(), sql.size()));
+    stmt.describe();
+    const auto metadata = stmt.metadata();
+    std::vector<BindType> types;
+    for (uint32_t pos = 1; pos <= metadata->numColumns(); ++pos) {
+        types.push_back(bindTypeFor(metadata->column(pos).typeInfo));
+    }
+    return types;
+}
+
+bool parseInt64(std::string_view text, int64_t& value) {
+    if (!text.empty() && text.front() == '+') {
+        text.remove_prefix(1);
+        if (!text.empty() && text.front() == '-') {
+            return false;
+        }
+    }
+    const auto res = std::from_chars(text.data(), text.data() + text.size(), value);
+    return !text.empty() && res.ec == std::errc() && res.ptr == text.data() + text.size();
+}
+
+bool parseDouble(std::string_view text, double& value) {
+    if (!text.empty() && text.front() == '+' && text.size() > 1 && text[1] != '-') {
+        text.remove_prefix(1);
+    }
+    // from_chars takes inf and nan, which are the server's to spell, so the sign has to be
+    // followed by a digit or a point.
+    const auto first = text.find_first_not_of('-');
+    if (first > 1 || first == std::string_view::npos ||
+            !(std::isdigit(static_cast<unsigned char>(text[first])) || text[first] == '.')) {
+        return false;
+    }
+    const auto res = std::from_chars(text.data(), text.data() + text.size(), value);
+    return res.ec == std::errc() && res.ptr == text.data() + text.size();
+}
+
+// YYYY-MM-DD, optionally followed by a space or a T and HH24:MI[:SS[.FF]], where FF is up
+// to nine digits. Dates without fractional seconds parse for DATE columns.
+bool parseTimestamp(std::string_view text, bool allowFraction, dpiTimestamp& value) {
+    size_t pos = 0;
+    auto digits = [&](size_t count, uint32_t& out) {
+        if (pos + count > text.size()) {
+            return false;
+        }
+        out = 0;
+        for (size_t idx = 0; idx < count; ++idx) {
+            const auto ch = text[pos + idx];
+            if (ch < '0' || ch > '9') {
+                return false;
+            }
+            out = out * 10 + static_cast<uint32_t>(ch - '0');
+        }
+        pos += count;
+        return true;
+    };
+    auto literal = [&](char ch) {
+        return pos < text.size() && text[pos++] == ch;
+    };
+
+    uint32_t year, month, day, hour = 0, minute = 0, second = 0, fraction = 0;
+    if (!digits(4, year) || !literal('-') || !digits(2, month) || !literal('-') || !digits(2, day)) {
+        return false;
+    }
+    if (pos < text.size()) {
+        if ((text[pos] != ' ' && text[pos] != 'T') || (++pos, !digits(2, hour)) || !literal(':') || !digits(2, minute)) {
+            return false;
+        }
+        if (pos < text.size() && (!literal(':') || !digits(2, second))) {
+            return false;
+        }
+        if (pos < text.size()) {
+            if (!allowFraction || !literal('.')) {
+                return false;
+            }
+            const auto start = pos;
+            while (pos < text.size() && pos - start < 9 && text[pos] >= '0' && text[pos] <= '9') {
+                fraction = fraction * 10 + static_cast<uint32_t>(text[pos++] - '0');
+            }
+            if (pos == start || pos < text.size()) {
+                return false;
+            }
+            for (auto scale = pos - start; scale < 9; ++scale) {
+                fraction *= 10;
+            }
+        }
+    }
+
+    constexpr uint32_t kDaysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    const bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    if (year == 0 || month < 1 || month > 12 || day < 1 ||
+            day > kDaysInMonth[month - 1] + (month == 2 && leap ? 1u : 0u) ||
+            hour > 23 || minute > 59 || second > 59) {
+        return false;
+    }
+    value = dpiTimestamp{};
+    value.year = static_cast<int16_t>(year);
+    value.month = static_cast<uint8_t>(month);
+    value.day = static_cast<uint8_t>(day);
+    value.hour = static_cast<uint8_t>(hour);
+    value.minute = static_cast<uint8_t>(minute);
+    value.second = static_cast<uint8_t>(second);
+    value.fsecond = fraction;
+    return true;
+}
+
+// Sets position row of var, a native array for type, from text, or to null for an empty
+// value as a text bind would be. False when text doesn't convert.
+bool setNative(OracleVariable& var, uint32_t row, BindType type, std::string_view text) {
+    if (text.empty()) {
+        var.setNull(row);
+        return true;
+    }
+    switch (type) {
+    case BindType::Int64: {
+        int64_t value;
+        if (!parseInt64(text, value)) {
+            return false;
+        }
+        var.setFrom(row, value);
+        return true;
+    }
+    case BindType::Double: {
+        double value;
+        if (!parseDouble(text, value)) {
+            return false;
+        }
+        var.setFrom(row, value);
+        return true;
+    }
+    case BindType::Date:
+    case BindType::Timestamp: {
+        dpiTimestamp value;
+        if (!parseTimestamp(text, type == BindType::Timestamp, value)) {
+            return false;
+        }
+        var.setFrom(row, value);
+        return true;
+    }
+    case BindType::Text:
+        break;
+    }
+    return false;
+}
+
+OracleVariable makeNativeArray(OracleConnection& conn, BindType type, uint32_t numRows) {
+    OracleConnection::VariableOpts varopts;
+    switch (type) {
+    case BindType::Int64:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_NUMBER;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_INT64;
+        break;
+    case BindType::Double:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_NATIVE_DOUBLE;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_DOUBLE;
+        break;
+    case BindType::Date:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_DATE;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_TIMESTAMP;
+        break;
+    case BindType::Timestamp:
+    case BindType::Text:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_TIMESTAMP;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_TIMESTAMP;
+        break;
+    }
+    varopts.opts = OracleConnection::VariableOpts::ByteBufferOpts{0, false};
+    varopts.maxArraySize = numRows;
+    return conn.newArrayVariable(varopts);
+}
+
+// One set of bind arrays. Two of these are in flight at a time: one being filled by the
+// parser while the other is being inserted.
+struct Batch {
+    // Per column, the text array, sized for valueSizes, and the native one for columns
+    // with a bind type; usesNative says which this batch's values went into.
+    std::vector<std::optional<OracleVariable>> textVars;
+    std::vector<uint32_t> valueSizes;
+    std::vector<std::optional<OracleVariable>> nativeVars;
+    std::vector<bool> usesNative;
+    std::vector<uint64_t> lines;
+    // The lines again, for BatchHooks::bindLines.
+    std::optional<OracleVariable> lineVar;
+    // Rows the arrays were made for.
+    uint32_t capacity = 0;
+    uint32_t numRows = 0;
+    // Bytes of the batch's values, for the BatchSizer.
+    uint64_t bytes = 0;
+    // Where the record after the batch's last starts.
+    size_t endPos = 0;
+    uint64_t endLine = 0;
+};
+
+// Called on the insert thread after each commit with where the next uncommitted record
+// starts and how many rows have been committed in all.
+using CommitCallback = std::function<void(size_t next, uint64_t nextLine, uint64_t rowsCommitted)>;
+
+struct BatchOutcome {
+    uint32_t numRows = 0;
+    uint64_t bytes = 0;
+    // How long the insert, and the hook after it, took.
+    double seconds = 0;
+    uint64_t rowsLoaded = 0;
+    uint64_t rowsMerged = 0;
+    std::vector<CsvLoadError> errors;
+};
+
+// What loadRecords does with each batch beyond inserting its values.
+struct BatchHooks {
+    // Binds each row's line number after its values.
+    bool bindLines = false;
+    // Runs on the insert thread once a batch is inserted, before any commit; returns how
+    // many rows it merged.
+    std::function<uint64_t()> afterInsert;
+};
+
+OracleVariable makeBindArray(OracleConnection& conn, uint32_t valueSize, uint32_t numRows) {
+    OracleConnection::VariableOpts varopts;
+    varopts.dbTypeNum = DPI_ORACLE_TYPE_VARCHAR;
+    varopts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+    varopts.opts = OracleConnection::VariableOpts::ByteBufferOpts{valueSize, true};
+    varopts.maxArraySize = numRows;
+    return conn.newArrayVariable(varopts);
+}
+
+OracleVariable makeLineArray(OracleConnection& conn, uint32_t numRows) {
+    OracleConnection::VariableOpts varopts;
+    varopts.dbTypeNum = DPI_ORACLE_TYPE_NUMBER;
+    varopts.nativeTypeNum = DPI_NATIVE_TYPE_INT64;
+    varopts.maxArraySize = numRows;
+    return conn.newArrayVariable(varopts);
+}
+
+// "insert into table (columns...) values (:1, ...)", with extraColumn bound last if set.
+std::string insertSql(std::string_view hint,
+                      std::string_view table,
+                      const std::vector<std::string>& columns,
+                      std::string_view extraColumn) {
+    fmt::memory_buffer sqlBuffer;
+    fmt::format_to(sqlBuffer, "insert {}into {} (", hint, table);
+    for (size_t col = 0; col < columns.size(); ++col) {
+        fmt::format_to(sqlBuffer, "{}{}", col == 0 ? "" : ", ", columns[col]);
+    }
+    if (!extraColumn.empty()) {
+        fmt::format_to(sqlBuffer, ", {}", extraColumn);
+    }
+    fmt::format_to(sqlBuffer, ") values (");
+    const auto numBinds = columns.size() + (extraColumn.empty() ? 0 : 1);
+    for (size_t col = 0; col < numBinds; ++col) {
+        fmt::format_to(sqlBuffer, "{}:{}", col == 0 ? "" : ", ", col + 1);
+    }
+    fmt::format_to(sqlBuffer, ")");
+    return std::string(sqlBuffer.data(), sqlBuffer.size());
+}
+
+// Reads the header record that names the target columns.
+std::vector<std::string> readHeader(CsvReader& reader, const std::string& path) {
+    StringArena scratch;
+    std::vector<std::string_view> fields;
+    if (!reader.nextRecord(fields, scratch)) {
+        throw std::runtime_error(fmt::format("{} is empty", path));
+    }
+    std::vector<std::string> columns;
+    for (auto field : fields) {
+        columns.push_back(normalizeIdentifier(field, false));
+    }
+    return columns;
+}
+
+} // namespace
+
+bool CsvReader::nextRecord(std::vector<std::string_view>& fields, StringArena& scratch) {
+    fields.clear();
+    // Skip blank lines between records.
+    while (_pos < _data.size() && (_data[_pos] == '\n' || _data[_pos] == '\r')) {
+        if (_data[_pos] == '\n') {
+            ++_line;
+        }
+        ++_pos;
+    }
+    if (_pos >= _data.size()) {
+        return false;
+    }
+
+    _recordLine = _line;
+    for (;;) {
+        if (_pos < _data.size() && _data[_pos] == '"') {
+            fields.push_back(_readQuoted(scratch));
+        } else {
+            const auto end = _findFieldEnd(_pos);
+            fields.push_back(_data.substr(_pos, end - _pos));
+            _pos = end;
+        }
+
+        if (_pos >= _data.size()) {
+            return true;
+        }
+        switch (_data[_pos]) {
+        case ',':
+            ++_pos;
+            continue;
+        case '\r':
+            ++_pos;
+            if (_pos < _data.size() && _data[_pos] == '\n') {
+                ++_pos;
+            }
+            ++_line;
+            return true;
+        case '\n':
+            ++_pos;
+            ++_line;
+            return true;
+        default:
+            throw std::runtime_error(fmt::format(
+                "unexpected character after quoted field on line {}", _line));
+        }
+    }
+}
+
+size_t CsvReader::_findFieldEnd(size_t pos) {
+    for (;;) {
+        if (pos < _maskBase || pos - _maskBase >= 64) {
+            _maskBase = pos;
+            _mask = fieldEndMask(_data, pos);
+        }
+        if (const auto bits = _mask & (~uint64_t{0} << (pos - _maskBase)); bits != 0) {
+            return std::min(_maskBase + static_cast<size_t>(__builtin_ctzll(bits)), _data.size());
+        }
+        pos = _maskBase + 64;
+    }
+}
+
+std::string_view CsvReader::_readQuoted(StringArena& scratch) {
+    const auto startLine = _line;
+    const auto start = ++_pos;
+    bool hasEscapes = false;
+    size_t end;
+    for (;;) {
+        auto quote = _data.find('"', _pos);
+        if (quote == std::string_view::npos) {
+            throw std::runtime_error(fmt::format(
+                "unterminated quoted field starting on line {}", startLine));
+        }
+        if (quote + 1 < _data.size() && _data[quote + 1] == '"') {
+            hasEscapes = true;
+            _pos = quote + 2;
+            continue;
+        }
+        end = quote;
+        _pos = quote + 1;
+        break;
+    }
+
+    auto value = _data.substr(start, end - start);
+    _line += static_cast<uint64_t>(std::count(value.begin(), value.end(), '\n'));
+    if (!hasEscapes) {
+        return value;
+    }
+
+    auto out = scratch.allocate(value.size());
+    size_t outSize = 0;
+    for (size_t i = 0; i < value.size(); ++i) {
+        out[outSize++] = value[i];
+        if (value[i] == '"') {
+            ++i;
+        }
+    }
+    scratch.shrinkLast(value.size() - outSize);
+    return std::string_view(out, outSize);
+}
+
+namespace {
+
+// Loads every record reader has left, pipelining parse and insert as described on loadCsv.
+// With bindTypes, columns of types the client converts are bound natively, see
+// CsvLoadOptions::nativeBinds; empty binds everything as text.
+CsvLoadResult loadRecords(OracleConnection& conn,
+                          std::string_view sql,
+                          CsvReader& reader,
+                          uint32_t numColumns,
+                          const std::vector<BindType>& bindTypes,
+                          const CsvLoadOptions& opts,
+                          const CommitCallback& onCommit,
+                          const BatchHooks& hooks = {}) {
+    const auto batchSize = std::max<uint32_t>(opts.batchSize, 1);
+    auto stmt = conn.prepareStatement(sql);
+    // Direct-path batches are commits, and keep the size they were given.
+    std::optional<BatchSizer> sizer;
+    if (opts.adaptiveBatchSize && !opts.directPath) {
+        BatchSizer::Options sizerOpts;
+        sizerOpts.initialRows = batchSize;
+        sizerOpts.maxRows = std::max(opts.maxBatchSize, batchSize);
+        sizerOpts.commitRows = opts.commitInterval;
+        sizer.emplace(sizerOpts);
+    }
+
+    CsvLoadResult result;
+    uint64_t rowsSinceCommit = 0;
+    uint64_t rowsUncommitted = 0;
+    uint64_t rowsCommitted = 0;
+
+    // Runs on the insert thread. Only one of these is ever running, so the statement and
+    // the commit counter are never shared.
+    auto insertBatch = [&](Batch& batch) {
+        for (uint32_t col = 0; col < numColumns; ++col) {
+            stmt.bindByPos(col + 1, batch.usesNative[col] ? *batch.nativeVars[col] : *batch.textVars[col]);
+        }
+        if (hooks.bindLines) {
+            stmt.bindByPos(numColumns + 1, *batch.lineVar);
+        }
+        const auto start = std::chrono::steady_clock::now();
+        stmt.executeMany(batch.numRows, static_cast<dpiExecMode>(
+            DPI_MODE_EXEC_BATCH_ERRORS | DPI_MODE_EXEC_ARRAY_DML_ROWCOUNTS));
+
+        BatchOutcome outcome;
+        outcome.numRows = batch.numRows;
+        outcome.bytes = batch.bytes;
+        for (auto count : stmt.rowCounts()) {
+            outcome.rowsLoaded += count;
+        }
+        for (auto& error : stmt.batchErrors()) {
+            outcome.errors.push_back(CsvLoadError{batch.lines.at(error.offset), std::move(error.message)});
+        }
+        if (hooks.afterInsert) {
+            outcome.rowsMerged = hooks.afterInsert();
+        }
+        outcome.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        rowsSinceCommit += batch.numRows;
+        rowsUncommitted += outcome.rowsLoaded;
+        if (opts.directPath || (opts.commitInterval != 0 && rowsSinceCommit >= opts.commitInterval)) {
+            conn.commit();
+            rowsSinceCommit = 0;
+            rowsCommitted += std::exchange(rowsUncommitted, 0);
+            if (onCommit) {
+                onCommit(batch.endPos, batch.endLine, rowsCommitted);
+            }
+        }
+        return outcome;
+    };
+
+    // Each batch is inserted on the I/O executor while the next is parsed.
+    auto& executor = WorkStealingExecutor::sharedIo();
+    auto collect = [&](std::future<BatchOutcome>& inFlight) {
+        auto outcome = executor.wait(inFlight);
+        if (sizer) {
+            sizer->record(outcome.numRows, outcome.bytes, outcome.seconds, outcome.errors.size());
+        }
+        result.rowsLoaded += outcome.rowsLoaded;
+        result.rowsMerged += outcome.rowsMerged;
+        result.rowsRejected += outcome.errors.size();
+        for (auto& error : outcome.errors) {
+            if (result.errors.size() < opts.maxReportedErrors) {
+                result.errors.push_back(std::move(error));
+            }
+        }
+    };
+
+    StringArena scratch;
+    std::vector<std::string_view> fields;
+    Batch batches[2];
+    std::vector<std::string_view> batchValues;
+    batchValues.reserve(static_cast<size_t>(batchSize) * numColumns);
+    std::future<BatchOutcome> inFlight;
+    size_t current = 0;
+
+    try {
+        bool moreInput = true;
+        while (moreInput) {
+            auto& batch = batches[current];
+            batch.numRows = 0;
+            batch.bytes = 0;
+            batch.lines.clear();
+            batchValues.clear();
+            scratch.reset();
+            // The arrays are made again when the sizer wants more rows than they hold; its
+            // last insert was collected before the other batch went, so they're free.
+            const auto batchRows = sizer ? sizer->rows() : batchSize;
+            if (batchRows > batch.capacity) {
+                for (auto& var : batch.textVars) {
+                    var.reset();
+                }
+                for (auto& var : batch.nativeVars) {
+                    var.reset();
+                }
+                batch.lineVar.reset();
+                batch.capacity = batchRows;
+            }
+
+            while (batch.numRows < batchRows) {
+                if (!reader.nextRecord(fields, scratch)) {
+                    moreInput = false;
+                    break;
+                }
+                if (fields.size() != numColumns) {
+                    throw std::runtime_error(fmt::format(
+                        "line {} has {} fields, expected {}", reader.recordLine(), fields.size(), numColumns));
+                }
+                batchValues.insert(batchValues.end(), fields.begin(), fields.end());
+                for (auto field : fields) {
+                    batch.bytes += field.size();
+                }
+                batch.lines.push_back(reader.recordLine());
+                ++batch.numRows;
+            }
+            if (batch.numRows == 0) {
+                break;
+            }
+            batch.endPos = reader.position();
+            batch.endLine = reader.currentLine();
+            result.rowsRead += batch.numRows;
+
+            if (batch.textVars.size() < numColumns) {
+                batch.textVars.resize(numColumns);
+                batch.valueSizes.resize(numColumns, 0);
+                batch.nativeVars.resize(numColumns);
+                batch.usesNative.resize(numColumns, false);
+            }
+            for (uint32_t col = 0; col < numColumns; ++col) {
+                // A column goes natively unless one of the batch's values doesn't convert,
+                // in which case the whole column goes as text for the server to convert.
+                const auto type = col < bindTypes.size() ? bindTypes[col] : BindType::Text;
+                bool native = type != BindType::Text;
+                if (native) {
+                    auto& var = batch.nativeVars[col];
+                    if (!var) {
+                        var = makeNativeArray(conn, type, batch.capacity);
+                    }
+                    for (uint32_t row = 0; row < batch.numRows && native; ++row) {
+                        native = setNative(*var, row, type, batchValues[row * numColumns + col]);
+                    }
+                }
+                batch.usesNative[col] = native;
+                if (native) {
+                    continue;
+                }
+
+                // Size the column's text array for the longest value in this batch,
+                // keeping whatever's already big enough from earlier batches.
+                size_t longest = 0;
+                for (uint32_t row = 0; row < batch.numRows; ++row) {
+                    longest = std::max(longest, batchValues[row * numColumns + col].size());
+                }
+                if (longest > kMaxValueSize) {
+                    throw std::runtime_error(fmt::format(
+                        "a value in column {} is longer than {} bytes", col + 1, kMaxValueSize));
+                }
+                const bool firstUse = !batch.textVars[col];
+                if (firstUse || longest > batch.valueSizes[col]) {
+                    auto size = firstUse ? kMinValueSize : batch.valueSizes[col];
+                    while (size < longest) {
+                        size = std::min(size * 2, kMaxValueSize);
+                    }
+                    batch.textVars[col] = makeBindArray(conn, size, batch.capacity);
+                    batch.valueSizes[col] = size;
+                }
+                for (uint32_t row = 0; row < batch.numRows; ++row) {
+                    batch.textVars[col]->setFrom(row, batchValues[row * numColumns + col]);
+                }
+            }
+            if (hooks.bindLines) {
+                if (!batch.lineVar) {
+                    batch.lineVar = makeLineArray(conn, batch.capacity);
+                }
+                for (uint32_t row = 0; row < batch.numRows; ++row) {
+                    batch.lineVar->setFrom(row, static_cast<int64_t>(batch.lines[row]));
+                }
+            }
+
+            if (inFlight.valid()) {
+                collect(inFlight);
+            }
+            inFlight = executor.submit([&insertBatch, &batch] { return insertBatch(batch); });
+            current ^= 1;
+        }
+        if (inFlight.valid()) {
+            collect(inFlight);
+        }
+    } catch(...) {
+        if (inFlight.valid()) {
+            executor.waitReady(inFlight);
+        }
+        throw;
+    }
+
+    conn.commit();
+    if (onCommit) {
+        onCommit(reader.position(), reader.currentLine(), rowsCommitted + rowsUncommitted);
+    }
+    return result;
+}
+
+struct ByteRange {
+    size_t begin;
+    size_t end;
+    uint64_t firstLine;
+};
+
+// Cuts data[begin, end) into up to numRanges pieces of about equal size, each ending on a
+// record boundary. Newlines inside quoted fields don't end records, so this has to track
+// the quoting from the start; it's one pass looking only at quotes and newlines, which is
+// far cheaper than parsing.
+std::vector<ByteRange> splitOnRecords(std::string_view data, size_t begin, uint64_t firstLine, size_t numRanges) {
+    std::vector<ByteRange> ranges;
+    const auto total = data.size() - begin;
+    const auto target = std::max<size_t>(total / std::max<size_t>(numRanges, 1), 1);
+
+    bool inQuotes = false;
+    uint64_t line = firstLine;
+    size_t rangeBegin = begin;
+    uint64_t rangeLine = firstLine;
+    for (size_t pos = begin; pos < data.size(); ++pos) {
+        const auto ch = data[pos];
+        if (ch == '"') {
+            inQuotes = !inQuotes;
+        } else if (ch == '\n') {
+            ++line;
+            if (!inQuotes && pos + 1 - rangeBegin >= target && ranges.size() + 1 < numRanges) {
+                ranges.push_back(ByteRange{rangeBegin, pos + 1, rangeLine});
+                rangeBegin = pos + 1;
+                rangeLine = line;
+            }
+        }
+    }
+    if (rangeBegin < data.size()) {
+        ranges.push_back(ByteRange{rangeBegin, data.size(), rangeLine});
+    }
+    return ranges;
+}
+
+} // namespace
+
+CsvLoadResult loadCsv(OracleConnection& conn,
+                      const std::function<OracleConnection()>& newConnection,
+                      const std::string& path,
+                      std::string_view tableName,
+                      const CsvLoadOptions& opts) {
+    const auto table = opts.partition.empty()
+        ? normalizeIdentifier(tableName, true)
+        : fmt::format("{} PARTITION (\"{}\")", normalizeIdentifier(tableName, true), opts.partition);
+
+    MappedFile file(path);
+    const auto contents = file.contents();
+    CsvReader headerReader(contents);
+    const auto columns = readHeader(headerReader, path);
+    const auto numColumns = static_cast<uint32_t>(columns.size());
+    const auto sql = insertSql(opts.directPath ? "/*+ APPEND_VALUES */ " : "", table, columns, {});
+    const auto bindTypes = opts.nativeBinds ? bindTypesFor(conn, table, columns) : std::vector<BindType>();
+
+    CsvLoadResult result;
+    LoadCheckpoint checkpoint;
+    // Which of the checkpoint's ranges each range being loaded is; a resumed load skips
+    // the ones that were finished.
+    std::vector<size_t> checkpointRanges;
+    std::vector<ByteRange> ranges;
+    if (!opts.checkpointPath.empty()) {
+        auto saved = readLoadCheckpoint(opts.checkpointPath);
+        if (saved && !opts.resume) {
+            throw std::runtime_error(fmt::format(
+                    "{} is left from an interrupted load of {}; resume it or remove the checkpoint",
+                    opts.checkpointPath, path));
+        }
+        if (!saved && opts.resume) {
+            throw std::runtime_error(fmt::format("there's no checkpoint at {} to resume from", opts.checkpointPath));
+        }
+        if (saved) {
+            if (saved->table != table || saved->fileSize != contents.size()) {
+                throw std::runtime_error(fmt::format(
+                        "{} is from a load of a {} byte file into {}, not this one", opts.checkpointPath,
+                        saved->fileSize, saved->table));
+            }
+            checkpoint = std::move(*saved);
+            for (size_t idx = 0; idx < checkpoint.ranges.size(); ++idx) {
+                const auto& range = checkpoint.ranges[idx];
+                result.rowsResumed += range.rowsLoaded;
+                if (range.next < range.end) {
+                    ranges.push_back(ByteRange{range.next, range.end, range.nextLine});
+                    checkpointRanges.push_back(idx);
+                }
+            }
+        }
+    }
+    if (!opts.resume) {
+        const bool lockedTable = opts.directPath && opts.partition.empty();
+        ranges = splitOnRecords(contents, headerReader.position(), headerReader.currentLine(),
+                                lockedTable ? 1 : std::max<uint32_t>(opts.parallelism, 1));
+        checkpoint.table = table;
+        checkpoint.fileSize = contents.size();
+        for (size_t idx = 0; idx < ranges.size(); ++idx) {
+            const auto& range = ranges[idx];
+            checkpoint.ranges.push_back({range.begin, range.end, range.begin, range.firstLine, 0});
+            checkpointRanges.push_back(idx);
+        }
+    }
+
+    const bool checkpointing = !opts.checkpointPath.empty()
+        && (opts.commitInterval != 0 || opts.directPath || opts.resume);
+    std::mutex checkpointMutex;
+    if (checkpointing && !opts.resume) {
+        writeCheckpoint(opts.checkpointPath, checkpoint);
+    }
+    auto onCommit = [&](size_t idx) -> CommitCallback {
+        if (!checkpointing) {
+            return {};
+        }
+        const auto rowsBefore = checkpoint.ranges[checkpointRanges[idx]].rowsLoaded;
+        return [&, idx, rowsBefore](size_t next, uint64_t nextLine, uint64_t rowsCommitted) {
+            std::lock_guard<std::mutex> lk(checkpointMutex);
+            auto& range = checkpoint.ranges[checkpointRanges[idx]];
+            range.next = next;
+            range.nextLine = nextLine;
+            range.rowsLoaded = rowsBefore + rowsCommitted;
+            writeCheckpoint(opts.checkpointPath, checkpoint);
+        };
+    };
+
+    // Each range gets its own connection, statement and bind arrays; the first one runs
+    // on the caller's connection.
+    auto loadRange = [&](size_t idx, OracleConnection& rangeConn) {
+        const auto& range = ranges[idx];
+        CsvReader reader(contents.substr(0, range.end), range.begin, range.firstLine);
+        const auto start = std::chrono::steady_clock::now();
+        auto result = loadRecords(rangeConn, sql, reader, numColumns, bindTypes, opts, onCommit(idx));
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        result.workers.push_back(CsvWorkerStats{
+            result.rowsLoaded, range.end - range.begin, elapsed.count()});
+        return result;
+    };
+
+    // A worker each, so every range gets a session; the biggest start first when there
+    // are more of them than the I/O budget has threads for.
+    std::vector<uint64_t> sizes;
+    sizes.reserve(ranges.size());
+    for (const auto& range : ranges) {
+        sizes.push_back(range.end - range.begin);
+    }
+    std::vector<std::optional<CsvLoadResult>> parts(ranges.size());
+    std::exception_ptr firstError;
+    try {
+        runLongestFirst(sizes, static_cast<uint32_t>(ranges.size()), [&](uint32_t, size_t idx) {
+            if (idx == 0) {
+                parts[idx] = loadRange(idx, conn);
+                return;
+            }
+            auto workerConn = newConnection();
+            parts[idx] = loadRange(idx, workerConn);
+        });
+    } catch(...) {
+        firstError = std::current_exception();
+    }
+
+    for (auto& part : parts) {
+        if (!part) {
+            continue;
+        }
+        result.rowsRead += part->rowsRead;
+        result.rowsLoaded += part->rowsLoaded;
+        result.rowsRejected += part->rowsRejected;
+        for (auto& error : part->errors) {
+            result.errors.push_back(std::move(error));
+        }
+        for (auto& worker : part->workers) {
+            result.workers.push_back(worker);
+        }
+    }
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+    if (checkpointing) {
+        removeCheckpoint(opts.checkpointPath);
+    }
+
+    std::sort(result.errors.begin(), result.errors.end(), [](const auto& a, const auto& b) {
+        return a.line < b.line;
+    });
+    if (result.errors.size() > opts.maxReportedErrors) {
+        result.errors.resize(opts.maxReportedErrors);
+    }
+    return result;
+}
+
+CsvLoadResult upsertCsv(OracleConnection& conn,
+                        const std::string& path,
+                        std::string_view tableName,
+                        const std::vector<std::string>& keyColumns,
+                        const CsvLoadOptions& opts) {
+    constexpr auto kLineColumn = std::string_view("SQLPP_LINE");
+    const auto table = normalizeIdentifier(tableName, true);
+
+    MappedFile file(path);
+    const auto contents = file.contents();
+    CsvReader reader(contents);
+    const auto columns = readHeader(reader, path);
+    std::vector<std::string> keys;
+    for (const auto& key : keyColumns) {
+        keys.push_back(normalizeIdentifier(key, false));
+        if (std::find(columns.begin(), columns.end(), keys.back()) == columns.end()) {
+            throw std::runtime_error(fmt::format("key column {} isn't in {}", keys.back(), path));
+        }
+    }
+    if (keys.empty()) {
+        throw std::runtime_error("an upsert needs at least one key column");
+    }
+
+    // The staging table is named for the session, so others upserting at the same time
+    // each get their own definition. One left by a session that died with the same SID is
+    // dropped first.
+    std::string staging;
+    {
+        auto stmt = conn.prepareStatement("SELECT SYS_CONTEXT('USERENV', 'SID') FROM dual");
+        stmt.execute();
+        forEachRow<std::string_view>(stmt, [&](std::string_view sid) {
+            staging = fmt::format("SQLPP_UPSERT_{}", sid);
+        });
+    }
+    conn.prepareStatement(fmt::format(R"(
+BEGIN
+    EXECUTE IMMEDIATE 'DROP TABLE {} PURGE';
+EXCEPTION
+    WHEN OTHERS THEN
+        IF SQLCODE != -942 THEN
+            RAISE;
+        END IF;
+END;)", staging)).execute();
+
+    fmt::memory_buffer columnList;
+    for (size_t col = 0; col < columns.size(); ++col) {
+        fmt::format_to(columnList, "{}{}", col == 0 ? "" : ", ", columns[col]);
+    }
+    const auto columnNames = std::string(columnList.data(), columnList.size());
+    conn.prepareStatement(fmt::format(
+            "CREATE GLOBAL TEMPORARY TABLE {} ON COMMIT DELETE ROWS AS "
+            "SELECT {}, CAST(NULL AS NUMBER) AS {} FROM {} WHERE 1 = 0",
+            staging, columnNames, kLineColumn, table)).execute();
+
+    // Only the last row for a key in each batch is merged, since MERGE won't update a
+    // row twice; later batches are merged after earlier ones, so the last row in the
+    // file wins.
+    fmt::memory_buffer mergeBuffer;
+    fmt::format_to(mergeBuffer, "MERGE INTO {} t USING (SELECT {} FROM (SELECT s.*, ROW_NUMBER() OVER (PARTITION BY ",
+            table, columnNames);
+    for (size_t idx = 0; idx < keys.size(); ++idx) {
+        fmt::format_to(mergeBuffer, "{}{}", idx == 0 ? "" : ", ", keys[idx]);
+    }
+    fmt::format_to(mergeBuffer, " ORDER BY {} DESC) AS sqlpp_rank FROM {} s) WHERE sqlpp_rank = 1) s ON (",
+            kLineColumn, staging);
+    for (size_t idx = 0; idx < keys.size(); ++idx) {
+        fmt::format_to(mergeBuffer, "{}t.{} = s.{}", idx == 0 ? "" : " AND ", keys[idx], keys[idx]);
+    }
+    fmt::format_to(mergeBuffer, ")");
+    bool firstUpdate = true;
+    for (const auto& column : columns) {
+        if (std::find(keys.begin(), keys.end(), column) != keys.end()) {
+            continue;
+        }
+        fmt::format_to(mergeBuffer, "{}t.{} = s.{}",
+                firstUpdate ? " WHEN MATCHED THEN UPDATE SET " : ", ", column, column);
+        firstUpdate = false;
+    }
+    fmt::format_to(mergeBuffer, " WHEN NOT MATCHED THEN INSERT ({}) VALUES (", columnNames);
+    for (size_t col = 0; col < columns.size(); ++col) {
+        fmt::format_to(mergeBuffer, "{}s.{}", col == 0 ? "" : ", ", columns[col]);
+    }
+    fmt::format_to(mergeBuffer, ")");
+
+    auto mergeStmt = conn.prepareStatement(std::string_view(mergeBuffer.data(), mergeBuffer.size()));
+    auto clearStmt = conn.prepareStatement(fmt::format("DELETE FROM {}", staging));
+    BatchHooks hooks;
+    hooks.bindLines = true;
+    hooks.afterInsert = [&] {
+        mergeStmt.execute();
+        const auto merged = mergeStmt.rowCount();
+        clearStmt.execute();
+        return merged;
+    };
+
+    auto loadOpts = opts;
+    loadOpts.directPath = false;
+    const auto bindTypes = opts.nativeBinds ? bindTypesFor(conn, table, columns) : std::vector<BindType>();
+    // If this throws the staging table is left, since it can't be dropped while the failed
+    // transaction holds it; the next upsert on this session drops it instead.
+    auto result = loadRecords(conn, insertSql("", staging, columns, kLineColumn), reader,
+                              static_cast<uint32_t>(columns.size()), bindTypes, loadOpts, {}, hooks);
+    conn.prepareStatement(fmt::format("DROP TABLE {} PURGE", staging)).execute();
+    return result;
+}
+
+NologgingScope::NologgingScope(OracleConnection& conn, std::string_view tableName) :
+    _conn(conn),
+    _table(normalizeIdentifier(tableName, true))
+{
+    const auto [owner, name] = splitOwner(_table);
+    auto stmt = conn.prepareStatement(R"(
+SELECT logging, partitioned
+  FROM all_tables
+ WHERE owner = NVL(:1, SYS_CONTEXT('USERENV', 'CURRENT_SCHEMA'))
+   AND table_name = :2)");
+    bind(stmt, owner, name);
+    stmt.execute();
+    std::optional<std::string> logging;
+    std::optional<std::string> partitioned;
+    forEachRow<std::optional<std::string_view>, std::string_view>(stmt,
+            [&](std::optional<std::string_view> tableLogging, std::string_view tablePartitioned) {
+        logging = tableLogging ? std::optional<std::string>(*tableLogging) : std::nullopt;
+        partitioned = std::string(tablePartitioned);
+    });
+    if (!partitioned) {
+        throw std::runtime_error(fmt::format("there's no table {}", _table));
+    }
+    if (*partitioned == "YES") {
+        throw std::runtime_error(fmt::format(
+                "{} is partitioned; set NOLOGGING on the partitions being loaded instead", _table));
+    }
+    if (logging == std::optional<std::string>("YES")) {
+        conn.prepareStatement(fmt::format("ALTER TABLE {} NOLOGGING", _table)).execute();
+        _changed = true;
+    }
+}
+
+NologgingScope::~NologgingScope() {
+    try {
+        restore();
+    } catch(const std::exception&) {
+    }
+}
+
+void NologgingScope::restore() {
+    if (_changed) {
+        _changed = false;
+        _conn.prepareStatement(fmt::format("ALTER TABLE {} LOGGING", _table)).execute();
+    }
+}
+
+std::vector<CsvLoadResult> loadCsvPartitions(const std::function<OracleConnection()>& newConnection,
+                                             std::string_view tableName,
+                                             const std::vector<CsvPartitionFile>& files,
+                                             const CsvLoadOptions& opts) {
+    std::vector<uint64_t> sizes;
+    sizes.reserve(files.size());
+    for (const auto& file : files) {
+        sizes.push_back(std::filesystem::file_size(file.path));
+    }
+
+    const auto numWorkers = std::max<uint32_t>(opts.parallelism, 1);
+    std::vector<std::optional<OracleConnection>> connections(numWorkers);
+    std::vector<CsvLoadResult> results(files.size());
+    runLongestFirst(sizes, numWorkers, [&](uint32_t worker, size_t idx) {
+        auto& conn = connections[worker];
+        if (!conn) {
+            conn = newConnection();
+        }
+        auto fileOpts = opts;
+        fileOpts.parallelism = 1;
+        fileOpts.checkpointPath.clear();
+        fileOpts.resume = false;
+        fileOpts.partition = files[idx].partition;
+        results[idx] = loadCsv(*conn, newConnection, files[idx].path, tableName, fileOpts);
+    });
+    return results;
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "arena.h"
+#include "oracle_helpers.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+// Splits RFC 4180 style CSV into records. Fields are views into the input except quoted
+// fields with doubled quotes, which are unescaped into a caller-provided arena. Blank
+// lines are skipped. Throws std::runtime_error on malformed quoting.
+//
+// Unquoted fields are found through a bitmap of where the commas and line ends are in
+// the next 64 bytes, built 16 bytes at a time with SSE2 where it's there, so the fields
+// of a line share one scan rather than each searching on its own.
+class CsvReader {
+public:
+    explicit CsvReader(std::string_view data) : _data(data) {}
+    // Reads data starting at a record boundary at offset begin, which is on firstLine.
+    CsvReader(std::string_view data, size_t begin, uint64_t firstLine)
+        : _data(data), _pos(begin), _line(firstLine) {}
+
+    // Reads the next record into fields. Returns false at the end of the input.
+    bool nextRecord(std::vector<std::string_view>& fields, StringArena& scratch);
+
+    // One-based line the last record returned by nextRecord() started on.
+    uint64_t recordLine() const noexcept {
+        return _recordLine;
+    }
+    // Offset and line of the next unread record.
+    size_t position() const noexcept {
+        return _pos;
+    }
+    uint64_t currentLine() const noexcept {
+        return _line;
+    }
+
+private:
+    std::string_view _readQuoted(StringArena& scratch);
+    // Offset of the comma or line end that ends the unquoted field at pos, or _data.size().
+    size_t _findFieldEnd(size_t pos);
+
+    std::string_view _data;
+    size_t _pos = 0;
+    uint64_t _line = 1;
+    uint64_t _recordLine = 0;
+    // The field end bitmap for the 64 bytes from _maskBase; it's empty to start with.
+    size_t _maskBase = std::string_view::npos;
+    uint64_t _mask = 0;
+};
+
+struct CsvLoadOptions {
+    // Rows sent per executeMany round trip.
+    uint32_t batchSize = 1000;
+    // Commit after at least this many rows; 0 commits once at the end.
+    uint64_t commitInterval = 0;
+    // Rejected rows beyond this many are counted but not kept in the result.
+    size_t maxReportedErrors = 20;
+    // Number of connections loading disjoint parts of the file at once.
+    uint32_t parallelism = 1;
+    // Inserts through a PARTITION (name) extended name when set, so only rows that belong
+    // in that partition of the table go in; the server rejects the rest.
+    std::string partition;
+    // Where to record, after every commit, how far each range has got, so a load cut off
+    // part way can carry on after its last commit; empty keeps no checkpoint. Only a load
+    // with a commit interval commits before the end. A load that finishes removes it.
+    std::string checkpointPath;
+    // Carries on from the checkpoint at checkpointPath instead of starting over, with the
+    // parallelism it was started with. Without it, a checkpoint that's there is an error,
+    // since loading the file again would insert its committed rows twice.
+    bool resume = false;
+    // Inserts with the APPEND_VALUES hint, so each batch is written as new blocks above the
+    // high water mark instead of through the buffer cache. The server won't let a
+    // transaction touch a table again once it's direct-path inserted into it, so every
+    // batch is committed as it's inserted and the commit interval doesn't apply; batches
+    // want to be large, since each one starts on fresh blocks. Such an insert also locks
+    // the whole table, or just the partition with a partition set, so a load of the whole
+    // table runs on one connection whatever the parallelism.
+    bool directPath = false;
+    // Binds the values of integer NUMBER, BINARY_FLOAT, BINARY_DOUBLE, DATE and TIMESTAMP
+    // columns as numbers and timestamps converted on the client, instead of as text for
+    // the server to convert. Dates and timestamps have to be YYYY-MM-DD, optionally
+    // followed by HH24:MI[:SS[.FF]] after a space or a T. When a value in a batch doesn't
+    // convert, its column goes as text for that batch, so the server's conversion and NLS
+    // settings still apply to it.
+    bool nativeBinds = true;
+    // Lets a BatchSizer pick each batch's rows, starting from batchSize and growing up to
+    // maxBatchSize, from how long batches take and how many rows they reject, instead of
+    // sending batchSize rows every time. Direct-path loads keep their batch size.
+    bool adaptiveBatchSize = false;
+    uint32_t maxBatchSize = 100000;
+};
+
+struct CsvLoadError {
+    uint64_t line;
+    std::string message;
+};
+
+struct CsvWorkerStats {
+    uint64_t rowsLoaded;
+    uint64_t bytes;
+    double seconds;
+};
+
+struct CsvLoadResult {
+    // Committed by the interrupted load this one resumed.
+    uint64_t rowsResumed = 0;
+    uint64_t rowsRead = 0;
+    uint64_t rowsLoaded = 0;
+    // For upsertCsv(), rows of the table that were inserted or updated.
+    uint64_t rowsMerged = 0;
+    uint64_t rowsRejected = 0;
+    std::vector<CsvLoadError> errors;
+    std::vector<CsvWorkerStats> workers;
+};
+
+// Inserts the rows of a CSV file into tableName. The first record names the target columns.
+// Parsing and inserting are pipelined: while one batch of bind arrays is being inserted
+// with executeMany on the I/O executor, the next batch is parsed into a second set, so the
+// parse, network and server time overlap rather than add up. Rows the server rejects are
+// reported through the result instead of stopping the load. Anything else, like a read or
+// parse error, throws; rows already committed by the commit interval stay committed.
+//
+// With opts.parallelism above one the records after the header are split into that many
+// byte ranges ending on record boundaries. The first range loads on conn and each of the
+// others on its own connection from newConnection, in its own transaction.
+CsvLoadResult loadCsv(OracleConnection& conn,
+                      const std::function<OracleConnection()>& newConnection,
+                      const std::string& path,
+                      std::string_view tableName,
+                      const CsvLoadOptions& opts);
+
+// Inserts or updates the rows of a CSV file in tableName by keyColumns, which must be
+// among the columns the header names. Each batch is array inserted into a global temporary
+// table shaped like those columns of tableName, then merged into tableName with one MERGE
+// and cleared; so rows reach the table in batches rather than one MERGE per row. Rows in a
+// batch with the same key are merged last one first, so the last row for a key in the file
+// is what the table ends up with. The loading runs on conn alone to keep that order, with
+// opts' batch size, commit interval and error limit. Rows that can't be staged, like
+// values that don't convert, are rejected as with loadCsv(); a MERGE that fails, like on a
+// constraint, throws. Creating and dropping the staging table commit.
+CsvLoadResult upsertCsv(OracleConnection& conn,
+                        const std::string& path,
+                        std::string_view tableName,
+                        const std::vector<std::string>& keyColumns,
+                        const CsvLoadOptions& opts);
+
+// Switches a table that generates redo to NOLOGGING for as long as it's alive and back to
+// LOGGING after, so direct-path loads into it skip the redo for the rows they write, which
+// leaves them unrecoverable from the archive logs until the next backup. Tables that are
+// NOLOGGING already are left alone. A database or tablespace in FORCE LOGGING mode logs
+// regardless. Altering a table commits; throws std::runtime_error for a partitioned one,
+// whose partitions each have their own setting.
+class NologgingScope {
+public:
+    NologgingScope(OracleConnection& conn, std::string_view tableName);
+    NologgingScope(const NologgingScope&) = delete;
+    NologgingScope& operator=(const NologgingScope&) = delete;
+    // Restores logging if restore() wasn't called, ignoring errors.
+    ~NologgingScope();
+
+    // Whether the table was switched, and so will be switched back.
+    bool changed() const noexcept {
+        return _changed;
+    }
+    // Switches the table back to LOGGING if this switched it off.
+    void restore();
+
+private:
+    OracleConnection& _conn;
+    std::string _table;
+    bool _changed = false;
+};
+
+struct CsvPartitionFile {
+    std::string partition;
+    std::string path;
+};
+
+// Loads each file into its partition of tableName, on up to opts.parallelism connections
+// from newConnection that take the biggest files first and steal from each other when
+// they run out, see runLongestFirst(); each file is loaded on one connection and commits
+// on its own. Results come back in the order of files, each with one worker entry. If a
+// file fails the first error is rethrown once the files being loaded are done, and files
+// that hadn't started are left alone.
+std::vector<CsvLoadResult> loadCsvPartitions(const std::function<OracleConnection()>& newConnection,
+                                             std::string_view tableName,
+                                             const std::vector<CsvPartitionFile>& files,
+                                             const CsvLoadOptions& opts);
+
+} // namespace sqlplusplus
@@ -0,0 +1,389 @@
+#include "data_compare.h"
+
+#include "result_metadata.h"
+#include "typed_rows.h"
+#include "value_format.h"
+#include "work_stealing.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <exception>
+#include <future>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace sqlplusplus {
+namespace {
+
+constexpr size_t kNumBuckets = 64;
+// Longest list of chunks the drill-down queries name in an IN list; with more differing
+// than this every row is compared instead.
+constexpr size_t kMaxChunkList = 1000;
+// Ends each value in keys and hashes, so ("ab", "c") and ("a", "bc") don't run together.
+constexpr char kSeparator = '\x1f';
+// Starts each key value, telling a null from a value that reads "<null>".
+constexpr char kNullTag = '\0';
+constexpr char kValueTag = '\1';
+
+constexpr uint64_t kFnvOffset = 14695981039346656037ull;
+constexpr uint64_t kFnvPrime = 1099511628211ull;
+
+uint64_t fnv1a(uint64_t hash, std::string_view bytes) noexcept {
+    for (auto ch : bytes) {
+        hash = (hash ^ static_cast<unsigned char>(ch)) * kFnvPrime;
+    }
+    return hash;
+}
+
+bool equalsIgnoringCase(std::string_view a, std::string_view b) noexcept {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::toupper(static_cast<unsigned char>(x)) == std::toupper(static_cast<unsigned char>(y));
+    });
+}
+
+// The key's values as a mismatch reports them.
+std::string displayKey(std::string_view key) {
+    std::string out;
+    while (!key.empty()) {
+        const auto end = std::min(key.find(kSeparator), key.size());
+        if (!out.empty()) {
+            out += ", ";
+        }
+        if (key.front() == kNullTag) {
+            out += ColumnFormatter::kNullText;
+        } else {
+            out += key.substr(1, end - 1);
+        }
+        key.remove_prefix(std::min(end + 1, key.size()));
+    }
+    return out;
+}
+
+struct RowDigest {
+    std::string key;
+    uint64_t digest;
+};
+
+// Where the two sides' rows meet. Each side adds its rows a block at a time; a row whose
+// key is waiting from the other side is compared and dropped, any other waits for it.
+class RowMatcher {
+public:
+    explicit RowMatcher(size_t maxReported) : _maxReported(maxReported) {}
+
+    void add(uint8_t side, std::vector<RowDigest>& rows) {
+        std::array<std::vector<RowDigest*>, kNumBuckets> byBucket;
+        for (auto& row : rows) {
+            byBucket[std::hash<std::string>{}(row.key) % kNumBuckets].push_back(&row);
+        }
+        for (size_t idx = 0; idx < kNumBuckets; ++idx) {
+            if (byBucket[idx].empty()) {
+                continue;
+            }
+            auto& bucket = _buckets[idx];
+            std::lock_guard<std::mutex> lk(bucket.mutex);
+            for (auto* row : byBucket[idx]) {
+                auto it = bucket.rows.find(row->key);
+                if (it == bucket.rows.end()) {
+                    bucket.rows.emplace(std::move(row->key), Entry{row->digest, side});
+                } else if (it->second.side == side) {
+                    ++_duplicateKeys;
+                } else {
+                    if (it->second.digest == row->digest) {
+                        ++_matched;
+                    } else {
+                        ++_different;
+                        _report(CompareDiff::Different, it->first);
+                    }
+                    bucket.rows.erase(it);
+                }
+            }
+        }
+    }
+
+    // Counts whatever's still waiting as only on its side into result, after both sides are done.
+    void finish(CompareResult& result) {
+        for (auto& bucket : _buckets) {
+            for (const auto& [key, entry] : bucket.rows) {
+                const auto kind = entry.side == 0 ? CompareDiff::OnlyInA : CompareDiff::OnlyInB;
+                ++(entry.side == 0 ? result.onlyInA : result.onlyInB);
+                _report(kind, key);
+            }
+            bucket.rows.clear();
+        }
+        result.matched += _matched;
+        result.different += _different;
+        result.duplicateKeys += _duplicateKeys;
+        for (auto& mismatch : _mismatches) {
+            result.mismatches.push_back(std::move(mismatch));
+        }
+        _mismatches.clear();
+    }
+
+private:
+    struct Entry {
+        uint64_t digest;
+        uint8_t side;
+    };
+    struct Bucket {
+        std::mutex mutex;
+        std::unordered_map<std::string, Entry> rows;
+    };
+
+    void _report(CompareDiff kind, std::string_view key) {
+        std::lock_guard<std::mutex> lk(_mismatchMutex);
+        if (_mismatches.size() < _maxReported) {
+            _mismatches.push_back({kind, displayKey(key)});
+        }
+    }
+
+    const size_t _maxReported;
+    std::array<Bucket, kNumBuckets> _buckets;
+    std::atomic<uint64_t> _matched{0};
+    std::atomic<uint64_t> _different{0};
+    std::atomic<uint64_t> _duplicateKeys{0};
+    std::mutex _mismatchMutex;
+    std::vector<CompareMismatch> _mismatches;
+};
+
+// One side's query, described, with its columns in the order both sides hash them in.
+struct CompareSide {
+    OracleConnection conn;
+    std::string sql;
+    std::vector<std::string> names;
+    // 1-based positions of the key columns, then of the rest in the other side's order.
+    std::vector<uint32_t> keyPositions;
+    std::vector<uint32_t> valuePositions;
+};
+
+std::vector<std::string> describeColumns(OracleConnection& conn, const std::string& sql) {
+    auto stmt = conn.prepareStatement(sql);
+    stmt.describe();
+    return stmt.metadata()->names();
+}
+
+// The side's rows as text for ORA_HASH, each value ended by the separator.
+std::string concatenation(const CompareSide& side, const std::vector<uint32_t>& positions) {
+    std::string expr;
+    for (auto pos : positions) {
+        fmt::format_to(std::back_inserter(expr), "{}\"{}\" || CHR(31)", expr.empty() ? "" : " || ",
+                       side.names[pos - 1]);
+    }
+    return expr;
+}
+
+std::string chunkExpr(const CompareSide& side, uint32_t chunks) {
+    return fmt::format("MOD(ORA_HASH({}), {})", concatenation(side, side.keyPositions), chunks);
+}
+
+struct ChunkSummary {
+    uint64_t rows;
+    std::string hashSum;
+};
+
+std::map<uint64_t, ChunkSummary> summarizeChunks(CompareSide& side, uint32_t chunks) {
+    const auto values = side.valuePositions.empty() ? side.keyPositions : side.valuePositions;
+    const auto sql = fmt::format(
+            "SELECT TO_CHAR({0}), TO_CHAR(COUNT(*)), TO_CHAR(SUM(ORA_HASH({1}))) FROM ({2}) GROUP BY {0}",
+            chunkExpr(side, chunks), concatenation(side, values), side.sql);
+    auto stmt = side.conn.prepareStatement(sql);
+    stmt.execute();
+    std::map<uint64_t, ChunkSummary> summary;
+    forEachRow<std::string_view, std::string_view, std::string_view>(stmt,
+            [&](std::string_view chunk, std::string_view rows, std::string_view hashSum) {
+        summary[std::stoull(std::string(chunk))] = ChunkSummary{std::stoull(std::string(rows)), std::string(hashSum)};
+    });
+    return summary;
+}
+
+uint64_t scanSide(CompareSide& side, uint8_t sideIdx, RowMatcher& matcher, const CompareOptions& opts) {
+    auto stmt = side.conn.prepareStatement(side.sql);
+    if (opts.setUpStatement) {
+        opts.setUpStatement(stmt);
+    }
+    stmt.execute();
+    auto formatters = makeColumnFormatters(stmt);
+    fmt::memory_buffer text;
+    std::vector<RowDigest> rows;
+    uint64_t numRows = 0;
+    for (;;) {
+        auto block = stmt.fetchBlock(stmt.fetchArraySize());
+        for (uint32_t col = 1; col <= block.numColumns(); ++col) {
+            auto& formatter = formatters[col - 1];
+            if (formatter.nativeType() != block.nativeType(col)) {
+                formatter = ColumnFormatter(block.nativeType(col), formatter.oracleType());
+            }
+        }
+        rows.clear();
+        for (uint32_t row = 0; row < block.numRows(); ++row) {
+            RowDigest digest;
+            for (auto pos : side.keyPositions) {
+                const auto& data = block.columnData(pos)[row];
+                if (data.isNull) {
+                    digest.key += kNullTag;
+                } else {
+                    text.clear();
+                    formatters[pos - 1].format(data, text);
+                    digest.key += kValueTag;
+                    digest.key.append(text.data(), text.size());
+                }
+                digest.key += kSeparator;
+            }
+            digest.digest = kFnvOffset;
+            for (auto pos : side.valuePositions) {
+                const auto& data = block.columnData(pos)[row];
+                text.clear();
+                if (!data.isNull) {
+                    text.push_back(kValueTag);
+                    formatters[pos - 1].format(data, text);
+                }
+                text.push_back(kSeparator);
+                digest.digest = fnv1a(digest.digest, std::string_view(text.data(), text.size()));
+            }
+            rows.push_back(std::move(digest));
+        }
+        numRows += block.numRows();
+        matcher.add(sideIdx, rows);
+        if (!block.moreRows()) {
+            break;
+        }
+    }
+    return numRows;
+}
+
+// Runs fn on both sides at once, rethrowing the first error once both are done.
+template <typename Fn>
+auto onBothSides(CompareSide& a, CompareSide& b, const Fn& fn) {
+    auto& executor = WorkStealingExecutor::sharedIo();
+    auto other = executor.submit([&] { return fn(b, uint8_t{1}); });
+    std::exception_ptr error;
+    std::optional<decltype(fn(a, uint8_t{0}))> first;
+    try {
+        first = fn(a, uint8_t{0});
+    } catch(...) {
+        error = std::current_exception();
+    }
+    try {
+        auto second = executor.wait(other);
+        if (!error) {
+            return std::make_pair(std::move(*first), std::move(second));
+        }
+    } catch(...) {
+        if (!error) {
+            error = std::current_exception();
+        }
+    }
+    std::rethrow_exception(error);
+}
+
+} // namespace
+
+CompareResult compareQueries(const std::function<OracleConnection()>& connectA,
+                             const std::string& sqlA,
+                             const std::function<OracleConnection()>& connectB,
+                             const std::string& sqlB,
+                             const CompareOptions& opts) {
+    if (opts.keyColumns.empty()) {
+        throw std::runtime_error("a comparison needs at least one key column");
+    }
+    // Both connect at once; the second connection is waited for even if the first fails,
+    // since its task refers to connectB.
+    auto& executor = WorkStealingExecutor::sharedIo();
+    auto connB = executor.submit([&connectB] { return connectB(); });
+    std::optional<OracleConnection> connA;
+    try {
+        connA.emplace(connectA());
+    } catch(...) {
+        try {
+            executor.wait(connB);
+        } catch(...) {
+            // The first side's error is the one to report.
+        }
+        throw;
+    }
+    CompareSide a{std::move(*connA), sqlA, {}, {}, {}};
+    CompareSide b{executor.wait(connB), sqlB, {}, {}, {}};
+    a.names = describeColumns(a.conn, a.sql);
+    b.names = describeColumns(b.conn, b.sql);
+    if (a.names.size() != b.names.size()) {
+        throw std::runtime_error(fmt::format(
+                "the first query returns {} columns and the second {}", a.names.size(), b.names.size()));
+    }
+
+    auto position = [](const CompareSide& side, std::string_view name, std::string_view which) {
+        auto it = std::find_if(side.names.begin(), side.names.end(), [&](const auto& candidate) {
+            return equalsIgnoringCase(candidate, name);
+        });
+        if (it == side.names.end()) {
+            throw std::runtime_error(fmt::format("the {} query has no column {}", which, name));
+        }
+        return static_cast<uint32_t>(it - side.names.begin() + 1);
+    };
+    for (const auto& key : opts.keyColumns) {
+        a.keyPositions.push_back(position(a, key, "first"));
+        b.keyPositions.push_back(position(b, key, "second"));
+    }
+    for (uint32_t pos = 1; pos <= a.names.size(); ++pos) {
+        if (std::find(a.keyPositions.begin(), a.keyPositions.end(), pos) == a.keyPositions.end()) {
+            a.valuePositions.push_back(pos);
+            b.valuePositions.push_back(position(b, a.names[pos - 1], "second"));
+        }
+    }
+
+    CompareResult result;
+    if (opts.chunks > 0) {
+        auto [chunksA, chunksB] = onBothSides(a, b, [&](CompareSide& side, uint8_t) {
+            return summarizeChunks(side, opts.chunks);
+        });
+        std::vector<uint64_t> differing;
+        for (const auto& [chunk, summary] : chunksA) {
+            auto other = chunksB.find(chunk);
+            if (other != chunksB.end() && other->second.rows == summary.rows
+                    && other->second.hashSum == summary.hashSum) {
+                result.rowsA += summary.rows;
+                result.rowsB += summary.rows;
+                result.matched += summary.rows;
+            } else {
+                differing.push_back(chunk);
+            }
+        }
+        for (const auto& [chunk, summary] : chunksB) {
+            if (chunksA.find(chunk) == chunksA.end()) {
+                differing.push_back(chunk);
+            }
+        }
+        result.chunksCompared = static_cast<uint32_t>(differing.size());
+        if (differing.empty()) {
+            return result;
+        }
+        if (differing.size() > kMaxChunkList) {
+            result = CompareResult();
+            result.chunksCompared = opts.chunks;
+        } else {
+            std::sort(differing.begin(), differing.end());
+            for (auto* side : {&a, &b}) {
+                side->sql = fmt::format("SELECT * FROM ({}) WHERE {} IN ({})", side->sql,
+                                        chunkExpr(*side, opts.chunks), fmt::join(differing, ", "));
+            }
+        }
+    }
+
+    RowMatcher matcher(opts.maxReported);
+    const auto [rowsA, rowsB] = onBothSides(a, b, [&](CompareSide& side, uint8_t sideIdx) {
+        return scanSide(side, sideIdx, matcher, opts);
+    });
+    result.rowsA += rowsA;
+    result.rowsB += rowsB;
+    matcher.finish(result);
+    return result;
+}
+
+} // namespace sqlplusplus
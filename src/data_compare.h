@@ -0,0 +1,69 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sqlplusplus {
+
+struct CompareOptions {
+    // Columns of both queries that identify a row; the rest are compared.
+    std::vector<std::string> keyColumns;
+    // With chunks set, each side first sums ORA_HASH over its rows in that many chunks by
+    // key on the server, and only the rows of chunks whose counts or sums differ are
+    // fetched and compared. 0 compares every row.
+    uint32_t chunks = 0;
+    // Mismatches beyond this many are counted but not kept in the result.
+    size_t maxReported = 20;
+    // Called on each query before it's executed, e.g. to size its fetches.
+    std::function<void(OracleStatement&)> setUpStatement;
+};
+
+enum class CompareDiff {
+    OnlyInA,
+    OnlyInB,
+    Different,
+};
+
+struct CompareMismatch {
+    CompareDiff kind;
+    // The key's values, separated by commas.
+    std::string key;
+};
+
+struct CompareResult {
+    uint64_t rowsA = 0;
+    uint64_t rowsB = 0;
+    uint64_t matched = 0;
+    uint64_t onlyInA = 0;
+    uint64_t onlyInB = 0;
+    uint64_t different = 0;
+    // Rows whose key a row from the same side already had; only the first is compared.
+    uint64_t duplicateKeys = 0;
+    // With chunks, the ones whose rows were fetched and compared.
+    uint32_t chunksCompared = 0;
+    std::vector<CompareMismatch> mismatches;
+};
+
+// Compares the rows of query sqlA on a connection from connectA with those of sqlB on one
+// from connectB, matched up by key. Both queries are fetched at once, on the I/O executor,
+// and each row is reduced to its key and a 64-bit hash of the rest of its values,
+// which go into buckets by key hash; a row whose key the other side has already sent is
+// checked off and forgotten, so memory holds the rows one side is ahead by plus the
+// mismatches, rather than either side whole. Values are compared by their text as the
+// table shows them, so only LOBs' previews are compared.
+//
+// Both queries have to return the same column names, in any order; throws
+// std::runtime_error when they don't or a key column is missing. With opts.chunks, values
+// are turned into text on the server by each session's NLS settings to be hashed, so both
+// sides need the same ones, and a row's values have to fit in a VARCHAR2 together.
+CompareResult compareQueries(const std::function<OracleConnection()>& connectA,
+                             const std::string& sqlA,
+                             const std::function<OracleConnection()>& connectB,
+                             const std::string& sqlB,
+                             const CompareOptions& opts);
+
+} // namespace sqlplusplus
@@ -0,0 +1,580 @@
+#include "data_generator.h"
+
+#include "session_executor.h"
+#include "typed_bind.h"
+#include "typed_rows.h"
+#include "work_stealing.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <future>
+#include <map>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+namespace sqlplusplus {
+namespace {
+
+// Strings without a key are at most this long, so they don't dominate the bound bytes.
+constexpr uint32_t kMaxRandomLength = 32;
+// Dates and timestamps are spread over this many seconds before the run starts.
+constexpr int64_t kTimeSpanSeconds = 10 * 366 * 86400;
+
+enum class ValueKind { Int64, Double, Text, Raw, Date, Timestamp, TimestampTz };
+
+// Where a column's values come from.
+enum class ValueSource { Random, Sequence, ForeignKey };
+
+struct GeneratedColumn {
+    std::string name;
+    ValueKind kind = ValueKind::Text;
+    ValueSource source = ValueSource::Random;
+    bool nullable = true;
+    // Longest value: characters for text, bytes for raws.
+    uint32_t maxLength = 0;
+    // Random integers are in [0, intRange); decimals are those over 10^scale.
+    int64_t intRange = 0;
+    int32_t scale = 0;
+    // First value of a numeric sequence.
+    int64_t sequenceStart = 0;
+    // A foreign key's parent values, as text.
+    std::vector<std::string> pool;
+    uint32_t bufferSize = 0;
+};
+
+// xoshiro256**: a few cycles a value, which matters when it's most of what a row costs.
+class Xoshiro256 {
+public:
+    explicit Xoshiro256(uint64_t seed) noexcept {
+        for (auto& word : _state) {
+            // splitmix64, so nearby seeds still start far apart.
+            seed += 0x9e3779b97f4a7c15ULL;
+            auto z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next() noexcept {
+        const auto result = rotl(_state[1] * 5, 7) * 9;
+        const auto t = _state[1] << 17;
+        _state[2] ^= _state[0];
+        _state[3] ^= _state[1];
+        _state[1] ^= _state[2];
+        _state[0] ^= _state[3];
+        _state[2] ^= t;
+        _state[3] = rotl(_state[3], 45);
+        return result;
+    }
+
+    // Uniform in [0, 1).
+    double unit() noexcept {
+        return static_cast<double>(next() >> 11) * 0x1.0p-53;
+    }
+
+    // Uniform in [0, n), for n > 0.
+    uint64_t below(uint64_t n) noexcept {
+        return static_cast<uint64_t>(unit() * static_cast<double>(n)) % n;
+    }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) noexcept {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    std::array<uint64_t, 4> _state;
+};
+
+struct WorkerResult {
+    uint64_t rowsInserted = 0;
+    uint64_t rowsRejected = 0;
+    std::string firstError;
+};
+
+struct GenerateBatch {
+    std::vector<std::optional<OracleVariable>> vars;
+    uint32_t numRows = 0;
+};
+
+OracleVariable makeArray(OracleConnection& conn, const GeneratedColumn& column, uint32_t numRows) {
+    OracleConnection::VariableOpts varopts;
+    varopts.opts = OracleConnection::VariableOpts::ByteBufferOpts{0, false};
+    // Foreign keys are bound as the text their parents were read as, whatever the type.
+    const auto kind = column.source == ValueSource::ForeignKey ? ValueKind::Text : column.kind;
+    switch (kind) {
+    case ValueKind::Int64:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_NUMBER;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_INT64;
+        break;
+    case ValueKind::Double:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_NATIVE_DOUBLE;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_DOUBLE;
+        break;
+    case ValueKind::Text:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_VARCHAR;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+        varopts.opts = OracleConnection::VariableOpts::ByteBufferOpts{column.bufferSize, true};
+        break;
+    case ValueKind::Raw:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_RAW;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+        varopts.opts = OracleConnection::VariableOpts::ByteBufferOpts{column.bufferSize, false};
+        break;
+    case ValueKind::Date:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_DATE;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_TIMESTAMP;
+        break;
+    case ValueKind::Timestamp:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_TIMESTAMP;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_TIMESTAMP;
+        break;
+    case ValueKind::TimestampTz:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_TIMESTAMP_TZ;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_TIMESTAMP;
+        break;
+    }
+    varopts.maxArraySize = numRows;
+    return conn.newArrayVariable(varopts);
+}
+
+// The kind of value a column's data type takes, or nothing for ones that can't be generated.
+std::optional<ValueKind> kindFor(std::string_view dataType, int64_t scale) {
+    if (dataType == "NUMBER") {
+        return scale > 0 ? ValueKind::Double : ValueKind::Int64;
+    }
+    if (dataType == "FLOAT" || dataType == "BINARY_FLOAT" || dataType == "BINARY_DOUBLE") {
+        return ValueKind::Double;
+    }
+    if (dataType == "VARCHAR2" || dataType == "NVARCHAR2" || dataType == "CHAR" || dataType == "NCHAR") {
+        return ValueKind::Text;
+    }
+    if (dataType == "RAW") {
+        return ValueKind::Raw;
+    }
+    if (dataType == "DATE") {
+        return ValueKind::Date;
+    }
+    if (dataType.rfind("TIMESTAMP", 0) == 0) {
+        // TIMESTAMP(n), TIMESTAMP(n) WITH TIME ZONE and WITH LOCAL TIME ZONE.
+        return dataType.find("TIME ZONE") == std::string_view::npos ? ValueKind::Timestamp : ValueKind::TimestampTz;
+    }
+    return std::nullopt;
+}
+
+int64_t powerOfTen(int64_t exponent) {
+    int64_t value = 1;
+    for (int64_t idx = 0; idx < exponent; ++idx) {
+        value *= 10;
+    }
+    return value;
+}
+
+// The columns of table to generate, with the sources its single column keys give them.
+std::vector<GeneratedColumn> describeColumns(OracleConnection& conn, const std::string& table,
+                                             const GenerateOptions& opts) {
+    const auto [owner, name] = splitOwner(table);
+    auto stmt = conn.prepareStatement(R"(
+SELECT column_name, data_type, CAST(data_length AS NUMBER(10)), CAST(NVL(char_length, 0) AS NUMBER(10)),
+       CAST(NVL(data_precision, -1) AS NUMBER(10)), CAST(NVL(data_scale, -1) AS NUMBER(10)),
+       nullable, virtual_column, identity_column
+  FROM all_tab_cols
+ WHERE owner = NVL(:1, SYS_CONTEXT('USERENV', 'CURRENT_SCHEMA'))
+   AND table_name = :2
+   AND hidden_column = 'NO'
+ ORDER BY column_id)");
+    bind(stmt, owner, name);
+    stmt.execute();
+    std::vector<GeneratedColumn> columns;
+    bool anyColumns = false;
+    forEachRow<std::string_view, std::string_view, int64_t, int64_t, int64_t, int64_t,
+               std::string_view, std::string_view, std::string_view>(stmt,
+            [&](std::string_view columnName, std::string_view dataType, int64_t dataLength, int64_t charLength,
+                int64_t precision, int64_t scale, std::string_view nullable, std::string_view isVirtual,
+                std::string_view isIdentity) {
+        anyColumns = true;
+        if (isVirtual == "YES" || isIdentity == "YES") {
+            return;
+        }
+        const auto kind = kindFor(dataType, scale);
+        if (!kind) {
+            if (nullable != "Y") {
+                throw std::runtime_error(fmt::format("can't generate values for NOT NULL column {} of type {}",
+                        columnName, dataType));
+            }
+            return;
+        }
+        GeneratedColumn column;
+        column.name = std::string(columnName);
+        column.kind = *kind;
+        column.nullable = nullable == "Y";
+        column.scale = static_cast<int32_t>(std::max<int64_t>(scale, 0));
+        if (dataType != "NUMBER") {
+            // Floats: a billion values to three places.
+            column.intRange = powerOfTen(9);
+            column.scale = 3;
+        } else {
+            // Unconstrained numbers get a billion values, others as many as fit, within
+            // the digits an int64 or a double carries exactly.
+            const auto digits = precision < 0 ? 9 : std::max<int64_t>(precision - column.scale, 0) + column.scale;
+            column.intRange = powerOfTen(std::min<int64_t>(digits, column.kind == ValueKind::Int64 ? 18 : 15));
+        }
+        const auto length = static_cast<uint32_t>(std::max<int64_t>(charLength > 0 ? charLength : dataLength, 1));
+        column.maxLength = length;
+        column.bufferSize = static_cast<uint32_t>(std::max<int64_t>(dataLength, 1));
+        columns.push_back(std::move(column));
+    });
+    if (!anyColumns) {
+        throw std::runtime_error(fmt::format("there's no table {}", table));
+    }
+
+    stmt = conn.prepareStatement(R"(
+SELECT cc.column_name, c.constraint_type, pc.owner, pc.table_name, pc.column_name
+  FROM all_constraints c
+  JOIN all_cons_columns cc ON cc.owner = c.owner AND cc.constraint_name = c.constraint_name
+  LEFT JOIN all_cons_columns pc ON pc.owner = c.r_owner AND pc.constraint_name = c.r_constraint_name
+ WHERE c.owner = NVL(:1, SYS_CONTEXT('USERENV', 'CURRENT_SCHEMA'))
+   AND c.table_name = :2
+   AND c.constraint_type IN ('P', 'U', 'R')
+   AND (SELECT COUNT(*) FROM all_cons_columns x
+         WHERE x.owner = c.owner AND x.constraint_name = c.constraint_name) = 1)");
+    bind(stmt, owner, name);
+    stmt.execute();
+    struct Parent {
+        std::string table;
+        std::string column;
+    };
+    std::map<std::string, Parent> parents;
+    forEachRow<std::string_view, std::string_view, std::optional<std::string_view>,
+               std::optional<std::string_view>, std::optional<std::string_view>>(stmt,
+            [&](std::string_view columnName, std::string_view type, std::optional<std::string_view> parentOwner,
+                std::optional<std::string_view> parentTable, std::optional<std::string_view> parentColumn) {
+        for (auto& column : columns) {
+            if (column.name != columnName) {
+                continue;
+            }
+            if (type == "R" && parentOwner && parentTable && parentColumn) {
+                // A column that's a key and references another is generated as the reference.
+                column.source = ValueSource::ForeignKey;
+                parents[column.name] = Parent{fmt::format("\"{}\".\"{}\"", *parentOwner, *parentTable),
+                                              std::string(*parentColumn)};
+            } else if (type != "R" && column.source == ValueSource::Random) {
+                column.source = ValueSource::Sequence;
+            }
+        }
+    });
+
+    for (auto& column : columns) {
+        if (column.source == ValueSource::ForeignKey) {
+            const auto& parent = parents.at(column.name);
+            auto pool = conn.prepareStatement(fmt::format(
+                    "SELECT TO_CHAR(\"{0}\") FROM {1} WHERE \"{0}\" IS NOT NULL AND ROWNUM <= :1",
+                    parent.column, parent.table));
+            bind(pool, static_cast<int64_t>(opts.foreignKeyPoolSize));
+            pool.execute();
+            uint32_t longest = 1;
+            forEachRow<std::string_view>(pool, [&](std::string_view value) {
+                column.pool.emplace_back(value);
+                longest = std::max(longest, static_cast<uint32_t>(value.size()));
+            });
+            if (column.pool.empty() && !column.nullable) {
+                throw std::runtime_error(fmt::format(
+                        "{} references {}, which has no rows to take its values from", column.name, parent.table));
+            }
+            column.bufferSize = longest;
+        } else if (column.source == ValueSource::Sequence
+                   && (column.kind == ValueKind::Int64 || column.kind == ValueKind::Double)) {
+            auto max = conn.prepareStatement(fmt::format(
+                    "SELECT CAST(NVL(MAX(\"{}\"), -1) + 1 AS NUMBER(18)) FROM {}", column.name, table));
+            max.execute();
+            forEachRow<int64_t>(max, [&](int64_t start) {
+                column.sequenceStart = std::max<int64_t>(start, 0);
+            });
+        }
+    }
+    // An empty pool leaves a nullable foreign key out, so it's null in every row.
+    columns.erase(std::remove_if(columns.begin(), columns.end(), [](const GeneratedColumn& column) {
+        return column.source == ValueSource::ForeignKey && column.pool.empty();
+    }), columns.end());
+    if (columns.empty()) {
+        throw std::runtime_error(fmt::format("{} has no columns values can be generated for", table));
+    }
+    return columns;
+}
+
+// Fills row of column's array for the row'th row of the run.
+class ValueGenerator {
+public:
+    ValueGenerator(uint64_t seed, const GenerateOptions& opts, std::string runTag, int64_t now) :
+        _random(seed),
+        _nullShare(std::min(opts.nullPercent, 100u) / 100.0),
+        _skew(opts.skew > 0 ? opts.skew : 1),
+        _runTag(std::move(runTag)),
+        _now(now)
+    {}
+
+    void fill(const GeneratedColumn& column, OracleVariable& var, uint32_t pos, uint64_t rowNumber) {
+        if (column.source == ValueSource::Random && column.nullable && _nullShare > 0 && _random.unit() < _nullShare) {
+            var.setNull(pos);
+            return;
+        }
+        if (column.source == ValueSource::ForeignKey) {
+            var.setFrom(pos, std::string_view(column.pool[pick(column.pool.size())]));
+            return;
+        }
+        const bool sequence = column.source == ValueSource::Sequence;
+        switch (column.kind) {
+        case ValueKind::Int64: {
+            const auto value = sequence
+                ? column.sequenceStart + static_cast<int64_t>(rowNumber)
+                : static_cast<int64_t>(pick(static_cast<uint64_t>(column.intRange)));
+            var.setFrom(pos, value);
+            break;
+        }
+        case ValueKind::Double: {
+            const auto value = sequence
+                ? static_cast<double>(column.sequenceStart + static_cast<int64_t>(rowNumber))
+                : static_cast<double>(pick(static_cast<uint64_t>(column.intRange))) / std::pow(10.0, column.scale);
+            var.setFrom(pos, value);
+            break;
+        }
+        case ValueKind::Text: {
+            if (sequence) {
+                // The run tag keeps this run's keys apart from earlier ones'; a column too
+                // short for it gets just the row number.
+                auto key = fmt::format("{}{}", _runTag, rowNumber);
+                if (key.size() > column.maxLength) {
+                    key = fmt::format("{}", rowNumber);
+                }
+                var.setFrom(pos, std::string_view(key));
+                break;
+            }
+            const auto length = 1 + _random.below(std::min(column.maxLength, kMaxRandomLength));
+            _text.resize(length);
+            for (auto& ch : _text) {
+                static constexpr char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+                ch = kAlphabet[_random.below(sizeof(kAlphabet) - 1)];
+            }
+            var.setFrom(pos, std::string_view(_text));
+            break;
+        }
+        case ValueKind::Raw: {
+            const auto length = sequence ? std::min<uint32_t>(column.maxLength, 8)
+                                         : 1 + _random.below(std::min(column.maxLength, kMaxRandomLength));
+            _text.resize(length);
+            auto bits = sequence ? rowNumber : _random.next();
+            for (size_t idx = 0; idx < _text.size(); ++idx) {
+                if (!sequence && idx % 8 == 0 && idx != 0) {
+                    bits = _random.next();
+                }
+                _text[_text.size() - 1 - idx] = static_cast<char>(bits & 0xff);
+                bits >>= 8;
+            }
+            var.setFrom(pos, std::string_view(_text));
+            break;
+        }
+        case ValueKind::Date:
+        case ValueKind::Timestamp:
+        case ValueKind::TimestampTz: {
+            // More skew piles the values up on the most recent; sequences count back a
+            // second a row.
+            const auto secondsBack = sequence
+                ? static_cast<int64_t>(rowNumber)
+                : static_cast<int64_t>(pick(kTimeSpanSeconds));
+            auto value = utcTimestamp(std::chrono::system_clock::time_point(std::chrono::seconds(_now - secondsBack)));
+            if (column.kind == ValueKind::Date || sequence) {
+                value.fsecond = 0;
+            } else {
+                value.fsecond = static_cast<uint32_t>(_random.below(1000000)) * 1000;
+            }
+            var.setFrom(pos, value);
+            break;
+        }
+        }
+    }
+
+private:
+    // An index into n values, skewed towards the first with a skew above 1.
+    uint64_t pick(uint64_t n) noexcept {
+        const auto u = _random.unit();
+        const auto skewed = _skew == 1 ? u : std::pow(u, _skew);
+        return std::min(static_cast<uint64_t>(skewed * static_cast<double>(n)), n - 1);
+    }
+
+    Xoshiro256 _random;
+    double _nullShare;
+    double _skew;
+    std::string _runTag;
+    int64_t _now;
+    std::string _text;
+};
+
+WorkerResult generateRange(OracleConnection& conn,
+                           const std::vector<GeneratedColumn>& columns,
+                           const std::string& sql,
+                           uint64_t firstRow,
+                           uint64_t endRow,
+                           ValueGenerator& generator,
+                           const GenerateOptions& opts) {
+    const auto batchSize = std::max<uint32_t>(opts.batchSize, 1);
+    auto stmt = conn.prepareStatement(sql);
+    WorkerResult result;
+    uint64_t rowsSinceCommit = 0;
+    // Runs on the executor; one batch at a time, so the statement is never shared.
+    auto insertBatch = [&](GenerateBatch& batch) {
+        for (size_t col = 0; col < columns.size(); ++col) {
+            stmt.bindByPos(static_cast<uint32_t>(col + 1), *batch.vars[col]);
+        }
+        stmt.executeMany(batch.numRows, DPI_MODE_EXEC_BATCH_ERRORS);
+        WorkerResult outcome;
+        auto errors = stmt.batchErrors();
+        outcome.rowsRejected = errors.size();
+        outcome.rowsInserted = batch.numRows - errors.size();
+        if (!errors.empty()) {
+            outcome.firstError = std::move(errors.front().message);
+        }
+        rowsSinceCommit += batch.numRows;
+        if (opts.commitInterval != 0 && rowsSinceCommit >= opts.commitInterval) {
+            conn.commit();
+            rowsSinceCommit = 0;
+        }
+        return outcome;
+    };
+    auto collect = [&](std::future<WorkerResult>& inFlight) {
+        auto outcome = inFlight.get();
+        result.rowsInserted += outcome.rowsInserted;
+        result.rowsRejected += outcome.rowsRejected;
+        if (result.firstError.empty()) {
+            result.firstError = std::move(outcome.firstError);
+        }
+    };
+
+    std::array<GenerateBatch, 2> batches;
+    for (auto& batch : batches) {
+        for (const auto& column : columns) {
+            batch.vars.push_back(makeArray(conn, column, batchSize));
+        }
+    }
+    std::array<std::future<WorkerResult>, 2> inFlight;
+    size_t current = 0;
+    // Declared after everything its tasks touch, so it's done with them before they go.
+    SessionExecutor executor;
+    try {
+        for (auto row = firstRow; row < endRow;) {
+            auto& batch = batches[current];
+            // The batch that last used this set has to be done with it first.
+            if (inFlight[current].valid()) {
+                collect(inFlight[current]);
+            }
+            batch.numRows = static_cast<uint32_t>(std::min<uint64_t>(batchSize, endRow - row));
+            for (uint32_t pos = 0; pos < batch.numRows; ++pos, ++row) {
+                for (size_t col = 0; col < columns.size(); ++col) {
+                    generator.fill(columns[col], *batch.vars[col], pos, row);
+                }
+            }
+            inFlight[current] = executor.submit([&insertBatch, &batch] { return insertBatch(batch); });
+            current ^= 1;
+        }
+        for (auto& pending : inFlight) {
+            if (pending.valid()) {
+                collect(pending);
+            }
+        }
+    } catch (...) {
+        for (auto& pending : inFlight) {
+            if (pending.valid()) {
+                pending.wait();
+            }
+        }
+        throw;
+    }
+    conn.commit();
+    return result;
+}
+
+} // namespace
+
+GenerateResult generateRows(OracleConnection& conn,
+                            const std::function<OracleConnection()>& newConnection,
+                            std::string_view tableName,
+                            const GenerateOptions& opts) {
+    const auto table = normalizeIdentifier(tableName, true);
+    const auto start = std::chrono::steady_clock::now();
+    const auto columns = describeColumns(conn, table, opts);
+
+    fmt::memory_buffer sql;
+    fmt::format_to(sql, "INSERT INTO {} (", table);
+    for (size_t col = 0; col < columns.size(); ++col) {
+        fmt::format_to(sql, "{}\"{}\"", col == 0 ? "" : ", ", columns[col].name);
+    }
+    fmt::format_to(sql, ") VALUES (");
+    for (size_t col = 0; col < columns.size(); ++col) {
+        fmt::format_to(sql, "{}:{}", col == 0 ? "" : ", ", col + 1);
+    }
+    fmt::format_to(sql, ")");
+    const std::string insert(sql.data(), sql.size());
+
+    const auto seed = opts.seed != 0 ? opts.seed : std::random_device()() ^ static_cast<uint64_t>(
+        std::chrono::system_clock::now().time_since_epoch().count());
+    const auto now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    const auto runTag = fmt::format("{:x}-", seed & 0xffffff);
+
+    // Each worker takes a contiguous share of the row numbers, so sequences don't overlap.
+    const auto numWorkers = static_cast<uint64_t>(std::max<uint32_t>(opts.parallelism, 1));
+    const auto share = (opts.rows + numWorkers - 1) / numWorkers;
+    auto runWorker = [&](uint64_t idx, OracleConnection& workerConn) {
+        ValueGenerator generator(seed + idx, opts, runTag, now);
+        const auto firstRow = std::min(opts.rows, idx * share);
+        const auto endRow = std::min(opts.rows, firstRow + share);
+        return generateRange(workerConn, columns, insert, firstRow, endRow, generator, opts);
+    };
+
+    auto& executor = WorkStealingExecutor::sharedIo();
+    std::vector<std::future<WorkerResult>> workers;
+    for (uint64_t idx = 1; idx < numWorkers && idx * share < opts.rows; ++idx) {
+        workers.push_back(executor.submit(executor.newAffinity(), [&, idx] {
+            auto workerConn = newConnection();
+            return runWorker(idx, workerConn);
+        }));
+    }
+
+    GenerateResult result;
+    std::exception_ptr firstError;
+    auto merge = [&](WorkerResult part) {
+        result.rowsInserted += part.rowsInserted;
+        result.rowsRejected += part.rowsRejected;
+        if (result.firstError.empty()) {
+            result.firstError = std::move(part.firstError);
+        }
+    };
+    try {
+        merge(runWorker(0, conn));
+    } catch(...) {
+        firstError = std::current_exception();
+    }
+    for (auto& worker : workers) {
+        try {
+            merge(executor.wait(worker));
+        } catch(...) {
+            if (!firstError) {
+                firstError = std::current_exception();
+            }
+        }
+    }
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    result.seconds = elapsed.count();
+    return result;
+}
+
+} // namespace sqlplusplus
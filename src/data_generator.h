@@ -0,0 +1,58 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace sqlplusplus {
+
+struct GenerateOptions {
+    uint64_t rows = 0;
+    // Connections inserting a share of the rows each at once.
+    uint32_t parallelism = 1;
+    // Rows per executeMany.
+    uint32_t batchSize = 1000;
+    // Each connection commits after at least this many rows; 0 commits once at the end.
+    uint64_t commitInterval = 0;
+    // Percent of a nullable column's values that are null.
+    uint32_t nullPercent = 0;
+    // How values are drawn from a range or a foreign key pool of n: floor(n * u^skew) for
+    // a uniform u, so 1 is uniform and more piles the picks up on the first values.
+    double skew = 1;
+    // Seeds the generators, so the same seed generates the same rows; 0 takes one from
+    // the clock.
+    uint64_t seed = 0;
+    // Most parent keys read into a foreign key column's pool.
+    uint32_t foreignKeyPoolSize = 100000;
+};
+
+struct GenerateResult {
+    uint64_t rowsInserted = 0;
+    uint64_t rowsRejected = 0;
+    // The first rejected row's error, when there were any.
+    std::string firstError;
+    double seconds = 0;
+};
+
+// Inserts opts.rows rows of synthetic values into tableName, generated from its columns'
+// types straight into bind arrays with a fast PRNG, and array inserted a batch at a time
+// with the next batch generated while one is inserted. Values fit their columns: numbers
+// within their precision and scale, strings and raws within their lengths, dates and
+// timestamps over the last ten years. Columns of a single column primary or unique key
+// count up from the largest number already there, or carry a run tag and the row number
+// for strings; single column foreign keys pick from the parent's keys. Nullable columns
+// of types that can't be generated, like LOBs, are left out, and identity and virtual
+// columns are left to the server; a NOT NULL column that can't be generated throws.
+//
+// The rows are split between opts.parallelism connections, the first on conn and the
+// others from newConnection, each in its own transaction. Rows the server rejects, like
+// ones a check constraint stops, are counted rather than stopping the run.
+GenerateResult generateRows(OracleConnection& conn,
+                            const std::function<OracleConnection()>& newConnection,
+                            std::string_view tableName,
+                            const GenerateOptions& opts);
+
+} // namespace sqlplusplus
@@ -0,0 +1,256 @@
+#include "datetime_format.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+
+namespace sqlplusplus {
+namespace {
+
+constexpr std::array<char, 200> makeDigitPairs() {
+    std::array<char, 200> pairs{};
+    for (int value = 0; value < 100; ++value) {
+        pairs[value * 2] = static_cast<char>('0' + value / 10);
+        pairs[value * 2 + 1] = static_cast<char>('0' + value % 10);
+    }
+    return pairs;
+}
+
+constexpr auto kDigitPairs = makeDigitPairs();
+
+constexpr std::string_view kMonthNames = "JANFEBMARAPRMAYJUNJULAUGSEPOCTNOVDEC";
+
+// Values are trusted to be in range: ODPI hands them out already validated.
+char* write2(char* out, unsigned value) noexcept {
+    const auto pair = kDigitPairs.data() + (value % 100) * 2;
+    out[0] = pair[0];
+    out[1] = pair[1];
+    return out + 2;
+}
+
+char* write4(char* out, unsigned value) noexcept {
+    return write2(write2(out, value / 100), value % 100);
+}
+
+// The leading digits of a nanosecond count, always nine of them to begin with.
+char* writeFraction(char* out, uint32_t nanoseconds, uint8_t digits) noexcept {
+    char all[9];
+    write2(all + 7, nanoseconds % 100);
+    nanoseconds /= 100;
+    write2(all + 5, nanoseconds % 100);
+    nanoseconds /= 100;
+    write2(all + 3, nanoseconds % 100);
+    nanoseconds /= 100;
+    write2(all + 1, nanoseconds % 100);
+    all[0] = static_cast<char>('0' + nanoseconds / 100 % 10);
+    return std::copy(all, all + digits, out);
+}
+
+bool startsWith(std::string_view text, std::string_view prefix) noexcept {
+    if (text.size() < prefix.size()) {
+        return false;
+    }
+    for (size_t idx = 0; idx < prefix.size(); ++idx) {
+        if (std::toupper(static_cast<unsigned char>(text[idx])) != prefix[idx]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+DateTimeMask& maskSlot(DateTimeKind kind) noexcept {
+    static DateTimeMask date("YYYY-MM-DD HH24:MI:SS");
+    static DateTimeMask timestamp("YYYY-MM-DD HH24:MI:SS.FF6");
+    static DateTimeMask timestampTz("YYYY-MM-DD HH24:MI:SS.FF6 TZH:TZM");
+    switch (kind) {
+    case DateTimeKind::Date:
+        return date;
+    case DateTimeKind::Timestamp:
+        return timestamp;
+    default:
+        return timestampTz;
+    }
+}
+
+} // namespace
+
+DateTimeMask::DateTimeMask(std::string_view mask) : _text(mask) {
+    auto addLiteral = [&](std::string_view text) {
+        // Runs of literal text are kept as one element.
+        if (!_elements.empty() && _elements.back().field == Field::Literal &&
+            _elements.back().width + text.size() <= UINT8_MAX) {
+            _elements.back().width = static_cast<uint8_t>(_elements.back().width + text.size());
+        } else {
+            while (text.size() > UINT8_MAX) {
+                _elements.push_back({Field::Literal, UINT8_MAX, static_cast<uint32_t>(_literals.size())});
+                _literals.append(text.substr(0, UINT8_MAX));
+                text.remove_prefix(UINT8_MAX);
+            }
+            _elements.push_back({Field::Literal, static_cast<uint8_t>(text.size()),
+                                 static_cast<uint32_t>(_literals.size())});
+        }
+        _literals.append(text);
+        _sizeBound += text.size();
+    };
+    // Longer elements come first where one starts another.
+    constexpr std::pair<std::string_view, Field> kElements[] = {
+        {"YYYY", Field::Year4}, {"YY", Field::Year2}, {"MON", Field::MonthName}, {"MM", Field::Month},
+        {"MI", Field::Minute}, {"DD", Field::Day}, {"HH24", Field::Hour24}, {"HH12", Field::Hour12},
+        {"HH", Field::Hour12}, {"SS", Field::Second}, {"FF", Field::Fraction}, {"AM", Field::Meridian},
+        {"PM", Field::Meridian}, {"TZH", Field::TzHour}, {"TZM", Field::TzMinute},
+    };
+
+    while (!mask.empty()) {
+        if (mask.front() == '"') {
+            const auto close = mask.find('"', 1);
+            if (close == std::string_view::npos) {
+                throw std::runtime_error(fmt::format("unterminated quoted text in format mask {}", _text));
+            }
+            if (close > 1) {
+                addLiteral(mask.substr(1, close - 1));
+            }
+            mask.remove_prefix(close + 1);
+            continue;
+        }
+        if (!std::isalpha(static_cast<unsigned char>(mask.front()))) {
+            addLiteral(mask.substr(0, 1));
+            mask.remove_prefix(1);
+            continue;
+        }
+        const auto known = std::find_if(std::begin(kElements), std::end(kElements),
+                [&](const auto& element) { return startsWith(mask, element.first); });
+        if (known == std::end(kElements)) {
+            throw std::runtime_error(fmt::format("unknown element at \"{}\" in format mask {}", mask, _text));
+        }
+        Element element{known->second};
+        mask.remove_prefix(known->first.size());
+        switch (element.field) {
+        case Field::Fraction:
+            element.width = 9;
+            if (!mask.empty() && mask.front() >= '1' && mask.front() <= '9') {
+                element.width = static_cast<uint8_t>(mask.front() - '0');
+                mask.remove_prefix(1);
+            }
+            _sizeBound += element.width;
+            break;
+        case Field::Year4:
+            // Room for a sign, for years BC.
+            _sizeBound += 5;
+            break;
+        case Field::MonthName:
+        case Field::TzHour:
+            _sizeBound += 3;
+            break;
+        default:
+            _sizeBound += 2;
+            break;
+        }
+        _elements.push_back(element);
+    }
+}
+
+char* DateTimeMask::format(const dpiTimestamp& ts, char* out) const noexcept {
+    for (const auto& element : _elements) {
+        switch (element.field) {
+        case Field::Literal:
+            out = std::copy_n(_literals.data() + element.offset, element.width, out);
+            break;
+        case Field::Year4:
+            if (ts.year < 0) {
+                *out++ = '-';
+            }
+            out = write4(out, static_cast<unsigned>(std::abs(ts.year)));
+            break;
+        case Field::Year2:
+            out = write2(out, static_cast<unsigned>(std::abs(ts.year)));
+            break;
+        case Field::Month:
+            out = write2(out, ts.month);
+            break;
+        case Field::MonthName:
+            out = std::copy_n(kMonthNames.data() + (std::clamp<unsigned>(ts.month, 1, 12) - 1) * 3, 3, out);
+            break;
+        case Field::Day:
+            out = write2(out, ts.day);
+            break;
+        case Field::Hour24:
+            out = write2(out, ts.hour);
+            break;
+        case Field::Hour12:
+            out = write2(out, ts.hour % 12 == 0 ? 12 : ts.hour % 12);
+            break;
+        case Field::Minute:
+            out = write2(out, ts.minute);
+            break;
+        case Field::Second:
+            out = write2(out, ts.second);
+            break;
+        case Field::Fraction:
+            out = writeFraction(out, ts.fsecond, element.width);
+            break;
+        case Field::Meridian:
+            *out++ = ts.hour < 12 ? 'A' : 'P';
+            *out++ = 'M';
+            break;
+        case Field::TzHour:
+            *out++ = ts.tzHourOffset < 0 || ts.tzMinuteOffset < 0 ? '-' : '+';
+            out = write2(out, static_cast<unsigned>(std::abs(ts.tzHourOffset)));
+            break;
+        case Field::TzMinute:
+            out = write2(out, static_cast<unsigned>(std::abs(ts.tzMinuteOffset)));
+            break;
+        }
+    }
+    return out;
+}
+
+const DateTimeMask& dateTimeMask(DateTimeKind kind) noexcept {
+    return maskSlot(kind);
+}
+
+void setDateTimeMask(DateTimeKind kind, DateTimeMask mask) {
+    maskSlot(kind) = std::move(mask);
+}
+
+char* formatIntervalDS(const dpiIntervalDS& interval, char* out) noexcept {
+    const bool negative = interval.days < 0 || interval.hours < 0 || interval.minutes < 0 ||
+        interval.seconds < 0 || interval.fseconds < 0;
+    *out++ = negative ? '-' : '+';
+    const auto days = static_cast<unsigned>(std::abs(interval.days));
+    if (days < 100) {
+        out = write2(out, days);
+    } else {
+        out = std::to_chars(out, out + 10, days).ptr;
+    }
+    *out++ = ' ';
+    out = write2(out, static_cast<unsigned>(std::abs(interval.hours)));
+    *out++ = ':';
+    out = write2(out, static_cast<unsigned>(std::abs(interval.minutes)));
+    *out++ = ':';
+    out = write2(out, static_cast<unsigned>(std::abs(interval.seconds)));
+    if (interval.fseconds != 0) {
+        *out++ = '.';
+        out = writeFraction(out, static_cast<uint32_t>(std::abs(interval.fseconds)), 9);
+    }
+    return out;
+}
+
+char* formatIntervalYM(const dpiIntervalYM& interval, char* out) noexcept {
+    *out++ = interval.years < 0 || interval.months < 0 ? '-' : '+';
+    const auto years = static_cast<unsigned>(std::abs(interval.years));
+    if (years < 100) {
+        out = write2(out, years);
+    } else {
+        out = std::to_chars(out, out + 10, years).ptr;
+    }
+    *out++ = '-';
+    return write2(out, static_cast<unsigned>(std::abs(interval.months)));
+}
+
+} // namespace sqlplusplus
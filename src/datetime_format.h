@@ -0,0 +1,79 @@
+#pragma once
+
+#include "dpi.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+// A datetime format mask in the style of Oracle's TO_CHAR, compiled once into a list of
+// fields, so formatting a value is a walk down the list writing fixed-width digits from a
+// lookup table. Elements are matched without regard to case:
+//
+//   YYYY YY        year
+//   MM MON         month as digits, or its English abbreviation
+//   DD             day of the month
+//   HH24 HH HH12   hour, on the 24 or 12-hour clock
+//   MI SS          minutes and seconds
+//   FF1 .. FF9 FF  that many fractional second digits; FF alone is all nine
+//   AM PM          the meridian indicator
+//   TZH TZM        the time zone offset's signed hours and its minutes
+//
+// Punctuation and spaces are copied as they are, and so is text in double quotes.
+class DateTimeMask {
+public:
+    // Throws std::runtime_error for an element it doesn't know.
+    explicit DateTimeMask(std::string_view mask);
+
+    const std::string& text() const noexcept {
+        return _text;
+    }
+    // The most format() writes.
+    size_t sizeBound() const noexcept {
+        return _sizeBound;
+    }
+    char* format(const dpiTimestamp& ts, char* out) const noexcept;
+
+private:
+    enum class Field : uint8_t {
+        Literal, Year4, Year2, Month, MonthName, Day, Hour24, Hour12, Minute, Second, Fraction,
+        Meridian, TzHour, TzMinute,
+    };
+    struct Element {
+        Field field;
+        // Digits for Fraction; the length of the literal for Literal.
+        uint8_t width = 0;
+        // Into _literals, for Literal.
+        uint32_t offset = 0;
+    };
+
+    std::string _text;
+    std::string _literals;
+    std::vector<Element> _elements;
+    size_t _sizeBound = 0;
+};
+
+// Which of a session's masks a column's values are shown with, after the NLS parameters
+// of the same names.
+enum class DateTimeKind { Date, Timestamp, TimestampTz };
+
+// The masks result columns are formatted with, by default YYYY-MM-DD HH24:MI:SS for DATE,
+// with .FF6 for TIMESTAMP and TIMESTAMP WITH LOCAL TIME ZONE, and TZH:TZM after that for
+// TIMESTAMP WITH TIME ZONE. Formatters read them while results are being formatted, so
+// they're set between statements.
+const DateTimeMask& dateTimeMask(DateTimeKind kind) noexcept;
+void setDateTimeMask(DateTimeKind kind, DateTimeMask mask);
+
+// INTERVAL DAY TO SECOND as Oracle shows it, e.g. +01 02:03:04.500000000, with the
+// fraction left off when it's 0.
+constexpr size_t kIntervalDSSizeBound = 32;
+char* formatIntervalDS(const dpiIntervalDS& interval, char* out) noexcept;
+// INTERVAL YEAR TO MONTH as Oracle shows it, e.g. -02-06.
+constexpr size_t kIntervalYMSizeBound = 16;
+char* formatIntervalYM(const dpiIntervalYM& interval, char* out) noexcept;
+
+} // namespace sqlplusplus
@@ -0,0 +1,183 @@
+#include "delimited_writer.h"
+
+#include "escape_scan.h"
+#include "oracle_helpers.h"
+#include "result_metadata.h"
+#include "trace_recorder.h"
+#include "value_format.h"
+
+#include <string>
+#include <vector>
+
+namespace sqlplusplus {
+
+void DelimitedWriter::_startField() {
+    if (!_atRecordStart) {
+        _out.append(_delimiter());
+    }
+    _atRecordStart = false;
+}
+
+void DelimitedWriter::_appendQuotedContents(std::string_view value) {
+    for (;;) {
+        auto quote = value.find('"');
+        _out.append(value.substr(0, quote));
+        if (quote == std::string_view::npos) {
+            break;
+        }
+        _out.append("\"\"");
+        value.remove_prefix(quote + 1);
+    }
+}
+
+void DelimitedWriter::_appendEscaped(std::string_view value) {
+    for (;;) {
+        const auto special = findTsvSpecial(value);
+        _out.append(value.substr(0, special));
+        if (special == value.size()) {
+            break;
+        }
+        switch (value[special]) {
+        case '\t':
+            _out.append("\\t");
+            break;
+        case '\r':
+            _out.append("\\r");
+            break;
+        case '\n':
+            _out.append("\\n");
+            break;
+        default:
+            _out.append("\\\\");
+            break;
+        }
+        value.remove_prefix(special + 1);
+    }
+}
+
+bool DelimitedWriter::_needsEscaping(std::string_view value) const noexcept {
+    const auto special = _format == DelimitedFormat::Csv ? findCsvSpecial(value) : findTsvSpecial(value);
+    return special != value.size();
+}
+
+void DelimitedWriter::writeField(std::string_view value) {
+    _startField();
+    if (_format == DelimitedFormat::Tsv) {
+        _appendEscaped(value);
+    } else if (findCsvSpecial(value) == value.size()) {
+        _out.append(value);
+    } else {
+        _out.append('"');
+        _appendQuotedContents(value);
+        _out.append('"');
+    }
+}
+
+void DelimitedWriter::beginPieces() {
+    _startField();
+    if (_format == DelimitedFormat::Csv) {
+        _out.append('"');
+    }
+}
+
+void DelimitedWriter::writePiece(std::string_view piece) {
+    if (_format == DelimitedFormat::Csv) {
+        _appendQuotedContents(piece);
+    } else {
+        _appendEscaped(piece);
+    }
+}
+
+void DelimitedWriter::endPieces() {
+    if (_format == DelimitedFormat::Csv) {
+        _out.append('"');
+    }
+}
+
+void DelimitedWriter::writeNull() {
+    writeField({});
+}
+
+void DelimitedWriter::endRecord() {
+    _out.append('\n');
+    _atRecordStart = true;
+}
+
+uint64_t writeDelimitedResults(OracleResultSource& stmt, DelimitedWriter& out) {
+    const auto metadata = stmt.metadata();
+    const auto numColumns = metadata->numColumns();
+    std::vector<bool> binary;
+    for (const auto& column : metadata->columns()) {
+        out.writeField(column.name);
+        binary.push_back(isBinaryType(column.typeInfo.oracleTypeNum));
+    }
+    out.endRecord();
+
+    auto formatters = metadata->formatters();
+    OracleLobReader lobReader(stmt.context());
+    std::string hex;
+    std::vector<dpiData*> columnData(numColumns);
+    uint64_t numRows = 0;
+    for (;;) {
+        auto block = stmt.fetchBlock(stmt.fetchArraySize());
+        // Values are formatted straight into the output, so decoding and writing are one span.
+        TraceSpan span("write");
+        span.setArg("rows", block.numRows());
+        for (uint32_t col = 1; col <= numColumns; ++col) {
+            if (formatters[col - 1].nativeType() != block.nativeType(col)) {
+                formatters[col - 1] = ColumnFormatter(block.nativeType(col), formatters[col - 1].oracleType());
+            }
+            columnData[col - 1] = block.columnData(col);
+        }
+
+        for (uint32_t row = 0; row < block.numRows(); ++row) {
+            for (uint32_t col = 0; col < numColumns; ++col) {
+                const auto& data = columnData[col][row];
+                const auto& formatter = formatters[col];
+                if (data.isNull) {
+                    out.writeNull();
+                } else if (formatter.nativeType() == DPI_NATIVE_TYPE_LOB) {
+                    // Streamed into the field a piece at a time, rather than previewed.
+                    out.beginPieces();
+                    lobReader.open(data.value.asLOB);
+                    for (auto piece = lobReader.next(); !piece.empty(); piece = lobReader.next()) {
+                        if (binary[col]) {
+                            hex.resize(piece.size() * 2);
+                            writeHex(piece, hex.data());
+                            piece = hex;
+                        }
+                        out.writePiece(piece);
+                    }
+                    out.endPieces();
+                } else if (formatter.nativeType() == DPI_NATIVE_TYPE_BYTES && !binary[col]) {
+                    // Text goes out raw, quoted by the writer, rather than the way the
+                    // table shows it.
+                    out.writeField(std::string_view(data.value.asBytes.ptr, data.value.asBytes.length));
+                } else if (formatter.nativeType() == DPI_NATIVE_TYPE_JSON
+                           || formatter.nativeType() == DPI_NATIVE_TYPE_OBJECT
+                           || formatter.nativeType() == DPI_NATIVE_TYPE_TIMESTAMP) {
+                    // Compact JSON has commas and quotes in it, and backslashes in its
+                    // strings; objects and collections are "POINT(1, 2)", their string
+                    // members as they are; and a .set dateformat mask can have any
+                    // literal text, like the comma in "Mon DD, YYYY".
+                    out.writeCheckedField(formatter.sizeBound(data), [&](char* ptr) {
+                        return formatter.format(data, ptr);
+                    });
+                } else {
+                    out.writeUnquotedField(formatter.sizeBound(data), [&](char* ptr) {
+                        return formatter.format(data, ptr);
+                    });
+                }
+            }
+            out.endRecord();
+        }
+        numRows += block.numRows();
+        if (!block.moreRows()) {
+            break;
+        }
+    }
+    out.flush();
+    return numRows;
+}
+
+} // namespace sqlplusplus
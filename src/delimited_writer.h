@@ -0,0 +1,102 @@
+#pragma once
+
+#include "buffered_writer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace sqlplusplus {
+
+class OracleResultSource;
+
+enum class DelimitedFormat {
+    // RFC 4180: comma separated, fields with commas, quotes or line breaks are quoted.
+    Csv,
+    // Tab separated, with tabs, line breaks and backslashes escaped as \t \n \r \\.
+    Tsv,
+};
+
+// Writes delimited records to a BufferedFdWriter, quoting or escaping fields as needed.
+// The writer only keeps track of where in a record it is, so it's cheap to make one per
+// result set over a long-lived output.
+class DelimitedWriter {
+public:
+    DelimitedWriter(BufferedFdWriter& out, DelimitedFormat format) :
+        _out(out), _format(format) {}
+
+    DelimitedFormat format() const noexcept {
+        return _format;
+    }
+
+    // Writes a field, quoting or escaping it as the format requires.
+    void writeField(std::string_view value);
+    // Nulls are written as empty fields.
+    void writeNull();
+    // Writes a field whose text is known not to need quoting, such as a number, straight
+    // into the buffer: write(char*) gets at least sizeBound bytes and returns its end.
+    template <typename WriteFn>
+    void writeUnquotedField(size_t sizeBound, WriteFn&& write) {
+        auto out = _out.reserve(sizeBound + 1);
+        if (!_atRecordStart) {
+            *out++ = _delimiter();
+        }
+        _out.commit(write(out));
+        _atRecordStart = false;
+    }
+    // Like writeUnquotedField(), for text that usually needs nothing done to it but may,
+    // such as JSON: it's formatted straight into the buffer and checked there, and only
+    // copied out and written with writeField() when something in it needs quoting or
+    // escaping.
+    template <typename WriteFn>
+    void writeCheckedField(size_t sizeBound, WriteFn&& write) {
+        auto out = _out.reserve(sizeBound + 1);
+        if (!_atRecordStart) {
+            *out++ = _delimiter();
+        }
+        auto end = write(out);
+        const std::string_view text(out, static_cast<size_t>(end - out));
+        if (_needsEscaping(text)) {
+            // Nothing's been committed, so writeField() starts the field over.
+            _scratch.assign(text);
+            writeField(_scratch);
+            return;
+        }
+        _out.commit(end);
+        _atRecordStart = false;
+    }
+    // Writes a field that arrives in pieces, such as a LOB being streamed. CSV fields written
+    // this way are always quoted, since whether they'd need it isn't known up front.
+    void beginPieces();
+    void writePiece(std::string_view piece);
+    void endPieces();
+    void endRecord();
+
+    void flush() {
+        _out.flush();
+    }
+
+private:
+    void _startField();
+    void _appendQuotedContents(std::string_view value);
+    void _appendEscaped(std::string_view value);
+    bool _needsEscaping(std::string_view value) const noexcept;
+
+    char _delimiter() const noexcept {
+        return _format == DelimitedFormat::Csv ? ',' : '\t';
+    }
+
+    BufferedFdWriter& _out;
+    DelimitedFormat _format;
+    bool _atRecordStart = true;
+    // writeCheckedField()'s copy of a field that turned out to need quoting or escaping.
+    std::string _scratch;
+};
+
+// Writes a header record of column names and then every remaining row of an executed
+// query, fetching straight from the statement's fetch buffers. Memory use doesn't depend on
+// the number of rows. Returns the number of rows written.
+uint64_t writeDelimitedResults(OracleResultSource& stmt, DelimitedWriter& out);
+
+} // namespace sqlplusplus
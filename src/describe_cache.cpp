@@ -0,0 +1,375 @@
+#include "describe_cache.h"
+
+#include "result_metadata.h"
+#include "typed_bind.h"
+#include "typed_rows.h"
+
+#include "fmt/format.h"
+
+#include <cctype>
+#include <set>
+
+namespace sqlplusplus {
+namespace {
+
+// Names asked for at once in describeMany()'s IN list; more take a query per batch.
+constexpr size_t kDictionaryBatch = 200;
+
+constexpr uint32_t kDictionaryFetchRows = 1000;
+
+// The current schema comes back with every row, so unqualified names can be matched up
+// without another round trip.
+constexpr std::string_view kColumnsSelect = R"(
+SELECT owner, table_name, column_name, data_type, data_length, char_length, data_precision, data_scale,
+       nullable, SYS_CONTEXT('USERENV', 'CURRENT_SCHEMA')
+  FROM all_tab_columns)";
+
+constexpr std::string_view kColumnsOrder = "\n ORDER BY owner, table_name, column_id";
+
+// What a describe reports for a column of the type ALL_TAB_COLUMNS names, e.g.
+// TIMESTAMP(6) WITH TIME ZONE. User-defined types, XMLTYPE included, come out as objects.
+dpiOracleTypeNum dictionaryType(std::string_view dataType) {
+    auto startsWith = [dataType](std::string_view prefix) {
+        return dataType.substr(0, prefix.size()) == prefix;
+    };
+    auto contains = [dataType](std::string_view text) {
+        return dataType.find(text) != std::string_view::npos;
+    };
+    if (dataType == "VARCHAR2") {
+        return DPI_ORACLE_TYPE_VARCHAR;
+    } else if (dataType == "NVARCHAR2") {
+        return DPI_ORACLE_TYPE_NVARCHAR;
+    } else if (dataType == "CHAR") {
+        return DPI_ORACLE_TYPE_CHAR;
+    } else if (dataType == "NCHAR") {
+        return DPI_ORACLE_TYPE_NCHAR;
+    } else if (dataType == "RAW") {
+        return DPI_ORACLE_TYPE_RAW;
+    } else if (dataType == "ROWID" || dataType == "UROWID") {
+        return DPI_ORACLE_TYPE_ROWID;
+    } else if (dataType == "NUMBER" || dataType == "FLOAT") {
+        return DPI_ORACLE_TYPE_NUMBER;
+    } else if (dataType == "BINARY_FLOAT") {
+        return DPI_ORACLE_TYPE_NATIVE_FLOAT;
+    } else if (dataType == "BINARY_DOUBLE") {
+        return DPI_ORACLE_TYPE_NATIVE_DOUBLE;
+    } else if (dataType == "DATE") {
+        return DPI_ORACLE_TYPE_DATE;
+    } else if (startsWith("TIMESTAMP")) {
+        return contains("LOCAL TIME ZONE") ? DPI_ORACLE_TYPE_TIMESTAMP_LTZ :
+            contains("TIME ZONE") ? DPI_ORACLE_TYPE_TIMESTAMP_TZ : DPI_ORACLE_TYPE_TIMESTAMP;
+    } else if (startsWith("INTERVAL DAY")) {
+        return DPI_ORACLE_TYPE_INTERVAL_DS;
+    } else if (startsWith("INTERVAL YEAR")) {
+        return DPI_ORACLE_TYPE_INTERVAL_YM;
+    } else if (dataType == "CLOB") {
+        return DPI_ORACLE_TYPE_CLOB;
+    } else if (dataType == "NCLOB") {
+        return DPI_ORACLE_TYPE_NCLOB;
+    } else if (dataType == "BLOB") {
+        return DPI_ORACLE_TYPE_BLOB;
+    } else if (dataType == "BFILE") {
+        return DPI_ORACLE_TYPE_BFILE;
+    } else if (dataType == "BOOLEAN") {
+        return DPI_ORACLE_TYPE_BOOLEAN;
+    } else if (dataType == "LONG") {
+        return DPI_ORACLE_TYPE_LONG_VARCHAR;
+    } else if (dataType == "LONG RAW") {
+        return DPI_ORACLE_TYPE_LONG_RAW;
+    } else if (dataType == "JSON") {
+        return DPI_ORACLE_TYPE_JSON;
+    }
+    return DPI_ORACLE_TYPE_OBJECT;
+}
+
+struct DictionaryTable {
+    std::string owner;
+    std::string table;
+    std::vector<ColumnMetadata> columns;
+};
+
+// Reads an executed kColumnsSelect query into its tables, in the order it returns them.
+std::vector<DictionaryTable> readDictionaryColumns(OracleStatement& stmt, std::string& currentSchema) {
+    std::vector<DictionaryTable> tables;
+    forEachRow<std::string_view, std::string_view, std::string_view, std::string_view, int64_t,
+               std::optional<int64_t>, std::optional<int64_t>, std::optional<int64_t>, std::string_view,
+               std::string_view>(stmt,
+            [&](std::string_view owner, std::string_view table, std::string_view column, std::string_view dataType,
+                int64_t dataLength, std::optional<int64_t> charLength, std::optional<int64_t> precision,
+                std::optional<int64_t> scale, std::string_view nullable, std::string_view schema) {
+                if (tables.empty() || tables.back().owner != owner || tables.back().table != table) {
+                    tables.push_back({std::string(owner), std::string(table), {}});
+                }
+                if (currentSchema.empty()) {
+                    currentSchema = std::string(schema);
+                }
+                const auto type = dictionaryType(dataType);
+                const bool isNumber = type == DPI_ORACLE_TYPE_NUMBER;
+                // As a describe has them: NUMBER is precision 0, scale -127, as is FLOAT but
+                // for its precision, and NUMBER(*,s) has the maximum precision.
+                tables.back().columns.push_back(ColumnMetadata{
+                    std::string(column),
+                    nullable == "Y",
+                    type,
+                    static_cast<uint32_t>(dataLength),
+                    static_cast<uint32_t>(charLength.value_or(0)),
+                    static_cast<int16_t>(precision ? *precision : isNumber && scale ? 38 : 0),
+                    static_cast<int8_t>(isNumber ? scale.value_or(-127) : 0),
+                    static_cast<uint8_t>(isNumber ? 0 : scale.value_or(0))});
+            });
+    return tables;
+}
+
+} // namespace
+
+std::string columnTypeName(const ColumnMetadata& column) {
+    switch (column.oracleType) {
+    case DPI_ORACLE_TYPE_VARCHAR:
+        return fmt::format("VARCHAR2({})", column.sizeInChars);
+    case DPI_ORACLE_TYPE_NVARCHAR:
+        return fmt::format("NVARCHAR2({})", column.sizeInChars);
+    case DPI_ORACLE_TYPE_CHAR:
+        return fmt::format("CHAR({})", column.sizeInChars);
+    case DPI_ORACLE_TYPE_NCHAR:
+        return fmt::format("NCHAR({})", column.sizeInChars);
+    case DPI_ORACLE_TYPE_RAW:
+        return fmt::format("RAW({})", column.dbSizeInBytes);
+    case DPI_ORACLE_TYPE_ROWID:
+        return "ROWID";
+    case DPI_ORACLE_TYPE_NUMBER:
+        if (column.scale == -127) {
+            return column.precision == 0 ? "NUMBER" : fmt::format("FLOAT({})", column.precision);
+        } else if (column.precision == 0) {
+            return "NUMBER";
+        } else if (column.scale == 0) {
+            return fmt::format("NUMBER({})", column.precision);
+        }
+        return fmt::format("NUMBER({},{})", column.precision, column.scale);
+    case DPI_ORACLE_TYPE_NATIVE_FLOAT:
+        return "BINARY_FLOAT";
+    case DPI_ORACLE_TYPE_NATIVE_DOUBLE:
+        return "BINARY_DOUBLE";
+    case DPI_ORACLE_TYPE_NATIVE_INT:
+    case DPI_ORACLE_TYPE_NATIVE_UINT:
+        return "BINARY_INTEGER";
+    case DPI_ORACLE_TYPE_DATE:
+        return "DATE";
+    case DPI_ORACLE_TYPE_TIMESTAMP:
+        return fmt::format("TIMESTAMP({})", column.fsPrecision);
+    case DPI_ORACLE_TYPE_TIMESTAMP_TZ:
+        return fmt::format("TIMESTAMP({}) WITH TIME ZONE", column.fsPrecision);
+    case DPI_ORACLE_TYPE_TIMESTAMP_LTZ:
+        return fmt::format("TIMESTAMP({}) WITH LOCAL TIME ZONE", column.fsPrecision);
+    case DPI_ORACLE_TYPE_INTERVAL_DS:
+        return "INTERVAL DAY TO SECOND";
+    case DPI_ORACLE_TYPE_INTERVAL_YM:
+        return "INTERVAL YEAR TO MONTH";
+    case DPI_ORACLE_TYPE_CLOB:
+        return "CLOB";
+    case DPI_ORACLE_TYPE_NCLOB:
+        return "NCLOB";
+    case DPI_ORACLE_TYPE_BLOB:
+        return "BLOB";
+    case DPI_ORACLE_TYPE_BFILE:
+        return "BFILE";
+    case DPI_ORACLE_TYPE_BOOLEAN:
+        return "BOOLEAN";
+    case DPI_ORACLE_TYPE_LONG_VARCHAR:
+        return "LONG";
+    case DPI_ORACLE_TYPE_LONG_RAW:
+        return "LONG RAW";
+    case DPI_ORACLE_TYPE_JSON:
+    case DPI_ORACLE_TYPE_JSON_OBJECT:
+    case DPI_ORACLE_TYPE_JSON_ARRAY:
+        return "JSON";
+    case DPI_ORACLE_TYPE_OBJECT:
+        return "OBJECT";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+std::shared_ptr<const TableDescription> DescribeCache::describe(OracleConnection& conn, std::string_view tableName) {
+    auto key = normalizeIdentifier(tableName, true);
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        if (auto it = _entries.find(key); it != _entries.end()) {
+            return it->second;
+        }
+    }
+
+    auto stmt = conn.prepareStatement(fmt::format("select * from {} where 1 = 0", key));
+    stmt.describe();
+
+    auto description = std::make_shared<TableDescription>();
+    description->name = key;
+    const auto metadata = stmt.metadata();
+    description->columns.reserve(metadata->numColumns());
+    for (const auto& column : metadata->columns()) {
+        const auto& typeInfo = column.typeInfo;
+        description->columns.push_back(ColumnMetadata{
+            std::string(column.name),
+            column.nullable,
+            typeInfo.oracleTypeNum,
+            typeInfo.dbSizeInBytes,
+            typeInfo.sizeInChars,
+            typeInfo.precision,
+            typeInfo.scale,
+            typeInfo.fsPrecision});
+    }
+
+    _store({description});
+    return description;
+}
+
+std::vector<std::shared_ptr<const TableDescription>> DescribeCache::describeMany(
+        OracleConnection& conn, const std::vector<std::string>& tableNames) {
+    std::vector<std::string> keys;
+    keys.reserve(tableNames.size());
+    for (const auto& name : tableNames) {
+        keys.push_back(normalizeIdentifier(name, true));
+    }
+    std::map<std::string, std::shared_ptr<const TableDescription>, std::less<>> found;
+    std::vector<std::string> missing;
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        std::set<std::string_view> seen;
+        for (const auto& key : keys) {
+            if (auto it = _entries.find(key); it != _entries.end()) {
+                found.emplace(key, it->second);
+            } else if (seen.insert(key).second) {
+                missing.push_back(key);
+            }
+        }
+    }
+
+    for (size_t first = 0; first < missing.size(); first += kDictionaryBatch) {
+        const auto last = std::min(first + kDictionaryBatch, missing.size());
+        fmt::memory_buffer sql;
+        fmt::format_to(sql, "{}\n WHERE (owner, table_name) IN (", kColumnsSelect);
+        for (size_t idx = first; idx < last; ++idx) {
+            const auto pos = 2 * (idx - first) + 1;
+            fmt::format_to(sql, "{}(NVL(:{}, SYS_CONTEXT('USERENV', 'CURRENT_SCHEMA')), :{})",
+                           idx == first ? "" : ", ", pos, pos + 1);
+        }
+        fmt::format_to(sql, "){}", kColumnsOrder);
+        auto stmt = conn.prepareStatement(std::string_view(sql.data(), sql.size()));
+        stmt.setFetchArraySize(kDictionaryFetchRows);
+        for (size_t idx = first; idx < last; ++idx) {
+            const auto [owner, table] = splitOwner(missing[idx]);
+            const auto pos = static_cast<uint32_t>(2 * (idx - first) + 1);
+            bindValue(stmt, pos, owner);
+            bindValue(stmt, pos + 1, table);
+        }
+        stmt.execute();
+        std::string currentSchema;
+        const auto tables = readDictionaryColumns(stmt, currentSchema);
+
+        std::vector<std::shared_ptr<const TableDescription>> described;
+        auto add = [&](std::string key, const std::vector<ColumnMetadata>& columns) {
+            if (found.count(key) > 0) {
+                return;
+            }
+            auto description = std::make_shared<TableDescription>();
+            description->name = key;
+            description->columns = columns;
+            found.emplace(std::move(key), description);
+            described.push_back(std::move(description));
+        };
+        const std::set<std::string_view> asked(missing.begin() + first, missing.begin() + last);
+        for (const auto& table : tables) {
+            // A table of the current schema may have been asked for either way.
+            if (auto qualified = fmt::format("{}.{}", table.owner, table.table); asked.count(qualified) > 0) {
+                add(std::move(qualified), table.columns);
+            }
+            if (table.owner == currentSchema && asked.count(table.table) > 0) {
+                add(table.table, table.columns);
+            }
+        }
+        _store(described);
+    }
+
+    std::vector<std::shared_ptr<const TableDescription>> descriptions;
+    descriptions.reserve(keys.size());
+    for (const auto& key : keys) {
+        auto it = found.find(key);
+        // Synonyms and the like, which only a describe resolves.
+        descriptions.push_back(it != found.end() ? it->second : describe(conn, key));
+    }
+    return descriptions;
+}
+
+std::vector<std::shared_ptr<const TableDescription>> DescribeCache::describeMatching(
+        OracleConnection& conn, std::string_view owner, std::string_view pattern) {
+    std::string like;
+    for (const auto ch : pattern) {
+        if (ch == '*') {
+            like += '%';
+            continue;
+        }
+        if (ch == '_' || ch == '%' || ch == '\\') {
+            like += '\\';
+        }
+        like += static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+    }
+    const auto normalizedOwner = owner.empty() ? std::optional<std::string>() : normalizeIdentifier(owner, false);
+
+    auto stmt = conn.prepareStatement(fmt::format(
+            "{}\n WHERE owner = NVL(:1, SYS_CONTEXT('USERENV', 'CURRENT_SCHEMA'))"
+            "\n   AND table_name LIKE :2 ESCAPE '\\'{}", kColumnsSelect, kColumnsOrder));
+    stmt.setFetchArraySize(kDictionaryFetchRows);
+    bind(stmt, normalizedOwner, like);
+    stmt.execute();
+    std::string currentSchema;
+    std::vector<std::shared_ptr<const TableDescription>> descriptions;
+    for (auto& table : readDictionaryColumns(stmt, currentSchema)) {
+        auto description = std::make_shared<TableDescription>();
+        description->name = normalizedOwner ? fmt::format("{}.{}", table.owner, table.table) : table.table;
+        description->columns = std::move(table.columns);
+        descriptions.push_back(std::move(description));
+    }
+    _store(descriptions);
+    return descriptions;
+}
+
+void DescribeCache::_store(const std::vector<std::shared_ptr<const TableDescription>>& descriptions) {
+    DescribedListener listener;
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        for (const auto& description : descriptions) {
+            _entries.insert_or_assign(description->name, description);
+        }
+        listener = _describedListener;
+    }
+    if (listener) {
+        for (const auto& description : descriptions) {
+            listener(*description);
+        }
+    }
+}
+
+void DescribeCache::invalidate(std::string_view owner, std::string_view name) {
+    auto qualified = fmt::format("{}.{}", owner, name);
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (auto it = _entries.find(qualified); it != _entries.end()) {
+        _entries.erase(it);
+    }
+    if (auto it = _entries.find(name); it != _entries.end()) {
+        _entries.erase(it);
+    }
+}
+
+void DescribeCache::swapEntries(DescribeCache& other) {
+    if (&other == this) {
+        return;
+    }
+    std::scoped_lock lk(_mutex, other._mutex);
+    _entries.swap(other._entries);
+}
+
+void DescribeCache::setDescribedListener(DescribedListener listener) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    _describedListener = std::move(listener);
+}
+
+} // namespace sqlplusplus
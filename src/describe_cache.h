@@ -0,0 +1,77 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+struct ColumnMetadata {
+    std::string name;
+    bool nullable;
+    dpiOracleTypeNum oracleType;
+    uint32_t dbSizeInBytes;
+    uint32_t sizeInChars;
+    int16_t precision;
+    int8_t scale;
+    uint8_t fsPrecision;
+};
+
+// SQL type of a column as it would be written in DDL, e.g. VARCHAR2(30) or NUMBER(10,2).
+std::string columnTypeName(const ColumnMetadata& column);
+
+struct TableDescription {
+    // The table name as it was asked for, upper-cased; qualified only if it was qualified.
+    std::string name;
+    std::vector<ColumnMetadata> columns;
+};
+
+// Column metadata for tables and views, keyed by upper-cased (owner.)table. Entries are
+// filled from a describe-only execute of "select * from <table>", which never runs the
+// query or scans the data dictionary, and stay until they're invalidated.
+class DescribeCache {
+public:
+    using DescribedListener = std::function<void(const TableDescription&)>;
+
+    // Returns the cached description of tableName, describing it on conn first if needed.
+    // Throws std::runtime_error if tableName isn't a plain, optionally qualified, identifier.
+    std::shared_ptr<const TableDescription> describe(OracleConnection& conn, std::string_view tableName);
+    // Describes all of tableNames, as describe() would each, with the ones that aren't
+    // cached yet described by one array-fetched ALL_TAB_COLUMNS query instead of a round
+    // trip apiece. A name that isn't a table or view in its schema, e.g. a synonym, is
+    // then described on its own. Returned in the order they were asked for.
+    std::vector<std::shared_ptr<const TableDescription>> describeMany(OracleConnection& conn,
+                                                                      const std::vector<std::string>& tableNames);
+    // Describes every table and view of owner, or of the current schema if owner is empty,
+    // whose name matches pattern, in which * matches anything, from one ALL_TAB_COLUMNS
+    // query, caching them under qualified names if owner was given. In name order.
+    std::vector<std::shared_ptr<const TableDescription>> describeMatching(OracleConnection& conn,
+                                                                          std::string_view owner,
+                                                                          std::string_view pattern);
+
+    // Drops any entries for owner.name, qualified or not. Safe to call from any thread.
+    void invalidate(std::string_view owner, std::string_view name);
+
+    // Exchanges every cached entry with other's, each keeping its own listener, e.g. to set
+    // one database's descriptions aside while another's are in use.
+    void swapEntries(DescribeCache& other);
+
+    // Called with every freshly described table, e.g. to feed the completion index.
+    void setDescribedListener(DescribedListener listener);
+
+private:
+    // Caches descriptions and passes them to the listener.
+    void _store(const std::vector<std::shared_ptr<const TableDescription>>& descriptions);
+
+    std::mutex _mutex;
+    std::map<std::string, std::shared_ptr<const TableDescription>, std::less<>> _entries;
+    DescribedListener _describedListener;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace sqlplusplus {
+
+// Terminal column widths of UTF-8 text. East Asian wide and fullwidth characters and most
+// emoji take two columns, combining marks and other zero-width characters none, everything
+// else one; a byte that isn't part of valid UTF-8 counts as one column, the replacement
+// character terminals draw for it. Text is checked for being all ASCII 16 bytes at a time
+// first, so the common case costs about as much as a memchr.
+
+// Whether every byte of text is below 0x80.
+bool isAscii(std::string_view text) noexcept;
+
+size_t displayWidth(std::string_view text) noexcept;
+
+// The length in bytes of the character text starts with, which mustn't be empty, with its
+// display width in width.
+size_t nextCharacter(std::string_view text, size_t& width) noexcept;
+
+// The longest prefix of text no wider than maxWidth, in bytes, with its width in width. A
+// character is never split, and the zero-width marks after one stay with it. When even the
+// first character is wider than maxWidth it's returned on its own, so wrapping text at
+// maxWidth always makes progress.
+size_t prefixForWidth(std::string_view text, size_t maxWidth, size_t& width) noexcept;
+
+} // namespace sqlplusplus
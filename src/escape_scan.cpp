@@ -0,0 +1,99 @@
+#include "escape_scan.h"
+
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace sqlplusplus {
+namespace {
+
+// The first byte from pos on that's one of A to D, or below Below unless that's 0. Sets
+// with fewer than four bytes repeat one.
+template <char A, char B, char C, char D, unsigned char Below>
+size_t findAny(std::string_view text, size_t pos) noexcept {
+    const auto data = text.data();
+    const auto size = text.size();
+#if defined(__AVX2__)
+    const __m256i a = _mm256_set1_epi8(A);
+    const __m256i b = _mm256_set1_epi8(B);
+    const __m256i c = _mm256_set1_epi8(C);
+    const __m256i d = _mm256_set1_epi8(D);
+    // Unsigned, x < Below when max(x, Below - 1) is Below - 1.
+    const __m256i belowMax = _mm256_set1_epi8(static_cast<char>(Below - 1));
+    for (; pos + 32 <= size; pos += 32) {
+        const auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        auto matches = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, a), _mm256_cmpeq_epi8(chunk, b)),
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, c), _mm256_cmpeq_epi8(chunk, d)));
+        if constexpr (Below != 0) {
+            matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(_mm256_max_epu8(chunk, belowMax), belowMax));
+        }
+        if (const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(matches)); mask != 0) {
+            return pos + static_cast<size_t>(__builtin_ctz(mask));
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i a = _mm_set1_epi8(A);
+    const __m128i b = _mm_set1_epi8(B);
+    const __m128i c = _mm_set1_epi8(C);
+    const __m128i d = _mm_set1_epi8(D);
+    const __m128i belowMax = _mm_set1_epi8(static_cast<char>(Below - 1));
+    for (; pos + 16 <= size; pos += 16) {
+        const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        auto matches = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, a), _mm_cmpeq_epi8(chunk, b)),
+                                    _mm_or_si128(_mm_cmpeq_epi8(chunk, c), _mm_cmpeq_epi8(chunk, d)));
+        if constexpr (Below != 0) {
+            matches = _mm_or_si128(matches, _mm_cmpeq_epi8(_mm_max_epu8(chunk, belowMax), belowMax));
+        }
+        if (const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(matches)); mask != 0) {
+            return pos + static_cast<size_t>(__builtin_ctz(mask));
+        }
+    }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    const auto bytes = reinterpret_cast<const uint8_t*>(data);
+    for (; pos + 16 <= size; pos += 16) {
+        const auto chunk = vld1q_u8(bytes + pos);
+        auto matches = vorrq_u8(vorrq_u8(vceqq_u8(chunk, vdupq_n_u8(static_cast<uint8_t>(A))),
+                                         vceqq_u8(chunk, vdupq_n_u8(static_cast<uint8_t>(B)))),
+                                vorrq_u8(vceqq_u8(chunk, vdupq_n_u8(static_cast<uint8_t>(C))),
+                                         vceqq_u8(chunk, vdupq_n_u8(static_cast<uint8_t>(D)))));
+        if constexpr (Below != 0) {
+            matches = vorrq_u8(matches, vcltq_u8(chunk, vdupq_n_u8(Below)));
+        }
+        // Narrowed to four bits a byte, so the first match is the lowest set nibble.
+        const auto mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(matches), 4)), 0);
+        if (mask != 0) {
+            return pos + static_cast<size_t>(__builtin_ctzll(mask)) / 4;
+        }
+    }
+#endif
+    for (; pos < size; ++pos) {
+        const auto ch = data[pos];
+        if (ch == A || ch == B || ch == C || ch == D || static_cast<unsigned char>(ch) < Below) {
+            return pos;
+        }
+    }
+    return size;
+}
+
+} // namespace
+
+size_t findCsvSpecial(std::string_view text, size_t from) noexcept {
+    return findAny<',', '"', '\r', '\n', 0>(text, from);
+}
+
+size_t findTsvSpecial(std::string_view text, size_t from) noexcept {
+    return findAny<'\t', '\r', '\n', '\\', 0>(text, from);
+}
+
+size_t findJsonSpecial(std::string_view text, size_t from) noexcept {
+    return findAny<'"', '\\', '"', '"', 0x20>(text, from);
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace sqlplusplus {
+
+// Where the first byte at or after from that a writer has to quote or escape is, or
+// text.size() if there's none, so the run before it can be copied in one go. Bytes are
+// checked 16 at a time, or 32 with AVX2, so text that needs nothing done to it, which is
+// most of it, costs about a memchr.
+
+// , " \r and \n, which make a CSV field need quoting.
+size_t findCsvSpecial(std::string_view text, size_t from = 0) noexcept;
+// \t \r \n and \\, which TSV escapes.
+size_t findTsvSpecial(std::string_view text, size_t from = 0) noexcept;
+// " \\ and the control characters below 0x20, which a JSON string escapes.
+size_t findJsonSpecial(std::string_view text, size_t from = 0) noexcept;
+
+} // namespace sqlplusplus
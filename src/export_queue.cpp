@@ -0,0 +1,230 @@
+#include "export_queue.h"
+
+#include "typed_bind.h"
+#include "typed_rows.h"
+
+#include "fmt/format.h"
+
+#include <chrono>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+
+namespace sqlplusplus {
+namespace {
+
+// Created the first time a job is queued; ORA-00955 is another coordinator having got
+// there first.
+constexpr std::string_view kCreateQueueSql = R"(
+BEGIN
+    EXECUTE IMMEDIATE '
+CREATE TABLE sqlplusplus_export_chunks (
+    job_name       VARCHAR2(128) NOT NULL,
+    chunk_no       NUMBER(10) NOT NULL,
+    table_name     VARCHAR2(261) NOT NULL,
+    format         VARCHAR2(16) NOT NULL,
+    path           VARCHAR2(4000) NOT NULL,
+    first_rowid    VARCHAR2(32),
+    last_rowid     VARCHAR2(32),
+    partition_name VARCHAR2(128),
+    status         VARCHAR2(8) DEFAULT ''todo'' NOT NULL,
+    worker         VARCHAR2(256),
+    rows_written   NUMBER,
+    seconds        NUMBER,
+    finished_at    TIMESTAMP,
+    CONSTRAINT sqlplusplus_export_chunks_pk PRIMARY KEY (job_name, chunk_no)
+)';
+EXCEPTION
+    WHEN OTHERS THEN
+        IF SQLCODE != -955 THEN
+            RAISE;
+        END IF;
+END;)";
+
+// Rows are locked as they're fetched, and ones another worker holds are passed over, so
+// fetching just the first row claims the first chunk nobody else has.
+constexpr std::string_view kClaimSql = R"(
+SELECT ROWIDTOCHAR(ROWID)
+  FROM sqlplusplus_export_chunks
+ WHERE job_name = :1
+   AND status = 'todo'
+ ORDER BY chunk_no
+   FOR UPDATE SKIP LOCKED)";
+
+constexpr std::string_view kChunkSql = R"(
+SELECT table_name, format, path, first_rowid, last_rowid, partition_name
+  FROM sqlplusplus_export_chunks
+ WHERE ROWID = CHARTOROWID(:1))";
+
+constexpr std::string_view kDoneSql = R"(
+UPDATE sqlplusplus_export_chunks
+   SET status = 'done', worker = :1, rows_written = :2, seconds = :3, finished_at = SYSTIMESTAMP
+ WHERE ROWID = CHARTOROWID(:4))";
+
+struct QueuedChunk {
+    std::string rowid;
+    std::string table;
+    std::string format;
+    std::string path;
+    std::optional<std::string> firstRowid;
+    std::optional<std::string> lastRowid;
+    std::optional<std::string> partition;
+};
+
+// Claims the next chunk of job in coordination's transaction, or returns nothing once
+// every chunk is done or claimed.
+std::optional<QueuedChunk> claimChunk(OracleConnection& coordination, OracleStatement& claim, std::string_view job) {
+    bind(claim, job);
+    claim.execute();
+    const auto block = claim.fetchBlock(1);
+    if (block.numRows() == 0) {
+        return std::nullopt;
+    }
+    QueuedChunk chunk;
+    chunk.rowid = std::string(block.value(1, 0).as<std::string_view>());
+
+    auto stmt = coordination.prepareStatement(kChunkSql);
+    bind(stmt, chunk.rowid);
+    stmt.execute();
+    forEachRow<std::string_view, std::string_view, std::string_view, std::optional<std::string_view>,
+               std::optional<std::string_view>, std::optional<std::string_view>>(stmt,
+            [&](std::string_view table, std::string_view format, std::string_view path,
+                std::optional<std::string_view> first, std::optional<std::string_view> last,
+                std::optional<std::string_view> partition) {
+                chunk.table = std::string(table);
+                chunk.format = std::string(format);
+                chunk.path = std::string(path);
+                if (first && last) {
+                    chunk.firstRowid = std::string(*first);
+                    chunk.lastRowid = std::string(*last);
+                }
+                if (partition) {
+                    chunk.partition = std::string(*partition);
+                }
+            });
+    return chunk;
+}
+
+ExportShard exportChunk(OracleConnection& data, const QueuedChunk& chunk, const ParallelExportOptions& opts) {
+    ExportShard shard;
+    shard.path = chunk.path;
+    const auto start = std::chrono::steady_clock::now();
+    std::optional<OracleStatement> stmt;
+    if (chunk.partition) {
+        stmt.emplace(data.prepareStatement(
+                fmt::format("SELECT * FROM {}", partitionExtendedName(chunk.table, *chunk.partition))));
+    } else if (chunk.firstRowid) {
+        stmt.emplace(data.prepareStatement(fmt::format(
+                "SELECT * FROM {} WHERE ROWID BETWEEN CHARTOROWID(:1) AND CHARTOROWID(:2)", chunk.table)));
+        bind(*stmt, *chunk.firstRowid, *chunk.lastRowid);
+    } else {
+        stmt.emplace(data.prepareStatement(fmt::format("SELECT * FROM {}", chunk.table)));
+    }
+    if (opts.setUpStatement) {
+        opts.setUpStatement(*stmt);
+    }
+    stmt->execute();
+    shard.rows = writeShard(*stmt, shard.path, opts);
+    shard.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return shard;
+}
+
+} // namespace
+
+void queueExport(OracleConnection& conn, const QueuedExport& exportJob, const std::vector<RowidRange>& ranges,
+                 const std::vector<TablePartition>& partitions) {
+    conn.prepareStatement(kCreateQueueSql).execute();
+
+    // Locks the job's chunks, so a worker can't be part way through one as it's replaced.
+    int64_t unfinished = 0;
+    {
+        auto stmt = conn.prepareStatement(
+                "SELECT status FROM sqlplusplus_export_chunks WHERE job_name = :1 FOR UPDATE NOWAIT");
+        bind(stmt, exportJob.job);
+        stmt.execute();
+        forEachRow<std::string_view>(stmt, [&](std::string_view status) {
+            unfinished += status != "done";
+        });
+    }
+    if (unfinished > 0) {
+        conn.rollback();
+        throw std::runtime_error(fmt::format(
+                "export job {} still has {} chunks to export; let its workers finish, or queue it under another name",
+                exportJob.job, unfinished));
+    }
+    {
+        auto stmt = conn.prepareStatement("DELETE FROM sqlplusplus_export_chunks WHERE job_name = :1");
+        bind(stmt, exportJob.job);
+        stmt.execute();
+    }
+
+    try {
+        const auto table = normalizeIdentifier(exportJob.table, true);
+        auto insert = conn.prepareStatement(
+                "INSERT INTO sqlplusplus_export_chunks "
+                "(job_name, chunk_no, table_name, format, path, first_rowid, last_rowid, partition_name) "
+                "VALUES (:1, :2, :3, :4, :5, :6, :7, :8)");
+        auto queue = [&](size_t idx, const std::string& path, std::optional<std::string_view> first,
+                         std::optional<std::string_view> last, std::optional<std::string_view> partition) {
+            bind(insert, exportJob.job, static_cast<int64_t>(idx + 1), table, exportJob.format, path,
+                 first, last, partition);
+            insert.execute();
+        };
+        // Chunk files are named just as a single-host parallel export names its shards.
+        if (!partitions.empty()) {
+            for (size_t idx = 0; idx < partitions.size(); ++idx) {
+                queue(idx, shardPath(exportJob.path, std::string_view(partitions[idx].name)), std::nullopt,
+                      std::nullopt, std::string_view(partitions[idx].name));
+            }
+        } else if (!ranges.empty()) {
+            for (size_t idx = 0; idx < ranges.size(); ++idx) {
+                queue(idx, shardPath(exportJob.path, idx), std::string_view(ranges[idx].first),
+                      std::string_view(ranges[idx].last), std::nullopt);
+            }
+        } else {
+            queue(0, shardPath(exportJob.path, size_t(0)), std::nullopt, std::nullopt, std::nullopt);
+        }
+        conn.commit();
+    } catch(...) {
+        conn.rollback();
+        throw;
+    }
+}
+
+std::vector<ExportShard> runExportWorker(OracleConnection& coordination, OracleConnection& data,
+                                         std::string_view job, const ExportWorkerOptions& opts) {
+    auto claim = coordination.prepareStatement(kClaimSql);
+    // Anything fetched ahead would be claimed along with the row that's wanted.
+    claim.setFetchArraySize(1);
+    claim.setPrefetchRows(0);
+    auto done = coordination.prepareStatement(kDoneSql);
+
+    std::vector<ExportShard> shards;
+    for (;;) {
+        try {
+            const auto chunk = claimChunk(coordination, claim, job);
+            if (!chunk) {
+                coordination.rollback();
+                return shards;
+            }
+            auto shard = exportChunk(data, *chunk, opts.optionsFor(chunk->format, chunk->path));
+            bind(done, opts.worker, shard.rows, shard.seconds, chunk->rowid);
+            done.execute();
+            coordination.commit();
+            if (opts.onShardDone) {
+                opts.onShardDone(shard);
+            }
+            shards.push_back(std::move(shard));
+        } catch(...) {
+            // Hands the claimed chunk back for another worker to export.
+            try {
+                coordination.rollback();
+            } catch(const std::exception&) {
+                // A lost connection has released the lock already.
+            }
+            throw;
+        }
+    }
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "oracle_helpers.h"
+#include "parallel_export.h"
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+// An export split into chunks that export workers on any number of hosts share out
+// between them through a table in the database, so one client host's network and CPU
+// don't cap the export.
+struct QueuedExport {
+    std::string job;
+    std::string table;
+    // csv, tsv, ndjson or parquet.
+    std::string format;
+    // Chunk files are named from it as shardPath() names a parallel export's shards, and
+    // written on the host of the worker that claims them, so a shared mount collects them
+    // in one place.
+    std::string path;
+};
+
+// The table chunks are queued in, created by queueExport() if it isn't there.
+constexpr std::string_view kExportQueueTable = "SQLPLUSPLUS_EXPORT_CHUNKS";
+
+// Queues a chunk per ROWID range, or per partition, for workers to claim, and commits.
+// A table with neither is queued whole as one chunk. Re-queuing a job that finished
+// replaces it; throws std::runtime_error if it still has chunks to export.
+void queueExport(OracleConnection& conn, const QueuedExport& exportJob, const std::vector<RowidRange>& ranges,
+                 const std::vector<TablePartition>& partitions);
+
+struct ExportWorkerOptions {
+    // Identifies the worker in the queue, e.g. host:pid.
+    std::string worker;
+    // The options for exporting a chunk in format to path.
+    std::function<ParallelExportOptions(std::string_view format, const std::string& path)> optionsFor;
+    // Called once a chunk's file is written and recorded as done.
+    std::function<void(const ExportShard& shard)> onShardDone;
+};
+
+// Claims the job's chunks one at a time with SELECT ... FOR UPDATE SKIP LOCKED on
+// coordination, so each goes to exactly one worker, and exports each on data until none
+// are left, returning the ones this worker exported. A claimed chunk stays locked until
+// it's recorded as done, in the same transaction, so the chunk of a worker that fails or
+// dies is rolled back into the queue for another to claim. Rethrows the first error.
+std::vector<ExportShard> runExportWorker(OracleConnection& coordination, OracleConnection& data,
+                                         std::string_view job, const ExportWorkerOptions& opts);
+
+} // namespace sqlplusplus
@@ -0,0 +1,642 @@
+#include "fanout.h"
+
+#include "mapped_file.h"
+#include "result_metadata.h"
+#include "trace_recorder.h"
+#include "value_format.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <string_view>
+#include <utility>
+
+namespace sqlplusplus {
+namespace {
+
+constexpr uint32_t kFetchArraySize = 500;
+
+std::string errorMessage(const std::exception& e) {
+    if (auto oracleError = dynamic_cast<const OracleException*>(&e)) {
+        return fmt::format("{}: {}", oracleError->context(), oracleError->what());
+    }
+    return e.what();
+}
+
+bool isWordChar(char ch) noexcept {
+    return std::isalnum(static_cast<unsigned char>(ch)) != 0 || ch == '_' || ch == '$' || ch == '#' ||
+            static_cast<unsigned char>(ch) >= 0x80;
+}
+
+bool equalsIgnoringCase(std::string_view word, std::string_view upper) noexcept {
+    return word.size() == upper.size() && std::equal(word.begin(), word.end(), upper.begin(), [](char left, char right) {
+        return std::toupper(static_cast<unsigned char>(left)) == right;
+    });
+}
+
+struct SqlToken {
+    std::string_view text;
+    // Parentheses open around it.
+    int depth = 0;
+};
+
+// Where the quote opened at pos, possibly a q-quote, ends, or sql.size() if it doesn't.
+size_t quoteEnd(std::string_view sql, size_t pos) {
+    if (sql[pos] == '"') {
+        return std::min(sql.find('"', pos + 1), sql.size() - 1) + 1;
+    }
+    if (sql[pos] != '\'') {
+        // q'<delimiter>...<delimiter>'
+        auto close = sql[pos + 2];
+        switch (close) {
+        case '[': close = ']'; break;
+        case '(': close = ')'; break;
+        case '{': close = '}'; break;
+        case '<': close = '>'; break;
+        default: break;
+        }
+        for (auto at = sql.find(close, pos + 3); at != std::string_view::npos; at = sql.find(close, at + 1)) {
+            if (at + 1 < sql.size() && sql[at + 1] == '\'') {
+                return at + 2;
+            }
+        }
+        return sql.size();
+    }
+    for (auto at = sql.find('\'', pos + 1); at != std::string_view::npos; at = sql.find('\'', at + 2)) {
+        if (at + 1 == sql.size() || sql[at + 1] != '\'') {
+            return at + 1;
+        }
+    }
+    return sql.size();
+}
+
+// sql's words, numbers, quotes and punctuation, without its whitespace and comments.
+std::vector<SqlToken> sqlTokens(std::string_view sql) {
+    std::vector<SqlToken> tokens;
+    int depth = 0;
+    for (size_t pos = 0; pos < sql.size();) {
+        const auto ch = sql[pos];
+        if (std::isspace(static_cast<unsigned char>(ch)) != 0) {
+            ++pos;
+        } else if (sql.substr(pos, 2) == "--") {
+            pos = std::min(sql.find('\n', pos), sql.size());
+        } else if (sql.substr(pos, 2) == "/*") {
+            pos = std::min(sql.find("*/", pos + 2), sql.size() - 2) + 2;
+        } else if (ch == '\'' || ch == '"') {
+            const auto end = quoteEnd(sql, pos);
+            tokens.push_back({sql.substr(pos, end - pos), depth});
+            pos = end;
+        } else if (isWordChar(ch)) {
+            // A q-quote or national string literal starts like a word.
+            auto prefix = pos;
+            if (std::toupper(static_cast<unsigned char>(sql[prefix])) == 'N') {
+                ++prefix;
+            }
+            if (prefix < sql.size() && std::toupper(static_cast<unsigned char>(sql[prefix])) == 'Q' &&
+                    prefix + 2 < sql.size() && sql[prefix + 1] == '\'') {
+                const auto end = quoteEnd(sql, prefix);
+                tokens.push_back({sql.substr(pos, end - pos), depth});
+                pos = end;
+                continue;
+            }
+            if (prefix > pos && prefix < sql.size() && sql[prefix] == '\'') {
+                const auto end = quoteEnd(sql, prefix);
+                tokens.push_back({sql.substr(pos, end - pos), depth});
+                pos = end;
+                continue;
+            }
+            auto end = pos + 1;
+            while (end < sql.size() && isWordChar(sql[end])) {
+                ++end;
+            }
+            tokens.push_back({sql.substr(pos, end - pos), depth});
+            pos = end;
+        } else {
+            if (ch == ')') {
+                --depth;
+            }
+            tokens.push_back({sql.substr(pos, 1), depth});
+            if (ch == '(') {
+                ++depth;
+            }
+            ++pos;
+        }
+    }
+    return tokens;
+}
+
+// The row's days since 1970-01-01 in the proleptic Gregorian calendar, after Howard
+// Hinnant's days_from_civil.
+int64_t daysFromCivil(int64_t year, int64_t month, int64_t day) noexcept {
+    year -= month <= 2;
+    const auto era = (year >= 0 ? year : year - 399) / 400;
+    const auto yearOfEra = year - era * 400;
+    const auto dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const auto dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+// A value to sort a cell by: text that compares byte by byte in the value's order, or for
+// numbers, their decimal digits. Cells of types without one compare by their formatted
+// text.
+std::optional<std::string> sortValue(const dpiData& data, dpiNativeTypeNum nativeType, std::string_view formatted) {
+    if (data.isNull) {
+        return std::nullopt;
+    }
+    switch (nativeType) {
+    case DPI_NATIVE_TYPE_INT64:
+        return std::to_string(data.value.asInt64);
+    case DPI_NATIVE_TYPE_UINT64:
+        return std::to_string(data.value.asUint64);
+    case DPI_NATIVE_TYPE_DOUBLE:
+        return fmt::format("{}", data.value.asDouble);
+    case DPI_NATIVE_TYPE_FLOAT:
+        return fmt::format("{}", data.value.asFloat);
+    case DPI_NATIVE_TYPE_BYTES:
+        return std::string(data.value.asBytes.ptr, data.value.asBytes.length);
+    case DPI_NATIVE_TYPE_TIMESTAMP: {
+        // In UTC, offset so it's never negative, as fixed-width digits.
+        const auto& ts = data.value.asTimestamp;
+        const auto seconds = daysFromCivil(ts.year, ts.month, ts.day) * 86400 + ts.hour * 3600 + ts.minute * 60 +
+                ts.second - ts.tzHourOffset * 3600 - ts.tzMinuteOffset * 60;
+        constexpr int64_t kOffset = int64_t{1} << 40;
+        return fmt::format("{:014}{:09}", seconds + kOffset, ts.fsecond);
+    }
+    default:
+        return std::string(formatted);
+    }
+}
+
+// Compares a magnitude's digits, without a sign.
+int compareMagnitudes(std::string_view left, std::string_view right) noexcept {
+    auto split = [](std::string_view digits) {
+        const auto point = std::min(digits.find('.'), digits.size());
+        auto whole = digits.substr(0, point);
+        auto fraction = digits.substr(std::min(point + 1, digits.size()));
+        whole.remove_prefix(std::min(whole.find_first_not_of('0'), whole.size()));
+        fraction = fraction.substr(0, fraction.find_last_not_of('0') + 1);
+        return std::make_pair(whole, fraction);
+    };
+    const auto [leftWhole, leftFraction] = split(left);
+    const auto [rightWhole, rightFraction] = split(right);
+    if (leftWhole.size() != rightWhole.size()) {
+        return leftWhole.size() < rightWhole.size() ? -1 : 1;
+    }
+    if (const auto whole = leftWhole.compare(rightWhole); whole != 0) {
+        return whole;
+    }
+    return leftFraction.compare(rightFraction);
+}
+
+// Compares numbers as sortValue() has them, exactly for plain decimals however many digits
+// they have, and as long doubles for ones in exponent form or that aren't finite.
+int compareNumbers(std::string_view left, std::string_view right) {
+    constexpr std::string_view kNonDecimal = "eEinfINFaA";
+    if (left.find_first_of(kNonDecimal) != std::string_view::npos ||
+            right.find_first_of(kNonDecimal) != std::string_view::npos) {
+        const auto leftValue = std::strtold(std::string(left).c_str(), nullptr);
+        const auto rightValue = std::strtold(std::string(right).c_str(), nullptr);
+        return leftValue < rightValue ? -1 : rightValue < leftValue ? 1 : 0;
+    }
+    auto sign = [](std::string_view& number) {
+        const bool negative = !number.empty() && number.front() == '-';
+        if (negative) {
+            number.remove_prefix(1);
+        }
+        return negative && number.find_first_not_of("0.") != std::string_view::npos;
+    };
+    const auto leftNegative = sign(left);
+    const auto rightNegative = sign(right);
+    if (leftNegative != rightNegative) {
+        return leftNegative ? -1 : 1;
+    }
+    const auto magnitude = compareMagnitudes(left, right);
+    return leftNegative ? -magnitude : magnitude;
+}
+
+std::string_view trim(std::string_view text) {
+    const auto first = text.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos) {
+        return {};
+    }
+    return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+}
+
+} // namespace
+
+std::vector<FanoutOrderKey> outerOrderBy(std::string_view sql) {
+    const auto tokens = sqlTokens(sql);
+    std::vector<FanoutOrderKey> keys;
+    if (tokens.empty() || !(equalsIgnoringCase(tokens.front().text, "SELECT") ||
+            equalsIgnoringCase(tokens.front().text, "WITH") || tokens.front().text == "(")) {
+        return keys;
+    }
+    size_t start = tokens.size();
+    for (size_t idx = 0; idx + 1 < tokens.size(); ++idx) {
+        if (tokens[idx].depth == 0 && equalsIgnoringCase(tokens[idx].text, "ORDER") &&
+                equalsIgnoringCase(tokens[idx + 1].text, "BY")) {
+            start = idx + 2;
+        }
+    }
+    if (start == tokens.size()) {
+        return keys;
+    }
+    auto end = start;
+    while (end < tokens.size() && !(tokens[end].depth == 0 && (equalsIgnoringCase(tokens[end].text, "OFFSET") ||
+            equalsIgnoringCase(tokens[end].text, "FETCH") || equalsIgnoringCase(tokens[end].text, "FOR")))) {
+        ++end;
+    }
+    for (auto first = start; first < end;) {
+        auto last = first;
+        while (last < end && !(tokens[last].depth == 0 && tokens[last].text == ",")) {
+            ++last;
+        }
+        auto termEnd = last;
+        FanoutOrderKey key;
+        bool nullsGiven = false;
+        if (termEnd - first >= 3 && equalsIgnoringCase(tokens[termEnd - 2].text, "NULLS")) {
+            key.nullsFirst = equalsIgnoringCase(tokens[termEnd - 1].text, "FIRST");
+            nullsGiven = true;
+            termEnd -= 2;
+        }
+        if (termEnd - first >= 2 && (equalsIgnoringCase(tokens[termEnd - 1].text, "ASC") ||
+                equalsIgnoringCase(tokens[termEnd - 1].text, "DESC"))) {
+            key.descending = equalsIgnoringCase(tokens[termEnd - 1].text, "DESC");
+            --termEnd;
+        }
+        if (!nullsGiven) {
+            key.nullsFirst = key.descending;
+        }
+        if (termEnd > first) {
+            const auto* begin = tokens[first].text.data();
+            const auto* finish = tokens[termEnd - 1].text.data() + tokens[termEnd - 1].text.size();
+            key.expression.assign(begin, finish);
+            keys.push_back(std::move(key));
+        }
+        first = last + 1;
+    }
+    return keys;
+}
+
+std::vector<std::string> loadFanoutTargets(const std::string& path) {
+    MappedFile file(path);
+    auto contents = file.contents();
+    std::vector<std::string> targets;
+    while (!contents.empty()) {
+        const auto end = std::min(contents.find('\n'), contents.size());
+        const auto line = trim(contents.substr(0, end));
+        contents.remove_prefix(std::min(end + 1, contents.size()));
+        if (!line.empty() && line.front() != '#') {
+            targets.emplace_back(line);
+        }
+    }
+    return targets;
+}
+
+FanoutQuery::FanoutQuery(ConnectionFactory newConnection, std::vector<std::string> targets, std::string sql,
+                         uint32_t maxWorkers)
+    : _newConnection(std::move(newConnection)),
+      _targets(std::move(targets)),
+      _sql(std::move(sql)),
+      _order(outerOrderBy(_sql)),
+      _outcomes(_targets.size())
+{
+    if (ordered()) {
+        if (_targets.size() > maxWorkers) {
+            throw std::runtime_error(fmt::format(
+                    "merging {} targets in ORDER BY order runs them all at once, and the fanout setting allows {}; "
+                    ".set fanout {} or more", _targets.size(), maxWorkers, _targets.size()));
+        }
+        _streams.resize(_targets.size());
+        _heads.resize(_targets.size());
+        _headRows.resize(_targets.size());
+    }
+    const auto workers = std::min<size_t>(std::max<uint32_t>(maxWorkers, 1), _targets.size());
+    _maxQueuedBatches = std::max<size_t>(workers, 1) * kMaxQueuedBatchesPerWorker;
+    _runningWorkers = workers;
+    for (size_t idx = 0; idx < workers; ++idx) {
+        _workers.emplace_back([this] { _work(); });
+    }
+}
+
+FanoutQuery::~FanoutQuery() {
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _stopping = true;
+        for (auto conn : _active) {
+            try {
+                conn->breakExecution();
+            } catch (const std::exception&) {
+                // The results are being thrown away either way.
+            }
+        }
+    }
+    _spaceReady.notify_all();
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+}
+
+std::optional<FanoutQuery::Batch> FanoutQuery::next() {
+    if (ordered()) {
+        return _nextMerged();
+    }
+    std::unique_lock<std::mutex> lk(_mutex);
+    _batchReady.wait(lk, [this] { return !_queue.empty() || _runningWorkers == 0; });
+    if (_queue.empty()) {
+        return std::nullopt;
+    }
+    auto batch = std::move(_queue.front());
+    _queue.pop_front();
+    lk.unlock();
+    _spaceReady.notify_one();
+    return batch;
+}
+
+std::vector<std::string> FanoutQuery::columnNames() const {
+    std::lock_guard<std::mutex> lk(_mutex);
+    return _columnNames;
+}
+
+std::optional<FanoutQuery::Batch> FanoutQuery::_nextMerged() {
+    auto later = [this](size_t left, size_t right) {
+        return _before(right, left);
+    };
+    if (!_merging) {
+        for (size_t target = 0; target < _targets.size(); ++target) {
+            _refill(target);
+            if (_heads[target].numRows > 0) {
+                _heap.push_back(target);
+            }
+        }
+        std::make_heap(_heap.begin(), _heap.end(), later);
+        _merging = true;
+    }
+
+    Batch merged;
+    const auto numColumns = _columnNames.size();
+    while (merged.numRows < kFetchArraySize && !_heap.empty()) {
+        std::pop_heap(_heap.begin(), _heap.end(), later);
+        const auto target = _heap.back();
+        auto& head = _heads[target];
+        const auto row = _headRows[target];
+        for (size_t col = 0; col < numColumns; ++col) {
+            merged.cells.push_back(std::move(head.cells[row * numColumns + col]));
+        }
+        merged.targets.push_back(target);
+        ++merged.numRows;
+        if (++_headRows[target] == head.numRows) {
+            _refill(target);
+        }
+        if (_heads[target].numRows > 0) {
+            std::push_heap(_heap.begin(), _heap.end(), later);
+        } else {
+            _heap.pop_back();
+        }
+    }
+    if (merged.numRows == 0) {
+        return std::nullopt;
+    }
+    return merged;
+}
+
+void FanoutQuery::_refill(size_t target) {
+    std::unique_lock<std::mutex> lk(_mutex);
+    auto& stream = _streams[target];
+    _batchReady.wait(lk, [&] { return !stream.queue.empty() || stream.done || !_orderError.empty(); });
+    if (!_orderError.empty()) {
+        throw std::runtime_error(_orderError);
+    }
+    _headRows[target] = 0;
+    if (stream.queue.empty()) {
+        _heads[target] = Batch();
+        return;
+    }
+    _heads[target] = std::move(stream.queue.front());
+    stream.queue.pop_front();
+    lk.unlock();
+    _spaceReady.notify_all();
+}
+
+bool FanoutQuery::_before(size_t left, size_t right) const {
+    const auto numKeys = _sortColumns.size();
+    const auto& leftValues = _heads[left].sortValues;
+    const auto& rightValues = _heads[right].sortValues;
+    const auto leftRow = _headRows[left];
+    const auto rightRow = _headRows[right];
+    for (size_t key = 0; key < numKeys; ++key) {
+        const auto& sort = _sortColumns[key];
+        const auto& leftValue = leftValues[leftRow * numKeys + key];
+        const auto& rightValue = rightValues[rightRow * numKeys + key];
+        if (!leftValue || !rightValue) {
+            if (leftValue.has_value() == rightValue.has_value()) {
+                continue;
+            }
+            return sort.nullsFirst ? !leftValue : !rightValue;
+        }
+        auto order = sort.numeric ? compareNumbers(*leftValue, *rightValue) : leftValue->compare(*rightValue);
+        if (order != 0) {
+            return sort.descending ? order > 0 : order < 0;
+        }
+    }
+    // Ties go in target order, which keeps the merge stable.
+    return left < right;
+}
+
+void FanoutQuery::_resolveOrder(const std::vector<std::string>& names, const std::vector<ColumnFormatter>& formatters) {
+    for (const auto& key : _order) {
+        std::string_view expression = key.expression;
+        std::optional<uint32_t> column;
+        uint32_t position = 0;
+        const auto parsed = std::from_chars(expression.data(), expression.data() + expression.size(), position);
+        if (parsed.ec == std::errc() && parsed.ptr == expression.data() + expression.size()) {
+            if (position >= 1 && position <= names.size()) {
+                column = position - 1;
+            }
+        } else {
+            // A column or alias, possibly qualified; quoted names are as they are.
+            std::string name;
+            if (expression.size() >= 2 && expression.back() == '"') {
+                const auto open = expression.rfind('"', expression.size() - 2);
+                if (open != std::string_view::npos && (open == 0 || expression[open - 1] == '.')) {
+                    name = expression.substr(open + 1, expression.size() - open - 2);
+                }
+            } else {
+                const auto dot = expression.rfind('.');
+                const auto last = dot == std::string_view::npos ? expression : expression.substr(dot + 1);
+                if (!last.empty() && std::all_of(last.begin(), last.end(), isWordChar)) {
+                    name.resize(last.size());
+                    std::transform(last.begin(), last.end(), name.begin(), [](char ch) {
+                        return static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+                    });
+                }
+            }
+            const auto found = std::find(names.begin(), names.end(), name);
+            if (!name.empty() && found != names.end()) {
+                column = static_cast<uint32_t>(found - names.begin());
+            }
+        }
+        if (!column) {
+            _orderError = fmt::format("can't merge the targets' rows in order: ORDER BY {} isn't one of the "
+                                      "query's columns; order by a column's name, alias or position", expression);
+            return;
+        }
+        const auto oracleType = formatters[*column].oracleType();
+        const bool numeric = oracleType == DPI_ORACLE_TYPE_NUMBER || oracleType == DPI_ORACLE_TYPE_NATIVE_DOUBLE ||
+                oracleType == DPI_ORACLE_TYPE_NATIVE_FLOAT || oracleType == DPI_ORACLE_TYPE_NATIVE_INT ||
+                oracleType == DPI_ORACLE_TYPE_NATIVE_UINT;
+        _sortColumns.push_back({*column, key.descending, key.nullsFirst, numeric});
+    }
+}
+
+void FanoutQuery::_push(size_t target, Batch batch) {
+    std::unique_lock<std::mutex> lk(_mutex);
+    auto* stream = ordered() ? &_streams[target] : nullptr;
+    _spaceReady.wait(lk, [&] {
+        return _stopping || (stream ? stream->queue.size() < kMaxQueuedBatchesPerTarget
+                                    : _queue.size() < _maxQueuedBatches);
+    });
+    if (_stopping) {
+        throw std::runtime_error("cancelled");
+    }
+    (stream ? stream->queue : _queue).push_back(std::move(batch));
+    lk.unlock();
+    if (stream) {
+        _batchReady.notify_all();
+    } else {
+        _batchReady.notify_one();
+    }
+}
+
+void FanoutQuery::_work() {
+    traceRecorder.nameThread("fanout");
+    for (;;) {
+        size_t target = 0;
+        {
+            std::lock_guard<std::mutex> lk(_mutex);
+            if (_stopping || _nextTarget == _targets.size()) {
+                break;
+            }
+            target = _nextTarget++;
+        }
+        auto& outcome = _outcomes[target];
+        const auto start = std::chrono::steady_clock::now();
+        try {
+            _runTarget(target, outcome);
+        } catch (const std::exception& e) {
+            outcome.failed = true;
+            outcome.message = errorMessage(e);
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        outcome.seconds = elapsed.count();
+        if (ordered()) {
+            {
+                std::lock_guard<std::mutex> lk(_mutex);
+                _streams[target].done = true;
+            }
+            _batchReady.notify_all();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        --_runningWorkers;
+    }
+    _batchReady.notify_all();
+}
+
+void FanoutQuery::_runTarget(size_t target, Outcome& outcome) {
+    TraceSpan span("fanout target");
+    auto conn = _newConnection(_targets[target]);
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        if (_stopping) {
+            throw std::runtime_error("cancelled");
+        }
+        _active.push_back(&conn);
+    }
+    struct Deactivate {
+        FanoutQuery& query;
+        OracleConnection* conn;
+        ~Deactivate() {
+            std::lock_guard<std::mutex> lk(query._mutex);
+            query._active.erase(std::find(query._active.begin(), query._active.end(), conn));
+        }
+    } deactivate{*this, &conn};
+
+    auto stmt = conn.prepareStatement(_sql);
+    stmt.setFetchArraySize(kFetchArraySize);
+    stmt.execute();
+    if (!stmt.isQuery()) {
+        const auto rows = stmt.isDML() ? stmt.rowCount() : 0;
+        conn.commit();
+        outcome.rows = rows;
+        outcome.message = stmt.isDML() ? fmt::format("{} {} affected", rows, rows == 1 ? "row" : "rows")
+            : "Statement executed";
+        return;
+    }
+
+    const auto numColumns = stmt.numColumns();
+    auto names = stmt.metadata()->names();
+    auto formatters = makeColumnFormatters(stmt);
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        if (!_haveColumns) {
+            _columnNames = names;
+            _haveColumns = true;
+            if (ordered()) {
+                _resolveOrder(names, formatters);
+            }
+        } else if (names != _columnNames) {
+            throw std::runtime_error("returned different columns than the other targets");
+        }
+        if (!_orderError.empty()) {
+            _stopping = true;
+            _spaceReady.notify_all();
+            _batchReady.notify_all();
+            throw std::runtime_error(_orderError);
+        }
+    }
+
+    fmt::memory_buffer text;
+    for (;;) {
+        auto block = stmt.fetchBlock(kFetchArraySize);
+        Batch batch;
+        batch.numRows = block.numRows();
+        batch.cells.reserve(static_cast<size_t>(block.numRows()) * numColumns);
+        batch.targets.assign(block.numRows(), target);
+        batch.sortValues.reserve(static_cast<size_t>(block.numRows()) * _sortColumns.size());
+        for (uint32_t col = 1; col <= numColumns; ++col) {
+            auto& formatter = formatters[col - 1];
+            if (formatter.nativeType() != block.nativeType(col)) {
+                formatter = ColumnFormatter(block.nativeType(col), formatter.oracleType());
+            }
+        }
+        for (uint32_t row = 0; row < block.numRows(); ++row) {
+            for (uint32_t col = 1; col <= numColumns; ++col) {
+                text.clear();
+                formatters[col - 1].format(block.columnData(col)[row], text);
+                batch.cells.emplace_back(text.data(), text.size());
+            }
+            const auto* cells = batch.cells.data() + static_cast<size_t>(row) * numColumns;
+            for (const auto& sort : _sortColumns) {
+                batch.sortValues.push_back(sortValue(block.columnData(sort.column + 1)[row],
+                                                     block.nativeType(sort.column + 1), cells[sort.column]));
+            }
+        }
+        outcome.rows += block.numRows();
+        if (batch.numRows > 0) {
+            _push(target, std::move(batch));
+        }
+        if (!block.moreRows()) {
+            break;
+        }
+    }
+    outcome.message = fmt::format("{} {} selected", outcome.rows, outcome.rows == 1 ? "row" : "rows");
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "oracle_helpers.h"
+#include "value_format.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace sqlplusplus {
+
+// Reads the connect strings of a .fanout targets file, one per line. Blank lines and lines
+// starting with # are skipped. Throws std::system_error when the file can't be read.
+std::vector<std::string> loadFanoutTargets(const std::string& path);
+
+// A term of a query's outermost ORDER BY: a column's name or alias, as written, or its
+// one-based position.
+struct FanoutOrderKey {
+    std::string expression;
+    bool descending = false;
+    // Oracle's default puts nulls last ascending and first descending.
+    bool nullsFirst = false;
+};
+
+// The terms of a query's outermost ORDER BY, the one after everything else at the top
+// level; empty if it has none, or sql isn't a query. Quotes, comments and parentheses are skipped over, so an ORDER BY
+// in a subquery or an analytic function's OVER doesn't count.
+std::vector<FanoutOrderKey> outerOrderBy(std::string_view sql);
+
+// Runs one statement against many databases at once, on a bounded pool of workers that
+// each connect to the next target as soon as they're done with their last, and merges
+// the rows of every target into one stream of batches in whatever order they arrive.
+// Workers block once enough batches are queued, so a slow reader never has more than a
+// few of them in memory.
+//
+// A query with an ORDER BY, whose terms are all columns of the result, is merged in that
+// order instead: every target runs at once, each into a queue of its own bounded at
+// kMaxQueuedBatchesPerTarget, and next() takes the least row of the targets' next ones
+// off a heap, so the merged rows are in order across all of them without any more being
+// held than that. A slow target holds the merge up, and with it the fast ones, whose
+// workers block on their full queues rather than buffer. The rows are compared by their
+// fetched values, numbers as numbers and datetimes in UTC, and text byte by byte, which
+// is the server's order with the default binary NLS_SORT.
+//
+// Queries are formatted the way the table shows them. Every target has to return the
+// columns the first one did; one that doesn't fails. Anything other than a query commits
+// on each target it succeeds on.
+class FanoutQuery {
+public:
+    using ConnectionFactory = std::function<OracleConnection(const std::string& connString)>;
+
+    struct Batch {
+        uint32_t numRows = 0;
+        // numRows rows of columnNames().size() cells each.
+        std::vector<std::string> cells;
+        // Each row's index into the targets.
+        std::vector<size_t> targets;
+        // numRows rows of a sort value per ORDER BY term, for merging; empty otherwise.
+        // Nulls have none.
+        std::vector<std::optional<std::string>> sortValues;
+    };
+
+    struct Outcome {
+        bool failed = false;
+        uint64_t rows = 0;
+        // Rows affected for DML, the error for a failed target.
+        std::string message;
+        double seconds = 0;
+    };
+
+    // Throws std::runtime_error for a query to be merged in order that has more targets
+    // than maxWorkers, which would leave some of them waiting for workers held up by the
+    // merge.
+    FanoutQuery(ConnectionFactory newConnection, std::vector<std::string> targets, std::string sql,
+                uint32_t maxWorkers);
+    FanoutQuery(const FanoutQuery&) = delete;
+    FanoutQuery& operator=(const FanoutQuery&) = delete;
+    // Breaks whatever is still running and waits for the workers.
+    ~FanoutQuery();
+
+    const std::vector<std::string>& targets() const noexcept {
+        return _targets;
+    }
+
+    // Whether the rows are merged in ORDER BY order.
+    bool ordered() const noexcept {
+        return !_order.empty();
+    }
+
+    // Blocks for the next batch from any target, or merged from all of them. Returns
+    // nullopt once every target is done. Throws std::runtime_error if the query's ORDER BY
+    // has a term that isn't one of its columns.
+    std::optional<Batch> next();
+    // Set before the first batch comes back; empty if no target ran a query.
+    std::vector<std::string> columnNames() const;
+    // After next() has returned nullopt: how each target went, in the order of targets().
+    const std::vector<Outcome>& outcomes() const noexcept {
+        return _outcomes;
+    }
+
+    static constexpr size_t kMaxQueuedBatchesPerWorker = 2;
+    static constexpr size_t kMaxQueuedBatchesPerTarget = 2;
+
+private:
+    // An ORDER BY term resolved against the columns.
+    struct SortColumn {
+        uint32_t column = 0;
+        bool descending = false;
+        bool nullsFirst = false;
+        bool numeric = false;
+    };
+    // A target's batches waiting to be merged.
+    struct Stream {
+        std::deque<Batch> queue;
+        bool done = false;
+    };
+
+    void _work();
+    void _runTarget(size_t target, Outcome& outcome);
+    void _push(size_t target, Batch batch);
+    // Called with _mutex held, by the first target to return columns.
+    void _resolveOrder(const std::vector<std::string>& names, const std::vector<ColumnFormatter>& formatters);
+    std::optional<Batch> _nextMerged();
+    // Blocks for target's next batch to merge, leaving it empty once the target is done.
+    void _refill(size_t target);
+    // Whether row of left's batch goes before row of right's.
+    bool _before(size_t left, size_t right) const;
+
+    const ConnectionFactory _newConnection;
+    const std::vector<std::string> _targets;
+    const std::string _sql;
+    const std::vector<FanoutOrderKey> _order;
+    std::vector<Outcome> _outcomes;
+    size_t _maxQueuedBatches = 0;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _batchReady;
+    std::condition_variable _spaceReady;
+    std::deque<Batch> _queue;
+    // Per target, when merging.
+    std::vector<Stream> _streams;
+    std::vector<SortColumn> _sortColumns;
+    // Why the ORDER BY couldn't be resolved, once a target has found it couldn't.
+    std::string _orderError;
+    // The merge's own, touched only by next(): the batch each target's next row is in,
+    // which row that is, and the targets that have one, as a heap.
+    std::vector<Batch> _heads;
+    std::vector<uint32_t> _headRows;
+    std::vector<size_t> _heap;
+    bool _merging = false;
+    size_t _nextTarget = 0;
+    size_t _runningWorkers = 0;
+    std::vector<std::string> _columnNames;
+    bool _haveColumns = false;
+    // Connections of the targets being run, so the destructor can break them.
+    std::vector<OracleConnection*> _active;
+    bool _stopping = false;
+    std::vector<std::thread> _workers;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,32 @@
+#include "fetch_bench.h"
+
+#include "oracle_helpers.h"
+
+#include <chrono>
+
+namespace sqlplusplus {
+
+FetchMeasurement drainResults(OracleResultSource& source) {
+    using Clock = std::chrono::steady_clock;
+    FetchMeasurement result;
+    const auto start = Clock::now();
+    for (;;) {
+        const auto fetchStart = Clock::now();
+        auto block = source.fetchBlock(source.fetchArraySize());
+        const std::chrono::duration<double> elapsed = Clock::now() - fetchStart;
+        if (block.numRows() > 0 && block.bufferRowIndex() == 0) {
+            ++result.roundTrips;
+            result.roundTripSeconds += elapsed.count();
+        }
+        result.rows += block.numRows();
+        result.bytes += block.valueBytes();
+        if (!block.moreRows()) {
+            break;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.finalArraySize = source.fetchArraySize();
+    return result;
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+namespace sqlplusplus {
+
+class OracleResultSource;
+
+struct FetchMeasurement {
+    uint64_t rows = 0;
+    // The values' sizes, as OracleFetchBlock::valueBytes() counts them.
+    uint64_t bytes = 0;
+    uint64_t roundTrips = 0;
+    double seconds = 0;
+    // Time spent in the fetches that went to the server, the rest having been served from
+    // rows already in the fetch buffers.
+    double roundTripSeconds = 0;
+    // The array size at the end, which an adaptive fetch may have moved.
+    uint32_t finalArraySize = 0;
+};
+
+// Fetches the rest of an executed query a fetch array at a time and counts what came back,
+// without decoding or formatting a single value, so what it measures is the server and the
+// network plus ODPI's own buffer handling.
+FetchMeasurement drainResults(OracleResultSource& source);
+
+} // namespace sqlplusplus
@@ -0,0 +1,175 @@
+#include "fetch_pipeline.h"
+
+#include "oracle_helpers.h"
+#include "trace_recorder.h"
+#include "value_format.h"
+#include "work_stealing.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace sqlplusplus {
+
+FetchPipeline::FetchPipeline(OracleResultSource& source, uint64_t maxRows)
+    : _source(source),
+      _maxRows(maxRows),
+      _maxFormatThreads(std::clamp<size_t>(sharedExecutorThreads() / 2, 1, kMaxFormatThreads)),
+      _fetcher([this] { _fetchLoop(); })
+{}
+
+FetchPipeline::~FetchPipeline() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _changed.notify_all();
+    _fetcher.join();
+}
+
+void FetchPipeline::_formatColumns(ColumnRange range, StringArena& storage) {
+    const auto& block = *_sharedBlock;
+    auto& batch = *_sharedBatch;
+    const auto numColumns = _formatters.size();
+    for (uint32_t col = range.first + 1; col <= range.end; ++col) {
+        const auto& formatter = _formatters[col - 1];
+        const auto columnData = block.columnData(col);
+        for (uint32_t row = 0; row < block.numRows(); ++row) {
+            const auto& data = columnData[row];
+            const auto sizeBound = formatter.sizeBound(data);
+            auto ptr = storage.allocate(sizeBound);
+            auto end = formatter.format(data, ptr);
+            const auto size = static_cast<size_t>(end - ptr);
+            storage.shrinkLast(sizeBound - size);
+            batch.cells[static_cast<size_t>(row) * numColumns + col - 1] = std::string_view(ptr, size);
+        }
+    }
+}
+
+void FetchPipeline::_formatBlock(const OracleFetchBlock& block, Batch& batch) {
+    const auto numColumns = static_cast<uint32_t>(_formatters.size());
+    bool hasLobs = false;
+    for (uint32_t col = 1; col <= numColumns; ++col) {
+        auto& formatter = _formatters[col - 1];
+        if (formatter.nativeType() != block.nativeType(col)) {
+            formatter = ColumnFormatter(block.nativeType(col), formatter.oracleType());
+        }
+        hasLobs = hasLobs || formatter.nativeType() == DPI_NATIVE_TYPE_LOB;
+    }
+
+    // LOB previews are read from the server through the statement's connection, so blocks
+    // with LOBs in them are formatted on this thread alone.
+    size_t numThreads = 1;
+    if (!hasLobs && static_cast<size_t>(block.numRows()) * numColumns >= kMinParallelCells) {
+        numThreads = std::clamp<size_t>(numColumns / kMinColumnsPerThread, 1, _maxFormatThreads);
+    }
+    if (batch.storage.size() < numThreads) {
+        batch.storage.resize(numThreads);
+    }
+    for (auto& storage : batch.storage) {
+        storage.reset();
+    }
+    batch.cells.resize(static_cast<size_t>(block.numRows()) * numColumns);
+
+    _sharedBlock = &block;
+    _sharedBatch = &batch;
+    if (numThreads == 1) {
+        _formatColumns({0, numColumns}, batch.storage.front());
+        return;
+    }
+
+    const auto fetchThread = std::this_thread::get_id();
+    WorkStealingExecutor::shared().runAll(numThreads, [&](size_t idx) {
+        const ColumnRange range{static_cast<uint32_t>(numColumns * idx / numThreads),
+                                static_cast<uint32_t>(numColumns * (idx + 1) / numThreads)};
+        // The fetch thread's own part is already inside its decode span.
+        if (std::this_thread::get_id() == fetchThread) {
+            _formatColumns(range, batch.storage[idx]);
+            return;
+        }
+        TraceSpan span("decode");
+        _formatColumns(range, batch.storage[idx]);
+    });
+}
+
+void FetchPipeline::_fetchLoop() {
+    traceRecorder.nameThread("fetch pipeline");
+    try {
+        _formatters = makeColumnFormatters(_source);
+        uint64_t fetched = 0;
+        bool moreRows = true;
+        while (moreRows && fetched < _maxRows) {
+            std::unique_ptr<Batch> batch;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _changed.wait(lock, [this] { return _stop || _ready.size() + _inFlight < kDepth; });
+                if (_stop) {
+                    return;
+                }
+                if (!_free.empty()) {
+                    batch = std::move(_free.back());
+                    _free.pop_back();
+                }
+            }
+            if (!batch) {
+                batch = std::make_unique<Batch>();
+            }
+
+            const auto fetchStart = StatementTiming::Clock::now();
+            const auto wanted = static_cast<uint32_t>(std::min<uint64_t>(_maxRows - fetched, UINT32_MAX));
+            auto block = _source.fetchBlock(wanted);
+            const auto formatStart = StatementTiming::Clock::now();
+            moreRows = block.moreRows();
+            fetched += block.numRows();
+
+            TraceSpan span("decode");
+            span.setArg("rows", block.numRows());
+            batch->numRows = block.numRows();
+            batch->roundTrip = block.bufferRowIndex() == 0;
+            _formatBlock(block, *batch);
+            const auto formatEnd = StatementTiming::Clock::now();
+            batch->fetchTime = formatStart - fetchStart;
+            batch->formatTime = formatEnd - formatStart;
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (batch->numRows > 0) {
+                _ready.push_back(std::move(batch));
+            } else {
+                _free.push_back(std::move(batch));
+            }
+            _moreRows = moreRows;
+            _changed.notify_all();
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _error = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    _done = true;
+    _changed.notify_all();
+}
+
+std::unique_ptr<FetchPipeline::Batch> FetchPipeline::next() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _changed.wait(lock, [this] { return !_ready.empty() || _done; });
+    if (_ready.empty()) {
+        if (_error) {
+            std::rethrow_exception(_error);
+        }
+        return nullptr;
+    }
+    auto batch = std::move(_ready.front());
+    _ready.pop_front();
+    ++_inFlight;
+    return batch;
+}
+
+void FetchPipeline::recycle(std::unique_ptr<Batch> batch) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        --_inFlight;
+        _free.push_back(std::move(batch));
+    }
+    _changed.notify_all();
+}
+
+} // namespace sqlplusplus
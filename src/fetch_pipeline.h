@@ -0,0 +1,113 @@
+#pragma once
+
+#include "arena.h"
+#include "statement_timing.h"
+#include "value_format.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace sqlplusplus {
+
+class OracleFetchBlock;
+class OracleResultSource;
+
+// Fetches and formats a query's rows on a thread of its own while the caller renders the
+// rows before them, so the round trip for the next block overlaps the time spent writing
+// out the last one rather than following it. Blocks point into the statement's define
+// buffers, which the next fetch overwrites, so each one is formatted into a batch of its
+// own before the thread fetches again. At most kDepth batches are in flight, and the
+// caller hands consumed ones back to be refilled.
+//
+// Formatting a block with many columns is split into up to kMaxFormatThreads ranges of
+// columns, run on the shared WorkStealingExecutor with each writing its values into an
+// arena of its own, so on a fast link a wide result isn't held to what one core can
+// format. The cells still come out in row order, since each range fills in its own
+// columns of every row.
+class FetchPipeline {
+public:
+    static constexpr size_t kDepth = 2;
+    static constexpr size_t kMaxFormatThreads = 8;
+    // Blocks smaller than this aren't worth waking other threads for.
+    static constexpr uint32_t kMinColumnsPerThread = 16;
+    static constexpr size_t kMinParallelCells = 16 * 1024;
+
+    struct Batch {
+        uint32_t numRows = 0;
+        // Row major, numColumns cells per row.
+        std::vector<std::string_view> cells;
+        // An arena for each thread that formatted part of the batch.
+        std::vector<StringArena> storage;
+        // Whether the block came from a round trip rather than rows left over in the
+        // fetch buffers, and how long fetching and formatting it took.
+        bool roundTrip = false;
+        StatementTiming::Clock::duration fetchTime{};
+        StatementTiming::Clock::duration formatTime{};
+    };
+
+    // Fetches no more than maxRows rows, so whatever is left stays on the cursor for the
+    // next page. source is only touched by the pipeline's thread until it's destroyed.
+    FetchPipeline(OracleResultSource& source, uint64_t maxRows);
+    FetchPipeline(const FetchPipeline&) = delete;
+    FetchPipeline& operator=(const FetchPipeline&) = delete;
+    // Stops fetching after the block in progress and waits for the thread.
+    ~FetchPipeline();
+
+    // The next batch of rows, or null once they've run out. Rethrows anything the fetch
+    // thread ran into.
+    std::unique_ptr<Batch> next();
+    // Returns a consumed batch, so its storage is reused for a later one.
+    void recycle(std::unique_ptr<Batch> batch);
+
+    // Whether the cursor had rows left when the pipeline stopped. Only meaningful once
+    // next() has returned null.
+    bool moreRows() const noexcept {
+        return _moreRows;
+    }
+
+private:
+    struct ColumnRange {
+        uint32_t first = 0;
+        uint32_t end = 0;
+    };
+
+    void _fetchLoop();
+    // Formats columns [range.first, range.end) of _sharedBlock into _sharedBatch.
+    void _formatColumns(ColumnRange range, StringArena& storage);
+    // Formats the block on this thread and as many of the shared executor's as it's wide
+    // enough for.
+    void _formatBlock(const OracleFetchBlock& block, Batch& batch);
+
+    OracleResultSource& _source;
+    const uint64_t _maxRows;
+
+    std::mutex _mutex;
+    std::condition_variable _changed;
+    std::deque<std::unique_ptr<Batch>> _ready;
+    std::vector<std::unique_ptr<Batch>> _free;
+    // Batches handed to the caller and not yet recycled.
+    size_t _inFlight = 0;
+    bool _done = false;
+    bool _moreRows = true;
+    bool _stop = false;
+    std::exception_ptr _error;
+
+    // Only touched by the fetch thread, and read by the executor tasks it waits for.
+    std::vector<ColumnFormatter> _formatters;
+    const size_t _maxFormatThreads;
+
+    // The block being formatted and the batch it's formatted into, for _formatColumns().
+    const OracleFetchBlock* _sharedBlock = nullptr;
+    Batch* _sharedBatch = nullptr;
+
+    std::thread _fetcher;
+};
+
+} // namespace sqlplusplus
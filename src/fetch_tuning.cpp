@@ -0,0 +1,48 @@
+#include "fetch_tuning.h"
+
+#include <algorithm>
+
+namespace sqlplusplus {
+
+FetchSizeTuner::FetchSizeTuner(uint64_t rowBytes, uint64_t targetBytes) {
+    rowBytes = std::max<uint64_t>(rowBytes, 1);
+    _maxArraySize = static_cast<uint32_t>(
+            std::clamp<uint64_t>(targetBytes * kMaxBatchFactor / rowBytes, kMinArraySize, kMaxArraySize));
+    _arraySize = _clamp(targetBytes / rowBytes);
+}
+
+uint32_t FetchSizeTuner::_clamp(uint64_t rows) const noexcept {
+    return static_cast<uint32_t>(std::clamp<uint64_t>(rows, kMinArraySize, _maxArraySize));
+}
+
+uint32_t FetchSizeTuner::observe(uint32_t rows, uint64_t bytes, Clock::duration latency) {
+    if (rows < _arraySize) {
+        return _arraySize;
+    }
+    if (latency > kMaxLatency) {
+        _arraySize = _clamp(_arraySize / 2);
+        _bestArraySize = 0;
+        _bestThroughput = 0;
+        _settled = true;
+        return _arraySize;
+    }
+
+    const auto seconds = std::max(std::chrono::duration<double>(latency).count(), 1e-6);
+    const auto throughput = static_cast<double>(bytes) / seconds;
+    if (throughput >= _bestThroughput * kMinGain) {
+        _bestThroughput = throughput;
+        _bestArraySize = _arraySize;
+        if (!_settled) {
+            _arraySize = _clamp(uint64_t{_arraySize} * 2);
+        }
+    } else if (_arraySize != _bestArraySize && throughput < _bestThroughput) {
+        _arraySize = _bestArraySize;
+        _settled = true;
+    } else {
+        // Close enough to the best not to be worth more memory.
+        _settled = true;
+    }
+    return _arraySize;
+}
+
+} // namespace sqlplusplus
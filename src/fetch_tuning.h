@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace sqlplusplus {
+
+// Picks a query's fetch array size, so narrow queries get thousands of rows a round trip
+// and wide ones aren't held to a few hundred kilobytes by hand-tuning. The first fetch is
+// sized for about targetBytes from each row's client buffer size; after that every full
+// round trip's throughput is measured and the size is doubled for as long as doubling it
+// keeps paying off by kMinGain. When a size does worse than the best seen it goes back to
+// the best, and a round trip slower than kMaxLatency halves it, so rows keep coming back
+// at an interactive pace over slow links. The size never puts more than kMaxBatchFactor
+// targets' worth of rows in the fetch buffers.
+class FetchSizeTuner {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr uint32_t kMinArraySize = 16;
+    static constexpr uint32_t kMaxArraySize = 64 * 1024;
+    static constexpr uint64_t kMaxBatchFactor = 16;
+    static constexpr double kMinGain = 1.1;
+    static constexpr Clock::duration kMaxLatency = std::chrono::milliseconds(500);
+
+    FetchSizeTuner(uint64_t rowBytes, uint64_t targetBytes);
+
+    uint32_t arraySize() const noexcept {
+        return _arraySize;
+    }
+
+    // Takes in a round trip that brought rows rows of bytes bytes in latency, and returns
+    // the array size for the next one. Round trips that came up short of arraySize() rows,
+    // the last of a query's, say nothing about the size and leave it be.
+    uint32_t observe(uint32_t rows, uint64_t bytes, Clock::duration latency);
+
+private:
+    uint32_t _clamp(uint64_t rows) const noexcept;
+
+    uint32_t _arraySize;
+    uint32_t _maxArraySize;
+    uint32_t _bestArraySize = 0;
+    double _bestThroughput = 0;
+    bool _settled = false;
+};
+
+} // namespace sqlplusplus
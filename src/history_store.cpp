@@ -0,0 +1,303 @@
+#include "history_store.h"
+
+#include "mapped_file.h"
+#include "trace_recorder.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sqlplusplus {
+namespace {
+
+// How far past maxEntries the file may grow from appends before loading rewrites it.
+constexpr size_t kRewriteFactor = 2;
+
+char lower(char ch) {
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+}
+
+uint32_t trigramAt(std::string_view text, size_t pos) {
+    return static_cast<uint32_t>(static_cast<unsigned char>(lower(text[pos]))) << 16 |
+        static_cast<uint32_t>(static_cast<unsigned char>(lower(text[pos + 1]))) << 8 |
+        static_cast<uint32_t>(static_cast<unsigned char>(lower(text[pos + 2])));
+}
+
+bool containsIgnoringCase(std::string_view haystack, std::string_view needle) {
+    return std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(),
+                       [](char left, char right) { return lower(left) == lower(right); }) != haystack.end();
+}
+
+void writeAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const auto written = ::write(fd, data.data(), data.size());
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "error writing history");
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+}
+
+} // namespace
+
+HistoryStore::HistoryStore(std::string path, size_t maxEntries)
+    : _path(std::move(path)),
+      _maxEntries(std::max<size_t>(maxEntries, 1)),
+      _worker([this] { _work(); })
+{}
+
+HistoryStore::~HistoryStore() {
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _stopping = true;
+    }
+    _pendingReady.notify_one();
+    _worker.join();
+}
+
+void HistoryStore::add(std::string_view line) {
+    std::string text(line);
+    std::replace(text.begin(), text.end(), '\n', ' ');
+    if (text.find_first_not_of(' ') == std::string::npos) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _pending.push_back(text);
+        _insertLocked(std::move(text));
+        _trimLocked();
+    }
+    _pendingReady.notify_one();
+}
+
+std::optional<std::vector<std::string>> HistoryStore::takeLoaded() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (!_loaded || _loadTaken) {
+        return std::nullopt;
+    }
+    _loadTaken = true;
+    return std::exchange(_loaded, std::vector<std::string>{});
+}
+
+size_t HistoryStore::numEntries() const {
+    std::lock_guard<std::mutex> lk(_mutex);
+    return _numLive;
+}
+
+const std::string* HistoryStore::_entryLocked(Sequence seq) const {
+    if (seq < _firstSequence || seq - _firstSequence >= _entries.size()) {
+        return nullptr;
+    }
+    const auto& entry = _entries[seq - _firstSequence];
+    return entry.empty() ? nullptr : &entry;
+}
+
+std::optional<std::string> HistoryStore::latestWithPrefix(std::string_view prefix) const {
+    std::lock_guard<std::mutex> lk(_mutex);
+    std::optional<Sequence> latest;
+    auto range = _latestByText.equal_prefix_range(prefix);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (!latest || it.value() > *latest) {
+            auto entry = _entryLocked(it.value());
+            if (entry != nullptr && entry->size() > prefix.size()) {
+                latest = it.value();
+            }
+        }
+    }
+    if (!latest) {
+        return std::nullopt;
+    }
+    return *_entryLocked(*latest);
+}
+
+std::vector<std::string> HistoryStore::search(std::string_view text, size_t maxResults) const {
+    std::vector<std::string> results;
+    std::lock_guard<std::mutex> lk(_mutex);
+    auto consider = [&](Sequence seq) {
+        auto entry = _entryLocked(seq);
+        if (entry != nullptr && containsIgnoringCase(*entry, text)) {
+            results.push_back(*entry);
+        }
+        return results.size() < maxResults;
+    };
+
+    if (text.size() < 3) {
+        for (auto seq = _firstSequence + _entries.size(); seq > _firstSequence && consider(seq - 1); --seq);
+        return results;
+    }
+
+    // Every match contains all of the text's trigrams, so the only candidates are the
+    // entries of its rarest one.
+    const std::vector<Sequence>* candidates = nullptr;
+    for (size_t pos = 0; pos + 3 <= text.size(); ++pos) {
+        auto it = _postings.find(trigramAt(text, pos));
+        if (it == _postings.end()) {
+            return results;
+        }
+        if (candidates == nullptr || it->second.size() < candidates->size()) {
+            candidates = &it->second;
+        }
+    }
+    for (auto it = candidates->rbegin(); it != candidates->rend() && consider(*it); ++it);
+    return results;
+}
+
+void HistoryStore::_insertLocked(std::string text) {
+    if (auto it = _latestByText.find(text); it != _latestByText.end()) {
+        if (_entryLocked(it.value()) != nullptr) {
+            _entries[it.value() - _firstSequence].clear();
+            --_numLive;
+        }
+    }
+    const auto seq = _firstSequence + _entries.size();
+    for (size_t pos = 0; pos + 3 <= text.size(); ++pos) {
+        auto& postings = _postings[trigramAt(text, pos)];
+        if (postings.empty() || postings.back() != seq) {
+            postings.push_back(seq);
+        }
+    }
+    _latestByText[text] = seq;
+    _entries.push_back(std::move(text));
+    ++_numLive;
+}
+
+void HistoryStore::_trimLocked() {
+    while (!_entries.empty() && (_numLive > _maxEntries || _entries.front().empty())) {
+        if (!_entries.front().empty()) {
+            _latestByText.erase(_entries.front());
+            --_numLive;
+        }
+        _entries.pop_front();
+        ++_firstSequence;
+        ++_droppedSinceCompaction;
+    }
+
+    if (_droppedSinceCompaction < _maxEntries) {
+        return;
+    }
+    _droppedSinceCompaction = 0;
+    for (auto it = _postings.begin(); it != _postings.end();) {
+        auto& postings = it->second;
+        postings.erase(std::remove_if(postings.begin(), postings.end(),
+                                      [this](Sequence seq) { return _entryLocked(seq) == nullptr; }),
+                       postings.end());
+        it = postings.empty() ? _postings.erase(it) : std::next(it);
+    }
+}
+
+void HistoryStore::_load() {
+    TraceSpan span("history load");
+    std::vector<std::string> lines;
+    size_t fileLines = 0;
+    try {
+        MappedFile file(_path);
+        file.adviseSequential();
+        auto contents = file.contents();
+        while (!contents.empty()) {
+            const auto end = std::min(contents.find('\n'), contents.size());
+            auto line = contents.substr(0, end);
+            contents.remove_prefix(std::min(end + 1, contents.size()));
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            if (!line.empty()) {
+                lines.emplace_back(line);
+                ++fileLines;
+            }
+        }
+    } catch (const std::system_error&) {
+        // No history yet.
+    }
+    if (lines.size() > _maxEntries) {
+        lines.erase(lines.begin(), lines.end() - static_cast<std::ptrdiff_t>(_maxEntries));
+    }
+
+    if (fileLines > _maxEntries * kRewriteFactor) {
+        // Written next to the file and renamed over it, so a crash leaves one or the other.
+        const auto tmpPath = _path + ".tmp";
+        int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd != -1) {
+            bool written = true;
+            try {
+                std::string out;
+                for (const auto& line : lines) {
+                    out.append(line).push_back('\n');
+                }
+                writeAll(fd, out);
+            } catch (const std::system_error&) {
+                written = false;
+            }
+            ::close(fd);
+            if (!written || ::rename(tmpPath.c_str(), _path.c_str()) == -1) {
+                ::unlink(tmpPath.c_str());
+            }
+        }
+    }
+
+    // Anything added while the file was being read is newer than all of it.
+    std::lock_guard<std::mutex> lk(_mutex);
+    std::vector<std::string> added;
+    for (auto& entry : _entries) {
+        if (!entry.empty()) {
+            added.push_back(std::move(entry));
+        }
+    }
+    _entries.clear();
+    _latestByText.clear();
+    _postings.clear();
+    _firstSequence = 0;
+    _numLive = 0;
+    _droppedSinceCompaction = 0;
+    for (const auto& line : lines) {
+        _insertLocked(line);
+    }
+    for (const auto& line : added) {
+        _insertLocked(line);
+    }
+    _trimLocked();
+    lines.insert(lines.end(), std::make_move_iterator(added.begin()), std::make_move_iterator(added.end()));
+    _loaded = std::move(lines);
+}
+
+void HistoryStore::_write(const std::vector<std::string>& lines) {
+    int fd = ::open(_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd == -1) {
+        return;
+    }
+    std::string out;
+    for (const auto& line : lines) {
+        out.append(line).push_back('\n');
+    }
+    try {
+        writeAll(fd, out);
+    } catch (const std::system_error&) {
+        // Like linenoise's own save, history that can't be written is just lost.
+    }
+    ::close(fd);
+}
+
+void HistoryStore::_work() {
+    traceRecorder.nameThread("history");
+    _load();
+    std::unique_lock<std::mutex> lk(_mutex);
+    for (;;) {
+        _pendingReady.wait(lk, [this] { return _stopping || !_pending.empty(); });
+        if (_pending.empty()) {
+            return;
+        }
+        auto lines = std::exchange(_pending, {});
+        lk.unlock();
+        _write(lines);
+        lk.lock();
+    }
+}
+
+} // namespace sqlplusplus
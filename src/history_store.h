@@ -0,0 +1,87 @@
+#pragma once
+
+#include "tsl/htrie_map.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace sqlplusplus {
+
+// The statements typed into the REPL, indexed for the prompt's history hints and for
+// .history searches. Entries are keyed in a trie by their text, so the latest entry
+// starting with what's been typed is a prefix walk, and every lower-cased trigram has a
+// posting list of the entries containing it, so a substring search only verifies entries
+// that contain all of its trigrams instead of scanning the whole history.
+//
+// The file is one entry per line, the format linenoise reads and writes. It's loaded on a
+// background thread, and new entries are appended to it from that thread, so neither
+// startup nor exit waits on a large history. A file that has grown well past maxEntries
+// is rewritten with just the latest ones after it's loaded.
+class HistoryStore {
+public:
+    HistoryStore(std::string path, size_t maxEntries);
+    HistoryStore(const HistoryStore&) = delete;
+    HistoryStore& operator=(const HistoryStore&) = delete;
+    // Waits for the entries still queued to be written.
+    ~HistoryStore();
+
+    // Newlines in line are stored as spaces, since the file holds an entry per line.
+    void add(std::string_view line);
+
+    // Once the file has been loaded, returns what it held followed by whatever was added
+    // while it was being read, oldest first, the first time it's called; nullopt before
+    // that and every time after.
+    std::optional<std::vector<std::string>> takeLoaded();
+
+    // The most recent entry that starts with prefix and is longer than it.
+    std::optional<std::string> latestWithPrefix(std::string_view prefix) const;
+    // Up to maxResults entries containing text, ignoring case, newest first.
+    std::vector<std::string> search(std::string_view text, size_t maxResults) const;
+
+    size_t numEntries() const;
+
+private:
+    using Sequence = uint64_t;
+
+    void _work();
+    void _load();
+    void _write(const std::vector<std::string>& lines);
+    // Indexes text as the newest entry. Called with _mutex held.
+    void _insertLocked(std::string text);
+    // Drops the oldest entries past _maxEntries. Called with _mutex held.
+    void _trimLocked();
+    const std::string* _entryLocked(Sequence seq) const;
+
+    const std::string _path;
+    const size_t _maxEntries;
+
+    mutable std::mutex _mutex;
+    // Entries by sequence number: _entries[0] is number _firstSequence. An entry repeated
+    // later is left where it was as an empty string, so positions never shift.
+    std::deque<std::string> _entries;
+    Sequence _firstSequence = 0;
+    size_t _numLive = 0;
+    tsl::htrie_map<char, Sequence> _latestByText;
+    // Ascending sequence numbers; entries that have since been dropped are skipped and
+    // pruned when the lists are compacted.
+    std::unordered_map<uint32_t, std::vector<Sequence>> _postings;
+    size_t _droppedSinceCompaction = 0;
+
+    std::optional<std::vector<std::string>> _loaded;
+    bool _loadTaken = false;
+
+    std::condition_variable _pendingReady;
+    std::vector<std::string> _pending;
+    bool _stopping = false;
+    std::thread _worker;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,354 @@
+#include "insert_batcher.h"
+
+#include "session.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace sqlplusplus {
+namespace {
+
+// Longest value a VARCHAR2 bind can carry with extended string sizes.
+constexpr size_t kMaxValueSize = 32767;
+
+bool isSpace(char ch) {
+    return std::isspace(static_cast<unsigned char>(ch)) != 0;
+}
+
+void skipSpaces(std::string_view sql, size_t& pos) {
+    while (pos < sql.size() && isSpace(sql[pos])) {
+        ++pos;
+    }
+}
+
+// Matches keyword, case-insensitively and as a whole word, at pos and moves past it.
+bool takeKeyword(std::string_view sql, size_t& pos, std::string_view keyword) {
+    skipSpaces(sql, pos);
+    if (sql.size() - pos < keyword.size()) {
+        return false;
+    }
+    for (size_t idx = 0; idx < keyword.size(); ++idx) {
+        if (std::tolower(static_cast<unsigned char>(sql[pos + idx])) != keyword[idx]) {
+            return false;
+        }
+    }
+    const auto end = pos + keyword.size();
+    if (end < sql.size() && (std::isalnum(static_cast<unsigned char>(sql[end])) || sql[end] == '_')) {
+        return false;
+    }
+    pos = end;
+    return true;
+}
+
+// Finds keyword, e.g. the VALUES that starts an insert's value list, skipping quoted
+// identifiers, and returns where it ends.
+size_t findKeyword(std::string_view sql, size_t pos, std::string_view keyword) {
+    while (pos < sql.size()) {
+        const auto ch = sql[pos];
+        if (ch == '"') {
+            auto end = sql.find('"', pos + 1);
+            if (end == std::string_view::npos) {
+                return std::string_view::npos;
+            }
+            pos = end + 1;
+        } else if (ch == '\'' || ch == '-' || ch == '/') {
+            // Strings, comments and expressions have no business in a table name.
+            return std::string_view::npos;
+        } else if ((pos == 0 || isSpace(sql[pos - 1]) || sql[pos - 1] == ')')) {
+            auto keywordEnd = pos;
+            if (takeKeyword(sql, keywordEnd, keyword)) {
+                return keywordEnd;
+            }
+            ++pos;
+        } else {
+            ++pos;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// Reads one literal at pos into value. Returns false for anything that isn't a plain
+// integer, string or NULL.
+bool takeLiteral(std::string_view sql, size_t& pos, std::string& value) {
+    skipSpaces(sql, pos);
+    if (pos >= sql.size()) {
+        return false;
+    }
+    value.clear();
+    if (sql[pos] == '\'') {
+        for (++pos; pos < sql.size(); ++pos) {
+            if (sql[pos] == '\'') {
+                if (pos + 1 < sql.size() && sql[pos + 1] == '\'') {
+                    value.push_back('\'');
+                    ++pos;
+                    continue;
+                }
+                ++pos;
+                return value.size() <= kMaxValueSize;
+            }
+            value.push_back(sql[pos]);
+        }
+        return false;
+    }
+    if (takeKeyword(sql, pos, "null")) {
+        return true;
+    }
+
+    const bool negative = sql[pos] == '-';
+    auto digits = negative ? pos + 1 : pos;
+    auto end = digits;
+    while (end < sql.size() && std::isdigit(static_cast<unsigned char>(sql[end]))) {
+        ++end;
+    }
+    if (end == digits || (end < sql.size() && (std::isalnum(static_cast<unsigned char>(sql[end])) ||
+            sql[end] == '.' || sql[end] == '_'))) {
+        return false;
+    }
+    pos = end;
+    // The literal 007 is the number 7, so that's what a text bind has to say too.
+    while (digits + 1 < end && sql[digits] == '0') {
+        ++digits;
+    }
+    if (negative && !(end - digits == 1 && sql[digits] == '0')) {
+        value.push_back('-');
+    }
+    value.append(sql.substr(digits, end - digits));
+    return true;
+}
+
+// Reads a column name, plain or "quoted" and optionally qualified, at pos into name.
+bool takeColumn(std::string_view sql, size_t& pos, std::string& name) {
+    skipSpaces(sql, pos);
+    name.clear();
+    while (pos < sql.size()) {
+        const auto ch = sql[pos];
+        if (ch == '"') {
+            const auto end = sql.find('"', pos + 1);
+            if (end == std::string_view::npos) {
+                return false;
+            }
+            name.append(sql.substr(pos, end + 1 - pos));
+            pos = end + 1;
+        } else if (std::isalnum(static_cast<unsigned char>(ch)) || ch == '_' || ch == '$' || ch == '#' || ch == '.') {
+            name.push_back(ch);
+            ++pos;
+        } else {
+            break;
+        }
+    }
+    return !name.empty();
+}
+
+// Reads "column = literal" pairs separated by separator (a comma, or the keyword and) into
+// out, with each literal replaced by the next bind, until something else comes along.
+bool takeAssignments(std::string_view sql, size_t& pos, std::string_view separator,
+                     ParameterizedStatement& out) {
+    std::string column;
+    std::string value;
+    for (;;) {
+        if (!takeColumn(sql, pos, column)) {
+            return false;
+        }
+        skipSpaces(sql, pos);
+        if (pos >= sql.size() || sql[pos] != '=') {
+            return false;
+        }
+        ++pos;
+        if (!takeLiteral(sql, pos, value)) {
+            return false;
+        }
+        out.values.push_back(value);
+        fmt::format_to(std::back_inserter(out.sql), "{} = :{}", column, out.values.size());
+        auto next = pos;
+        skipSpaces(sql, next);
+        const bool more = separator == "," ? next < sql.size() && sql[next] == ','
+                                           : takeKeyword(sql, next, separator);
+        if (!more) {
+            return true;
+        }
+        pos = separator == "," ? next + 1 : next;
+        fmt::format_to(std::back_inserter(out.sql), "{} ", separator == "," ? "," : " AND");
+    }
+}
+
+// WHERE column = literal [AND ...] to the end of the statement, or nothing when optional.
+bool takeWhere(std::string_view sql, size_t& pos, bool optional, ParameterizedStatement& out) {
+    skipSpaces(sql, pos);
+    if (pos == sql.size()) {
+        return optional;
+    }
+    if (!takeKeyword(sql, pos, "where")) {
+        return false;
+    }
+    out.sql.append(" WHERE ");
+    if (!takeAssignments(sql, pos, "and", out)) {
+        return false;
+    }
+    skipSpaces(sql, pos);
+    return pos == sql.size();
+}
+
+std::optional<ParameterizedStatement> parameterizeUpdate(std::string_view sql) {
+    size_t pos = 0;
+    if (!takeKeyword(sql, pos, "update")) {
+        return std::nullopt;
+    }
+    const auto setEnd = findKeyword(sql, pos, "set");
+    if (setEnd == std::string_view::npos) {
+        return std::nullopt;
+    }
+    ParameterizedStatement update;
+    update.kind = ParameterizedStatement::Kind::Update;
+    update.sql.assign(sql.substr(0, setEnd));
+    update.sql.push_back(' ');
+    pos = setEnd;
+    if (!takeAssignments(sql, pos, ",", update) || !takeWhere(sql, pos, true, update)) {
+        return std::nullopt;
+    }
+    return update;
+}
+
+std::optional<ParameterizedStatement> parameterizeDelete(std::string_view sql) {
+    size_t pos = 0;
+    if (!takeKeyword(sql, pos, "delete")) {
+        return std::nullopt;
+    }
+    auto wherePos = findKeyword(sql, pos, "where");
+    if (wherePos == std::string_view::npos) {
+        return std::nullopt;
+    }
+    // Back to the start of WHERE, which takeWhere() reads itself.
+    wherePos -= 5;
+    ParameterizedStatement del;
+    del.kind = ParameterizedStatement::Kind::Delete;
+    del.sql.assign(sql.substr(0, wherePos));
+    while (!del.sql.empty() && isSpace(del.sql.back())) {
+        del.sql.pop_back();
+    }
+    pos = wherePos;
+    if (!takeWhere(sql, pos, false, del)) {
+        return std::nullopt;
+    }
+    return del;
+}
+
+} // namespace
+
+std::optional<ParameterizedStatement> parameterizeInsert(std::string_view sql) {
+    size_t pos = 0;
+    if (!takeKeyword(sql, pos, "insert") || !takeKeyword(sql, pos, "into")) {
+        return std::nullopt;
+    }
+    const auto valuesEnd = findKeyword(sql, pos, "values");
+    if (valuesEnd == std::string_view::npos) {
+        return std::nullopt;
+    }
+    pos = valuesEnd;
+    skipSpaces(sql, pos);
+    if (pos >= sql.size() || sql[pos] != '(') {
+        return std::nullopt;
+    }
+    ++pos;
+
+    ParameterizedStatement insert;
+    insert.sql.assign(sql.substr(0, valuesEnd));
+    insert.sql.append(" (");
+    std::string value;
+    for (;;) {
+        if (!takeLiteral(sql, pos, value)) {
+            return std::nullopt;
+        }
+        insert.values.push_back(value);
+        fmt::format_to(std::back_inserter(insert.sql), "{}:{}",
+                insert.values.size() == 1 ? "" : ", ", insert.values.size());
+        skipSpaces(sql, pos);
+        if (pos < sql.size() && sql[pos] == ',') {
+            ++pos;
+            continue;
+        }
+        if (pos < sql.size() && sql[pos] == ')') {
+            ++pos;
+            break;
+        }
+        return std::nullopt;
+    }
+    skipSpaces(sql, pos);
+    if (pos != sql.size()) {
+        return std::nullopt;
+    }
+    insert.sql.push_back(')');
+    return insert;
+}
+
+std::optional<ParameterizedStatement> parameterizeDml(std::string_view sql) {
+    if (auto insert = parameterizeInsert(sql)) {
+        return insert;
+    }
+    if (auto update = parameterizeUpdate(sql)) {
+        return update;
+    }
+    return parameterizeDelete(sql);
+}
+
+void InsertBatcher::add(ParameterizedStatement insert, uint64_t line) {
+    if (_numRows == 0) {
+        _sql = std::move(insert.sql);
+        _kind = insert.kind;
+    }
+    for (auto& value : insert.values) {
+        _values.push_back(std::move(value));
+    }
+    _lines.push_back(line);
+    ++_numRows;
+}
+
+InsertBatcher::FlushResult InsertBatcher::flush(Session& session, dpiExecMode mode) {
+    FlushResult result;
+    if (_numRows == 0) {
+        return result;
+    }
+    const auto numRows = _numRows;
+    const auto numColumns = static_cast<uint32_t>(_values.size() / numRows);
+    auto values = std::move(_values);
+    auto lines = std::move(_lines);
+    _values.clear();
+    _lines.clear();
+    _numRows = 0;
+
+    auto stmt = session.prepareStatement(_sql);
+    auto& conn = session.connection();
+    std::vector<OracleVariable> vars;
+    vars.reserve(numColumns);
+    for (uint32_t col = 0; col < numColumns; ++col) {
+        size_t longest = 1;
+        for (uint32_t row = 0; row < numRows; ++row) {
+            longest = std::max(longest, values[row * numColumns + col].size());
+        }
+        OracleConnection::VariableOpts varopts;
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_VARCHAR;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+        varopts.opts = OracleConnection::VariableOpts::ByteBufferOpts{static_cast<uint32_t>(longest), true};
+        varopts.maxArraySize = numRows;
+        vars.push_back(conn.newArrayVariable(varopts));
+        for (uint32_t row = 0; row < numRows; ++row) {
+            vars.back().setFrom(row, values[row * numColumns + col]);
+        }
+        stmt.bindByPos(col + 1, vars.back());
+    }
+    stmt.executeMany(numRows, static_cast<dpiExecMode>(
+        mode | DPI_MODE_EXEC_BATCH_ERRORS | DPI_MODE_EXEC_ARRAY_DML_ROWCOUNTS));
+
+    result.kind = _kind;
+    result.statements = numRows;
+    for (auto count : stmt.rowCounts()) {
+        result.rowsAffected += count;
+    }
+    for (auto& error : stmt.batchErrors()) {
+        result.errors.push_back(InsertBatchError{lines.at(error.offset), std::move(error.message)});
+    }
+    return result;
+}
+
+} // namespace sqlplusplus
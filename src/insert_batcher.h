@@ -0,0 +1,93 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+class Session;
+
+// A DML statement whose values are all plain literals, rewritten to take them as binds, so
+// a run of them differing only in their values can go to the server as one executeMany.
+struct ParameterizedStatement {
+    enum class Kind { Insert, Update, Delete };
+
+    Kind kind = Kind::Insert;
+    // The statement with :1, :2, ... in place of the literals.
+    std::string sql;
+    // Values as they'd be converted by the server: strings unescaped, integers in canonical
+    // form, and NULL as empty, which Oracle reads as null.
+    std::vector<std::string> values;
+};
+
+// Only integer, string and NULL literals qualify. Other numbers don't, since a number bound
+// as text converts through NLS_NUMERIC_CHARACTERS where the literal wouldn't, and neither
+// does anything with an expression, a subquery or a trailing clause.
+std::optional<ParameterizedStatement> parameterizeInsert(std::string_view sql);
+// Inserts as above, and besides them UPDATE ... SET column = literal, ... [WHERE column =
+// literal AND ...] and DELETE ... WHERE column = literal AND ..., the same literals taken
+// the same way. Their text is put back together with a space around each =, so statements
+// that were spaced differently still share one normalized text.
+std::optional<ParameterizedStatement> parameterizeDml(std::string_view sql);
+
+struct InsertBatchError {
+    // Script line of the failing statement.
+    uint64_t line;
+    std::string message;
+};
+
+// Collects consecutive statements of the same parameterized text and runs them in one
+// executeMany, with batch errors on so one bad row is reported against its line without
+// losing the rest.
+class InsertBatcher {
+public:
+    explicit InsertBatcher(uint32_t maxRows) : _maxRows(std::max<uint32_t>(maxRows, 1)) {}
+
+    // Whether insert can join the pending rows; when it can't, flush() first.
+    bool accepts(const ParameterizedStatement& insert) const noexcept {
+        return _numRows == 0 || (_numRows < _maxRows && insert.sql == _sql);
+    }
+    void add(ParameterizedStatement insert, uint64_t line);
+
+    bool empty() const noexcept {
+        return _numRows == 0;
+    }
+    // The parameterized text of the pending rows.
+    const std::string& sql() const noexcept {
+        return _sql;
+    }
+    uint32_t numRows() const noexcept {
+        return _numRows;
+    }
+    // Script line of the first pending row.
+    uint64_t firstLine() const noexcept {
+        return _lines.empty() ? 0 : _lines.front();
+    }
+
+    struct FlushResult {
+        ParameterizedStatement::Kind kind = ParameterizedStatement::Kind::Insert;
+        uint32_t statements = 0;
+        uint64_t rowsAffected = 0;
+        std::vector<InsertBatchError> errors;
+    };
+    // Runs the pending rows, if any, and starts over. Anything but an error in individual
+    // rows throws, and the pending rows are dropped either way. mode is added to how the
+    // batch is executed, for DPI_MODE_EXEC_COMMIT_ON_SUCCESS.
+    FlushResult flush(Session& session, dpiExecMode mode = DPI_MODE_EXEC_DEFAULT);
+
+private:
+    uint32_t _maxRows;
+    std::string _sql;
+    ParameterizedStatement::Kind _kind = ParameterizedStatement::Kind::Insert;
+    uint32_t _numRows = 0;
+    // Row major, _numRows rows of however many values the statement takes.
+    std::vector<std::string> _values;
+    std::vector<uint64_t> _lines;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,51 @@
+#include "interrupt_watcher.h"
+
+#include <cerrno>
+#include <system_error>
+
+#include <pthread.h>
+
+namespace sqlplusplus {
+namespace {
+
+sigset_t interruptSignals() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    return signals;
+}
+
+} // namespace
+
+InterruptWatcher::InterruptWatcher(std::function<void()> onInterrupt) :
+    _onInterrupt(std::move(onInterrupt))
+{
+    const auto signals = interruptSignals();
+    if (auto rc = pthread_sigmask(SIG_BLOCK, &signals, &_previousMask); rc != 0) {
+        throw std::system_error(rc, std::generic_category(), "error blocking SIGINT");
+    }
+    _thread = std::thread([this] { _run(); });
+}
+
+InterruptWatcher::~InterruptWatcher() {
+    _stopping.store(true, std::memory_order_release);
+    pthread_kill(_thread.native_handle(), SIGINT);
+    _thread.join();
+    pthread_sigmask(SIG_SETMASK, &_previousMask, nullptr);
+}
+
+void InterruptWatcher::_run() {
+    const auto signals = interruptSignals();
+    for (;;) {
+        int signal = 0;
+        if (sigwait(&signals, &signal) != 0) {
+            continue;
+        }
+        if (_stopping.load(std::memory_order_acquire)) {
+            return;
+        }
+        _onInterrupt();
+    }
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+#include <signal.h>
+
+namespace sqlplusplus {
+
+// Turns SIGINT into calls to a callback on a thread of its own, where it's safe to do
+// things a signal handler can't, like calling into OCI. SIGINT is blocked in the thread
+// that constructs the watcher, and so in every thread started after it; construct it
+// before starting any other threads.
+class InterruptWatcher {
+public:
+    explicit InterruptWatcher(std::function<void()> onInterrupt);
+    InterruptWatcher(const InterruptWatcher&) = delete;
+    InterruptWatcher& operator=(const InterruptWatcher&) = delete;
+    ~InterruptWatcher();
+
+private:
+    void _run();
+
+    std::function<void()> _onInterrupt;
+    sigset_t _previousMask;
+    std::atomic<bool> _stopping{false};
+    std::thread _thread;
+};
+
+} // namespace sqlplusplus
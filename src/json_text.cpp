@@ -0,0 +1,241 @@
+#include "json_text.h"
+
+#include "escape_scan.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace sqlplusplus {
+namespace {
+
+// For each byte, the character that follows the backslash when it has to be escaped, 'u'
+// for the \u00XX form, or 0 for bytes that are copied as they are.
+constexpr std::array<char, 256> makeEscapeTable() {
+    std::array<char, 256> table{};
+    for (int ch = 0; ch < 0x20; ++ch) {
+        table[ch] = 'u';
+    }
+    table['\b'] = 'b';
+    table['\f'] = 'f';
+    table['\n'] = 'n';
+    table['\r'] = 'r';
+    table['\t'] = 't';
+    table['"'] = '"';
+    table['\\'] = '\\';
+    return table;
+}
+
+constexpr auto kEscapes = makeEscapeTable();
+constexpr std::string_view kHexDigits = "0123456789abcdef";
+
+char* append(char* out, std::string_view str) {
+    return std::copy(str.begin(), str.end(), out);
+}
+
+char* writeHexString(const dpiBytes& bytes, char* out) {
+    *out++ = '"';
+    for (uint32_t idx = 0; idx < bytes.length; ++idx) {
+        auto byte = static_cast<unsigned char>(bytes.ptr[idx]);
+        *out++ = kHexDigits[byte >> 4];
+        *out++ = kHexDigits[byte & 0xf];
+    }
+    *out++ = '"';
+    return out;
+}
+
+// Intervals are written as ISO 8601 durations.
+char* writeIntervalDS(const dpiIntervalDS& interval, char* out) {
+    const bool negative = interval.days < 0 || interval.hours < 0 || interval.minutes < 0 ||
+        interval.seconds < 0 || interval.fseconds < 0;
+    out = fmt::format_to(out, "\"{}P{}DT{}H{}M{}",
+            negative ? "-" : "",
+            std::abs(interval.days),
+            std::abs(interval.hours),
+            std::abs(interval.minutes),
+            std::abs(interval.seconds));
+    if (interval.fseconds != 0) {
+        out = fmt::format_to(out, ".{:09}", std::abs(interval.fseconds));
+    }
+    return append(out, "S\"");
+}
+
+char* writeIntervalYM(const dpiIntervalYM& interval, char* out) {
+    const bool negative = interval.years < 0 || interval.months < 0;
+    return fmt::format_to(out, "\"{}P{}Y{}M\"",
+            negative ? "-" : "",
+            std::abs(interval.years),
+            std::abs(interval.months));
+}
+
+constexpr size_t kIntervalSizeBound = 64;
+
+} // namespace
+
+char* writeJsonStringContents(std::string_view value, char* out) {
+    // Runs between escapes are found a vector at a time and copied whole; most strings are
+    // one run.
+    for (size_t pos = 0; pos < value.size();) {
+        const auto special = findJsonSpecial(value, pos);
+        std::memcpy(out, value.data() + pos, special - pos);
+        out += special - pos;
+        if (special == value.size()) {
+            break;
+        }
+        auto ch = static_cast<unsigned char>(value[special]);
+        *out++ = '\\';
+        *out++ = kEscapes[ch];
+        if (kEscapes[ch] == 'u') {
+            out = append(out, "00");
+            *out++ = kHexDigits[ch >> 4];
+            *out++ = kHexDigits[ch & 0xf];
+        }
+        pos = special + 1;
+    }
+    return out;
+}
+
+char* writeJsonString(std::string_view value, char* out) {
+    *out++ = '"';
+    out = writeJsonStringContents(value, out);
+    *out++ = '"';
+    return out;
+}
+
+char* writeJsonTimestamp(const dpiTimestamp& ts, char* out) {
+    out = fmt::format_to(out, "\"{:04}-{:02}-{:02}T{:02}:{:02}:{:02}",
+            ts.year, ts.month, ts.day, ts.hour, ts.minute, ts.second);
+    if (ts.fsecond != 0) {
+        out = fmt::format_to(out, ".{:09}", ts.fsecond);
+    }
+    if (ts.tzHourOffset != 0 || ts.tzMinuteOffset != 0) {
+        const bool negative = ts.tzHourOffset < 0 || ts.tzMinuteOffset < 0;
+        out = fmt::format_to(out, "{}{:02}:{:02}",
+                negative ? '-' : '+',
+                std::abs(ts.tzHourOffset),
+                std::abs(ts.tzMinuteOffset));
+    }
+    *out++ = '"';
+    return out;
+}
+
+char* writeJsonDouble(double value, char* out) {
+    if (!std::isfinite(value)) {
+        return append(out, "null");
+    }
+    return fmt::format_to(out, "{}", value);
+}
+
+size_t jsonNodeSizeBound(const dpiJsonNode& node) {
+    switch (node.nativeTypeNum) {
+    case DPI_NATIVE_TYPE_JSON_OBJECT: {
+        const auto& obj = node.value->asJsonObject;
+        // Braces, plus a colon and a comma per field.
+        size_t size = 2 + obj.numFields * 2;
+        for (uint32_t idx = 0; idx < obj.numFields; ++idx) {
+            size += jsonStringSizeBound(obj.fieldNameLengths[idx]);
+            size += jsonNodeSizeBound(obj.fields[idx]);
+        }
+        return size;
+    }
+    case DPI_NATIVE_TYPE_JSON_ARRAY: {
+        const auto& arr = node.value->asJsonArray;
+        size_t size = 2 + arr.numElements;
+        for (uint32_t idx = 0; idx < arr.numElements; ++idx) {
+            size += jsonNodeSizeBound(arr.elements[idx]);
+        }
+        return size;
+    }
+    case DPI_NATIVE_TYPE_BYTES: {
+        const auto length = node.value->asBytes.length;
+        if (node.oracleTypeNum == DPI_ORACLE_TYPE_NUMBER) {
+            return length;
+        }
+        if (node.oracleTypeNum == DPI_ORACLE_TYPE_RAW) {
+            return static_cast<size_t>(length) * 2 + 2;
+        }
+        return jsonStringSizeBound(length);
+    }
+    case DPI_NATIVE_TYPE_DOUBLE:
+    case DPI_NATIVE_TYPE_FLOAT:
+        return kJsonDoubleSizeBound;
+    case DPI_NATIVE_TYPE_INT64:
+    case DPI_NATIVE_TYPE_UINT64:
+        return 20;
+    case DPI_NATIVE_TYPE_TIMESTAMP:
+        return kJsonTimestampSizeBound;
+    case DPI_NATIVE_TYPE_INTERVAL_DS:
+    case DPI_NATIVE_TYPE_INTERVAL_YM:
+        return kIntervalSizeBound;
+    default:
+        // Booleans, nulls and anything unrecognized, which is written as null.
+        return 5;
+    }
+}
+
+char* writeJsonNode(const dpiJsonNode& node, char* out) {
+    const auto& value = *node.value;
+    switch (node.nativeTypeNum) {
+    case DPI_NATIVE_TYPE_JSON_OBJECT: {
+        const auto& obj = value.asJsonObject;
+        *out++ = '{';
+        for (uint32_t idx = 0; idx < obj.numFields; ++idx) {
+            if (idx > 0) {
+                *out++ = ',';
+            }
+            out = writeJsonString(std::string_view(obj.fieldNames[idx], obj.fieldNameLengths[idx]), out);
+            *out++ = ':';
+            out = writeJsonNode(obj.fields[idx], out);
+        }
+        *out++ = '}';
+        return out;
+    }
+    case DPI_NATIVE_TYPE_JSON_ARRAY: {
+        const auto& arr = value.asJsonArray;
+        *out++ = '[';
+        for (uint32_t idx = 0; idx < arr.numElements; ++idx) {
+            if (idx > 0) {
+                *out++ = ',';
+            }
+            out = writeJsonNode(arr.elements[idx], out);
+        }
+        *out++ = ']';
+        return out;
+    }
+    case DPI_NATIVE_TYPE_BYTES: {
+        const auto& bytes = value.asBytes;
+        if (node.oracleTypeNum == DPI_ORACLE_TYPE_NUMBER) {
+            return std::copy(bytes.ptr, bytes.ptr + bytes.length, out);
+        }
+        if (node.oracleTypeNum == DPI_ORACLE_TYPE_RAW) {
+            return writeHexString(bytes, out);
+        }
+        return writeJsonString(std::string_view(bytes.ptr, bytes.length), out);
+    }
+    case DPI_NATIVE_TYPE_DOUBLE:
+        return writeJsonDouble(value.asDouble, out);
+    case DPI_NATIVE_TYPE_FLOAT:
+        return writeJsonDouble(value.asFloat, out);
+    case DPI_NATIVE_TYPE_INT64:
+        return std::to_chars(out, out + 20, value.asInt64).ptr;
+    case DPI_NATIVE_TYPE_UINT64:
+        return std::to_chars(out, out + 20, value.asUint64).ptr;
+    case DPI_NATIVE_TYPE_BOOLEAN:
+        return append(out, value.asBoolean ? "true" : "false");
+    case DPI_NATIVE_TYPE_TIMESTAMP:
+        return writeJsonTimestamp(value.asTimestamp, out);
+    case DPI_NATIVE_TYPE_INTERVAL_DS:
+        return writeIntervalDS(value.asIntervalDS, out);
+    case DPI_NATIVE_TYPE_INTERVAL_YM:
+        return writeIntervalYM(value.asIntervalYM, out);
+    default:
+        return append(out, "null");
+    }
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "dpi.h"
+
+#include <cstddef>
+#include <string_view>
+
+namespace sqlplusplus {
+
+// JSON text for result values. Like the ValueFormatFn routines, each writer fills caller
+// reserved storage and returns the end of what it wrote, and each has a matching size bound.
+
+// Every byte could need the six byte \u00XX form, plus the quotes.
+constexpr size_t jsonStringSizeBound(size_t length) noexcept {
+    return length * 6 + 2;
+}
+
+// Writes value as a quoted JSON string. Text is expected to be UTF-8, which passes through
+// unchanged; quotes, backslashes and control characters are escaped.
+char* writeJsonString(std::string_view value, char* out);
+// The escaped text of value without the surrounding quotes, for callers that write long
+// strings in pieces.
+char* writeJsonStringContents(std::string_view value, char* out);
+
+// Timestamps are written as quoted ISO 8601 text, with the fraction and offset only when
+// they're set.
+constexpr size_t kJsonTimestampSizeBound = 48;
+char* writeJsonTimestamp(const dpiTimestamp& ts, char* out);
+
+// Non-finite values have no JSON representation and are written as null.
+constexpr size_t kJsonDoubleSizeBound = 32;
+char* writeJsonDouble(double value, char* out);
+
+// Native (OSON) JSON documents, as returned by dpiJson_getValue(). Numbers are expected as
+// text (DPI_JSON_OPT_NUMBER_AS_STRING) and are written unquoted, so no precision is lost.
+size_t jsonNodeSizeBound(const dpiJsonNode& node);
+char* writeJsonNode(const dpiJsonNode& node, char* out);
+
+} // namespace sqlplusplus
@@ -0,0 +1,88 @@
+#include "keyword_cache.h"
+
+#include "cache_file.h"
+#include "mapped_file.h"
+#include "typed_rows.h"
+
+#include "fmt/format.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+
+namespace sqlplusplus {
+namespace {
+
+constexpr std::string_view kKeywordCacheMagic = "SQLPPKW1";
+
+} // namespace
+
+tsl::htrie_set<char> fetchReservedKeywords(OracleConnection& conn) {
+    tsl::htrie_set<char> out;
+    constexpr static std::string_view selectKeywordsStmtStr
+        ("select lower(KEYWORD) from V$RESERVED_WORDS where LENGTH(KEYWORD) > 1");
+
+    // There are a couple of thousand of them, so prefetching them all with the execute
+    // makes loading them a single round trip.
+    constexpr static uint32_t kKeywordFetchArraySize = 4096;
+
+    auto selectKeywordsStmt = conn.prepareStatement(selectKeywordsStmtStr);
+    selectKeywordsStmt.setFetchArraySize(kKeywordFetchArraySize);
+    selectKeywordsStmt.setPrefetchRows(kKeywordFetchArraySize);
+    selectKeywordsStmt.execute();
+    forEachRow<std::string_view>(selectKeywordsStmt, [&out](std::string_view keyword) { out.insert(keyword); });
+
+    return out;
+}
+
+std::filesystem::path userCacheDirectory() {
+    if (auto xdgCache = ::getenv("XDG_CACHE_HOME"); xdgCache != nullptr && *xdgCache != '\0') {
+        return std::filesystem::path(xdgCache) / "sqlplusplus";
+    }
+    if (auto home = ::getenv("HOME"); home != nullptr && *home != '\0') {
+        return std::filesystem::path(home) / ".cache" / "sqlplusplus";
+    }
+    return {};
+}
+
+std::filesystem::path keywordCachePath(const OracleServerVersion& version) {
+    auto dir = userCacheDirectory();
+    if (dir.empty()) {
+        return {};
+    }
+    const auto& info = version.versionInfo;
+    return dir / fmt::format("keywords-{}.{}.{}.{}.{}",
+            info.versionNum, info.releaseNum, info.updateNum, info.portReleaseNum, info.portUpdateNum);
+}
+
+std::optional<tsl::htrie_set<char>> loadKeywordCache(const std::filesystem::path& path) {
+    if (path.empty()) {
+        return std::nullopt;
+    }
+
+    try {
+        MappedFile file(path.string());
+        auto contents = file.contents();
+        if (contents.substr(0, kKeywordCacheMagic.size()) != kKeywordCacheMagic) {
+            return std::nullopt;
+        }
+        CacheDeserializer deserializer(contents.substr(kKeywordCacheMagic.size()));
+        return tsl::htrie_set<char>::deserialize(deserializer);
+    } catch (const std::exception&) {
+        // Missing, unreadable or corrupt caches are just refetched.
+        return std::nullopt;
+    }
+}
+
+void saveKeywordCache(const std::filesystem::path& path, const tsl::htrie_set<char>& keywords) {
+    if (path.empty()) {
+        return;
+    }
+
+    CacheSerializer serializer;
+    serializer(kKeywordCacheMagic.data(), kKeywordCacheMagic.size());
+    keywords.serialize(serializer);
+    replaceCacheFile(path, serializer.data());
+}
+
+} // namespace sqlplusplus
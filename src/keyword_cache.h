@@ -0,0 +1,30 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include "tsl/htrie_set.h"
+
+#include <filesystem>
+#include <optional>
+
+namespace sqlplusplus {
+
+// Reserved words only change with the server release, so they're cached on disk per server
+// version and the V$RESERVED_WORDS query only runs the first time a version is seen. Cache
+// files are hat-trie serializations that are memory-mapped back in.
+
+// The words in V$RESERVED_WORDS longer than a letter, lower case, in one round trip.
+tsl::htrie_set<char> fetchReservedKeywords(OracleConnection& conn);
+
+// $XDG_CACHE_HOME/sqlplusplus or ~/.cache/sqlplusplus; empty if neither can be determined.
+std::filesystem::path userCacheDirectory();
+
+std::filesystem::path keywordCachePath(const OracleServerVersion& version);
+
+// Returns nullopt if there's no usable cache file at path.
+std::optional<tsl::htrie_set<char>> loadKeywordCache(const std::filesystem::path& path);
+
+// Writes the cache atomically (write to a temp file then rename). Throws on I/O errors.
+void saveKeywordCache(const std::filesystem::path& path, const tsl::htrie_set<char>& keywords);
+
+} // namespace sqlplusplus
@@ -0,0 +1,218 @@
+#include "load_generator.h"
+
+#include "arena.h"
+#include "csv_load.h"
+#include "mapped_file.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+
+namespace sqlplusplus {
+namespace {
+
+struct WorkerResult {
+    uint64_t failures = 0;
+    std::string firstError;
+    uint64_t rowsFetched = 0;
+    std::vector<uint32_t> latenciesMicros;
+};
+
+// Lets the workers connect and prepare in parallel, then start executing together.
+class StartGate {
+public:
+    explicit StartGate(uint32_t workers) : _waiting(workers) {}
+
+    // Called by each worker once it's ready, or has failed getting there.
+    void arrive() {
+        std::lock_guard<std::mutex> lk(_mutex);
+        --_waiting;
+        _changed.notify_all();
+    }
+
+    void waitForWorkers() {
+        std::unique_lock<std::mutex> lk(_mutex);
+        _changed.wait(lk, [this] { return _waiting == 0; });
+    }
+
+    void open() {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _open = true;
+        _changed.notify_all();
+    }
+
+    void waitForOpen() {
+        std::unique_lock<std::mutex> lk(_mutex);
+        _changed.wait(lk, [this] { return _open; });
+    }
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _changed;
+    uint32_t _waiting;
+    bool _open = false;
+};
+
+double percentile(const std::vector<uint32_t>& sorted, double fraction) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    const auto rank = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+} // namespace
+
+LoadRunResult runLoad(const std::function<OracleConnection()>& newConnection,
+                      std::string_view sql,
+                      const LoadRunOptions& opts) {
+    const auto threads = std::max<uint32_t>(opts.threads, 1);
+    const auto numBinds = opts.bindRows.empty() ? size_t{0} : opts.bindRows.front().size();
+    for (const auto& row : opts.bindRows) {
+        if (row.size() != numBinds) {
+            throw std::runtime_error("every bind row needs the same number of values");
+        }
+    }
+    // One bind buffer per position, big enough for the longest value it will be given.
+    std::vector<uint32_t> bindSizes(numBinds, 1);
+    for (const auto& row : opts.bindRows) {
+        for (size_t pos = 0; pos < numBinds; ++pos) {
+            bindSizes[pos] = std::max(bindSizes[pos], static_cast<uint32_t>(row[pos].size()));
+        }
+    }
+
+    StartGate gate(threads);
+    auto worker = [&](uint32_t workerIdx) {
+        WorkerResult result;
+        std::optional<OracleConnection> conn;
+        std::optional<OracleStatement> stmt;
+        std::vector<OracleVariable> binds;
+        try {
+            conn.emplace(newConnection());
+            stmt.emplace(conn->prepareStatement(sql));
+            for (size_t pos = 0; pos < numBinds; ++pos) {
+                OracleConnection::VariableOpts varopts;
+                varopts.dbTypeNum = DPI_ORACLE_TYPE_VARCHAR;
+                varopts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+                varopts.opts = OracleConnection::VariableOpts::ByteBufferOpts{bindSizes[pos], true};
+                varopts.maxArraySize = 1;
+                binds.push_back(conn->newArrayVariable(varopts));
+                stmt->bindByPos(static_cast<uint32_t>(pos + 1), binds.back());
+            }
+            stmt->setFetchArraySize(opts.fetchArraySize);
+        } catch(...) {
+            gate.arrive();
+            throw;
+        }
+        gate.arrive();
+        gate.waitForOpen();
+
+        result.latenciesMicros.reserve(opts.iterations);
+        for (uint64_t iteration = 0; iteration < opts.iterations; ++iteration) {
+            const auto start = std::chrono::steady_clock::now();
+            try {
+                if (numBinds != 0) {
+                    // Threads start at different rows so they aren't all binding the same values.
+                    const auto& row = opts.bindRows[(iteration * threads + workerIdx) % opts.bindRows.size()];
+                    for (size_t pos = 0; pos < numBinds; ++pos) {
+                        binds[pos].setFrom(0, row[pos]);
+                    }
+                }
+                stmt->execute();
+                if (stmt->numColumns() > 0) {
+                    for (;;) {
+                        auto block = stmt->fetchBlock(opts.fetchArraySize);
+                        result.rowsFetched += block.numRows();
+                        if (!block.moreRows()) {
+                            break;
+                        }
+                    }
+                }
+            } catch(const std::exception& e) {
+                if (result.failures++ == 0) {
+                    result.firstError = e.what();
+                }
+                continue;
+            }
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            result.latenciesMicros.push_back(static_cast<uint32_t>(std::min<int64_t>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count(),
+                    std::numeric_limits<uint32_t>::max())));
+        }
+        try {
+            conn->rollback();
+        } catch(const std::exception&) {
+            // The connection is going away either way.
+        }
+        return result;
+    };
+
+    std::vector<std::future<WorkerResult>> workers;
+    for (uint32_t idx = 0; idx < threads; ++idx) {
+        workers.push_back(std::async(std::launch::async, worker, idx));
+    }
+    gate.waitForWorkers();
+    const auto start = std::chrono::steady_clock::now();
+    gate.open();
+
+    LoadRunResult result;
+    std::vector<uint32_t> latencies;
+    std::exception_ptr firstError;
+    for (auto& future : workers) {
+        try {
+            auto part = future.get();
+            result.failures += part.failures;
+            if (result.firstError.empty()) {
+                result.firstError = std::move(part.firstError);
+            }
+            result.rowsFetched += part.rowsFetched;
+            latencies.insert(latencies.end(), part.latenciesMicros.begin(), part.latenciesMicros.end());
+        } catch(...) {
+            if (!firstError) {
+                firstError = std::current_exception();
+            }
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+
+    result.executions = latencies.size() + result.failures;
+    result.seconds = elapsed.count();
+    std::sort(latencies.begin(), latencies.end());
+    if (!latencies.empty()) {
+        result.meanMicros = std::accumulate(latencies.begin(), latencies.end(), 0.0) / latencies.size();
+        result.maxMicros = latencies.back();
+    }
+    result.p50Micros = percentile(latencies, 0.50);
+    result.p95Micros = percentile(latencies, 0.95);
+    result.p99Micros = percentile(latencies, 0.99);
+    return result;
+}
+
+std::vector<std::vector<std::string>> loadBindRows(const std::string& path) {
+    MappedFile file(path);
+    CsvReader reader(file.contents());
+    StringArena scratch;
+    std::vector<std::string_view> fields;
+    std::vector<std::vector<std::string>> rows;
+    while (reader.nextRecord(fields, scratch)) {
+        rows.emplace_back(fields.begin(), fields.end());
+        scratch.reset();
+    }
+    if (rows.empty()) {
+        throw std::runtime_error(fmt::format("{} has no bind rows", path));
+    }
+    return rows;
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+struct LoadRunOptions {
+    // Connections running the statement at once, each on its own thread.
+    uint32_t threads = 1;
+    // Executions per thread.
+    uint64_t iterations = 1;
+    // Positional bind values, one row per execution, cycled through when there are fewer
+    // rows than executions. Every row needs as many values as the statement has binds.
+    std::vector<std::vector<std::string>> bindRows;
+    uint32_t fetchArraySize = 100;
+};
+
+struct LoadRunResult {
+    uint64_t executions = 0;
+    uint64_t failures = 0;
+    // The first failure's message, when there were any.
+    std::string firstError;
+    uint64_t rowsFetched = 0;
+    // Wall clock time from when every thread was connected and prepared until the last
+    // one finished.
+    double seconds = 0;
+    // Latencies of the successful executions, in microseconds, each covering the execute
+    // and fetching every row it returned.
+    double meanMicros = 0;
+    double p50Micros = 0;
+    double p95Micros = 0;
+    double p99Micros = 0;
+    double maxMicros = 0;
+};
+
+// Runs sql opts.iterations times on each of opts.threads connections from newConnection
+// and reports throughput and latency percentiles. The connections are set up and the
+// statement prepared on every one of them before the clock starts, so the numbers only
+// cover the executions. Failed executions are counted and the run carries on; anything a
+// statement changed is rolled back at the end. Throws if a connection or prepare fails.
+LoadRunResult runLoad(const std::function<OracleConnection()>& newConnection,
+                      std::string_view sql,
+                      const LoadRunOptions& opts);
+
+// Reads bind rows for LoadRunOptions from a CSV file, one row per record.
+std::vector<std::vector<std::string>> loadBindRows(const std::string& path);
+
+} // namespace sqlplusplus
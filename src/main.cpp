@@ -1,8 +1,77 @@
+#include "async_output.h"
 
+#include "background_jobs.h"
+#include "bind_variables.h"
+#include "broker.h"
+#include "bulk_dml.h"
+#include "checkpoint.h"
+#include "change_events.h"
 #include "cli_args.h"
+#include "client_counters.h"
+#include "columnar_result.h"
+#include "commit_policy.h"
+#include "completion.h"
+#include "connect_string.h"
+#include "csv_load.h"
+#include "data_compare.h"
+#include "data_generator.h"
+#include "datetime_format.h"
+#include "delimited_writer.h"
+#include "describe_cache.h"
+#include "export_queue.h"
 #include "dpi.h"
+#include "fanout.h"
+#include "fetch_bench.h"
+#include "fetch_pipeline.h"
+#include "history_store.h"
+#include "insert_batcher.h"
+#include "interrupt_watcher.h"
+#include "keyword_cache.h"
+#include "load_generator.h"
+#include "mapped_file.h"
+#include "metrics_exporter.h"
+#include "ndjson_writer.h"
+#include "open_results.h"
 #include "oracle_helpers.h"
+#include "output_throttle.h"
+#include "pager.h"
+#include "parallel_block.h"
+#include "parallel_export.h"
+#include "parquet_reader.h"
+#include "parquet_writer.h"
+#include "piped_command.h"
+#include "plsql_call.h"
+#include "progress_monitor.h"
+#include "result_cache.h"
+#include "result_metadata.h"
+#include "result_summary.h"
+#include "schema_ddl.h"
+#include "schema_index.h"
+#include "script_check.h"
+#include "session.h"
+#include "session_stats.h"
+#include "session_targets.h"
+#include "sql_keywords.h"
+#include "sql_splitter.h"
+#include "sql_trace.h"
+#include "sqlite_offload.h"
+#include "statement_timing.h"
 #include "table.h"
+#include "table_checksum.h"
+#include "table_copy.h"
+#include "table_dump.h"
+#include "terminal.h"
+#include "top_sql.h"
+#include "trace_recorder.h"
+#include "typed_bind.h"
+#include "typed_rows.h"
+#include "value_format.h"
+#include "vertical_layout.h"
+#include "wait_monitor.h"
+#include "watch_view.h"
+#include "work_stealing.h"
+#include "workload_bench.h"
+#include "workload_capture.h"
 
 #include "fmt/format.h"
 #include "linenoise.h"
@@ -10,18 +79,29 @@
 #include "tsl/htrie_map.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <iterator>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <optional>
-#include <set>
-#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <unordered_map>
 
+#include <unistd.h>
+
 using namespace sqlplusplus;
 
 void print_usage(std::string_view program_name)
@@ -34,9 +114,146 @@ void print_usage(std::string_view program_name)
                  "  -c, --connectionString   Connection string to connect to oracle with\n"
                  "  -u, --username           Username to authenticate to Oracle with\n"
                  "  -p, --password           Password to authenticate to Oracle with\n"
+                 "  --proxyUser              Log in as this user through --username's proxy\n"
+                 "                           authentication, with --username's password\n"
+                 "  --fetchArraySize         Number of rows fetched per round trip (default 100)\n"
+                 "  --prefetchRows           Number of rows prefetched on execute (default 2)\n"
+                 "  --stmtCacheSize          Number of prepared statements kept open (default 20)\n"
+                 "  --noPool                 Use standalone connections instead of a session pool\n"
+                 "  --poolMinSessions        Sessions the pool opens up front (default 1)\n"
+                 "  --poolMaxSessions        Most sessions the pool will open (default 4)\n"
+                 "  --poolSessionIncrement   Sessions opened at a time when the pool grows (default 1)\n"
+                 "  --poolGetMode            wait, nowait, forceget or timedwait (default wait)\n"
+                 "  --poolWaitTimeout        Milliseconds to wait for a session in timedwait mode\n"
+                 "  --poolPingInterval       Idle seconds before a session is pinged on acquire,\n"
+                 "                           negative disables (default 60)\n"
+                 "  --poolTimeout            Idle seconds before pooled sessions close (default never)\n"
+                 "  --poolMaxLifetime        Seconds before a pooled session is retired (default never)\n"
+                 "  --poolHeterogeneous      Allow sessions with different credentials in the pool\n"
+                 "  --healthCheckInterval    Idle seconds before the connection and pooled sessions\n"
+                 "                           are pinged and replaced if dead; 0 disables (default 60)\n"
+                 "  --standby                Connection string of an Active Data Guard standby that\n"
+                 "                           read-only queries are sent to, see .route\n"
+                 "  --sdu                    Bytes of session data per network packet, 512 to\n"
+                 "                           2097152; bigger is faster to fetch over slow links\n"
+                 "  --expireTime             Minutes between keepalive probes of idle connections\n"
+                 "  --connectTimeout         Seconds to connect and log in within\n"
+                 "  --transportConnectTimeout Seconds for the TCP connect to each address\n"
+                 "  --retryCount             Times the addresses are tried again before a connect\n"
+                 "                           fails\n"
+                 "  --networkCompression     Compress network traffic, if the server allows it\n"
+                 "                           These six are added to Easy Connect strings and\n"
+                 "                           connect descriptors, not tnsnames.ora aliases\n"
+                 "  --clientConfigDir        Directory to read sqlnet.ora, tnsnames.ora and\n"
+                 "                           oraaccess.xml from instead of TNS_ADMIN, e.g. to turn\n"
+                 "                           the client result cache on with OCI_RESULT_CACHE_MAX_SIZE\n"
+                 "  --connectionClass        DRCP connection class to share pooled servers within\n"
+                 "  --purity                 self or new: whether a DRCP session may reuse a pooled\n"
+                 "                           server's state (default self with a connection class)\n"
+                 "  --sessionTag             NAME=value;... session settings, each applied with\n"
+                 "                           ALTER SESSION SET; pooled sessions are tagged with it\n"
+                 "                           so they're only set up once\n"
+                 "  --sessionFixup           PL/SQL procedure (requested_properties VARCHAR2,\n"
+                 "                           actual_properties VARCHAR2) the server runs to apply\n"
+                 "                           --sessionTag to a pooled session, saving the client's\n"
+                 "                           ALTER SESSION round trips\n"
+                 "  --output-format          table, csv, tsv or ndjson; all but table print every\n"
+                 "                           row of a result to stdout (default table, or tsv\n"
+                 "                           when stdout isn't a terminal)\n"
+                 "  --module                 Module the session reports to the server (default\n"
+                 "                           sqlplusplus)\n"
+                 "  --action                 Action the session reports to the server; statements\n"
+                 "                           piped in on stdin report <stdin>:<line> instead\n"
+                 "  --clientIdentifier       Client identifier for auditing and end-to-end tracing\n"
+                 "  --stats-json             File to write the client's .stats counters to as JSON\n"
+                 "                           on exit\n"
+                 "  --trace                  File to write a Chrome trace-event JSON timeline of\n"
+                 "                           connect, prepare, execute, fetch and render spans to\n"
+                 "                           on exit, for chrome://tracing or Perfetto\n"
+                 "  --capture                File to record every statement run to, with its bind\n"
+                 "                           values and timing, for .replay\n"
+                 "  --topsql-json            File to write the .topsql totals of every statement\n"
+                 "                           fingerprint to as JSON on exit\n"
+                 "  --metrics-listen         [host:]port to serve OpenMetrics text at /metrics on,\n"
+                 "                           for Prometheus (host defaults to 127.0.0.1)\n"
+                 "  --metrics-file           File to write OpenMetrics text to every\n"
+                 "                           --metrics-interval seconds (default 15) and on exit\n"
+                 "  --schema-cache           Directory whose schema completion indexes are shared\n"
+                 "                           with other sessions on the host, or \"off\" (default\n"
+                 "                           ~/.cache/sqlplusplus)\n"
+                 "  --cores                  Threads shared by the work that keeps a core busy,\n"
+                 "                           like formatting wide results, however much of it\n"
+                 "                           runs at once (default one per core)\n"
+                 "  --io-workers             Sessions that exports, loads, checksums, .ddl,\n"
+                 "                           .check and parallel blocks run at once between\n"
+                 "                           them; --parallel above it adds sessions but not\n"
+                 "                           concurrency (default 64)\n"
+                 "  -f, --file               Run a script's statements and commands, then exit;\n"
+                 "                           the exit status is 1 if any of them failed\n"
+                 "  -e, --execute            Run this statement or command, then exit with status\n"
+                 "                           1 if it failed; no history, completion or keywords\n"
+                 "                           are loaded, and results are TSV unless\n"
+                 "                           --output-format says otherwise\n"
+                 "  --open                   Show a result saved with .save and exit, without\n"
+                 "                           connecting to the database\n"
+                 "  --bench                  Run \".bench <threads> <iterations> <sql>\" once, print\n"
+                 "                           its throughput and latency and exit\n"
+                 "  --bench-workload         Run the mix of transactions a YAML file describes,\n"
+                 "                           print each one's throughput and latency percentiles\n"
+                 "                           and exit; --poolMaxSessions has to be above its\n"
+                 "                           sessions\n"
+                 "  --broker                 Unix socket to serve --attach clients on from warm\n"
+                 "                           pooled sessions, until interrupted\n"
+                 "  --brokerShared           Serve every local user on --broker, each as the\n"
+                 "                           database user named after their login through\n"
+                 "                           --username's proxy authentication\n"
+                 "  --attach                 Run the --file script, or stdin, on the broker at\n"
+                 "                           this socket and exit with its status; results are\n"
+                 "                           written in --output-format (default csv)\n"
+                 "  --export-worker          Export chunks of this job, queued by .export --queue,\n"
+                 "                           alongside workers on other hosts until none are\n"
+                 "                           left, then exit\n"
+                 "  --check                  Have the server parse or describe every query, DML\n"
+                 "                           statement and PL/SQL block of this script, on the\n"
+                 "                           pool's sessions at once, without running any; list\n"
+                 "                           the errors by line and exit with status 1 if there\n"
+                 "                           were any\n"
               << std::endl;
 }
 
+uint32_t uint32ArgValue(const CliArgument& arg) {
+    auto value = arg.as<int64_t>();
+    if (value < 0 || value > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error(fmt::format(
+            "--{} must be between 0 and {}", arg.name(), std::numeric_limits<uint32_t>::max()));
+    }
+    return static_cast<uint32_t>(value);
+}
+
+dpiPoolGetMode poolGetModeArgValue(const CliArgument& arg) {
+    auto value = arg.value();
+    if (value == "wait") {
+        return DPI_MODE_POOL_GET_WAIT;
+    } else if (value == "nowait") {
+        return DPI_MODE_POOL_GET_NOWAIT;
+    } else if (value == "forceget") {
+        return DPI_MODE_POOL_GET_FORCEGET;
+    } else if (value == "timedwait") {
+        return DPI_MODE_POOL_GET_TIMEDWAIT;
+    }
+    throw std::runtime_error(fmt::format("invalid value \"{}\" for --{}", value, arg.name()));
+}
+
+dpiPurity purityArgValue(const CliArgument& arg) {
+    auto value = arg.value();
+    if (value == "self") {
+        return DPI_PURITY_SELF;
+    } else if (value == "new") {
+        return DPI_PURITY_NEW;
+    }
+    throw std::runtime_error(fmt::format("invalid value \"{}\" for --{}", value, arg.name()));
+}
+
 template <typename T>
 struct LinenoiseFreeHelper {
     ~LinenoiseFreeHelper() noexcept {
@@ -57,366 +274,6454 @@ struct LinenoiseMaskGuard {
     }
 };
 
-std::function<std::vector<std::string>(std::string_view cmd)> generateCompletions;
+// Calls emit with each completion of cmd, best first, null terminated and only valid
+// during the call.
+std::function<void(std::string_view cmd, const std::function<void(std::string_view)>& emit)> generateCompletions;
 
-bool fetchAndPrintResults(OracleStatement& stmt, int maxResults) {
-    if (!stmt.fetch()) {
-        std::cout << "No rows returned" << std::endl;
-        return false;
-    }
-    Table table(stmt.numColumns());
-    
-    table.addRow();
-    for (int idx = 1; idx <= stmt.numColumns(); ++idx) {
-        auto colInfo = stmt.getColumnInfo(idx);
-        table.setColumnValue(0, idx - 1, colInfo.name());
-    }
+// Null when there's no history file, e.g. with no $HOME.
+std::unique_ptr<HistoryStore> historyStore;
 
-    int resCounter = 0;
-    bool moreResults = true;
-    while(resCounter < maxResults && moreResults) {
-        resCounter++;
-        auto rowIdx = table.addRow();
-        std::set<int> nulColumns;
-        for (auto col = 1; col <= stmt.numColumns(); ++col) {
-            auto colValue = stmt.getColumnValue(col);
-            std::string colValueStr;
-            if (colValue.isNull()) {
-                nulColumns.insert(col - 1);
-                colValueStr = "<null>";
-            }
-            switch(colValue.nativeType()) {
-            case DPI_NATIVE_TYPE_BOOLEAN:
-                colValueStr = colValue.as<bool>() ? "TRUE" : "FALSE";
-                break;
-            case DPI_NATIVE_TYPE_BYTES:
-                colValueStr = fmt::format("\"{}\"", colValue.as<std::string_view>());
-                break;
-            case DPI_NATIVE_TYPE_DOUBLE:
-                colValueStr = fmt::format("{}", colValue.as<double>());
-                break;
-            case DPI_NATIVE_TYPE_INT64:
-                colValueStr = fmt::format("{}", colValue.as<int64_t>());
-                break;
-            case DPI_NATIVE_TYPE_UINT64:
-                colValueStr = fmt::format("{}", colValue.as<uint64_t>());
-                break;
-            case DPI_NATIVE_TYPE_FLOAT:
-                colValueStr = fmt::format("{}", colValue.as<float>());
-                break;
-            case DPI_NATIVE_TYPE_TIMESTAMP: {
-                auto ts = colValue.as<dpiTimestamp*>();
-                colValueStr =fmt::format("{}-{}-{} {}:{}:{}.{} Z{}",
-                            ts->year,
-                            ts->month,
-                            ts->day,
-                            ts->hour,
-                            ts->minute,
-                            ts->second,
-                            ts->fsecond,
-                            ts->tzHourOffset);
-                break;
-                                            }
-            default:
-                colValueStr = "unsupported type";
-            }
-            table.setColumnValue(rowIdx, col - 1, colValueStr);
-        }
-        /*
-        for (const auto& col: nulColumns) {
-            table.row(resCounter + 1).cell(col).format().font_style({tabulate::FontStyle::italic});
-        }*/
+// How often words come up in the history, for ranking completions. Only used from the
+// main thread.
+WordFrequencies historyWordFrequencies;
 
-        moreResults = stmt.fetch();
-    }
+// Every statement run, replays included, by fingerprint for .topsql.
+TopSql topSql;
 
-    table.render(std::cout);
-    std::cout << "Fetched " << resCounter << " rows" << std::endl;
-    return moreResults;
+// Set by --capture; every statement run is recorded to it for .replay.
+std::unique_ptr<WorkloadCapture> workloadCapture;
+
+void addHistoryEntry(std::string_view line) {
+    linenoiseHistoryAdd(std::string(line).c_str());
+    historyWordFrequencies.addStatement(line);
+    if (historyStore) {
+        historyStore->add(line);
+    }
 }
 
-class Command;
-tsl::htrie_map<char, Command*>& getCommandMap() {
-    static tsl::htrie_map<char, Command*> globalMap;
+class Setting;
+tsl::htrie_map<char, Setting*>& getSettingMap() {
+    static tsl::htrie_map<char, Setting*> globalMap;
     return globalMap;
 }
 
-class Command {
+class Setting {
 public:
-    virtual ~Command() = default;
+    virtual ~Setting() = default;
 
-    explicit Command(std::string_view name)
+    explicit Setting(std::string_view name)
     {
-        getCommandMap().insert(name, this);
+        getSettingMap().insert(name, this);
     }
 
     virtual std::string_view name() const noexcept = 0;
-    virtual bool run(OracleConnection& conn, std::string_view cmdLine) = 0;
+    virtual void set(std::string_view value) = 0;
+    virtual std::string value() const = 0;
 };
 
-class DescribeCommand : public Command {
+class UInt32Setting : public Setting {
 public:
-    constexpr static auto kName = std::string_view(".describe");
-    DescribeCommand() : Command(kName) {}
+    UInt32Setting(std::string_view name, uint32_t defaultValue)
+        : Setting(name), _name(name), _value(defaultValue)
+    {}
 
     std::string_view name() const noexcept override {
-        return kName;
+        return _name;
     }
 
-    bool run(OracleConnection& conn, std::string_view tableName) override {
-        if (tableName.empty()) {
-            throw std::runtime_error("describe command requires a table name");
+    void set(std::string_view value) override {
+        uint32_t parsed = 0;
+        auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), parsed);
+        if (ec != std::errc{} || ptr != value.data() + value.size()) {
+            throw std::runtime_error(fmt::format("invalid value \"{}\" for {}", value, _name));
         }
-        OracleConnection::VariableOpts varopts;
-        varopts.dbTypeNum = DPI_ORACLE_TYPE_CHAR;
-        varopts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
-        varopts.opts = OracleConnection::VariableOpts::ByteBufferOpts{
-            static_cast<uint32_t>(tableName.size()), false};
-        varopts.maxArraySize = 1;
-        auto var = conn.newArrayVariable(varopts);
-
-        std::string tableNameUpper;
-        tableNameUpper.reserve(tableName.size());
-        std::transform(
-                tableName.begin(),
-                tableName.end(),
-                std::back_inserter(tableNameUpper),
-                [](const auto ch) {
-            return std::toupper(ch);
-        });
-
-        var.setFrom(0, tableNameUpper);
-
-        constexpr auto describeStmtStr = \
-            "select column_name as \"Name\", "
-            "nullable as \"Null?\", "
-            "concat(concat(concat(data_type,'('),data_length),')') as \"Type\" "
-            "from all_tab_columns where table_name = :1";
+        _value = parsed;
+    }
 
-        auto describeStatement = conn.prepareStatement(describeStmtStr);
-        describeStatement.bindByPos(1, var);
-        describeStatement.execute();
-        fetchAndPrintResults(describeStatement, std::numeric_limits<int>::max());
+    std::string value() const override {
+        return fmt::format("{}", _value);
+    }
 
-        return true;
+    uint32_t get() const noexcept {
+        return _value;
     }
-} cmdDescribe;
 
-class ExitCommand : public Command {
+private:
+    std::string_view _name;
+    uint32_t _value;
+};
+
+// One of the masks dates and timestamps are shown with, compiled when it's set.
+class DateTimeMaskSetting : public Setting {
 public:
-    constexpr static auto kName = std::string_view(".exit");
-    ExitCommand() : Command(kName) {}
+    DateTimeMaskSetting(std::string_view name, DateTimeKind kind)
+        : Setting(name), _name(name), _kind(kind)
+    {}
 
     std::string_view name() const noexcept override {
-        return kName;
+        return _name;
     }
 
-    bool run(OracleConnection& conn, std::string_view cmdLine) override {
-        return false;
+    void set(std::string_view value) override {
+        setDateTimeMask(_kind, DateTimeMask(value));
     }
-} cmdExit;
 
+    std::string value() const override {
+        return dateTimeMask(_kind).text();
+    }
 
-class MoreRowsCommand : public Command {
+private:
+    std::string_view _name;
+    DateTimeKind _kind;
+};
+
+DateTimeMaskSetting dateFormatSetting("dateformat", DateTimeKind::Date);
+DateTimeMaskSetting timestampFormatSetting("timestampformat", DateTimeKind::Timestamp);
+DateTimeMaskSetting timestampTzFormatSetting("timestamptzformat", DateTimeKind::TimestampTz);
+
+// 0 has each query size its fetches for about fetchbatchkb a round trip to start with, and
+// adjust that as it goes from how long the round trips take.
+UInt32Setting fetchArraySizeSetting("arraysize", 0);
+UInt32Setting fetchBatchKbSetting("fetchbatchkb", 256);
+// Most a query's define buffers may take, in MB: a fixed or tuned array size that would
+// need more fetches fewer rows a round trip instead. 0 is no limit.
+UInt32Setting defineMbSetting("definemb", 32);
+UInt32Setting prefetchRowsSetting("prefetchrows", DPI_DEFAULT_PREFETCH_ROWS);
+// Non-zero opens interactive queries with scrollable cursors, so .prevRows and .gotoRow can
+// reposition them on the server instead of running the query again.
+UInt32Setting scrollableSetting("scrollable", 0);
+// LOB columns whose first block of values are all at most this many KB are fetched inline
+// with their rows from then on, instead of through a locator each; 0 always uses locators.
+UInt32Setting lobInlineKbSetting("lobinlinekb", 32);
+// Non-zero fetches NUMBER columns that would come back as doubles as their exact decimal
+// text instead.
+UInt32Setting exactNumbersSetting("exactnumbers", 0);
+// Milliseconds any one round trip may take before it's interrupted; 0 means no limit.
+UInt32Setting callTimeoutSetting("timeout", 0);
+// Guards against accidental full-table selects: once a query has handed out this many rows
+// or bytes its cursor is closed. 0 means no limit.
+UInt32Setting maxRowsSetting("maxrows", 0);
+UInt32Setting maxBytesSetting("maxbytes", 0);
+// The widest any column of a result table is drawn; 0 is no limit. Wider values are
+// wrapped onto more lines, or with wrap set to 0 cut to one line ending in an ellipsis.
+UInt32Setting colWidthSetting("colwidth", 0);
+UInt32Setting wrapSetting("wrap", 1);
+
+// How query results are drawn: as a table, or vertical, a block of "column : value" lines
+// a row, for rows too wide to read across.
+class LayoutSetting : public Setting {
 public:
-    constexpr static auto kName = std::string_view(".moreRows");
-    MoreRowsCommand() : Command(kName) {}
+    explicit LayoutSetting(std::string_view name) : Setting(name), _name(name) {}
 
     std::string_view name() const noexcept override {
-        return kName;
+        return _name;
     }
 
-    bool run(OracleConnection& conn, std::string_view cmdLine) override {
-        if (!_activeStatement) {
-            std::cout << "No active statement" << std::endl;
-            return true;
+    void set(std::string_view value) override {
+        if (value == "table") {
+            _vertical = false;
+        } else if (value == "vertical") {
+            _vertical = true;
+        } else {
+            throw std::runtime_error(fmt::format("invalid value \"{}\" for {}; it's table or vertical", value, _name));
         }
+    }
 
-        if (!fetchAndPrintResults(*_activeStatement, 20)) {
-            _activeStatement = std::nullopt;
-        }
-        return true;
+    std::string value() const override {
+        return _vertical ? "vertical" : "table";
     }
 
-    void setActiveStatement(OracleStatement stmt) {
-        _activeStatement = std::move(stmt);
+    bool vertical() const noexcept {
+        return _vertical;
     }
 
 private:
-    std::optional<OracleStatement> _activeStatement;
-} moreRowsCmd;
+    std::string_view _name;
+    bool _vertical = false;
+};
 
-tsl::htrie_set<char> populateReservedKeywords(OracleConnection& conn) {
-    tsl::htrie_set<char> out;
-    for (const auto& cmdName: getCommandMap()) {
-        out.insert(cmdName->name());
-    }
+LayoutSetting layoutSetting("layout");
 
-    constexpr static std::string_view selectKeywordsStmtStr
-        ("select lower(KEYWORD) from V$RESERVED_WORDS where LENGTH(KEYWORD) > 1");
+// Result tables are also shrunk to fit the terminal when stdout is one.
+void applyTableLayout(Table& table) {
+    table.setColumnWidthLimit(colWidthSetting.get());
+    table.truncate = wrapSetting.get() == 0;
+    table.maxTableWidth = terminalColumns();
+}
+enum class ResultFormat {
+    Csv,
+    Tsv,
+    // One JSON object per row and line.
+    Ndjson,
+};
 
-    auto selectKeywordsStmt = conn.prepareStatement(selectKeywordsStmtStr);
-    selectKeywordsStmt.execute();
-    while (selectKeywordsStmt.fetch()) {
-        auto valueFromDB = selectKeywordsStmt.getColumnValue(1).as<std::string_view>();
-        out.insert(valueFromDB);
-    }
+// Files are written as TSV or NDJSON when their extension says so, and CSV otherwise.
+bool isGzipPath(std::string_view path) {
+    constexpr auto kSuffix = std::string_view(".gz");
+    return path.size() > kSuffix.size() && path.substr(path.size() - kSuffix.size()) == kSuffix;
+}
 
-    return out;
+// .load reads files ending in .parquet as Parquet and anything else as CSV.
+bool isParquetPath(std::string_view path) {
+    constexpr auto kSuffix = std::string_view(".parquet");
+    return path.size() > kSuffix.size() && path.substr(path.size() - kSuffix.size()) == kSuffix;
 }
 
-int main(int argc, const char** argv) try {
-    CliArgumentParser argParser;
-    CliArgument connStringArg(argParser, "connectionString", 'c');
-    CliArgument usernameArg(argParser, "username", 'u');
-    CliArgument passwordarg(argParser, "password", 'p');
-    CliArgument historyFileArg(argParser, "historyFile");
-    CliArgument historyMaxSizeArg(argParser, "maxHistorySize");
-    CliFlag helpFlag(argParser, "help", 'h');
+ResultFormat resultFormatForPath(std::string_view path) {
+    if (isGzipPath(path)) {
+        path.remove_suffix(3);
+    }
+    auto endsWith = [&](std::string_view suffix) {
+        return path.size() >= suffix.size() && path.substr(path.size() - suffix.size()) == suffix;
+    };
+    if (endsWith(".tsv")) {
+        return ResultFormat::Tsv;
+    }
+    if (endsWith(".ndjson") || endsWith(".jsonl")) {
+        return ResultFormat::Ndjson;
+    }
+    return ResultFormat::Csv;
+}
 
-    auto res = argParser.parse(argc, argv);
+uint64_t writeResults(OracleStatement& stmt, BufferedFdWriter& out, ResultFormat format) {
+    uint64_t numRows = 0;
+    if (format == ResultFormat::Ndjson) {
+        numRows = writeNdjsonResults(stmt, out);
+    } else {
+        DelimitedWriter writer(out, format == ResultFormat::Csv ? DelimitedFormat::Csv : DelimitedFormat::Tsv);
+        numRows = writeDelimitedResults(stmt, writer);
+    }
+    clientCounters.add(ClientCounter::RowsRendered, numRows);
+    return numRows;
+}
 
-    if (helpFlag) {
-        print_usage(res.program_name);
+// Where query results go when they aren't drawn as a table: a .spool file, or stdout when
+// --output-format asks for something other than a table.
+std::optional<BufferedFdWriter> resultOutput;
+ResultFormat resultOutputFormat = ResultFormat::Csv;
+std::string spoolPath;
+std::optional<ResultFormat> stdoutFormat;
+
+void resetResultOutput() {
+    spoolPath.clear();
+    resultOutput.reset();
+    if (stdoutFormat) {
+        resultOutput.emplace(STDOUT_FILENO);
+        resultOutputFormat = *stdoutFormat;
     }
+}
 
-    std::string historyPath;
-    if (historyFileArg) {
-        historyPath = historyFileArg.as<std::string>();
-        linenoiseHistoryLoad(historyPath.c_str());
-    } else if (auto homeVar = ::getenv("HOME"); homeVar != nullptr) {
-        historyPath = fmt::format("{}/.sqlplusplus_history", homeVar);
-        linenoiseHistoryLoad(historyPath.c_str());
+UInt32Setting parquetRowGroupSetting("parquetrowgroup", 65536);
+// These size .copy's batches and commits as well.
+UInt32Setting loadBatchSizeSetting("loadbatchsize", 1000);
+// 0 commits once, at the end of the load.
+UInt32Setting loadCommitRowsSetting("loadcommitrows", 0);
+// Connections, borrowed from the session pool, that .load splits a file across.
+UInt32Setting loadParallelSetting("loadparallel", 1);
+// Rows per batch, and so per commit, for .load --direct, which starts every batch on new blocks.
+UInt32Setting loadDirectBatchSizeSetting("loaddirectbatchsize", 50000);
+// 0 binds every loaded value as text for the server to convert, as before native binds.
+UInt32Setting loadNativeSetting("loadnative", 1);
+// Lets .load and .upsert size batches from how they go, starting from loadbatchsize and
+// up to loadmaxbatchsize rows; 0 sends loadbatchsize rows every time.
+UInt32Setting loadAdaptiveSetting("loadadaptive", 1);
+UInt32Setting loadMaxBatchSizeSetting("loadmaxbatchsize", 100000);
+// Most frequent values .summary shows per column.
+UInt32Setting summaryTopSetting("summarytop", 5);
+// How .spool and .export gzip files whose names end in .gz.
+UInt32Setting compressLevelSetting("compresslevel", 6);
+UInt32Setting compressThreadsSetting("compressthreads", 2);
+
+OutputCompression compressionForPath(std::string_view path) {
+    OutputCompression compression;
+    if (isGzipPath(path)) {
+        compression.level = static_cast<int>(std::clamp<uint32_t>(compressLevelSetting.get(), 1, 9));
+        compression.threads = std::max<uint32_t>(compressThreadsSetting.get(), 1);
     }
+    return compression;
+}
 
-    auto oracleCtx = OracleContext::make();
-    OracleConnectionOptions connOpts;
-    connOpts.connString = connStringArg.as<std::string>();
-    connOpts.username = usernameArg.as<std::string>();
-    if (passwordarg) {
-        connOpts.password = passwordarg.as<std::string>();
+// Buffers of a .spool, .export or .dump file written at once through io_uring; 0 writes
+// each with write(2) as it fills. Gzipped files have their own writer.
+UInt32Setting writeQueueSetting("writequeue", 4);
+// Non-zero opens those files with O_DIRECT, where the filesystem allows it.
+UInt32Setting directIoSetting("directio", 0);
+
+FileWriteOptions fileWriteOptions() {
+    FileWriteOptions fileWrite;
+    fileWrite.queueDepth = writeQueueSetting.get();
+    fileWrite.direct = directIoSetting.get() != 0;
+    return fileWrite;
+}
+
+// The array size for fetches that aren't tuned as they go.
+uint32_t fixedFetchArraySize() {
+    const auto size = fetchArraySizeSetting.get();
+    return size == 0 ? DPI_DEFAULT_FETCH_ARRAY_SIZE : size;
+}
+
+// A fixed array size is re-applied before every page so .set arraysize affects active
+// queries; an adaptive one is left to the statement.
+void applyFetchArraySize(OracleStatement& stmt) {
+    if (fetchArraySizeSetting.get() == 0) {
+        stmt.setAdaptiveFetch(uint64_t{std::max<uint32_t>(fetchBatchKbSetting.get(), 1)} * 1024);
     } else {
-        LinenoiseMaskGuard maskGuard;
-        auto linenoisePtr = linenoise("Password > ");
-        LinenoiseFreeHelper freeHelper(linenoisePtr);
-        connOpts.password = std::string(linenoisePtr);
+        stmt.setAdaptiveFetch(0);
+        stmt.setFetchArraySize(fetchArraySizeSetting.get());
     }
+}
 
-    if (historyMaxSizeArg) {
-        linenoiseHistorySetMaxLen(historyMaxSizeArg.as<int64_t>());
-    } else {
-        // Make history really big by default
-        linenoiseHistorySetMaxLen(10000);
+// Applies the configured fetch sizes to a statement. Prefetch only matters before execute.
+void applyFetchSettings(OracleStatement& stmt) {
+    stmt.setDefineMemoryLimit(uint64_t{defineMbSetting.get()} * 1024 * 1024);
+    applyFetchArraySize(stmt);
+    stmt.setPrefetchRows(prefetchRowsSetting.get());
+    stmt.setFetchLimits(maxRowsSetting.get(), maxBytesSetting.get());
+    stmt.setLobInlineThreshold(uint64_t{lobInlineKbSetting.get()} * 1024);
+    stmt.setExactNumbers(exactNumbersSetting.get() != 0);
+}
+
+// The call timeout is an attribute of the connection rather than a round trip, so it's
+// applied before each line instead of when it's set, which may be before the connection
+// is up.
+void applyCallTimeout(Session& session) {
+    session.connection().setCallTimeout(callTimeoutSetting.get());
+}
+
+// Closes the cursor of a query that stopped at maxrows or maxbytes, so it doesn't hold on
+// to server resources. Returns whether it did.
+bool closeIfFetchLimited(OracleStatement& stmt) {
+    if (!stmt.fetchLimitReached()) {
+        return false;
     }
+    stmt.close();
+    std::cout << "Stopped at the maxrows/maxbytes limit" << std::endl;
+    return true;
+}
 
-    linenoiseSetCompletionCallback([](const char* strPtr, linenoiseCompletions* lc) {
-        if (!generateCompletions) {
+// Rows per page of interactive results.
+constexpr int kPageRows = 20;
+
+// Non-zero has interactive queries ask for just their first page: the prefetch and the
+// first fetch are cut to a page and a row, the row to tell whether there are more, and a
+// SELECT gets a FIRST_ROWS hint so the server plans for those rows rather than all of them.
+// .more still fetches the rest. The results aren't limited with FETCH FIRST, since then
+// there would be no rest to fetch.
+UInt32Setting previewSetting("preview", 0);
+
+// Non-zero gives every SELECT typed a RESULT_CACHE hint, so with the client result cache on
+// a query repeated against unchanged tables is answered from the client's memory, without
+// a round trip; .stats shows how often it was.
+UInt32Setting resultCacheHintSetting("resultcachehint", 0);
+
+// Non-zero samples what a statement is waiting on from a second session once its execute
+// or a fetch has been blocked this many milliseconds, and every this many after, with a
+// status line on a terminal and a summary at the end.
+UInt32Setting waitMonitorSetting("waitmonitor", 0);
+
+// Non-zero draws a progress line on a terminal, redrawn this many milliseconds apart, once a
+// statement's execute, an export or a fetch has gone on that long: rows fetched and their
+// rate, and the server's estimate for the long operation it's in, such as a scan or sort.
+UInt32Setting progressSetting("progress", 0);
+
+// Made on the first statement with waitmonitor or progress set. They follow the REPL to
+// whichever target it's on, polling from a connection of that target's session.
+std::unique_ptr<WaitMonitor> waitMonitor;
+std::unique_ptr<ProgressMonitor> progressMonitor;
+
+// Watches a statement with waitMonitor and progressMonitor while their settings are on, for
+// as long as it's alive.
+class MonitoredStatement {
+public:
+    explicit MonitoredStatement(Session& session) {
+        const bool terminal = ::isatty(STDERR_FILENO) != 0;
+        if (progressSetting.get() != 0 && terminal) {
+            if (!progressMonitor) {
+                progressMonitor = std::make_unique<ProgressMonitor>();
+            }
+            try {
+                progressMonitor->begin(session.connection(), [&session] { return session.newConnection(); },
+                                       std::chrono::milliseconds(progressSetting.get()));
+                _showingProgress = true;
+            } catch (const std::exception& e) {
+                std::cerr << "Not showing progress: " << e.what() << std::endl;
+            }
+        }
+        if (waitMonitorSetting.get() == 0) {
             return;
         }
-
-        for (const auto& completion : generateCompletions(std::string_view(strPtr))) {
-            linenoiseAddCompletion(lc, completion.c_str());
+        if (!waitMonitor) {
+            waitMonitor = std::make_unique<WaitMonitor>();
         }
-    });
+        try {
+            // The progress line has the terminal to itself; the waits still add up to the summary.
+            waitMonitor->begin(session.connection(), [&session] { return session.newConnection(); },
+                               std::chrono::milliseconds(waitMonitorSetting.get()), terminal && !_showingProgress);
+            _watching = true;
+        } catch (const std::exception& e) {
+            // An account that can't read v$session still gets its statement run.
+            std::cerr << "Not monitoring waits: " << e.what() << std::endl;
+        }
+    }
+    MonitoredStatement(const MonitoredStatement&) = delete;
+    MonitoredStatement& operator=(const MonitoredStatement&) = delete;
 
-    auto oracleConn = OracleConnection::make(oracleCtx.get(), connOpts);
-    auto reservedKeywords = populateReservedKeywords(oracleConn);
-    generateCompletions = [&](std::string_view sv) -> std::vector<std::string> {
-        std::vector<std::string> ret;
+    ~MonitoredStatement() {
+        if (_showingProgress) {
+            progressMonitor->finish();
+        }
+        if (_watching) {
+            waitMonitor->finish();
+        }
+    }
 
-        if (sv.empty()) {
-            return ret;
+    // e.g. "Waits: 12 samples, 58% ON CPU, 33% db file scattered read, 8% direct path read".
+    void printSummary() {
+        if (_showingProgress) {
+            _showingProgress = false;
+            progressMonitor->finish();
+        }
+        if (!_watching) {
+            return;
+        }
+        _watching = false;
+        const auto summary = waitMonitor->finish();
+        if (summary.samples > 0) {
+            constexpr size_t kMaxEvents = 5;
+            fmt::memory_buffer out;
+            fmt::format_to(out, "Waits: {} sample{}", summary.samples, summary.samples == 1 ? "" : "s");
+            for (size_t idx = 0; idx < std::min(summary.events.size(), kMaxEvents); ++idx) {
+                fmt::format_to(out, ", {:.0f}% {}", 100.0 * summary.events[idx].samples / summary.samples,
+                        summary.events[idx].event);
+            }
+            std::cout << std::string_view(out.data(), out.size()) << std::endl;
+        }
+        if (!summary.error.empty()) {
+            std::cout << "Wait sampling stopped: " << summary.error << std::endl;
         }
+    }
+
+private:
+    bool _watching = false;
+    bool _showingProgress = false;
+};
 
-        auto lastWordBoundary = sv.find_last_of(" (),.@");
-        if (lastWordBoundary == std::string_view::npos || lastWordBoundary == sv.size() || lastWordBoundary == 0) {
-            lastWordBoundary = 0;
+// Where sql's leading SELECT ends, past any comments before it, or nullopt when it doesn't
+// start with one.
+std::optional<size_t> leadingSelectEnd(std::string_view sql) {
+    size_t pos = 0;
+    for (;;) {
+        pos = std::min(sql.find_first_not_of(" \t\r\n", pos), sql.size());
+        if (sql.substr(pos, 2) == "--") {
+            pos = std::min(sql.find('\n', pos), sql.size());
+        } else if (sql.substr(pos, 2) == "/*") {
+            const auto end = sql.find("*/", pos + 2);
+            if (end == std::string_view::npos) {
+                return std::nullopt;
+            }
+            pos = end + 2;
         } else {
-            ++lastWordBoundary;
+            break;
         }
+    }
+    constexpr auto kSelect = std::string_view("select");
+    const auto word = sql.substr(pos, kSelect.size());
+    const bool isSelect = word.size() == kSelect.size() &&
+            std::equal(word.begin(), word.end(), kSelect.begin(), [](char left, char right) {
+                return std::tolower(static_cast<unsigned char>(left)) == right;
+            });
+    const auto afterSelect = pos + kSelect.size();
+    if (!isSelect || (afterSelect < sql.size() && !std::isspace(static_cast<unsigned char>(sql[afterSelect])))) {
+        return std::nullopt;
+    }
+    return afterSelect;
+}
 
-        std::string_view lastWord = sv.substr(lastWordBoundary);
+// sql with a FIRST_ROWS(rows) hint after its leading SELECT, or nullopt when it doesn't
+// start with one or already has a hint there.
+std::optional<std::string> withFirstRowsHint(std::string_view sql, uint32_t rows) {
+    const auto afterSelect = leadingSelectEnd(sql);
+    if (!afterSelect) {
+        return std::nullopt;
+    }
+    const auto next = std::min(sql.find_first_not_of(" \t\r\n", *afterSelect), sql.size());
+    if (sql.substr(next, 3) == "/*+" || sql.substr(next, 3) == "--+") {
+        return std::nullopt;
+    }
+    return fmt::format("{} /*+ FIRST_ROWS({}) */{}", sql.substr(0, *afterSelect), rows, sql.substr(*afterSelect));
+}
 
-        auto prefixRange = reservedKeywords.equal_prefix_range(lastWord);
-        for (auto it = prefixRange.first; it != prefixRange.second; ++it) {
-            ret.push_back(fmt::format("{}{}", sv.substr(0, lastWordBoundary), it.key()));
-        }
+// Whether the hint that follows sql's leading SELECT asks for the result cache, or says not
+// to use it, with NO_RESULT_CACHE.
+bool hasResultCacheHint(std::string_view sql) {
+    const auto afterSelect = leadingSelectEnd(sql);
+    if (!afterSelect) {
+        return false;
+    }
+    const auto next = std::min(sql.find_first_not_of(" \t\r\n", *afterSelect), sql.size());
+    if (sql.substr(next, 3) != "/*+" && sql.substr(next, 3) != "--+") {
+        return false;
+    }
+    auto hint = std::string(sql.substr(next, sql.find(sql[next] == '/' ? "*/" : "\n", next) - next));
+    std::transform(hint.begin(), hint.end(), hint.begin(), [](const auto ch) {
+        return static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+    });
+    return hint.find("RESULT_CACHE") != std::string::npos;
+}
 
-        return ret;
-    };
+// sql with RESULT_CACHE added to the hint after its leading SELECT, or a hint of its own
+// there, or nullopt when it doesn't start with a SELECT or already has it either way.
+std::optional<std::string> withResultCacheHint(std::string_view sql) {
+    const auto afterSelect = leadingSelectEnd(sql);
+    if (!afterSelect || hasResultCacheHint(sql)) {
+        return std::nullopt;
+    }
+    const auto next = std::min(sql.find_first_not_of(" \t\r\n", *afterSelect), sql.size());
+    // Only the first hint comment counts, so the server would ignore a second one.
+    if (sql.substr(next, 3) == "/*+" || sql.substr(next, 3) == "--+") {
+        return fmt::format("{} RESULT_CACHE {}", sql.substr(0, next + 3), sql.substr(next + 3));
+    }
+    return fmt::format("{} /*+ RESULT_CACHE */{}", sql.substr(0, *afterSelect), sql.substr(*afterSelect));
+}
 
-    std::optional<OracleStatement> activeStatement;
-    std::stringstream lineBuilder;
-    bool inMultLine = false;
-    for(;;) {
-        auto linePtr = linenoise(inMultLine ? "SQL++ (cont.) > " : "SQL++ > ");
-        if (linePtr == nullptr) {
-            break;
-        }
-        LinenoiseFreeHelper helper(linePtr);
-        std::string_view line(linePtr);
+// Where the last statement's time went, printed after each result with .timing on.
+StatementTiming statementTiming;
+bool timingEnabled = false;
 
-        if (line.back() == '\\') {
-            lineBuilder << line.substr(0, line.size() - 1);
-            linenoiseSetMultiLine(1);
-            inMultLine = true;
-            continue;
-        } else {
-            lineBuilder << line;
-            inMultLine = false;
-            linenoiseSetMultiLine(0);
-        }
+// For .timing, once the query's rows have been fetched.
+void noteDefineBuffers(const OracleStatement& stmt) {
+    const auto& layout = stmt.defineLayout();
+    statementTiming.setDefineBuffers(layout.rowBytes, layout.arraySize, layout.requestedArraySize);
+}
 
-        auto fullLine = lineBuilder.str();
-        lineBuilder = std::stringstream{};
+void printTiming() {
+    if (timingEnabled) {
+        std::cout << "Timing: " << statementTiming.summary() << std::endl;
+    }
+}
 
-        if (fullLine.empty()) {
-            continue;
-        }
+// Result tables stream to stdout through a writer thread, so fetching and formatting only
+// wait on a slow terminal once this many MB of table are waiting to be written.
+UInt32Setting outputQueueMbSetting("outputqueuemb", 16);
 
-        const auto& commandMap = getCommandMap();
-        if (auto cmdIt = commandMap.longest_prefix(fullLine); cmdIt != commandMap.end()) {
-            auto commandName = cmdIt.value()->name();
-            size_t prefixEnd = 0;
-            auto checkPrefix = [&] {
-                if (prefixEnd == fullLine.size() || prefixEnd == commandName.size()) {
-                    return false;
-                }
-                return fullLine.at(prefixEnd) == commandName.at(prefixEnd);
-            };
+struct QueuedStdout {
+    AsyncOutputBuffer buffer{STDOUT_FILENO, 0};
+    std::ostream stream{&buffer};
+};
 
-            for (; checkPrefix(); ++prefixEnd);
-            if (prefixEnd < fullLine.size()) {
-                auto afterSpaces = fullLine.substr(prefixEnd).find_first_not_of(" ");
-                if (afterSpaces != std::string_view::npos) {
-                    prefixEnd += afterSpaces;
-                }
-            }
+// Started the first time a result is drawn.
+QueuedStdout& queuedStdout() {
+    static QueuedStdout out;
+    out.buffer.setMaxQueuedBytes(size_t{outputQueueMbSetting.get()} * 1024 * 1024);
+    return out;
+}
 
-            if (!cmdIt.value()->run(oracleConn, fullLine.substr(prefixEnd))) {
-                break;
+// Non-zero lets a result of more than a page that floods the terminal collapse into a line
+// of progress a second, with its last rows shown at the end, rather than hold its fetch to
+// the terminal's pace; pressing s while it's drawn skips to the end too.
+UInt32Setting throttleSetting("throttle", 1);
+
+std::optional<OutputThrottle> outputThrottle(AsyncOutputBuffer& output, int maxResults) {
+    if (throttleSetting.get() == 0 || maxResults <= kPageRows || !::isatty(STDOUT_FILENO)) {
+        return std::nullopt;
+    }
+    return std::optional<OutputThrottle>(std::in_place, output);
+}
+
+// Skips a batch's rows on a collapsed throttle, saying so the first time, and writes
+// whatever progress line is due.
+void skipBatch(OutputThrottle& throttle, const FetchPipeline::Batch& batch, uint32_t numColumns, uint64_t rowsSoFar,
+               std::ostream& out) {
+    if (throttle.skippedRows() == 0) {
+        out << "-- " << throttle.reason() << "; counting the rows rather than drawing them\n";
+    }
+    for (uint32_t row = 0; row < batch.numRows; ++row) {
+        throttle.skip(batch.cells.data() + static_cast<size_t>(row) * numColumns, numColumns);
+    }
+    if (auto line = throttle.progress(rowsSoFar)) {
+        out << *line;
+    }
+    out.flush();
+}
+
+std::string skippedRowsLine(const OutputThrottle& throttle) {
+    return fmt::format("-- {} rows not shown; the last {} follow\n", throttle.skippedRows() - throttle.tail().size(),
+                       throttle.tail().size());
+}
+
+// fetchAndPrintResults with layout set to vertical: each row is written as its own block
+// as soon as it's fetched, with no column widths to work out first. With pages, records
+// are numbered on from the pages printed before.
+bool fetchAndPrintRecords(OracleStatement& stmt, int maxResults, CachedResult* capture, PagedTable* pages) {
+    const auto metadata = stmt.metadata();
+    const auto numColumns = metadata->numColumns();
+    std::vector<std::string> names;
+    names.reserve(numColumns);
+    for (uint32_t idx = 1; idx <= numColumns; ++idx) {
+        names.emplace_back(metadata->column(idx).name);
+    }
+    VerticalLayout layout(std::move(names), pages ? pages->records + 1 : 1);
+    auto& out = queuedStdout();
+    struct DrainOnExit {
+        AsyncOutputBuffer& buffer;
+        ~DrainOnExit() {
+            try {
+                buffer.drain();
+            } catch(const std::exception&) {
+                // Output that can't be written has nowhere to report it either.
             }
-            continue;
         }
+    } drainOnExit{out.buffer};
+    auto throttle = outputThrottle(out.buffer, maxResults);
 
-        try {
-            auto activeStatement = oracleConn.prepareStatement(fullLine);
-            activeStatement.execute();
-            linenoiseHistoryAdd(fullLine.c_str());
-            fetchAndPrintResults(activeStatement, 20);
-            moreRowsCmd.setActiveStatement(std::move(activeStatement));
-        } catch(const OracleException& e) {
-            std::cerr << "Error " << e.context() << ": " << e.what() << std::endl;
+    using Phase = StatementTiming::Phase;
+    int resCounter = 0;
+    bool moreResults = true;
+    {
+        FetchPipeline pipeline(stmt, static_cast<uint64_t>(std::max(maxResults, 0)));
+        auto nextBatch = [&pipeline] {
+            WaitMonitor::Blocked blocked(waitMonitor.get());
+            ProgressMonitor::Active progress(progressMonitor.get());
+            return pipeline.next();
+        };
+        while (auto batch = nextBatch()) {
+            statementTiming.add(Phase::Fetch, batch->fetchTime);
+            statementTiming.add(Phase::Format, batch->formatTime);
+            if (batch->roundTrip) {
+                statementTiming.addFetchRoundTrip();
+            }
+            statementTiming.measure(Phase::Render, [&] {
+                TraceSpan span("render");
+                if (throttle && !throttle->drawing()) {
+                    skipBatch(*throttle, *batch, numColumns, static_cast<uint64_t>(resCounter) + batch->numRows,
+                              out.stream);
+                    return;
+                }
+                for (uint32_t row = 0; row < batch->numRows; ++row) {
+                    layout.writeRecord(batch->cells.data() + static_cast<size_t>(row) * numColumns, out.stream);
+                }
+                out.stream.flush();
+            });
+            if (capture) {
+                for (uint32_t row = 0; row < batch->numRows; ++row) {
+                    capture->addRow(batch->cells.data() + static_cast<size_t>(row) * numColumns);
+                }
+            }
+            resCounter += static_cast<int>(batch->numRows);
+            pipeline.recycle(std::move(batch));
+        }
+        moreResults = pipeline.moreRows();
+    }
+    if (throttle && throttle->skippedRows() > 0) {
+        out.stream << skippedRowsLine(*throttle);
+        layout.skipRecords(throttle->skippedRows() - throttle->tail().size());
+        std::vector<std::string_view> cells(numColumns);
+        for (const auto& row : throttle->tail()) {
+            std::copy(row.begin(), row.end(), cells.begin());
+            layout.writeRecord(cells.data(), out.stream);
         }
     }
+    if (pages) {
+        pages->records = layout.nextRecord() - 1;
+    }
 
-    if (!historyPath.empty()) {
-        linenoiseHistorySave(historyPath.c_str());
+    if (resCounter == 0) {
+        std::cout << "No rows returned" << std::endl;
+        return false;
     }
 
-    return 0;
-} catch(const OracleException& e) {
-    std::cerr << "Fatal error " << e.context() << ": " << e.what() << std::endl;
+    statementTiming.measure(Phase::Render, [&] {
+        out.buffer.drain();
+    });
+    std::cout << "Fetched " << resCounter << " rows" << std::endl;
+    if (closeIfFetchLimited(stmt)) {
+        return false;
+    }
+    return moreResults;
+}
+
+// Rows printed are also added to capture, when there is one. With pages, the rows are
+// printed with its table, laid out to line up with the pages printed with it before.
+bool fetchAndPrintResults(OracleStatement& stmt, int maxResults, CachedResult* capture = nullptr,
+                          PagedTable* pages = nullptr) {
+    // Held for the whole result, so the header cells can point at its names.
+    const auto metadata = stmt.metadata();
+    const auto numColumns = metadata->numColumns();
+    if (layoutSetting.vertical()) {
+        return fetchAndPrintRecords(stmt, maxResults, capture, pages);
+    }
+    std::optional<Table> ownTable;
+    auto& table = pages && pages->table.columns.size() == numColumns ? pages->table : ownTable.emplace(numColumns);
+    applyTableLayout(table);
+    // Column widths are sized from the first fetched block, then each block is written out
+    // as soon as it arrives, so memory stays bounded however many rows come back.
+    auto& out = queuedStdout();
+    // However the result ends, the table is all written out before anything else is.
+    struct DrainOnExit {
+        AsyncOutputBuffer& buffer;
+        ~DrainOnExit() {
+            try {
+                buffer.drain();
+            } catch(const std::exception&) {
+                // Output that can't be written has nowhere to report it either.
+            }
+        }
+    } drainOnExit{out.buffer};
+    // A collapsed result's last rows are drawn as a table of their own after the count, at
+    // the widths the rows before them were.
+    auto throttle = outputThrottle(out.buffer, maxResults);
+    std::vector<Table::Width> ownWidths;
+    auto* widths = pages ? &pages->widths : &ownWidths;
+    auto addHeader = [&] {
+        table.addRow();
+        for (uint32_t idx = 1; idx <= numColumns; ++idx) {
+            table.setColumnView(0, idx - 1, metadata->column(idx).name);
+        }
+    };
+    table.beginStreaming(out.stream, widths);
+    addHeader();
+
+    // Fetching and formatting the next block runs on the pipeline's thread while this one
+    // renders the last, so the phases below add up to more than the wall clock time.
+    using Phase = StatementTiming::Phase;
+    int resCounter = 0;
+    bool moreResults = true;
+    {
+        FetchPipeline pipeline(stmt, static_cast<uint64_t>(std::max(maxResults, 0)));
+        auto nextBatch = [&pipeline] {
+            WaitMonitor::Blocked blocked(waitMonitor.get());
+            ProgressMonitor::Active progress(progressMonitor.get());
+            return pipeline.next();
+        };
+        while (auto batch = nextBatch()) {
+            statementTiming.add(Phase::Fetch, batch->fetchTime);
+            statementTiming.add(Phase::Format, batch->formatTime);
+            // A block starting at the top of the fetch buffers had to be fetched from the
+            // server; the rest were left over from an earlier fetch.
+            if (batch->roundTrip) {
+                statementTiming.addFetchRoundTrip();
+            }
+
+            if (throttle && !throttle->drawing()) {
+                statementTiming.measure(Phase::Render, [&] {
+                    if (throttle->skippedRows() == 0) {
+                        table.endStreaming();
+                    }
+                    skipBatch(*throttle, *batch, numColumns, static_cast<uint64_t>(resCounter) + batch->numRows,
+                              out.stream);
+                });
+                if (capture) {
+                    for (uint32_t row = 0; row < batch->numRows; ++row) {
+                        capture->addRow(batch->cells.data() + static_cast<size_t>(row) * numColumns);
+                    }
+                }
+                resCounter += static_cast<int>(batch->numRows);
+                pipeline.recycle(std::move(batch));
+                continue;
+            }
+
+            // The cells point into the batch's arenas rather than being copied into the
+            // table's, so the rows are flushed before the batch goes back to be refilled.
+            const auto firstRow = table.numRows;
+            for (uint32_t row = 0; row < batch->numRows; ++row) {
+                table.addRow();
+            }
+            auto cell = batch->cells.begin();
+            for (uint32_t row = 0; row < batch->numRows; ++row) {
+                for (uint32_t col = 0; col < numColumns; ++col) {
+                    table.setColumnView(firstRow + row, col, *cell++);
+                }
+            }
+            if (capture) {
+                for (uint32_t row = 0; row < batch->numRows; ++row) {
+                    capture->addRow(batch->cells.data() + static_cast<size_t>(row) * numColumns);
+                }
+            }
+            resCounter += static_cast<int>(batch->numRows);
+            statementTiming.measure(Phase::Render, [&] {
+                TraceSpan span("render");
+                table.flush();
+            });
+            pipeline.recycle(std::move(batch));
+        }
+        moreResults = pipeline.moreRows();
+    }
+
+    if (resCounter == 0) {
+        std::cout << "No rows returned" << std::endl;
+        return false;
+    }
+
+    statementTiming.measure(Phase::Render, [&] {
+        TraceSpan span("render");
+        if (throttle && throttle->skippedRows() > 0) {
+            out.stream << skippedRowsLine(*throttle);
+            table.beginStreaming(out.stream, widths);
+            addHeader();
+            for (const auto& row : throttle->tail()) {
+                const auto tableRow = table.addRow();
+                for (uint32_t col = 0; col < numColumns; ++col) {
+                    table.setColumnView(tableRow, col, row[col]);
+                }
+            }
+        }
+        table.endStreaming();
+        out.buffer.drain();
+    });
+    std::cout << "Fetched " << resCounter << " rows" << std::endl;
+    if (closeIfFetchLimited(stmt)) {
+        return false;
+    }
+    return moreResults;
+}
+
+// Result sets a PL/SQL block returned with DBMS_SQL.RETURN_RESULT, each shown whole, or
+// exported, the way a query's rows would be.
+void printImplicitResults(OracleStatement& stmt) {
+    uint32_t resultNumber = 0;
+    while (auto result = stmt.nextImplicitResult()) {
+        applyFetchSettings(*result);
+        std::cout << "\nResultSet #" << ++resultNumber << std::endl;
+        if (resultOutput) {
+            auto numRows = statementTiming.measure(StatementTiming::Phase::Render, [&] {
+                return writeResults(*result, *resultOutput, resultOutputFormat);
+            });
+            if (!spoolPath.empty()) {
+                std::cout << "Spooled " << numRows << " rows to " << spoolPath << std::endl;
+            }
+            closeIfFetchLimited(*result);
+        } else {
+            fetchAndPrintResults(*result, std::numeric_limits<int>::max());
+        }
+    }
+}
+
+class Command;
+tsl::htrie_map<char, Command*>& getCommandMap() {
+    static tsl::htrie_map<char, Command*> globalMap;
+    return globalMap;
+}
+
+class Command {
+public:
+    virtual ~Command() = default;
+
+    explicit Command(std::string_view name)
+    {
+        getCommandMap().insert(name, this);
+    }
+
+    virtual std::string_view name() const noexcept = 0;
+    virtual bool run(Session& session, std::string_view cmdLine) = 0;
+};
+
+// Shared by .describe and the schema change notifications that invalidate it.
+DescribeCache describeCache;
+
+// Declared with .var and bound into every statement typed after that refers to them.
+BindVariables bindVariables;
+
+void bindReplVariables(Session& session, OracleStatement& stmt) {
+    bindVariables.bindInto(session.connection(), stmt);
+}
+
+class DescribeCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".describe");
+    DescribeCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .describe <table> [table...] describes each table, view or synonym named, and
+    // .describe [schema.]<pattern> every table and view whose name matches, with * for
+    // anything, e.g. .describe HR.* for a whole schema. More than one name, or a pattern,
+    // is described in one pass over the dictionary, and each table gets a heading.
+    bool run(Session& session, std::string_view cmdLine) override {
+        std::vector<std::string> names;
+        for (size_t pos = cmdLine.find_first_not_of(' '); pos != std::string_view::npos;
+                pos = cmdLine.find_first_not_of(' ', pos)) {
+            const auto end = std::min(cmdLine.find(' ', pos), cmdLine.size());
+            names.emplace_back(cmdLine.substr(pos, end - pos));
+            pos = end;
+        }
+        if (names.empty()) {
+            throw std::runtime_error("describe command requires a table name");
+        }
+
+        std::vector<std::shared_ptr<const TableDescription>> descriptions;
+        if (names.size() == 1 && names[0].find('*') != std::string::npos) {
+            const auto dot = names[0].find('.');
+            const auto owner = dot == std::string::npos ? std::string_view() : std::string_view(names[0]).substr(0, dot);
+            const auto pattern = dot == std::string::npos ? std::string_view(names[0])
+                                                          : std::string_view(names[0]).substr(dot + 1);
+            descriptions = describeCache.describeMatching(session.connection(), owner, pattern);
+            if (descriptions.empty()) {
+                throw std::runtime_error(fmt::format("no tables or views match {}", names[0]));
+            }
+        } else if (names.size() == 1) {
+            descriptions.push_back(describeCache.describe(session.connection(), names[0]));
+        } else {
+            descriptions = describeCache.describeMany(session.connection(), names);
+        }
+
+        const bool headings = descriptions.size() > 1 || names[0].find('*') != std::string::npos;
+        for (size_t idx = 0; idx < descriptions.size(); ++idx) {
+            const auto& description = descriptions[idx];
+            if (headings) {
+                std::cout << (idx == 0 ? "" : "\n") << description->name << std::endl;
+            }
+            Table table(3);
+            applyTableLayout(table);
+            table.addRow();
+            table.setColumnValue(0, 0, "Name");
+            table.setColumnValue(0, 1, "Null?");
+            table.setColumnValue(0, 2, "Type");
+            for (const auto& column : description->columns) {
+                auto row = table.addRow();
+                table.setColumnValue(row, 0, column.name);
+                table.setColumnValue(row, 1, column.nullable ? "Y" : "N");
+                table.setColumnValue(row, 2, columnTypeName(column));
+            }
+            table.render(std::cout);
+        }
+        return true;
+    }
+} cmdDescribe;
+
+class ExitCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".exit");
+    ExitCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session& session, std::string_view cmdLine) override {
+        return false;
+    }
+} cmdExit;
+
+
+class MoreRowsCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".moreRows");
+    MoreRowsCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session& session, std::string_view cmdLine) override {
+        printPage(std::nullopt);
+        return true;
+    }
+
+    void setActiveStatement(OracleStatement stmt, std::string sql, bool scrollable, uint64_t pageStart,
+                            std::shared_ptr<PagedTable> pages) {
+        setActive({std::move(stmt), std::move(sql), scrollable, pageStart, std::move(pages)});
+    }
+
+    void setActive(OpenResults::Entry entry) {
+        _pageStart = entry.pageStart;
+        _active = std::move(entry);
+    }
+
+    // Drops the active statement. It isn't closed, since it may be the statement cache's.
+    void clearActive() {
+        _active = std::nullopt;
+    }
+
+    std::optional<OpenResults::Entry> takeActive() {
+        if (_active) {
+            _active->pageStart = _pageStart;
+        }
+        return std::exchange(_active, std::nullopt);
+    }
+
+    std::optional<OracleStatement> takeActiveStatement() {
+        auto active = takeActive();
+        if (!active) {
+            return std::nullopt;
+        }
+        return std::move(active->stmt);
+    }
+
+    // Prints the page starting at a 1-based row, or the page after the last one without
+    // one. Jumping around takes a scrollable cursor.
+    void printPage(std::optional<uint64_t> startRow) {
+        if (!_active) {
+            std::cout << "No active statement" << std::endl;
+            return;
+        }
+        auto& stmt = _active->stmt;
+        if (startRow) {
+            if (!_active->scrollable) {
+                std::cout << "The active statement isn't scrollable; .set scrollable 1 and run it again"
+                          << std::endl;
+                return;
+            }
+            if (*startRow > static_cast<uint64_t>(std::numeric_limits<int32_t>::max())) {
+                throw std::runtime_error(fmt::format("row {} is out of range", *startRow));
+            }
+            statementTiming.reset();
+            statementTiming.measure(StatementTiming::Phase::Fetch, [&] {
+                stmt.scroll(DPI_MODE_FETCH_ABSOLUTE, static_cast<int32_t>(*startRow));
+            });
+        } else {
+            statementTiming.reset();
+        }
+
+        applyFetchArraySize(stmt);
+        _pageStart = stmt.rowCount() + 1;
+        // A scrollable cursor stays around at the end of the results so it can go back.
+        if (!_active->pages) {
+            _active->pages = std::make_shared<PagedTable>(stmt.numColumns());
+        }
+        const bool moreRows = fetchAndPrintResults(stmt, kPageRows, nullptr, _active->pages.get());
+        noteDefineBuffers(stmt);
+        printTiming();
+        if (!moreRows && (!_active->scrollable || !stmt.isOpen())) {
+            _active = std::nullopt;
+        }
+    }
+
+    uint64_t pageStart() const noexcept {
+        return _pageStart;
+    }
+
+private:
+    std::optional<OpenResults::Entry> _active;
+    // 1-based row number of the first row of the last page printed.
+    uint64_t _pageStart = 1;
+} moreRowsCmd;
+
+class PrevRowsCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".prevRows");
+    PrevRowsCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session& session, std::string_view cmdLine) override {
+        const auto pageStart = moreRowsCmd.pageStart();
+        if (pageStart == 1) {
+            std::cout << "Already at the first row" << std::endl;
+            return true;
+        }
+        moreRowsCmd.printPage(pageStart > kPageRows ? pageStart - kPageRows : 1);
+        return true;
+    }
+} prevRowsCmd;
+
+class GotoRowCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".gotoRow");
+    GotoRowCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session& session, std::string_view cmdLine) override {
+        uint64_t row = 0;
+        auto res = std::from_chars(cmdLine.data(), cmdLine.data() + cmdLine.size(), row);
+        if (res.ec != std::errc() || res.ptr != cmdLine.data() + cmdLine.size() || row == 0) {
+            throw std::runtime_error("usage: .gotoRow <row number, starting at 1>");
+        }
+        moreRowsCmd.printPage(row);
+        return true;
+    }
+} gotoRowCmd;
+
+// Named results kept open by .keep; past this many the least recently used is closed.
+UInt32Setting openCursorsSetting("opencursors", 4);
+OpenResults openResults(4);
+
+// A name for .keep and the commands after it: letters, digits and underscores.
+std::string_view resultName(std::string_view cmdLine, std::string_view usage) {
+    cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+    cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(' ') + 1);
+    const bool valid = !cmdLine.empty() && std::all_of(cmdLine.begin(), cmdLine.end(), [](unsigned char ch) {
+        return std::isalnum(ch) || ch == '_';
+    });
+    if (!valid) {
+        throw std::runtime_error(std::string(usage));
+    }
+    return cmdLine;
+}
+
+class KeepCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".keep");
+    KeepCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // Puts the active statement aside as name, to be picked up again with .resume.
+    bool run(Session& session, std::string_view cmdLine) override {
+        const auto name = resultName(cmdLine, "usage: .keep <name>");
+        auto active = moreRowsCmd.takeActive();
+        if (!active) {
+            std::cout << "No active statement" << std::endl;
+            return true;
+        }
+        // Running the same SQL again mustn't re-execute the kept cursor.
+        session.detachStatement(active->stmt);
+        openResults.setCapacity(openCursorsSetting.get());
+        for (const auto& evicted : openResults.keep(std::string(name), std::move(*active))) {
+            std::cout << "Closed " << evicted << " to stay within opencursors" << std::endl;
+        }
+        return true;
+    }
+} keepCmd;
+
+class ResumeCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".resume");
+    ResumeCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // Makes the results kept as name the active statement again and prints their next page.
+    bool run(Session& session, std::string_view cmdLine) override {
+        const auto name = resultName(cmdLine, "usage: .resume <name>");
+        auto entry = openResults.take(name);
+        if (!entry) {
+            throw std::runtime_error(fmt::format("no results kept as {}", name));
+        }
+        moreRowsCmd.setActive(std::move(*entry));
+        moreRowsCmd.printPage(std::nullopt);
+        return true;
+    }
+} resumeCmd;
+
+class CursorsCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".cursors");
+    CursorsCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session& session, std::string_view cmdLine) override {
+        const auto infos = openResults.list();
+        if (infos.empty()) {
+            std::cout << "No kept results" << std::endl;
+            return true;
+        }
+        Table table(5);
+        applyTableLayout(table);
+        table.addRow();
+        table.setColumnValue(0, 0, "Name");
+        table.setColumnValue(0, 1, "Rows fetched");
+        table.setColumnValue(0, 2, "Scrollable");
+        table.setColumnValue(0, 3, "Idle");
+        table.setColumnValue(0, 4, "SQL");
+        for (const auto& info : infos) {
+            const auto row = table.addRow();
+            table.setColumnValue(row, 0, info.name);
+            table.setColumnValue(row, 1, fmt::format("{}", info.rowsFetched));
+            table.setColumnValue(row, 2, info.scrollable ? "yes" : "no");
+            table.setColumnValue(row, 3, fmt::format("{:.0f}s", std::chrono::duration<double>(info.idle).count()));
+            table.setColumnValue(row, 4, info.sql);
+        }
+        table.render(std::cout);
+        std::cout << fmt::format("{} of {} kept", infos.size(), openCursorsSetting.get()) << std::endl;
+        return true;
+    }
+} cursorsCmd;
+
+class CloseCursorCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".closeCursor");
+    CloseCursorCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session& session, std::string_view cmdLine) override {
+        const auto name = resultName(cmdLine, "usage: .closeCursor <name> | all");
+        if (name == "all") {
+            std::cout << "Closed " << openResults.closeAll() << " kept results" << std::endl;
+        } else if (!openResults.close(name)) {
+            throw std::runtime_error(fmt::format("no results kept as {}", name));
+        }
+        return true;
+    }
+} closeCursorCmd;
+
+// Budget for the rows the pager keeps decoded, in KB.
+UInt32Setting pagerWindowSetting("pagerwindowkb", 4096);
+
+class PageCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".page");
+    PageCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // With a query, runs it and pages through its results; without one, pages through the
+    // rest of the active statement.
+    bool run(Session& session, std::string_view query) override {
+        std::optional<OracleStatement> stmt;
+        if (query.empty()) {
+            stmt = moreRowsCmd.takeActiveStatement();
+            if (!stmt) {
+                std::cout << "No active statement" << std::endl;
+                return true;
+            }
+        } else {
+            stmt = session.prepareStatement(query);
+            bindReplVariables(session, *stmt);
+            applyFetchSettings(*stmt);
+            stmt->execute();
+            if (stmt->numColumns() == 0) {
+                throw std::runtime_error("only queries can be paged");
+            }
+        }
+
+        applyFetchArraySize(*stmt);
+        ResultPager pager(*stmt, static_cast<size_t>(pagerWindowSetting.get()) * 1024);
+        pager.run();
+        closeIfFetchLimited(*stmt);
+        return true;
+    }
+} pageCmd;
+
+class WatchCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".watch");
+    WatchCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .watch <interval>[ms|s|m] [key <column>] <query> runs the query again every interval
+    // until q is pressed, redrawing only what changed. Rows are matched up by the key
+    // column: ROWID when the query selects it, otherwise the first column.
+    bool run(Session& session, std::string_view cmdLine) override {
+        constexpr std::string_view kUsage = "usage: .watch <interval>[ms|s|m] [key <column>] <query>";
+        auto nextWord = [&] {
+            cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+            auto word = cmdLine.substr(0, cmdLine.find(' '));
+            cmdLine.remove_prefix(word.size());
+            return word;
+        };
+
+        const auto intervalText = nextWord();
+        uint32_t count = 0;
+        auto res = std::from_chars(intervalText.data(), intervalText.data() + intervalText.size(), count);
+        const auto unit = intervalText.substr(static_cast<size_t>(res.ptr - intervalText.data()));
+        std::chrono::milliseconds interval;
+        if (res.ec != std::errc() || count == 0) {
+            throw std::runtime_error(std::string(kUsage));
+        } else if (unit.empty() || unit == "s") {
+            interval = std::chrono::seconds(count);
+        } else if (unit == "ms") {
+            interval = std::chrono::milliseconds(count);
+        } else if (unit == "m") {
+            interval = std::chrono::minutes(count);
+        } else {
+            throw std::runtime_error(std::string(kUsage));
+        }
+
+        std::string keyName = "ROWID";
+        const auto afterInterval = cmdLine;
+        if (nextWord() == "key") {
+            keyName = std::string(nextWord());
+            std::transform(keyName.begin(), keyName.end(), keyName.begin(),
+                           [](unsigned char ch) { return static_cast<char>(std::toupper(ch)); });
+        } else {
+            cmdLine = afterInterval;
+        }
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        if (cmdLine.empty()) {
+            throw std::runtime_error(std::string(kUsage));
+        }
+
+        // Prepared once; every tick is just an execute and a fetch of a screenful.
+        auto stmt = session.prepareStatement(cmdLine);
+        bindReplVariables(session, stmt);
+        applyFetchSettings(stmt);
+        stmt.execute();
+        const auto numColumns = stmt.numColumns();
+        if (numColumns == 0) {
+            throw std::runtime_error("only queries can be watched");
+        }
+        auto columnNames = stmt.metadata()->names();
+        auto keyIt = std::find(columnNames.begin(), columnNames.end(), keyName);
+        if (keyIt == columnNames.end()) {
+            if (keyName != "ROWID") {
+                throw std::runtime_error(fmt::format("the query has no column {}", keyName));
+            }
+            keyIt = columnNames.begin();
+        }
+
+        auto formatters = makeColumnFormatters(stmt);
+        WatchView view(columnNames, static_cast<uint32_t>(keyIt - columnNames.begin()));
+        RawTerminal terminal;
+        for (uint64_t tick = 1;; ++tick) {
+            const auto deadline = std::chrono::steady_clock::now() + interval;
+            const auto [screenRows, screenColumns] = terminal.size();
+            const auto wantedRows = WatchView::viewRows(screenRows);
+
+            std::vector<std::vector<std::string>> rows;
+            bool moreRows = true;
+            while (moreRows && rows.size() < wantedRows) {
+                auto block = stmt.fetchBlock(stmt.fetchArraySize());
+                moreRows = block.moreRows();
+                for (uint32_t col = 1; col <= numColumns; ++col) {
+                    auto& formatter = formatters[col - 1];
+                    if (formatter.nativeType() != block.nativeType(col)) {
+                        formatter = ColumnFormatter(block.nativeType(col), formatter.oracleType());
+                    }
+                }
+                for (uint32_t row = 0; row < block.numRows() && rows.size() < wantedRows; ++row) {
+                    auto& cells = rows.emplace_back();
+                    for (uint32_t col = 1; col <= numColumns; ++col) {
+                        fmt::memory_buffer text;
+                        formatters[col - 1].format(block.columnData(col)[row], text);
+                        cells.emplace_back(text.data(), text.size());
+                    }
+                }
+            }
+
+            char clock[16] = "";
+            const auto now = std::time(nullptr);
+            std::strftime(clock, sizeof(clock), "%H:%M:%S", std::localtime(&now));
+            const auto status = fmt::format(" every {}  {}{} rows  run {} at {}  q to stop",
+                    intervalText, rows.size(), moreRows ? "+" : "", tick, clock);
+            terminal.write(view.update(std::move(rows), status, screenRows, screenColumns));
+
+            for (auto left = deadline - std::chrono::steady_clock::now(); left.count() > 0;
+                 left = deadline - std::chrono::steady_clock::now()) {
+                const auto keys = terminal.readKeys(-1,
+                        static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(left).count()));
+                if (std::find(keys.begin(), keys.end(), Key::Quit) != keys.end()) {
+                    return true;
+                }
+            }
+            stmt.execute();
+        }
+    }
+} watchCmd;
+
+// Most targets .fanout has connected and running at once.
+UInt32Setting fanoutSetting("fanout", 16);
+
+class FanoutCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".fanout");
+    FanoutCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .fanout <targets file> <sql> runs the statement on every connect string in the file,
+    // logging on with this session's credentials, and shows the rows of all of them as one
+    // table with a SOURCE column saying which target each came from. A query with an ORDER
+    // BY is merged in that order across the targets as their rows arrive.
+    bool run(Session& session, std::string_view cmdLine) override {
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        const auto pathEnd = std::min(cmdLine.find(' '), cmdLine.size());
+        const std::string path(cmdLine.substr(0, pathEnd));
+        auto sql = cmdLine.substr(pathEnd);
+        sql.remove_prefix(std::min(sql.find_first_not_of(' '), sql.size()));
+        if (path.empty() || sql.empty()) {
+            throw std::runtime_error("usage: .fanout <targets file> <sql>");
+        }
+        auto targets = loadFanoutTargets(path);
+        if (targets.empty()) {
+            throw std::runtime_error(fmt::format("{} has no targets", path));
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        FanoutQuery query([&session](const std::string& connString) { return session.newConnectionTo(connString); },
+                          std::move(targets), std::string(sql), fanoutSetting.get());
+        std::optional<Table> table;
+        constexpr uint64_t kRowsPerFlush = 1000;
+        uint64_t rows = 0;
+        while (auto batch = query.next()) {
+            const auto names = query.columnNames();
+            if (!table) {
+                table.emplace(static_cast<Table::Width>(names.size() + 1));
+                applyTableLayout(*table);
+                table->beginStreaming(std::cout);
+                table->addRow();
+                table->setColumnValue(0, 0, "SOURCE");
+                for (size_t col = 0; col < names.size(); ++col) {
+                    table->setColumnValue(0, static_cast<Table::Width>(col + 1), names[col]);
+                }
+            }
+            for (uint32_t row = 0; row < batch->numRows; ++row) {
+                const auto tableRow = table->addRow();
+                table->setColumnValue(tableRow, 0, query.targets()[batch->targets[row]]);
+                for (size_t col = 0; col < names.size(); ++col) {
+                    table->setColumnValue(tableRow, static_cast<Table::Width>(col + 1),
+                                          batch->cells[row * names.size() + col]);
+                }
+                if (++rows % kRowsPerFlush == 0) {
+                    table->flush();
+                }
+            }
+        }
+        const bool isQuery = !query.columnNames().empty();
+        if (table) {
+            table->endStreaming();
+        } else if (isQuery) {
+            std::cout << "No rows returned" << std::endl;
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        const auto& outcomes = query.outcomes();
+        size_t failed = 0;
+        for (size_t idx = 0; idx < outcomes.size(); ++idx) {
+            const auto& outcome = outcomes[idx];
+            if (outcome.failed) {
+                ++failed;
+                std::cerr << fmt::format("{}: Error {}", query.targets()[idx], outcome.message) << std::endl;
+            } else if (!isQuery) {
+                std::cout << fmt::format("{}: {} ({:.3f}s)", query.targets()[idx], outcome.message,
+                                         outcome.seconds) << std::endl;
+            }
+        }
+        if (isQuery) {
+            std::cout << fmt::format("Fetched {} rows from {} targets in {:.3f}s", rows,
+                                     outcomes.size() - failed, elapsed.count());
+        } else {
+            std::cout << fmt::format("Ran on {} targets in {:.3f}s", outcomes.size() - failed, elapsed.count());
+        }
+        if (failed > 0) {
+            std::cout << fmt::format(", {} failed", failed);
+        }
+        std::cout << std::endl;
+        return true;
+    }
+} fanoutCmd;
+
+class HistoryCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".history");
+    HistoryCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .history [text] lists the latest statements, or the latest ones containing text
+    // ignoring case, oldest first so the newest ends up next to the prompt.
+    bool run(Session&, std::string_view cmdLine) override {
+        constexpr size_t kMaxShown = 25;
+        if (!historyStore) {
+            throw std::runtime_error("there's no history file");
+        }
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        cmdLine.remove_suffix(cmdLine.size() - std::min(cmdLine.find_last_not_of(' ') + 1, cmdLine.size()));
+        auto matches = historyStore->search(cmdLine, kMaxShown);
+        if (matches.empty()) {
+            std::cout << "No matching history" << std::endl;
+            return true;
+        }
+        for (auto it = matches.rbegin(); it != matches.rend(); ++it) {
+            std::cout << *it << std::endl;
+        }
+        return true;
+    }
+} historyCmd;
+
+// Set while .autotrace is on: what taking the snapshots themselves adds to the counters,
+// measured when it's turned on and taken off every report.
+std::optional<SessionStats> autotraceOverhead;
+
+class AutotraceCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".autotrace");
+    AutotraceCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session& session, std::string_view arg) override {
+        if (arg == "on") {
+            const auto first = SessionStats::snapshot(session);
+            const auto second = SessionStats::snapshot(session);
+            autotraceOverhead = second.since(first, SessionStats{});
+        } else if (arg == "off") {
+            autotraceOverhead.reset();
+        } else if (arg.empty()) {
+            std::cout << "autotrace is " << (autotraceOverhead ? "on" : "off") << std::endl;
+        } else {
+            throw std::runtime_error("usage: .autotrace [on|off]");
+        }
+        return true;
+    }
+} autotraceCmd;
+
+// The cursor .xplan last shows. Left unset, DBMS_XPLAN.DISPLAY_CURSOR finds the session's
+// previous statement itself; autotrace runs its own queries after each statement, so with
+// autotrace on the cursor is recorded before they run.
+struct CursorId {
+    std::string sqlId;
+    int64_t childNumber = 0;
+};
+std::optional<CursorId> lastCursor;
+
+CursorId previousCursor(Session& session) {
+    auto stmt = session.prepareStatement(
+            "select prev_sql_id, cast(prev_child_number as number(10)) from v$session "
+            "where sid = sys_context('userenv', 'sid')");
+    stmt.execute();
+    if (!stmt.fetch()) {
+        throw std::runtime_error("the session isn't in v$session");
+    }
+    CursorId cursor;
+    cursor.sqlId = std::string(stmt.getColumnValue(1).as<std::string_view>());
+    cursor.childNumber = stmt.getColumnValue(2).as<int64_t>();
+    return cursor;
+}
+
+// Quotes value as a SQL string literal.
+std::string sqlLiteral(std::string_view value) {
+    std::string out = "'";
+    for (auto ch : value) {
+        out += ch;
+        if (ch == '\'') {
+            out += ch;
+        }
+    }
+    out += '\'';
+    return out;
+}
+
+// Plan output is one row per line, and all of it is shown rather than a page.
+void printPlan(OracleStatement& plan) {
+    applyFetchSettings(plan);
+    plan.execute();
+    fetchAndPrintResults(plan, std::numeric_limits<int>::max());
+}
+
+class ExplainCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".explain");
+    ExplainCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session& session, std::string_view sql) override {
+        if (sql.empty()) {
+            throw std::runtime_error("usage: .explain <sql>");
+        }
+        constexpr std::string_view kStatementId = "SQLPLUSPLUS";
+        auto explain = session.connection().prepareStatement(
+                fmt::format("explain plan set statement_id = '{}' for {}", kStatementId, sql));
+        explain.execute();
+        auto plan = session.prepareStatement(fmt::format(
+                "select plan_table_output from table(dbms_xplan.display('PLAN_TABLE', '{}', 'TYPICAL'))",
+                kStatementId));
+        printPlan(plan);
+        return true;
+    }
+} explainCmd;
+
+class XplanCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".xplan");
+    XplanCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .xplan last [format] shows the plan the last statement actually ran with, from the
+    // cursor cache. format is a DBMS_XPLAN format such as "ALLSTATS LAST".
+    bool run(Session& session, std::string_view args) override {
+        auto format = std::string_view("TYPICAL");
+        if (args.substr(0, 4) != "last" || (args.size() > 4 && args[4] != ' ')) {
+            throw std::runtime_error("usage: .xplan last [format]");
+        }
+        args.remove_prefix(std::min(args.find_first_not_of(' ', 4), args.size()));
+        if (!args.empty()) {
+            format = args;
+        }
+
+        std::string sqlId = "null";
+        std::string childNumber = "null";
+        if (lastCursor) {
+            sqlId = sqlLiteral(lastCursor->sqlId);
+            childNumber = std::to_string(lastCursor->childNumber);
+        }
+        auto plan = session.prepareStatement(fmt::format(
+                "select plan_table_output from table(dbms_xplan.display_cursor({}, {}, {}))",
+                sqlId, childNumber, sqlLiteral(format)));
+        printPlan(plan);
+        return true;
+    }
+} xplanCmd;
+
+// The SQL_ID of the last statement run, for .monitor last. Empty when the
+// client can't tell, where .monitor asks the session for its previous statement instead.
+std::string lastSqlId;
+
+class MonitorCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".monitor");
+    MonitorCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .monitor [sql_id|last] shows the real-time SQL Monitor report of a statement's
+    // latest monitored execution: each plan line's actual rows, time and waits, and how
+    // the work split across parallel servers. The server monitors parallel statements,
+    // ones that have run for 5 s and ones with the MONITOR hint; the report is empty for
+    // anything else. Needs the Tuning Pack.
+    bool run(Session& session, std::string_view arg) override {
+        std::string sqlId(arg);
+        if (arg.empty() || arg == "last") {
+            sqlId = !lastSqlId.empty() ? lastSqlId : previousCursor(session).sqlId;
+        } else if (arg.find(' ') != std::string_view::npos) {
+            throw std::runtime_error("usage: .monitor [sql_id|last]");
+        }
+        if (sqlId.empty()) {
+            throw std::runtime_error("no statement has been run yet");
+        }
+        auto report = session.connection().prepareStatement(fmt::format(
+                "select dbms_sqltune.report_sql_monitor(sql_id => {}, type => 'TEXT', report_level => 'ALL') from dual",
+                sqlLiteral(sqlId)));
+        report.execute();
+        if (!report.fetch() || report.getColumnValue(1).isNull()) {
+            std::cout << "No SQL Monitor report for " << sqlId << std::endl;
+            return true;
+        }
+        // A report of a big parallel plan runs to megabytes, so it's written as it's read.
+        OracleLobReader reader(report.context());
+        reader.open(report.getColumnValue(1).as<dpiLob*>());
+        char last = '\n';
+        for (auto piece = reader.next(); !piece.empty(); piece = reader.next()) {
+            std::cout.write(piece.data(), static_cast<std::streamsize>(piece.size()));
+            last = piece.back();
+        }
+        if (last != '\n') {
+            std::cout << '\n';
+        }
+        std::cout << std::flush;
+        return true;
+    }
+} monitorCmd;
+
+class TimingCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".timing");
+    TimingCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session&, std::string_view arg) override {
+        if (arg == "on") {
+            timingEnabled = true;
+        } else if (arg == "off") {
+            timingEnabled = false;
+        } else if (arg.empty()) {
+            std::cout << "timing is " << (timingEnabled ? "on" : "off") << std::endl;
+        } else {
+            throw std::runtime_error("usage: .timing [on|off]");
+        }
+        return true;
+    }
+} timingCmd;
+
+class SetCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".set");
+    SetCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session& session, std::string_view cmdLine) override {
+        auto nameEnd = cmdLine.find_first_of(' ');
+        auto settingName = cmdLine.substr(0, nameEnd);
+        if (settingName.empty()) {
+            for (auto it = getSettingMap().begin(); it != getSettingMap().end(); ++it) {
+                std::cout << it.key() << " " << it.value()->value() << std::endl;
+            }
+            return true;
+        }
+
+        auto settingIt = getSettingMap().find(settingName);
+        if (settingIt == getSettingMap().end()) {
+            std::cout << "Unknown setting " << settingName << std::endl;
+            return true;
+        }
+
+        std::string_view value;
+        if (nameEnd != std::string_view::npos) {
+            value = cmdLine.substr(nameEnd);
+            value.remove_prefix(std::min(value.find_first_not_of(' '), value.size()));
+        }
+
+        if (value.empty()) {
+            std::cout << settingName << " " << settingIt.value()->value() << std::endl;
+        } else {
+            settingIt.value()->set(value);
+        }
+        return true;
+    }
+} setCmd;
+
+class StatsCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".stats");
+    StatsCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session& session, std::string_view) override {
+        auto stats = session.statementCache().stats();
+        const auto lookups = stats.hits + stats.misses;
+        const double hitRate = lookups == 0 ? 0.0 : 100.0 * static_cast<double>(stats.hits) / lookups;
+        std::cout << fmt::format(
+                "statement cache: {} hits, {} misses ({:.1f}% hit rate), {} evictions, {}/{} entries",
+                stats.hits, stats.misses, hitRate, stats.evictions, stats.size, stats.capacity)
+            << '\n' << clientCounters.summary() << std::endl;
+        // Not before the session is up: asking would be what connects.
+        if (session.isReady()) {
+            printClientResultCache(session);
+        }
+        return true;
+    }
+
+private:
+    // Cache hits come from what the client last reported to the server, so they can trail
+    // the executes counted here by a few seconds.
+    static void printClientResultCache(Session& session) {
+        const auto cacheable = static_cast<int64_t>(clientCounters.value(ClientCounter::ResultCacheExecutes));
+        try {
+            const auto cache = ClientResultCacheStats::snapshot(session);
+            if (!cache) {
+                std::cout << "client result cache: off (see the server's CLIENT_RESULT_CACHE_SIZE, or "
+                             "OCI_RESULT_CACHE_MAX_SIZE in sqlnet.ora)" << std::endl;
+                return;
+            }
+            std::cout << fmt::format(
+                    "client result cache: {} hits, {} of {} cacheable executes went to the server, "
+                    "{} results cached, {} invalidated",
+                    cache->hits, std::max<int64_t>(cacheable - cache->hits, 0), cacheable, cache->created,
+                    cache->invalidated) << std::endl;
+        } catch (const OracleException& e) {
+            std::cout << "client result cache: " << e.what() << std::endl;
+        }
+    }
+} statsCmd;
+
+class SpoolCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".spool");
+    SpoolCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session&, std::string_view path) override {
+        if (path.empty()) {
+            if (spoolPath.empty()) {
+                std::cout << "not spooling" << std::endl;
+            } else {
+                std::cout << "spooling to " << spoolPath << std::endl;
+            }
+            return true;
+        }
+
+        if (!spoolPath.empty()) {
+            resetResultOutput();
+        }
+        if (path == "off") {
+            return true;
+        }
+
+        spoolPath = std::string(path);
+        resultOutput.emplace(BufferedFdWriter::open(spoolPath, compressionForPath(spoolPath), fileWriteOptions()));
+        resultOutputFormat = resultFormatForPath(path);
+        return true;
+    }
+} spoolCmd;
+
+class PipeCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".pipe");
+    PipeCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .pipe <command> <sql> streams the query's rows as TSV into a shell command's stdin,
+    // e.g. .pipe "gzip > out.tsv.gz" select * from orders. A command with spaces in it is
+    // quoted.
+    bool run(Session& session, std::string_view cmdLine) override {
+        constexpr auto kUsage = "usage: .pipe <command> <sql>";
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        std::string_view command;
+        if (!cmdLine.empty() && (cmdLine.front() == '"' || cmdLine.front() == '\'')) {
+            const auto close = cmdLine.find(cmdLine.front(), 1);
+            if (close == std::string_view::npos) {
+                throw std::runtime_error(kUsage);
+            }
+            command = cmdLine.substr(1, close - 1);
+            cmdLine.remove_prefix(close + 1);
+        } else {
+            const auto end = std::min(cmdLine.find(' '), cmdLine.size());
+            command = cmdLine.substr(0, end);
+            cmdLine.remove_prefix(end);
+        }
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(" ;") + 1);
+        if (command.empty() || cmdLine.empty()) {
+            throw std::runtime_error(kUsage);
+        }
+
+        auto stmt = session.prepareStatement(cmdLine);
+        bindReplVariables(session, stmt);
+        applyFetchSettings(stmt);
+        stmt.execute();
+        if (stmt.numColumns() == 0) {
+            throw std::runtime_error("only queries can be piped");
+        }
+
+        std::cout.flush();
+        PipedCommand piped{std::string(command)};
+        uint64_t numRows = 0;
+        bool stoppedReading = false;
+        try {
+            BufferedFdWriter out(piped.fd());
+            numRows = writeResults(stmt, out, ResultFormat::Tsv);
+            out.flush();
+        } catch (const std::system_error& e) {
+            if (e.code() != std::errc::broken_pipe) {
+                throw;
+            }
+            // Whatever the command didn't want isn't fetched.
+            stoppedReading = true;
+            stmt.close();
+        }
+        const auto status = piped.wait();
+        if (stoppedReading) {
+            std::cout << fmt::format("{} stopped reading its input; it exited with status {}", command, status)
+                      << std::endl;
+        } else {
+            std::cout << fmt::format("Piped {} rows to {}; it exited with status {}", numRows, command, status)
+                      << std::endl;
+        }
+        return true;
+    }
+} pipeCmd;
+
+// Messages .deq and .enq move per round trip.
+UInt32Setting aqBatchSetting("aqbatch", 1000);
+
+class DeqCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".deq");
+    DeqCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .deq <queue> <count>|tail [consumer] dequeues up to count messages from a RAW queue,
+    // or with tail keeps waiting for more until Ctrl-C, and writes each payload to stdout
+    // on a line of its own. Messages are dequeued aqbatch at a time.
+    bool run(Session& session, std::string_view cmdLine) override {
+        constexpr auto kUsage = "usage: .deq <queue> <count>|tail [consumer]";
+        auto nextWord = [&] {
+            cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+            auto word = cmdLine.substr(0, cmdLine.find(' '));
+            cmdLine.remove_prefix(word.size());
+            return std::string(word);
+        };
+        const auto queueName = nextWord();
+        const auto countText = nextWord();
+        const auto consumer = nextWord();
+        if (queueName.empty() || countText.empty()) {
+            throw std::runtime_error(kUsage);
+        }
+        const bool tail = countText == "tail";
+        uint64_t count = 0;
+        if (!tail) {
+            const auto res = std::from_chars(countText.data(), countText.data() + countText.size(), count);
+            if (res.ec != std::errc() || res.ptr != countText.data() + countText.size() || count == 0) {
+                throw std::runtime_error(kUsage);
+            }
+        }
+
+        auto queue = session.connection().openQueue(queueName);
+        if (!consumer.empty()) {
+            queue.setConsumerName(consumer);
+        }
+        const auto batch = std::max<uint32_t>(aqBatchSetting.get(), 1);
+        std::cout.flush();
+        BufferedFdWriter out(STDOUT_FILENO);
+        uint64_t numMessages = 0;
+        try {
+            while (tail || numMessages < count) {
+                const auto wanted = tail ? batch : static_cast<uint32_t>(std::min<uint64_t>(batch, count - numMessages));
+                const auto got = queue.dequeue(wanted, tail ? DPI_DEQ_WAIT_FOREVER : DPI_DEQ_WAIT_NO_WAIT,
+                        [&](std::string_view payload) {
+                            out.append(payload);
+                            out.append('\n');
+                        });
+                numMessages += got;
+                // Tailed messages are shown as they come rather than a buffer at a time.
+                out.flush();
+                if (got == 0 && !tail) {
+                    break;
+                }
+            }
+        } catch (const OracleException& e) {
+            // Ctrl-C is how a tail ends.
+            if (!tail || e.info().code != 1013) {
+                throw;
+            }
+        }
+        out.flush();
+        std::cout << fmt::format("Dequeued {} messages from {}", numMessages, queueName) << std::endl;
+        return true;
+    }
+} deqCmd;
+
+class EnqCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".enq");
+    EnqCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .enq <queue> <file> enqueues each non-empty line of file as the payload of a message
+    // on a RAW queue, aqbatch lines a round trip, e.g. to replay what .deq drained.
+    bool run(Session& session, std::string_view cmdLine) override {
+        constexpr auto kUsage = "usage: .enq <queue> <file>";
+        auto nextWord = [&] {
+            cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+            auto word = cmdLine.substr(0, cmdLine.find(' '));
+            cmdLine.remove_prefix(word.size());
+            return std::string(word);
+        };
+        const auto queueName = nextWord();
+        const auto path = nextWord();
+        if (queueName.empty() || path.empty()) {
+            throw std::runtime_error(kUsage);
+        }
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            throw std::system_error(errno, std::generic_category(), fmt::format("error opening {}", path));
+        }
+
+        auto queue = session.connection().openQueue(queueName);
+        const auto batch = std::max<uint32_t>(aqBatchSetting.get(), 1);
+        std::vector<std::string> lines(batch);
+        std::vector<std::string_view> payloads;
+        payloads.reserve(batch);
+        uint64_t numMessages = 0;
+        auto send = [&] {
+            queue.enqueue(payloads);
+            numMessages += payloads.size();
+            payloads.clear();
+        };
+        while (std::getline(in, lines[payloads.size()])) {
+            auto& line = lines[payloads.size()];
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.empty()) {
+                continue;
+            }
+            payloads.push_back(line);
+            if (payloads.size() == batch) {
+                send();
+            }
+        }
+        if (in.bad()) {
+            throw std::system_error(errno, std::generic_category(), fmt::format("error reading {}", path));
+        }
+        send();
+        std::cout << fmt::format("Enqueued {} messages on {}", numMessages, queueName) << std::endl;
+        return true;
+    }
+} enqCmd;
+
+// Documents .soda fetches or inserts per round trip.
+UInt32Setting sodaBatchSetting("sodabatch", 1000);
+
+class SodaCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".soda");
+    SodaCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .soda find <collection> [filter] writes the collection's documents, or those matching
+    // a query by example filter, to stdout as NDJSON. .soda insert <collection> <file>
+    // inserts each non-empty line of an NDJSON file as a document. Both move sodabatch
+    // documents a round trip, and each batch inserted is committed with it.
+    bool run(Session& session, std::string_view cmdLine) override {
+        constexpr auto kUsage = "usage: .soda find <collection> [filter] | .soda insert <collection> <file>";
+        auto nextWord = [&] {
+            cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+            auto word = cmdLine.substr(0, cmdLine.find(' '));
+            cmdLine.remove_prefix(word.size());
+            return std::string(word);
+        };
+        const auto action = nextWord();
+        const auto collectionName = nextWord();
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(' ') + 1);
+        if (collectionName.empty() || (action != "find" && action != "insert")) {
+            throw std::runtime_error(kUsage);
+        }
+        const auto batch = std::max<uint32_t>(sodaBatchSetting.get(), 1);
+        auto collection = session.connection().openSodaCollection(collectionName);
+
+        if (action == "find") {
+            std::cout.flush();
+            BufferedFdWriter out(STDOUT_FILENO);
+            const auto numDocs = collection.find(cmdLine, batch, [&](std::string_view content) {
+                // A line break can only be whitespace between tokens in JSON text, so a
+                // pretty printed document goes onto its one line by blanking them.
+                auto ptr = out.reserve(content.size() + 1);
+                ptr = std::replace_copy_if(content.begin(), content.end(), ptr,
+                        [](char ch) { return ch == '\n' || ch == '\r'; }, ' ');
+                *ptr++ = '\n';
+                out.commit(ptr);
+            });
+            out.flush();
+            std::cout << fmt::format("Found {} documents in {}", numDocs, collectionName) << std::endl;
+            return true;
+        }
+
+        if (cmdLine.empty()) {
+            throw std::runtime_error(kUsage);
+        }
+        const std::string path(cmdLine);
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            throw std::system_error(errno, std::generic_category(), fmt::format("error opening {}", path));
+        }
+        std::vector<std::string> lines(batch);
+        std::vector<std::string_view> contents;
+        contents.reserve(batch);
+        uint64_t numDocs = 0;
+        auto send = [&] {
+            collection.insertMany(contents);
+            numDocs += contents.size();
+            contents.clear();
+        };
+        while (std::getline(in, lines[contents.size()])) {
+            auto& line = lines[contents.size()];
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.find_first_not_of(" \t") == std::string::npos) {
+                continue;
+            }
+            contents.push_back(line);
+            if (contents.size() == batch) {
+                send();
+            }
+        }
+        if (in.bad()) {
+            throw std::system_error(errno, std::generic_category(), fmt::format("error reading {}", path));
+        }
+        send();
+        std::cout << fmt::format("Inserted {} documents into {}", numDocs, collectionName) << std::endl;
+        return true;
+    }
+} sodaCmd;
+
+// Bumped on each Ctrl-C, for commands that wait on something other than a round trip, which
+// breaking the session's execution doesn't wake.
+std::atomic<uint32_t> interruptCount{0};
+
+class ListenCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".listen");
+    ListenCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .listen <table> streams every committed change to the table, with the rowids that
+    // changed, to stdout as NDJSON until Ctrl-C. .listen <query> streams a notification
+    // each time a commit changes the query's result. The subscription is on a connection
+    // of its own, with events enabled.
+    bool run(Session& session, std::string_view cmdLine) override {
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(" ;") + 1);
+        if (cmdLine.empty()) {
+            throw std::runtime_error("usage: .listen <table> | .listen <query>");
+        }
+        const bool table = cmdLine.find_first_of(" \t\n") == std::string_view::npos;
+        const auto sql = table
+            ? fmt::format("select 1 from {} where 1 = 0", normalizeIdentifier(cmdLine, true))
+            : std::string(cmdLine);
+
+        ChangeEventQueue events;
+        auto conn = session.newConnection(true);
+        auto onMessage = [&events](const dpiSubscrMessage& message) { events.push(message); };
+        auto subscription = table
+            ? conn.subscribeObjectChanges(DPI_OPCODE_ALL_OPS, onMessage, true)
+            : conn.subscribeQueryChanges(onMessage);
+        subscription.registerQuery(sql);
+
+        std::cerr << fmt::format("Listening for changes to {}; Ctrl-C to stop", cmdLine) << std::endl;
+        std::cout.flush();
+        BufferedFdWriter out(STDOUT_FILENO);
+        const auto interrupts = interruptCount.load();
+        std::string batch;
+        uint64_t numEvents = 0;
+        while (interruptCount.load() == interrupts) {
+            if (const auto taken = events.take(batch, std::chrono::milliseconds(200)); taken > 0) {
+                numEvents += taken;
+                out.append(batch);
+                out.flush();
+            }
+        }
+        std::cout << fmt::format("Saw {} change events", numEvents) << std::endl;
+        return true;
+    }
+} listenCmd;
+
+// A size such as 1GB, 512M or 64k, in powers of 1024; a bare number is bytes.
+uint64_t byteSizeValue(std::string_view text) {
+    uint64_t value = 0;
+    const auto res = std::from_chars(text.data(), text.data() + text.size(), value);
+    auto unit = std::string(text.substr(static_cast<size_t>(res.ptr - text.data())));
+    std::transform(unit.begin(), unit.end(), unit.begin(), [](unsigned char ch) {
+        return static_cast<char>(std::toupper(ch));
+    });
+    if (!unit.empty() && unit.back() == 'B') {
+        unit.pop_back();
+    }
+    constexpr std::string_view kUnits = "KMGT";
+    const auto unitIndex = unit.size() == 1 ? kUnits.find(unit[0]) : std::string_view::npos;
+    const auto scale = unit.empty() ? 0 : unitIndex + 1;
+    if (res.ec != std::errc() || res.ptr == text.data() || (!unit.empty() && unitIndex == std::string_view::npos)) {
+        throw std::runtime_error(fmt::format("invalid size \"{}\"", text));
+    }
+    return value << (10 * scale);
+}
+
+// What every kind of export to path in format, "parquet", "csv", "tsv" or "ndjson", writes
+// its files with.
+ParallelExportOptions exportOptions(std::string_view format, const std::string& path) {
+    ParallelExportOptions opts;
+    opts.format = format == "parquet" ? ExportFormat::Parquet :
+        format == "csv" ? ExportFormat::Csv :
+        format == "tsv" ? ExportFormat::Tsv : ExportFormat::Ndjson;
+    opts.parquetRowGroupRows = parquetRowGroupSetting.get();
+    opts.compression = compressionForPath(path);
+    opts.fileWrite = fileWriteOptions();
+    return opts;
+}
+
+class ExportCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".export");
+    ExportCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session& session, std::string_view cmdLine) override {
+        auto nextToken = [&] {
+            cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+            auto end = std::min(cmdLine.find(' '), cmdLine.size());
+            auto token = cmdLine.substr(0, end);
+            cmdLine.remove_prefix(end);
+            return token;
+        };
+        auto format = nextToken();
+        if (format == "--resume") {
+            const auto path = std::string(nextToken());
+            const auto checkpoint = path.empty() ? std::nullopt : readExportCheckpoint(checkpointPath(path));
+            if (!checkpoint) {
+                throw std::runtime_error("usage: .export --resume <file>, for a file an interrupted parallel export left a checkpoint for");
+            }
+            return _exportParallel(session, checkpoint->parallel, checkpoint->byPartition, checkpoint->format, path,
+                                   checkpoint->table, &*checkpoint);
+        }
+        std::string queueJob;
+        if (format == "--queue") {
+            queueJob = std::string(nextToken());
+            format = nextToken();
+            if (queueJob.empty() || (format != "--parallel" && format != "--partitions")) {
+                throw std::runtime_error(
+                        "usage: .export --queue <job> --parallel <n> | --partitions <n> parquet|csv|tsv|ndjson <file> <table>");
+            }
+        }
+        SplitLimits split;
+        while (format == "--split-size" || format == "--split-rows") {
+            const auto value = nextToken();
+            if (format == "--split-size") {
+                split.maxBytes = byteSizeValue(value);
+            } else {
+                auto res = std::from_chars(value.data(), value.data() + value.size(), split.maxRows);
+                if (res.ec != std::errc() || res.ptr != value.data() + value.size() || split.maxRows == 0) {
+                    throw std::runtime_error("usage: .export --split-rows <n> parquet|csv|tsv|ndjson <file> <query | table>");
+                }
+            }
+            format = nextToken();
+        }
+        uint32_t parallel = 0;
+        const bool byPartition = format == "--partitions";
+        if (format == "--parallel" || byPartition) {
+            auto count = nextToken();
+            auto res = std::from_chars(count.data(), count.data() + count.size(), parallel);
+            if (res.ec != std::errc() || res.ptr != count.data() + count.size() || parallel == 0) {
+                throw std::runtime_error(fmt::format(
+                        "usage: .export {} <n> parquet|csv|tsv|ndjson <file> <table>", format));
+            }
+            format = nextToken();
+        }
+        // An expression with no spaces in it, since it's a token like the rest.
+        std::string_view splitBy;
+        if (format == "--split-by") {
+            splitBy = nextToken();
+            format = nextToken();
+            if (splitBy.empty() || parallel == 0 || byPartition || !queueJob.empty()) {
+                throw std::runtime_error(
+                        "usage: .export --parallel <n> --split-by <expr> parquet|csv|tsv|ndjson <file> <query>");
+            }
+        }
+        auto path = std::string(nextToken());
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        if (format.empty() || path.empty() || cmdLine.empty()) {
+            throw std::runtime_error(
+                    "usage: .export [--split-size <size>] [--split-rows <n>] [--queue <job>] "
+                    "[--parallel <n> [--split-by <expr>] | --partitions <n>] parquet|csv|tsv|ndjson <file> "
+                    "<query | table>");
+        }
+        if (format != "parquet" && format != "csv" && format != "tsv" && format != "ndjson") {
+            throw std::runtime_error(fmt::format("unknown export format {}", format));
+        }
+        if (format == "parquet" && isGzipPath(path)) {
+            throw std::runtime_error("parquet files can't be gzipped; export to csv, tsv or ndjson instead");
+        }
+        if (parallel > 0) {
+            if (split.enabled()) {
+                throw std::runtime_error("--split-size and --split-rows can't be used with --parallel or --partitions");
+            }
+            if (!splitBy.empty()) {
+                return _exportQuerySlices(session, parallel, splitBy, format, path, cmdLine);
+            }
+            if (!queueJob.empty()) {
+                return _exportQueue(session, queueJob, parallel, byPartition, format, path, cmdLine);
+            }
+            return _exportParallel(session, parallel, byPartition, format, path, cmdLine, nullptr);
+        }
+
+        auto stmt = session.prepareStatement(cmdLine);
+        bindReplVariables(session, stmt);
+        applyFetchSettings(stmt);
+        stmt.execute();
+        if (stmt.numColumns() == 0) {
+            throw std::runtime_error("only queries can be exported");
+        }
+
+        if (split.enabled()) {
+            return _exportSplit(stmt, format, path, split);
+        }
+
+        uint64_t numRows = 0;
+        if (format == "parquet") {
+            numRows = writeParquetResults(stmt, path, parquetRowGroupSetting.get());
+            clientCounters.add(ClientCounter::RowsRendered, numRows);
+        } else {
+            auto out = BufferedFdWriter::open(path, compressionForPath(path), fileWriteOptions());
+            numRows = writeResults(stmt, out,
+                    format == "csv" ? ResultFormat::Csv :
+                    format == "tsv" ? ResultFormat::Tsv : ResultFormat::Ndjson);
+        }
+        std::cout << "Exported " << numRows << " rows to " << path << std::endl;
+        closeIfFetchLimited(stmt);
+        return true;
+    }
+
+private:
+    // Rotates the query's rows through numbered files, each closed at the limits and
+    // synced while the next is written.
+    bool _exportSplit(OracleStatement& stmt, std::string_view format, const std::string& path,
+                      const SplitLimits& split) {
+        auto opts = exportOptions(format, path);
+        const auto start = std::chrono::steady_clock::now();
+        const auto shards = exportSplit(stmt, path, opts, split);
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint64_t numRows = 0;
+        for (const auto& shard : shards) {
+            numRows += shard.rows;
+        }
+        clientCounters.add(ClientCounter::RowsRendered, numRows);
+        std::cout << fmt::format("Exported {} rows to {} files in {:.2f}s, listed in {}", numRows, shards.size(),
+                                 elapsed, manifestPath(path)) << std::endl;
+        closeIfFetchLimited(stmt);
+        return true;
+    }
+
+    // Runs the query as parallel hash slices of splitBy at once, each into a file of its
+    // own, for joins and views that have no ROWID ranges to split them by.
+    bool _exportQuerySlices(Session& session, uint32_t parallel, std::string_view splitBy, std::string_view format,
+                            const std::string& path, std::string_view query) {
+        query = query.substr(0, query.find_last_not_of(" ;") + 1);
+        // Variables are bound on the session's connection, not the slices'.
+        if (!session.prepareStatement(query).bindNames().empty()) {
+            throw std::runtime_error("--split-by queries can't use bind variables");
+        }
+        auto opts = exportOptions(format, path);
+        opts.setUpStatement = [](OracleStatement& stmt) { applyFetchSettings(stmt); };
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto shards = exportQueryParallel([&session] { return session.newConnection(); }, query, splitBy,
+                                                parallel, path, opts);
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint64_t numRows = 0;
+        for (const auto& shard : shards) {
+            std::cout << fmt::format("  {}: {} rows in {:.2f}s", shard.path, shard.rows, shard.seconds) << std::endl;
+            numRows += shard.rows;
+        }
+        clientCounters.add(ClientCounter::RowsRendered, numRows);
+        std::cout << fmt::format("Exported {} rows to {} files in {:.2f}s", numRows, shards.size(), elapsed)
+                  << std::endl;
+        return true;
+    }
+
+    // Splits the table as _exportParallel() would, but queues the ranges or partitions
+    // under job for --export-worker processes to claim and export, on as many hosts as
+    // are run. It commits on a connection of its own, so the session's transaction is
+    // left alone.
+    bool _exportQueue(Session& session, const std::string& job, uint32_t parallel, bool byPartition,
+                      std::string_view format, const std::string& path, std::string_view table) {
+        table = table.substr(0, table.find_last_not_of(" ;") + 1);
+        auto conn = session.newConnection();
+        std::vector<RowidRange> ranges;
+        std::vector<TablePartition> partitions;
+        if (byPartition) {
+            partitions = tablePartitions(conn, table);
+            if (partitions.empty()) {
+                throw std::runtime_error(fmt::format("{} isn't partitioned; use --parallel", table));
+            }
+        } else {
+            ranges = rowidRanges(conn, table, parallel);
+        }
+        queueExport(conn, {job, std::string(table), std::string(format), path}, ranges, partitions);
+        const auto numChunks = std::max<size_t>(byPartition ? partitions.size() : ranges.size(), 1);
+        std::cout << fmt::format("Queued {} chunks of {} as export job {}; run sqlplusplus --export-worker {} "
+                                 "with this connect string on each host to export them", numChunks, table, job, job)
+                  << std::endl;
+        return true;
+    }
+
+    // Splits the table into ROWID ranges and scans them all at once, or byPartition into
+    // its partitions and scans those parallel at a time, each range or partition into a
+    // file of its own. Which files are done is checkpointed as they're finished, so an
+    // export that's cut off can be resumed with the rest, split just as it was.
+    bool _exportParallel(Session& session,
+                         uint32_t parallel,
+                         bool byPartition,
+                         std::string_view format,
+                         const std::string& path,
+                         std::string_view table,
+                         const ExportCheckpoint* resumed) {
+        table = table.substr(0, table.find_last_not_of(" ;") + 1);
+        std::vector<RowidRange> ranges;
+        std::vector<TablePartition> partitions;
+        ExportCheckpoint checkpoint;
+        if (resumed) {
+            checkpoint = *resumed;
+            for (const auto& shard : checkpoint.shards) {
+                if (byPartition) {
+                    partitions.push_back({shard.first, shard.size});
+                } else {
+                    ranges.push_back({shard.first, shard.last});
+                }
+            }
+        } else {
+            if (byPartition) {
+                partitions = tablePartitions(session.connection(), table);
+                if (partitions.empty()) {
+                    throw std::runtime_error(fmt::format("{} isn't partitioned; use --parallel", table));
+                }
+            } else {
+                ranges = rowidRanges(session.connection(), table, parallel);
+            }
+            checkpoint.table = std::string(table);
+            checkpoint.format = std::string(format);
+            checkpoint.parallel = parallel;
+            checkpoint.byPartition = byPartition;
+            for (const auto& partition : partitions) {
+                checkpoint.shards.push_back({partition.name, {}, partition.blocks});
+            }
+            for (const auto& range : ranges) {
+                checkpoint.shards.push_back({range.first, range.last});
+            }
+        }
+        const auto checkpointFile = checkpointPath(path);
+        writeCheckpoint(checkpointFile, checkpoint);
+
+        auto opts = exportOptions(format, path);
+        opts.setUpStatement = [](OracleStatement& stmt) { applyFetchSettings(stmt); };
+        std::mutex checkpointMutex;
+        for (const auto& shard : checkpoint.shards) {
+            opts.skip.push_back(shard.done);
+        }
+        opts.onShardDone = [&](size_t idx, const ExportShard& shard) {
+            std::lock_guard<std::mutex> lk(checkpointMutex);
+            // A table without a segment is exported as one shard that no range covers.
+            if (idx < checkpoint.shards.size()) {
+                checkpoint.shards[idx].done = true;
+                checkpoint.shards[idx].rows = shard.rows;
+                writeCheckpoint(checkpointFile, checkpoint);
+            }
+        };
+
+        const auto start = std::chrono::steady_clock::now();
+        auto newConnection = [&session] { return session.newConnection(); };
+        const auto shards = byPartition
+            ? exportPartitionsParallel(newConnection, table, partitions, parallel, path, opts)
+            : exportTableParallel(newConnection, table, ranges, path, opts);
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        removeCheckpoint(checkpointFile);
+
+        uint64_t numRows = 0;
+        for (size_t idx = 0; idx < shards.size(); ++idx) {
+            const auto& shard = shards[idx];
+            if (shard.skipped) {
+                const auto rows = checkpoint.shards[idx].rows;
+                std::cout << fmt::format("  {}: {} rows, written before", shard.path, rows) << std::endl;
+                numRows += rows;
+                continue;
+            }
+            std::cout << fmt::format("  {}: {} rows in {:.2f}s", shard.path, shard.rows, shard.seconds) << std::endl;
+            clientCounters.add(ClientCounter::RowsRendered, shard.rows);
+            numRows += shard.rows;
+        }
+        std::cout << fmt::format("Exported {} rows to {} files in {:.2f}s", numRows, shards.size(), elapsed)
+                  << std::endl;
+        return true;
+    }
+} exportCmd;
+
+class OffloadCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".offload");
+    OffloadCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .offload sqlite <file> [as <table>] <query> writes the query's rows into a table of
+    // a local SQLite database, RESULT unless it's named, for working on offline.
+    bool run(Session& session, std::string_view cmdLine) override {
+        constexpr auto kUsage = "usage: .offload sqlite <file> [as <table>] <query>";
+        auto nextToken = [&] {
+            cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+            const auto end = std::min(cmdLine.find(' '), cmdLine.size());
+            const auto token = cmdLine.substr(0, end);
+            cmdLine.remove_prefix(end);
+            return token;
+        };
+        const auto format = nextToken();
+        const auto path = std::string(nextToken());
+        std::string_view table = "RESULT";
+        auto rest = cmdLine;
+        auto keyword = std::string(nextToken());
+        std::transform(keyword.begin(), keyword.end(), keyword.begin(), [](const auto ch) {
+            return static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+        });
+        if (keyword == "as") {
+            table = nextToken();
+        } else {
+            cmdLine = rest;
+        }
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        if (format != "sqlite" || path.empty() || table.empty() || cmdLine.empty()) {
+            throw std::runtime_error(kUsage);
+        }
+
+        auto stmt = session.prepareStatement(cmdLine);
+        bindReplVariables(session, stmt);
+        applyFetchSettings(stmt);
+        stmt.execute();
+        if (stmt.numColumns() == 0) {
+            throw std::runtime_error("only queries can be offloaded");
+        }
+        const auto numRows = offloadToSqlite(stmt, path, table);
+        clientCounters.add(ClientCounter::RowsRendered, numRows);
+        std::cout << "Offloaded " << numRows << " rows to " << table << " in " << path << std::endl;
+        closeIfFetchLimited(stmt);
+        return true;
+    }
+} offloadCmd;
+
+class LoadCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".load");
+    LoadCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session& session, std::string_view cmdLine) override {
+        std::string lowered;
+        std::transform(cmdLine.begin(), cmdLine.end(), std::back_inserter(lowered), [](const auto ch) {
+            return static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+        });
+        CsvLoadOptions opts;
+        opts.batchSize = loadBatchSizeSetting.get();
+        opts.commitInterval = loadCommitRowsSetting.get();
+        opts.parallelism = loadParallelSetting.get();
+        opts.nativeBinds = loadNativeSetting.get() != 0;
+        opts.adaptiveBatchSize = loadAdaptiveSetting.get() != 0;
+        opts.maxBatchSize = loadMaxBatchSizeSetting.get();
+
+        // --direct and --nologging come first, in either order.
+        constexpr auto kDirectFlag = std::string_view("--direct ");
+        constexpr auto kNologgingFlag = std::string_view("--nologging ");
+        bool nologging = false;
+        for (;;) {
+            if (lowered.rfind(kDirectFlag, 0) == 0) {
+                opts.directPath = true;
+                lowered.erase(0, kDirectFlag.size());
+                cmdLine.remove_prefix(kDirectFlag.size());
+            } else if (lowered.rfind(kNologgingFlag, 0) == 0) {
+                nologging = true;
+                lowered.erase(0, kNologgingFlag.size());
+                cmdLine.remove_prefix(kNologgingFlag.size());
+            } else {
+                break;
+            }
+        }
+        if (nologging && !opts.directPath) {
+            throw std::runtime_error("--nologging only saves redo for --direct loads");
+        }
+        if (opts.directPath) {
+            opts.batchSize = loadDirectBatchSizeSetting.get();
+        }
+
+        constexpr auto kResumeFlag = std::string_view("--resume ");
+        if (lowered.rfind(kResumeFlag, 0) == 0) {
+            auto path = std::string(cmdLine.substr(kResumeFlag.size()));
+            path = path.substr(std::min(path.find_first_not_of(' '), path.size()));
+            path = path.substr(0, path.find_last_not_of(' ') + 1);
+            opts.checkpointPath = checkpointPath(path);
+            const auto checkpoint = readLoadCheckpoint(opts.checkpointPath);
+            if (!checkpoint) {
+                throw std::runtime_error(fmt::format("there's no checkpoint at {} to resume from", opts.checkpointPath));
+            }
+            opts.resume = true;
+            return _withLogging(session, nologging, checkpoint->table, [&] {
+                return _load(session, path, checkpoint->table, opts);
+            });
+        }
+
+        constexpr auto kPartitionsFlag = std::string_view("--partitions ");
+        const bool byPartition = lowered.rfind(kPartitionsFlag, 0) == 0;
+        auto intoPos = lowered.rfind(" into ");
+        if (intoPos == std::string::npos || (byPartition && intoPos < kPartitionsFlag.size())) {
+            throw std::runtime_error("usage: .load [--direct [--nologging]] [--partitions] <file.csv|file.parquet> INTO <table>"
+                                     " | .load [--direct [--nologging]] --resume <file.csv>");
+        }
+        const auto pathStart = byPartition ? kPartitionsFlag.size() : 0;
+        auto path = std::string(cmdLine.substr(pathStart, intoPos - pathStart));
+        auto tableName = cmdLine.substr(intoPos + 6);
+        tableName.remove_prefix(std::min(tableName.find_first_not_of(' '), tableName.size()));
+        tableName = tableName.substr(0, tableName.find_last_not_of(' ') + 1);
+
+        if (isParquetPath(path) && byPartition) {
+            throw std::runtime_error("--partitions loads CSV files; load each parquet file into its partition instead");
+        }
+        if (byPartition) {
+            return _withLogging(session, nologging, tableName, [&] {
+                return _loadPartitions(session, path, tableName, opts);
+            });
+        }
+        opts.checkpointPath = checkpointPath(path);
+        return _withLogging(session, nologging, tableName, [&] {
+            return _load(session, path, tableName, opts);
+        });
+    }
+
+private:
+    // Runs load with the table switched to NOLOGGING, if nologging asks for it, and back
+    // after, whether the load succeeds or not.
+    template <typename Fn>
+    bool _withLogging(Session& session, bool nologging, std::string_view tableName, const Fn& load) {
+        if (!nologging) {
+            return load();
+        }
+        NologgingScope scope(session.connection(), tableName);
+        if (scope.changed()) {
+            std::cout << fmt::format("{} is NOLOGGING for the load; back it up after, since the rows "
+                    "loaded can't be recovered from redo", tableName) << std::endl;
+        }
+        const auto ret = load();
+        scope.restore();
+        return ret;
+    }
+
+    bool _load(Session& session, const std::string& path, std::string_view tableName, const CsvLoadOptions& opts) {
+        const auto start = std::chrono::steady_clock::now();
+        // Parquet loads run on the session alone, without a checkpoint.
+        auto result = isParquetPath(path)
+            ? loadParquet(session.connection(), path, tableName, opts)
+            : loadCsv(session.connection(), [&session] { return session.newConnection(); }, path, tableName, opts);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        for (const auto& error : result.errors) {
+            std::cout << "line " << error.line << ": " << error.message << std::endl;
+        }
+        if (result.rowsRejected > result.errors.size()) {
+            std::cout << "... and " << (result.rowsRejected - result.errors.size())
+                      << " more rejected rows" << std::endl;
+        }
+        if (result.workers.size() > 1) {
+            for (size_t idx = 0; idx < result.workers.size(); ++idx) {
+                const auto& worker = result.workers[idx];
+                const auto seconds = std::max(worker.seconds, 1e-9);
+                std::cout << fmt::format("worker {}: {} rows in {:.2f}s ({:.0f} rows/s, {:.1f} MB/s)",
+                        idx + 1, worker.rowsLoaded, worker.seconds, worker.rowsLoaded / seconds,
+                        worker.bytes / seconds / (1024 * 1024)) << std::endl;
+            }
+        }
+        if (result.rowsResumed > 0) {
+            std::cout << result.rowsResumed << " rows were loaded before the load was interrupted" << std::endl;
+        }
+        std::cout << fmt::format("Loaded {} of {} rows in {:.2f}s",
+                result.rowsLoaded, result.rowsRead, elapsed.count()) << std::endl;
+        return true;
+    }
+
+    // Loads the files a .export --partitions of the table wrote, each into its partition,
+    // loadparallel partitions at a time. Partitions without a file are left alone.
+    bool _loadPartitions(Session& session, const std::string& path, std::string_view tableName,
+                         const CsvLoadOptions& opts) {
+        std::vector<CsvPartitionFile> files;
+        size_t numMissing = 0;
+        for (const auto& partition : tablePartitions(session.connection(), tableName)) {
+            auto partitionPath = shardPath(path, std::string_view(partition.name));
+            if (std::filesystem::exists(partitionPath)) {
+                files.push_back({partition.name, std::move(partitionPath)});
+            } else {
+                ++numMissing;
+            }
+        }
+        if (files.empty()) {
+            throw std::runtime_error(fmt::format("no partition files of {} for {}", path, tableName));
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto results = loadCsvPartitions([&session] { return session.newConnection(); },
+                tableName, files, opts);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        uint64_t rowsRead = 0;
+        uint64_t rowsLoaded = 0;
+        for (size_t idx = 0; idx < files.size(); ++idx) {
+            const auto& result = results[idx];
+            for (const auto& error : result.errors) {
+                std::cout << files[idx].path << " line " << error.line << ": " << error.message << std::endl;
+            }
+            if (result.rowsRejected > result.errors.size()) {
+                std::cout << "... and " << (result.rowsRejected - result.errors.size())
+                          << " more rejected rows" << std::endl;
+            }
+            const auto seconds = result.workers.empty() ? 0.0 : result.workers.front().seconds;
+            std::cout << fmt::format("  {}: {} of {} rows in {:.2f}s", files[idx].partition,
+                    result.rowsLoaded, result.rowsRead, seconds) << std::endl;
+            rowsRead += result.rowsRead;
+            rowsLoaded += result.rowsLoaded;
+        }
+        if (numMissing > 0) {
+            std::cout << numMissing << " partitions had no file" << std::endl;
+        }
+        std::cout << fmt::format("Loaded {} of {} rows into {} partitions in {:.2f}s",
+                rowsLoaded, rowsRead, files.size(), elapsed.count()) << std::endl;
+        return true;
+    }
+} loadCmd;
+
+// The names in a parenthesized, comma-separated list like "(a, b)".
+std::vector<std::string> parseColumnList(std::string_view list) {
+    std::vector<std::string> names;
+    list = list.substr(1, list.size() - 2);
+    while (!list.empty()) {
+        const auto comma = std::min(list.find(','), list.size());
+        auto name = list.substr(0, comma);
+        name.remove_prefix(std::min(name.find_first_not_of(' '), name.size()));
+        name = name.substr(0, name.find_last_not_of(' ') + 1);
+        names.emplace_back(name);
+        list.remove_prefix(std::min(comma + 1, list.size()));
+    }
+    return names;
+}
+
+class UpsertCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".upsert");
+    UpsertCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session& session, std::string_view cmdLine) override {
+        std::string lowered;
+        std::transform(cmdLine.begin(), cmdLine.end(), std::back_inserter(lowered), [](const auto ch) {
+            return static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+        });
+        const auto keyPos = lowered.rfind(" key ");
+        const auto intoPos = keyPos == std::string::npos ? keyPos : lowered.rfind(" into ", keyPos);
+        auto keyList = keyPos == std::string::npos ? std::string_view() : cmdLine.substr(keyPos + 5);
+        keyList = keyList.substr(0, keyList.find_last_not_of(" ;") + 1);
+        keyList.remove_prefix(std::min(keyList.find_first_not_of(' '), keyList.size()));
+        if (intoPos == std::string::npos || keyList.size() < 2 || keyList.front() != '(' || keyList.back() != ')') {
+            throw std::runtime_error("usage: .upsert <file.csv> INTO <table> KEY (<column>, ...)");
+        }
+        const auto path = std::string(cmdLine.substr(0, intoPos));
+        auto tableName = cmdLine.substr(intoPos + 6, keyPos - intoPos - 6);
+        tableName.remove_prefix(std::min(tableName.find_first_not_of(' '), tableName.size()));
+        tableName = tableName.substr(0, tableName.find_last_not_of(' ') + 1);
+
+        const auto keys = parseColumnList(keyList);
+
+        CsvLoadOptions opts;
+        opts.batchSize = loadBatchSizeSetting.get();
+        opts.commitInterval = loadCommitRowsSetting.get();
+        opts.nativeBinds = loadNativeSetting.get() != 0;
+        opts.adaptiveBatchSize = loadAdaptiveSetting.get() != 0;
+        opts.maxBatchSize = loadMaxBatchSizeSetting.get();
+        const auto start = std::chrono::steady_clock::now();
+        const auto result = upsertCsv(session.connection(), path, tableName, keys, opts);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        for (const auto& error : result.errors) {
+            std::cout << "line " << error.line << ": " << error.message << std::endl;
+        }
+        if (result.rowsRejected > result.errors.size()) {
+            std::cout << "... and " << (result.rowsRejected - result.errors.size())
+                      << " more rejected rows" << std::endl;
+        }
+        std::cout << fmt::format("Merged {} of {} rows into {} rows in {:.2f}s",
+                result.rowsLoaded, result.rowsRead, result.rowsMerged, elapsed.count()) << std::endl;
+        return true;
+    }
+} upsertCmd;
+
+// What .bulkdelete and .bulkupdate take after their table: "... KEY (<column>, ...) FROM
+// <file>", split into what's before KEY, the key columns and the file. Empty keys when
+// the line isn't shaped like that.
+struct KeyFileArgs {
+    std::string_view head;
+    std::vector<std::string> keys;
+    std::string path;
+};
+
+KeyFileArgs parseKeyFileArgs(std::string_view cmdLine) {
+    std::string lowered;
+    std::transform(cmdLine.begin(), cmdLine.end(), std::back_inserter(lowered), [](const auto ch) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+    });
+    KeyFileArgs args;
+    const auto fromPos = lowered.rfind(" from ");
+    const auto keyPos = fromPos == std::string::npos ? fromPos : lowered.rfind(" key", fromPos);
+    if (keyPos == std::string::npos) {
+        return args;
+    }
+    auto keyList = cmdLine.substr(keyPos + 4, fromPos - keyPos - 4);
+    keyList.remove_prefix(std::min(keyList.find_first_not_of(' '), keyList.size()));
+    keyList = keyList.substr(0, keyList.find_last_not_of(' ') + 1);
+    auto path = cmdLine.substr(fromPos + 6);
+    path.remove_prefix(std::min(path.find_first_not_of(' '), path.size()));
+    path = path.substr(0, path.find_last_not_of(" ;") + 1);
+    if (keyList.size() < 2 || keyList.front() != '(' || keyList.back() != ')' || path.empty()) {
+        return args;
+    }
+    args.head = cmdLine.substr(0, keyPos);
+    args.head.remove_prefix(std::min(args.head.find_first_not_of(' '), args.head.size()));
+    args.keys = parseColumnList(keyList);
+    args.path = std::string(path);
+    return args;
+}
+
+KeyDmlOptions keyDmlOptions() {
+    KeyDmlOptions opts;
+    opts.batchSize = loadBatchSizeSetting.get();
+    opts.commitInterval = loadCommitRowsSetting.get();
+    return opts;
+}
+
+void printKeyDmlResult(const KeyDmlResult& result, std::string_view verb, double seconds) {
+    for (const auto& error : result.errors) {
+        std::cout << "line " << error.line << ": " << error.message << std::endl;
+    }
+    if (result.keysRejected > result.errors.size()) {
+        std::cout << "... and " << (result.keysRejected - result.errors.size()) << " more rejected keys" << std::endl;
+    }
+    std::cout << fmt::format("{} {} rows for {} keys ({} matched nothing) in {:.2f}s",
+            verb, result.rowsAffected, result.keysRead, result.keysUnmatched, seconds) << std::endl;
+}
+
+class BulkDeleteCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".bulkdelete");
+    BulkDeleteCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .bulkdelete <table> KEY (<column>, ...) FROM <file> deletes the rows matching each
+    // line of a key file, loadbatchsize keys a round trip, committing every
+    // loadcommitrows keys.
+    bool run(Session& session, std::string_view cmdLine) override {
+        const auto args = parseKeyFileArgs(cmdLine);
+        if (args.keys.empty() || args.head.empty() || args.head.find(' ') != std::string_view::npos) {
+            throw std::runtime_error("usage: .bulkdelete <table> KEY (<column>, ...) FROM <file>");
+        }
+        const auto start = std::chrono::steady_clock::now();
+        const auto result = deleteByKeys(session.connection(), args.path, args.head, args.keys, keyDmlOptions());
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        printKeyDmlResult(result, "Deleted", elapsed.count());
+        return true;
+    }
+} bulkDeleteCmd;
+
+class BulkUpdateCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".bulkupdate");
+    BulkUpdateCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .bulkupdate <table> SET <assignments> KEY (<column>, ...) FROM <file> runs the
+    // update for the rows matching each line of a key file, as .bulkdelete does.
+    bool run(Session& session, std::string_view cmdLine) override {
+        constexpr auto kUsage = "usage: .bulkupdate <table> SET <column> = <expr>, ... KEY (<column>, ...) FROM <file>";
+        const auto args = parseKeyFileArgs(cmdLine);
+        const auto tableEnd = std::min(args.head.find(' '), args.head.size());
+        const auto table = args.head.substr(0, tableEnd);
+        auto setClause = args.head.substr(tableEnd);
+        setClause.remove_prefix(std::min(setClause.find_first_not_of(' '), setClause.size()));
+        std::string setWord(setClause.substr(0, 4));
+        std::transform(setWord.begin(), setWord.end(), setWord.begin(), [](const auto ch) {
+            return static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+        });
+        if (args.keys.empty() || table.empty() || setWord != "SET ") {
+            throw std::runtime_error(kUsage);
+        }
+        setClause.remove_prefix(4);
+        setClause.remove_prefix(std::min(setClause.find_first_not_of(' '), setClause.size()));
+        if (setClause.empty()) {
+            throw std::runtime_error(kUsage);
+        }
+        const auto start = std::chrono::steady_clock::now();
+        const auto result = updateByKeys(session.connection(), args.path, table, setClause, args.keys, keyDmlOptions());
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        printKeyDmlResult(result, "Updated", elapsed.count());
+        return true;
+    }
+} bulkUpdateCmd;
+
+class GenerateCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".generate");
+    GenerateCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .generate <table> rows <n> [--parallel <n>] [--nulls <percent>] [--skew <s>]
+    // [--seed <n>] inserts n rows of values made up to fit the table's columns,
+    // loadbatchsize rows a round trip, committing every loadcommitrows rows.
+    bool run(Session& session, std::string_view cmdLine) override {
+        constexpr auto kUsage =
+            "usage: .generate <table> rows <n> [--parallel <n>] [--nulls <percent>] [--skew <s>] [--seed <n>]";
+        cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(" ;") + 1);
+        auto nextToken = [&] {
+            cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+            auto end = std::min(cmdLine.find(' '), cmdLine.size());
+            auto token = cmdLine.substr(0, end);
+            cmdLine.remove_prefix(end);
+            return token;
+        };
+        auto parseNumber = [&](auto& value) {
+            const auto token = nextToken();
+            const auto parsed = std::from_chars(token.data(), token.data() + token.size(), value);
+            if (parsed.ec != std::errc() || parsed.ptr != token.data() + token.size()) {
+                throw std::runtime_error(kUsage);
+            }
+        };
+        const auto table = nextToken();
+        auto rowsWord = std::string(nextToken());
+        std::transform(rowsWord.begin(), rowsWord.end(), rowsWord.begin(), [](const auto ch) {
+            return static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+        });
+        if (table.empty() || rowsWord != "rows") {
+            throw std::runtime_error(kUsage);
+        }
+        GenerateOptions opts;
+        parseNumber(opts.rows);
+        for (auto flag = nextToken(); !flag.empty(); flag = nextToken()) {
+            if (flag == "--parallel") {
+                parseNumber(opts.parallelism);
+            } else if (flag == "--nulls") {
+                parseNumber(opts.nullPercent);
+            } else if (flag == "--skew") {
+                parseNumber(opts.skew);
+            } else if (flag == "--seed") {
+                parseNumber(opts.seed);
+            } else {
+                throw std::runtime_error(kUsage);
+            }
+        }
+        if (opts.parallelism == 0 || opts.nullPercent > 100 || !(opts.skew > 0)) {
+            throw std::runtime_error(kUsage);
+        }
+        opts.batchSize = loadBatchSizeSetting.get();
+        opts.commitInterval = loadCommitRowsSetting.get();
+
+        const auto result = generateRows(session.connection(), [&session] { return session.newConnection(); },
+                table, opts);
+        if (result.rowsRejected > 0) {
+            std::cout << result.rowsRejected << " rows rejected, the first with: " << result.firstError << std::endl;
+        }
+        std::cout << fmt::format("Generated {} rows in {:.2f}s ({:.0f} rows/s)", result.rowsInserted, result.seconds,
+                result.seconds > 0 ? result.rowsInserted / result.seconds : 0.0) << std::endl;
+        return true;
+    }
+} generateCmd;
+
+class CompareCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".compare");
+    CompareCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .compare [--chunks N] <connA> <sqlA> | <connB> <sqlB> KEY (<column>, ...) compares the
+    // rows of two queries by key, each on the database its connect string names, or this
+    // one for ".", and lists the keys that differ.
+    bool run(Session& session, std::string_view cmdLine) override {
+        constexpr auto kUsage = ".compare [--chunks N] <connA> <sqlA> | <connB> <sqlB> KEY (<column>, ...)";
+        std::string lowered;
+        std::transform(cmdLine.begin(), cmdLine.end(), std::back_inserter(lowered), [](const auto ch) {
+            return static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+        });
+        CompareOptions opts;
+        constexpr auto kChunksFlag = std::string_view("--chunks ");
+        if (lowered.rfind(kChunksFlag, 0) == 0) {
+            auto rest = cmdLine.substr(kChunksFlag.size());
+            rest.remove_prefix(std::min(rest.find_first_not_of(' '), rest.size()));
+            const auto end = std::min(rest.find(' '), rest.size());
+            const auto parsed = std::from_chars(rest.data(), rest.data() + end, opts.chunks);
+            if (parsed.ec != std::errc() || parsed.ptr != rest.data() + end || opts.chunks == 0) {
+                throw std::runtime_error(fmt::format("usage: {}", kUsage));
+            }
+            const auto skipped = static_cast<size_t>(rest.data() + end - cmdLine.data());
+            cmdLine.remove_prefix(skipped);
+            lowered.erase(0, skipped);
+        }
+
+        const auto keyPos = lowered.rfind(" key ");
+        const auto splitPos = keyPos == std::string::npos ? keyPos : lowered.rfind(" | ", keyPos);
+        auto keyList = keyPos == std::string::npos ? std::string_view() : cmdLine.substr(keyPos + 5);
+        keyList = keyList.substr(0, keyList.find_last_not_of(" ;") + 1);
+        keyList.remove_prefix(std::min(keyList.find_first_not_of(' '), keyList.size()));
+        if (splitPos == std::string::npos || keyList.size() < 2 || keyList.front() != '(' || keyList.back() != ')') {
+            throw std::runtime_error(fmt::format("usage: {}", kUsage));
+        }
+        opts.keyColumns = parseColumnList(keyList);
+
+        // A connect string, then the query to the end of its half.
+        auto splitSide = [&](std::string_view side) {
+            side.remove_prefix(std::min(side.find_first_not_of(' '), side.size()));
+            const auto connEnd = std::min(side.find(' '), side.size());
+            auto sql = side.substr(connEnd);
+            sql.remove_prefix(std::min(sql.find_first_not_of(' '), sql.size()));
+            sql = sql.substr(0, sql.find_last_not_of(" ;") + 1);
+            if (connEnd == 0 || sql.empty()) {
+                throw std::runtime_error(fmt::format("usage: {}", kUsage));
+            }
+            return std::make_pair(std::string(side.substr(0, connEnd)), std::string(sql));
+        };
+        const auto [connA, sqlA] = splitSide(cmdLine.substr(0, splitPos));
+        const auto [connB, sqlB] = splitSide(cmdLine.substr(splitPos + 3, keyPos - splitPos - 3));
+        auto connector = [&session](const std::string& connString) {
+            return [&session, connString] {
+                return connString == "." ? session.newConnection() : session.newConnectionTo(connString);
+            };
+        };
+        opts.setUpStatement = [](OracleStatement& stmt) { applyFetchSettings(stmt); };
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto result = compareQueries(connector(connA), sqlA, connector(connB), sqlB, opts);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        for (const auto& mismatch : result.mismatches) {
+            const auto kind = mismatch.kind == CompareDiff::OnlyInA ? "only in A"
+                : mismatch.kind == CompareDiff::OnlyInB ? "only in B" : "different";
+            std::cout << fmt::format("{}: {}", kind, mismatch.key) << std::endl;
+        }
+        const auto numMismatches = result.onlyInA + result.onlyInB + result.different;
+        if (numMismatches > result.mismatches.size()) {
+            std::cout << "... and " << (numMismatches - result.mismatches.size()) << " more" << std::endl;
+        }
+        if (result.duplicateKeys > 0) {
+            std::cout << result.duplicateKeys << " rows repeated a key and weren't compared" << std::endl;
+        }
+        if (opts.chunks > 0) {
+            std::cout << fmt::format("{} of {} chunks differed and were compared row by row",
+                    result.chunksCompared, opts.chunks) << std::endl;
+        }
+        std::cout << fmt::format("Compared {} rows with {} in {:.2f}s: {} matched, {} only in A, {} only in B, {} different",
+                result.rowsA, result.rowsB, elapsed.count(), result.matched, result.onlyInA, result.onlyInB,
+                result.different) << std::endl;
+        return true;
+    }
+} compareCmd;
+
+class CopyCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".copy");
+    CopyCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .copy FROM <connA> TO <connB> <table> [WHERE <condition>] copies a table's rows from
+    // the database one connect string names to the same table on another's, or this one
+    // for ".", without going through text. Rows go loadbatchsize a round trip, committing
+    // every loadcommitrows of them.
+    bool run(Session& session, std::string_view cmdLine) override {
+        constexpr auto kUsage = "usage: .copy FROM <connA> TO <connB> <table> [WHERE <condition>]";
+        auto nextWord = [&] {
+            cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+            auto word = cmdLine.substr(0, cmdLine.find(' '));
+            cmdLine.remove_prefix(word.size());
+            return std::string(word);
+        };
+        auto isKeyword = [](std::string word, std::string_view keyword) {
+            std::transform(word.begin(), word.end(), word.begin(), [](const auto ch) {
+                return static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+            });
+            return word == keyword;
+        };
+        const bool fromOk = isKeyword(nextWord(), "FROM");
+        const auto connA = nextWord();
+        const bool toOk = isKeyword(nextWord(), "TO");
+        const auto connB = nextWord();
+        const auto table = nextWord();
+        const auto whereWord = nextWord();
+        auto where = cmdLine;
+        where.remove_prefix(std::min(where.find_first_not_of(' '), where.size()));
+        where = where.substr(0, where.find_last_not_of(" ;") + 1);
+        if (!fromOk || !toOk || connA.empty() || connB.empty() || table.empty() ||
+                (!whereWord.empty() && (!isKeyword(whereWord, "WHERE") || where.empty()))) {
+            throw std::runtime_error(kUsage);
+        }
+
+        auto connect = [&session](const std::string& connString) {
+            return connString == "." ? session.newConnection() : session.newConnectionTo(connString);
+        };
+        auto source = connect(connA);
+        auto target = connect(connB);
+        TableCopyOptions opts;
+        opts.batchRows = loadBatchSizeSetting.get();
+        opts.commitRows = loadCommitRowsSetting.get();
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto result = copyTable(source, target, table, where, opts);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << fmt::format("Copied {} rows in {} batches in {:.2f}s", result.rows, result.batches,
+                elapsed.count()) << std::endl;
+        return true;
+    }
+} copyCmd;
+
+class ChecksumCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".checksum");
+    ChecksumCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .checksum <table> [--parallel N] fingerprints the table's rows on the server, N
+    // connections at a time, for comparing with the same table on another database.
+    bool run(Session& session, std::string_view cmdLine) override {
+        constexpr auto kUsage = "usage: .checksum <table> [--parallel N]";
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(" ;") + 1);
+        const auto tableEnd = std::min(cmdLine.find(' '), cmdLine.size());
+        const auto table = cmdLine.substr(0, tableEnd);
+        auto rest = cmdLine.substr(tableEnd);
+        rest.remove_prefix(std::min(rest.find_first_not_of(' '), rest.size()));
+        uint32_t parallel = 1;
+        constexpr auto kParallelFlag = std::string_view("--parallel ");
+        if (!rest.empty()) {
+            if (rest.rfind(kParallelFlag, 0) != 0) {
+                throw std::runtime_error(kUsage);
+            }
+            rest.remove_prefix(kParallelFlag.size());
+            rest.remove_prefix(std::min(rest.find_first_not_of(' '), rest.size()));
+            const auto parsed = std::from_chars(rest.data(), rest.data() + rest.size(), parallel);
+            if (parsed.ec != std::errc() || parsed.ptr != rest.data() + rest.size() || parallel == 0) {
+                throw std::runtime_error(kUsage);
+            }
+        }
+        if (table.empty()) {
+            throw std::runtime_error(kUsage);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto checksum = checksumTable(session.connection(), [&session] { return session.newConnection(); },
+                table, parallel);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        for (const auto& column : checksum.skippedColumns) {
+            std::cout << column << " can't be hashed and was left out" << std::endl;
+        }
+        std::cout << fmt::format("{} rows, fingerprint {:016x}, from {} chunks in {:.2f}s",
+                checksum.rows, checksum.fingerprint, checksum.chunks, elapsed.count()) << std::endl;
+        return true;
+    }
+} checksumCmd;
+
+class SummaryCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".summary");
+    SummaryCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .summary <sql> runs the query and profiles its columns in one pass over the rows,
+    // without holding on to them: nulls, smallest and largest values, mean, roughly how
+    // many distinct values and the most frequent ones.
+    bool run(Session& session, std::string_view cmdLine) override {
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(" ;") + 1);
+        if (cmdLine.empty()) {
+            throw std::runtime_error("usage: .summary <sql>");
+        }
+        auto stmt = session.prepareStatement(cmdLine);
+        bindReplVariables(session, stmt);
+        applyFetchSettings(stmt);
+        stmt.execute();
+        if (stmt.numColumns() == 0) {
+            throw std::runtime_error("only queries can be summarized");
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto summary = summarizeResults(stmt, summaryTopSetting.get());
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        Table table(9);
+        applyTableLayout(table);
+        table.addRow();
+        table.setColumnValue(0, 0, "Column");
+        table.setColumnValue(0, 1, "Type");
+        table.setColumnValue(0, 2, "Nulls");
+        table.setColumnValue(0, 3, "Distinct~");
+        table.setColumnValue(0, 4, "Min");
+        table.setColumnValue(0, 5, "Max");
+        table.setColumnValue(0, 6, "Mean");
+        table.setColumnValue(0, 7, "Top");
+        table.setColumnValue(0, 8, "Top counts");
+        for (const auto& column : summary.columns) {
+            const auto row = table.addRow();
+            table.setColumnValue(row, 0, column.name);
+            table.setColumnValue(row, 1, column.type);
+            table.setColumnValue(row, 2, fmt::format("{}", column.nulls));
+            table.setColumnValue(row, 3, fmt::format("{:.0f}", column.distinct));
+            table.setColumnValue(row, 4, column.min ? *column.min : std::string(ColumnFormatter::kNullText));
+            table.setColumnValue(row, 5, column.max ? *column.max : std::string(ColumnFormatter::kNullText));
+            table.setColumnValue(row, 6, column.mean ? fmt::format("{:.6g}", *column.mean) : std::string());
+            fmt::memory_buffer values;
+            fmt::memory_buffer counts;
+            for (const auto& item : column.top) {
+                const auto sep = values.size() == 0 ? "" : ", ";
+                fmt::format_to(values, "{}{}", sep, item.value);
+                // A count that may be overstated shows how far.
+                if (item.error == 0) {
+                    fmt::format_to(counts, "{}{}", sep, item.count);
+                } else {
+                    fmt::format_to(counts, "{}{}±{}", sep, item.count, item.error);
+                }
+            }
+            table.setColumnValue(row, 7, fmt::to_string(values));
+            table.setColumnValue(row, 8, fmt::to_string(counts));
+        }
+        table.render(std::cout);
+        std::cout << fmt::format("{} rows summarized in {:.2f}s", summary.rows, elapsed.count()) << std::endl;
+        return true;
+    }
+} summaryCmd;
+
+class DumpCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".dump");
+    DumpCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session& session, std::string_view cmdLine) override {
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        const auto split = std::min(cmdLine.find(' '), cmdLine.size());
+        const auto table = cmdLine.substr(0, split);
+        auto path = std::string(cmdLine.substr(split));
+        path = path.substr(std::min(path.find_first_not_of(' '), path.size()));
+        path = path.substr(0, path.find_last_not_of(' ') + 1);
+        if (table.empty() || path.empty()) {
+            throw std::runtime_error("usage: .dump <table> <file>");
+        }
+
+        // Straight from the connection rather than the statement cache, since the dump
+        // redefines how some columns are fetched and the define would outlast it.
+        auto stmt = session.connection().prepareStatement(
+                fmt::format("SELECT * FROM {}", normalizeIdentifier(table, true)));
+        applyFetchSettings(stmt);
+        const auto start = std::chrono::steady_clock::now();
+        stmt.execute();
+        auto out = BufferedFdWriter::open(path, {}, fileWriteOptions());
+        const auto numRows = writeDumpResults(stmt, out);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << fmt::format("Dumped {} rows to {} in {:.2f}s", numRows, path, elapsed.count()) << std::endl;
+        return true;
+    }
+} dumpCmd;
+
+class RestoreCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".restore");
+    RestoreCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session& session, std::string_view cmdLine) override {
+        cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(' ') + 1);
+        const auto split = cmdLine.rfind(' ');
+        if (split == std::string_view::npos) {
+            throw std::runtime_error("usage: .restore <file> <table>");
+        }
+        auto path = std::string(cmdLine.substr(0, split));
+        path = path.substr(std::min(path.find_first_not_of(' '), path.size()));
+        const auto table = cmdLine.substr(split + 1);
+        if (path.empty()) {
+            throw std::runtime_error("usage: .restore <file> <table>");
+        }
+
+        DumpRestoreOptions opts;
+        opts.commitInterval = loadCommitRowsSetting.get();
+        const auto start = std::chrono::steady_clock::now();
+        const auto result = restoreDump(session.connection(), path, table, opts);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        for (const auto& error : result.errors) {
+            std::cout << "row " << error.row << ": " << error.message << std::endl;
+        }
+        if (result.rowsRejected > result.errors.size()) {
+            std::cout << "... and " << (result.rowsRejected - result.errors.size())
+                      << " more rejected rows" << std::endl;
+        }
+        std::cout << fmt::format("Restored {} of {} rows into {} columns in {:.2f}s",
+                result.rowsLoaded, result.rowsRead, result.columns.size(), elapsed.count()) << std::endl;
+        return true;
+    }
+} restoreCmd;
+
+class DdlCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".ddl");
+    constexpr static auto kUsage = std::string_view("usage: .ddl [--parallel <n>] <schema> <file | directory/>");
+    // Sessions generating DDL at once when --parallel isn't given.
+    constexpr static uint32_t kDefaultParallel = 4;
+    DdlCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .ddl [--parallel <n>] <schema> <file | directory/> writes the DDL of every object in
+    // the schema, from DBMS_METADATA, as one script in dependency order, or into a file per
+    // object in a directory, one that exists or a path ending in /.
+    bool run(Session& session, std::string_view cmdLine) override {
+        auto nextToken = [&] {
+            cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+            auto end = std::min(cmdLine.find(' '), cmdLine.size());
+            auto token = cmdLine.substr(0, end);
+            cmdLine.remove_prefix(end);
+            return token;
+        };
+        auto schema = nextToken();
+        uint32_t parallel = kDefaultParallel;
+        if (schema == "--parallel") {
+            const auto count = nextToken();
+            auto res = std::from_chars(count.data(), count.data() + count.size(), parallel);
+            if (res.ec != std::errc() || res.ptr != count.data() + count.size() || parallel == 0) {
+                throw std::runtime_error(std::string(kUsage));
+            }
+            schema = nextToken();
+        }
+        const auto path = std::string(nextToken());
+        if (schema.empty() || path.empty() || !nextToken().empty()) {
+            throw std::runtime_error(std::string(kUsage));
+        }
+        const auto owner = normalizeIdentifier(schema, false);
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto objects = schemaObjects(session.connection(), owner);
+        if (objects.empty()) {
+            throw std::runtime_error(fmt::format("no objects in {} to generate DDL for", owner));
+        }
+        auto newConnection = [&session] { return session.newConnection(); };
+        const bool perObject = path.back() == '/' || std::filesystem::is_directory(path);
+        SchemaDdlResult result;
+        if (perObject) {
+            result = writeSchemaDdlFiles(newConnection, owner, objects, parallel, path);
+        } else {
+            auto out = BufferedFdWriter::open(path, compressionForPath(path), fileWriteOptions());
+            result = writeSchemaDdl(newConnection, owner, objects, parallel, out);
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        for (const auto& error : result.errors) {
+            std::cout << "  " << error << std::endl;
+        }
+        std::cout << fmt::format("Wrote DDL for {} of {} objects ({} bytes) to {} in {:.2f}s", result.objects,
+                                 objects.size(), result.bytes, path, elapsed.count()) << std::endl;
+        return true;
+    }
+} ddlCmd;
+
+class BenchCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".bench");
+    constexpr static auto kUsage = std::string_view(
+            "usage: .bench <threads> [threads] <iterations> [iterations] [binds=<file.csv>] <sql>");
+    BenchCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session& session, std::string_view cmdLine) override {
+        auto nextWord = [&cmdLine] {
+            cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+            return cmdLine.substr(0, cmdLine.find(' '));
+        };
+        auto takeWord = [&cmdLine](std::string_view word) {
+            cmdLine.remove_prefix(word.size());
+        };
+        auto takeCount = [&](std::string_view label) -> uint64_t {
+            auto word = nextWord();
+            uint64_t value = 0;
+            auto res = std::from_chars(word.data(), word.data() + word.size(), value);
+            if (res.ec != std::errc() || res.ptr != word.data() + word.size() || value == 0) {
+                throw std::runtime_error(std::string(kUsage));
+            }
+            takeWord(word);
+            // The "4 threads 100 iterations" spelling reads better in scripts.
+            if (nextWord() == label) {
+                takeWord(label);
+            }
+            return value;
+        };
+
+        LoadRunOptions opts;
+        const auto threads = takeCount("threads");
+        if (threads > std::numeric_limits<uint32_t>::max()) {
+            throw std::runtime_error(std::string(kUsage));
+        }
+        opts.threads = static_cast<uint32_t>(threads);
+        opts.iterations = takeCount("iterations");
+        if (auto word = nextWord(); word.substr(0, 6) == "binds=") {
+            opts.bindRows = loadBindRows(std::string(word.substr(6)));
+            takeWord(word);
+        }
+        auto sql = cmdLine.substr(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        if (sql.empty()) {
+            throw std::runtime_error(std::string(kUsage));
+        }
+        opts.fetchArraySize = fixedFetchArraySize();
+
+        auto result = runLoad([&session] { return session.newConnection(); }, sql, opts);
+        const auto seconds = std::max(result.seconds, 1e-9);
+        std::cout << fmt::format("{} executions on {} threads in {:.2f}s: {:.1f} per second, {} rows fetched",
+                result.executions, opts.threads, result.seconds, result.executions / seconds,
+                result.rowsFetched) << '\n'
+            << fmt::format("latency: mean {:.2f} ms, p50 {:.2f} ms, p95 {:.2f} ms, p99 {:.2f} ms, max {:.2f} ms",
+                result.meanMicros / 1000, result.p50Micros / 1000, result.p95Micros / 1000,
+                result.p99Micros / 1000, result.maxMicros / 1000) << std::endl;
+        if (result.failures != 0) {
+            std::cout << fmt::format("{} executions failed; the first with: {}",
+                    result.failures, result.firstError) << std::endl;
+        }
+        lastFailures = result.failures;
+        return true;
+    }
+
+    // Failed executions in the last run, so --bench can exit with an error.
+    uint64_t lastFailures = 0;
+} benchCmd;
+
+class WorkloadCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".workload");
+    constexpr static auto kUsage = std::string_view("usage: .workload <file.yaml>");
+    WorkloadCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .workload <file> runs the mix of transactions the file describes (see
+    // parseBenchWorkload()) on sessions of their own for its duration, then shows each
+    // transaction's throughput and latency percentiles.
+    bool run(Session& session, std::string_view cmdLine) override {
+        cmdLine = cmdLine.substr(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(" ;") + 1);
+        if (cmdLine.empty()) {
+            throw std::runtime_error(std::string(kUsage));
+        }
+        const auto workload = readBenchWorkload(std::string(cmdLine));
+        const bool openLoop = workload.rate > 0;
+        std::cout << fmt::format("Running {} transaction{} on {} session{} for {:.0f}s, {}",
+                workload.transactions.size(), workload.transactions.size() == 1 ? "" : "s",
+                workload.sessions, workload.sessions == 1 ? "" : "s",
+                std::chrono::duration<double>(workload.duration).count(),
+                openLoop ? fmt::format("{} a second", workload.rate) : std::string("back to back")) << std::endl;
+
+        const auto result = runBenchWorkload([&session] { return session.newConnection(); }, workload);
+        const auto seconds = std::max(result.seconds, 1e-9);
+        std::vector<std::string_view> headings = {
+            "Transaction", "Count", "Failed", "Per s", "Mean ms", "p50 ms", "p90 ms", "p99 ms", "p99.9 ms", "Max ms",
+        };
+        if (openLoop) {
+            // What the latencies would be without waiting for a free session.
+            headings.push_back("Service p99 ms");
+        }
+        Table table(headings.size());
+        applyTableLayout(table);
+        table.addRow();
+        for (size_t col = 0; col < headings.size(); ++col) {
+            table.setColumnValue(0, static_cast<Table::Width>(col), headings[col]);
+        }
+        auto millis = [](double micros) {
+            return fmt::format("{:.2f}", micros / 1000);
+        };
+        uint64_t failures = 0;
+        for (const auto& transaction : result.transactions) {
+            const auto succeeded = transaction.latency.count();
+            const auto row = table.addRow();
+            table.setColumnView(row, 0, transaction.name);
+            table.setColumnValue(row, 1, fmt::format("{}", transaction.count));
+            table.setColumnValue(row, 2, fmt::format("{}", transaction.failures));
+            table.setColumnValue(row, 3, fmt::format("{:.1f}", succeeded / seconds));
+            table.setColumnValue(row, 4, millis(succeeded == 0 ? 0 : static_cast<double>(transaction.totalMicros) / succeeded));
+            table.setColumnValue(row, 5, millis(static_cast<double>(transaction.latency.quantileMicros(0.5))));
+            table.setColumnValue(row, 6, millis(static_cast<double>(transaction.latency.quantileMicros(0.9))));
+            table.setColumnValue(row, 7, millis(static_cast<double>(transaction.latency.quantileMicros(0.99))));
+            table.setColumnValue(row, 8, millis(static_cast<double>(transaction.latency.quantileMicros(0.999))));
+            table.setColumnValue(row, 9, millis(static_cast<double>(transaction.maxMicros)));
+            if (openLoop) {
+                table.setColumnValue(row, 10, millis(static_cast<double>(transaction.service.quantileMicros(0.99))));
+            }
+            failures += transaction.failures;
+        }
+        table.render(std::cout);
+        if (openLoop) {
+            std::cout << fmt::format("Transactions started up to {:.2f} ms behind schedule", result.maxLagMillis)
+                      << std::endl;
+        }
+        for (const auto& transaction : result.transactions) {
+            if (transaction.failures != 0) {
+                std::cout << fmt::format("{}: {} failed; the first with: {}",
+                        transaction.name, transaction.failures, transaction.firstError) << std::endl;
+            }
+        }
+        lastFailures = failures;
+        return true;
+    }
+
+    // Failed transactions in the last run, so --bench-workload can exit with an error.
+    uint64_t lastFailures = 0;
+} workloadCmd;
+
+class ReplayCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".replay");
+    constexpr static auto kUsage = std::string_view("usage: .replay <file> [--sessions <n>] [--speed <x>]");
+    ReplayCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .replay <file> [--sessions N] [--speed X] runs a workload recorded with --capture
+    // again on N connections, keeping the executions' relative timing sped up X times, and
+    // compares the latencies with the captured ones.
+    bool run(Session& session, std::string_view cmdLine) override {
+        cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(" ;") + 1);
+        auto nextToken = [&] {
+            cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+            auto end = std::min(cmdLine.find(' '), cmdLine.size());
+            auto token = cmdLine.substr(0, end);
+            cmdLine.remove_prefix(end);
+            return token;
+        };
+        auto parseNumber = [&](auto& value) {
+            const auto token = nextToken();
+            const auto parsed = std::from_chars(token.data(), token.data() + token.size(), value);
+            if (parsed.ec != std::errc() || parsed.ptr != token.data() + token.size()) {
+                throw std::runtime_error(std::string(kUsage));
+            }
+        };
+        const auto path = std::string(nextToken());
+        if (path.empty()) {
+            throw std::runtime_error(std::string(kUsage));
+        }
+        ReplayOptions opts;
+        for (auto flag = nextToken(); !flag.empty(); flag = nextToken()) {
+            if (flag == "--sessions") {
+                parseNumber(opts.sessions);
+            } else if (flag == "--speed") {
+                parseNumber(opts.speed);
+            } else {
+                throw std::runtime_error(std::string(kUsage));
+            }
+        }
+        if (opts.sessions == 0 || opts.speed < 0) {
+            throw std::runtime_error(std::string(kUsage));
+        }
+
+        opts.topSql = &topSql;
+        const auto workload = readWorkload(path);
+        const auto result = replayWorkload([&session] { return session.newConnection(); }, workload, opts);
+        const auto seconds = std::max(result.seconds, 1e-9);
+        std::cout << fmt::format("{} executions of {} statements on {} sessions in {:.2f}s: {:.1f} per second, "
+                                 "{} rows fetched, at most {:.1f} ms behind schedule",
+                result.executions, workload.statements.size(), opts.sessions, result.seconds,
+                result.executions / seconds, result.rowsFetched, result.maxLagMillis) << '\n';
+        auto printLatencies = [](std::string_view label, const LatencyPercentiles& latency) {
+            std::cout << fmt::format("{} latency: p50 {:.2f} ms, p95 {:.2f} ms, p99 {:.2f} ms, max {:.2f} ms",
+                    label, latency.p50Micros / 1000, latency.p95Micros / 1000, latency.p99Micros / 1000,
+                    latency.maxMicros / 1000) << '\n';
+        };
+        printLatencies("captured", result.captured);
+        printLatencies("replayed", result.replayed);
+        if (result.failures != 0) {
+            std::cout << fmt::format("{} executions failed; the first with: {}",
+                    result.failures, result.firstError) << '\n';
+        }
+        std::cout.flush();
+        return true;
+    }
+} replayCmd;
+
+class TopSqlCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".topsql");
+    constexpr static auto kUsage = std::string_view("usage: .topsql [<n>] [total|mean|max|count|rows] | .topsql reset");
+    TopSqlCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .topsql [N] [total|mean|max|count|rows] lists the N statement fingerprints (default
+    // 20) that took the most time, or were the slowest on average or at worst, ran most
+    // often or touched the most rows, of everything run so far. .topsql reset starts over.
+    bool run(Session& session, std::string_view cmdLine) override {
+        cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(" ;") + 1);
+        auto nextToken = [&] {
+            cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+            auto end = std::min(cmdLine.find(' '), cmdLine.size());
+            auto token = cmdLine.substr(0, end);
+            cmdLine.remove_prefix(end);
+            return token;
+        };
+        size_t limit = 20;
+        auto key = TopSql::SortKey::Total;
+        for (auto token = nextToken(); !token.empty(); token = nextToken()) {
+            if (token == "reset") {
+                topSql.clear();
+                std::cout << "Statement totals cleared" << std::endl;
+                return true;
+            }
+            if (std::isdigit(static_cast<unsigned char>(token.front()))) {
+                const auto parsed = std::from_chars(token.data(), token.data() + token.size(), limit);
+                if (parsed.ec != std::errc() || parsed.ptr != token.data() + token.size()) {
+                    throw std::runtime_error(std::string(kUsage));
+                }
+            } else if (token == "total") {
+                key = TopSql::SortKey::Total;
+            } else if (token == "mean") {
+                key = TopSql::SortKey::Mean;
+            } else if (token == "max") {
+                key = TopSql::SortKey::Max;
+            } else if (token == "count") {
+                key = TopSql::SortKey::Count;
+            } else if (token == "rows") {
+                key = TopSql::SortKey::Rows;
+            } else {
+                throw std::runtime_error(std::string(kUsage));
+            }
+        }
+
+        const auto entries = topSql.top(limit, key);
+        if (entries.empty()) {
+            std::cout << "No statements have run yet" << std::endl;
+            return true;
+        }
+        constexpr std::array<std::string_view, 10> kHeadings = {
+            "Count", "Total ms", "Mean ms", "p50 ms", "p95 ms", "p99 ms", "Max ms", "Rows", "Round trips", "Statement",
+        };
+        Table table(kHeadings.size());
+        applyTableLayout(table);
+        table.addRow();
+        for (size_t col = 0; col < kHeadings.size(); ++col) {
+            table.setColumnValue(0, static_cast<Table::Width>(col), kHeadings[col]);
+        }
+        auto millis = [](double micros) {
+            return fmt::format("{:.2f}", micros / 1000);
+        };
+        for (const auto& entry : entries) {
+            const auto row = table.addRow();
+            table.setColumnValue(row, 0, fmt::format("{}", entry.count));
+            table.setColumnValue(row, 1, millis(static_cast<double>(entry.totalMicros)));
+            table.setColumnValue(row, 2, millis(entry.meanMicros()));
+            table.setColumnValue(row, 3, millis(static_cast<double>(entry.p50Micros)));
+            table.setColumnValue(row, 4, millis(static_cast<double>(entry.p95Micros)));
+            table.setColumnValue(row, 5, millis(static_cast<double>(entry.p99Micros)));
+            table.setColumnValue(row, 6, millis(static_cast<double>(entry.maxMicros)));
+            table.setColumnValue(row, 7, fmt::format("{}", entry.rows));
+            table.setColumnValue(row, 8, fmt::format("{}", entry.roundTrips));
+            table.setColumnView(row, 9, entry.fingerprint);
+        }
+        table.render(std::cout);
+        return true;
+    }
+} topSqlCmd;
+
+class SqlTraceCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".sqltrace");
+    constexpr static auto kUsage = std::string_view("usage: .sqltrace on [binds] [waits] | off | report [<n>]");
+    // Statements the report shows when no number is given.
+    constexpr static size_t kDefaultStatements = 10;
+    SqlTraceCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .sqltrace on [binds] [waits] turns SQL trace (event 10046) on for the REPL's session
+    // with DBMS_MONITOR, recording bind values and waits too if asked; .sqltrace off turns
+    // it off. .sqltrace report [N] reads what's been traced since it was turned on back
+    // from V$DIAG_TRACE_FILE_CONTENTS, on a session of its own so the reading isn't
+    // traced, and shows a tkprof-style summary of the N statements (default 10) that took
+    // the longest, with their parse, execute and fetch calls and waits. No access to the
+    // server's file system is needed, only to those views.
+    bool run(Session& session, std::string_view cmdLine) override {
+        cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(" ;") + 1);
+        auto nextToken = [&] {
+            cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+            auto end = std::min(cmdLine.find(' '), cmdLine.size());
+            auto token = cmdLine.substr(0, end);
+            cmdLine.remove_prefix(end);
+            return token;
+        };
+        const auto action = nextToken();
+        if (action == "on") {
+            bool binds = false;
+            bool waits = false;
+            for (auto token = nextToken(); !token.empty(); token = nextToken()) {
+                if (token == "binds") {
+                    binds = true;
+                } else if (token == "waits") {
+                    waits = true;
+                } else {
+                    throw std::runtime_error(std::string(kUsage));
+                }
+            }
+            turnOn(session.connection(), binds, waits);
+            std::cout << fmt::format("SQL trace on, to {}", _traceFile) << std::endl;
+        } else if (action == "off" && nextToken().empty()) {
+            session.connection().prepareStatement(kDisableSql).execute();
+            std::cout << "SQL trace off" << std::endl;
+        } else if (action == "report") {
+            auto limit = kDefaultStatements;
+            const auto count = nextToken();
+            if (!count.empty()) {
+                const auto parsed = std::from_chars(count.data(), count.data() + count.size(), limit);
+                if (parsed.ec != std::errc() || parsed.ptr != count.data() + count.size() || limit == 0 ||
+                        !nextToken().empty()) {
+                    throw std::runtime_error(std::string(kUsage));
+                }
+            }
+            if (_traceFile.empty()) {
+                throw std::runtime_error("SQL trace hasn't been turned on; .sqltrace on first");
+            }
+            auto conn = session.newConnection();
+            report(read(conn), limit);
+        } else {
+            throw std::runtime_error(std::string(kUsage));
+        }
+        return true;
+    }
+
+private:
+    constexpr static auto kEnableSql = std::string_view(
+            "BEGIN DBMS_MONITOR.SESSION_TRACE_ENABLE(waits => :1, binds => :2); END;");
+    constexpr static auto kDisableSql = std::string_view("BEGIN DBMS_MONITOR.SESSION_TRACE_DISABLE; END;");
+    constexpr static auto kTraceFileSql = std::string_view(
+            "SELECT value FROM v$diag_info WHERE name = 'Default Trace File'");
+    constexpr static auto kLastLineSql = std::string_view(
+            "SELECT NVL(MAX(line_number), 0) FROM v$diag_trace_file_contents WHERE trace_filename = :1");
+    constexpr static auto kContentsSql = std::string_view(
+            "SELECT payload FROM v$diag_trace_file_contents WHERE trace_filename = :1 AND line_number > :2 "
+            "ORDER BY line_number");
+
+    // Remembers the session's trace file, and how far it went before, so the report
+    // starts from here.
+    void turnOn(OracleConnection& conn, bool binds, bool waits) {
+        std::string path;
+        {
+            auto stmt = conn.prepareStatement(kTraceFileSql);
+            stmt.execute();
+            forEachRow<std::string_view>(stmt, [&](std::string_view value) { path = value; });
+        }
+        if (path.empty()) {
+            throw std::runtime_error("the server didn't say where the session's trace file is");
+        }
+        const auto file = path.substr(path.find_last_of("/\\") + 1);
+        uint64_t lastLine = 0;
+        {
+            auto stmt = conn.prepareStatement(kLastLineSql);
+            bind(stmt, file);
+            stmt.execute();
+            forEachRow<uint64_t>(stmt, [&](uint64_t line) { lastLine = line; });
+        }
+        auto stmt = conn.prepareStatement(kEnableSql);
+        bind(stmt, waits, binds);
+        stmt.execute();
+        _traceFile = file;
+        _startLine = lastLine;
+    }
+
+    SqlTraceSummary read(OracleConnection& conn) const {
+        SqlTraceSummary summary;
+        auto stmt = conn.prepareStatement(kContentsSql);
+        applyFetchSettings(stmt);
+        bind(stmt, _traceFile, _startLine);
+        stmt.execute();
+        forEachRow<std::optional<std::string_view>>(stmt, [&](std::optional<std::string_view> payload) {
+            summary.addLine(payload.value_or(std::string_view()));
+        });
+        return summary;
+    }
+
+    static void report(const SqlTraceSummary& summary, size_t limit) {
+        const auto statements = summary.statements();
+        if (statements.empty()) {
+            std::cout << "Nothing has been traced yet" << std::endl;
+            return;
+        }
+        auto seconds = [](uint64_t micros) {
+            return fmt::format("{:.3f}", static_cast<double>(micros) / 1e6);
+        };
+        auto millis = [](uint64_t micros) {
+            return fmt::format("{:.2f}", static_cast<double>(micros) / 1000);
+        };
+        auto addHeadings = [](Table& table, auto headings) {
+            table.addRow();
+            for (size_t col = 0; col < headings.size(); ++col) {
+                table.setColumnValue(0, static_cast<Table::Width>(col), headings[col]);
+            }
+        };
+        auto renderWaits = [&](const std::vector<TraceWaitTotals>& waits) {
+            constexpr std::array<std::string_view, 4> kHeadings = {"Waited on", "Times", "Max ms", "Total ms"};
+            Table table(kHeadings.size());
+            applyTableLayout(table);
+            addHeadings(table, kHeadings);
+            for (const auto& wait : waits) {
+                const auto row = table.addRow();
+                table.setColumnView(row, 0, wait.event);
+                table.setColumnValue(row, 1, fmt::format("{}", wait.count));
+                table.setColumnValue(row, 2, millis(wait.maxMicros));
+                table.setColumnValue(row, 3, millis(wait.totalMicros));
+            }
+            table.render(std::cout);
+        };
+
+        constexpr std::array<std::string_view, 9> kHeadings = {
+            "Call", "Count", "CPU s", "Elapsed s", "Disk", "Query", "Current", "Rows", "Misses",
+        };
+        constexpr std::array<std::string_view, 4> kCalls = {"Parse", "Execute", "Fetch", "Total"};
+        for (size_t idx = 0; idx < std::min(limit, statements.size()); ++idx) {
+            const auto& statement = statements[idx];
+            std::cout << fmt::format("\n{} at depth {}{}", statement.id, statement.depth,
+                                     statement.parseErrors == 0 ? std::string()
+                                                                : fmt::format(", {} failed parses", statement.parseErrors))
+                      << '\n' << (statement.text.empty() ? "(parsed before tracing began)" : statement.text) << '\n';
+            Table table(kHeadings.size());
+            applyTableLayout(table);
+            addHeadings(table, kHeadings);
+            for (size_t call = 0; call < kCalls.size(); ++call) {
+                const auto totals = call < statement.calls.size() ? statement.calls[call] : statement.total();
+                const auto row = table.addRow();
+                table.setColumnView(row, 0, kCalls[call]);
+                table.setColumnValue(row, 1, fmt::format("{}", totals.count));
+                table.setColumnValue(row, 2, seconds(totals.cpuMicros));
+                table.setColumnValue(row, 3, seconds(totals.elapsedMicros));
+                table.setColumnValue(row, 4, fmt::format("{}", totals.disk));
+                table.setColumnValue(row, 5, fmt::format("{}", totals.query));
+                table.setColumnValue(row, 6, fmt::format("{}", totals.current));
+                table.setColumnValue(row, 7, fmt::format("{}", totals.rows));
+                table.setColumnValue(row, 8, fmt::format("{}", totals.misses));
+            }
+            table.render(std::cout);
+            if (!statement.waits.empty()) {
+                renderWaits(statement.waits);
+            }
+        }
+        const auto otherWaits = summary.waitsOutsideCursors();
+        if (!otherWaits.empty()) {
+            std::cout << "\nBetween calls\n";
+            renderWaits(otherWaits);
+        }
+        std::cout << fmt::format("\n{} of {} statements traced, by elapsed time", std::min(limit, statements.size()),
+                                 statements.size()) << std::endl;
+    }
+
+    // The REPL session's trace file, by its name in V$DIAG_TRACE_FILE_CONTENTS, and the
+    // last line it had before tracing was turned on. Empty until it has been.
+    std::string _traceFile;
+    uint64_t _startLine = 0;
+} sqlTraceCmd;
+
+class FetchBenchCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".fetchbench");
+    constexpr static auto kUsage = std::string_view("usage: .fetchbench [arraysize=<n>[,<n>...]] <query>");
+    FetchBenchCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // Runs the query once per array size, or once with the fetch settings, draining its rows
+    // without formatting them.
+    bool run(Session& session, std::string_view cmdLine) override {
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        std::vector<uint32_t> arraySizes;
+        constexpr auto kSizesPrefix = std::string_view("arraysize=");
+        if (cmdLine.substr(0, kSizesPrefix.size()) == kSizesPrefix) {
+            const auto end = std::min(cmdLine.find(' '), cmdLine.size());
+            auto list = cmdLine.substr(kSizesPrefix.size(), end - kSizesPrefix.size());
+            cmdLine.remove_prefix(end);
+            while (!list.empty()) {
+                const auto comma = std::min(list.find(','), list.size());
+                const auto word = list.substr(0, comma);
+                uint32_t size = 0;
+                auto res = std::from_chars(word.data(), word.data() + word.size(), size);
+                if (res.ec != std::errc() || res.ptr != word.data() + word.size() || size == 0) {
+                    throw std::runtime_error(std::string(kUsage));
+                }
+                arraySizes.push_back(size);
+                list.remove_prefix(std::min(comma + 1, list.size()));
+            }
+            cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        }
+        if (cmdLine.empty()) {
+            throw std::runtime_error(std::string(kUsage));
+        }
+
+        auto stmt = session.prepareStatement(cmdLine);
+        if (!stmt.isQuery()) {
+            throw std::runtime_error("only queries can be fetch benchmarked");
+        }
+        bindReplVariables(session, stmt);
+        auto measure = [&](std::optional<uint32_t> arraySize) {
+            applyFetchSettings(stmt);
+            // No limits, the point is to fetch everything.
+            stmt.setFetchLimits(0, 0);
+            if (arraySize) {
+                stmt.setAdaptiveFetch(0);
+                stmt.setFetchArraySize(*arraySize);
+            }
+            const auto start = std::chrono::steady_clock::now();
+            stmt.execute();
+            const std::chrono::duration<double> executed = std::chrono::steady_clock::now() - start;
+            const auto result = drainResults(stmt);
+
+            const auto seconds = std::max(result.seconds, 1e-9);
+            std::string label;
+            if (arraySize || fetchArraySizeSetting.get() != 0) {
+                label = fmt::format("arraysize {}", result.finalArraySize);
+            } else {
+                label = fmt::format("arraysize auto, ending at {}", result.finalArraySize);
+            }
+            std::cout << fmt::format("{}: {} rows in {:.3f}s, {:.0f} rows/s, {:.1f} MB/s, {} round trips, "
+                                     "{:.2f} ms per round trip, execute {:.2f} ms",
+                    label, result.rows, result.seconds, result.rows / seconds,
+                    result.bytes / seconds / (1024 * 1024), result.roundTrips,
+                    result.roundTrips == 0 ? 0.0 : result.roundTripSeconds * 1000 / result.roundTrips,
+                    executed.count() * 1000) << std::endl;
+        };
+        if (arraySizes.empty()) {
+            measure(std::nullopt);
+        }
+        for (const auto size : arraySizes) {
+            measure(size);
+        }
+        return true;
+    }
+} fetchBenchCmd;
+
+// MB of a background job's formatted rows kept in memory before the rest spill to disk.
+// With buffer set, queries are fetched whole, up to that many rows, into a columnar
+// result that .sort, .filter, .grep and .top slice without running the query again; 0 is off.
+UInt32Setting bufferRowsSetting("buffer", 0);
+std::optional<ColumnarResult> bufferedResult;
+
+void printBufferedResult(const ColumnarResult& result) {
+    const auto& view = result.view();
+    if (view.empty()) {
+        std::cout << "No rows" << std::endl;
+        return;
+    }
+    Table table(static_cast<Table::Width>(result.numColumns()));
+    applyTableLayout(table);
+    table.beginStreaming(std::cout);
+    table.addRow();
+    for (uint32_t col = 0; col < result.numColumns(); ++col) {
+        table.setColumnValue(0, static_cast<Table::Width>(col), result.column(col).name);
+    }
+    constexpr size_t kRowsPerFlush = 1000;
+    fmt::memory_buffer text;
+    for (size_t idx = 0; idx < view.size(); ++idx) {
+        const auto tableRow = table.addRow();
+        for (uint32_t col = 0; col < result.numColumns(); ++col) {
+            text.clear();
+            result.formatCell(col, view[idx], text);
+            table.setColumnValue(tableRow, static_cast<Table::Width>(col), std::string_view(text.data(), text.size()));
+        }
+        if ((idx + 1) % kRowsPerFlush == 0) {
+            table.flush();
+        }
+    }
+    table.endStreaming();
+    std::cout << fmt::format("{} of {} buffered rows{}", view.size(), result.numRows(),
+            result.truncated() ? ", stopped at the buffer setting" : "") << std::endl;
+}
+
+ColumnarResult& requireBufferedResult() {
+    if (!bufferedResult) {
+        throw std::runtime_error("there's no buffered result; set buffer to a row limit and run a query");
+    }
+    return *bufferedResult;
+}
+
+class SortCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".sort");
+    SortCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .sort <column> [asc|desc] reorders the buffered result's rows, which ties keep in the
+    // order they were in.
+    bool run(Session&, std::string_view cmdLine) override {
+        auto& result = requireBufferedResult();
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(" ;") + 1);
+        const auto nameEnd = std::min(cmdLine.find(' '), cmdLine.size());
+        auto direction = cmdLine.substr(nameEnd);
+        direction.remove_prefix(std::min(direction.find_first_not_of(' '), direction.size()));
+        std::string lowered(direction);
+        std::transform(lowered.begin(), lowered.end(), lowered.begin(), [](const auto ch) {
+            return static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+        });
+        if (nameEnd == 0 || (!lowered.empty() && lowered != "asc" && lowered != "desc")) {
+            throw std::runtime_error("usage: .sort <column> [asc|desc]");
+        }
+        result.sortBy(result.findColumn(cmdLine.substr(0, nameEnd)), lowered == "desc");
+        printBufferedResult(result);
+        return true;
+    }
+} sortCmd;
+
+class FilterCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".filter");
+    FilterCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .filter <column> <op> <value> narrows the buffered result's rows to the ones that
+    // match, on top of any filter before it; .filter alone brings every row back.
+    bool run(Session&, std::string_view cmdLine) override {
+        auto& result = requireBufferedResult();
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(" ;") + 1);
+        if (cmdLine.empty()) {
+            result.reset();
+            printBufferedResult(result);
+            return true;
+        }
+        auto nextWord = [&] {
+            cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+            const auto end = std::min(cmdLine.find(' '), cmdLine.size());
+            const auto word = cmdLine.substr(0, end);
+            cmdLine.remove_prefix(end);
+            return word;
+        };
+        const auto column = nextWord();
+        const auto op = nextWord();
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        if (op.empty() || cmdLine.empty()) {
+            throw std::runtime_error("usage: .filter [<column> <op> <value>]");
+        }
+        result.filter(result.findColumn(column), parseCompareOp(op), cmdLine);
+        printBufferedResult(result);
+        return true;
+    }
+} filterCmd;
+
+class TopCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".top");
+    TopCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .top <n> by <column> shows the buffered rows with the n largest values of a column.
+    bool run(Session&, std::string_view cmdLine) override {
+        constexpr auto kUsage = "usage: .top <n> by <column>";
+        auto& result = requireBufferedResult();
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(" ;") + 1);
+        uint32_t n = 0;
+        const auto parsed = std::from_chars(cmdLine.data(), cmdLine.data() + cmdLine.size(), n);
+        auto rest = cmdLine.substr(static_cast<size_t>(parsed.ptr - cmdLine.data()));
+        rest.remove_prefix(std::min(rest.find_first_not_of(' '), rest.size()));
+        if (parsed.ec != std::errc() || rest.size() < 4 || std::tolower(static_cast<unsigned char>(rest[0])) != 'b'
+                || std::tolower(static_cast<unsigned char>(rest[1])) != 'y' || rest[2] != ' ') {
+            throw std::runtime_error(kUsage);
+        }
+        rest.remove_prefix(3);
+        rest.remove_prefix(std::min(rest.find_first_not_of(' '), rest.size()));
+        result.top(n, result.findColumn(rest));
+        printBufferedResult(result);
+        return true;
+    }
+} topCmd;
+
+// Shows a buffered or loaded result in the pager when there's a terminal to page on, or
+// printed whole otherwise.
+void showColumnarResult(const ColumnarResult& result) {
+    if (result.view().empty() || !::isatty(STDIN_FILENO) || !::isatty(STDOUT_FILENO)) {
+        printBufferedResult(result);
+        return;
+    }
+    ColumnarResultSource source(result);
+    ResultPager pager(source, static_cast<size_t>(pagerWindowSetting.get()) * 1024);
+    pager.run();
+}
+
+class GrepCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".grep");
+    GrepCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .grep [<column>=]<text> narrows the buffered result's rows to the ones with text in
+    // a column, or in any column, on top of any filter before it, and shows them. When what
+    // comes before the = isn't a column, all of it is the text.
+    bool run(Session&, std::string_view cmdLine) override {
+        auto& result = requireBufferedResult();
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(" ;") + 1);
+        if (cmdLine.empty()) {
+            throw std::runtime_error("usage: .grep [<column>=]<text>");
+        }
+        std::optional<uint32_t> column;
+        auto pattern = cmdLine;
+        if (const auto equals = cmdLine.find('='); equals != std::string_view::npos && equals > 0
+                && equals + 1 < cmdLine.size()) {
+            try {
+                column = result.findColumn(cmdLine.substr(0, equals));
+                pattern = cmdLine.substr(equals + 1);
+            } catch(const std::runtime_error&) {
+            }
+        }
+        result.grep(column, pattern);
+        showColumnarResult(result);
+        return true;
+    }
+} grepCmd;
+
+// The path a .save or .open argument names, without the spaces or semicolon around it.
+std::string snapshotPath(std::string_view arg, std::string_view usage) {
+    arg.remove_prefix(std::min(arg.find_first_not_of(' '), arg.size()));
+    arg = arg.substr(0, arg.find_last_not_of(" ;") + 1);
+    if (arg.empty()) {
+        throw std::runtime_error(std::string(usage));
+    }
+    return std::string(arg);
+}
+
+class SaveCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".save");
+    SaveCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .save <file> writes the buffered rows, as sorted and filtered, to a snapshot that
+    // .open or --open shows again later without the database.
+    bool run(Session&, std::string_view arg) override {
+        const auto path = snapshotPath(arg, "usage: .save <file>");
+        const auto& result = requireBufferedResult();
+        result.save(path);
+        std::cout << "Saved " << result.view().size() << " rows to " << path << std::endl;
+        return true;
+    }
+} saveCmd;
+
+class OpenCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".open");
+    OpenCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .open <file> loads a snapshot written by .save as the buffered result, so .sort,
+    // .filter, .grep and .top work on it, and shows it.
+    bool run(Session&, std::string_view arg) override {
+        bufferedResult = ColumnarResult::load(snapshotPath(arg, "usage: .open <file>"));
+        showColumnarResult(*bufferedResult);
+        return true;
+    }
+} openCmd;
+
+UInt32Setting bgMemorySetting("bgmemorymb", 64);
+BackgroundJobs backgroundJobs;
+
+class BgCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".bg");
+    BgCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session& session, std::string_view cmdLine) override {
+        cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(" ;") + 1);
+        if (cmdLine.empty()) {
+            throw std::runtime_error("usage: .bg <sql>");
+        }
+        const auto id = backgroundJobs.start([&session] { return session.newConnection(); }, std::string(cmdLine),
+                                             static_cast<size_t>(bgMemorySetting.get()) * 1024 * 1024);
+        std::cout << "[" << id << "] started" << std::endl;
+        return true;
+    }
+} bgCmd;
+
+class JobsCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".jobs");
+    JobsCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session&, std::string_view) override {
+        if (backgroundJobs.jobs().empty()) {
+            std::cout << "No background jobs" << std::endl;
+            return true;
+        }
+        constexpr size_t kMaxSqlWidth = 60;
+        for (const auto& [id, job] : backgroundJobs.jobs()) {
+            const auto status = job->status();
+            std::string_view sql = job->sql();
+            auto shown = sql.size() > kMaxSqlWidth ? fmt::format("{}...", sql.substr(0, kMaxSqlWidth - 3))
+                : std::string(sql);
+            std::replace(shown.begin(), shown.end(), '\n', ' ');
+            std::string state;
+            switch (status.state) {
+            case BackgroundJob::State::Running:
+                state = "running";
+                break;
+            case BackgroundJob::State::Done:
+                state = fmt::format("done in {:.3f}s", status.seconds);
+                break;
+            case BackgroundJob::State::Failed:
+                state = "failed";
+                break;
+            }
+            std::cout << fmt::format("[{}] {:<16} {:>10} rows {:>8} KB{}  {}", id, state, status.rows,
+                                     status.bufferedBytes / 1024, status.spilled ? " (spilled)" : "", shown)
+                      << std::endl;
+        }
+        return true;
+    }
+} jobsCmd;
+
+class FgCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".fg");
+    FgCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // Waits for the job, newest by default, then prints its results and forgets it.
+    bool run(Session&, std::string_view cmdLine) override {
+        cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(' ') + 1);
+        uint32_t id = 0;
+        if (!cmdLine.empty()) {
+            auto res = std::from_chars(cmdLine.data(), cmdLine.data() + cmdLine.size(), id);
+            if (res.ec != std::errc() || res.ptr != cmdLine.data() + cmdLine.size() || id == 0) {
+                throw std::runtime_error("usage: .fg [job]");
+            }
+        }
+        auto job = backgroundJobs.take(id);
+        job->wait();
+        const auto status = job->status();
+        if (status.state == BackgroundJob::State::Failed) {
+            throw std::runtime_error(status.message);
+        }
+        const auto& names = job->columnNames();
+        if (names.empty()) {
+            std::cout << status.message << std::endl;
+            return true;
+        }
+
+        Table table(static_cast<Table::Width>(names.size()));
+        applyTableLayout(table);
+        table.beginStreaming(std::cout);
+        table.addRow();
+        for (size_t col = 0; col < names.size(); ++col) {
+            table.setColumnValue(0, static_cast<Table::Width>(col), names[col]);
+        }
+        constexpr uint64_t kRowsPerFlush = 1000;
+        uint64_t rows = 0;
+        job->forEachRow([&](const std::vector<std::string_view>& cells) {
+            const auto row = table.addRow();
+            for (size_t col = 0; col < cells.size(); ++col) {
+                table.setColumnValue(row, static_cast<Table::Width>(col), cells[col]);
+            }
+            if (++rows % kRowsPerFlush == 0) {
+                table.flush();
+            }
+        });
+        if (rows == 0) {
+            std::cout << "No rows returned" << std::endl;
+            return true;
+        }
+        table.endStreaming();
+        std::cout << fmt::format("Fetched {} rows in {:.3f}s", rows, status.seconds) << std::endl;
+        return true;
+    }
+} fgCmd;
+
+// MB of query results .cache keeps before dropping the least recently used.
+UInt32Setting cacheMbSetting("cachemb", 16);
+ResultCache resultCache;
+
+void printCachedResult(const CachedResult& result) {
+    const auto& names = result.columnNames();
+    if (result.numRows() == 0) {
+        std::cout << "No rows returned" << std::endl;
+        return;
+    }
+    Table table(static_cast<Table::Width>(names.size()));
+    applyTableLayout(table);
+    table.beginStreaming(std::cout);
+    table.addRow();
+    for (size_t col = 0; col < names.size(); ++col) {
+        table.setColumnValue(0, static_cast<Table::Width>(col), names[col]);
+    }
+    for (uint32_t row = 0; row < result.numRows(); ++row) {
+        const auto tableRow = table.addRow();
+        for (size_t col = 0; col < names.size(); ++col) {
+            table.setColumnValue(tableRow, static_cast<Table::Width>(col),
+                                 result.cell(row, static_cast<uint32_t>(col)));
+        }
+    }
+    table.endStreaming();
+    std::cout << "Fetched " << result.numRows() << " rows from the cache" << std::endl;
+}
+
+class CacheCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".cache");
+    CacheCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .cache on|off|clear, or the cache's state with no argument.
+    bool run(Session& session, std::string_view cmdLine) override {
+        cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(' ') + 1);
+        if (cmdLine == "on") {
+            // Change notifications are registered on a connection that never takes the key,
+            // so nothing done on the shard would invalidate what's cached.
+            if (!session.shardingKey().empty()) {
+                throw std::runtime_error("the result cache can't be used with a sharding key; .shard off first");
+            }
+            if (!resultCache.isStarted()) {
+                resultCache.start([&session] { return session.newConnection(true); });
+            }
+        } else if (cmdLine == "off") {
+            resultCache.stop();
+        } else if (cmdLine == "clear") {
+            resultCache.clear();
+        } else if (!cmdLine.empty()) {
+            throw std::runtime_error("usage: .cache [on|off|clear]");
+        }
+        if (!resultCache.isStarted()) {
+            std::cout << "Result cache is off" << std::endl;
+            return true;
+        }
+        std::cout << fmt::format("Result cache is on: {} results, {} KB", resultCache.numEntries(),
+                                 resultCache.bytes() / 1024) << std::endl;
+        return true;
+    }
+} cacheCmd;
+
+class CallCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".call");
+    CallCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .call <procedure> [argument ...] runs a stored procedure in one round trip, with
+    // [v1, v2, ...] and @file arguments bound as whole PL/SQL index-by tables.
+    bool run(Session& session, std::string_view cmdLine) override {
+        const auto call = ProcedureCall::parse(cmdLine);
+        auto stmt = call.execute(session.connection());
+        resultCache.clear();
+        size_t arrayValues = 0;
+        for (const auto& arg : call.arguments()) {
+            arrayValues += arg.isArray ? arg.values.size() : 0;
+        }
+        if (arrayValues > 0) {
+            std::cout << fmt::format("Called {} with {} array values", call.procedure(), arrayValues) << std::endl;
+        } else {
+            std::cout << "Called " << call.procedure() << std::endl;
+        }
+        printImplicitResults(stmt);
+        return true;
+    }
+} callCmd;
+
+// Words offered by tab completion. The dot-commands and the built-in keywords are known up
+// front; the rest of the reserved words come from the database and are filled in by the
+// background connect.
+struct CompletionWords {
+    tsl::htrie_set<char> commands;
+    tsl::htrie_set<char> reservedKeywords;
+    std::atomic<bool> reservedKeywordsReady{false};
+} completionWords;
+
+// When input is piped in or read from a script rather than typed, each statement is tagged
+// with the <file>:<line> it started on, so it can be found in v$session and server-side
+// traces.
+std::string statementAction;
+
+// Non-zero commits every change as it's executed, in the same round trip.
+UInt32Setting autocommitSetting("autocommit", 0);
+// Scripts commit every this many changes or rows, whichever comes first; 0 is no limit.
+UInt32Setting commitEverySetting("commitevery", 0);
+UInt32Setting commitRowsSetting("commitrows", 0);
+CommitPolicy commitPolicy;
+// How many scripts deep the line being run is; 0 when it was typed.
+uint32_t scriptDepth = 0;
+
+CommitPolicy::Limits commitLimits() {
+    CommitPolicy::Limits limits;
+    limits.autocommit = autocommitSetting.get() != 0;
+    if (scriptDepth > 0) {
+        limits.statements = commitEverySetting.get();
+        limits.rows = commitRowsSetting.get();
+    }
+    return limits;
+}
+
+// Where queries go when there's a standby. Auto sends read-only queries there unless there
+// are uncommitted changes they'd need to see; standby sends them regardless. Anything that
+// writes or locks always runs on the primary.
+enum class Route { Auto, Primary, Standby };
+Route queryRoute = Route::Auto;
+
+bool routesToStandby(const Session& session, const dpiStmtInfo& info, std::string_view sql) {
+    if (!session.hasStandby() || !info.isQuery || queryRoute == Route::Primary) {
+        return false;
+    }
+    std::string lower(sql);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char ch) { return std::tolower(ch); });
+    // A standby is read-only, so it can't take the row locks.
+    if (lower.find("for update") != std::string::npos) {
+        return false;
+    }
+    return queryRoute == Route::Standby || !commitPolicy.hasPending();
+}
+
+class RouteCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".route");
+    RouteCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .route [auto|primary|standby] shows or sets where queries run, see Route.
+    bool run(Session& session, std::string_view cmdLine) override {
+        if (cmdLine == "auto") {
+            queryRoute = Route::Auto;
+        } else if (cmdLine == "primary") {
+            queryRoute = Route::Primary;
+        } else if (cmdLine == "standby") {
+            queryRoute = Route::Standby;
+        } else if (!cmdLine.empty()) {
+            throw std::runtime_error("usage: .route [auto|primary|standby]");
+        }
+        if (!session.hasStandby()) {
+            std::cout << "No standby configured; everything runs on the primary" << std::endl;
+            return true;
+        }
+        const auto name = queryRoute == Route::Auto ? "auto" : queryRoute == Route::Primary ? "primary" : "standby";
+        std::cout << "Queries route " << name << std::endl;
+        return true;
+    }
+} routeCmd;
+
+class ShardCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".shard");
+    constexpr static auto kUsage = std::string_view("usage: .shard [off | key=<value>[,<value> ...] [super=<value>[,...]]]");
+    ShardCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .shard key=<value>[,...] [super=<value>[,...]] moves the REPL's session to the shard
+    // that owns the key, so statements skip the catalog's routing; .shard off goes back to
+    // it and .shard shows the key. Numbers are NUMBER columns and anything else, 'quoted' or
+    // not, VARCHAR2.
+    bool run(Session& session, std::string_view cmdLine) override {
+        if (cmdLine.empty()) {
+            const auto key = session.shardingKey();
+            if (key.empty()) {
+                std::cout << "No sharding key" << std::endl;
+            } else {
+                std::cout << "key=" << describe(key.columns);
+                if (!key.superColumns.empty()) {
+                    std::cout << " super=" << describe(key.superColumns);
+                }
+                std::cout << std::endl;
+            }
+            return true;
+        }
+        OracleShardingKey key;
+        if (cmdLine != "off") {
+            while (!cmdLine.empty()) {
+                const auto equals = cmdLine.find('=');
+                if (equals == std::string_view::npos) {
+                    throw std::runtime_error(std::string(kUsage));
+                }
+                const auto name = cmdLine.substr(0, equals);
+                if (name != "key" && name != "super") {
+                    throw std::runtime_error(std::string(kUsage));
+                }
+                auto& columns = name == "key" ? key.columns : key.superColumns;
+                cmdLine.remove_prefix(equals + 1);
+                columns = parseColumns(cmdLine);
+                cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+            }
+            if (key.columns.empty()) {
+                throw std::runtime_error(std::string(kUsage));
+            }
+        }
+        // The session is swapped for another, which would silently lose the changes.
+        if (commitPolicy.hasPending()) {
+            throw std::runtime_error("commit or roll back first; moving to another shard would lose the changes");
+        }
+        // Cached results came from the last shard, and with a key set changes on the new
+        // one wouldn't invalidate them, so the cache only starts again through the catalog.
+        const bool caching = resultCache.isStarted();
+        resultCache.stop();
+        resultCache.clear();
+        session.setShardingKey(std::move(key));
+        moreRowsCmd.clearActive();
+        std::cout << (session.shardingKey().empty() ? "Connected through the shard catalog" : "Connected to the key's shard") << std::endl;
+        if (caching && session.shardingKey().empty()) {
+            resultCache.start([&session] { return session.newConnection(true); });
+        } else if (caching) {
+            std::cout << "Result cache is off while a sharding key is set" << std::endl;
+        }
+        return true;
+    }
+
+private:
+    // Comma separated values up to the next space outside quotes, taken off text.
+    static std::vector<OracleShardingKeyColumn> parseColumns(std::string_view& text) {
+        std::vector<OracleShardingKeyColumn> columns;
+        for (;;) {
+            OracleShardingKeyColumn column;
+            size_t pos = 0;
+            const bool quoted = !text.empty() && text.front() == '\'';
+            if (quoted) {
+                for (pos = 1;; ++pos) {
+                    if (pos == text.size()) {
+                        throw std::runtime_error("sharding key value is missing its closing quote");
+                    }
+                    if (text[pos] == '\'') {
+                        if (pos + 1 < text.size() && text[pos + 1] == '\'') {
+                            ++pos;
+                        } else {
+                            ++pos;
+                            break;
+                        }
+                    }
+                    column.value.push_back(text[pos]);
+                }
+            } else {
+                pos = std::min(text.find_first_of(", "), text.size());
+                column.value.assign(text.substr(0, pos));
+                double number = 0;
+                const auto res = std::from_chars(column.value.data(), column.value.data() + column.value.size(), number);
+                if (res.ec == std::errc() && res.ptr == column.value.data() + column.value.size()) {
+                    column.type = DPI_ORACLE_TYPE_NUMBER;
+                }
+            }
+            if (column.value.empty() && !quoted) {
+                throw std::runtime_error("empty sharding key value");
+            }
+            columns.push_back(std::move(column));
+            text.remove_prefix(pos);
+            if (text.empty() || text.front() != ',') {
+                return columns;
+            }
+            text.remove_prefix(1);
+        }
+    }
+
+    static std::string describe(const std::vector<OracleShardingKeyColumn>& columns) {
+        std::string out;
+        for (const auto& column : columns) {
+            if (!out.empty()) {
+                out += ',';
+            }
+            out += column.type == DPI_ORACLE_TYPE_NUMBER ? column.value : fmt::format("'{}'", column.value);
+        }
+        return out;
+    }
+} shardCmd;
+
+class VarCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".var");
+    VarCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .var lists the bind variables; .var <name> <type> [= value] declares one, null
+    // unless it's given a number or 'string' to start with.
+    bool run(Session& session, std::string_view cmdLine) override {
+        if (cmdLine.empty()) {
+            const auto declared = bindVariables.list();
+            if (declared.empty()) {
+                std::cout << "No bind variables" << std::endl;
+                return true;
+            }
+            Table table(2);
+            applyTableLayout(table);
+            table.addRow();
+            table.setColumnValue(0, 0, "Name");
+            table.setColumnValue(0, 1, "Type");
+            for (const auto& var : declared) {
+                const auto row = table.addRow();
+                table.setColumnValue(row, 0, var.name);
+                table.setColumnValue(row, 1, var.type);
+            }
+            table.render(std::cout);
+            return true;
+        }
+        const auto nameEnd = std::min(cmdLine.find(' '), cmdLine.size());
+        const auto name = cmdLine.substr(0, nameEnd);
+        auto type = cmdLine.substr(nameEnd);
+        std::optional<std::string_view> value;
+        if (const auto equals = type.find('='); equals != std::string_view::npos) {
+            value = type.substr(equals + 1);
+            type = type.substr(0, equals);
+        }
+        if (type.find_first_not_of(' ') == std::string_view::npos) {
+            throw std::runtime_error("usage: .var [<name> <type> [= value]]");
+        }
+        bindVariables.declare(session.connection(), name, type);
+        if (value) {
+            bindVariables.assign(name, *value);
+        }
+        return true;
+    }
+} varCmd;
+
+class ExecCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".exec");
+    ExecCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .exec <statement> runs one PL/SQL statement, e.g. :id := 42 or a procedure call, in
+    // an anonymous block with the bind variables bound in and out. The block's text
+    // doesn't change with the values, so it's parsed once however often it's run.
+    bool run(Session& session, std::string_view cmdLine) override {
+        while (!cmdLine.empty() && (cmdLine.back() == ';' || cmdLine.back() == ' ')) {
+            cmdLine.remove_suffix(1);
+        }
+        if (cmdLine.empty()) {
+            throw std::runtime_error("usage: .exec <PL/SQL statement>");
+        }
+        auto stmt = session.prepareStatement(fmt::format("BEGIN {}; END;", cmdLine));
+        bindReplVariables(session, stmt);
+        const auto mode = commitPolicy.modeFor(commitLimits(), 1);
+        stmt.execute(mode);
+        commitPolicy.executed(mode, 1, 0);
+        resultCache.clear();
+        std::cout << "PL/SQL procedure successfully completed" << std::endl;
+        printImplicitResults(stmt);
+        return true;
+    }
+} execCmd;
+
+class PrintCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".print");
+    PrintCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .print [name ...] shows the values of the named bind variables, or all of them.
+    bool run(Session& session, std::string_view cmdLine) override {
+        std::vector<std::string> names;
+        while (!cmdLine.empty()) {
+            const auto end = std::min(cmdLine.find(' '), cmdLine.size());
+            if (end > 0) {
+                auto name = cmdLine.substr(0, end);
+                name.remove_prefix(name.front() == ':' ? 1 : 0);
+                names.emplace_back(name);
+            }
+            cmdLine.remove_prefix(std::min(end + 1, cmdLine.size()));
+        }
+        const auto declared = bindVariables.list(names);
+        if (declared.empty()) {
+            std::cout << "No bind variables" << std::endl;
+            return true;
+        }
+        Table table(static_cast<Table::Width>(declared.size()));
+        applyTableLayout(table);
+        table.addRow();
+        table.addRow();
+        for (Table::Width idx = 0; idx < declared.size(); ++idx) {
+            table.setColumnValue(0, idx, declared[idx].name);
+            table.setColumnValue(1, idx, declared[idx].value.value_or(""));
+        }
+        table.render(std::cout);
+        return true;
+    }
+} printCmd;
+
+// Named connections that .connect opens and .use switches between; the session the REPL
+// started with is "default".
+SessionTargets sessionTargets(describeCache);
+constexpr auto kDefaultTarget = std::string_view("default");
+// Set by main, which has the options every connection is made with: opens a target, its
+// password asked for if it's not given, with its schema index set up.
+std::function<std::unique_ptr<SessionTarget>(std::string name, std::string username,
+                                             std::optional<std::string> password, std::string connString)>
+        openSessionTarget;
+
+// What's typed next runs on name's session. Cached results came from the last target's
+// database, so they go, and a started cache starts again on the new one.
+void useSessionTarget(std::string_view name) {
+    if (sessionTargets.find(name) == nullptr) {
+        throw std::runtime_error(fmt::format("no connection named {}; .connect {} <connect string> first",
+                                             name, name));
+    }
+    if (commitPolicy.hasPending()) {
+        throw std::runtime_error("there are uncommitted changes on this connection; commit or roll back first");
+    }
+    const bool caching = resultCache.isStarted();
+    resultCache.stop();
+    resultCache.clear();
+    auto& target = sessionTargets.use(name);
+    if (caching && target.session->shardingKey().empty()) {
+        resultCache.start([session = target.session] { return session->newConnection(true); });
+    } else if (caching) {
+        std::cout << "Result cache is off while a sharding key is set" << std::endl;
+    }
+}
+
+class ConnectCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".connect");
+    constexpr static auto kUsage = std::string_view(
+            "usage: .connect <name> [<username>[/<password>]@]<connect string>");
+    ConnectCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .connect <name> [<username>[/<password>]@]<connect string> logs in to another
+    // database, as the REPL's own username unless one's given, keeps the session and its
+    // pool open under name, and switches to it. The one the REPL started with is default.
+    bool run(Session&, std::string_view cmdLine) override {
+        if (!openSessionTarget) {
+            throw std::runtime_error(".connect only works in the REPL");
+        }
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        const auto nameEnd = std::min(cmdLine.find(' '), cmdLine.size());
+        const auto targetName = std::string(cmdLine.substr(0, nameEnd));
+        auto target = cmdLine.substr(nameEnd);
+        target.remove_prefix(std::min(target.find_first_not_of(' '), target.size()));
+        while (!target.empty() && target.back() == ' ') {
+            target.remove_suffix(1);
+        }
+        if (targetName.empty() || target.empty() || target.find(' ') != std::string_view::npos) {
+            throw std::runtime_error(std::string(kUsage));
+        }
+        if (sessionTargets.find(targetName) != nullptr) {
+            throw std::runtime_error(fmt::format("there's already a connection named {}; .use {} to switch to it",
+                                                 targetName, targetName));
+        }
+        if (commitPolicy.hasPending()) {
+            throw std::runtime_error("there are uncommitted changes on this connection; commit or roll back first");
+        }
+
+        std::string username = sessionTargets.find(kDefaultTarget)->username;
+        std::optional<std::string> password;
+        if (const auto at = target.rfind('@'); at != std::string_view::npos) {
+            const auto login = target.substr(0, at);
+            const auto slash = login.find('/');
+            username = std::string(login.substr(0, slash));
+            if (slash != std::string_view::npos) {
+                password = std::string(login.substr(slash + 1));
+            }
+            target.remove_prefix(at + 1);
+        }
+        if (target.empty()) {
+            throw std::runtime_error(std::string(kUsage));
+        }
+        auto opened = openSessionTarget(targetName, username, std::move(password), std::string(target));
+        // Logged in now, so a bad password or connect string fails here rather than when the
+        // target is first used, and switching to it doesn't wait.
+        opened->session->connection();
+        sessionTargets.add(std::move(opened));
+        useSessionTarget(targetName);
+        std::cout << fmt::format("Connected to {} as {}; .use {} to switch back", target, targetName,
+                                 kDefaultTarget) << std::endl;
+        return true;
+    }
+} connectCmd;
+
+class UseCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".use");
+    UseCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .use <name> switches to a connection opened with .connect, or back to default; .use
+    // on its own lists them, the one in use marked *.
+    bool run(Session&, std::string_view cmdLine) override {
+        cmdLine.remove_prefix(std::min(cmdLine.find_first_not_of(' '), cmdLine.size()));
+        while (!cmdLine.empty() && cmdLine.back() == ' ') {
+            cmdLine.remove_suffix(1);
+        }
+        if (cmdLine.empty()) {
+            for (const auto& target : sessionTargets.targets()) {
+                std::cout << fmt::format("{} {} {}@{}", target.get() == sessionTargets.current() ? '*' : ' ',
+                                         target->name, target->username, target->connString) << std::endl;
+            }
+            return true;
+        }
+        useSessionTarget(cmdLine);
+        return true;
+    }
+} useCmd;
+
+// After an error that lost a session somewhere other than a statement's execute, e.g. part
+// way through a fetch: the standby session is let go, since it may be the one, and the
+// primary replaced if a ping shows it's gone too.
+void recoverLostSession(Session& session) {
+    session.dropStandbyConnection();
+    try {
+        session.connection().ping();
+        return;
+    } catch (const OracleException& e) {
+        if (!e.isSessionLost()) {
+            throw;
+        }
+    }
+    const bool lostChanges = commitPolicy.hasPending();
+    session.replaceLostConnection();
+    commitPolicy.ended();
+    std::cerr << "The session was lost and has been replaced"
+              << (lostChanges ? "; its uncommitted changes were rolled back" : "") << std::endl;
+}
+
+// Runs one complete line of input, either a dot-command or a SQL statement. Returns false
+// when the REPL should exit. fullLine is only copied when it's added to the history or
+// kept for .more.
+bool dispatchLine(Session& session, std::string_view fullLine, bool addToHistory = true) {
+    TraceSpan span("statement");
+    const auto& commandMap = getCommandMap();
+    if (auto cmdIt = commandMap.longest_prefix_ks(fullLine.data(), fullLine.size()); cmdIt != commandMap.end()) {
+        auto commandName = cmdIt.value()->name();
+        size_t prefixEnd = 0;
+        auto checkPrefix = [&] {
+            if (prefixEnd == fullLine.size() || prefixEnd == commandName.size()) {
+                return false;
+            }
+            return fullLine.at(prefixEnd) == commandName.at(prefixEnd);
+        };
+
+        for (; checkPrefix(); ++prefixEnd);
+        if (prefixEnd < fullLine.size()) {
+            auto afterSpaces = fullLine.substr(prefixEnd).find_first_not_of(" ");
+            if (afterSpaces != std::string_view::npos) {
+                prefixEnd += afterSpaces;
+            }
+        }
+
+        // Commands like .set work before the connection is up, so don't wait for it here.
+        if (session.isReady()) {
+            applyCallTimeout(session);
+        }
+        return cmdIt.value()->run(session, fullLine.substr(prefixEnd));
+    }
+
+    applyCallTimeout(session);
+    if (!statementAction.empty()) {
+        session.connection().setAction(statementAction);
+    }
+
+    // Exports always go to the server: the cache only holds what the table shows.
+    std::string cacheKey;
+    if (resultCache.isStarted() && !resultOutput) {
+        cacheKey = ResultCache::cacheKey(fullLine);
+        if (auto cached = cacheKey.empty() ? nullptr : resultCache.find(cacheKey)) {
+            if (addToHistory) {
+                addHistoryEntry(fullLine);
+            }
+            moreRowsCmd.takeActiveStatement();
+            printCachedResult(*cached);
+            return true;
+        }
+    }
+
+    std::optional<SessionStats> statsBefore;
+    // Where the statement ended up; see routesToStandby().
+    bool onStandby = false;
+    lastCursor.reset();
+    if (autotraceOverhead) {
+        statsBefore = SessionStats::snapshot(session);
+    }
+    auto printAutotrace = [&] {
+        // The statistics are the primary session's, which a query on the standby doesn't move.
+        if (statsBefore && !onStandby) {
+            lastCursor = previousCursor(session);
+            printSessionStats(std::cout, SessionStats::snapshot(session).since(*statsBefore, *autotraceOverhead));
+        }
+    };
+
+    using Phase = StatementTiming::Phase;
+    statementTiming.reset();
+    bool scrollable = false;
+    // Exports read every row, so they're never previewed.
+    const bool preview = previewSetting.get() != 0 && !resultOutput;
+    auto prepare = [&] {
+        std::optional<std::string> previewSql;
+        if (preview) {
+            previewSql = withFirstRowsHint(fullLine, kPageRows + 1);
+        }
+        std::string_view sql = previewSql ? std::string_view(*previewSql) : fullLine;
+        std::optional<std::string> cachedSql;
+        if (resultCacheHintSetting.get() != 0) {
+            cachedSql = withResultCacheHint(sql);
+            if (cachedSql) {
+                sql = *cachedSql;
+            }
+        }
+        auto stmt = session.prepareStatement(sql);
+        // Exports read every row once, so there's nothing to gain from a scrollable cursor.
+        scrollable = scrollableSetting.get() != 0 && !resultOutput && stmt.isQuery();
+        // The statement type comes from the client's parse, so preparing on the primary to
+        // find out costs no round trip.
+        onStandby = routesToStandby(session, stmt.info(), sql);
+        if (onStandby) {
+            stmt = session.prepareStandbyStatement(sql, scrollable);
+        } else if (scrollable) {
+            stmt = session.prepareScrollableStatement(sql);
+        }
+        // Rebound every time: a cached statement keeps its binds, but the variable may
+        // have been redeclared or the session replaced since.
+        bindVariables.bindInto(onStandby ? session.standbyConnection() : session.connection(), stmt);
+        if (onStandby) {
+            auto& standby = session.standbyConnection();
+            standby.setCallTimeout(callTimeoutSetting.get());
+            if (!statementAction.empty()) {
+                standby.setAction(statementAction);
+            }
+        }
+        if (stmt.isQuery()) {
+            applyFetchSettings(stmt);
+            // What's prepared here is executed once.
+            if (hasResultCacheHint(sql)) {
+                clientCounters.add(ClientCounter::ResultCacheExecutes);
+            }
+            if (preview) {
+                // .more puts the configured array size back for the pages after this one.
+                stmt.setAdaptiveFetch(0);
+                stmt.setPrefetchRows(kPageRows + 1);
+                stmt.setFetchArraySize(kPageRows + 1);
+            }
+        }
+        return stmt;
+    };
+    const auto captureStart = std::chrono::steady_clock::now();
+    const auto rowsFetchedBefore = clientCounters.value(ClientCounter::RowsFetched);
+    const auto blockFetchesBefore = clientCounters.value(ClientCounter::BlockFetches);
+    auto activeStatement = statementTiming.measure(Phase::Prepare, prepare);
+    // Taken before the execute, which can change them through out binds.
+    std::vector<CapturedBind> capturedBinds;
+    if (workloadCapture) {
+        const auto names = activeStatement.bindNames();
+        if (!names.empty()) {
+            for (auto& declared : bindVariables.list(names)) {
+                capturedBinds.push_back(CapturedBind{std::move(declared.name), std::move(declared.value)});
+            }
+        }
+    }
+    // The statement type is known from the prepare, so only queries get fetch settings and
+    // go on to be fetched; anything else is done once it's executed.
+    const auto info = activeStatement.info();
+    const bool isChange = info.isDML || info.isPLSQL;
+    const auto execMode = isChange ? commitPolicy.modeFor(commitLimits(), 1) : DPI_MODE_EXEC_DEFAULT;
+    uint64_t cacheQueryId = 0;
+    if (info.isQuery) {
+        cacheQueryId = cacheKey.empty() ? 0 : resultCache.registerQuery(cacheKey, fullLine);
+    }
+    std::optional<MonitoredStatement> monitored;
+    if (!onStandby) {
+        monitored.emplace(session);
+    }
+    auto execute = [&] {
+        statementTiming.measure(Phase::Execute, [&] {
+            WaitMonitor::Blocked blocked(waitMonitor.get());
+            ProgressMonitor::Active progress(progressMonitor.get());
+            activeStatement.execute(execMode);
+        });
+    };
+    try {
+        execute();
+    } catch (const OracleException& e) {
+        if (!e.isSessionLost()) {
+            throw;
+        }
+        // A failed RAC instance fails the statement right away in events mode; the session
+        // is replaced from the pool, whose sessions there FAN has dropped. Only a query is
+        // run again: it's idempotent, where a change may or may not have been made, and it
+        // would no longer see what the lost session hadn't committed.
+        const bool lostChanges = !onStandby && commitPolicy.hasPending();
+        if (onStandby) {
+            session.dropStandbyConnection();
+        } else {
+            session.replaceLostConnection();
+            commitPolicy.ended();
+        }
+        if (!info.isQuery || lostChanges) {
+            throw std::runtime_error(fmt::format("{}\nThe session was lost and has been replaced; {}", e.what(),
+                    lostChanges ? "its uncommitted changes were rolled back" : "the statement wasn't run again"));
+        }
+        std::cerr << "Session lost (" << e.what() << "); running the query again on a new one" << std::endl;
+        activeStatement = statementTiming.measure(Phase::Prepare, prepare);
+        execute();
+    }
+    lastSqlId = activeStatement.sqlId();
+    // Round trips are the execute's and a block fetch's each, which overcounts blocks
+    // split from one round trip's rows but is close for anything that fetches much.
+    auto recordTopSql = [&](uint64_t rows) {
+        const auto fetched = clientCounters.value(ClientCounter::RowsFetched) - rowsFetchedBefore;
+        const auto blocks = clientCounters.value(ClientCounter::BlockFetches) - blockFetchesBefore;
+        topSql.record(fullLine, statementTiming.total(), info.isQuery ? fetched : rows, 1 + blocks);
+    };
+    if (workloadCapture) {
+        workloadCapture->record(fullLine, capturedBinds, captureStart, std::chrono::steady_clock::now() - captureStart);
+    }
+    if (addToHistory) {
+        addHistoryEntry(fullLine);
+    }
+    if (isChange) {
+        commitPolicy.executed(execMode, 1, info.isDML ? activeStatement.rowCount() : 0);
+    } else if (info.isDDL || info.statementType == DPI_STMT_TYPE_COMMIT ||
+               info.statementType == DPI_STMT_TYPE_ROLLBACK) {
+        commitPolicy.ended();
+    }
+    if (!info.isQuery) {
+        // Our own changes are visible to us before they're committed, and notifications
+        // only come for committed ones.
+        resultCache.clear();
+        if (info.isDML) {
+            const auto rows = activeStatement.rowCount();
+            std::cout << rows << (rows == 1 ? " row" : " rows") << " affected" << std::endl;
+        } else {
+            std::cout << "Statement executed" << std::endl;
+        }
+        if (info.isPLSQL) {
+            printImplicitResults(activeStatement);
+        }
+        recordTopSql(info.isDML ? activeStatement.rowCount() : 0);
+        printTiming();
+        if (monitored) {
+            monitored->printSummary();
+        }
+        printAutotrace();
+        return true;
+    }
+    if (resultOutput && activeStatement.numColumns() > 0) {
+        // Exports take every row in one go; there's nothing left for .more.
+        std::cout.flush();
+        // Writers fetch and write block by block, so all of it is counted as rendering.
+        auto numRows = statementTiming.measure(Phase::Render, [&] {
+            WaitMonitor::Blocked blocked(waitMonitor.get());
+            ProgressMonitor::Active progress(progressMonitor.get());
+            return writeResults(activeStatement, *resultOutput, resultOutputFormat);
+        });
+        if (!spoolPath.empty()) {
+            std::cout << "Spooled " << numRows << " rows to " << spoolPath << std::endl;
+        }
+        closeIfFetchLimited(activeStatement);
+        noteDefineBuffers(activeStatement);
+        recordTopSql(0);
+        printTiming();
+        if (monitored) {
+            monitored->printSummary();
+        }
+        printAutotrace();
+        return true;
+    }
+    if (bufferRowsSetting.get() > 0) {
+        // The whole result stays on the client for .sort, .filter and .top; there's
+        // nothing left for .more.
+        if (cacheQueryId != 0) {
+            resultCache.abandon(cacheQueryId);
+        }
+        moreRowsCmd.clearActive();
+        bufferedResult = statementTiming.measure(Phase::Fetch, [&] {
+            return ColumnarResult::fetch(activeStatement, bufferRowsSetting.get());
+        });
+        statementTiming.measure(Phase::Render, [&] { printBufferedResult(*bufferedResult); });
+        activeStatement.close();
+        noteDefineBuffers(activeStatement);
+        recordTopSql(0);
+        printTiming();
+        if (monitored) {
+            monitored->printSummary();
+        }
+        printAutotrace();
+        return true;
+    }
+    bool moreRows = false;
+    auto pages = std::make_shared<PagedTable>(activeStatement.numColumns());
+    if (cacheQueryId != 0) {
+        CachedResult capture(activeStatement.metadata()->names());
+        moreRows = fetchAndPrintResults(activeStatement, kPageRows, &capture, pages.get());
+        // Only whole results are cached: a hit has no cursor for .more to carry on with.
+        if (moreRows || activeStatement.fetchLimitReached()) {
+            resultCache.abandon(cacheQueryId);
+        } else {
+            resultCache.setBudget(size_t{cacheMbSetting.get()} * 1024 * 1024);
+            resultCache.insert(cacheKey, cacheQueryId, std::move(capture));
+        }
+    } else {
+        moreRows = fetchAndPrintResults(activeStatement, kPageRows, nullptr, pages.get());
+    }
+    noteDefineBuffers(activeStatement);
+    recordTopSql(0);
+    printTiming();
+    if (monitored) {
+        monitored->printSummary();
+    }
+    printAutotrace();
+    // Results that have run out are let go of straight away rather than when the next
+    // query replaces them, unless they're scrollable and so can still go back.
+    if (moreRows || (scrollable && activeStatement.isOpen())) {
+        moreRowsCmd.setActiveStatement(std::move(activeStatement), std::string(fullLine), scrollable, 1,
+                std::move(pages));
+    } else {
+        moreRowsCmd.clearActive();
+    }
+    return true;
+}
+
+// Most rows a script's consecutive literal inserts are coalesced into per executeMany; 0 or
+// 1 runs every insert on its own.
+UInt32Setting scriptBatchSetting("scriptbatch", 1000);
+// Non-zero also lifts the literals out of a script's UPDATE and DELETE statements, and keeps
+// up to this many statement texts batching at once rather than just the latest, so
+// interleaved statements still batch. Each batch runs when it fills, or when a statement
+// that can't be batched comes along, in the order the texts first appeared; that reorders
+// statements of different texts, so it's only for scripts whose statements don't depend on
+// each other, like generated loads.
+UInt32Setting parameterizeSetting("parameterize", 0);
+
+// Most sessions a script's -- @parallel block runs its statements on at once.
+UInt32Setting parallelSetting("parallel", 4);
+
+// Failed statements across every script run so far, for --file's exit status.
+uint64_t scriptFailures = 0;
+constexpr uint32_t kMaxScriptDepth = 20;
+
+// Like sqlplus, @name means name.sql when name has no extension.
+std::string scriptPath(std::string_view name) {
+    std::string path(name);
+    auto slash = path.rfind('/');
+    if (path.find('.', slash == std::string::npos ? 0 : slash + 1) == std::string::npos) {
+        path.append(".sql");
+    }
+    return path;
+}
+
+// <file>:<line> for the session's action, which the server caps at 64 bytes.
+std::string scriptAction(std::string_view path, uint64_t line) {
+    constexpr size_t kMaxActionSize = 64;
+    auto slash = path.rfind('/');
+    auto action = fmt::format("{}:{}", path.substr(slash == std::string_view::npos ? 0 : slash + 1), line);
+    if (action.size() > kMaxActionSize) {
+        action.erase(0, action.size() - kMaxActionSize);
+    }
+    return action;
+}
+
+// Runs the statements and commands of the script at path in order. Failures are reported
+// against their line and the script carries on, as sqlplus does by default. Consecutive
+// inserts of literal values into the same table go to the server as array-bound batches.
+// Returns false when the script runs a command that exits.
+bool runScript(Session& session, const std::string& path) {
+    if (scriptDepth >= kMaxScriptDepth) {
+        throw std::runtime_error(fmt::format("scripts are nested more than {} deep", kMaxScriptDepth));
+    }
+    // Statements are prepared straight from views into the mapping, so even a script of
+    // hundreds of MB is never copied; the kernel reads it ahead as it's split.
+    MappedFile script(path);
+    script.adviseSequential();
+    ++scriptDepth;
+    auto outerAction = statementAction;
+    struct Restore {
+        std::string& action;
+        std::string outer;
+        ~Restore() {
+            --scriptDepth;
+            action = std::move(outer);
+        }
+    } restore{statementAction, std::move(outerAction)};
+
+    auto reportError = [&path](uint64_t line, std::string_view message) {
+        ++scriptFailures;
+        std::cerr << fmt::format("{}:{}: Error {}", path, line, message) << std::endl;
+    };
+    auto reportException = [&](uint64_t line) {
+        try {
+            throw;
+        } catch(const OracleException& e) {
+            if (session.hasFailed()) {
+                throw;
+            }
+            reportError(line, fmt::format("{}: {}", e.context(), e.what()));
+        } catch(const std::exception& e) {
+            reportError(line, e.what());
+        }
+    };
+
+    const auto batchRows = scriptBatchSetting.get();
+    const auto parameterize = parameterizeSetting.get();
+    const size_t maxBatches = std::max<uint32_t>(parameterize, 1);
+    // In the order their texts first appeared.
+    std::vector<InsertBatcher> batchers;
+    auto flushBatcher = [&](InsertBatcher& batcher) {
+        if (batcher.empty()) {
+            return;
+        }
+        const auto firstLine = batcher.firstLine();
+        try {
+            session.connection().setAction(scriptAction(path, firstLine));
+            const auto statements = batcher.numRows();
+            const auto mode = commitPolicy.modeFor(commitLimits(), statements);
+            auto result = batcher.flush(session, mode);
+            commitPolicy.executed(mode, statements, result.rowsAffected);
+            resultCache.clear();
+            for (const auto& error : result.errors) {
+                reportError(error.line, error.message);
+            }
+            using Kind = ParameterizedStatement::Kind;
+            const auto verb = result.kind == Kind::Insert ? "inserted" : result.kind == Kind::Update ? "updated" : "deleted";
+            std::cout << result.rowsAffected << (result.rowsAffected == 1 ? " row " : " rows ") << verb
+                      << " by " << result.statements << " batched statements" << std::endl;
+        } catch(...) {
+            reportException(firstLine);
+        }
+    };
+    auto flush = [&] {
+        for (auto& batcher : batchers) {
+            flushBatcher(batcher);
+        }
+        batchers.clear();
+    };
+
+    // Statements between -- @parallel begin and -- @parallel end are collected, then run
+    // together on their own sessions when the block ends. A block can instead group them
+    // into steps with -- @step <name> [depends_on <step>[,<step>...]], which run as their
+    // dependencies allow.
+    uint64_t parallelLine = 0;
+    std::vector<ParallelStatement> parallel;
+    std::vector<uint64_t> parallelLines;
+    std::vector<ParallelStep> steps;
+    // The line of each step's directive, then of each of its statements.
+    std::vector<std::vector<uint64_t>> stepLines;
+    auto runStepBlock = [&](uint64_t blockLine, const std::vector<ParallelStep>& blockSteps,
+                            const std::vector<std::vector<uint64_t>>& blockStepLines) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto outcomes = runSteps([&session] { return session.newConnection(); }, blockSteps,
+                                       parallelSetting.get());
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        size_t succeeded = 0;
+        for (size_t idx = 0; idx < outcomes.size(); ++idx) {
+            const auto& outcome = outcomes[idx];
+            const auto& lines = blockStepLines[idx];
+            if (outcome.skipped) {
+                reportError(lines[0], fmt::format("step {}: {}", blockSteps[idx].name, outcome.message));
+                continue;
+            }
+            for (size_t stmtIdx = 0; stmtIdx < outcome.statements.size(); ++stmtIdx) {
+                const auto& statement = outcome.statements[stmtIdx];
+                if (statement.failed) {
+                    reportError(lines[stmtIdx + 1], statement.message);
+                }
+            }
+            if (!outcome.failed) {
+                ++succeeded;
+                std::cout << fmt::format("{}:{}: step {}: {} statements in {:.3f}s", path, lines[0], blockSteps[idx].name,
+                                         outcome.statements.size(), outcome.seconds) << std::endl;
+            }
+        }
+        std::cout << fmt::format("Parallel block at line {} ran {} of {} steps in {:.3f}s", blockLine, succeeded,
+                                 blockSteps.size(), elapsed.count()) << std::endl;
+    };
+    auto runParallelBlock = [&] {
+        if (!steps.empty()) {
+            // Taken first, so a block that can't be scheduled isn't left behind.
+            runStepBlock(std::exchange(parallelLine, 0), std::exchange(steps, {}), std::exchange(stepLines, {}));
+            return;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        auto outcomes = runParallel([&session] { return session.newConnection(); }, parallel,
+                                    parallelSetting.get());
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        for (size_t idx = 0; idx < outcomes.size(); ++idx) {
+            if (outcomes[idx].failed) {
+                reportError(parallelLines[idx], outcomes[idx].message);
+            } else {
+                std::cout << fmt::format("{}:{}: {} ({:.3f}s)", path, parallelLines[idx],
+                                         outcomes[idx].message, outcomes[idx].seconds) << std::endl;
+            }
+        }
+        std::cout << fmt::format("Parallel block at line {} ran {} statements in {:.3f}s", parallelLine,
+                                 parallel.size(), elapsed.count()) << std::endl;
+        parallel.clear();
+        parallelLines.clear();
+        parallelLine = 0;
+    };
+    auto runDirective = [&](const SqlStatement& directive) {
+        std::vector<std::string_view> words;
+        for (auto text = directive.text; !text.empty();) {
+            const auto wordEnd = std::min(text.find_first_of(" \t"), text.size());
+            words.push_back(text.substr(0, wordEnd));
+            const auto next = text.find_first_not_of(" \t", wordEnd);
+            text = text.substr(next == std::string_view::npos ? text.size() : next);
+        }
+        const bool isParallel = words.size() == 2 && words[0] == "@parallel";
+        if (isParallel && words[1] == "begin") {
+            if (parallelLine != 0) {
+                throw std::runtime_error(fmt::format("the parallel block at line {} isn't ended yet", parallelLine));
+            }
+            parallelLine = directive.line;
+        } else if (isParallel && words[1] == "end") {
+            if (parallelLine == 0) {
+                throw std::runtime_error("no parallel block to end");
+            }
+            runParallelBlock();
+        } else if (words[0] == "@step") {
+            if (parallelLine == 0) {
+                throw std::runtime_error("steps go in a parallel block");
+            }
+            if (!parallel.empty()) {
+                parallel.clear();
+                parallelLines.clear();
+                throw std::runtime_error("a parallel block with steps has every statement in a step; "
+                                         "the statements before this one won't run");
+            }
+            if (words.size() < 2 || (words.size() > 2 && words[2] != "depends_on") || words.size() == 3) {
+                throw std::runtime_error("usage: -- @step <name> [depends_on <step>[,<step>...]]");
+            }
+            ParallelStep step;
+            step.name = std::string(words[1]);
+            for (size_t idx = 3; idx < words.size(); ++idx) {
+                for (auto list = words[idx]; !list.empty();) {
+                    const auto comma = std::min(list.find(','), list.size());
+                    if (comma > 0) {
+                        step.dependsOn.emplace_back(list.substr(0, comma));
+                    }
+                    list.remove_prefix(std::min(comma + 1, list.size()));
+                }
+            }
+            steps.push_back(std::move(step));
+            stepLines.push_back({directive.line});
+        } else {
+            throw std::runtime_error(fmt::format("unknown directive {}", directive.text));
+        }
+    };
+
+    SqlSplitter splitter(script.contents());
+    SqlStatement stmt;
+    bool keepRunning = true;
+    while (keepRunning && splitter.next(stmt)) {
+        if (stmt.isDirective) {
+            flush();
+            try {
+                runDirective(stmt);
+            } catch(...) {
+                reportException(stmt.line);
+            }
+            continue;
+        }
+        if (parallelLine != 0) {
+            if (stmt.isCommand) {
+                reportError(stmt.line, "commands can't run inside a parallel block");
+            } else if (!steps.empty()) {
+                steps.back().statements.push_back({stmt.text, scriptAction(path, stmt.line)});
+                stepLines.back().push_back(stmt.line);
+            } else {
+                parallel.push_back({stmt.text, scriptAction(path, stmt.line)});
+                parallelLines.push_back(stmt.line);
+            }
+            continue;
+        }
+        if (batchRows > 1 && !stmt.isCommand) {
+            auto parameterized = parameterize > 0 ? parameterizeDml(stmt.text) : parameterizeInsert(stmt.text);
+            if (parameterized) {
+                auto batcher = std::find_if(batchers.begin(), batchers.end(), [&](const InsertBatcher& pending) {
+                    return pending.sql() == parameterized->sql;
+                });
+                // A full batch runs along with everything before it, so the texts still run
+                // in the order they first appeared.
+                if (batcher != batchers.end() && !batcher->accepts(*parameterized)) {
+                    flush();
+                    batcher = batchers.end();
+                }
+                if (batcher == batchers.end()) {
+                    if (batchers.size() == maxBatches) {
+                        flush();
+                    }
+                    batcher = batchers.emplace(batchers.end(), batchRows);
+                }
+                batcher->add(std::move(*parameterized), stmt.line);
+                continue;
+            }
+        }
+        flush();
+        statementAction = scriptAction(path, stmt.line);
+        try {
+            keepRunning = dispatchLine(session, stmt.text, false);
+        } catch(...) {
+            reportException(stmt.line);
+        }
+    }
+    flush();
+    if (parallelLine != 0) {
+        reportError(parallelLine, "parallel block isn't ended; running it at the end of the script");
+        try {
+            runParallelBlock();
+        } catch(...) {
+            reportException(parallelLine);
+        }
+    }
+    // A script with a commit policy leaves nothing uncommitted behind it, though when it
+    // was run from another script that one's policy gets to decide.
+    const auto limits = commitLimits();
+    if (scriptDepth == 1 && (limits.statements != 0 || limits.rows != 0) && commitPolicy.hasPending()) {
+        try {
+            session.connection().commit();
+            commitPolicy.ended();
+        } catch(...) {
+            reportException(stmt.line);
+        }
+    }
+    return keepRunning;
+}
+
+// A script attached to the broker with --attach, run on a connection of its own from the
+// broker's pool with its results written to the caller's stdout in format, as proxyUser
+// through the broker's login if it's given. Statements run as they do in --file scripts, carrying on past errors;
+// client commands need the REPL's state and aren't run.
+int runBrokeredScript(Session& session, std::optional<std::string_view> proxyUser, std::string_view script, std::string_view format,
+                      int outFd, int errFd) {
+    BufferedFdWriter out(outFd);
+    BufferedFdWriter err(errFd);
+    auto reportError = [&err](uint64_t line, std::string_view message) {
+        err.append(fmt::format("<attach>:{}: Error {}\n", line, message));
+        err.flush();
+    };
+    ResultFormat resultFormat = ResultFormat::Csv;
+    if (format == "tsv") {
+        resultFormat = ResultFormat::Tsv;
+    } else if (format == "ndjson") {
+        resultFormat = ResultFormat::Ndjson;
+    } else if (format != "csv") {
+        reportError(0, "the broker writes csv, tsv or ndjson");
+        return 2;
+    }
+    if (proxyUser && proxyUser->empty()) {
+        reportError(0, "there's no login name for your user id to connect as");
+        return 1;
+    }
+
+    uint64_t failures = 0;
+    try {
+        auto conn = proxyUser ? session.newConnectionAs(*proxyUser) : session.newConnection();
+        SqlSplitter splitter(script);
+        SqlStatement stmt;
+        while (splitter.next(stmt)) {
+            if (stmt.isDirective) {
+                continue;
+            }
+            try {
+                if (stmt.isCommand) {
+                    throw std::runtime_error("client commands don't run through the broker");
+                }
+                auto prepared = conn.prepareStatement(stmt.text);
+                applyFetchSettings(prepared);
+                prepared.execute();
+                if (prepared.isQuery()) {
+                    writeResults(prepared, out, resultFormat);
+                } else if (prepared.info().isDML) {
+                    const auto rows = prepared.rowCount();
+                    out.append(fmt::format("{} {} affected\n", rows, rows == 1 ? "row" : "rows"));
+                } else {
+                    out.append("Statement executed\n");
+                }
+            } catch (const OracleException& e) {
+                ++failures;
+                reportError(stmt.line, fmt::format("{}: {}", e.context(), e.what()));
+            } catch (const std::exception& e) {
+                ++failures;
+                reportError(stmt.line, e.what());
+            }
+        }
+        out.flush();
+    } catch (const std::exception& e) {
+        // No connection to be had, or the caller's stdout has gone.
+        try {
+            reportError(0, e.what());
+        } catch (const std::exception&) {
+        }
+        return 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+// An argument without the spaces and semicolons around it.
+std::string_view trimmedArgument(std::string_view arg) {
+    arg.remove_prefix(std::min(arg.find_first_not_of(" \t\r\n"), arg.size()));
+    return arg.substr(0, arg.find_last_not_of(" \t\r\n;") + 1);
+}
+
+class CountCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".count");
+    CountCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .count <query> runs SELECT COUNT(*) over the query, so finding out how many rows it
+    // has doesn't bring any of them over.
+    bool run(Session& session, std::string_view cmdLine) override {
+        const auto query = trimmedArgument(cmdLine);
+        if (query.empty()) {
+            throw std::runtime_error("usage: .count <query>");
+        }
+        // On its own line, so a -- comment at the end of the query can't swallow the ).
+        return dispatchLine(session, fmt::format("SELECT COUNT(*) FROM (\n{}\n)", query), false);
+    }
+} countCmd;
+
+class SampleCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view(".sample");
+    SampleCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    // .sample <percent> <table> shows about that percentage of the table's rows, picked
+    // at random by the server with SAMPLE, for a look at what's in a table too big to page
+    // through.
+    bool run(Session& session, std::string_view cmdLine) override {
+        constexpr auto kUsage = "usage: .sample <percent> <table>";
+        cmdLine = trimmedArgument(cmdLine);
+        const auto percentEnd = std::min(cmdLine.find(' '), cmdLine.size());
+        const std::string percentText(cmdLine.substr(0, percentEnd));
+        const auto table = trimmedArgument(cmdLine.substr(percentEnd));
+        char* end = nullptr;
+        const auto percent = std::strtod(percentText.c_str(), &end);
+        if (percentText.empty() || end != percentText.c_str() + percentText.size() || table.empty()
+                || table.find_first_of(" \t(),;") != std::string_view::npos) {
+            throw std::runtime_error(kUsage);
+        }
+        // The range SAMPLE takes; 100 would be the whole table.
+        if (!(percent >= 0.000001 && percent < 100)) {
+            throw std::runtime_error("the percentage has to be at least 0.000001 and below 100");
+        }
+        return dispatchLine(session, fmt::format("SELECT * FROM {} SAMPLE ({})", table, percentText), false);
+    }
+} sampleCmd;
+
+class ScriptCommand : public Command {
+public:
+    constexpr static auto kName = std::string_view("@");
+    ScriptCommand() : Command(kName) {}
+
+    std::string_view name() const noexcept override {
+        return kName;
+    }
+
+    bool run(Session& session, std::string_view cmdLine) override {
+        cmdLine = cmdLine.substr(0, cmdLine.find_last_not_of(' ') + 1);
+        if (cmdLine.empty()) {
+            throw std::runtime_error("usage: @<script>[.sql]");
+        }
+        return runScript(session, scriptPath(cmdLine));
+    }
+} scriptCmd;
+
+// Runs -e's text as piped input would be, its last statement needing no terminator.
+// Returns the exit status: 1 if anything in it failed.
+int runOneShot(Session& session, std::string_view text) {
+    int exitCode = 0;
+    SqlSplitter splitter(text);
+    SqlStatement stmt;
+    while (splitter.next(stmt)) {
+        if (stmt.isDirective) {
+            continue;
+        }
+        try {
+            if (!dispatchLine(session, stmt.text)) {
+                break;
+            }
+        } catch(const OracleException& e) {
+            if (session.hasFailed()) {
+                // The connect error is reported on the way out.
+                return 1;
+            }
+            std::cerr << "Error " << e.context() << ": " << e.what() << std::endl;
+            exitCode = 1;
+        } catch(const std::exception& e) {
+            if (session.hasFailed()) {
+                return 1;
+            }
+            std::cerr << "Error: " << e.what() << std::endl;
+            exitCode = 1;
+        }
+    }
+    return exitCode;
+}
+
+// Claims and exports chunks of the job a .export --queue planned, alongside the workers
+// on other hosts, until there are none left. Returns the exit status: 1 if one failed,
+// whose chunk goes back to the queue.
+int runQueuedExport(Session& session, const std::string& job) {
+    try {
+        auto& coordination = session.connection();
+        auto data = session.newConnection();
+        ExportWorkerOptions opts;
+        char host[256] = {};
+        ::gethostname(host, sizeof(host) - 1);
+        opts.worker = fmt::format("{}:{}", host, ::getpid());
+        opts.optionsFor = [](std::string_view format, const std::string& path) {
+            auto exportOpts = exportOptions(format, path);
+            exportOpts.setUpStatement = [](OracleStatement& stmt) { applyFetchSettings(stmt); };
+            return exportOpts;
+        };
+        opts.onShardDone = [](const ExportShard& shard) {
+            std::cout << fmt::format("  {}: {} rows in {:.2f}s", shard.path, shard.rows, shard.seconds) << std::endl;
+            clientCounters.add(ClientCounter::RowsRendered, shard.rows);
+        };
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto shards = runExportWorker(coordination, data, job, opts);
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint64_t numRows = 0;
+        for (const auto& shard : shards) {
+            numRows += shard.rows;
+        }
+        std::cout << fmt::format("Exported {} rows to {} files of job {} in {:.2f}s as {}", numRows, shards.size(),
+                                 job, elapsed, opts.worker) << std::endl;
+        return 0;
+    } catch(const OracleException& e) {
+        if (session.hasFailed()) {
+            // The connect error is reported on the way out.
+            return 1;
+        }
+        std::cerr << "Error " << e.context() << ": " << e.what() << std::endl;
+    } catch(const std::exception& e) {
+        if (session.hasFailed()) {
+            return 1;
+        }
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+    return 1;
+}
+
+// Has the server check path's statements, on parallelism sessions at once, without running
+// any of them, and lists the errors by line. Returns the exit status: 1 if there were any.
+int runScriptCheck(Session& session, const std::string& path, uint32_t parallelism) {
+    try {
+        MappedFile script(path);
+        const auto start = std::chrono::steady_clock::now();
+        const auto result = checkScript([&session] { return session.newConnection(); }, script.contents(),
+                                        parallelism);
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (const auto& error : result.errors) {
+            std::cout << fmt::format("{}:{}: {}", path, error.line, error.message) << std::endl;
+        }
+        std::cout << fmt::format("Checked {} statements of {} in {:.2f}s: {} {}, {} not checked (DDL, transaction "
+                                 "control and client commands)", result.checked, path, elapsed, result.errors.size(),
+                                 result.errors.size() == 1 ? "error" : "errors", result.skipped) << std::endl;
+        return result.errors.empty() ? 0 : 1;
+    } catch(const OracleException& e) {
+        if (session.hasFailed()) {
+            // The connect error is reported on the way out.
+            return 1;
+        }
+        std::cerr << "Error " << e.context() << ": " << e.what() << std::endl;
+    } catch(const std::exception& e) {
+        if (session.hasFailed()) {
+            return 1;
+        }
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+    return 1;
+}
+
+// History, hints and Tab completion for the REPL's prompt.
+void setUpLineEditing(const std::string& historyPath, int64_t historyMaxSize) {
+    // A paste comes in as one input, not a key and a refresh at a time.
+    linenoiseSetBracketedPaste(1);
+    linenoiseHistorySetMaxLen(static_cast<int>(historyMaxSize));
+    if (!historyPath.empty()) {
+        historyStore = std::make_unique<HistoryStore>(historyPath, static_cast<size_t>(std::max<int64_t>(historyMaxSize, 1)));
+    }
+
+    linenoiseSetCompletionCallback([](const char* strPtr, linenoiseCompletions* lc) {
+        if (!generateCompletions) {
+            return;
+        }
+
+        generateCompletions(std::string_view(strPtr), [lc](std::string_view completion) {
+            linenoiseAddCompletion(lc, completion.data());
+        });
+        // Last, so Tab cycles through to the statement the hint is showing.
+        if (historyStore) {
+            if (auto entry = historyStore->latestWithPrefix(strPtr)) {
+                linenoiseAddCompletion(lc, entry->c_str());
+            }
+        }
+    });
+    // The rest of the latest statement that starts with what's been typed, dimmed after
+    // the cursor.
+    linenoiseSetHintsCallback([](const char* strPtr, int* color, int* bold) -> char* {
+        constexpr size_t kMinHintPrefix = 2;
+        std::string_view typed(strPtr);
+        if (!historyStore || typed.size() < kMinHintPrefix) {
+            return nullptr;
+        }
+        auto entry = historyStore->latestWithPrefix(typed);
+        if (!entry) {
+            return nullptr;
+        }
+        *color = 90;
+        *bold = 0;
+        return ::strdup(entry->c_str() + typed.size());
+    });
+    linenoiseSetFreeHintsCallback(::free);
+
+    for (const auto& cmdName: getCommandMap()) {
+        completionWords.commands.insert(cmdName->name());
+    }
+}
+
+int main(int argc, const char** argv) try {
+    CliArgumentParser argParser;
+    CliArgument connStringArg(argParser, "connectionString", 'c');
+    CliArgument usernameArg(argParser, "username", 'u');
+    CliArgument passwordarg(argParser, "password", 'p');
+    CliArgument proxyUserArg(argParser, "proxyUser");
+    CliArgument historyFileArg(argParser, "historyFile");
+    CliArgument historyMaxSizeArg(argParser, "maxHistorySize");
+    CliArgument fetchArraySizeArg(argParser, "fetchArraySize");
+    CliArgument prefetchRowsArg(argParser, "prefetchRows");
+    CliArgument stmtCacheSizeArg(argParser, "stmtCacheSize");
+    CliFlag noPoolFlag(argParser, "noPool");
+    CliArgument poolMinSessionsArg(argParser, "poolMinSessions");
+    CliArgument poolMaxSessionsArg(argParser, "poolMaxSessions");
+    CliArgument poolSessionIncrementArg(argParser, "poolSessionIncrement");
+    CliArgument poolGetModeArg(argParser, "poolGetMode");
+    CliArgument poolWaitTimeoutArg(argParser, "poolWaitTimeout");
+    CliArgument poolPingIntervalArg(argParser, "poolPingInterval");
+    CliArgument poolTimeoutArg(argParser, "poolTimeout");
+    CliArgument poolMaxLifetimeArg(argParser, "poolMaxLifetime");
+    CliFlag poolHeterogeneousFlag(argParser, "poolHeterogeneous");
+    CliArgument outputFormatArg(argParser, "output-format");
+    CliArgument moduleArg(argParser, "module");
+    CliArgument actionArg(argParser, "action");
+    CliArgument clientIdentifierArg(argParser, "clientIdentifier");
+    CliArgument healthCheckIntervalArg(argParser, "healthCheckInterval");
+    CliArgument connectionClassArg(argParser, "connectionClass");
+    CliArgument standbyArg(argParser, "standby");
+    CliArgument sduArg(argParser, "sdu");
+    CliArgument expireTimeArg(argParser, "expireTime");
+    CliArgument connectTimeoutArg(argParser, "connectTimeout");
+    CliArgument transportConnectTimeoutArg(argParser, "transportConnectTimeout");
+    CliArgument retryCountArg(argParser, "retryCount");
+    CliFlag networkCompressionFlag(argParser, "networkCompression");
+    CliArgument purityArg(argParser, "purity");
+    CliArgument clientConfigDirArg(argParser, "clientConfigDir");
+    CliArgument sessionTagArg(argParser, "sessionTag");
+    CliArgument sessionFixupArg(argParser, "sessionFixup");
+    CliArgument statsJsonArg(argParser, "stats-json");
+    CliArgument traceArg(argParser, "trace");
+    CliArgument captureArg(argParser, "capture");
+    CliArgument topSqlJsonArg(argParser, "topsql-json");
+    CliArgument metricsListenArg(argParser, "metrics-listen");
+    CliArgument metricsFileArg(argParser, "metrics-file");
+    CliArgument metricsIntervalArg(argParser, "metrics-interval");
+    CliArgument coresArg(argParser, "cores");
+    CliArgument ioWorkersArg(argParser, "io-workers");
+    // Ahead of --bench, which would otherwise match it as a prefix.
+    CliArgument benchWorkloadArg(argParser, "bench-workload");
+    CliArgument benchArg(argParser, "bench");
+    CliArgument openArg(argParser, "open");
+    // Ahead of --broker, which would otherwise match it as a prefix.
+    CliFlag brokerSharedFlag(argParser, "brokerShared");
+    CliArgument brokerArg(argParser, "broker");
+    CliArgument attachArg(argParser, "attach");
+    CliArgument exportWorkerArg(argParser, "export-worker");
+    CliArgument schemaCacheArg(argParser, "schema-cache");
+    CliArgument checkArg(argParser, "check");
+    CliArgument fileArg(argParser, "file", 'f');
+    CliArgument executeArg(argParser, "execute", 'e');
+    CliFlag helpFlag(argParser, "help", 'h');
+
+    auto res = argParser.parse(argc, argv);
+
+    if (helpFlag) {
+        print_usage(res.program_name);
+        return 0;
+    }
+
+    if (coresArg) {
+        setSharedExecutorThreads(std::max<uint32_t>(uint32ArgValue(coresArg), 1));
+    }
+    if (ioWorkersArg) {
+        setSharedIoThreads(std::max<uint32_t>(uint32ArgValue(ioWorkersArg), 1));
+    }
+
+    std::string tracePath;
+    if (traceArg) {
+        tracePath = traceArg.as<std::string>();
+        traceRecorder.enable();
+        traceRecorder.nameThread("main");
+    }
+
+    if (captureArg) {
+        workloadCapture = std::make_unique<WorkloadCapture>(captureArg.as<std::string>());
+    }
+
+    if (outputFormatArg) {
+        auto format = outputFormatArg.value();
+        if (format == "csv") {
+            stdoutFormat = ResultFormat::Csv;
+        } else if (format == "tsv") {
+            stdoutFormat = ResultFormat::Tsv;
+        } else if (format == "ndjson") {
+            stdoutFormat = ResultFormat::Ndjson;
+        } else if (format != "table") {
+            throw std::runtime_error(fmt::format("invalid value \"{}\" for --output-format", format));
+        }
+        resetResultOutput();
+    } else if (executeArg || !::isatty(STDOUT_FILENO)) {
+        // Nobody's looking at a grid in a pipe or a file, nor from the script wrapping -e:
+        // rows are streamed out as TSV in big writes, skipping the table's width sampling
+        // and box drawing.
+        stdoutFormat = ResultFormat::Tsv;
+        resetResultOutput();
+    }
+
+    if (fetchArraySizeArg) {
+        fetchArraySizeSetting.set(fetchArraySizeArg.value());
+    }
+    if (prefetchRowsArg) {
+        prefetchRowsSetting.set(prefetchRowsArg.value());
+    }
+
+    // A saved result needs nothing from the server, so there's no context or login.
+    if (openArg) {
+        showColumnarResult(ColumnarResult::load(openArg.as<std::string>()));
+        return 0;
+    }
+    // The broker has the connection, so there's nothing to load or log in to here.
+    if (attachArg) {
+        std::string script;
+        if (fileArg) {
+            script = std::string(MappedFile(fileArg.as<std::string>()).contents());
+        } else {
+            script.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+        }
+        return attachToBroker(attachArg.as<std::string>(),
+                outputFormatArg ? outputFormatArg.value() : std::string_view("csv"), script);
+    }
+
+    std::string historyPath;
+    if (historyFileArg) {
+        historyPath = historyFileArg.as<std::string>();
+    } else if (auto homeVar = ::getenv("HOME"); homeVar != nullptr) {
+        historyPath = fmt::format("{}/.sqlplusplus_history", homeVar);
+    }
+
+    NetworkTuning networkTuning;
+    if (sduArg) {
+        networkTuning.sdu = uint32ArgValue(sduArg);
+    }
+    if (expireTimeArg) {
+        networkTuning.expireTime = uint32ArgValue(expireTimeArg);
+    }
+    if (connectTimeoutArg) {
+        networkTuning.connectTimeout = uint32ArgValue(connectTimeoutArg);
+    }
+    if (transportConnectTimeoutArg) {
+        networkTuning.transportConnectTimeout = uint32ArgValue(transportConnectTimeoutArg);
+    }
+    if (retryCountArg) {
+        networkTuning.retryCount = uint32ArgValue(retryCountArg);
+    }
+    networkTuning.compression = static_cast<bool>(networkCompressionFlag);
+
+    OracleConnectionOptions connOpts;
+    connOpts.connString = tunedConnectString(connStringArg.as<std::string>(), networkTuning);
+    connOpts.username = usernameArg.as<std::string>();
+    if (stmtCacheSizeArg) {
+        connOpts.stmtCacheSize = uint32ArgValue(stmtCacheSizeArg);
+    }
+    connOpts.module = moduleArg ? moduleArg.as<std::string>() : std::string("sqlplusplus");
+    if (actionArg) {
+        connOpts.action = actionArg.as<std::string>();
+    }
+    if (clientIdentifierArg) {
+        connOpts.clientIdentifier = clientIdentifierArg.as<std::string>();
+    }
+    if (connectionClassArg) {
+        connOpts.connectionClass = connectionClassArg.as<std::string>();
+    }
+    if (purityArg) {
+        connOpts.purity = purityArgValue(purityArg);
+    }
+    if (clientConfigDirArg) {
+        connOpts.clientConfigDir = clientConfigDirArg.as<std::string>();
+    }
+    if (sessionTagArg) {
+        connOpts.sessionTag = sessionTagArg.as<std::string>();
+    }
+    if (!noPoolFlag) {
+        OracleConnectionPoolOptions poolOpts;
+        if (poolMinSessionsArg) {
+            poolOpts.minSessions = uint32ArgValue(poolMinSessionsArg);
+        }
+        if (poolMaxSessionsArg) {
+            poolOpts.maxSessions = uint32ArgValue(poolMaxSessionsArg);
+        }
+        if (poolSessionIncrementArg) {
+            poolOpts.sessionIncrement = uint32ArgValue(poolSessionIncrementArg);
+        }
+        if (poolGetModeArg) {
+            poolOpts.getMode = poolGetModeArgValue(poolGetModeArg);
+        }
+        if (poolWaitTimeoutArg) {
+            poolOpts.waitTimeout = uint32ArgValue(poolWaitTimeoutArg);
+        }
+        if (poolPingIntervalArg) {
+            auto pingInterval = poolPingIntervalArg.as<int64_t>();
+            poolOpts.pingInterval = static_cast<int>(std::clamp<int64_t>(
+                pingInterval, -1, std::numeric_limits<int>::max()));
+        }
+        if (poolTimeoutArg) {
+            poolOpts.timeout = uint32ArgValue(poolTimeoutArg);
+        }
+        if (poolMaxLifetimeArg) {
+            poolOpts.maxLifetimeSession = uint32ArgValue(poolMaxLifetimeArg);
+        }
+        // Proxy sessions are each acquired as the user they're for.
+        poolOpts.homogeneous = !poolHeterogeneousFlag && !proxyUserArg && !brokerSharedFlag;
+        if (sessionFixupArg) {
+            poolOpts.plsqlFixupCallback = sessionFixupArg.as<std::string>();
+        }
+        if (poolOpts.maxSessions < std::max<uint32_t>(poolOpts.minSessions, 1)) {
+            throw std::runtime_error("--poolMaxSessions must be at least 1 and --poolMinSessions");
+        }
+        connOpts.pool = poolOpts;
+    } else if (sessionFixupArg) {
+        throw std::runtime_error("--sessionFixup needs a pool; it can't be used with --noPool");
+    }
+    if (passwordarg) {
+        connOpts.password = passwordarg.as<std::string>();
+    }
+    if (proxyUserArg) {
+        connOpts.proxyUser = proxyUserArg.as<std::string>();
+    }
+    if (brokerSharedFlag && !brokerArg) {
+        throw std::runtime_error("--brokerShared needs --broker");
+    }
+
+    // -e runs its statement and exits, so there's no line editing, history or completion
+    // to set up.
+    if (!executeArg) {
+        // Make history really big by default
+        setUpLineEditing(historyPath, historyMaxSizeArg ? historyMaxSizeArg.as<int64_t>() : 10000);
+    }
+
+    Session session;
+    // Ctrl-C cancels the running statement and leaves the session connected; a second one
+    // in quick succession, for when nothing is listening on the server, exits.
+    InterruptWatcher interruptWatcher([&session, lastInterrupt = std::chrono::steady_clock::time_point{}]() mutable {
+        const auto now = std::chrono::steady_clock::now();
+        if (lastInterrupt.time_since_epoch().count() != 0 && now - lastInterrupt < std::chrono::seconds(2)) {
+            std::_Exit(130);
+        }
+        lastInterrupt = now;
+        ++interruptCount;
+        std::cerr << "\nCancelling (Ctrl-C again to exit)" << std::endl;
+        try {
+            // Whichever connection the REPL's on; the one it started with until then.
+            auto* current = sessionTargets.currentSession();
+            (current != nullptr ? *current : session).breakExecution();
+        } catch(const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+    });
+    if (standbyArg) {
+        session.setStandby(tunedConnectString(standbyArg.as<std::string>(), networkTuning));
+    }
+    const auto healthCheckInterval = std::chrono::seconds(
+            healthCheckIntervalArg ? uint32ArgValue(healthCheckIntervalArg) : 60);
+    session.setHealthCheckInterval(healthCheckInterval);
+    // The client libraries aren't loaded, nor the password asked for, until the first
+    // statement or command that needs the database.
+    const bool promptForPassword = !passwordarg;
+    auto loadKeywords = [](OracleConnection& conn) {
+        try {
+            auto cachePath = keywordCachePath(conn.serverVersion());
+            if (auto cached = loadKeywordCache(cachePath)) {
+                completionWords.reservedKeywords = std::move(*cached);
+            } else {
+                completionWords.reservedKeywords = fetchReservedKeywords(conn);
+                try {
+                    saveKeywordCache(cachePath, completionWords.reservedKeywords);
+                } catch(const std::exception&) {
+                    // Not being able to write the cache just means fetching again next time.
+                }
+            }
+            completionWords.reservedKeywordsReady.store(true, std::memory_order_release);
+        } catch(const std::exception&) {
+            // Completion keeps working with just the commands if the keywords can't be loaded.
+        }
+    };
+    auto askPassword = [](OracleConnectionOptions& opts) {
+        LinenoiseMaskGuard maskGuard;
+        auto linenoisePtr = linenoise("Password > ");
+        if (linenoisePtr == nullptr) {
+            throw std::runtime_error("no password given");
+        }
+        LinenoiseFreeHelper freeHelper(linenoisePtr);
+        opts.password = std::string(linenoisePtr);
+    };
+    session.deferConnect(connOpts, executeArg ? Session::ConnectedCallback{} : loadKeywords,
+            [promptForPassword, &askPassword](OracleConnectionOptions& opts) {
+        if (promptForPassword) {
+            askPassword(opts);
+        }
+    });
+
+    // Scraped from their own threads for as long as the session's around.
+    std::optional<MetricsServer> metricsServer;
+    std::optional<MetricsFileWriter> metricsFile;
+    if (metricsListenArg) {
+        metricsServer.emplace(metricsListenArg.value(), [&session] { return sessionOpenMetrics(session); });
+    }
+    if (metricsFileArg) {
+        metricsFile.emplace(metricsFileArg.as<std::string>(),
+                std::chrono::seconds(metricsIntervalArg ? uint32ArgValue(metricsIntervalArg) : 15),
+                [&session] { return sessionOpenMetrics(session); });
+    }
+
+    // Everything that has to happen on the way out, whichever way the session was used.
+    auto shutDown = [&](int exitCode) {
+        // Jobs and the result cache hold connections made through the session, so they have to
+        // go before it does.
+        backgroundJobs.clear();
+        resultCache.stop();
+        sessionTargets.clear();
+
+        // Only waits for what's still being appended.
+        historyStore.reset();
+        workloadCapture.reset();
+        waitMonitor.reset();
+        progressMonitor.reset();
+        // The file's last write has the totals of everything run.
+        metricsFile.reset();
+        metricsServer.reset();
+
+        if (statsJsonArg) {
+            auto statsOut = BufferedFdWriter::open(statsJsonArg.as<std::string>());
+            statsOut.append(clientCounters.toJson());
+            statsOut.append('\n');
+            statsOut.flush();
+        }
+        if (topSqlJsonArg) {
+            auto topSqlOut = BufferedFdWriter::open(topSqlJsonArg.as<std::string>());
+            topSqlOut.append(topSql.toJson());
+            topSqlOut.append('\n');
+            topSqlOut.flush();
+        }
+        if (!tracePath.empty()) {
+            traceRecorder.write(tracePath);
+        }
+
+        if (session.hasFailed()) {
+            // Rethrows the connect error so main reports it as fatal.
+            session.connection();
+        }
+        return exitCode;
+    };
+
+    if (brokerArg) {
+        // Logged in, asking for the password if need be, before any client attaches.
+        session.connection();
+        // A client that goes away mid-result only fails its own writes.
+        ::signal(SIGPIPE, SIG_IGN);
+        // Other users' scripts never run with the broker's own login, only as their own
+        // database users, which the login has to be granted to connect through.
+        const bool shared = static_cast<bool>(brokerSharedFlag);
+        BrokerServer broker(brokerArg.as<std::string>(), [&session, shared](const BrokerClient& client,
+                std::string_view script, std::string_view format, int outFd, int errFd) {
+            std::optional<std::string_view> proxyUser;
+            if (shared && client.uid != ::getuid()) {
+                proxyUser = client.userName;
+            }
+            return runBrokeredScript(session, proxyUser, script, format, outFd, errFd);
+        }, shared);
+        std::cerr << "Broker listening at " << brokerArg.value() << std::endl;
+        // Until Ctrl-C, which InterruptWatcher turns into an exit the second time.
+        for (;;) {
+            ::pause();
+        }
+    }
+
+    if (exportWorkerArg) {
+        return shutDown(runQueuedExport(session, exportWorkerArg.as<std::string>()));
+    }
+
+    if (checkArg) {
+        // One of the pool's sessions stays with the REPL's connection.
+        const auto parallelism = connOpts.pool ? std::max<uint32_t>(connOpts.pool->maxSessions, 2) - 1
+                                               : OracleConnectionPoolOptions().maxSessions;
+        return shutDown(runScriptCheck(session, checkArg.as<std::string>(), parallelism));
+    }
+
+    if (executeArg) {
+        return shutDown(runOneShot(session, executeArg.value()));
+    }
+
+    // Each connection's own schema is loaded once its session is up; see the REPL loop.
+    const auto schemaCache = schemaCacheArg ? std::filesystem::path(schemaCacheArg.value()) : userCacheDirectory();
+    auto setUpSchemaIndex = [&schemaCache](SessionTarget& target) {
+        target.schemaIndex = std::make_unique<SchemaIndex>([session = target.session] {
+            return session->newConnection(true);
+        });
+        if (!schemaCache.empty() && schemaCache != "off") {
+            target.schemaIndex->setSharedCache(schemaCache, fmt::format("{}\n{}", target.connString, target.username));
+        }
+        target.schemaIndex->setInvalidationListener([&target](std::string_view owner, std::string_view name) {
+            sessionTargets.invalidate(target, owner, name);
+        });
+    };
+    {
+        auto primary = std::make_unique<SessionTarget>();
+        primary->name = kDefaultTarget;
+        primary->username = connOpts.username;
+        primary->connString = connStringArg.as<std::string>();
+        primary->session = &session;
+        setUpSchemaIndex(*primary);
+        sessionTargets.add(std::move(primary));
+    }
+    // Other connections get the same options but for the login, and share the keywords
+    // loaded for the first; they're the same from one release to the next but for a few.
+    openSessionTarget = [&](std::string name, std::string username, std::optional<std::string> password,
+                            std::string connString) {
+        auto target = std::make_unique<SessionTarget>();
+        target->name = std::move(name);
+        target->username = username;
+        target->connString = connString;
+        target->ownedSession = std::make_unique<Session>();
+        target->session = target->ownedSession.get();
+        target->session->setHealthCheckInterval(healthCheckInterval);
+        auto opts = connOpts;
+        opts.username = std::move(username);
+        opts.connString = tunedConnectString(connString, networkTuning);
+        const bool askForPassword = !password;
+        opts.password = password.value_or(std::string());
+        target->session->deferConnect(std::move(opts), {},
+                [askForPassword, &askPassword](OracleConnectionOptions& opts) {
+            if (askForPassword) {
+                askPassword(opts);
+            }
+        });
+        setUpSchemaIndex(*target);
+        return target;
+    };
+    describeCache.setDescribedListener([](const TableDescription& description) {
+        auto* target = sessionTargets.current();
+        if (target == nullptr) {
+            return;
+        }
+        std::vector<std::string_view> columnNames;
+        columnNames.reserve(description.columns.size());
+        for (const auto& column : description.columns) {
+            columnNames.push_back(column.name);
+        }
+        target->schemaIndex->addColumns(description.name, columnNames);
+    });
+
+    // Only the completion callback uses these, on the main thread, one keystroke after
+    // another; they're kept between keystrokes so completing doesn't allocate once warm.
+    CompletionLexer completionLexer;
+    constexpr size_t kMaxCompletions = 64;
+    CompletionRanker ranker(CompletionContext::StatementStart, &historyWordFrequencies, kMaxCompletions);
+    std::string qualifiedWord;
+    generateCompletions = [&](std::string_view sv, const std::function<void(std::string_view)>& emit) {
+        if (sv.empty()) {
+            return;
+        }
+
+        using Kind = CompletionPoint::Kind;
+        const auto& point = completionLexer.update(sv);
+        ranker.reset(point.context);
+        const auto word = sv.substr(point.wordStart);
+        switch (point.kind) {
+        case Kind::None:
+        case Kind::Bind:
+            // Nothing to complete inside quotes and comments, nor bind names yet.
+            return;
+        case Kind::Command:
+            ranker.offerPrefixMatches(completionWords.commands, word, CompletionSource::Command);
+            ranker.take(sv.substr(0, point.wordStart), emit);
+            return;
+        case Kind::Word: {
+            const auto [firstBuiltin, lastBuiltin] = builtinKeywordsWithPrefix(word);
+            const auto scanned = std::min<ptrdiff_t>(lastBuiltin - firstBuiltin, CompletionRanker::kMaxScannedPerSource);
+            for (auto it = firstBuiltin; it != firstBuiltin + scanned; ++it) {
+                ranker.offer(*it, CompletionSource::Keyword);
+            }
+            if (completionWords.reservedKeywordsReady.load(std::memory_order_acquire)) {
+                ranker.offerPrefixMatches(completionWords.reservedKeywords, word, CompletionSource::Keyword);
+            }
+            break;
+        }
+        case Kind::QualifiedName:
+            break;
+        }
+
+        // Schema objects match on the whole dotted name, so "hr.emp" and "employees.sal"
+        // complete as well as bare names, from the connection in use.
+        auto& target = *sessionTargets.current();
+        auto& schemaIndex = *target.schemaIndex;
+        qualifiedWord.clear();
+        std::transform(sv.begin() + point.nameStart, sv.end(), std::back_inserter(qualifiedWord),
+                [](const auto ch) {
+            return static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+        });
+        if (auto dot = qualifiedWord.find('.'); dot != std::string::npos && dot > 0) {
+            auto qualifier = std::string_view(qualifiedWord).substr(0, dot);
+            // Not before the session is up: loading it would be what connects.
+            if (target.session->isReady() && !schemaIndex.isSchemaKnown(qualifier)) {
+                // Might be a schema we haven't seen yet; it'll complete once it's loaded.
+                schemaIndex.requestSchema(qualifier);
+            }
+        }
+        // Columns aren't what follows FROM or JOIN, unless they're qualified.
+        auto kinds = SchemaIndex::kAllKinds;
+        if (point.kind == Kind::Word && point.context == CompletionContext::Relation) {
+            kinds &= ~SchemaIndex::kindBit(SchemaObjectKind::Column);
+        }
+        schemaIndex.forEachPrefixMatch(qualifiedWord, CompletionRanker::kMaxScannedPerSource, kinds,
+                [&](std::string_view key, SchemaObjectKind kind) {
+            switch (kind) {
+            case SchemaObjectKind::Table:
+            case SchemaObjectKind::View:
+            case SchemaObjectKind::Synonym:
+                ranker.offer(key, CompletionSource::Relation);
+                break;
+            case SchemaObjectKind::Column:
+                ranker.offer(key, CompletionSource::Column);
+                break;
+            default:
+                ranker.offer(key, CompletionSource::OtherObject);
+                break;
+            }
+        });
+
+        ranker.take(sv.substr(0, point.nameStart), emit);
+    };
+
+    int exitCode = 0;
+    if (benchArg) {
+        dispatchLine(session, fmt::format(".bench {}", benchArg.value()));
+        exitCode = benchCmd.lastFailures == 0 ? 0 : 1;
+    }
+    if (benchWorkloadArg) {
+        dispatchLine(session, fmt::format(".workload {}", benchWorkloadArg.value()));
+        exitCode = workloadCmd.lastFailures == 0 ? 0 : 1;
+    }
+    if (fileArg) {
+        runScript(session, fileArg.as<std::string>());
+        exitCode = scriptFailures == 0 ? 0 : 1;
+    }
+
+    // Input accumulates here until the splitter finds complete statements in it; whatever is
+    // left over is a statement that's still being typed.
+    std::string pending;
+    // The input line pending starts on.
+    uint64_t pendingLine = 1;
+    uint64_t inputLine = 0;
+    const bool fromScript = !::isatty(STDIN_FILENO);
+    bool keepRunning = true;
+    auto runStatement = [&](const SqlStatement& stmt) {
+        // Directives shape how a script runs; typed or piped in, they're just comments.
+        if (stmt.isDirective) {
+            return;
+        }
+        if (fromScript) {
+            statementAction = fmt::format("<stdin>:{}", pendingLine + stmt.line - 1);
+        }
+        // A .use takes effect from the statement after it.
+        auto& current = *sessionTargets.currentSession();
+        try {
+            keepRunning = dispatchLine(current, stmt.text);
+        } catch(const OracleException& e) {
+            if (current.hasFailed()) {
+                keepRunning = false;
+                return;
+            }
+            std::cerr << "Error " << e.context() << ": " << e.what() << std::endl;
+            if (e.isSessionLost()) {
+                try {
+                    recoverLostSession(current);
+                } catch(const std::exception& reconnectError) {
+                    std::cerr << "Error reconnecting: " << reconnectError.what() << std::endl;
+                }
+            }
+        } catch(const std::exception& e) {
+            if (current.hasFailed()) {
+                keepRunning = false;
+                return;
+            }
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+    };
+
+    // --bench, --bench-workload and --file run without reading any input.
+    while (keepRunning && !benchArg && !benchWorkloadArg && !fileArg) {
+        if (session.hasFailed()) {
+            break;
+        }
+        if (auto& target = *sessionTargets.current(); !target.schemaRequested && target.session->isReady()) {
+            target.schemaIndex->requestSchema({});
+            target.schemaRequested = true;
+        }
+        // Up-arrow history comes from the file once it's been read in the background.
+        // Anything typed before that is added again after it, so it stays newest.
+        if (historyStore) {
+            if (auto loaded = historyStore->takeLoaded()) {
+                for (const auto& entry : *loaded) {
+                    linenoiseHistoryAdd(entry.c_str());
+                    historyWordFrequencies.addStatement(entry);
+                }
+            }
+        }
+        auto linePtr = linenoise(pending.empty() ? "SQL++ > " : "SQL++ (cont.) > ");
+        if (linePtr == nullptr) {
+            break;
+        }
+        LinenoiseFreeHelper helper(linePtr);
+        std::string_view input(linePtr);
+        if (pending.empty()) {
+            pendingLine = inputLine + 1;
+        }
+        // A bracketed paste of many lines arrives as one input, so however long the statement
+        // it's split just once below.
+        for (;;) {
+            const auto end = std::min(input.find('\n'), input.size());
+            auto line = input.substr(0, end);
+            ++inputLine;
+            // A trailing backslash used to be the only way to continue a statement onto the
+            // next line, so it's still accepted.
+            if (!line.empty() && line.back() == '\\') {
+                line.remove_suffix(1);
+            }
+            pending.append(line).push_back('\n');
+            if (end == input.size()) {
+                break;
+            }
+            input.remove_prefix(end + 1);
+        }
+
+        SqlSplitter splitter(pending);
+        SqlStatement stmt;
+        while (keepRunning && splitter.next(stmt) && stmt.complete) {
+            runStatement(stmt);
+        }
+        const auto consumed = splitter.consumed();
+        pendingLine += std::count(pending.begin(), pending.begin() + consumed, '\n');
+        pending.erase(0, consumed);
+        linenoiseSetMultiLine(pending.empty() ? 0 : 1);
+    }
+
+    // Piped input may end without terminating its last statement.
+    if (keepRunning && !pending.empty() && !session.hasFailed()) {
+        SqlSplitter splitter(pending);
+        SqlStatement stmt;
+        if (splitter.next(stmt)) {
+            runStatement(stmt);
+        }
+    }
+
+    return shutDown(exitCode);
+} catch(const OracleException& e) {
+    std::cerr << "Fatal error " << e.context() << ": " << e.what() << std::endl;
+    return 1;
+} catch(const std::exception& e) {
+    std::cerr << "Fatal error: " << e.what() << std::endl;
     return 1;
 }
 
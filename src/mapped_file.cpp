@@ -0,0 +1,71 @@
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sqlplusplus {
+
+MappedFile::MappedFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw std::system_error(errno, std::generic_category(), "error opening " + path);
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) == -1) {
+        auto err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "error reading size of " + path);
+    }
+
+    _size = static_cast<size_t>(st.st_size);
+    if (_size != 0) {
+        _data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (_data == MAP_FAILED) {
+            auto err = errno;
+            _data = nullptr;
+            _size = 0;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "error mapping " + path);
+        }
+    }
+    // The mapping keeps the file referenced on its own.
+    ::close(fd);
+}
+
+void MappedFile::adviseSequential() const noexcept {
+    if (_data != nullptr) {
+        // Only a hint; reads work the same if it's refused.
+        ::madvise(_data, _size, MADV_SEQUENTIAL);
+    }
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : _data(std::exchange(other._data, nullptr)),
+      _size(std::exchange(other._size, 0))
+{}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        if (_data != nullptr) {
+            ::munmap(_data, _size);
+        }
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    if (_data != nullptr) {
+        ::munmap(_data, _size);
+    }
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace sqlplusplus {
+
+// A read-only memory mapping of a whole file. Throws std::system_error if the file can't be
+// opened or mapped.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+
+    std::string_view contents() const noexcept {
+        return std::string_view(static_cast<const char*>(_data), _size);
+    }
+
+    // Hints that the mapping will be read front to back, so the kernel reads ahead
+    // aggressively and drops pages behind the reader first.
+    void adviseSequential() const noexcept;
+
+private:
+    void* _data = nullptr;
+    size_t _size = 0;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,223 @@
+#include "metrics_exporter.h"
+
+#include "client_counters.h"
+#include "session.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace sqlplusplus {
+namespace {
+
+// How long a scraper gets to send its request.
+constexpr int kRequestTimeoutMs = 5000;
+constexpr size_t kMaxRequestBytes = 8192;
+
+bool writeAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const auto rc = ::write(fd, data.data(), data.size());
+        if (rc == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(rc));
+    }
+    return true;
+}
+
+// Without SIGPIPE, which would end the process when a scraper hangs up early.
+void sendAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const auto rc = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (rc == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data.remove_prefix(static_cast<size_t>(rc));
+    }
+}
+
+} // namespace
+
+std::string sessionOpenMetrics(const Session& session) {
+    auto text = clientCounters.toOpenMetrics();
+    if (const auto pool = session.poolUsage()) {
+        text += fmt::format("# TYPE sqlplusplus_pool_sessions gauge\n"
+                            "sqlplusplus_pool_sessions{{state=\"open\"}} {}\n"
+                            "sqlplusplus_pool_sessions{{state=\"busy\"}} {}\n"
+                            "# TYPE sqlplusplus_pool_max_sessions gauge\n"
+                            "sqlplusplus_pool_max_sessions {}\n",
+                            pool->open, pool->busy, pool->max);
+    }
+    text += "# EOF\n";
+    return text;
+}
+
+MetricsServer::MetricsServer(std::string_view address, std::function<std::string()> render) :
+    _render(std::move(render))
+{
+    std::string host = "127.0.0.1";
+    std::string port(address);
+    if (const auto colon = address.rfind(':'); colon != std::string_view::npos) {
+        host = std::string(address.substr(0, colon));
+        port = std::string(address.substr(colon + 1));
+    }
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* found = nullptr;
+    if (const auto rc = ::getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &found); rc != 0) {
+        throw std::runtime_error(fmt::format("can't listen on {}: {}", address, ::gai_strerror(rc)));
+    }
+    int err = 0;
+    for (auto* ai = found; ai != nullptr && _listenFd == -1; ai = ai->ai_next) {
+        _listenFd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (_listenFd == -1) {
+            err = errno;
+            continue;
+        }
+        const int on = 1;
+        ::setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (::bind(_listenFd, ai->ai_addr, ai->ai_addrlen) == -1 || ::listen(_listenFd, 16) == -1) {
+            err = errno;
+            ::close(_listenFd);
+            _listenFd = -1;
+        }
+    }
+    ::freeaddrinfo(found);
+    if (_listenFd == -1) {
+        throw std::system_error(err, std::generic_category(), fmt::format("error listening on {}", address));
+    }
+    if (::pipe2(_wakeFds, O_CLOEXEC) == -1) {
+        err = errno;
+        ::close(_listenFd);
+        throw std::system_error(err, std::generic_category(), "error creating pipe");
+    }
+    _thread = std::thread([this] { _run(); });
+}
+
+MetricsServer::~MetricsServer() {
+    writeAll(_wakeFds[1], "x");
+    _thread.join();
+    ::close(_listenFd);
+    ::close(_wakeFds[0]);
+    ::close(_wakeFds[1]);
+}
+
+void MetricsServer::_run() {
+    for (;;) {
+        pollfd fds[2] = {{_listenFd, POLLIN, 0}, {_wakeFds[0], POLLIN, 0}};
+        if (::poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (fds[1].revents != 0) {
+            return;
+        }
+        const int fd = ::accept4(_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd == -1) {
+            continue;
+        }
+        _serve(fd);
+        ::close(fd);
+    }
+}
+
+void MetricsServer::_serve(int fd) {
+    // Only the request line matters, but the headers are read so the client isn't reset
+    // while it's still sending them.
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < kMaxRequestBytes) {
+        pollfd pfd{fd, POLLIN, 0};
+        if (::poll(&pfd, 1, kRequestTimeoutMs) <= 0) {
+            return;
+        }
+        const auto rc = ::read(fd, buffer, sizeof(buffer));
+        if (rc <= 0) {
+            return;
+        }
+        request.append(buffer, static_cast<size_t>(rc));
+    }
+    const auto lineEnd = request.find("\r\n");
+    const std::string_view line = std::string_view(request).substr(0, lineEnd);
+    std::string response;
+    if (line.rfind("GET /metrics ", 0) == 0 || line.rfind("GET /metrics?", 0) == 0) {
+        const auto body = _render();
+        response = fmt::format("HTTP/1.1 200 OK\r\n"
+                               "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+                               "Content-Length: {}\r\nConnection: close\r\n\r\n{}", body.size(), body);
+    } else {
+        constexpr std::string_view kBody = "Metrics are at /metrics\n";
+        response = fmt::format("HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\n"
+                               "Content-Length: {}\r\nConnection: close\r\n\r\n{}", kBody.size(), kBody);
+    }
+    sendAll(fd, response);
+}
+
+MetricsFileWriter::MetricsFileWriter(std::string path, std::chrono::seconds interval,
+                                     std::function<std::string()> render) :
+    _path(std::move(path)),
+    _interval(std::max(interval, std::chrono::seconds(1))),
+    _render(std::move(render))
+{
+    _thread = std::thread([this] {
+        std::unique_lock<std::mutex> lk(_mutex);
+        while (!_wake.wait_for(lk, _interval, [this] { return _stopping; })) {
+            lk.unlock();
+            _write();
+            lk.lock();
+        }
+    });
+}
+
+MetricsFileWriter::~MetricsFileWriter() {
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    _thread.join();
+    _write();
+}
+
+void MetricsFileWriter::_write() {
+    const auto text = _render();
+    const auto tmpPath = _path + ".tmp";
+    const int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool written = fd != -1 && writeAll(fd, text);
+    const int err = errno;
+    if (fd != -1) {
+        ::close(fd);
+    }
+    if (written && ::rename(tmpPath.c_str(), _path.c_str()) == 0) {
+        return;
+    }
+    const int reported = written ? errno : err;
+    ::unlink(tmpPath.c_str());
+    if (!_reportedError) {
+        _reportedError = true;
+        std::cerr << "Error writing metrics to " << _path << ": " << std::strerror(reported) << std::endl;
+    }
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace sqlplusplus {
+
+class Session;
+
+// The client's counters, latency histograms and the session pool's usage as an OpenMetrics
+// text exposition, "# EOF" and all, for Prometheus to scrape. Rates, such as rows a second
+// for an export or executes a second for .bench, come from the counters on the
+// Prometheus side.
+std::string sessionOpenMetrics(const Session& session);
+
+// Serves render()'s text at GET /metrics on a thread of its own, one request at a time, for
+// Prometheus to scrape a job that runs unattended. address is [host:]port, the host
+// defaulting to 127.0.0.1 so the endpoint isn't on the network unless asked for. Throws
+// std::system_error if it can't listen there.
+class MetricsServer {
+public:
+    MetricsServer(std::string_view address, std::function<std::string()> render);
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+    ~MetricsServer();
+
+private:
+    void _run();
+    void _serve(int fd);
+
+    std::function<std::string()> _render;
+    int _listenFd = -1;
+    // Written to on destruction to wake the thread out of poll().
+    int _wakeFds[2] = {-1, -1};
+    std::thread _thread;
+};
+
+// Writes render()'s text to path every interval, and once more when it's destroyed so the
+// file ends with the job's totals; each write goes to a file next to it that's renamed over
+// it, so node_exporter's textfile collector never reads half of one. Write errors are
+// reported on stderr once and the writes carry on.
+class MetricsFileWriter {
+public:
+    MetricsFileWriter(std::string path, std::chrono::seconds interval, std::function<std::string()> render);
+    MetricsFileWriter(const MetricsFileWriter&) = delete;
+    MetricsFileWriter& operator=(const MetricsFileWriter&) = delete;
+    ~MetricsFileWriter();
+
+private:
+    void _write();
+
+    std::string _path;
+    std::chrono::seconds _interval;
+    std::function<std::string()> _render;
+    bool _reportedError = false;
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    bool _stopping = false;
+    std::thread _thread;
+};
+
+} // namespace sqlplusplus
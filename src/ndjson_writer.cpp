@@ -0,0 +1,257 @@
+#include "ndjson_writer.h"
+
+#include "json_text.h"
+#include "oracle_helpers.h"
+#include "result_metadata.h"
+#include "trace_recorder.h"
+#include "value_format.h"
+
+#include <algorithm>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+namespace {
+
+// Strings longer than this are escaped a piece at a time, so a large CLOB doesn't need
+// six times its size reserved in the output buffer.
+constexpr size_t kStringChunkSize = 64 * 1024;
+
+enum class ValueKind {
+    String,
+    // NUMBER columns fetched as text; the text is already a valid JSON number.
+    NumberText,
+    Int64,
+    Uint64,
+    Double,
+    Float,
+    Boolean,
+    Timestamp,
+    Json,
+    // Streamed from the LOB a piece at a time, as hex for BLOBs.
+    TextLob,
+    BinaryLob,
+    // Anything else is written as a string of its table text.
+    Formatted,
+};
+
+struct NdjsonColumn {
+    // The text in front of the value: the opening brace or a comma, the quoted key and
+    // the colon.
+    std::string prefix;
+    dpiOracleTypeNum oracleType;
+    dpiNativeTypeNum nativeType = 0;
+    dpiObjectType* objectType = nullptr;
+    ValueKind kind = ValueKind::Formatted;
+    ColumnFormatter formatter{0};
+};
+
+ValueKind valueKind(dpiOracleTypeNum oracleType, dpiNativeTypeNum nativeType) {
+    switch (nativeType) {
+    case DPI_NATIVE_TYPE_BYTES:
+        if (isBinaryType(oracleType)) {
+            // A RAW or a BLOB fetched inline, written as the same hex its formatter shows.
+            return ValueKind::Formatted;
+        }
+        return oracleType == DPI_ORACLE_TYPE_NUMBER ? ValueKind::NumberText : ValueKind::String;
+    case DPI_NATIVE_TYPE_INT64:
+        return ValueKind::Int64;
+    case DPI_NATIVE_TYPE_UINT64:
+        return ValueKind::Uint64;
+    case DPI_NATIVE_TYPE_DOUBLE:
+        return ValueKind::Double;
+    case DPI_NATIVE_TYPE_FLOAT:
+        return ValueKind::Float;
+    case DPI_NATIVE_TYPE_BOOLEAN:
+        return ValueKind::Boolean;
+    case DPI_NATIVE_TYPE_TIMESTAMP:
+        return ValueKind::Timestamp;
+    case DPI_NATIVE_TYPE_JSON:
+        return ValueKind::Json;
+    case DPI_NATIVE_TYPE_LOB:
+        return isBinaryLob(oracleType) ? ValueKind::BinaryLob : ValueKind::TextLob;
+    default:
+        return ValueKind::Formatted;
+    }
+}
+
+void setNativeType(NdjsonColumn& column, dpiNativeTypeNum nativeType) {
+    column.nativeType = nativeType;
+    column.kind = valueKind(column.oracleType, nativeType);
+    column.formatter = ColumnFormatter(nativeType, column.oracleType, column.objectType);
+}
+
+void writeStringContents(BufferedFdWriter& out, std::string_view value) {
+    while (!value.empty()) {
+        auto chunk = value.substr(0, kStringChunkSize);
+        auto ptr = out.reserve(jsonStringSizeBound(chunk.size()));
+        out.commit(writeJsonStringContents(chunk, ptr));
+        value.remove_prefix(chunk.size());
+    }
+}
+
+void writeString(BufferedFdWriter& out, std::string_view prefix, std::string_view value) {
+    if (value.size() <= kStringChunkSize) {
+        auto ptr = out.reserve(prefix.size() + jsonStringSizeBound(value.size()));
+        ptr = std::copy(prefix.begin(), prefix.end(), ptr);
+        out.commit(writeJsonString(value, ptr));
+        return;
+    }
+    out.append(prefix);
+    out.append('"');
+    writeStringContents(out, value);
+    out.append('"');
+}
+
+void writeLob(BufferedFdWriter& out, std::string_view prefix, OracleLobReader& reader, dpiLob* lob, bool binary) {
+    out.append(prefix);
+    out.append('"');
+    reader.open(lob);
+    for (auto piece = reader.next(); !piece.empty(); piece = reader.next()) {
+        if (binary) {
+            // Hex needs no escaping.
+            auto ptr = out.reserve(piece.size() * 2);
+            out.commit(writeHex(piece, ptr));
+        } else {
+            writeStringContents(out, piece);
+        }
+    }
+    out.append('"');
+}
+
+void writeValue(BufferedFdWriter& out, const OracleResultSource& source, OracleLobReader& lobReader,
+                const NdjsonColumn& column, const dpiData& data) {
+    const std::string_view prefix = column.prefix;
+    if (data.isNull) {
+        auto ptr = out.reserve(prefix.size() + 4);
+        ptr = std::copy(prefix.begin(), prefix.end(), ptr);
+        out.commit(std::copy_n("null", 4, ptr));
+        return;
+    }
+
+    const auto& value = data.value;
+    if (column.kind == ValueKind::String) {
+        writeString(out, prefix, std::string_view(value.asBytes.ptr, value.asBytes.length));
+        return;
+    }
+    if (column.kind == ValueKind::TextLob || column.kind == ValueKind::BinaryLob) {
+        writeLob(out, prefix, lobReader, value.asLOB, column.kind == ValueKind::BinaryLob);
+        return;
+    }
+    if (column.kind == ValueKind::Formatted) {
+        fmt::memory_buffer text;
+        column.formatter.format(data, text);
+        writeString(out, prefix, std::string_view(text.data(), text.size()));
+        return;
+    }
+
+    const dpiJsonNode* node = nullptr;
+    size_t sizeBound = 0;
+    switch (column.kind) {
+    case ValueKind::NumberText:
+        sizeBound = value.asBytes.length;
+        break;
+    case ValueKind::Int64:
+    case ValueKind::Uint64:
+        sizeBound = 20;
+        break;
+    case ValueKind::Double:
+    case ValueKind::Float:
+        sizeBound = kJsonDoubleSizeBound;
+        break;
+    case ValueKind::Boolean:
+        sizeBound = 5;
+        break;
+    case ValueKind::Timestamp:
+        sizeBound = kJsonTimestampSizeBound;
+        break;
+    default:
+        node = &source.jsonValue(data, DPI_JSON_OPT_NUMBER_AS_STRING);
+        sizeBound = jsonNodeSizeBound(*node);
+        break;
+    }
+
+    auto ptr = out.reserve(prefix.size() + sizeBound);
+    ptr = std::copy(prefix.begin(), prefix.end(), ptr);
+    switch (column.kind) {
+    case ValueKind::NumberText:
+        ptr = std::copy(value.asBytes.ptr, value.asBytes.ptr + value.asBytes.length, ptr);
+        break;
+    case ValueKind::Int64:
+        ptr = std::to_chars(ptr, ptr + 20, value.asInt64).ptr;
+        break;
+    case ValueKind::Uint64:
+        ptr = std::to_chars(ptr, ptr + 20, value.asUint64).ptr;
+        break;
+    case ValueKind::Double:
+        ptr = writeJsonDouble(value.asDouble, ptr);
+        break;
+    case ValueKind::Float:
+        ptr = writeJsonDouble(value.asFloat, ptr);
+        break;
+    case ValueKind::Boolean:
+        ptr = value.asBoolean ? std::copy_n("true", 4, ptr) : std::copy_n("false", 5, ptr);
+        break;
+    case ValueKind::Timestamp:
+        ptr = writeJsonTimestamp(value.asTimestamp, ptr);
+        break;
+    default:
+        ptr = writeJsonNode(*node, ptr);
+        break;
+    }
+    out.commit(ptr);
+}
+
+} // namespace
+
+uint64_t writeNdjsonResults(OracleResultSource& stmt, BufferedFdWriter& out) {
+    const auto metadata = stmt.metadata();
+    const auto numColumns = metadata->numColumns();
+    std::vector<NdjsonColumn> columns(numColumns);
+    for (uint32_t col = 1; col <= numColumns; ++col) {
+        const auto& info = metadata->column(col);
+        auto& column = columns[col - 1];
+        column.prefix.resize(jsonStringSizeBound(info.name.size()) + 2);
+        auto end = column.prefix.data();
+        *end++ = col == 1 ? '{' : ',';
+        end = writeJsonString(info.name, end);
+        *end++ = ':';
+        column.prefix.resize(static_cast<size_t>(end - column.prefix.data()));
+        column.oracleType = info.typeInfo.oracleTypeNum;
+        column.objectType = info.typeInfo.objectType;
+        setNativeType(column, info.typeInfo.defaultNativeTypeNum);
+    }
+
+    OracleLobReader lobReader(stmt.context());
+    std::vector<dpiData*> columnData(numColumns);
+    uint64_t numRows = 0;
+    for (;;) {
+        auto block = stmt.fetchBlock(stmt.fetchArraySize());
+        // Values are formatted straight into the output, so decoding and writing are one span.
+        TraceSpan span("write");
+        span.setArg("rows", block.numRows());
+        for (uint32_t col = 1; col <= numColumns; ++col) {
+            if (columns[col - 1].nativeType != block.nativeType(col)) {
+                setNativeType(columns[col - 1], block.nativeType(col));
+            }
+            columnData[col - 1] = block.columnData(col);
+        }
+
+        for (uint32_t row = 0; row < block.numRows(); ++row) {
+            for (uint32_t col = 0; col < numColumns; ++col) {
+                writeValue(out, stmt, lobReader, columns[col], columnData[col][row]);
+            }
+            out.append("}\n");
+        }
+        numRows += block.numRows();
+        if (!block.moreRows()) {
+            break;
+        }
+    }
+    out.flush();
+    return numRows;
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "buffered_writer.h"
+
+#include <cstdint>
+
+namespace sqlplusplus {
+
+class OracleResultSource;
+
+// Writes every remaining row of an executed query as newline-delimited JSON: one object
+// per line, keyed by column name. Each column's key is escaped once up front, and values
+// are written straight from the statement's fetch buffers, with native JSON columns
+// embedded as JSON rather than as strings. Returns the number of rows written.
+uint64_t writeNdjsonResults(OracleResultSource& stmt, BufferedFdWriter& out);
+
+} // namespace sqlplusplus
@@ -0,0 +1,178 @@
+#include "object_format.h"
+
+#include <string_view>
+
+namespace sqlplusplus {
+namespace {
+
+constexpr std::string_view kUnreadableObjectText = "<unreadable object>";
+// The most text ODPI writes for a NUMBER, which objects are asked for as text to keep
+// every digit.
+constexpr uint32_t kNumberTextBytes = 172;
+
+struct RenderedObject {
+    const ObjectLayout* layout = nullptr;
+    dpiObject* object = nullptr;
+    std::string text;
+};
+
+thread_local RenderedObject lastRendered;
+
+} // namespace
+
+std::shared_ptr<const ObjectLayout> ObjectLayout::forType(dpiObjectType* type) {
+    dpiObjectTypeInfo info;
+    if (type == nullptr || dpiObjectType_getInfo(type, &info) != DPI_SUCCESS) {
+        return nullptr;
+    }
+    std::shared_ptr<ObjectLayout> layout(new ObjectLayout);
+    dpiObjectType_addRef(type);
+    layout->_type = type;
+    layout->_name.assign(info.name, info.nameLength);
+    layout->_isCollection = info.isCollection != 0;
+    if (layout->_isCollection) {
+        layout->_element.typeInfo = info.elementTypeInfo;
+        if (!_describeMember(layout->_element)) {
+            return nullptr;
+        }
+        return layout;
+    }
+
+    std::vector<dpiObjectAttr*> attrs(info.numAttributes);
+    if (dpiObjectType_getAttributes(type, info.numAttributes, attrs.data()) != DPI_SUCCESS) {
+        return nullptr;
+    }
+    layout->_attributes.resize(attrs.size());
+    // Each attribute is owned by the layout as soon as it's in it, so they're all released
+    // if a later one fails.
+    for (size_t idx = 0; idx < attrs.size(); ++idx) {
+        layout->_attributes[idx].attr = attrs[idx];
+    }
+    for (auto& member : layout->_attributes) {
+        dpiObjectAttrInfo attrInfo;
+        if (dpiObjectAttr_getInfo(member.attr, &attrInfo) != DPI_SUCCESS) {
+            return nullptr;
+        }
+        member.typeInfo = attrInfo.typeInfo;
+        if (!_describeMember(member)) {
+            return nullptr;
+        }
+    }
+    return layout;
+}
+
+ObjectLayout::~ObjectLayout() {
+    for (const auto& member : _attributes) {
+        if (member.attr != nullptr) {
+            dpiObjectAttr_release(member.attr);
+        }
+    }
+    if (_type != nullptr) {
+        dpiObjectType_release(_type);
+    }
+}
+
+bool ObjectLayout::_describeMember(Member& member) {
+    const auto& type = member.typeInfo;
+    member.nativeType = type.defaultNativeTypeNum;
+    if (type.oracleTypeNum == DPI_ORACLE_TYPE_NUMBER) {
+        member.nativeType = DPI_NATIVE_TYPE_BYTES;
+    } else if (member.nativeType == DPI_NATIVE_TYPE_OBJECT) {
+        member.nested = forType(type.objectType);
+        if (!member.nested) {
+            return false;
+        }
+    }
+    member.formatter = ColumnFormatter(member.nativeType, type.oracleTypeNum);
+    return true;
+}
+
+size_t ObjectLayout::sizeBound(dpiObject* object) const {
+    lastRendered.layout = this;
+    lastRendered.object = object;
+    lastRendered.text.clear();
+    _render(object, lastRendered.text);
+    return lastRendered.text.size();
+}
+
+char* ObjectLayout::format(dpiObject* object, char* out) const {
+    if (lastRendered.layout != this || lastRendered.object != object) {
+        sizeBound(object);
+    }
+    const auto& text = lastRendered.text;
+    return std::copy(text.begin(), text.end(), out);
+}
+
+void ObjectLayout::_render(dpiObject* object, std::string& out) const {
+    const auto start = out.size();
+    out.append(_name);
+    out.push_back('(');
+    auto fail = [&] {
+        out.resize(start);
+        out.append(kUnreadableObjectText);
+    };
+
+    char numberText[kNumberTextBytes];
+    dpiData data;
+    auto prepare = [&](const Member& member) {
+        if (member.nativeType == DPI_NATIVE_TYPE_BYTES && member.typeInfo.oracleTypeNum == DPI_ORACLE_TYPE_NUMBER) {
+            data.value.asBytes.ptr = numberText;
+            data.value.asBytes.length = kNumberTextBytes;
+        }
+    };
+
+    if (_isCollection) {
+        int32_t index = 0;
+        int exists = 0;
+        if (dpiObject_getFirstIndex(object, &index, &exists) != DPI_SUCCESS) {
+            return fail();
+        }
+        for (bool first = true; exists; first = false) {
+            if (!first) {
+                out.append(", ");
+            }
+            prepare(_element);
+            if (dpiObject_getElementValueByIndex(object, index, _element.nativeType, &data) != DPI_SUCCESS) {
+                return fail();
+            }
+            _renderMember(_element, data, out);
+            if (dpiObject_getNextIndex(object, index, &index, &exists) != DPI_SUCCESS) {
+                return fail();
+            }
+        }
+    } else {
+        for (size_t idx = 0; idx < _attributes.size(); ++idx) {
+            const auto& member = _attributes[idx];
+            if (idx != 0) {
+                out.append(", ");
+            }
+            prepare(member);
+            if (dpiObject_getAttributeValue(object, member.attr, member.nativeType, &data) != DPI_SUCCESS) {
+                return fail();
+            }
+            _renderMember(member, data, out);
+        }
+    }
+    out.push_back(')');
+}
+
+void ObjectLayout::_renderMember(const Member& member, dpiData& data, std::string& out) const {
+    if (data.isNull) {
+        out.append(ColumnFormatter::kNullText);
+        return;
+    }
+    if (member.nested) {
+        member.nested->_render(data.value.asObject, out);
+        dpiObject_release(data.value.asObject);
+        return;
+    }
+    const auto start = out.size();
+    out.resize(start + member.formatter.sizeBound(data));
+    const auto end = member.formatter.format(data, out.data() + start);
+    out.resize(static_cast<size_t>(end - out.data()));
+    if (member.nativeType == DPI_NATIVE_TYPE_LOB) {
+        dpiLob_release(data.value.asLOB);
+    }
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "dpi.h"
+#include "value_format.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sqlplusplus {
+
+// How the values of one object or collection type are shown, as the type's name with its
+// attributes or elements in parentheses, the way SQL*Plus shows them: POINT(1, 2), or
+// NUMBER_LIST(1, 2, 3). The attributes and their types are read from ODPI once, when a
+// column of the type is described, along with those of the object types nested in it, so
+// formatting a value only fetches the values themselves; a collection is walked index by
+// index with nothing looked up per element.
+class ObjectLayout {
+public:
+    // nullptr when the type can't be described.
+    static std::shared_ptr<const ObjectLayout> forType(dpiObjectType* type);
+
+    ObjectLayout(const ObjectLayout&) = delete;
+    ObjectLayout& operator=(const ObjectLayout&) = delete;
+    ~ObjectLayout();
+
+    // The text's size, which has to be rendered to be known, so the text is kept for a
+    // format() of the same object that follows on the same thread.
+    size_t sizeBound(dpiObject* object) const;
+    char* format(dpiObject* object, char* out) const;
+
+private:
+    struct Member {
+        // Unset for a collection's elements.
+        dpiObjectAttr* attr = nullptr;
+        dpiDataTypeInfo typeInfo{};
+        dpiNativeTypeNum nativeType = DPI_NATIVE_TYPE_BYTES;
+        ColumnFormatter formatter{DPI_NATIVE_TYPE_BYTES};
+        // For members that are objects themselves.
+        std::shared_ptr<const ObjectLayout> nested;
+    };
+
+    ObjectLayout() = default;
+    static bool _describeMember(Member& member);
+    void _render(dpiObject* object, std::string& out) const;
+    void _renderMember(const Member& member, dpiData& data, std::string& out) const;
+
+    dpiObjectType* _type = nullptr;
+    std::string _name;
+    bool _isCollection = false;
+    Member _element;
+    std::vector<Member> _attributes;
+};
+
+} // namespace sqlplusplus
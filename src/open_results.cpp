@@ -0,0 +1,88 @@
+#include "open_results.h"
+
+#include <utility>
+
+namespace sqlplusplus {
+
+std::list<OpenResults::Kept>::iterator OpenResults::_find(std::string_view name) {
+    for (auto it = _kept.begin(); it != _kept.end(); ++it) {
+        if (it->name == name) {
+            return it;
+        }
+    }
+    return _kept.end();
+}
+
+void OpenResults::_closeCursor(Entry& entry) noexcept {
+    // The statement may already be closed, or its connection gone; either way there's
+    // nothing left to release.
+    try {
+        if (entry.stmt.isOpen()) {
+            entry.stmt.close();
+        }
+    } catch (const OracleException&) {
+    }
+}
+
+std::vector<std::string> OpenResults::keep(std::string name, Entry entry) {
+    close(name);
+    _kept.push_front({std::move(name), std::move(entry), Clock::now()});
+    return _evictToCapacity();
+}
+
+std::optional<OpenResults::Entry> OpenResults::take(std::string_view name) {
+    auto it = _find(name);
+    if (it == _kept.end()) {
+        return std::nullopt;
+    }
+    auto entry = std::move(it->entry);
+    _kept.erase(it);
+    return entry;
+}
+
+bool OpenResults::close(std::string_view name) {
+    auto it = _find(name);
+    if (it == _kept.end()) {
+        return false;
+    }
+    _closeCursor(it->entry);
+    _kept.erase(it);
+    return true;
+}
+
+size_t OpenResults::closeAll() {
+    const auto numClosed = _kept.size();
+    for (auto& kept : _kept) {
+        _closeCursor(kept.entry);
+    }
+    _kept.clear();
+    return numClosed;
+}
+
+std::vector<std::string> OpenResults::setCapacity(size_t capacity) {
+    _capacity = capacity;
+    return _evictToCapacity();
+}
+
+std::vector<std::string> OpenResults::_evictToCapacity() {
+    std::vector<std::string> evicted;
+    while (_kept.size() > _capacity) {
+        auto& oldest = _kept.back();
+        _closeCursor(oldest.entry);
+        evicted.push_back(std::move(oldest.name));
+        _kept.pop_back();
+    }
+    return evicted;
+}
+
+std::vector<OpenResults::Info> OpenResults::list() const {
+    const auto now = Clock::now();
+    std::vector<Info> infos;
+    for (const auto& kept : _kept) {
+        infos.push_back({kept.name, kept.entry.sql, kept.entry.stmt.rowCount(), kept.entry.scrollable,
+                         now - kept.lastUsed});
+    }
+    return infos;
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "oracle_helpers.h"
+#include "table.h"
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+// Query results put aside by name with their cursors still open, so .more can go back to
+// them later. Each one holds a server cursor and whatever memory the server keeps for it,
+// so there's a budget: past capacity the one used least recently is closed. Closing one
+// closes its cursor on the server right away rather than whenever the last copy of the
+// statement goes.
+class OpenResults {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        OracleStatement stmt;
+        std::string sql;
+        bool scrollable = false;
+        // 1-based row number of the first row of the last page printed.
+        uint64_t pageStart = 1;
+        // The table the pages are printed with, so they keep lining up.
+        std::shared_ptr<PagedTable> pages;
+    };
+
+    struct Info {
+        std::string name;
+        std::string sql;
+        uint64_t rowsFetched = 0;
+        bool scrollable = false;
+        Clock::duration idle{};
+    };
+
+    explicit OpenResults(size_t capacity) : _capacity(capacity) {}
+    OpenResults(const OpenResults&) = delete;
+    OpenResults& operator=(const OpenResults&) = delete;
+
+    // Keeps entry as name, closing whatever had that name, and returns the names of the
+    // results closed to make room for it.
+    std::vector<std::string> keep(std::string name, Entry entry);
+    // Hands back the results named name, which are no longer kept.
+    std::optional<Entry> take(std::string_view name);
+    // Whether there were results named name to close.
+    bool close(std::string_view name);
+    // Returns how many results were closed.
+    size_t closeAll();
+
+    // Returns the names of the results closed to get down to capacity.
+    std::vector<std::string> setCapacity(size_t capacity);
+    size_t capacity() const noexcept {
+        return _capacity;
+    }
+
+    // Most recently used first.
+    std::vector<Info> list() const;
+
+private:
+    struct Kept {
+        std::string name;
+        Entry entry;
+        Clock::time_point lastUsed;
+    };
+
+    static void _closeCursor(Entry& entry) noexcept;
+    std::vector<std::string> _evictToCapacity();
+    std::list<Kept>::iterator _find(std::string_view name);
+
+    size_t _capacity;
+    // Most recently used first; there are only ever a handful, so lookups are a walk.
+    std::list<Kept> _kept;
+};
+
+} // namespace sqlplusplus
@@ -1,5 +1,13 @@
 #include "oracle_helpers.h"
+#include "client_counters.h"
 #include "dpi.h"
+#include "result_metadata.h"
+#include "trace_recorder.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iterator>
 #include <stdexcept>
 #include <string_view>
 
@@ -24,50 +32,130 @@ const std::string& OracleException::context() const {
     return _context;
 }
 
+bool OracleException::isSessionLost() const noexcept {
+    // The codes dpiError__check() marks a session dead for.
+    static constexpr int32_t kLostCodes[] = {
+        22, 28, 31, 45, 378, 602, 603, 609, 1012, 1041, 1043, 1089, 1092, 2396, 3113, 3114,
+        3122, 3135, 12153, 12537, 12547, 12570, 12583, 27146, 28511, 56600,
+    };
+    if (_errorInfo.code == 0) {
+        return std::string_view(what()).substr(0, 9) == "DPI-1010:";
+    }
+    return std::find(std::begin(kLostCodes), std::end(kLostCodes), _errorInfo.code) != std::end(kLostCodes);
+}
+
 namespace {
-void checkErr(int rc, const dpiErrorInfo &errInfo, std::string context) {
+// The checkErr helpers sit on every fetch and decode call, so the success path only compares
+// the return code. Contexts are string literals; they're only copied into a std::string once
+// we know we're going to throw.
+[[noreturn]] void throwOracleError(const dpiErrorInfo& errInfo, std::string_view context) {
+    clientCounters.add(ClientCounter::OracleErrors);
+    throw OracleException(errInfo, std::string(context));
+}
+
+[[noreturn]] void throwOracleError(std::string_view context) {
+    clientCounters.add(ClientCounter::OracleErrors);
+    throw OracleException(std::string(context));
+}
+
+inline void checkErr(int rc, const dpiErrorInfo &errInfo, std::string_view context) {
   if (rc == DPI_SUCCESS) {
     return;
   }
-
-  throw OracleException(errInfo, std::move(context));
+  throwOracleError(errInfo, context);
 }
 
-void checkErr(int rc, const OracleContext *ctx, std::string context) {
+inline void checkErr(int rc, const OracleContext *ctx, std::string_view context) {
   if (rc == DPI_SUCCESS) {
     return;
   }
-  throw OracleException(ctx->getLastError(), std::move(context));
+  throwOracleError(ctx->getLastError(), context);
 }
 
-void checkErr(bool ok, std::string context) {
+inline void checkErr(bool ok, std::string_view context) {
     if (!ok) {
-        throw OracleException(std::move(context));
+        throwOracleError(context);
     }
 }
+
+// What a value costs to take out of its define buffer, as counted by the fetch limits and
+// the bytes decoded counter.
+inline uint64_t decodedBytes(dpiNativeTypeNum typeNum, const dpiData& data) {
+    if (data.isNull) {
+        return 0;
+    }
+    return typeNum == DPI_NATIVE_TYPE_BYTES ? data.value.asBytes.length : sizeof(dpiDataBuffer);
+}
+
+// A sharding key's columns as ODPI takes them, pointing into the key's values, so the key
+// has to outlive the connect they're passed to.
+class ShardingKeyParams {
+public:
+    explicit ShardingKeyParams(const OracleShardingKey& key)
+        : _columns(_convert(key.columns)),
+          _superColumns(_convert(key.superColumns))
+    {}
+
+    void apply(dpiConnCreateParams& params) {
+        params.shardingKeyColumns = _columns.empty() ? nullptr : _columns.data();
+        params.numShardingKeyColumns = static_cast<uint8_t>(_columns.size());
+        params.superShardingKeyColumns = _superColumns.empty() ? nullptr : _superColumns.data();
+        params.numSuperShardingKeyColumns = static_cast<uint8_t>(_superColumns.size());
+    }
+
+private:
+    // Numbers go as their text, which the client converts, so they're exact.
+    static std::vector<dpiShardingKeyColumn> _convert(const std::vector<OracleShardingKeyColumn>& columns) {
+        std::vector<dpiShardingKeyColumn> out;
+        out.reserve(columns.size());
+        for (const auto& column : columns) {
+            dpiShardingKeyColumn converted{};
+            converted.oracleTypeNum = column.type;
+            converted.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+            converted.value.asBytes.ptr = const_cast<char*>(column.value.data());
+            converted.value.asBytes.length = static_cast<uint32_t>(column.value.size());
+            out.push_back(converted);
+        }
+        return out;
+    }
+
+    std::vector<dpiShardingKeyColumn> _columns;
+    std::vector<dpiShardingKeyColumn> _superColumns;
+};
+}
+
+uint64_t OracleFetchBlock::valueBytes() const noexcept {
+    uint64_t bytes = 0;
+    for (const auto& column : _columns) {
+        for (uint32_t row = 0; row < _numRows; ++row) {
+            bytes += decodedBytes(column.typeNum, column.data[row]);
+        }
+    }
+    return bytes;
 }
 
 OracleRowId::OracleRowId(const OracleRowId& other) :
     _rowId(other._rowId)
 {
-    dpiRowid_addRef(_rowId);
-    _initStrValue();
+    if (_rowId != nullptr) {
+        dpiRowid_addRef(_rowId);
+    }
 }
 
 OracleRowId::OracleRowId(OracleRowId&& other) noexcept :
     _rowId(other._rowId)
 {
     other._rowId = nullptr;
-    _initStrValue();
 }
 
 OracleRowId& OracleRowId::operator=(const OracleRowId& other) {
+    if (other._rowId != nullptr) {
+        dpiRowid_addRef(other._rowId);
+    }
     if (_rowId != nullptr) {
         dpiRowid_release(_rowId);
     }
     _rowId = other._rowId;
-    dpiRowid_addRef(_rowId);
-    _initStrValue();
     return *this;
 }
 
@@ -77,7 +165,6 @@ OracleRowId& OracleRowId::operator=(OracleRowId&& other) noexcept {
         _rowId = nullptr;
     }
     std::swap(_rowId, other._rowId);
-    _initStrValue();
     return *this;
 }
 
@@ -87,49 +174,46 @@ OracleRowId::~OracleRowId() {
     }
 }
 
-void OracleRowId::_initStrValue() {
+OracleRowId::operator std::string_view() const {
+    return rowidText(_rowId);
+}
+
+std::string_view rowidText(dpiRowid* rowid) noexcept {
     const char* strValue = nullptr;
     uint32_t strSize = 0;
-
-    dpiRowid_getStringValue(_rowId, &strValue, &strSize);
-    _strValue = std::string_view(strValue, strSize);
+    if (rowid == nullptr || dpiRowid_getStringValue(rowid, &strValue, &strSize) != DPI_SUCCESS) {
+        return {};
+    }
+    return std::string_view(strValue, strSize);
 }
 
 
-OracleVariable::OracleVariable(const OracleVariable& other) :
-    _ctx(other._ctx),
-    _var(other._var)
-{
-    dpiVar_addRef(_var);
-}
-
 OracleVariable::OracleVariable(OracleVariable&& other) noexcept :
     _ctx(other._ctx),
-    _var(other._var)
+    _nativeType(other._nativeType),
+    _var(other._var),
+    _allocatedData(std::move(other._allocatedData))
 {
     other._var = nullptr;
 }
 
-OracleVariable& OracleVariable::operator=(const OracleVariable& other) {
-    if (_var != nullptr) {
-        dpiVar_release(_var);
-    }
-    _ctx = other._ctx;
-    _var = other._var;
-    dpiVar_addRef(_var);
-    return *this;
-}
-
 OracleVariable& OracleVariable::operator=(OracleVariable&& other) noexcept {
     if (_var != nullptr) {
         dpiVar_release(_var);
         _var = nullptr;
     }
     _ctx = other._ctx;
+    _nativeType = other._nativeType;
     std::swap(_var, other._var);
+    _allocatedData = std::move(other._allocatedData);
     return *this;
 }
 
+OracleVariable OracleVariable::share() const {
+    dpiVar_addRef(_var);
+    return OracleVariable(_ctx, _nativeType, _var, _allocatedData);
+}
+
 OracleVariable::~OracleVariable() {
     if (_var != nullptr) {
         dpiVar_release(_var);
@@ -162,6 +246,36 @@ void OracleVariable::setFrom(uint32_t pos, const OracleRowId& rowid) {
     checkErr(rc, _ctx, "copying from row id to variable");
 }
 
+void OracleVariable::setFrom(uint32_t pos, int64_t value) {
+    checkErr(_nativeType == DPI_NATIVE_TYPE_INT64, "variable is not int64_t");
+    checkErr(pos < _allocatedData.size(), "variable position is out of range");
+    dpiData_setInt64(_allocatedData[pos]._data, value);
+}
+
+void OracleVariable::setFrom(uint32_t pos, double value) {
+    checkErr(_nativeType == DPI_NATIVE_TYPE_DOUBLE, "variable is not double");
+    checkErr(pos < _allocatedData.size(), "variable position is out of range");
+    dpiData_setDouble(_allocatedData[pos]._data, value);
+}
+
+void OracleVariable::setFrom(uint32_t pos, const dpiTimestamp& value) {
+    checkErr(_nativeType == DPI_NATIVE_TYPE_TIMESTAMP, "variable is not a timestamp");
+    checkErr(pos < _allocatedData.size(), "variable position is out of range");
+    dpiData_setTimestamp(_allocatedData[pos]._data, value.year, value.month, value.day, value.hour,
+                         value.minute, value.second, value.fsecond, value.tzHourOffset,
+                         value.tzMinuteOffset);
+}
+
+void OracleVariable::setNull(uint32_t pos) {
+    checkErr(pos < _allocatedData.size(), "variable position is out of range");
+    dpiData_setNull(_allocatedData[pos]._data);
+}
+
+void OracleVariable::setNumElementsInArray(uint32_t numElements) {
+    auto rc = dpiVar_setNumElementsInArray(_var, numElements);
+    checkErr(rc, _ctx, "setting number of elements in oracle variable");
+}
+
 uint32_t OracleVariable::numElements() const {
     uint32_t res = 0;
     auto rc = dpiVar_getNumElementsInArray(_var, &res);
@@ -176,93 +290,96 @@ uint32_t OracleVariable::sizeInBytes() const {
     return res;
 }
 
-std::vector<OracleData> OracleVariable::returnedData(uint32_t pos) const {
+OracleReturnedData OracleVariable::returnedData(uint32_t pos) const {
     uint32_t numElements = 0;
     dpiData* data = nullptr;
 
     auto rc = dpiVar_getReturnedData(_var, pos, &numElements, &data);
     checkErr(rc, _ctx, "getting returned data from oracle variable");
-
-    std::vector<OracleData> ret;
-    ret.reserve(numElements);
-    for (uint32_t idx = 0; idx < numElements; idx++) {
-        ret.emplace_back(_nativeType, &data[idx]);
-    }
-
-    return ret;
+    return OracleReturnedData(_nativeType, data, numElements);
 }
 
 const std::vector<OracleData>& OracleVariable::allocatedData() const {
     return _allocatedData;
 }
 
-OracleConnection::OracleConnection(const OracleConnection& other) :
-    _ctx(other._ctx),
-    _conn(other._conn)
-{
-    dpiConn_addRef(_conn);
+OracleStatement OracleVariable::statementAt(uint32_t pos) const {
+    checkErr(pos < _allocatedData.size(), "REF CURSOR position is out of range");
+    checkErr(_nativeType == DPI_NATIVE_TYPE_STMT, "variable is not a REF CURSOR");
+    auto stmt = dpiData_getStmt(_allocatedData[pos]._data);
+    checkErr(stmt != nullptr, "REF CURSOR variable holds no cursor");
+    // The variable keeps its own reference.
+    auto rc = dpiStmt_addRef(stmt);
+    checkErr(rc, _ctx, "error referencing REF CURSOR");
+    return OracleStatement(_ctx, stmt);
 }
 
 OracleConnection::OracleConnection(OracleConnection&& other) noexcept :
     _ctx(other._ctx),
-    _conn(other._conn)
+    _conn(other._conn),
+    _sessionTag(std::move(other._sessionTag)),
+    _newSession(other._newSession),
+    _releaseTag(std::move(other._releaseTag))
 {
     other._conn = nullptr;
     other._ctx = nullptr;
 }
 
-OracleConnection& OracleConnection::operator=(const OracleConnection& other) {
-    if (_conn != nullptr) {
-        dpiConn_release(_conn);
-    }
-    _ctx = other._ctx;
-    _conn = other._conn;
-    dpiConn_addRef(_conn);
-    return *this;
-}
-
 OracleConnection& OracleConnection::operator=(OracleConnection&& other) noexcept {
-    if (_conn != nullptr) {
-        dpiConn_release(_conn);
-        _conn = nullptr;
-    }
+    _release();
+    _conn = nullptr;
     _ctx = nullptr;
     std::swap(_ctx, other._ctx);
     std::swap(_conn, other._conn);
+    _sessionTag = std::move(other._sessionTag);
+    _newSession = other._newSession;
+    _releaseTag = std::move(other._releaseTag);
     return *this;
 }
 
+OracleConnection OracleConnection::share() const {
+    dpiConn_addRef(_conn);
+    OracleConnection shared(_ctx, _conn);
+    shared._sessionTag = _sessionTag;
+    shared._newSession = _newSession;
+    shared._releaseTag = _releaseTag;
+    return shared;
+}
+
 OracleConnection::~OracleConnection() {
-    if (_conn != nullptr) {
-        dpiConn_release(_conn);
+    _release();
+}
+
+void OracleConnection::_release() noexcept {
+    if (_conn == nullptr) {
+        return;
     }
+    if (_releaseTag && _releaseTag.use_count() == 1) {
+        // A failed retag still leaves the session to be released below, just untagged.
+        dpiConn_close(_conn, DPI_MODE_CONN_CLOSE_RETAG, _releaseTag->data(),
+                      static_cast<uint32_t>(_releaseTag->size()));
+    }
+    _releaseTag.reset();
+    dpiConn_release(_conn);
 }
 
-OracleStatement::OracleStatement(const OracleStatement& other) :
-    _ctx(other._ctx),
-    _statement(other._statement)
-{
-    dpiStmt_addRef(_statement);
+void OracleConnection::setReleaseTag(std::string tag) {
+    _releaseTag = std::make_shared<const std::string>(std::move(tag));
 }
 
 OracleStatement::OracleStatement(OracleStatement&& other) noexcept :
     _ctx(other._ctx),
-    _statement(other._statement)
+    _statement(other._statement),
+    _limits(other._limits),
+    _lobInlining(std::move(other._lobInlining)),
+    _adaptiveFetch(std::move(other._adaptiveFetch)),
+    _metadata(std::move(other._metadata)),
+    _exactNumbers(other._exactNumbers)
 {
     other._statement = nullptr;
     other._ctx = nullptr;
 }
 
-OracleStatement& OracleStatement::operator=(const OracleStatement& other) {
-    if (_statement != nullptr) {
-        dpiStmt_release(_statement);
-    }
-    _ctx = other._ctx;
-    _statement = other._statement;
-    dpiStmt_addRef(_statement);
-    return *this;
-}
-
 OracleStatement& OracleStatement::operator=(OracleStatement&& other) noexcept {
     if (_statement != nullptr) {
         dpiStmt_release(_statement);
@@ -271,22 +388,42 @@ OracleStatement& OracleStatement::operator=(OracleStatement&& other) noexcept {
     _ctx = nullptr;
     std::swap(_ctx, other._ctx);
     std::swap(_statement, other._statement);
+    _limits = other._limits;
+    _lobInlining = std::move(other._lobInlining);
+    _adaptiveFetch = std::move(other._adaptiveFetch);
+    _metadata = std::move(other._metadata);
+    _exactNumbers = other._exactNumbers;
     return *this;
 }
 
+OracleStatement OracleStatement::share() const {
+    dpiStmt_addRef(_statement);
+    OracleStatement shared(_ctx, _statement);
+    shared._limits = _limits;
+    shared._lobInlining = _lobInlining;
+    shared._adaptiveFetch = _adaptiveFetch;
+    shared._metadata = _metadata;
+    shared._exactNumbers = _exactNumbers;
+    return shared;
+}
+
 OracleStatement::~OracleStatement() {
     if (_statement != nullptr) {
         dpiStmt_release(_statement);
     }
 }
 
-std::unique_ptr<OracleContext> OracleContext::make() {
+std::unique_ptr<OracleContext> OracleContext::make(const std::string& configDir) {
+    dpiContextCreateParams params{};
+    if (!configDir.empty()) {
+        params.oracleClientConfigDir = configDir.c_str();
+    }
     dpiErrorInfo errInfo;
     dpiContext* ctx;
     auto rc = dpiContext_createWithParams(
         DPI_MAJOR_VERSION,
         DPI_MINOR_VERSION,
-        nullptr,
+        &params,
         &ctx,
         &errInfo
     );
@@ -300,10 +437,82 @@ OracleContext::~OracleContext() {
     }
 }
 
+std::string normalizeIdentifier(std::string_view name, bool allowQualifier) {
+    auto invalid = [&] {
+        return std::runtime_error("invalid identifier " + std::string(name));
+    };
+    std::string ret;
+    ret.reserve(name.size());
+    bool seenDot = false;
+    for (auto ch : name) {
+        auto uch = static_cast<unsigned char>(ch);
+        if (ch == '.') {
+            if (!allowQualifier || seenDot || ret.empty()) {
+                throw invalid();
+            }
+            seenDot = true;
+        } else if (!std::isalnum(uch) && ch != '_' && ch != '$' && ch != '#') {
+            throw invalid();
+        }
+        ret.push_back(static_cast<char>(std::toupper(uch)));
+    }
+    if (ret.empty() || ret.back() == '.') {
+        throw invalid();
+    }
+    return ret;
+}
+
+std::pair<std::optional<std::string>, std::string> splitOwner(const std::string& name) {
+    const auto dot = name.find('.');
+    if (dot == std::string::npos) {
+        return {std::nullopt, name};
+    }
+    return {name.substr(0, dot), name.substr(dot + 1)};
+}
+
+namespace {
+
+// Every pool and standalone connection gets an OCI environment of its own, made with these.
+// Threaded mode is what has ODPI lock the reference counts of the handles made in it, which
+// handles shared between threads depend on.
+dpiCommonCreateParams commonCreateParams(OracleContext* ctx, const OracleConnectionOptions& opts) {
+    dpiCommonCreateParams commonParams;
+    auto rc = dpiContext_initCommonCreateParams(ctx->get(), &commonParams);
+    checkErr(rc, ctx, "error initializing connection parameters");
+    auto mode = commonParams.createMode | DPI_MODE_CREATE_THREADED;
+    if (opts.events) {
+        mode |= DPI_MODE_CREATE_EVENTS;
+    }
+    commonParams.createMode = static_cast<dpiCreateMode>(mode);
+    return commonParams;
+}
+
+} // namespace
+
 OracleConnectionPool OracleConnectionPool::make(
         OracleContext* ctx, const OracleConnectionOptions& opts) {
+    auto commonParams = commonCreateParams(ctx, opts);
+
+    const auto poolOpts = opts.pool.value_or(OracleConnectionPoolOptions{});
+    dpiPoolCreateParams poolParams;
+    auto rc = dpiContext_initPoolCreateParams(ctx->get(), &poolParams);
+    checkErr(rc, ctx, "error initializing connection pool parameters");
+    poolParams.minSessions = poolOpts.minSessions;
+    poolParams.maxSessions = poolOpts.maxSessions;
+    poolParams.sessionIncrement = poolOpts.sessionIncrement;
+    poolParams.getMode = poolOpts.getMode;
+    poolParams.pingInterval = poolOpts.pingInterval;
+    poolParams.timeout = poolOpts.timeout;
+    poolParams.waitTimeout = poolOpts.waitTimeout;
+    poolParams.maxLifetimeSession = poolOpts.maxLifetimeSession;
+    poolParams.homogeneous = poolOpts.homogeneous ? 1 : 0;
+    if (!poolOpts.plsqlFixupCallback.empty()) {
+        poolParams.plsqlFixupCallback = poolOpts.plsqlFixupCallback.c_str();
+        poolParams.plsqlFixupCallbackLength = static_cast<uint32_t>(poolOpts.plsqlFixupCallback.size());
+    }
+
     dpiPool* pool;
-    auto rc = dpiPool_create(
+    rc = dpiPool_create(
             ctx->get(),
             opts.username.c_str(),
             opts.username.size(),
@@ -311,48 +520,474 @@ OracleConnectionPool OracleConnectionPool::make(
             opts.password.size(),
             opts.connString.c_str(),
             opts.connString.size(),
-            nullptr,
-            nullptr,
+            &commonParams,
+            &poolParams,
             &pool);
     checkErr(rc, ctx, "error creating oracle connection pool");
-    return OracleConnectionPool(ctx, pool);
+    if (opts.stmtCacheSize) {
+        rc = dpiPool_setStmtCacheSize(pool, *opts.stmtCacheSize);
+        checkErr(rc, ctx, "error setting oracle statement cache size");
+    }
+    OracleConnectionPool ret(ctx, pool);
+    ret._connectionClass = opts.connectionClass;
+    ret._purity = opts.purity;
+    return ret;
+}
+
+OracleConnectionPool::OracleConnectionPool(OracleConnectionPool&& other) noexcept :
+    _ctx(other._ctx),
+    _pool(other._pool),
+    _connectionClass(std::move(other._connectionClass)),
+    _purity(other._purity)
+{
+    other._ctx = nullptr;
+    other._pool = nullptr;
+}
+
+OracleConnectionPool& OracleConnectionPool::operator=(OracleConnectionPool&& other) noexcept {
+    if (_pool != nullptr) {
+        dpiPool_release(_pool);
+        _pool = nullptr;
+    }
+    _ctx = nullptr;
+    std::swap(_ctx, other._ctx);
+    std::swap(_pool, other._pool);
+    _connectionClass = std::move(other._connectionClass);
+    _purity = other._purity;
+    return *this;
+}
+
+OracleConnectionPool::~OracleConnectionPool() {
+    // Connections acquired from the pool hold their own reference to it.
+    if (_pool != nullptr) {
+        dpiPool_release(_pool);
+    }
 }
 
 OracleConnection OracleConnectionPool::acquireConnection() {
+    return acquireConnection({}, {});
+}
+
+OracleConnection OracleConnectionPool::acquireConnection(std::string_view username, std::string_view password,
+                                                         std::string_view tag, bool matchAnyTag,
+                                                         const OracleShardingKey& shardingKey) {
+    dpiConnCreateParams params;
+    auto rc = dpiContext_initConnCreateParams(_ctx->get(), &params);
+    checkErr(rc, _ctx, "error initializing connection parameters");
+    params.connectionClass = _connectionClass.empty() ? nullptr : _connectionClass.data();
+    params.connectionClassLength = static_cast<uint32_t>(_connectionClass.size());
+    params.purity = _purity;
+    params.tag = tag.empty() ? nullptr : tag.data();
+    params.tagLength = static_cast<uint32_t>(tag.size());
+    params.matchAnyTag = matchAnyTag ? 1 : 0;
+    ShardingKeyParams sharding(shardingKey);
+    sharding.apply(params);
+
     dpiConn* conn;
-    int rc = dpiPool_acquireConnection(_pool, nullptr, 0, nullptr, 0, nullptr, &conn);
+    rc = dpiPool_acquireConnection(
+            _pool,
+            username.empty() ? nullptr : username.data(),
+            username.size(),
+            password.empty() ? nullptr : password.data(),
+            password.size(),
+            &params,
+            &conn);
     checkErr(rc, _ctx, "error acquiring oracle connection");
 
-    return OracleConnection(_ctx, conn);
+    OracleConnection ret(_ctx, conn);
+    if (params.outTagFound) {
+        ret._sessionTag.assign(params.outTag, params.outTagLength);
+    }
+    ret._newSession = params.outNewSession != 0;
+    return ret;
+}
+
+uint32_t OracleConnectionPool::openCount() const {
+    uint32_t value = 0;
+    auto rc = dpiPool_getOpenCount(_pool, &value);
+    checkErr(rc, _ctx, "error getting pool open count");
+    return value;
+}
+
+uint32_t OracleConnectionPool::busyCount() const {
+    uint32_t value = 0;
+    auto rc = dpiPool_getBusyCount(_pool, &value);
+    checkErr(rc, _ctx, "error getting pool busy count");
+    return value;
 }
 
 OracleConnection OracleConnection::make(OracleContext *ctx, const OracleConnectionOptions &opts) {
+    auto commonParams = commonCreateParams(ctx, opts);
+
+    dpiConnCreateParams connParams;
+    dpiConnCreateParams* connParamsPtr = nullptr;
+    ShardingKeyParams sharding(opts.shardingKey);
+    if (!opts.connectionClass.empty() || opts.purity != DPI_PURITY_DEFAULT || !opts.shardingKey.empty()) {
+        auto rc = dpiContext_initConnCreateParams(ctx->get(), &connParams);
+        checkErr(rc, ctx, "error initializing connection parameters");
+        connParams.connectionClass = opts.connectionClass.empty() ? nullptr : opts.connectionClass.data();
+        connParams.connectionClassLength = static_cast<uint32_t>(opts.connectionClass.size());
+        connParams.purity = opts.purity;
+        sharding.apply(connParams);
+        connParamsPtr = &connParams;
+    }
+
+    const auto username = opts.proxyUser.empty() ? opts.username
+                                                 : fmt::format("{}[{}]", opts.username, opts.proxyUser);
     dpiConn* conn;
     auto rc = dpiConn_create(
             ctx->get(),
-            opts.username.c_str(),
-            opts.username.size(),
+            username.c_str(),
+            username.size(),
             opts.password.c_str(),
             opts.password.size(),
             opts.connString.c_str(),
             opts.connString.size(),
-            nullptr,
-            nullptr,
+            &commonParams,
+            connParamsPtr,
             &conn);
 
     checkErr(rc, ctx, "error creating oracle connection");
 
-    return OracleConnection(ctx, conn);
+    OracleConnection ret(ctx, conn);
+    if (opts.stmtCacheSize) {
+        rc = dpiConn_setStmtCacheSize(conn, *opts.stmtCacheSize);
+        checkErr(rc, ctx, "error setting oracle statement cache size");
+    }
+    ret.applyTags(opts);
+    return ret;
 }
 
-OracleStatement OracleConnection::prepareStatement(std::string_view sql) {
+OracleStatement OracleConnection::prepareStatement(std::string_view sql, bool scrollable) {
+    TraceSpan span("prepare");
     dpiStmt* stmt = nullptr;
-    int rc = dpiConn_prepareStmt(_conn, 0, sql.data(), sql.size(), nullptr, 0, &stmt);
+    int rc = dpiConn_prepareStmt(_conn, scrollable, sql.data(), sql.size(), nullptr, 0, &stmt);
     checkErr(rc, _ctx, "error preparing oracle statement");
 
     return OracleStatement(_ctx, stmt);
 }
 
+OracleSubscription OracleConnection::subscribeObjectChanges(
+        uint32_t operations, std::function<void(const dpiSubscrMessage&)> callback, bool rowids) {
+    return _subscribe(operations, rowids ? DPI_SUBSCR_QOS_ROWIDS : 0, std::move(callback));
+}
+
+OracleSubscription OracleConnection::subscribeQueryChanges(std::function<void(const dpiSubscrMessage&)> callback) {
+    return _subscribe(DPI_OPCODE_ALL_OPS, DPI_SUBSCR_QOS_QUERY, std::move(callback));
+}
+
+OracleSubscription OracleConnection::_subscribe(
+        uint32_t operations, uint32_t qos, std::function<void(const dpiSubscrMessage&)> callback) {
+    dpiSubscrCreateParams params;
+    auto rc = dpiContext_initSubscrCreateParams(_ctx->get(), &params);
+    checkErr(rc, _ctx, "error initializing subscription parameters");
+
+    auto callbackPtr = std::make_unique<OracleSubscription::Callback>(std::move(callback));
+    params.subscrNamespace = DPI_SUBSCR_NAMESPACE_DBCHANGE;
+    params.protocol = DPI_SUBSCR_PROTO_CALLBACK;
+    params.operations = static_cast<dpiOpCode>(operations);
+    params.qos = static_cast<dpiSubscrQOS>(qos);
+    params.callback = [](void* context, dpiSubscrMessage* message) {
+        (*static_cast<OracleSubscription::Callback*>(context))(*message);
+    };
+    params.callbackContext = callbackPtr.get();
+
+    dpiSubscr* subscr = nullptr;
+    rc = dpiConn_subscribe(_conn, &params, &subscr);
+    checkErr(rc, _ctx, "error subscribing to object change notifications");
+
+    dpiConn_addRef(_conn);
+    return OracleSubscription(_ctx, _conn, subscr, std::move(callbackPtr), (qos & DPI_SUBSCR_QOS_QUERY) != 0);
+}
+
+OracleQueue OracleConnection::openQueue(std::string_view name) {
+    dpiQueue* queue = nullptr;
+    auto rc = dpiConn_newQueue(_conn, name.data(), static_cast<uint32_t>(name.size()), nullptr, &queue);
+    checkErr(rc, _ctx, fmt::format("error opening queue {}", name));
+    OracleQueue result(_ctx, _conn, queue);
+    dpiConn_addRef(_conn);
+
+    dpiDeqOptions* deqOptions = nullptr;
+    rc = dpiQueue_getDeqOptions(queue, &deqOptions);
+    checkErr(rc, _ctx, "error getting dequeue options");
+    rc = dpiDeqOptions_setVisibility(deqOptions, DPI_VISIBILITY_IMMEDIATE);
+    checkErr(rc, _ctx, "error setting dequeue visibility");
+    dpiEnqOptions* enqOptions = nullptr;
+    rc = dpiQueue_getEnqOptions(queue, &enqOptions);
+    checkErr(rc, _ctx, "error getting enqueue options");
+    rc = dpiEnqOptions_setVisibility(enqOptions, DPI_VISIBILITY_IMMEDIATE);
+    checkErr(rc, _ctx, "error setting enqueue visibility");
+    return result;
+}
+
+OracleQueue::OracleQueue(OracleQueue&& other) noexcept :
+    _ctx(other._ctx),
+    _conn(std::exchange(other._conn, nullptr)),
+    _queue(std::exchange(other._queue, nullptr)),
+    _enqueueProps(std::move(other._enqueueProps)),
+    _dequeueProps(std::move(other._dequeueProps))
+{}
+
+OracleQueue& OracleQueue::operator=(OracleQueue&& other) noexcept {
+    if (this != &other) {
+        _release();
+        _ctx = other._ctx;
+        _conn = std::exchange(other._conn, nullptr);
+        _queue = std::exchange(other._queue, nullptr);
+        _enqueueProps = std::move(other._enqueueProps);
+        _dequeueProps = std::move(other._dequeueProps);
+    }
+    return *this;
+}
+
+OracleQueue::~OracleQueue() {
+    _release();
+}
+
+void OracleQueue::_release() noexcept {
+    for (auto props : _enqueueProps) {
+        dpiMsgProps_release(props);
+    }
+    _enqueueProps.clear();
+    if (_queue != nullptr) {
+        dpiQueue_release(_queue);
+        _queue = nullptr;
+    }
+    if (_conn != nullptr) {
+        dpiConn_release(_conn);
+        _conn = nullptr;
+    }
+}
+
+void OracleQueue::setConsumerName(std::string_view name) {
+    dpiDeqOptions* options = nullptr;
+    auto rc = dpiQueue_getDeqOptions(_queue, &options);
+    checkErr(rc, _ctx, "error getting dequeue options");
+    rc = dpiDeqOptions_setConsumerName(options, name.data(), static_cast<uint32_t>(name.size()));
+    checkErr(rc, _ctx, "error setting dequeue consumer name");
+}
+
+uint32_t OracleQueue::dequeue(uint32_t maxMessages, uint32_t waitSeconds,
+                              const std::function<void(std::string_view payload)>& onMessage) {
+    dpiDeqOptions* options = nullptr;
+    auto rc = dpiQueue_getDeqOptions(_queue, &options);
+    checkErr(rc, _ctx, "error getting dequeue options");
+    rc = dpiDeqOptions_setWait(options, waitSeconds);
+    checkErr(rc, _ctx, "error setting dequeue wait");
+
+    // Each dequeue hands back new references; only the array they land in is reused.
+    _dequeueProps.resize(std::max<uint32_t>(maxMessages, 1));
+    uint32_t numProps = static_cast<uint32_t>(_dequeueProps.size());
+    TraceSpan span("dequeue");
+    rc = dpiQueue_deqMany(_queue, &numProps, _dequeueProps.data());
+    checkErr(rc, _ctx, "error dequeuing messages");
+    span.setArg("messages", numProps);
+
+    struct Releaser {
+        dpiMsgProps** props;
+        uint32_t count;
+        ~Releaser() {
+            for (uint32_t idx = 0; idx < count; ++idx) {
+                dpiMsgProps_release(props[idx]);
+            }
+        }
+    } releaser{_dequeueProps.data(), numProps};
+    for (uint32_t idx = 0; idx < numProps; ++idx) {
+        dpiObject* object = nullptr;
+        const char* payload = nullptr;
+        uint32_t payloadLength = 0;
+        rc = dpiMsgProps_getPayload(_dequeueProps[idx], &object, &payload, &payloadLength);
+        checkErr(rc, _ctx, "error getting message payload");
+        onMessage(std::string_view(payload, payloadLength));
+    }
+    return numProps;
+}
+
+void OracleQueue::enqueue(const std::vector<std::string_view>& payloads) {
+    if (payloads.empty()) {
+        return;
+    }
+    while (_enqueueProps.size() < payloads.size()) {
+        dpiMsgProps* props = nullptr;
+        auto rc = dpiConn_newMsgProps(_conn, &props);
+        checkErr(rc, _ctx, "error creating message properties");
+        _enqueueProps.push_back(props);
+    }
+    for (size_t idx = 0; idx < payloads.size(); ++idx) {
+        auto rc = dpiMsgProps_setPayloadBytes(_enqueueProps[idx], payloads[idx].data(),
+                                              static_cast<uint32_t>(payloads[idx].size()));
+        checkErr(rc, _ctx, "error setting message payload");
+    }
+    TraceSpan span("enqueue");
+    span.setArg("messages", payloads.size());
+    auto rc = dpiQueue_enqMany(_queue, static_cast<uint32_t>(payloads.size()), _enqueueProps.data());
+    checkErr(rc, _ctx, "error enqueuing messages");
+}
+
+OracleSodaCollection OracleConnection::openSodaCollection(std::string_view name) {
+    dpiSodaDb* db = nullptr;
+    auto rc = dpiConn_getSodaDb(_conn, &db);
+    checkErr(rc, _ctx, "error getting SODA database");
+    dpiSodaColl* coll = nullptr;
+    rc = dpiSodaDb_openCollection(db, name.data(), static_cast<uint32_t>(name.size()), DPI_SODA_FLAGS_DEFAULT, &coll);
+    OracleSodaCollection result(_ctx, db, coll);
+    checkErr(rc, _ctx, fmt::format("error opening SODA collection {}", name));
+    if (coll == nullptr) {
+        throw std::runtime_error(fmt::format("no SODA collection named {}", name));
+    }
+    return result;
+}
+
+OracleSodaCollection::OracleSodaCollection(OracleSodaCollection&& other) noexcept :
+    _ctx(other._ctx),
+    _db(std::exchange(other._db, nullptr)),
+    _coll(std::exchange(other._coll, nullptr))
+{}
+
+OracleSodaCollection& OracleSodaCollection::operator=(OracleSodaCollection&& other) noexcept {
+    if (this != &other) {
+        _release();
+        _ctx = other._ctx;
+        _db = std::exchange(other._db, nullptr);
+        _coll = std::exchange(other._coll, nullptr);
+    }
+    return *this;
+}
+
+OracleSodaCollection::~OracleSodaCollection() {
+    _release();
+}
+
+void OracleSodaCollection::_release() noexcept {
+    if (_coll != nullptr) {
+        dpiSodaColl_release(_coll);
+        _coll = nullptr;
+    }
+    if (_db != nullptr) {
+        dpiSodaDb_release(_db);
+        _db = nullptr;
+    }
+}
+
+uint64_t OracleSodaCollection::find(std::string_view filter, uint32_t fetchArraySize,
+                                    const std::function<void(std::string_view content)>& onDocument) {
+    dpiSodaOperOptions options;
+    auto rc = dpiContext_initSodaOperOptions(_ctx->get(), &options);
+    checkErr(rc, _ctx, "error initializing SODA operation options");
+    if (!filter.empty()) {
+        options.filter = filter.data();
+        options.filterLength = static_cast<uint32_t>(filter.size());
+    }
+    options.fetchArraySize = fetchArraySize;
+
+    dpiSodaDocCursor* cursor = nullptr;
+    {
+        TraceSpan span("execute");
+        rc = dpiSodaColl_find(_coll, &options, DPI_SODA_FLAGS_DEFAULT, &cursor);
+        checkErr(rc, _ctx, "error finding SODA documents");
+    }
+    std::unique_ptr<dpiSodaDocCursor, int (*)(dpiSodaDocCursor*)> cursorRef(cursor, dpiSodaDocCursor_release);
+    uint64_t numDocs = 0;
+    for (;;) {
+        dpiSodaDoc* doc = nullptr;
+        rc = dpiSodaDocCursor_getNext(cursor, DPI_SODA_FLAGS_DEFAULT, &doc);
+        checkErr(rc, _ctx, "error fetching SODA document");
+        if (doc == nullptr) {
+            break;
+        }
+        std::unique_ptr<dpiSodaDoc, int (*)(dpiSodaDoc*)> docRef(doc, dpiSodaDoc_release);
+        const char* content = nullptr;
+        uint32_t contentLength = 0;
+        const char* encoding = nullptr;
+        rc = dpiSodaDoc_getContent(doc, &content, &contentLength, &encoding);
+        checkErr(rc, _ctx, "error getting SODA document content");
+        onDocument(std::string_view(content, contentLength));
+        ++numDocs;
+    }
+    return numDocs;
+}
+
+void OracleSodaCollection::insertMany(const std::vector<std::string_view>& contents) {
+    if (contents.empty()) {
+        return;
+    }
+    std::vector<std::unique_ptr<dpiSodaDoc, int (*)(dpiSodaDoc*)>> docRefs;
+    std::vector<dpiSodaDoc*> docs;
+    docRefs.reserve(contents.size());
+    docs.reserve(contents.size());
+    for (const auto& content : contents) {
+        dpiSodaDoc* doc = nullptr;
+        auto rc = dpiSodaDb_createDocument(_db, nullptr, 0, content.data(), static_cast<uint32_t>(content.size()),
+                                           nullptr, 0, DPI_SODA_FLAGS_DEFAULT, &doc);
+        checkErr(rc, _ctx, "error creating SODA document");
+        docRefs.emplace_back(doc, dpiSodaDoc_release);
+        docs.push_back(doc);
+    }
+    TraceSpan span("execute");
+    span.setArg("documents", docs.size());
+    auto rc = dpiSodaColl_insertMany(_coll, static_cast<uint32_t>(docs.size()), docs.data(),
+                                     DPI_SODA_FLAGS_ATOMIC_COMMIT, nullptr);
+    checkErr(rc, _ctx, "error inserting SODA documents");
+}
+
+OracleSubscription::OracleSubscription(OracleSubscription&& other) noexcept :
+    _ctx(other._ctx),
+    _conn(other._conn),
+    _subscr(other._subscr),
+    _callback(std::move(other._callback)),
+    _queryLevel(other._queryLevel)
+{
+    other._ctx = nullptr;
+    other._conn = nullptr;
+    other._subscr = nullptr;
+}
+
+OracleSubscription& OracleSubscription::operator=(OracleSubscription&& other) noexcept {
+    _unsubscribe();
+    std::swap(_ctx, other._ctx);
+    std::swap(_conn, other._conn);
+    std::swap(_subscr, other._subscr);
+    std::swap(_callback, other._callback);
+    std::swap(_queryLevel, other._queryLevel);
+    return *this;
+}
+
+OracleSubscription::~OracleSubscription() {
+    _unsubscribe();
+}
+
+void OracleSubscription::_unsubscribe() noexcept {
+    if (_subscr != nullptr) {
+        // No notifications are delivered once this succeeds; it also drops our reference to
+        // the subscription, which is left to us if it fails.
+        if (dpiConn_unsubscribe(_conn, _subscr) != DPI_SUCCESS) {
+            dpiSubscr_release(_subscr);
+        }
+        _subscr = nullptr;
+    }
+    if (_conn != nullptr) {
+        dpiConn_release(_conn);
+        _conn = nullptr;
+    }
+}
+
+uint64_t OracleSubscription::registerQuery(std::string_view sql) {
+    dpiStmt* stmt = nullptr;
+    auto rc = dpiSubscr_prepareStmt(_subscr, sql.data(), sql.size(), &stmt);
+    checkErr(rc, _ctx, "error preparing statement for subscription");
+
+    rc = dpiStmt_execute(stmt, DPI_MODE_EXEC_DEFAULT, nullptr);
+    uint64_t queryId = 0;
+    if (rc == DPI_SUCCESS && _queryLevel) {
+        rc = dpiStmt_getSubscrQueryId(stmt, &queryId);
+    }
+    // Releasing the statement resets this thread's error, so it's read first.
+    const auto errInfo = rc == DPI_SUCCESS ? dpiErrorInfo{} : _ctx->getLastError();
+    dpiStmt_release(stmt);
+    checkErr(rc, errInfo, "error registering query with subscription");
+    return queryId;
+}
+
 OracleVariable OracleConnection::newArrayVariable(VariableOpts opts) {
     dpiObjectType* objType = nullptr;
     uint32_t size = 0;
@@ -388,9 +1023,102 @@ OracleVariable OracleConnection::newArrayVariable(VariableOpts opts) {
     return OracleVariable(_ctx, opts.nativeTypeNum, var, std::move(dataVec));
 }
 
-void OracleStatement::execute() {
-    int rc = dpiStmt_execute(_statement, DPI_MODE_EXEC_DEFAULT, nullptr);
+OracleVariable OracleConnection::newCursorVariable() {
+    return newArrayVariable({DPI_ORACLE_TYPE_STMT, DPI_NATIVE_TYPE_STMT, 1, false,
+                             VariableOpts::ByteBufferOpts{0, false}});
+}
+
+std::optional<OracleStatement> OracleStatement::nextImplicitResult() {
+    dpiStmt* child = nullptr;
+    auto rc = dpiStmt_getImplicitResult(_statement, &child);
+    checkErr(rc, _ctx, "error getting implicit result");
+    if (child == nullptr) {
+        return std::nullopt;
+    }
+    OracleStatement result(_ctx, child);
+    result._exactNumbers = _exactNumbers;
+    result._metadata = std::make_shared<const ResultMetadata>(result, _exactNumbers);
+    result._defineExactNumbers();
+    return result;
+}
+
+void OracleStatement::execute(dpiExecMode mode) {
+    _limits.fetchedBytes = 0;
+    _limits.reached = false;
+    TraceSpan span("execute");
+    const auto start = std::chrono::steady_clock::now();
+    int rc = dpiStmt_execute(_statement, mode, nullptr);
+    clientCounters.add(ClientCounter::Executes);
+    clientCounters.record(ClientLatency::Execute, std::chrono::steady_clock::now() - start);
     checkErr(rc, _ctx, "error executing oracle statement");
+    _adaptiveFetch.executedQuery = isQuery();
+    _metadata.reset();
+    _define.layout.rowBytes = 0;
+    if (_adaptiveFetch.executedQuery) {
+        _metadata = std::make_shared<const ResultMetadata>(*this, _exactNumbers);
+        _define.layout.rowBytes = _defineRowBytes();
+        _defineExactNumbers();
+        _startLobInlining();
+        _startAdaptiveFetch();
+        if (!_adaptiveFetch.tuner) {
+            // The size set before execute, now that the row's size is known to cap it by.
+            const auto requested = _define.layout.requestedArraySize;
+            setFetchArraySize(requested != 0 ? requested : fetchArraySize());
+        }
+    }
+}
+
+void OracleStatement::executeMany(uint32_t numIters, dpiExecMode mode) {
+    TraceSpan span("execute");
+    span.setArg("iterations", numIters);
+    clientCounters.add(ClientCounter::Executes);
+    clientCounters.add(ClientCounter::ArrayDmlRows, numIters);
+    int rc = dpiStmt_executeMany(_statement, mode, numIters);
+    checkErr(rc, _ctx, "error executing oracle statement");
+}
+
+std::vector<OracleBatchError> OracleStatement::batchErrors() const {
+    uint32_t numErrors = 0;
+    int rc = dpiStmt_getBatchErrorCount(_statement, &numErrors);
+    checkErr(rc, _ctx, "error getting batch error count");
+
+    std::vector<OracleBatchError> ret;
+    if (numErrors == 0) {
+        return ret;
+    }
+    std::vector<dpiErrorInfo> errors(numErrors);
+    rc = dpiStmt_getBatchErrors(_statement, numErrors, errors.data());
+    checkErr(rc, _ctx, "error getting batch errors");
+
+    ret.reserve(numErrors);
+    for (const auto& error : errors) {
+        ret.push_back(OracleBatchError{
+            error.offset,
+            error.code,
+            std::string(error.message, error.messageLength)});
+    }
+    return ret;
+}
+
+std::vector<uint64_t> OracleStatement::rowCounts() const {
+    uint32_t numRowCounts = 0;
+    uint64_t* rowCounts = nullptr;
+    int rc = dpiStmt_getRowCounts(_statement, &numRowCounts, &rowCounts);
+    checkErr(rc, _ctx, "error getting array DML row counts");
+    return std::vector<uint64_t>(rowCounts, rowCounts + numRowCounts);
+}
+
+uint64_t OracleStatement::rowCount() const {
+    uint64_t count = 0;
+    int rc = dpiStmt_getRowCount(_statement, &count);
+    checkErr(rc, _ctx, "error getting row count");
+    return count;
+}
+
+void OracleStatement::describe() {
+    int rc = dpiStmt_execute(_statement, DPI_MODE_EXEC_DESCRIBE_ONLY, nullptr);
+    checkErr(rc, _ctx, "error describing oracle statement");
+    _metadata = std::make_shared<const ResultMetadata>(*this, _exactNumbers);
 }
 
 void OracleConnection::commit() {
@@ -398,14 +1126,308 @@ void OracleConnection::commit() {
     checkErr(rc, _ctx, "error committing changes");
 }
 
+void OracleConnection::rollback() {
+    auto rc = dpiConn_rollback(_conn);
+    checkErr(rc, _ctx, "error rolling back changes");
+}
+
+void OracleConnection::breakExecution() {
+    auto rc = dpiConn_breakExecution(_conn);
+    checkErr(rc, _ctx, "error interrupting execution");
+}
+
+void OracleConnection::ping() {
+    auto rc = dpiConn_ping(_conn);
+    checkErr(rc, _ctx, "error pinging oracle connection");
+}
+
+void OracleConnection::drop() {
+    _releaseTag.reset();
+    auto rc = dpiConn_close(_conn, DPI_MODE_CONN_CLOSE_DROP, nullptr, 0);
+    checkErr(rc, _ctx, "error dropping oracle connection");
+}
+
+void OracleConnection::setCallTimeout(uint32_t milliseconds) {
+    auto rc = dpiConn_setCallTimeout(_conn, milliseconds);
+    checkErr(rc, _ctx, "error setting call timeout");
+}
+
+uint32_t OracleConnection::callTimeout() const {
+    uint32_t milliseconds = 0;
+    auto rc = dpiConn_getCallTimeout(_conn, &milliseconds);
+    checkErr(rc, _ctx, "error getting call timeout");
+    return milliseconds;
+}
+
+void OracleConnection::setModule(std::string_view module) {
+    auto rc = dpiConn_setModule(_conn, module.data(), module.size());
+    checkErr(rc, _ctx, "error setting module");
+}
+
+void OracleConnection::setAction(std::string_view action) {
+    auto rc = dpiConn_setAction(_conn, action.data(), action.size());
+    checkErr(rc, _ctx, "error setting action");
+}
+
+void OracleConnection::setClientIdentifier(std::string_view clientIdentifier) {
+    auto rc = dpiConn_setClientIdentifier(_conn, clientIdentifier.data(), clientIdentifier.size());
+    checkErr(rc, _ctx, "error setting client identifier");
+}
+
+void OracleConnection::applyTags(const OracleConnectionOptions& opts) {
+    if (!opts.module.empty()) {
+        setModule(opts.module);
+    }
+    if (!opts.action.empty()) {
+        setAction(opts.action);
+    }
+    if (!opts.clientIdentifier.empty()) {
+        setClientIdentifier(opts.clientIdentifier);
+    }
+}
+
+OracleServerVersion OracleConnection::serverVersion() const {
+    const char* releaseString = nullptr;
+    uint32_t releaseStringLength = 0;
+    OracleServerVersion version;
+    auto rc = dpiConn_getServerVersion(_conn, &releaseString, &releaseStringLength, &version.versionInfo);
+    checkErr(rc, _ctx, "error getting oracle server version");
+    version.releaseString = std::string(releaseString, releaseStringLength);
+    return version;
+}
+
 bool OracleStatement::fetch() {
     int found = 0;
     uint32_t bufferRowIndex;
     auto rc = dpiStmt_fetch(_statement, &found, &bufferRowIndex);
+    clientCounters.add(ClientCounter::RowFetches);
     checkErr(rc, _ctx, "error fetching row from oracle statement");
+    if (found != 0) {
+        clientCounters.add(ClientCounter::RowsFetched);
+    }
     return found != 0;
 }
 
+OracleFetchBlock OracleStatement::fetchBlock(uint32_t maxRows) {
+    OracleFetchBlock block;
+    if (_limits.reached) {
+        return block;
+    }
+    int moreRows = 0;
+    TraceSpan span("fetch");
+    const auto start = std::chrono::steady_clock::now();
+    if (_lobInlining.state == LobInlining::State::Switching) {
+        _defineLobs(true);
+        _lobInlining.state = LobInlining::State::Inline;
+    }
+    auto rc = dpiStmt_fetchRows(_statement, maxRows, &block._bufferRowIndex, &block._numRows, &moreRows);
+    const auto latency = std::chrono::steady_clock::now() - start;
+    clientCounters.add(ClientCounter::BlockFetches);
+    clientCounters.record(ClientLatency::BlockFetch, latency);
+    checkErr(rc, _ctx, "error fetching rows from oracle statement");
+    block._moreRows = moreRows != 0;
+    if (block._numRows == 0) {
+        return block;
+    }
+
+    auto columnCount = numColumns();
+    block._columns.reserve(columnCount);
+    for (uint32_t pos = 1; pos <= columnCount; ++pos) {
+        dpiNativeTypeNum typeNum;
+        dpiData* data;
+        rc = dpiStmt_getQueryValue(_statement, pos, &typeNum, &data);
+        checkErr(rc, _ctx, "error getting column buffer from oracle results");
+        // After fetchRows the statement is positioned on the last row of the block, and
+        // the define buffers are contiguous, so the block starts numRows - 1 entries back.
+        block._columns.push_back({typeNum, data - (block._numRows - 1)});
+    }
+    clientCounters.add(ClientCounter::QueryValueLookups, columnCount);
+    if (_lobInlining.state == LobInlining::State::Sampling) {
+        _sampleLobs(block, maxRows);
+    }
+    if (_limits.maxRows != 0 || _limits.maxBytes != 0) {
+        _applyFetchLimits(block);
+    }
+    const auto blockBytes = block.valueBytes();
+    clientCounters.add(ClientCounter::RowsFetched, block._numRows);
+    clientCounters.add(ClientCounter::BytesDecoded, blockBytes);
+    span.setArg("rows", block._numRows);
+    if (_adaptiveFetch.tuner) {
+        _tuneFetchArraySize(block, maxRows, blockBytes, latency);
+    }
+    return block;
+}
+
+void OracleStatement::setAdaptiveFetch(uint64_t targetBatchBytes) {
+    _adaptiveFetch.targetBytes = targetBatchBytes;
+    if (targetBatchBytes == 0) {
+        _adaptiveFetch.tuner.reset();
+    } else if (!_adaptiveFetch.tuner && _adaptiveFetch.executedQuery) {
+        _startAdaptiveFetch();
+    }
+}
+
+void OracleStatement::_startAdaptiveFetch() {
+    _adaptiveFetch.tuner.reset();
+    if (_adaptiveFetch.targetBytes == 0) {
+        return;
+    }
+    _adaptiveFetch.tuner.emplace(_defineRowBytes(), _adaptiveFetch.targetBytes);
+    setFetchArraySize(_adaptiveFetch.tuner->arraySize());
+}
+
+uint64_t OracleStatement::_defineRowBytes() const {
+    uint64_t rowBytes = 0;
+    for (const auto& column : metadata()->columns()) {
+        rowBytes += sizeof(dpiData) + column.typeInfo.clientSizeInBytes;
+    }
+    return rowBytes;
+}
+
+void OracleStatement::_tuneFetchArraySize(const OracleFetchBlock& block,
+                                          uint32_t maxRows,
+                                          uint64_t blockBytes,
+                                          std::chrono::steady_clock::duration latency) {
+    // Only blocks that started a fresh internal fetch made a round trip. One that filled
+    // maxRows may have left rows of it in the buffers, so its bytes are scaled up to the
+    // whole fetch.
+    if (block._bufferRowIndex != 0 || block._numRows == 0) {
+        return;
+    }
+    auto& tuner = *_adaptiveFetch.tuner;
+    const auto arraySize = fetchArraySize();
+    auto rows = block._numRows;
+    auto bytes = blockBytes;
+    if (rows == maxRows && rows < arraySize && block._moreRows) {
+        bytes = blockBytes * arraySize / rows;
+        rows = arraySize;
+    }
+    const auto next = tuner.observe(rows, bytes, latency);
+    if (next != arraySize) {
+        setFetchArraySize(next);
+    }
+}
+
+void OracleStatement::setFetchLimits(uint64_t maxRows, uint64_t maxBytes) {
+    _limits.maxRows = maxRows;
+    _limits.maxBytes = maxBytes;
+}
+
+void OracleStatement::_applyFetchLimits(OracleFetchBlock& block) {
+    // The row count already includes this block.
+    const auto rowsBefore = rowCount() - block._numRows;
+    uint32_t allowed = block._numRows;
+    bool cut = false;
+    if (_limits.maxRows != 0) {
+        const auto remaining = _limits.maxRows - std::min(_limits.maxRows, rowsBefore);
+        if (remaining <= allowed) {
+            allowed = static_cast<uint32_t>(remaining);
+            // Stopping exactly at the end of the results isn't a cut.
+            cut = allowed < block._numRows || block._moreRows;
+        }
+    }
+    if (_limits.maxBytes != 0) {
+        for (uint32_t row = 0; row < allowed; ++row) {
+            uint64_t rowBytes = 0;
+            for (const auto& column : block._columns) {
+                rowBytes += decodedBytes(column.typeNum, column.data[row]);
+            }
+            if (_limits.fetchedBytes + rowBytes > _limits.maxBytes) {
+                allowed = row;
+                cut = true;
+                break;
+            }
+            _limits.fetchedBytes += rowBytes;
+        }
+    }
+    if (cut) {
+        block._numRows = allowed;
+        block._moreRows = false;
+        _limits.reached = true;
+    }
+}
+
+void OracleStatement::close() {
+    int rc = dpiStmt_close(_statement, nullptr, 0);
+    checkErr(rc, _ctx, "error closing oracle statement");
+}
+
+bool OracleStatement::isOpen() const {
+    // ODPI reports a closed statement as an error from anything that uses it.
+    dpiStmtInfo info;
+    return dpiStmt_getInfo(_statement, &info) == DPI_SUCCESS;
+}
+
+void OracleStatement::scroll(dpiFetchMode mode, int32_t offset) {
+    int rc = dpiStmt_scroll(_statement, mode, offset, 0);
+    checkErr(rc, _ctx, "error scrolling oracle cursor");
+    // A scroll may leave rows in the fetch buffers that no later fetch drains, so there's
+    // no safe point left to redefine the LOB columns at.
+    if (_lobInlining.state == LobInlining::State::Sampling) {
+        _lobInlining.state = LobInlining::State::Off;
+    }
+}
+
+void OracleStatement::setFetchArraySize(uint32_t numRows) {
+    auto& layout = _define.layout;
+    layout.requestedArraySize = numRows;
+    if (_define.limit != 0 && layout.rowBytes != 0) {
+        numRows = static_cast<uint32_t>(std::clamp<uint64_t>(_define.limit / layout.rowBytes, 1, numRows));
+    }
+    layout.arraySize = numRows;
+    auto rc = dpiStmt_setFetchArraySize(_statement, numRows);
+    checkErr(rc, _ctx, "error setting fetch array size on oracle statement");
+}
+
+uint32_t OracleStatement::fetchArraySize() const {
+    uint32_t numRows = 0;
+    auto rc = dpiStmt_getFetchArraySize(_statement, &numRows);
+    checkErr(rc, _ctx, "error getting fetch array size from oracle statement");
+    return numRows;
+}
+
+void OracleStatement::setPrefetchRows(uint32_t numRows) {
+    auto rc = dpiStmt_setPrefetchRows(_statement, numRows);
+    checkErr(rc, _ctx, "error setting prefetch rows on oracle statement");
+}
+
+uint32_t OracleStatement::prefetchRows() const {
+    uint32_t numRows = 0;
+    auto rc = dpiStmt_getPrefetchRows(_statement, &numRows);
+    checkErr(rc, _ctx, "error getting prefetch rows from oracle statement");
+    return numRows;
+}
+
+std::string OracleStatement::sqlId() const {
+    // OCI_ATTR_SQL_ID, which ODPI doesn't wrap.
+    constexpr uint32_t kSqlIdAttribute = 504;
+    dpiDataBuffer value;
+    uint32_t length = 0;
+    if (dpiStmt_getOciAttr(_statement, kSqlIdAttribute, &value, &length) != DPI_SUCCESS || value.asString == nullptr) {
+        return {};
+    }
+    return std::string(value.asString, length);
+}
+
+dpiStmtInfo OracleStatement::info() const {
+    dpiStmtInfo info;
+    auto rc = dpiStmt_getInfo(_statement, &info);
+    checkErr(rc, _ctx, "error getting statement info");
+    return info;
+}
+
+bool OracleStatement::isQuery() const {
+    return info().isQuery;
+}
+
+bool OracleStatement::isDML() const {
+    return info().isDML;
+}
+
+bool OracleStatement::isPLSQL() const {
+    return info().isPLSQL;
+}
+
 uint32_t OracleStatement::numColumns() const {
     uint32_t numColumns;
     auto rc = dpiStmt_getNumQueryColumns(_statement, &numColumns);
@@ -420,19 +1442,144 @@ OracleColumnInfo OracleStatement::getColumnInfo(uint32_t pos) const {
     return OracleColumnInfo{std::move(info)};
 }
 
+std::shared_ptr<const ResultMetadata> OracleStatement::metadata() const {
+    return _metadata ? _metadata : std::make_shared<const ResultMetadata>(*this);
+}
+
 OracleData OracleStatement::getColumnValue(uint32_t pos) const {
     dpiNativeTypeNum typeNum;
     dpiData* data;
     int rc = dpiStmt_getQueryValue(_statement, pos, &typeNum, &data);
     checkErr(rc, _ctx, "error getting column value from oracle results");
+    clientCounters.add(ClientCounter::QueryValueLookups);
+    clientCounters.add(ClientCounter::BytesDecoded, decodedBytes(typeNum, *data));
     return OracleData(typeNum, data);
 }
 
+void OracleStatement::setLobInlineThreshold(uint64_t maxBytes) {
+    _lobInlining.threshold = maxBytes;
+}
+
+void OracleStatement::defineColumn(uint32_t pos, dpiOracleTypeNum oracleType, dpiNativeTypeNum nativeType) {
+    auto rc = dpiStmt_defineValue(_statement, pos, oracleType, nativeType, 0, 0, nullptr);
+    checkErr(rc, _ctx, "error defining column");
+}
+
+void OracleStatement::defineVariable(uint32_t pos, const OracleVariable& var) {
+    auto rc = dpiStmt_define(_statement, pos, var._var);
+    checkErr(rc, _ctx, "error defining column with variable");
+}
+
+void OracleStatement::_defineExactNumbers() {
+    if (!_exactNumbers) {
+        return;
+    }
+    for (uint32_t pos = 1; pos <= _metadata->numColumns(); ++pos) {
+        if (fetchesNumberAsText(_metadata->column(pos).typeInfo)) {
+            defineColumn(pos, DPI_ORACLE_TYPE_NUMBER, DPI_NATIVE_TYPE_BYTES);
+        }
+    }
+}
+
+void OracleStatement::_startLobInlining() {
+    _lobInlining.columns.clear();
+    _lobInlining.state = LobInlining::State::Off;
+    const auto columns = numColumns();
+    for (uint32_t pos = 1; pos <= columns; ++pos) {
+        const auto oracleType = _metadata->column(pos).typeInfo.oracleTypeNum;
+        if (oracleType == DPI_ORACLE_TYPE_CLOB || oracleType == DPI_ORACLE_TYPE_NCLOB ||
+            oracleType == DPI_ORACLE_TYPE_BLOB) {
+            _lobInlining.columns.push_back({pos, oracleType});
+        }
+    }
+    if (_lobInlining.columns.empty()) {
+        return;
+    }
+    // Defines outlive the execute, and every copy of the statement shares them, so a
+    // previous run may have left these columns inline. Each run starts back on locators.
+    _defineLobs(false);
+    if (_lobInlining.threshold != 0) {
+        _lobInlining.state = LobInlining::State::Sampling;
+    }
+}
+
+void OracleStatement::_sampleLobs(const OracleFetchBlock& block, uint32_t maxRows) {
+    for (const auto& column : _lobInlining.columns) {
+        const auto data = block.columnData(column.pos);
+        for (uint32_t row = 0; row < block._numRows; ++row) {
+            if (data[row].isNull) {
+                continue;
+            }
+            uint64_t size = 0;
+            auto rc = dpiLob_getSize(data[row].value.asLOB, &size);
+            checkErr(rc, _ctx, "error getting size of LOB");
+            if (size > _lobInlining.threshold) {
+                _lobInlining.state = LobInlining::State::Off;
+                return;
+            }
+        }
+    }
+    // The new defines replace the buffers the fetched rows are in, so they can only go in
+    // once every row of the last internal fetch has been handed out: either the block came
+    // up short of maxRows, or it started a fresh fetch that maxRows covers entirely.
+    // Otherwise the next block is measured too.
+    if (block._numRows < maxRows || (block._bufferRowIndex == 0 && maxRows >= fetchArraySize())) {
+        _lobInlining.state = LobInlining::State::Switching;
+    }
+}
+
+void OracleStatement::_defineLobs(bool inlineValues) {
+    for (const auto& column : _lobInlining.columns) {
+        const bool binary = column.oracleType == DPI_ORACLE_TYPE_BLOB;
+        auto rc = inlineValues
+            ? dpiStmt_defineValue(_statement, column.pos,
+                                  binary ? DPI_ORACLE_TYPE_LONG_RAW : DPI_ORACLE_TYPE_LONG_VARCHAR,
+                                  DPI_NATIVE_TYPE_BYTES, 0, 0, nullptr)
+            : dpiStmt_defineValue(_statement, column.pos, column.oracleType, DPI_NATIVE_TYPE_LOB, 0, 0, nullptr);
+        checkErr(rc, _ctx, "error defining LOB column");
+    }
+}
+
+const dpiJsonNode& OracleStatement::jsonValue(const dpiData& data, uint32_t options) const {
+    dpiJsonNode* node = nullptr;
+    int rc = dpiJson_getValue(data.value.asJson, options, &node);
+    checkErr(rc, _ctx, "error decoding JSON value");
+    return *node;
+}
+
 void OracleStatement::bindByPos(uint32_t pos, const OracleVariable &var) {
     int rc = dpiStmt_bindByPos(_statement, pos, var._var);
     checkErr(rc, _ctx, "binding variable to statement by pos");
 }
 
+void OracleStatement::bindByName(std::string_view name, const OracleVariable& var) {
+    int rc = dpiStmt_bindByName(_statement, name.data(), static_cast<uint32_t>(name.size()), var._var);
+    checkErr(rc, _ctx, "binding variable to statement by name");
+}
+
+std::vector<std::string> OracleStatement::bindNames() const {
+    uint32_t count = 0;
+    int rc = dpiStmt_getBindCount(_statement, &count);
+    checkErr(rc, _ctx, "getting bind count of statement");
+    std::vector<const char*> names(count);
+    std::vector<uint32_t> lengths(count);
+    if (count > 0) {
+        rc = dpiStmt_getBindNames(_statement, &count, names.data(), lengths.data());
+        checkErr(rc, _ctx, "getting bind names of statement");
+    }
+    std::vector<std::string> ret;
+    ret.reserve(count);
+    for (uint32_t idx = 0; idx < count; ++idx) {
+        ret.emplace_back(names[idx], lengths[idx]);
+    }
+    return ret;
+}
+
+void OracleStatement::bindValueByPos(uint32_t pos, dpiNativeTypeNum nativeType, dpiData& data) {
+    int rc = dpiStmt_bindValueByPos(_statement, pos, nativeType, &data);
+    checkErr(rc, _ctx, "binding value to statement by pos");
+}
+
 bool OracleData::isNull() const {
     return dpiData_getIsNull(_data);
 }
@@ -477,6 +1624,64 @@ dpiTimestamp* OracleData::as<dpiTimestamp*>() const {
     return dpiData_getTimestamp(_data);
 }
 
+template<>
+dpiStmt* OracleData::as<dpiStmt*>() const {
+    checkErr(_typeNum == DPI_NATIVE_TYPE_STMT, "value is not a cursor");
+    return dpiData_getStmt(_data);
+}
+
+template<>
+dpiLob* OracleData::as<dpiLob*>() const {
+    checkErr(_typeNum == DPI_NATIVE_TYPE_LOB, "value for column is not a LOB");
+    return dpiData_getLOB(_data);
+}
+
+void OracleLobReader::_check(int rc, std::string_view context) const {
+    if (_ctx != nullptr) {
+        checkErr(rc, _ctx, context);
+    } else if (rc != DPI_SUCCESS) {
+        throwOracleError(context);
+    }
+}
+
+void OracleLobReader::open(dpiLob* lob) {
+    _lob = lob;
+    _offset = 1;
+    uint64_t size = 0;
+    _check(dpiLob_getSize(lob, &size), "error getting LOB size");
+    _remaining = size;
+    if (size == 0) {
+        return;
+    }
+    uint32_t chunkSize = 0;
+    _check(dpiLob_getChunkSize(lob, &chunkSize), "error getting LOB chunk size");
+    chunkSize = std::max<uint32_t>(chunkSize, 1);
+    _amount = std::min(std::max<uint64_t>(kPieceBytes / chunkSize, 1) * chunkSize, size);
+    uint64_t bufferSize = 0;
+    _check(dpiLob_getBufferSize(lob, _amount, &bufferSize), "error sizing LOB buffer");
+    if (_buffer.size() < bufferSize) {
+        _buffer.resize(bufferSize);
+    }
+}
+
+std::string_view OracleLobReader::next() {
+    if (_remaining == 0) {
+        return {};
+    }
+    TraceSpan span("read lob");
+    const auto amount = std::min(_amount, _remaining);
+    uint64_t length = _buffer.size();
+    _check(dpiLob_readBytes(_lob, _offset, amount, _buffer.data(), &length), "error reading LOB");
+    _offset += amount;
+    _remaining -= amount;
+    // A LOB cut short while it was being read just ends early.
+    if (length == 0) {
+        _remaining = 0;
+    }
+    clientCounters.add(ClientCounter::BytesDecoded, length);
+    return std::string_view(_buffer.data(), length);
+}
+
 template<>
 std::string_view OracleData::as<std::string_view>() const {
     checkErr(_typeNum == DPI_NATIVE_TYPE_BYTES, "value for column is not bytes");
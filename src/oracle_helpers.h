@@ -1,13 +1,18 @@
 #pragma once
 
 #include "dpi.h"
+#include "fetch_tuning.h"
 #include "mpark/variant.hpp"
 
+#include <chrono>
 #include <cstddef>
+#include <functional>
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 namespace sqlplusplus {
@@ -19,15 +24,37 @@ public:
 
     const dpiErrorInfo& info() const;
     const std::string& context() const;
+    // Whether the error means the session is gone, e.g. its instance went down or the
+    // network dropped it: the errors ODPI marks a connection dead for, or ODPI's own "not
+    // connected". Nothing more can be done on that connection.
+    bool isSessionLost() const noexcept;
 
 private:
-    dpiErrorInfo _errorInfo;
+    dpiErrorInfo _errorInfo{};
     std::string _context;
 };
 
+// Upper-cases an unquoted Oracle identifier, optionally qualified with an owner, for
+// callers that splice names into SQL text. Throws std::runtime_error if name has anything
+// an unquoted identifier can't contain.
+std::string normalizeIdentifier(std::string_view name, bool allowQualifier);
+
+// A normalized, possibly qualified name as its owner, if it has one, and object name, for
+// binding into dictionary queries.
+std::pair<std::optional<std::string>, std::string> splitOwner(const std::string& name);
+
+// One context serves every thread. The pools and connections made from it are created in
+// threaded mode, so a pool can hand out sessions to any number of threads at once and
+// handles can be shared between threads, but a connection and its statements should only
+// be used by one thread at a time; breakExecution() is the exception.
 class OracleContext {
 public:
-    static std::unique_ptr<OracleContext> make();
+    // configDir is where the client libraries read sqlnet.ora, tnsnames.ora and
+    // oraaccess.xml from in place of TNS_ADMIN, e.g. one whose sqlnet.ora sets
+    // OCI_RESULT_CACHE_MAX_SIZE to turn the client result cache on for this process alone.
+    // Empty leaves it to the usual search. The client libraries are loaded once, so only the
+    // process's first context gets to set it.
+    static std::unique_ptr<OracleContext> make(const std::string& configDir = {});
 
     explicit OracleContext(dpiContext* ctx) noexcept : _ctx(ctx) {}
     ~OracleContext();
@@ -36,6 +63,8 @@ public:
         return _ctx;
     }
 
+    // ODPI keeps the last error per thread, and clears it at the start of every call, so
+    // this has to be read on the thread whose call failed before it makes another.
     dpiErrorInfo getLastError() const noexcept {
         dpiErrorInfo errInfo;
         dpiContext_getError(_ctx, &errInfo);
@@ -45,26 +74,123 @@ private:
     dpiContext* _ctx = nullptr;
 };
 
+struct OracleServerVersion {
+    std::string releaseString;
+    dpiVersionInfo versionInfo;
+};
+
+// Sizing and timeouts for a session pool, see dpiPoolCreateParams.
+struct OracleConnectionPoolOptions {
+    uint32_t minSessions = 1;
+    uint32_t maxSessions = 4;
+    uint32_t sessionIncrement = 1;
+    dpiPoolGetMode getMode = DPI_MODE_POOL_GET_WAIT;
+    // Seconds a session can sit idle before it's pinged when acquired; negative disables.
+    int pingInterval = 60;
+    // Seconds before idle sessions are closed; 0 keeps them open.
+    uint32_t timeout = 0;
+    // Milliseconds to wait for a free session with DPI_MODE_POOL_GET_TIMEDWAIT.
+    uint32_t waitTimeout = 0;
+    // Seconds a session may live before it's closed; 0 is unlimited.
+    uint32_t maxLifetimeSession = 0;
+    bool homogeneous = true;
+    // A PL/SQL procedure, (requested_properties IN VARCHAR2, actual_properties IN
+    // VARCHAR2), that the server runs to set up a session acquired with a tag it doesn't
+    // have, as part of the acquire rather than in round trips of the client's own. Empty
+    // leaves tagged sessions to be set up by the client. Needs 12.2 client libraries.
+    std::string plsqlFixupCallback;
+};
+
+// One column of a sharding key: VARCHAR text, or a NUMBER written as text.
+struct OracleShardingKeyColumn {
+    dpiOracleTypeNum type = DPI_ORACLE_TYPE_VARCHAR;
+    std::string value;
+};
+
+// Connects straight to the shard owning the key, with the super sharding key picking the
+// shardspace, instead of going through the shard catalog. Empty has no key.
+struct OracleShardingKey {
+    std::vector<OracleShardingKeyColumn> columns;
+    std::vector<OracleShardingKeyColumn> superColumns;
+
+    bool empty() const noexcept {
+        return columns.empty() && superColumns.empty();
+    }
+};
+
 class OracleConnection;
 struct OracleConnectionOptions {
     std::string username;
     std::string password;
     std::string connString;
+    // Log in as this user through username's proxy authentication, given ALTER USER
+    // proxyUser GRANT CONNECT THROUGH username, with no password of proxyUser's own.
+    // Standalone connections log in as username[proxyUser]; pooled ones need a
+    // heterogeneous pool, whose sessions can each be a different user's. Empty logs in as
+    // username.
+    std::string proxyUser;
+    // Create the connection in events mode, which subscriptions need.
+    bool events = false;
+    // Size of OCI's statement cache for the connection or pool. Unset keeps the client
+    // library's default.
+    std::optional<uint32_t> stmtCacheSize;
+    // Connect through a session pool with these settings; unset uses standalone connections.
+    std::optional<OracleConnectionPoolOptions> pool;
+    // Tags every session is set up with, as seen in v$session and in server-side traces.
+    // Empty values are left alone.
+    std::string module;
+    std::string action;
+    std::string clientIdentifier;
+    // Database resident connection pooling: the connection class the server shares pooled
+    // server processes within, and whether a session may take over one's state
+    // (DPI_PURITY_SELF) or needs a fresh one (DPI_PURITY_NEW). Only matters when connString
+    // asks for a pooled server, e.g. with :POOLED.
+    std::string connectionClass;
+    dpiPurity purity = DPI_PURITY_DEFAULT;
+    // Session state as NAME=value pairs separated by semicolons, e.g.
+    // "NLS_DATE_FORMAT=YYYY-MM-DD;TIME_ZONE=UTC", each one an ALTER SESSION SET. Pooled
+    // sessions are requested with it as their tag and only set up when they come back
+    // without it, then released with it, so state is set once per session rather than once
+    // per acquire. See Session.
+    std::string sessionTag;
+    // Standalone connections are made with it; pooled ones are acquired with it.
+    OracleShardingKey shardingKey;
+    // The client configuration directory the session's context is made with; see
+    // OracleContext::make().
+    std::string clientConfigDir;
 };
 
 class OracleConnectionPool {
 public:
     static OracleConnectionPool make(OracleContext* ctx, const OracleConnectionOptions& opts);
 
+    OracleConnectionPool(const OracleConnectionPool&) = delete;
+    OracleConnectionPool& operator=(const OracleConnectionPool&) = delete;
+    OracleConnectionPool(OracleConnectionPool&& other) noexcept;
+    OracleConnectionPool& operator=(OracleConnectionPool&& other) noexcept;
+    ~OracleConnectionPool();
+
     OracleConnection acquireConnection();
+    // Heterogeneous pools need the credentials of the session being acquired; homogeneous
+    // ones take them empty. A tag asks for a session released with that tag, or with
+    // matchAnyTag one with any tag, before falling back to an untagged or new one; the
+    // connection's sessionTag() says which was found. A sharding key asks for a session on
+    // the shard that owns it.
+    OracleConnection acquireConnection(std::string_view username, std::string_view password,
+                                       std::string_view tag = {}, bool matchAnyTag = false,
+                                       const OracleShardingKey& shardingKey = {});
+
+    // Sessions the pool has open, and how many of those are acquired right now.
+    uint32_t openCount() const;
+    uint32_t busyCount() const;
 
 private:
-    OracleConnectionPool(const OracleConnectionPool&) = delete;
-    OracleConnectionPool(OracleConnectionPool&&) = delete;
-
     explicit OracleConnectionPool(OracleContext* ctx, dpiPool* pool) : _ctx(ctx), _pool(pool) {}
     OracleContext* _ctx = nullptr;
     dpiPool* _pool = nullptr;
+    // Passed with every acquire, see OracleConnectionOptions.
+    std::string _connectionClass;
+    dpiPurity _purity = DPI_PURITY_DEFAULT;
 };
 
 class OracleData {
@@ -85,7 +211,78 @@ public:
     dpiData* _data = nullptr;
 };
 
+// A view over what a RETURNING ... INTO out bind returned for one iteration of an
+// execute: a row per row the iteration's DML touched, zero or more for array DML. It
+// points into the variable's buffers, so it's only valid until the statement it's bound
+// to is executed again.
+class OracleReturnedData {
+public:
+    OracleReturnedData() = default;
+    OracleReturnedData(dpiNativeTypeNum typeNum, dpiData* data, uint32_t size) :
+        _typeNum(typeNum),
+        _data(data),
+        _size(size)
+    {}
+
+    dpiNativeTypeNum nativeType() const noexcept {
+        return _typeNum;
+    }
+    uint32_t size() const noexcept {
+        return _size;
+    }
+    bool empty() const noexcept {
+        return _size == 0;
+    }
+    dpiData* data() const noexcept {
+        return _data;
+    }
+    OracleData operator[](uint32_t idx) const noexcept {
+        return OracleData(_typeNum, _data + idx);
+    }
+
+private:
+    dpiNativeTypeNum _typeNum = DPI_NATIVE_TYPE_NULL;
+    dpiData* _data = nullptr;
+    uint32_t _size = 0;
+};
+
+// Reads a LOB front to back a piece at a time, so exporting one never needs it in memory
+// whole. Each piece is a whole number of the LOB's chunks, the unit the server stores it
+// in, adding up to about kPieceBytes, so a small LOB is one read and a big one a round
+// trip per MB rather than per chunk. The one buffer is reused from piece to piece and LOB
+// to LOB. CLOB text comes back as UTF-8.
+class OracleLobReader {
+public:
+    static constexpr uint64_t kPieceBytes = 1024 * 1024;
+
+    // Errors are reported through ctx; without one they're thrown without Oracle's details.
+    explicit OracleLobReader(const OracleContext* ctx) noexcept : _ctx(ctx) {}
+
+    // Starts reading lob, which must stay valid until its last piece has been read.
+    void open(dpiLob* lob);
+    // The next piece, or empty once the LOB has been read. Only valid until the next call.
+    std::string_view next();
+
+private:
+    void _check(int rc, std::string_view context) const;
+
+    const OracleContext* _ctx;
+    dpiLob* _lob = nullptr;
+    // In characters for CLOBs, bytes for BLOBs.
+    uint64_t _offset = 1;
+    uint64_t _remaining = 0;
+    uint64_t _amount = 0;
+    std::vector<char> _buffer;
+};
+
 class OracleStatement;
+// The text of an ODPI rowid, which ODPI works out the first time it's asked for and keeps
+// with the rowid. Empty for a null rowid, or one whose text can't be had.
+std::string_view rowidText(dpiRowid* rowid) noexcept;
+
+// A reference on an ODPI rowid. Copying or moving one only adjusts the reference; the
+// text is asked of ODPI when it's wanted, which works it out once and keeps it with the
+// rowid.
 class OracleRowId {
 public:
     OracleRowId(const OracleRowId& other);
@@ -94,9 +291,8 @@ public:
     OracleRowId& operator=(OracleRowId&& other) noexcept;
     ~OracleRowId();
 
-    operator std::string_view() const {
-        return _strValue;
-    }
+    // Empty for a rowid that's been moved from, or whose text can't be had.
+    operator std::string_view() const;
 
 protected:
     friend class OracleVariable;
@@ -105,29 +301,48 @@ protected:
     }
 
 private:
-    void _initStrValue();
-
     dpiRowid* _rowId;
-    std::string_view _strValue;
 };
 
+// Variables, connections and statements are move-only: copying one takes a reference on
+// the ODPI handle, which is an atomic or a lock inside ODPI, so it's spelled share() to
+// keep it out of loops by accident. Every shared handle refers to the same variable,
+// session or cursor.
 class OracleVariable {
-public: 
-    OracleVariable(const OracleVariable& other);
+public:
+    OracleVariable(const OracleVariable&) = delete;
+    OracleVariable& operator=(const OracleVariable&) = delete;
     OracleVariable(OracleVariable&& other) noexcept;
-    OracleVariable& operator=(const OracleVariable& other);
     OracleVariable& operator=(OracleVariable&& other) noexcept;
     ~OracleVariable();
 
+    OracleVariable share() const;
+
     void copyFrom(const OracleVariable& other, uint32_t pos, uint32_t sourcePos);
     void setFrom(uint32_t pos, std::string_view value);
     void setFrom(uint32_t pos, const OracleStatement& stmt);
     void setFrom(uint32_t pos, const OracleRowId& rowId);
+    // Typed values for variables created with the matching native type, so numbers and
+    // dates go to the server without a round trip through text.
+    void setFrom(uint32_t pos, int64_t value);
+    void setFrom(uint32_t pos, double value);
+    void setFrom(uint32_t pos, const dpiTimestamp& value);
+    void setNull(uint32_t pos);
+    // How many elements of a variable created with isArray are passed, when it's bound to
+    // a PL/SQL index-by table.
+    void setNumElementsInArray(uint32_t numElements);
 
     uint32_t numElements() const;
     uint32_t sizeInBytes() const;
-    std::vector<OracleData> returnedData(uint32_t pos) const;
+    // What a RETURNING ... INTO bind returned for iteration pos of the last execute, or of
+    // executeMany with a variable of at least as many elements as iterations, so array
+    // DML gets each row's generated values back in the one round trip.
+    OracleReturnedData returnedData(uint32_t pos) const;
     const std::vector<OracleData>& allocatedData() const;
+    // The cursor a REF CURSOR variable holds at the 0-based array position pos, once the
+    // statement it's bound to as an out parameter has executed. It fetches like any
+    // executed query and stays open after the variable goes away.
+    OracleStatement statementAt(uint32_t pos) const;
 
 private:
     friend class OracleStatement;
@@ -145,18 +360,63 @@ private:
     std::vector<OracleData> _allocatedData;
 };
 
+class OracleQueue;
+class OracleSodaCollection;
+class OracleSubscription;
 class OracleConnection {
 public:
     static OracleConnection make(OracleContext* ctx, const OracleConnectionOptions& opts);
 
-    OracleConnection(const OracleConnection& other);
+    OracleConnection(const OracleConnection&) = delete;
+    OracleConnection& operator=(const OracleConnection&) = delete;
     OracleConnection(OracleConnection&& other) noexcept;
-    OracleConnection& operator=(const OracleConnection& other);
     OracleConnection& operator=(OracleConnection&& other) noexcept;
     ~OracleConnection();
 
-    OracleStatement prepareStatement(std::string_view sql);
+    OracleConnection share() const;
+
+    // A scrollable statement's query cursor can be repositioned with
+    // OracleStatement::scroll() once it's executed.
+    OracleStatement prepareStatement(std::string_view sql, bool scrollable = false);
     void commit();
+    void rollback();
+    // Asks the server to abandon whatever is running on the connection; the blocked call
+    // fails with ORA-01013 and the connection stays usable. Safe to call from any thread.
+    void breakExecution();
+    // A round trip that does nothing, to find out whether the session is still there.
+    // Throws OracleException when it isn't.
+    void ping();
+    // Ends a pooled session for good instead of returning it to the pool, e.g. because
+    // ping() failed. The connection can't be used afterwards.
+    void drop();
+    // Bounds every round trip on the connection, in milliseconds; a call that runs longer
+    // is interrupted and fails with DPI-1067. Zero means no limit.
+    void setCallTimeout(uint32_t milliseconds);
+    uint32_t callTimeout() const;
+    // These tag the session for v$session, auditing and end-to-end tracing. They don't
+    // cost a round trip of their own; the values go along with the next call.
+    void setModule(std::string_view module);
+    void setAction(std::string_view action);
+    void setClientIdentifier(std::string_view clientIdentifier);
+    // Sets whichever of the module, action and client identifier opts has values for.
+    void applyTags(const OracleConnectionOptions& opts);
+
+    // For a session acquired from a pool: the tag it was released with last, empty for an
+    // untagged one, and whether it was created for this acquire.
+    const std::string& sessionTag() const noexcept {
+        return _sessionTag;
+    }
+    bool isNewSession() const noexcept {
+        return _newSession;
+    }
+    // Has a pooled session go back to its pool with this tag once the last copy of the
+    // connection goes away, so the next acquire asking for it can skip setting it up.
+    void setReleaseTag(std::string tag);
+    OracleServerVersion serverVersion() const;
+    // Whether other is a copy of this connection, the session variables are created on.
+    bool isSameSession(const OracleConnection& other) const noexcept {
+        return _conn == other._conn;
+    }
 
     struct VariableOpts {
         struct ByteBufferOpts {
@@ -170,11 +430,29 @@ public:
         dpiOracleTypeNum dbTypeNum;
         dpiNativeTypeNum nativeTypeNum;
         uint32_t maxArraySize;
-        bool isArray;
+        bool isArray = false;
         mpark::variant<ByteBufferOpts, ObjectOpts> opts;
     };
 
     OracleVariable newArrayVariable(VariableOpts opts); 
+    // A single REF CURSOR, to bind to an out parameter and read with statementAt(0).
+    OracleVariable newCursorVariable();
+
+    // Subscribes to object change notifications for the given operations (a mask of
+    // DPI_OPCODE_* values). Objects are added to the subscription with registerQuery. The
+    // connection must have been created with events enabled. With rowids, notifications
+    // list the rows that changed too, up to the server's limit.
+    OracleSubscription subscribeObjectChanges(
+            uint32_t operations, std::function<void(const dpiSubscrMessage&)> callback, bool rowids = false);
+    // Subscribes to query result change notifications: a query registered with
+    // registerQuery is notified, by the id registerQuery returned, once a commit changes
+    // its result rather than just a table it reads.
+    OracleSubscription subscribeQueryChanges(std::function<void(const dpiSubscrMessage&)> callback);
+
+    // An Advanced Queuing queue with RAW payloads, by its possibly qualified name.
+    OracleQueue openQueue(std::string_view name);
+    // A SODA collection by name. Throws std::runtime_error when there's none.
+    OracleSodaCollection openSodaCollection(std::string_view name);
 
 private:
     friend class OracleConnectionPool;
@@ -183,11 +461,20 @@ private:
         _conn(conn)
     {}
 
+    OracleSubscription _subscribe(uint32_t operations, uint32_t qos, std::function<void(const dpiSubscrMessage&)> callback);
+    void _release() noexcept;
+
     OracleContext* _ctx;
     dpiConn* _conn = nullptr;
+    std::string _sessionTag;
+    bool _newSession = false;
+    // Shared by every copy: closing the session to retag it ends it for all of them, so only
+    // the last one to go does it.
+    std::shared_ptr<const std::string> _releaseTag;
 };
 
 class OracleStatement;
+class ResultMetadata;
 class OracleColumnInfo {
 public:
     std::string_view name() const noexcept {
@@ -202,30 +489,264 @@ public:
         return _info.typeInfo;
     }
 
-private:
-    friend class OracleStatement;
-    OracleColumnInfo(dpiQueryInfo info)
+    explicit OracleColumnInfo(dpiQueryInfo info)
         : _info(std::move(info))
     {}
 
+private:
     dpiQueryInfo _info;
 };
 
-class OracleStatement {
+// A view over the rows returned by a single OracleStatement::fetchBlock() call. Column
+// data points straight into the statement's define buffers, so the view is only valid
+// until the next fetch on the statement. Column positions are 1-based like the rest of
+// the statement API, row indexes are 0-based within the block.
+class OracleFetchBlock {
 public:
-    OracleStatement(const OracleStatement& other);
+    struct Column {
+        dpiNativeTypeNum typeNum;
+        // The block's first row; the rest follow contiguously.
+        dpiData* data;
+    };
+
+    OracleFetchBlock() = default;
+    OracleFetchBlock(std::vector<Column> columns, uint32_t numRows, uint32_t bufferRowIndex, bool moreRows) :
+        _columns(std::move(columns)),
+        _numRows(numRows),
+        _bufferRowIndex(bufferRowIndex),
+        _moreRows(moreRows)
+    {}
+
+    uint32_t numRows() const noexcept {
+        return _numRows;
+    }
+
+    uint32_t bufferRowIndex() const noexcept {
+        return _bufferRowIndex;
+    }
+
+    bool moreRows() const noexcept {
+        return _moreRows;
+    }
+
+    uint32_t numColumns() const noexcept {
+        return static_cast<uint32_t>(_columns.size());
+    }
+
+    dpiNativeTypeNum nativeType(uint32_t pos) const noexcept {
+        return _columns[pos - 1].typeNum;
+    }
+
+    dpiData* columnData(uint32_t pos) const noexcept {
+        return _columns[pos - 1].data;
+    }
+
+    OracleData value(uint32_t pos, uint32_t row) const noexcept {
+        const auto& column = _columns[pos - 1];
+        return OracleData(column.typeNum, column.data + row);
+    }
+
+    // What the block's values cost to take out of the define buffers, as counted by the
+    // fetch limits and the bytes decoded counter.
+    uint64_t valueBytes() const noexcept;
+
+private:
+    friend class OracleStatement;
+
+    std::vector<Column> _columns;
+    uint32_t _numRows = 0;
+    uint32_t _bufferRowIndex = 0;
+    bool _moreRows = false;
+};
+
+// One row of an array DML execute that failed with DPI_MODE_EXEC_BATCH_ERRORS.
+struct OracleBatchError {
+    // Zero-based index of the failing row within the batch.
+    uint32_t offset;
+    int32_t code;
+    std::string message;
+};
+
+// The part of a query the result writers read rows through. OracleStatement is the real
+// one; a synthetic source (see synthetic_results.h) stands in for it to measure the
+// client's decode and render paths without a database. Calls are per block, not per row,
+// so the virtual dispatch doesn't show up.
+class OracleResultSource {
+public:
+    virtual ~OracleResultSource() = default;
+
+    virtual uint32_t numColumns() const = 0;
+    virtual OracleColumnInfo getColumnInfo(uint32_t pos) const = 0;
+    // The columns as described once for the current result, for readers that want their
+    // names, types or formatters without going back to getColumnInfo() for each.
+    virtual std::shared_ptr<const ResultMetadata> metadata() const = 0;
+    virtual uint32_t fetchArraySize() const = 0;
+    // Up to maxRows of the remaining rows; an empty block once they've run out.
+    virtual OracleFetchBlock fetchBlock(uint32_t maxRows) = 0;
+    // Decodes a fetched native JSON value into ODPI's node tree. options is a mask of
+    // DPI_JSON_OPT_* flags. The nodes are owned by the fetch buffers and are only valid
+    // until the next fetch.
+    virtual const dpiJsonNode& jsonValue(const dpiData& data, uint32_t options) const = 0;
+    // Where errors reading the LOBs of fetched DPI_NATIVE_TYPE_LOB values are reported, see
+    // OracleLobReader. Null when there's no database behind the source.
+    virtual const OracleContext* context() const noexcept = 0;
+
+protected:
+    OracleResultSource() = default;
+    OracleResultSource(const OracleResultSource&) = default;
+    OracleResultSource(OracleResultSource&&) = default;
+    OracleResultSource& operator=(const OracleResultSource&) = default;
+    OracleResultSource& operator=(OracleResultSource&&) = default;
+};
+
+class OracleStatement : public OracleResultSource {
+public:
+    OracleStatement(const OracleStatement&) = delete;
+    OracleStatement& operator=(const OracleStatement&) = delete;
     OracleStatement(OracleStatement&& other) noexcept;
-    OracleStatement& operator=(const OracleStatement& other);
     OracleStatement& operator=(OracleStatement&& other) noexcept;
     ~OracleStatement();
 
-    void execute();
+    // Shares the cursor, and copies the fetch settings and metadata as they are now.
+    OracleStatement share() const;
+
+    // mode may include DPI_MODE_EXEC_COMMIT_ON_SUCCESS, to commit in the same round trip.
+    void execute(dpiExecMode mode = DPI_MODE_EXEC_DEFAULT);
+    // Executes in describe-only mode: the column metadata becomes available through
+    // numColumns()/getColumnInfo() without the query being run.
+    void describe();
+    // Executes the statement once per bound array element, in a single round trip. mode
+    // may include DPI_MODE_EXEC_BATCH_ERRORS, to keep going past failing rows and collect
+    // them in batchErrors(), and DPI_MODE_EXEC_ARRAY_DML_ROWCOUNTS, to get rowCounts().
+    void executeMany(uint32_t numIters, dpiExecMode mode = DPI_MODE_EXEC_DEFAULT);
+    std::vector<OracleBatchError> batchErrors() const;
+    // Rows affected by each iteration of the last executeMany().
+    std::vector<uint64_t> rowCounts() const;
+    // Rows affected by the last execute, or fetched so far for queries.
+    uint64_t rowCount() const;
     bool fetch();
-    uint32_t numColumns() const;
-    OracleColumnInfo getColumnInfo(uint32_t pos) const ;
+    OracleFetchBlock fetchBlock(uint32_t maxRows) override;
+
+    // Caps how much of a query fetchBlock() hands out, counting from the next execute;
+    // zero leaves a limit off. Bytes are the sizes of the fetched values. Once a limit is
+    // hit the block that reached it is cut short and reports no more rows, and
+    // fetchLimitReached() turns true; callers should close() the cursor once done with it.
+    void setFetchLimits(uint64_t maxRows, uint64_t maxBytes);
+    bool fetchLimitReached() const noexcept {
+        return _limits.reached;
+    }
+
+    // Closes the cursor and releases the statement's server resources. Every copy of the
+    // statement is closed with it.
+    void close();
+    bool isOpen() const;
+    // Whether both are copies of one prepared statement, and so share its cursor.
+    bool isSameCursor(const OracleStatement& other) const noexcept {
+        return _statement == other._statement;
+    }
+    // Repositions a cursor prepared as scrollable so the next fetch starts at the row mode and offset
+    // pick, e.g. DPI_MODE_FETCH_ABSOLUTE with a 1-based row number. Only goes back to the
+    // server when the row isn't already in the fetch buffers. Throws OracleException when
+    // the row is past either end of the results.
+    void scroll(dpiFetchMode mode, int32_t offset);
+
+    // Number of rows fetched into the define buffers per round trip. Takes effect on the
+    // next internal fetch, so it may be changed between pages of an active query.
+    void setFetchArraySize(uint32_t numRows);
+    uint32_t fetchArraySize() const override;
+    // Has queries pick their own fetch array size, starting from about targetBatchBytes of
+    // rows a round trip and adjusting it as they go, see FetchSizeTuner. Set on a query
+    // that's already been executed it takes over from the next fetch. 0 turns it off and
+    // leaves whatever size was set last.
+    void setAdaptiveFetch(uint64_t targetBatchBytes);
+    // Caps a query's define buffers, its array size times what a row takes in them, at
+    // maxBytes by fetching fewer rows a round trip than asked for, so a high array size is
+    // safe over wide VARCHAR2(4000) columns; every row still fits, however wide. Applies to
+    // fixed and adaptive sizes alike, from the next execute or array size set. 0, the
+    // default, leaves them uncapped.
+    void setDefineMemoryLimit(uint64_t maxBytes) noexcept {
+        _define.limit = maxBytes;
+    }
+    struct DefineLayout {
+        // What a row takes in the define buffers; 0 until a query has been executed.
+        uint64_t rowBytes = 0;
+        // The array size last asked for, and what the limit left of it.
+        uint32_t requestedArraySize = 0;
+        uint32_t arraySize = 0;
+    };
+    const DefineLayout& defineLayout() const noexcept {
+        return _define.layout;
+    }
+
+    // Number of rows the Oracle client prefetches along with execute(). Must be set
+    // before execute() to have any effect.
+    void setPrefetchRows(uint32_t numRows);
+    uint32_t prefetchRows() const;
+
+    // What kind of statement was prepared, known before it's executed without a round
+    // trip. The is*() calls below each read it again; callers branching on several of them
+    // can read it once.
+    dpiStmtInfo info() const;
+    // Whether the prepared statement is a query, known before it's executed.
+    bool isQuery() const;
+    // Whether it's an INSERT, UPDATE, DELETE or MERGE, whose rowCount() is rows affected.
+    bool isDML() const;
+    // Whether it's an anonymous block or a CALL, which may return implicit results.
+    bool isPLSQL() const;
+    // The SQL_ID the server gave the statement, kept by the client once it's been
+    // executed, so no round trip. Empty before then, and with clients older than 12.2.
+    std::string sqlId() const;
+    uint32_t numColumns() const override;
+    OracleColumnInfo getColumnInfo(uint32_t pos) const override;
+    // Described by execute() or describe() for a query, and shared with every copy made
+    // after; described afresh on each call otherwise.
+    std::shared_ptr<const ResultMetadata> metadata() const override;
     OracleData getColumnValue(uint32_t pos) const;
+    const dpiJsonNode& jsonValue(const dpiData& data, uint32_t options) const override;
+    const OracleContext* context() const noexcept override {
+        return _ctx;
+    }
+
+    // CLOB, NCLOB and BLOB columns come back as locators, each of which costs round trips
+    // to read. With a threshold set, the LOBs of the first block fetched after execute()
+    // are measured (in characters for CLOB and NCLOB), and when none is longer than
+    // maxBytes the columns are redefined as long text or raw, so the blocks after it bring
+    // their values inline with the rows. An inline value comes back whole however long it
+    // is, so this only suits columns whose first block is representative. 0 keeps
+    // locators. Takes effect from the next execute().
+    void setLobInlineThreshold(uint64_t maxBytes);
+    // Fetches column pos as oracleType into nativeType from the next fetch on, e.g. a
+    // NUMBER as its decimal text rather than a double that can't hold every value. Only
+    // for an executed query; the define lasts through later executes of the statement.
+    void defineColumn(uint32_t pos, dpiOracleTypeNum oracleType, dpiNativeTypeNum nativeType);
+    // Fetches column pos into var's buffers instead of the statement's own, so the values
+    // can be handed to another variable with OracleVariable::copyFrom(). var needs room
+    // for the fetch array size, and a block's values are at var's positions from its
+    // bufferRowIndex().
+    void defineVariable(uint32_t pos, const OracleVariable& var);
+    // Fetches the NUMBER columns ODPI would bring back as doubles, which lose digits past
+    // the 15th and are slow to format shortest round trip, as their exact decimal text
+    // instead. Integer columns of up to 18 digits still come back as int64, which is exact
+    // already and cheaper to format than text. Takes effect from the next execute(), and
+    // carries over to the statement's implicit results.
+    void setExactNumbers(bool exact) noexcept {
+        _exactNumbers = exact;
+    }
 
     void bindByPos(uint32_t pos, const OracleVariable& var);
+    // name is the placeholder without its colon; unquoted names match in any case.
+    void bindByName(std::string_view name, const OracleVariable& var);
+    // The distinct placeholder names in the prepared text, in the order they first appear,
+    // upper-cased unless they were quoted. Read from the client's parse, so no round trip.
+    std::vector<std::string> bindNames() const;
+    // Binds a copy of data, converted from nativeType, without a variable of our own;
+    // typed_bind.h's bind() is the typed way in.
+    void bindValueByPos(uint32_t pos, dpiNativeTypeNum nativeType, dpiData& data);
+
+    // The next result set the executed PL/SQL returned with DBMS_SQL.RETURN_RESULT, in the
+    // order they were returned, or nullopt once there are no more. Each is an executed
+    // query ready to fetch.
+    std::optional<OracleStatement> nextImplicitResult();
 
 protected:
     friend class OracleConnection;
@@ -241,9 +762,168 @@ protected:
 
 private:
     std::pair<dpiData*, dpiNativeTypeNum> _dataForColumn(uint32_t pos);
+    void _applyFetchLimits(OracleFetchBlock& block);
+    void _defineExactNumbers();
+    void _startLobInlining();
+    void _sampleLobs(const OracleFetchBlock& block, uint32_t maxRows);
+    void _defineLobs(bool inlineValues);
+    void _startAdaptiveFetch();
+    // A dpiData per column, plus the bytes of variable length values. LOB locators are
+    // counted as the dpiData alone.
+    uint64_t _defineRowBytes() const;
+    void _tuneFetchArraySize(const OracleFetchBlock& block, uint32_t maxRows, uint64_t blockBytes,
+                             std::chrono::steady_clock::duration latency);
+
+    struct FetchLimits {
+        uint64_t maxRows = 0;
+        uint64_t maxBytes = 0;
+        uint64_t fetchedBytes = 0;
+        bool reached = false;
+    };
+
+    struct LobInlining {
+        struct Column {
+            uint32_t pos;
+            dpiOracleTypeNum oracleType;
+        };
+        // Sampling measures each block's LOBs; Switching redefines the columns before the
+        // next fetch and Inline is what that leaves. Off keeps the locators.
+        enum class State { Off, Sampling, Switching, Inline };
+
+        uint64_t threshold = 0;
+        std::vector<Column> columns;
+        State state = State::Off;
+    };
+
+    struct AdaptiveFetch {
+        uint64_t targetBytes = 0;
+        bool executedQuery = false;
+        // Set from execute(), or setAdaptiveFetch() after it, to the end of the query.
+        std::optional<FetchSizeTuner> tuner;
+    };
+
+    struct DefineMemory {
+        uint64_t limit = 0;
+        DefineLayout layout;
+    };
 
     OracleContext* _ctx = nullptr;
     dpiStmt* _statement = nullptr;
+    FetchLimits _limits;
+    DefineMemory _define;
+    LobInlining _lobInlining;
+    AdaptiveFetch _adaptiveFetch;
+    std::shared_ptr<const ResultMetadata> _metadata;
+    bool _exactNumbers = false;
+};
+
+class OracleSubscription {
+public:
+    using Callback = std::function<void(const dpiSubscrMessage&)>;
+
+    OracleSubscription(const OracleSubscription&) = delete;
+    OracleSubscription& operator=(const OracleSubscription&) = delete;
+    OracleSubscription(OracleSubscription&& other) noexcept;
+    OracleSubscription& operator=(OracleSubscription&& other) noexcept;
+    ~OracleSubscription();
+
+    // Executes sql for registration only, which adds every object it references to the
+    // subscription. No rows are fetched. Returns the query's id for query change
+    // subscriptions, 0 for object change ones.
+    uint64_t registerQuery(std::string_view sql);
+
+private:
+    friend class OracleConnection;
+    OracleSubscription(OracleContext* ctx, dpiConn* conn, dpiSubscr* subscr, std::unique_ptr<Callback> callback,
+                       bool queryLevel) :
+        _ctx(ctx),
+        _conn(conn),
+        _subscr(subscr),
+        _callback(std::move(callback)),
+        _queryLevel(queryLevel)
+    {}
+
+    void _unsubscribe() noexcept;
+
+    OracleContext* _ctx = nullptr;
+    dpiConn* _conn = nullptr;
+    dpiSubscr* _subscr = nullptr;
+    // Heap-allocated so the address handed to ODPI as the callback context survives moves.
+    std::unique_ptr<Callback> _callback;
+    bool _queryLevel = false;
+};
+
+// A RAW payload queue, for draining and replaying backlogs in bulk: each dequeue() and
+// enqueue() is one dpiQueue_deqMany or dpiQueue_enqMany round trip for the whole batch.
+// Both are visible immediately rather than on commit, so each batch is a transaction of
+// its own, whatever the session has open.
+class OracleQueue {
+public:
+    OracleQueue(const OracleQueue&) = delete;
+    OracleQueue& operator=(const OracleQueue&) = delete;
+    OracleQueue(OracleQueue&& other) noexcept;
+    OracleQueue& operator=(OracleQueue&& other) noexcept;
+    ~OracleQueue();
+
+    // Dequeues as the named subscriber, for multi-consumer queues.
+    void setConsumerName(std::string_view name);
+    // Dequeues up to maxMessages, waiting up to waitSeconds for the first when the queue
+    // is empty (DPI_DEQ_WAIT_FOREVER blocks until one comes, 0 doesn't wait), and calls
+    // onMessage with each payload. Returns how many there were.
+    uint32_t dequeue(uint32_t maxMessages, uint32_t waitSeconds,
+                     const std::function<void(std::string_view payload)>& onMessage);
+    // Enqueues every payload in one round trip. The message properties are kept from one
+    // call to the next, so a replay only allocates them for its largest batch.
+    void enqueue(const std::vector<std::string_view>& payloads);
+
+private:
+    friend class OracleConnection;
+    OracleQueue(OracleContext* ctx, dpiConn* conn, dpiQueue* queue) :
+        _ctx(ctx),
+        _conn(conn),
+        _queue(queue)
+    {}
+
+    void _release() noexcept;
+
+    OracleContext* _ctx = nullptr;
+    dpiConn* _conn = nullptr;
+    dpiQueue* _queue = nullptr;
+    std::vector<dpiMsgProps*> _enqueueProps;
+    std::vector<dpiMsgProps*> _dequeueProps;
+};
+
+// A SODA collection, read and written a batch of documents a round trip.
+class OracleSodaCollection {
+public:
+    OracleSodaCollection(const OracleSodaCollection&) = delete;
+    OracleSodaCollection& operator=(const OracleSodaCollection&) = delete;
+    OracleSodaCollection(OracleSodaCollection&& other) noexcept;
+    OracleSodaCollection& operator=(OracleSodaCollection&& other) noexcept;
+    ~OracleSodaCollection();
+
+    // Calls onDocument with the content of each document matching filter, a query by
+    // example such as {"status": "open"}, or of every document when it's empty. The cursor
+    // brings back fetchArraySize documents a round trip. Returns how many there were.
+    uint64_t find(std::string_view filter, uint32_t fetchArraySize,
+                  const std::function<void(std::string_view content)>& onDocument);
+    // Inserts a JSON document for each of contents in one round trip, committed along with
+    // it.
+    void insertMany(const std::vector<std::string_view>& contents);
+
+private:
+    friend class OracleConnection;
+    OracleSodaCollection(OracleContext* ctx, dpiSodaDb* db, dpiSodaColl* coll) :
+        _ctx(ctx),
+        _db(db),
+        _coll(coll)
+    {}
+
+    void _release() noexcept;
+
+    OracleContext* _ctx = nullptr;
+    dpiSodaDb* _db = nullptr;
+    dpiSodaColl* _coll = nullptr;
 };
 
 
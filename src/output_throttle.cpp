@@ -0,0 +1,90 @@
+#include "output_throttle.h"
+
+#include "async_output.h"
+
+#include "fmt/format.h"
+
+#include <poll.h>
+#include <unistd.h>
+
+namespace sqlplusplus {
+
+OutputThrottle::OutputThrottle(AsyncOutputBuffer& output) : _output(output) {
+    if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &_saved) == -1) {
+        return;
+    }
+    auto keys = _saved;
+    keys.c_lflag &= ~static_cast<tcflag_t>(ICANON | ECHO);
+    keys.c_cc[VMIN] = 0;
+    keys.c_cc[VTIME] = 0;
+    _keys = tcsetattr(STDIN_FILENO, TCSANOW, &keys) == 0;
+}
+
+OutputThrottle::~OutputThrottle() {
+    if (_keys) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &_saved);
+    }
+}
+
+bool OutputThrottle::drawing() {
+    if (!_drawing) {
+        return false;
+    }
+    if (_keyPressed()) {
+        _reason = "skipping to the end";
+    } else if (_output.queuedBytes() >= kBacklogBytes) {
+        _reason = "the output is outrunning the terminal";
+    } else {
+        return true;
+    }
+    _drawing = false;
+    _collapsedAt = _lastProgress = std::chrono::steady_clock::now();
+    return false;
+}
+
+void OutputThrottle::skip(const std::string_view* cells, size_t numColumns) {
+    ++_skippedRows;
+    std::vector<std::string> row;
+    if (_tail.size() == kTailRows) {
+        row = std::move(_tail.front());
+        _tail.pop_front();
+    }
+    row.resize(numColumns);
+    for (size_t col = 0; col < numColumns; ++col) {
+        row[col].assign(cells[col]);
+    }
+    _tail.push_back(std::move(row));
+}
+
+std::optional<std::string> OutputThrottle::progress(uint64_t rowsSoFar) {
+    const auto now = std::chrono::steady_clock::now();
+    if (now - _lastProgress < kSummaryInterval) {
+        return std::nullopt;
+    }
+    _lastProgress = now;
+    const std::chrono::duration<double> elapsed = now - _collapsedAt;
+    return fmt::format("-- {} rows so far, {:.0f} rows/s; the last {} are shown at the end\n", rowsSoFar,
+                       static_cast<double>(_skippedRows) / elapsed.count(), kTailRows);
+}
+
+// s skips to the end; anything else typed meanwhile is dropped.
+bool OutputThrottle::_keyPressed() {
+    if (!_keys) {
+        return false;
+    }
+    pollfd pfd{STDIN_FILENO, POLLIN, 0};
+    bool pressed = false;
+    char input[64];
+    while (::poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN) != 0) {
+        const auto length = ::read(STDIN_FILENO, input, sizeof(input));
+        if (length <= 0) {
+            break;
+        }
+        for (ssize_t idx = 0; idx < length; ++idx) {
+            pressed = pressed || input[idx] == 's' || input[idx] == 'S';
+        }
+    }
+    return pressed;
+}
+
+} // namespace sqlplusplus
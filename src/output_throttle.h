@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <termios.h>
+
+namespace sqlplusplus {
+
+class AsyncOutputBuffer;
+
+// Keeps a result that floods the terminal from holding its fetch to the terminal's pace.
+// Rows are drawn as usual until the terminal falls kBacklogBytes behind what's been
+// written to it, or s is pressed; from then on they're only counted, with a line of
+// progress every kSummaryInterval, and the last kTailRows are kept to be shown with the
+// count once the fetch is over, which carries on at full speed meanwhile.
+//
+// While a throttle is alive, stdin, when it's a terminal, is out of canonical mode and
+// doesn't echo, so a key is read as soon as it's pressed; Ctrl-C still interrupts.
+class OutputThrottle {
+public:
+    static constexpr size_t kBacklogBytes = 1024 * 1024;
+    static constexpr std::chrono::seconds kSummaryInterval{1};
+    static constexpr size_t kTailRows = 20;
+
+    explicit OutputThrottle(AsyncOutputBuffer& output);
+    OutputThrottle(const OutputThrottle&) = delete;
+    OutputThrottle& operator=(const OutputThrottle&) = delete;
+    ~OutputThrottle();
+
+    // Whether the next rows should still be drawn. Once it's false it stays false, and the
+    // first time it is, reason() says why.
+    bool drawing();
+    std::string_view reason() const noexcept {
+        return _reason;
+    }
+
+    // Counts a row that isn't drawn, keeping it if it's among the last kTailRows.
+    void skip(const std::string_view* cells, size_t numColumns);
+    // The line to show in place of the rows skipped so far, once one is due; rowsSoFar is
+    // every row fetched, drawn or not.
+    std::optional<std::string> progress(uint64_t rowsSoFar);
+
+    uint64_t skippedRows() const noexcept {
+        return _skippedRows;
+    }
+    // The last rows skipped, oldest first, a cell a column.
+    const std::deque<std::vector<std::string>>& tail() const noexcept {
+        return _tail;
+    }
+
+private:
+    bool _keyPressed();
+
+    AsyncOutputBuffer& _output;
+    bool _keys = false;
+    termios _saved{};
+    bool _drawing = true;
+    std::string_view _reason;
+    uint64_t _skippedRows = 0;
+    std::deque<std::vector<std::string>> _tail;
+    std::chrono::steady_clock::time_point _collapsedAt;
+    std::chrono::steady_clock::time_point _lastProgress;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,478 @@
+#include "pager.h"
+
+#include "arena.h"
+#include "oracle_helpers.h"
+#include "result_metadata.h"
+#include "spill_file.h"
+#include "terminal.h"
+#include "trace_recorder.h"
+#include "value_format.h"
+
+#include "fmt/format.h"
+#include "tsl/htrie_map.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sqlplusplus {
+
+// Chunks start out resident, with their values in storage. Past the window budget they're
+// spilled, and then only have cells while the viewport is on them and they're mapped back.
+struct ResultPager::RowChunk {
+    uint64_t firstRow = 0;
+    uint32_t numRows = 0;
+    StringArena storage{kStorageBlockSize};
+    std::vector<Cell> cells;
+    bool resident = true;
+    SpillFile::Extent extent;
+    std::optional<SpilledBatch> mapped;
+
+    static constexpr size_t kStorageBlockSize = 16 * 1024;
+
+    size_t bytes() const noexcept {
+        return storage.bytesReserved() + cells.capacity() * sizeof(Cell);
+    }
+};
+
+namespace {
+
+// Only this much of each value is kept; nothing wider than a column is ever drawn.
+constexpr size_t kMaxStoredValueBytes = ResultPager::kMaxColumnWidth * 4;
+// Values up to this long are stored once per column of a chunk.
+constexpr size_t kMaxInternedValueBytes = 64;
+// How far past the bottom of the viewport rows are fetched, in screens.
+constexpr uint64_t kLookaheadScreens = 4;
+// Header, header underline and status line.
+constexpr uint32_t kChromeRows = 3;
+constexpr std::string_view kColumnSeparator = " │ ";
+
+} // namespace
+
+ResultPager::ResultPager(OracleResultSource& stmt, size_t windowBytes) :
+    _stmt(stmt),
+    _windowBytes(windowBytes)
+{
+    for (const auto& column : stmt.metadata()->columns()) {
+        _columnNames.emplace_back(column.name);
+        _columnWidths.push_back(std::min(column.nameWidth, kMaxColumnWidth));
+    }
+
+    if (pipe2(_wakePipe, O_NONBLOCK | O_CLOEXEC) == -1) {
+        throw std::system_error(errno, std::generic_category(), "error creating pager wake pipe");
+    }
+    _fetcher = std::thread([this] { _fetchLoop(); });
+}
+
+ResultPager::~ResultPager() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _fetchWanted.notify_one();
+    _fetcher.join();
+    ::close(_wakePipe[0]);
+    ::close(_wakePipe[1]);
+}
+
+void ResultPager::_wake() noexcept {
+    const char byte = 0;
+    // A full pipe already has a wakeup pending.
+    [[maybe_unused]] auto rc = ::write(_wakePipe[1], &byte, 1);
+}
+
+void ResultPager::_fetchLoop() {
+    traceRecorder.nameThread("pager fetch");
+    auto formatters = makeColumnFormatters(_stmt);
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _fetchWanted.wait(lock, [this] { return _stop || _fetchedRows < _wantedRows; });
+            if (_stop) {
+                return;
+            }
+        }
+
+        std::unique_ptr<RowChunk> chunk;
+        bool moreRows = false;
+        try {
+            chunk = _fetchChunk(formatters, moreRows);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _error = std::current_exception();
+            _moreRows = false;
+            _wake();
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            chunk->firstRow = _fetchedRows;
+            _fetchedRows += chunk->numRows;
+            _moreRows = moreRows;
+            if (chunk->numRows > 0) {
+                _bytes += chunk->bytes();
+                _chunks.push_back(std::move(chunk));
+                _evictLocked();
+            }
+        }
+        _wake();
+        if (!moreRows) {
+            return;
+        }
+    }
+}
+
+std::unique_ptr<ResultPager::RowChunk> ResultPager::_fetchChunk(
+        std::vector<ColumnFormatter>& formatters, bool& moreRows) {
+    const auto numColumns = static_cast<uint32_t>(_columnNames.size());
+    auto block = _stmt.fetchBlock(_stmt.fetchArraySize());
+    moreRows = block.moreRows();
+    TraceSpan span("decode");
+    span.setArg("rows", block.numRows());
+
+    auto chunk = std::make_unique<RowChunk>();
+    chunk->numRows = block.numRows();
+    chunk->cells.resize(static_cast<size_t>(block.numRows()) * numColumns);
+    fmt::memory_buffer scratch;
+    // A column's repeated values point at the one copy of them in storage.
+    tsl::htrie_map<char, Cell> seen;
+    for (uint32_t col = 1; col <= numColumns; ++col) {
+        seen.clear();
+        auto& formatter = formatters[col - 1];
+        if (formatter.nativeType() != block.nativeType(col)) {
+            formatter = ColumnFormatter(block.nativeType(col), formatter.oracleType());
+        }
+        const auto columnData = block.columnData(col);
+        for (uint32_t row = 0; row < block.numRows(); ++row) {
+            const auto& data = columnData[row];
+            std::string_view value;
+            const auto sizeBound = formatter.sizeBound(data);
+            if (sizeBound <= kMaxStoredValueBytes) {
+                auto ptr = chunk->storage.allocate(sizeBound);
+                auto end = formatter.format(data, ptr);
+                chunk->storage.shrinkLast(sizeBound - static_cast<size_t>(end - ptr));
+                value = std::string_view(ptr, static_cast<size_t>(end - ptr));
+            } else {
+                scratch.clear();
+                formatter.format(data, scratch);
+                auto size = std::min(scratch.size(), kMaxStoredValueBytes);
+                while (size > 0 && size < scratch.size() && isContinuationByte(scratch.data()[size])) {
+                    --size;
+                }
+                value = chunk->storage.append(std::string_view(scratch.data(), size));
+            }
+            auto& cell = chunk->cells[static_cast<size_t>(row) * numColumns + col - 1];
+            if (value.size() > kMaxInternedValueBytes) {
+                cell = Cell{value.data(), static_cast<uint32_t>(value.size())};
+            } else if (auto it = seen.find_ks(value.data(), value.size()); it != seen.end()) {
+                // The value was the last thing stored, so it can be given back.
+                chunk->storage.shrinkLast(value.size());
+                cell = it.value();
+            } else {
+                cell = Cell{value.data(), static_cast<uint32_t>(value.size())};
+                seen.insert_ks(value.data(), value.size(), cell);
+            }
+        }
+    }
+    return chunk;
+}
+
+void ResultPager::_evictLocked() {
+    // Never evict the block the viewport starts in, or anything after it, so scrolling back
+    // up always has somewhere to land.
+    for (size_t idx = 0; idx < _chunks.size() && _bytes > _windowBytes && !_spillFailed; ++idx) {
+        auto& chunk = *_chunks[idx];
+        if (chunk.firstRow + chunk.numRows > _topRow) {
+            return;
+        }
+        if (!chunk.resident) {
+            continue;
+        }
+        try {
+            _spillLocked(chunk);
+        } catch (const std::system_error&) {
+            // Without somewhere to spill to, the oldest rows are dropped instead.
+            _spillFailed = true;
+        }
+    }
+    while (_bytes > _windowBytes && _chunks.size() > 1) {
+        const auto& front = *_chunks.front();
+        if (front.firstRow + front.numRows > _topRow) {
+            break;
+        }
+        if (front.resident) {
+            _bytes -= front.bytes();
+        }
+        _mappedChunks.erase(std::remove(_mappedChunks.begin(), _mappedChunks.end(), &front), _mappedChunks.end());
+        _chunks.pop_front();
+    }
+}
+
+void ResultPager::_spillLocked(RowChunk& chunk) {
+    if (!_spill) {
+        _spill = std::make_unique<SpillFile>("pager");
+    }
+    const auto numColumns = static_cast<uint32_t>(_columnNames.size());
+    SpillBatchBuilder batch(numColumns);
+    std::vector<std::string_view> row(numColumns);
+    for (size_t idx = 0; idx < chunk.cells.size(); idx += numColumns) {
+        for (uint32_t col = 0; col < numColumns; ++col) {
+            const auto& cell = chunk.cells[idx + col];
+            row[col] = std::string_view(cell.data, cell.length);
+        }
+        batch.addRow(row.data());
+    }
+    chunk.extent = _spill->append(batch);
+    _bytes -= chunk.bytes();
+    chunk.resident = false;
+    chunk.storage = StringArena(RowChunk::kStorageBlockSize);
+    std::vector<Cell>().swap(chunk.cells);
+}
+
+void ResultPager::_mapViewportLocked(uint32_t viewRows) {
+    const auto overlapsViewport = [&](const RowChunk& chunk) {
+        return chunk.firstRow < _topRow + viewRows && chunk.firstRow + chunk.numRows > _topRow;
+    };
+    for (auto it = _mappedChunks.begin(); it != _mappedChunks.end();) {
+        auto& chunk = **it;
+        if (overlapsViewport(chunk)) {
+            ++it;
+            continue;
+        }
+        chunk.mapped.reset();
+        std::vector<Cell>().swap(chunk.cells);
+        it = _mappedChunks.erase(it);
+    }
+
+    auto it = std::upper_bound(_chunks.begin(), _chunks.end(), _topRow,
+            [](uint64_t row, const std::unique_ptr<RowChunk>& chunk) {
+                return row < chunk->firstRow;
+            });
+    if (it != _chunks.begin()) {
+        --it;
+    }
+    for (; it != _chunks.end() && overlapsViewport(**it); ++it) {
+        auto& chunk = **it;
+        if (chunk.resident || chunk.mapped) {
+            continue;
+        }
+        chunk.mapped = _spill->map(chunk.extent);
+        const auto& batch = *chunk.mapped;
+        chunk.cells.resize(static_cast<size_t>(batch.numRows()) * batch.numColumns());
+        for (uint32_t row = 0; row < batch.numRows(); ++row) {
+            for (uint32_t col = 0; col < batch.numColumns(); ++col) {
+                const auto value = batch.cell(row, col);
+                chunk.cells[static_cast<size_t>(row) * batch.numColumns() + col] =
+                    Cell{value.data(), static_cast<uint32_t>(value.size())};
+            }
+        }
+        _mappedChunks.push_back(&chunk);
+    }
+}
+
+const ResultPager::Cell* ResultPager::_rowLocked(uint64_t row) const {
+    auto it = std::upper_bound(_chunks.begin(), _chunks.end(), row,
+            [](uint64_t row, const std::unique_ptr<RowChunk>& chunk) {
+                return row < chunk->firstRow;
+            });
+    if (it == _chunks.begin()) {
+        return nullptr;
+    }
+    const auto& chunk = **std::prev(it);
+    // Spilled chunks have no cells unless they're mapped.
+    if (row >= chunk.firstRow + chunk.numRows || chunk.cells.empty()) {
+        return nullptr;
+    }
+    return chunk.cells.data() + (row - chunk.firstRow) * _columnNames.size();
+}
+
+void ResultPager::_settleWidthsLocked() {
+    if (!_chunks.empty()) {
+        const auto& chunk = *_chunks.front();
+        for (size_t idx = 0; idx < chunk.cells.size(); ++idx) {
+            auto& width = _columnWidths[idx % _columnNames.size()];
+            const auto& cell = chunk.cells[idx];
+            width = std::max(width, cappedDisplayWidth(std::string_view(cell.data, cell.length), kMaxColumnWidth));
+        }
+    }
+    _widthsSettled = true;
+}
+
+std::string ResultPager::_renderLocked(uint32_t viewRows, uint32_t screenColumns) const {
+    const auto numColumns = static_cast<uint32_t>(_columnNames.size());
+
+    // As many columns as fit, starting from the scrolled-to one; the first one always shows
+    // even if it has to be cut to the screen width.
+    std::vector<std::pair<uint32_t, uint32_t>> visible;
+    uint32_t lineWidth = 0;
+    for (auto col = _firstColumn; col < numColumns; ++col) {
+        const auto separator = visible.empty() ? 0 : static_cast<uint32_t>(displayWidth(kColumnSeparator));
+        const auto width = _columnWidths[col];
+        if (lineWidth + separator + width > screenColumns) {
+            if (visible.empty()) {
+                visible.emplace_back(col, screenColumns);
+            }
+            break;
+        }
+        visible.emplace_back(col, width);
+        lineWidth += separator + width;
+    }
+
+    std::string frame = "\x1b[H";
+    auto endLine = [&] {
+        frame += "\x1b[K\r\n";
+    };
+
+    frame += "\x1b[1m";
+    for (size_t idx = 0; idx < visible.size(); ++idx) {
+        if (idx > 0) {
+            frame += kColumnSeparator;
+        }
+        appendCell(frame, _columnNames[visible[idx].first], visible[idx].second);
+    }
+    frame += "\x1b[0m";
+    endLine();
+    for (size_t idx = 0; idx < visible.size(); ++idx) {
+        if (idx > 0) {
+            frame += "─┼─";
+        }
+        for (uint32_t pos = 0; pos < visible[idx].second; ++pos) {
+            frame += "─";
+        }
+    }
+    endLine();
+
+    for (uint32_t line = 0; line < viewRows; ++line) {
+        const auto row = _topRow + line;
+        if (auto cells = _rowLocked(row)) {
+            for (size_t idx = 0; idx < visible.size(); ++idx) {
+                if (idx > 0) {
+                    frame += kColumnSeparator;
+                }
+                const auto& cell = cells[visible[idx].first];
+                appendCell(frame, std::string_view(cell.data, cell.length), visible[idx].second);
+            }
+        } else if (row >= _fetchedRows && _moreRows) {
+            frame += "\x1b[2m…\x1b[0m";
+        } else {
+            frame += "\x1b[2m~\x1b[0m";
+        }
+        endLine();
+    }
+
+    const auto lastShown = std::min<uint64_t>(_topRow + viewRows, _fetchedRows);
+    auto status = fmt::format(" rows {}-{} of {}{}  columns {}-{} of {}",
+            std::min(_topRow + 1, lastShown),
+            lastShown,
+            _fetchedRows,
+            _moreRows ? "+" : "",
+            visible.empty() ? 0 : visible.front().first + 1,
+            visible.empty() ? 0 : visible.back().first + 1,
+            numColumns);
+    if (!_chunks.empty() && _chunks.front()->firstRow > 0) {
+        status += fmt::format("  (rows before {} dropped)", _chunks.front()->firstRow + 1);
+    }
+    status += "  ↑↓ PgUp/PgDn Home/End ←→ q";
+    frame += "\x1b[7m";
+    appendCell(frame, status, screenColumns);
+    frame += "\x1b[0m\x1b[K";
+    return frame;
+}
+
+void ResultPager::run() {
+    {
+        RawTerminal terminal;
+        for (;;) {
+            const auto [screenRows, screenColumns] = terminal.size();
+            const uint32_t viewRows = screenRows > kChromeRows + 1 ? screenRows - kChromeRows : 1;
+
+            std::string frame;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (_error) {
+                    break;
+                }
+                if (_followEnd) {
+                    _topRow = _fetchedRows > viewRows ? _fetchedRows - viewRows : 0;
+                } else if (!_moreRows && _topRow + viewRows > _fetchedRows) {
+                    _topRow = _fetchedRows > viewRows ? _fetchedRows - viewRows : 0;
+                } else {
+                    _topRow = std::min(_topRow, _fetchedRows);
+                }
+                if (!_chunks.empty()) {
+                    _topRow = std::max(_topRow, _chunks.front()->firstRow);
+                }
+                _wantedRows = _followEnd ?
+                    std::numeric_limits<uint64_t>::max() :
+                    std::max(_wantedRows, _topRow + viewRows * (kLookaheadScreens + 1));
+                if (!_widthsSettled && (!_chunks.empty() || !_moreRows)) {
+                    _settleWidthsLocked();
+                }
+                _mapViewportLocked(viewRows);
+                TraceSpan span("render");
+                frame = _renderLocked(viewRows, screenColumns);
+            }
+            _fetchWanted.notify_one();
+            terminal.write(frame);
+
+            const auto keys = terminal.readKeys(_wakePipe[0]);
+            std::lock_guard<std::mutex> lock(_mutex);
+            bool quit = false;
+            for (auto key : keys) {
+                if (key != Key::End) {
+                    _followEnd = false;
+                }
+                switch (key) {
+                case Key::Quit:
+                    quit = true;
+                    break;
+                case Key::Up:
+                    _topRow -= std::min<uint64_t>(_topRow, 1);
+                    break;
+                case Key::Down:
+                    ++_topRow;
+                    break;
+                case Key::PageUp:
+                    _topRow -= std::min<uint64_t>(_topRow, viewRows);
+                    break;
+                case Key::PageDown:
+                    _topRow += viewRows;
+                    break;
+                case Key::Home:
+                    _topRow = 0;
+                    break;
+                case Key::End:
+                    _followEnd = true;
+                    break;
+                case Key::Left:
+                    _firstColumn -= std::min<uint32_t>(_firstColumn, 1);
+                    break;
+                case Key::Right:
+                    if (_firstColumn + 1 < _columnNames.size()) {
+                        ++_firstColumn;
+                    }
+                    break;
+                }
+            }
+            if (quit) {
+                break;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_error) {
+        std::rethrow_exception(_error);
+    }
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sqlplusplus {
+
+class ColumnFormatter;
+class OracleResultSource;
+class SpillFile;
+
+// Full-screen, scrollable view over the remaining rows of an executed query, or of any
+// other result source.
+//
+// Rows are decoded into a bounded window of fetched blocks: a background thread fetches
+// ahead of the viewport as the user scrolls, and once the window grows past its byte budget
+// the oldest blocks are spilled to a temporary file and mapped back only while they're on
+// screen, so paging through millions of rows keeps only a few MB resident. Without a
+// usable spill file they're dropped instead. Column widths are settled from the first block and stay put from then on,
+// and only the rows inside the viewport are ever rendered.
+class ResultPager {
+public:
+    static constexpr uint32_t kMaxColumnWidth = 48;
+
+    // The pager fetches from stmt on its own thread until it's destroyed; stmt must outlive
+    // it and mustn't be used in the meantime.
+    ResultPager(OracleResultSource& stmt, size_t windowBytes);
+    ResultPager(const ResultPager&) = delete;
+    ResultPager& operator=(const ResultPager&) = delete;
+    ~ResultPager();
+
+    // Takes over the terminal until the user quits. Throws std::runtime_error when stdin
+    // or stdout isn't a terminal, and rethrows any error the fetch thread ran into.
+    void run();
+
+private:
+    struct Cell {
+        const char* data = nullptr;
+        uint32_t length = 0;
+    };
+    struct RowChunk;
+
+    void _fetchLoop();
+    std::unique_ptr<RowChunk> _fetchChunk(std::vector<ColumnFormatter>& formatters, bool& moreRows);
+    void _evictLocked();
+    void _spillLocked(RowChunk& chunk);
+    void _mapViewportLocked(uint32_t viewRows);
+    const Cell* _rowLocked(uint64_t row) const;
+    void _settleWidthsLocked();
+    std::string _renderLocked(uint32_t viewRows, uint32_t screenColumns) const;
+    void _wake() noexcept;
+
+    OracleResultSource& _stmt;
+    const size_t _windowBytes;
+    std::vector<std::string> _columnNames;
+    // Sized from the column names until the first rows arrive, then settled for good.
+    std::vector<uint32_t> _columnWidths;
+    bool _widthsSettled = false;
+
+    // Everything below is shared with the fetch thread and guarded by _mutex.
+    std::mutex _mutex;
+    std::condition_variable _fetchWanted;
+    std::deque<std::unique_ptr<RowChunk>> _chunks;
+    // Of resident chunks only; mapped ones are backed by the page cache.
+    size_t _bytes = 0;
+    std::unique_ptr<SpillFile> _spill;
+    bool _spillFailed = false;
+    std::vector<RowChunk*> _mappedChunks;
+    uint64_t _fetchedRows = 0;
+    uint64_t _wantedRows = 0;
+    bool _moreRows = true;
+    bool _stop = false;
+    std::exception_ptr _error;
+
+    // View state. Only run() changes it, but eviction reads _topRow.
+    uint64_t _topRow = 0;
+    uint32_t _firstColumn = 0;
+    bool _followEnd = false;
+
+    // The fetch thread writes a byte here whenever it adds rows, so run() can wait for
+    // keys and new rows in one poll().
+    int _wakePipe[2] = {-1, -1};
+    std::thread _fetcher;
+};
+
+} // namespace sqlplusplus
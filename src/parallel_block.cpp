@@ -0,0 +1,259 @@
+#include "parallel_block.h"
+
+#include "work_stealing.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+
+namespace sqlplusplus {
+namespace {
+
+constexpr uint32_t kFetchArraySize = 1000;
+
+std::string rowsMessage(uint64_t rows, std::string_view what) {
+    return fmt::format("{} {} {}", rows, rows == 1 ? "row" : "rows", what);
+}
+
+std::string errorMessage(const std::exception& e) {
+    if (auto oracleError = dynamic_cast<const OracleException*>(&e)) {
+        return fmt::format("{}: {}", oracleError->context(), oracleError->what());
+    }
+    return e.what();
+}
+
+// Runs statement on conn and commits it, or rolls it back and records why it failed.
+void runStatement(OracleConnection& conn, const ParallelStatement& statement, ParallelOutcome& outcome) {
+    try {
+        conn.setAction(statement.action);
+        auto stmt = conn.prepareStatement(statement.sql);
+        stmt.setFetchArraySize(kFetchArraySize);
+        stmt.execute();
+        if (stmt.isQuery()) {
+            uint64_t rows = 0;
+            for (;;) {
+                auto block = stmt.fetchBlock(kFetchArraySize);
+                rows += block.numRows();
+                if (!block.moreRows()) {
+                    break;
+                }
+            }
+            outcome.message = rowsMessage(rows, "selected");
+        } else if (stmt.isDML()) {
+            outcome.message = rowsMessage(stmt.rowCount(), "affected");
+        } else {
+            outcome.message = "Statement executed";
+        }
+        conn.commit();
+    } catch(const std::exception& e) {
+        outcome.failed = true;
+        outcome.message = errorMessage(e);
+        try {
+            conn.rollback();
+        } catch(const std::exception&) {
+            // The failure is already being reported.
+        }
+    }
+}
+
+} // namespace
+
+std::vector<ParallelOutcome> runParallel(const std::function<OracleConnection()>& newConnection,
+                                         const std::vector<ParallelStatement>& statements,
+                                         uint32_t maxSessions) {
+    std::vector<ParallelOutcome> outcomes(statements.size());
+    // Whether each statement was taken by a connected worker.
+    std::vector<char> ran(statements.size(), 0);
+    std::atomic<size_t> nextStatement{0};
+    std::mutex errorMutex;
+    std::string connectError;
+
+    auto worker = [&](size_t) {
+        std::optional<OracleConnection> conn;
+        try {
+            conn.emplace(newConnection());
+        } catch(const std::exception& e) {
+            std::lock_guard<std::mutex> lk(errorMutex);
+            if (connectError.empty()) {
+                connectError = errorMessage(e);
+            }
+            return;
+        }
+        for (auto idx = nextStatement++; idx < statements.size(); idx = nextStatement++) {
+            const auto& statement = statements[idx];
+            auto& outcome = outcomes[idx];
+            ran[idx] = 1;
+            const auto start = std::chrono::steady_clock::now();
+            runStatement(*conn, statement, outcome);
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            outcome.seconds = elapsed.count();
+        }
+    };
+
+    // Sessions start as executor threads come free, so a statement is only left unrun if
+    // every one that started failed to connect.
+    const auto workers = std::min<size_t>(std::max<uint32_t>(maxSessions, 1), statements.size());
+    WorkStealingExecutor::sharedIo().runAll(workers, worker);
+
+    for (size_t idx = 0; idx < statements.size(); ++idx) {
+        if (!ran[idx]) {
+            outcomes[idx].failed = true;
+            outcomes[idx].message = connectError;
+        }
+    }
+    return outcomes;
+}
+
+std::vector<StepOutcome> runSteps(const std::function<OracleConnection()>& newConnection,
+                                  const std::vector<ParallelStep>& steps,
+                                  uint32_t maxSessions) {
+    std::map<std::string_view, size_t> positions;
+    for (size_t idx = 0; idx < steps.size(); ++idx) {
+        if (!positions.emplace(steps[idx].name, idx).second) {
+            throw std::runtime_error(fmt::format("step {} is declared twice", steps[idx].name));
+        }
+    }
+    std::vector<std::vector<size_t>> dependents(steps.size());
+    std::vector<size_t> waitingOn(steps.size());
+    for (size_t idx = 0; idx < steps.size(); ++idx) {
+        for (const auto& name : steps[idx].dependsOn) {
+            auto it = positions.find(name);
+            if (it == positions.end()) {
+                throw std::runtime_error(fmt::format("step {} depends on {}, which isn't a step", steps[idx].name, name));
+            }
+            dependents[it->second].push_back(idx);
+            ++waitingOn[idx];
+        }
+    }
+    // Whatever a topological pass can't reach is in a cycle, or waits on one.
+    {
+        auto remaining = waitingOn;
+        std::vector<size_t> reachable;
+        for (size_t idx = 0; idx < steps.size(); ++idx) {
+            if (remaining[idx] == 0) {
+                reachable.push_back(idx);
+            }
+        }
+        for (size_t next = 0; next < reachable.size(); ++next) {
+            for (const auto dependent : dependents[reachable[next]]) {
+                if (--remaining[dependent] == 0) {
+                    reachable.push_back(dependent);
+                }
+            }
+        }
+        if (reachable.size() < steps.size()) {
+            std::string stuck;
+            for (size_t idx = 0; idx < steps.size(); ++idx) {
+                if (remaining[idx] > 0) {
+                    stuck += fmt::format("{}{}", stuck.empty() ? "" : ", ", steps[idx].name);
+                }
+            }
+            throw std::runtime_error(fmt::format("steps {} depend on each other in a cycle", stuck));
+        }
+    }
+
+    std::vector<StepOutcome> outcomes(steps.size());
+    std::vector<char> ran(steps.size(), 0);
+    std::mutex mutex;
+    std::condition_variable cv;
+    // Guarded by mutex.
+    std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> ready;
+    size_t running = 0;
+    std::string connectError;
+    for (size_t idx = 0; idx < steps.size(); ++idx) {
+        if (waitingOn[idx] == 0) {
+            ready.push(idx);
+        }
+    }
+
+    // Skips everything downstream of a step that failed or was skipped itself.
+    std::function<void(size_t)> skipDependents = [&](size_t idx) {
+        for (const auto dependent : dependents[idx]) {
+            auto& outcome = outcomes[dependent];
+            if (outcome.skipped) {
+                continue;
+            }
+            outcome.failed = true;
+            outcome.skipped = true;
+            outcome.message = fmt::format("skipped: step {} {}", steps[idx].name,
+                                          outcomes[idx].skipped ? "was skipped" : "failed");
+            skipDependents(dependent);
+        }
+    };
+
+    auto worker = [&](size_t) {
+        std::optional<OracleConnection> conn;
+        try {
+            conn.emplace(newConnection());
+        } catch(const std::exception& e) {
+            std::lock_guard<std::mutex> lk(mutex);
+            if (connectError.empty()) {
+                connectError = errorMessage(e);
+            }
+            return;
+        }
+        std::unique_lock<std::mutex> lk(mutex);
+        for (;;) {
+            cv.wait(lk, [&] { return !ready.empty() || running == 0; });
+            if (ready.empty()) {
+                return;
+            }
+            const auto idx = ready.top();
+            ready.pop();
+            ++running;
+            ran[idx] = 1;
+            lk.unlock();
+
+            auto& outcome = outcomes[idx];
+            const auto start = std::chrono::steady_clock::now();
+            for (const auto& statement : steps[idx].statements) {
+                outcome.statements.emplace_back();
+                runStatement(*conn, statement, outcome.statements.back());
+                if (outcome.statements.back().failed) {
+                    outcome.failed = true;
+                    break;
+                }
+            }
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            outcome.seconds = elapsed.count();
+
+            lk.lock();
+            --running;
+            if (outcome.failed) {
+                skipDependents(idx);
+            } else {
+                for (const auto dependent : dependents[idx]) {
+                    if (--waitingOn[dependent] == 0) {
+                        ready.push(dependent);
+                    }
+                }
+            }
+            cv.notify_all();
+        }
+    };
+
+    // A worker only waits for steps that a running worker will finish or skip, so it's
+    // safe for the later ones to start once the earlier are done.
+    const auto workers = std::min<size_t>(std::max<uint32_t>(maxSessions, 1), steps.size());
+    WorkStealingExecutor::sharedIo().runAll(workers, worker);
+
+    for (size_t idx = 0; idx < steps.size(); ++idx) {
+        if (!ran[idx] && !outcomes[idx].skipped) {
+            outcomes[idx].failed = true;
+            outcomes[idx].skipped = true;
+            outcomes[idx].message = connectError;
+        }
+    }
+    return outcomes;
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+struct ParallelStatement {
+    std::string_view sql;
+    // Set as the session's action while the statement runs.
+    std::string action;
+};
+
+struct ParallelOutcome {
+    bool failed = false;
+    // Rows affected or fetched on success, the error otherwise.
+    std::string message;
+    double seconds = 0;
+};
+
+// Runs statements concurrently on up to maxSessions connections from newConnection, each
+// taking the next statement as soon as it's done with its last, and returns once they've
+// all finished. Outcomes come back in the order of statements.
+//
+// Each statement commits on its own when it succeeds and is rolled back when it fails, so
+// the statements must be independent of one another; they see what was committed before
+// the block, not the caller's uncommitted changes. Queries are fetched to the end and
+// their rows counted. If no connection can be had, the statements that didn't get to run
+// fail with the connection's error.
+std::vector<ParallelOutcome> runParallel(const std::function<OracleConnection()>& newConnection,
+                                         const std::vector<ParallelStatement>& statements,
+                                         uint32_t maxSessions);
+
+// A named group of statements in a parallel block, run in order on one session once every
+// step it depends on has succeeded.
+struct ParallelStep {
+    std::string name;
+    std::vector<std::string> dependsOn;
+    std::vector<ParallelStatement> statements;
+};
+
+struct StepOutcome {
+    // A statement failed, or the step didn't run; its dependents are skipped.
+    bool failed = false;
+    bool skipped = false;
+    // Why it was skipped.
+    std::string message;
+    double seconds = 0;
+    // For the statements that ran, in order; the last is the one that failed, if any did.
+    std::vector<ParallelOutcome> statements;
+};
+
+// Runs steps as a dependency graph on up to maxSessions connections from newConnection:
+// a step is started, on whichever session is free, as soon as the last step it depends on
+// succeeds, earlier steps first when more than one is ready. Statements commit or roll
+// back one by one as runParallel()'s do, and a failed statement ends its step. The steps
+// that depend on a failed one, directly or not, are skipped. Outcomes come back in the
+// order of steps.
+//
+// Throws std::runtime_error before anything runs if a step name is repeated, a step
+// depends on one that isn't there, or steps depend on each other in a cycle.
+std::vector<StepOutcome> runSteps(const std::function<OracleConnection()>& newConnection,
+                                  const std::vector<ParallelStep>& steps,
+                                  uint32_t maxSessions);
+
+} // namespace sqlplusplus
@@ -0,0 +1,429 @@
+#include "parallel_export.h"
+
+#include "buffered_writer.h"
+#include "delimited_writer.h"
+#include "json_text.h"
+#include "ndjson_writer.h"
+#include "parquet_writer.h"
+#include "typed_bind.h"
+#include "typed_rows.h"
+#include "work_stealing.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <future>
+#include <optional>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sqlplusplus {
+namespace {
+
+// Extents are numbered off in (object, file, block) order, the order ROWIDs compare in, and
+// cut into chunks by running block count. Each chunk's range runs from the first block of
+// its first extent to the last row slot of its last one.
+constexpr std::string_view kChunkSql = R"(
+WITH extents AS (
+    SELECT o.data_object_id, e.relative_fno, e.block_id, e.blocks,
+           TRUNC((SUM(e.blocks) OVER (ORDER BY o.data_object_id, e.relative_fno, e.block_id
+                                      ROWS UNBOUNDED PRECEDING) - e.blocks) * :1
+                 / SUM(e.blocks) OVER ()) AS chunk
+      FROM dba_extents e
+      JOIN dba_objects o
+        ON o.owner = e.owner AND o.object_name = e.segment_name AND o.object_type = e.segment_type
+       AND (o.subobject_name = e.partition_name OR (o.subobject_name IS NULL AND e.partition_name IS NULL))
+     WHERE e.owner = NVL(:2, SYS_CONTEXT('USERENV', 'CURRENT_SCHEMA'))
+       AND e.segment_name = :3
+       AND e.segment_type IN ('TABLE', 'TABLE PARTITION', 'TABLE SUBPARTITION'))
+SELECT ROWIDTOCHAR(DBMS_ROWID.ROWID_CREATE(1,
+           MIN(data_object_id) KEEP (DENSE_RANK FIRST ORDER BY data_object_id, relative_fno, block_id),
+           MIN(relative_fno) KEEP (DENSE_RANK FIRST ORDER BY data_object_id, relative_fno, block_id),
+           MIN(block_id) KEEP (DENSE_RANK FIRST ORDER BY data_object_id, relative_fno, block_id),
+           0)),
+       ROWIDTOCHAR(DBMS_ROWID.ROWID_CREATE(1,
+           MAX(data_object_id) KEEP (DENSE_RANK LAST ORDER BY data_object_id, relative_fno, block_id),
+           MAX(relative_fno) KEEP (DENSE_RANK LAST ORDER BY data_object_id, relative_fno, block_id),
+           MAX(block_id + blocks - 1) KEEP (DENSE_RANK LAST ORDER BY data_object_id, relative_fno, block_id),
+           32767))
+  FROM extents
+ GROUP BY chunk
+ ORDER BY chunk)";
+
+constexpr std::string_view kPartitionSql = R"(
+SELECT partition_name, NVL(blocks, 0)
+  FROM all_tab_partitions
+ WHERE table_owner = NVL(:1, SYS_CONTEXT('USERENV', 'CURRENT_SCHEMA'))
+   AND table_name = :2
+ ORDER BY partition_position)";
+
+// Flushes what's been written to path to disk, through an fd of its own, since the
+// writer's has been closed by then.
+void syncFile(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1 || ::fsync(fd) == -1) {
+        const int err = errno;
+        if (fd != -1) {
+            ::close(fd);
+        }
+        throw std::system_error(err, std::generic_category(), "error syncing " + path);
+    }
+    ::close(fd);
+}
+
+uint64_t fileSize(const std::string& path) {
+    struct stat st{};
+    return ::stat(path.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+}
+
+// One shard's worth of a statement's rows, for the writers, which write until their
+// source runs out: once the shard reaches a limit, its block is handed out as the last.
+class ShardSource : public OracleResultSource {
+public:
+    ShardSource(OracleStatement& stmt, const SplitLimits& limits) : _stmt(stmt), _limits(limits) {}
+
+    void start(const std::string& path) {
+        _path = &path;
+        _rows = 0;
+        _full = false;
+    }
+    // The statement has rows left for another shard.
+    bool full() const noexcept {
+        return _full;
+    }
+    // Also the shard's rows.
+    uint64_t rows() const noexcept {
+        return _rows;
+    }
+
+    uint32_t numColumns() const override {
+        return _stmt.numColumns();
+    }
+    OracleColumnInfo getColumnInfo(uint32_t pos) const override {
+        return _stmt.getColumnInfo(pos);
+    }
+    std::shared_ptr<const ResultMetadata> metadata() const override {
+        return _stmt.metadata();
+    }
+    uint32_t fetchArraySize() const override {
+        return _stmt.fetchArraySize();
+    }
+    const dpiJsonNode& jsonValue(const dpiData& data, uint32_t options) const override {
+        return _stmt.jsonValue(data, options);
+    }
+    const OracleContext* context() const noexcept override {
+        return _stmt.context();
+    }
+
+    OracleFetchBlock fetchBlock(uint32_t maxRows) override {
+        if (_full) {
+            return {};
+        }
+        if (_limits.maxRows > 0) {
+            maxRows = static_cast<uint32_t>(std::min<uint64_t>(maxRows, _limits.maxRows - _rows));
+        }
+        auto block = _stmt.fetchBlock(maxRows);
+        _rows += block.numRows();
+        if (!block.moreRows()) {
+            return block;
+        }
+        _full = (_limits.maxRows > 0 && _rows >= _limits.maxRows) ||
+                (_limits.maxBytes > 0 && fileSize(*_path) >= _limits.maxBytes);
+        if (!_full) {
+            return block;
+        }
+        std::vector<OracleFetchBlock::Column> columns;
+        columns.reserve(block.numColumns());
+        for (uint32_t pos = 1; pos <= block.numColumns(); ++pos) {
+            columns.push_back({block.nativeType(pos), block.columnData(pos)});
+        }
+        return OracleFetchBlock(std::move(columns), block.numRows(), block.bufferRowIndex(), false);
+    }
+
+private:
+    OracleStatement& _stmt;
+    const SplitLimits& _limits;
+    const std::string* _path = nullptr;
+    uint64_t _rows = 0;
+    bool _full = false;
+};
+
+// Shards being synced at once; the next shard waits for the oldest past this.
+constexpr size_t kMaxPendingSyncs = 4;
+
+} // namespace
+
+uint64_t writeShard(OracleResultSource& stmt, const std::string& path, const ParallelExportOptions& opts) {
+    if (opts.format == ExportFormat::Parquet) {
+        return writeParquetResults(stmt, path, opts.parquetRowGroupRows);
+    }
+    auto out = BufferedFdWriter::open(path, opts.compression, opts.fileWrite);
+    if (opts.format == ExportFormat::Ndjson) {
+        const auto numRows = writeNdjsonResults(stmt, out);
+        out.flush();
+        return numRows;
+    }
+    DelimitedWriter writer(out, opts.format == ExportFormat::Csv ? DelimitedFormat::Csv : DelimitedFormat::Tsv);
+    const auto numRows = writeDelimitedResults(stmt, writer);
+    out.flush();
+    return numRows;
+}
+
+namespace {
+
+// Runs a statement per shard from prepare, all at once on a connection each, each into
+// shard file idx of path; see exportTableParallel().
+std::vector<ExportShard> exportShardsAtOnce(const std::function<OracleConnection()>& newConnection,
+                                            size_t numShards,
+                                            const std::string& path,
+                                            const ParallelExportOptions& opts,
+                                            const std::function<OracleStatement(OracleConnection&, size_t)>& prepare) {
+    auto exportShard = [&](size_t idx) {
+        ExportShard shard;
+        shard.path = shardPath(path, idx);
+        if (idx < opts.skip.size() && opts.skip[idx]) {
+            shard.skipped = true;
+            return shard;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        auto conn = newConnection();
+        auto stmt = prepare(conn, idx);
+        if (opts.setUpStatement) {
+            opts.setUpStatement(stmt);
+        }
+        stmt.execute();
+        shard.rows = writeShard(stmt, shard.path, opts);
+        shard.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (opts.onShardDone) {
+            opts.onShardDone(idx, shard);
+        }
+        return shard;
+    };
+
+    // Each shard is a session of its own, on a thread of the I/O budget's.
+    auto& executor = WorkStealingExecutor::sharedIo();
+    std::vector<std::future<ExportShard>> workers;
+    workers.reserve(numShards);
+    for (size_t idx = 0; idx < numShards; ++idx) {
+        workers.push_back(executor.submit(executor.newAffinity(), [&exportShard, idx] { return exportShard(idx); }));
+    }
+
+    std::vector<ExportShard> shards;
+    std::exception_ptr firstError;
+    for (auto& worker : workers) {
+        try {
+            shards.push_back(executor.wait(worker));
+        } catch(...) {
+            if (!firstError) {
+                firstError = std::current_exception();
+            }
+        }
+    }
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+    return shards;
+}
+
+} // namespace
+
+std::vector<RowidRange> rowidRanges(OracleConnection& conn, std::string_view table, uint32_t numChunks) {
+    const auto [owner, tableName] = splitOwner(normalizeIdentifier(table, true));
+    auto stmt = conn.prepareStatement(kChunkSql);
+    bind(stmt, int64_t{std::max<uint32_t>(numChunks, 1)}, owner, tableName);
+    stmt.execute();
+    std::vector<RowidRange> ranges;
+    forEachRow<std::string_view, std::string_view>(stmt, [&](std::string_view first, std::string_view last) {
+        ranges.push_back({std::string(first), std::string(last)});
+    });
+    return ranges;
+}
+
+std::string shardPath(const std::string& path, size_t index) {
+    return shardPath(path, std::to_string(index + 1));
+}
+
+std::string shardPath(const std::string& path, std::string_view name) {
+    constexpr auto kGzip = std::string_view(".gz");
+    if (path.size() > kGzip.size() && std::string_view(path).substr(path.size() - kGzip.size()) == kGzip) {
+        return shardPath(path.substr(0, path.size() - kGzip.size()), name) + std::string(kGzip);
+    }
+    const auto slash = path.rfind('/');
+    const auto dot = path.rfind('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash) || dot == slash + 1) {
+        return fmt::format("{}.{}", path, name);
+    }
+    return fmt::format("{}.{}{}", path.substr(0, dot), name, path.substr(dot));
+}
+
+std::vector<TablePartition> tablePartitions(OracleConnection& conn, std::string_view table) {
+    const auto [owner, tableName] = splitOwner(normalizeIdentifier(table, true));
+    auto stmt = conn.prepareStatement(kPartitionSql);
+    bind(stmt, owner, tableName);
+    stmt.execute();
+    std::vector<TablePartition> partitions;
+    forEachRow<std::string_view, uint64_t>(stmt, [&](std::string_view name, uint64_t blocks) {
+        partitions.push_back({std::string(name), blocks});
+    });
+    return partitions;
+}
+
+std::string partitionExtendedName(std::string_view table, std::string_view partition) {
+    return fmt::format("{} PARTITION (\"{}\")", normalizeIdentifier(table, true), partition);
+}
+
+std::vector<ExportShard> exportTableParallel(const std::function<OracleConnection()>& newConnection,
+                                             std::string_view table,
+                                             const std::vector<RowidRange>& ranges,
+                                             const std::string& path,
+                                             const ParallelExportOptions& opts) {
+    const auto name = normalizeIdentifier(table, true);
+    // A table without a segment has no ranges, but still gets a file, if an empty one.
+    const auto numShards = std::max<size_t>(ranges.size(), 1);
+    return exportShardsAtOnce(newConnection, numShards, path, opts, [&](OracleConnection& conn, size_t idx) {
+        if (ranges.empty()) {
+            return conn.prepareStatement(fmt::format("SELECT * FROM {}", name));
+        }
+        auto stmt = conn.prepareStatement(fmt::format(
+                "SELECT * FROM {} WHERE ROWID BETWEEN CHARTOROWID(:1) AND CHARTOROWID(:2)", name));
+        bind(stmt, ranges[idx].first, ranges[idx].last);
+        return stmt;
+    });
+}
+
+std::vector<ExportShard> exportQueryParallel(const std::function<OracleConnection()>& newConnection,
+                                             std::string_view query,
+                                             std::string_view splitBy,
+                                             uint32_t numSlices,
+                                             const std::string& path,
+                                             const ParallelExportOptions& opts) {
+    numSlices = std::max<uint32_t>(numSlices, 1);
+    // The slice is part of the text rather than a bind, so it can't clash with the
+    // query's own placeholders.
+    return exportShardsAtOnce(newConnection, numSlices, path, opts, [&](OracleConnection& conn, size_t idx) {
+        return conn.prepareStatement(fmt::format(
+                "SELECT * FROM ({}) WHERE ORA_HASH({}, {}) = {}", query, splitBy, numSlices - 1, idx));
+    });
+}
+
+std::vector<ExportShard> exportPartitionsParallel(const std::function<OracleConnection()>& newConnection,
+                                                  std::string_view table,
+                                                  const std::vector<TablePartition>& partitions,
+                                                  uint32_t parallelism,
+                                                  const std::string& path,
+                                                  const ParallelExportOptions& opts) {
+    std::vector<ExportShard> shards(partitions.size());
+    std::vector<size_t> pending;
+    std::vector<uint64_t> sizes;
+    for (size_t idx = 0; idx < partitions.size(); ++idx) {
+        shards[idx].path = shardPath(path, std::string_view(partitions[idx].name));
+        if (idx < opts.skip.size() && opts.skip[idx]) {
+            shards[idx].skipped = true;
+        } else {
+            pending.push_back(idx);
+            sizes.push_back(partitions[idx].blocks);
+        }
+    }
+
+    // Each worker connects on its first partition and keeps the connection for the rest.
+    std::vector<std::optional<OracleConnection>> connections(std::max<uint32_t>(parallelism, 1));
+    runLongestFirst(sizes, parallelism, [&](uint32_t worker, size_t job) {
+        const auto idx = pending[job];
+        auto& shard = shards[idx];
+        const auto start = std::chrono::steady_clock::now();
+        auto& conn = connections[worker];
+        if (!conn) {
+            conn = newConnection();
+        }
+        auto stmt = conn->prepareStatement(
+                fmt::format("SELECT * FROM {}", partitionExtendedName(table, partitions[idx].name)));
+        if (opts.setUpStatement) {
+            opts.setUpStatement(stmt);
+        }
+        stmt.execute();
+        shard.rows = writeShard(stmt, shard.path, opts);
+        shard.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (opts.onShardDone) {
+            opts.onShardDone(idx, shard);
+        }
+    });
+    return shards;
+}
+
+std::string manifestPath(const std::string& path) {
+    return path + ".manifest.json";
+}
+
+std::vector<ExportShard> exportSplit(OracleStatement& stmt, const std::string& path,
+                                     const ParallelExportOptions& opts, const SplitLimits& limits) {
+    ShardSource source(stmt, limits);
+    std::vector<ExportShard> shards;
+    // Shards are flushed to disk on the I/O executor while the next one is written.
+    auto& executor = WorkStealingExecutor::sharedIo();
+    std::deque<std::future<void>> syncs;
+    auto waitForSyncs = [&](size_t pending) {
+        while (syncs.size() > pending) {
+            executor.wait(syncs.front());
+            syncs.pop_front();
+        }
+    };
+    try {
+        do {
+            ExportShard shard;
+            shard.path = shardPath(path, shards.size());
+            const auto start = std::chrono::steady_clock::now();
+            source.start(shard.path);
+            shard.rows = writeShard(source, shard.path, opts);
+            shard.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            // The statement can say it has more rows right up to the fetch that finds none.
+            if (shard.rows == 0 && !shards.empty()) {
+                ::unlink(shard.path.c_str());
+                break;
+            }
+            shard.bytes = fileSize(shard.path);
+            waitForSyncs(kMaxPendingSyncs - 1);
+            syncs.push_back(executor.submit([shardFile = shard.path] { syncFile(shardFile); }));
+            shards.push_back(std::move(shard));
+        } while (source.full());
+        waitForSyncs(0);
+    } catch(...) {
+        for (auto& sync : syncs) {
+            try {
+                executor.wait(sync);
+            } catch(...) {
+                // Not rethrown: the first error is the one to report.
+            }
+        }
+        throw;
+    }
+
+    uint64_t totalRows = 0;
+    std::string manifest = fmt::format("{{\"format\":\"{}\",\"shards\":[",
+            opts.format == ExportFormat::Parquet ? "parquet" :
+            opts.format == ExportFormat::Csv ? "csv" :
+            opts.format == ExportFormat::Tsv ? "tsv" : "ndjson");
+    std::string quoted;
+    for (size_t idx = 0; idx < shards.size(); ++idx) {
+        const auto& shard = shards[idx];
+        quoted.resize(jsonStringSizeBound(shard.path.size()));
+        quoted.resize(static_cast<size_t>(writeJsonString(shard.path, quoted.data()) - quoted.data()));
+        manifest += fmt::format("{}{{\"path\":{},\"rows\":{},\"bytes\":{}}}", idx == 0 ? "" : ",",
+                                quoted, shard.rows, shard.bytes);
+        totalRows += shard.rows;
+    }
+    manifest += fmt::format("],\"rows\":{}}}\n", totalRows);
+    auto out = BufferedFdWriter::open(manifestPath(path));
+    out.append(manifest);
+    out.flush();
+    return shards;
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "buffered_writer.h"
+#include "oracle_helpers.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+// ROWIDs bounding one chunk of a table, both inclusive, as ROWIDTOCHAR text.
+struct RowidRange {
+    std::string first;
+    std::string last;
+};
+
+// Splits a table's segments, partitions included, into up to numChunks ROWID ranges of
+// about the same number of blocks each, from its extents in DBA_EXTENTS, which takes
+// SELECT_CATALOG_ROLE or the like to read. Ranges are disjoint and together cover every
+// row; a table with fewer extents than numChunks gets fewer ranges, and one that has no
+// segment yet gets none. table may be qualified with its owner.
+std::vector<RowidRange> rowidRanges(OracleConnection& conn, std::string_view table, uint32_t numChunks);
+
+// Where shard index (0-based) of an export to path goes: data.csv becomes data.1.csv,
+// data.2.csv and so on, and a path without an extension just gets the number. A .gz
+// stays last, so data.csv.gz becomes data.1.csv.gz.
+std::string shardPath(const std::string& path, size_t index);
+// The same with a name in place of the number, e.g. data.P2024.csv for a partition.
+std::string shardPath(const std::string& path, std::string_view name);
+
+struct TablePartition {
+    std::string name;
+    // From the optimizer statistics; 0 for a partition that hasn't been analyzed.
+    uint64_t blocks = 0;
+};
+
+// The partitions of table from ALL_TAB_PARTITIONS in partition order; none if it isn't
+// partitioned. table may be qualified with its owner.
+std::vector<TablePartition> tablePartitions(OracleConnection& conn, std::string_view table);
+
+// table with a PARTITION ("name") extended name, for statements that should only see or
+// touch the one partition.
+std::string partitionExtendedName(std::string_view table, std::string_view partition);
+
+enum class ExportFormat { Csv, Tsv, Ndjson, Parquet };
+
+struct ExportShard;
+
+struct ParallelExportOptions {
+    ExportFormat format = ExportFormat::Csv;
+    uint32_t parquetRowGroupRows = 0;
+    // For each shard of a delimited or NDJSON export.
+    OutputCompression compression;
+    FileWriteOptions fileWrite;
+    // Run on each range's statement before it's executed, e.g. to apply fetch settings.
+    std::function<void(OracleStatement&)> setUpStatement;
+    // Shards, by index, that an interrupted run already wrote in full, which are left as
+    // they are and come back skipped.
+    std::vector<bool> skip;
+    // Called on the worker that wrote a shard once its file is complete, e.g. to
+    // checkpoint the export. An error it throws fails the export like the shard's own.
+    std::function<void(size_t index, const ExportShard& shard)> onShardDone;
+};
+
+struct ExportShard {
+    std::string path;
+    uint64_t rows = 0;
+    double seconds = 0;
+    bool skipped = false;
+    // The file's size once it's written; only exportSplit() sets it.
+    uint64_t bytes = 0;
+};
+
+// Writes the rest of an executed query to path in opts.format, returning its rows: the
+// one shard file each of the exports below writes per range or partition.
+uint64_t writeShard(OracleResultSource& stmt, const std::string& path, const ParallelExportOptions& opts);
+
+// Exports every row of table by running a range scan per ROWID range on a connection of
+// its own from newConnection, all at once, each writing its own shard file of path in the
+// chosen format, so no one server process or network stream limits the export. The
+// shards are returned in range order. If any range fails the first error is rethrown
+// once the others are done, with their files left behind.
+std::vector<ExportShard> exportTableParallel(const std::function<OracleConnection()>& newConnection,
+                                             std::string_view table,
+                                             const std::vector<RowidRange>& ranges,
+                                             const std::string& path,
+                                             const ParallelExportOptions& opts);
+
+// Exports every row of a query, such as a join or a view that has no ROWIDs to range
+// over, as numSlices copies of it run all at once like exportTableParallel()'s ranges,
+// each keeping the rows whose ORA_HASH(splitBy) falls in its slice. splitBy is an
+// expression over the query's columns; one with many distinct values, like a key, splits
+// the rows evenly. Each slice runs the whole query, so the server does numSlices times
+// the work of its joins to spread the fetching and writing out. query can't have bind
+// placeholders.
+std::vector<ExportShard> exportQueryParallel(const std::function<OracleConnection()>& newConnection,
+                                             std::string_view query,
+                                             std::string_view splitBy,
+                                             uint32_t numSlices,
+                                             const std::string& path,
+                                             const ParallelExportOptions& opts);
+
+// Exports every row of a partitioned table a partition at a time, each into its own shard
+// file of path named after it, on up to parallelism connections from newConnection that
+// take the biggest partitions first; see runLongestFirst(). For tables whose partitions
+// already split the work, where carving ROWID ranges out of each would only add scans.
+// The shards are returned in the order of partitions; errors are handled like
+// exportTableParallel()'s.
+std::vector<ExportShard> exportPartitionsParallel(const std::function<OracleConnection()>& newConnection,
+                                                  std::string_view table,
+                                                  const std::vector<TablePartition>& partitions,
+                                                  uint32_t parallelism,
+                                                  const std::string& path,
+                                                  const ParallelExportOptions& opts);
+
+// When exportSplit() moves on to the next shard; 0 is no limit, for either.
+struct SplitLimits {
+    uint64_t maxRows = 0;
+    // Checked against the shard's file between fetched blocks, so a shard can go over by
+    // about a block's rows and whatever the writer hasn't handed to the file yet.
+    uint64_t maxBytes = 0;
+
+    bool enabled() const noexcept {
+        return maxRows > 0 || maxBytes > 0;
+    }
+};
+
+// Where exportSplit() lists the shards of an export to path: data.csv.manifest.json.
+std::string manifestPath(const std::string& path);
+
+// Writes the rest of an executed query to shards of path, numbered as shardPath() numbers
+// them, each a whole file in opts.format with a header of its own, starting the next one
+// whenever one reaches a limit, so Spark or a loader can ingest them in parallel. A shard
+// is fsynced on the I/O executor once it's closed, while the next is written. Once all
+// of them are on disk, the manifest lists their paths, rows and sizes as JSON. Returns
+// the shards in order.
+std::vector<ExportShard> exportSplit(OracleStatement& stmt, const std::string& path,
+                                     const ParallelExportOptions& opts, const SplitLimits& limits);
+
+} // namespace sqlplusplus
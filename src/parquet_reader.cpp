@@ -0,0 +1,1339 @@
+#include "parquet_reader.h"
+
+#include "batch_sizer.h"
+#include "oracle_helpers.h"
+#include "session_executor.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#include <zlib.h>
+
+namespace sqlplusplus {
+namespace {
+
+constexpr std::string_view kMagic = "PAR1";
+// Longest string or binary value bound, as for CSV loads.
+constexpr uint32_t kMaxValueSize = 32767;
+constexpr uint32_t kMinValueSize = 64;
+
+// Values from parquet.thrift.
+enum PhysicalType : int32_t {
+    kBoolean = 0,
+    kInt32 = 1,
+    kInt64 = 2,
+    kInt96 = 3,
+    kFloat = 4,
+    kDouble = 5,
+    kByteArray = 6,
+    kFixedLenByteArray = 7,
+};
+enum ConvertedType : int32_t {
+    kUtf8 = 0,
+    kEnum = 4,
+    kDecimal = 5,
+    kDate = 6,
+    kTimestampMillis = 9,
+    kTimestampMicros = 10,
+    kUint8 = 11,
+    kUint16 = 12,
+    kUint32 = 13,
+    kUint64 = 14,
+    kJson = 19,
+};
+enum Codec : int32_t {
+    kUncompressed = 0,
+    kSnappy = 1,
+    kGzip = 2,
+};
+enum Encoding : int32_t {
+    kPlain = 0,
+    kPlainDictionary = 2,
+    kRle = 3,
+    kRleDictionary = 8,
+};
+enum PageType : int32_t {
+    kDataPage = 0,
+    kDictionaryPage = 2,
+    kDataPageV2 = 3,
+};
+constexpr int32_t kRepetitionOptional = 1;
+constexpr int32_t kRepetitionRepeated = 2;
+// The Julian day of 1970-01-01, which INT96 timestamps count from.
+constexpr int64_t kJulianEpochDay = 2440588;
+
+[[noreturn]] void corrupt(std::string_view what) {
+    throw std::runtime_error(fmt::format("corrupt parquet file: {}", what));
+}
+
+// Just enough of Thrift's compact protocol to read Parquet's footer and page headers;
+// fields nobody asks for are skipped.
+class ThriftCompactReader {
+public:
+    enum Type : uint8_t {
+        kTrue = 1,
+        kFalse = 2,
+        kByte = 3,
+        kI16 = 4,
+        kI32 = 5,
+        kI64 = 6,
+        kDouble = 7,
+        kBinary = 8,
+        kList = 9,
+        kSet = 10,
+        kMap = 11,
+        kStruct = 12,
+    };
+
+    explicit ThriftCompactReader(std::string_view data) : _data(data) {}
+
+    size_t position() const noexcept {
+        return _pos;
+    }
+
+    // Calls onField(id, type) for each field of the struct that starts here; it has to
+    // read the field's value or skip() it.
+    template <typename Fn>
+    void readStruct(Fn&& onField) {
+        if (++_depth > kMaxDepth) {
+            corrupt("metadata nests too deep");
+        }
+        int16_t lastId = 0;
+        for (;;) {
+            const auto header = _byte();
+            if (header == 0) {
+                break;
+            }
+            const auto type = static_cast<uint8_t>(header & 0x0f);
+            const auto delta = header >> 4;
+            const auto id = delta != 0 ? static_cast<int16_t>(lastId + delta) : static_cast<int16_t>(i32());
+            lastId = id;
+            onField(id, type);
+        }
+        --_depth;
+    }
+
+    // Calls onElement(type) for each element of the list that starts here.
+    template <typename Fn>
+    void readList(Fn&& onElement) {
+        const auto header = _byte();
+        uint64_t size = header >> 4;
+        if (size == 15) {
+            size = _varint();
+        }
+        if (size > _data.size() - _pos) {
+            corrupt("list is longer than the metadata");
+        }
+        const auto type = static_cast<uint8_t>(header & 0x0f);
+        for (uint64_t idx = 0; idx < size; ++idx) {
+            onElement(type);
+        }
+    }
+
+    int32_t i32() {
+        return static_cast<int32_t>(i64());
+    }
+    int64_t i64() {
+        const auto value = _varint();
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+    std::string_view binary() {
+        const auto size = _varint();
+        if (size > _data.size() - _pos) {
+            corrupt("string is longer than the metadata");
+        }
+        const auto value = _data.substr(_pos, size);
+        _pos += size;
+        return value;
+    }
+
+    void skip(uint8_t type) {
+        switch (type) {
+        case kTrue:
+        case kFalse:
+            // A boolean field's value is its type; list elements skip theirs below.
+            break;
+        case kByte:
+            _byte();
+            break;
+        case kI16:
+        case kI32:
+        case kI64:
+            _varint();
+            break;
+        case kDouble:
+            _advance(8);
+            break;
+        case kBinary:
+            binary();
+            break;
+        case kList:
+        case kSet:
+            readList([this](uint8_t elementType) {
+                if (elementType == kTrue || elementType == kFalse) {
+                    _byte();
+                } else {
+                    skip(elementType);
+                }
+            });
+            break;
+        case kMap: {
+            const auto size = _varint();
+            if (size > 0) {
+                const auto types = _byte();
+                for (uint64_t idx = 0; idx < size; ++idx) {
+                    skip(types >> 4);
+                    skip(types & 0x0f);
+                }
+            }
+            break;
+        }
+        case kStruct:
+            readStruct([this](int16_t, uint8_t fieldType) { skip(fieldType); });
+            break;
+        default:
+            corrupt("unknown metadata type");
+        }
+    }
+
+private:
+    static constexpr int kMaxDepth = 32;
+
+    uint8_t _byte() {
+        if (_pos >= _data.size()) {
+            corrupt("metadata ends early");
+        }
+        return static_cast<uint8_t>(_data[_pos++]);
+    }
+    void _advance(size_t size) {
+        if (size > _data.size() - _pos) {
+            corrupt("metadata ends early");
+        }
+        _pos += size;
+    }
+    uint64_t _varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const auto byte = _byte();
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        corrupt("varint is too long");
+    }
+
+    std::string_view _data;
+    size_t _pos = 0;
+    int _depth = 0;
+};
+
+uint32_t readLe32(const char* data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+// Snappy's raw format, as Parquet stores its SNAPPY pages: the uncompressed length as a
+// varint, then literals and back references.
+void snappyDecompress(std::string_view in, char* out, size_t outSize) {
+    size_t pos = 0;
+    auto byte = [&] {
+        if (pos >= in.size()) {
+            corrupt("snappy data ends early");
+        }
+        return static_cast<uint8_t>(in[pos++]);
+    };
+    uint64_t length = 0;
+    for (int shift = 0;; shift += 7) {
+        const auto value = byte();
+        length |= static_cast<uint64_t>(value & 0x7f) << shift;
+        if ((value & 0x80) == 0 || shift > 28) {
+            break;
+        }
+    }
+    if (length != outSize) {
+        corrupt("snappy page isn't the size its header says");
+    }
+
+    size_t outPos = 0;
+    while (pos < in.size()) {
+        const auto tag = byte();
+        size_t size;
+        size_t offset = 0;
+        switch (tag & 3) {
+        case 0:
+            size = tag >> 2;
+            if (size >= 60) {
+                const auto numBytes = size - 59;
+                size = 0;
+                for (size_t idx = 0; idx < numBytes; ++idx) {
+                    size |= static_cast<size_t>(byte()) << (8 * idx);
+                }
+            }
+            ++size;
+            if (size > in.size() - pos || size > outSize - outPos) {
+                corrupt("snappy literal runs past the end");
+            }
+            std::memcpy(out + outPos, in.data() + pos, size);
+            pos += size;
+            outPos += size;
+            continue;
+        case 1:
+            size = ((tag >> 2) & 7) + 4;
+            offset = static_cast<size_t>(tag >> 5) << 8;
+            offset |= byte();
+            break;
+        case 2:
+            size = (tag >> 2) + 1;
+            offset = byte();
+            offset |= static_cast<size_t>(byte()) << 8;
+            break;
+        default:
+            size = (tag >> 2) + 1;
+            for (int idx = 0; idx < 4; ++idx) {
+                offset |= static_cast<size_t>(byte()) << (8 * idx);
+            }
+            break;
+        }
+        if (offset == 0 || offset > outPos || size > outSize - outPos) {
+            corrupt("snappy copy runs past the end");
+        }
+        // Copies can overlap what they write, which repeats the bytes.
+        for (size_t idx = 0; idx < size; ++idx, ++outPos) {
+            out[outPos] = out[outPos - offset];
+        }
+    }
+    if (outPos != outSize) {
+        corrupt("snappy page is short");
+    }
+}
+
+void gzipDecompress(std::string_view in, char* out, size_t outSize) {
+    z_stream stream{};
+    // 32 over the window bits takes a gzip or a zlib header, whichever is there.
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+        throw std::runtime_error("can't start inflating a gzip page");
+    }
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    stream.avail_in = static_cast<uInt>(in.size());
+    stream.next_out = reinterpret_cast<Bytef*>(out);
+    stream.avail_out = static_cast<uInt>(outSize);
+    const auto rc = inflate(&stream, Z_FINISH);
+    const auto written = stream.total_out;
+    inflateEnd(&stream);
+    if (rc != Z_STREAM_END || written != outSize) {
+        corrupt("gzip page doesn't inflate to its size");
+    }
+}
+
+std::string_view decompress(std::string_view data, int32_t codec, size_t uncompressedSize, StringArena& storage) {
+    if (codec == kUncompressed) {
+        return data;
+    }
+    auto out = storage.allocate(std::max<size_t>(uncompressedSize, 1));
+    switch (codec) {
+    case kSnappy:
+        snappyDecompress(data, out, uncompressedSize);
+        break;
+    case kGzip:
+        gzipDecompress(data, out, uncompressedSize);
+        break;
+    default:
+        throw std::runtime_error(fmt::format(
+                "parquet pages compressed with codec {} can't be read, only uncompressed, snappy and gzip", codec));
+    }
+    return std::string_view(out, uncompressedSize);
+}
+
+// Appends count values of the RLE/bit-packed hybrid encoding with the given bit width.
+template <typename T>
+void decodeHybrid(std::string_view data, uint32_t bitWidth, size_t count, std::vector<T>& out) {
+    if (bitWidth > 32) {
+        corrupt("bit width is over 32");
+    }
+    const size_t valueBytes = (bitWidth + 7) / 8;
+    const uint64_t valueMask = bitWidth == 32 ? 0xffffffffu : (uint64_t{1} << bitWidth) - 1;
+    const auto end = out.size() + count;
+    size_t pos = 0;
+    while (out.size() < end) {
+        uint64_t header = 0;
+        for (int shift = 0;; shift += 7) {
+            if (pos >= data.size() || shift > 35) {
+                corrupt("levels or indices end early");
+            }
+            const auto byte = static_cast<uint8_t>(data[pos++]);
+            header |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+        }
+        if ((header & 1) == 0) {
+            const auto runLength = std::min<uint64_t>(header >> 1, end - out.size());
+            if (valueBytes > data.size() - pos) {
+                corrupt("levels or indices end early");
+            }
+            uint64_t value = 0;
+            for (size_t idx = 0; idx < valueBytes; ++idx) {
+                value |= static_cast<uint64_t>(static_cast<uint8_t>(data[pos + idx])) << (8 * idx);
+            }
+            pos += valueBytes;
+            out.insert(out.end(), runLength, static_cast<T>(value));
+        } else {
+            const auto numValues = (header >> 1) * 8;
+            const auto numBytes = (header >> 1) * bitWidth;
+            if (numBytes > data.size() - pos) {
+                corrupt("levels or indices end early");
+            }
+            const auto* bytes = reinterpret_cast<const uint8_t*>(data.data() + pos);
+            for (uint64_t idx = 0; idx < numValues && out.size() < end; ++idx) {
+                const auto bit = idx * bitWidth;
+                uint64_t word = 0;
+                for (size_t byte = bit / 8; byte < numBytes && byte * 8 < bit + bitWidth; ++byte) {
+                    word |= static_cast<uint64_t>(bytes[byte]) << (byte * 8 - bit / 8 * 8);
+                }
+                out.push_back(static_cast<T>((word >> (bit % 8)) & valueMask));
+            }
+            pos += numBytes;
+        }
+    }
+}
+
+// The values of a column, before nulls are spread out between them.
+struct DecodedValues {
+    std::vector<int64_t> ints;
+    std::vector<double> doubles;
+    std::vector<std::string_view> bytes;
+
+    size_t size(int32_t physicalType) const {
+        switch (physicalType) {
+        case kFloat:
+        case kDouble:
+            return doubles.size();
+        case kByteArray:
+        case kFixedLenByteArray:
+            return bytes.size();
+        default:
+            return ints.size();
+        }
+    }
+};
+
+template <typename T>
+T readValue(std::string_view data, size_t& pos) {
+    if (sizeof(T) > data.size() - pos) {
+        corrupt("page ends early");
+    }
+    T value;
+    std::memcpy(&value, data.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+}
+
+// Appends count PLAIN encoded values, which are little-endian as ODPI's platforms are.
+void decodePlain(std::string_view data, int32_t physicalType, int32_t typeLength, bool zeroExtend,
+                 size_t count, DecodedValues& out) {
+    size_t pos = 0;
+    switch (physicalType) {
+    case kBoolean:
+        if ((count + 7) / 8 > data.size()) {
+            corrupt("page ends early");
+        }
+        for (size_t idx = 0; idx < count; ++idx) {
+            out.ints.push_back((static_cast<uint8_t>(data[idx / 8]) >> (idx % 8)) & 1);
+        }
+        break;
+    case kInt32:
+        for (size_t idx = 0; idx < count; ++idx) {
+            const auto value = readValue<int32_t>(data, pos);
+            out.ints.push_back(zeroExtend ? static_cast<int64_t>(static_cast<uint32_t>(value)) : value);
+        }
+        break;
+    case kInt64:
+        for (size_t idx = 0; idx < count; ++idx) {
+            out.ints.push_back(readValue<int64_t>(data, pos));
+        }
+        break;
+    case kInt96:
+        // Nanoseconds into the day, then the Julian day.
+        for (size_t idx = 0; idx < count; ++idx) {
+            const auto nanos = readValue<int64_t>(data, pos);
+            const auto day = static_cast<int64_t>(readValue<uint32_t>(data, pos));
+            out.ints.push_back((day - kJulianEpochDay) * 86400 * 1000000000 + nanos);
+        }
+        break;
+    case kFloat:
+        for (size_t idx = 0; idx < count; ++idx) {
+            out.doubles.push_back(readValue<float>(data, pos));
+        }
+        break;
+    case kDouble:
+        for (size_t idx = 0; idx < count; ++idx) {
+            out.doubles.push_back(readValue<double>(data, pos));
+        }
+        break;
+    case kByteArray:
+        for (size_t idx = 0; idx < count; ++idx) {
+            const auto size = readValue<uint32_t>(data, pos);
+            if (size > data.size() - pos) {
+                corrupt("byte array runs past its page");
+            }
+            out.bytes.push_back(data.substr(pos, size));
+            pos += size;
+        }
+        break;
+    case kFixedLenByteArray: {
+        const auto size = static_cast<size_t>(typeLength);
+        if (size * count > data.size()) {
+            corrupt("page ends early");
+        }
+        for (size_t idx = 0; idx < count; ++idx) {
+            out.bytes.push_back(data.substr(idx * size, size));
+        }
+        break;
+    }
+    default:
+        corrupt("unknown physical type");
+    }
+}
+
+// The values of a data page, in whatever encoding it's in.
+void decodeValues(std::string_view data, int32_t encoding, int32_t physicalType, int32_t typeLength,
+                  bool zeroExtend, size_t count, const std::optional<DecodedValues>& dictionary,
+                  std::vector<uint32_t>& indices, DecodedValues& out) {
+    switch (encoding) {
+    case kPlain:
+        decodePlain(data, physicalType, typeLength, zeroExtend, count, out);
+        return;
+    case kPlainDictionary:
+    case kRleDictionary: {
+        if (!dictionary) {
+            corrupt("dictionary encoded page without a dictionary");
+        }
+        if (count == 0) {
+            return;
+        }
+        if (data.empty()) {
+            corrupt("page ends early");
+        }
+        indices.clear();
+        decodeHybrid(data.substr(1), static_cast<uint8_t>(data[0]), count, indices);
+        const auto dictSize = dictionary->size(physicalType);
+        for (auto index : indices) {
+            if (index >= dictSize) {
+                corrupt("dictionary index is out of range");
+            }
+        }
+        switch (physicalType) {
+        case kFloat:
+        case kDouble:
+            for (auto index : indices) {
+                out.doubles.push_back(dictionary->doubles[index]);
+            }
+            break;
+        case kByteArray:
+        case kFixedLenByteArray:
+            for (auto index : indices) {
+                out.bytes.push_back(dictionary->bytes[index]);
+            }
+            break;
+        default:
+            for (auto index : indices) {
+                out.ints.push_back(dictionary->ints[index]);
+            }
+            break;
+        }
+        return;
+    }
+    case kRle:
+        if (physicalType == kBoolean && data.size() >= 4) {
+            decodeHybrid(data.substr(4, readLe32(data.data())), 1, count, out.ints);
+            return;
+        }
+        break;
+    }
+    throw std::runtime_error(fmt::format("parquet pages with encoding {} can't be read", encoding));
+}
+
+// Moves the page's count values into a slot per row of out from start on, leaving the
+// rows that aren't present at a default value.
+template <typename T>
+void spread(std::vector<T>& out, size_t start, const std::vector<T>& values, const uint8_t* present, size_t numRows) {
+    out.resize(start + numRows);
+    size_t next = 0;
+    for (size_t row = 0; row < numRows; ++row) {
+        out[start + row] = present[row] ? values[next++] : T{};
+    }
+}
+
+// Days since 1970-01-01 to a proleptic Gregorian date.
+void civilFromDays(int64_t days, int64_t& year, unsigned& month, unsigned& day) {
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const auto doe = static_cast<unsigned>(days - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = static_cast<int64_t>(yoe) + era * 400 + (month <= 2);
+}
+
+int64_t floorDiv(int64_t value, int64_t divisor) {
+    return value / divisor - ((value % divisor) < 0 ? 1 : 0);
+}
+
+dpiTimestamp timestampFrom(int64_t ticks, int64_t unitsPerSecond) {
+    const auto seconds = floorDiv(ticks, unitsPerSecond);
+    const auto fraction = ticks - seconds * unitsPerSecond;
+    const auto days = floorDiv(seconds, 86400);
+    const auto secondOfDay = seconds - days * 86400;
+    int64_t year;
+    unsigned month, day;
+    civilFromDays(days, year, month, day);
+    dpiTimestamp ts{};
+    ts.year = static_cast<int16_t>(year);
+    ts.month = static_cast<uint8_t>(month);
+    ts.day = static_cast<uint8_t>(day);
+    ts.hour = static_cast<uint8_t>(secondOfDay / 3600);
+    ts.minute = static_cast<uint8_t>(secondOfDay / 60 % 60);
+    ts.second = static_cast<uint8_t>(secondOfDay % 60);
+    ts.fsecond = static_cast<uint32_t>(fraction * (1000000000 / unitsPerSecond));
+    return ts;
+}
+
+// The unscaled value over scale digits as decimal text.
+std::string_view decimalText(__int128 unscaled, int32_t scale, StringArena& arena) {
+    char digits[48];
+    size_t numDigits = 0;
+    const bool negative = unscaled < 0;
+    auto magnitude = negative ? -static_cast<unsigned __int128>(unscaled) : static_cast<unsigned __int128>(unscaled);
+    do {
+        digits[numDigits++] = static_cast<char>('0' + static_cast<int>(magnitude % 10));
+        magnitude /= 10;
+    } while (magnitude != 0);
+    const auto fractionDigits = static_cast<size_t>(std::max(scale, 0));
+    while (numDigits <= fractionDigits) {
+        digits[numDigits++] = '0';
+    }
+    auto out = arena.allocate(numDigits + 2);
+    size_t len = 0;
+    if (negative) {
+        out[len++] = '-';
+    }
+    for (size_t idx = numDigits; idx-- > 0;) {
+        out[len++] = digits[idx];
+        if (idx == fractionDigits && idx != 0) {
+            out[len++] = '.';
+        }
+    }
+    arena.shrinkLast(numDigits + 2 - len);
+    return std::string_view(out, len);
+}
+
+// A DECIMAL stored as big-endian two's complement bytes.
+__int128 unscaledFromBytes(std::string_view bytes, std::string_view column) {
+    if (bytes.size() > 16) {
+        throw std::runtime_error(fmt::format("a decimal in column {} has more than 38 digits", column));
+    }
+    unsigned __int128 value = bytes.empty() || (static_cast<uint8_t>(bytes[0]) & 0x80) == 0 ? 0 : ~static_cast<unsigned __int128>(0);
+    for (auto byte : bytes) {
+        value = (value << 8) | static_cast<uint8_t>(byte);
+    }
+    return static_cast<__int128>(value);
+}
+
+// How a column's values are bound for loadParquet().
+enum class BindKind { Int64, Double, Text, Raw, Date, Timestamp, TimestampTz };
+
+BindKind bindKindFor(const ParquetFileColumn& column, bool narrowInt) {
+    switch (column.kind) {
+    case ParquetValueKind::Integer:
+        return BindKind::Int64;
+    case ParquetValueKind::UnsignedInteger:
+        // Past INT64_MAX a UINT_64 only fits as text.
+        return narrowInt ? BindKind::Int64 : BindKind::Text;
+    case ParquetValueKind::Decimal:
+    case ParquetValueKind::String:
+        return BindKind::Text;
+    case ParquetValueKind::Double:
+        return BindKind::Double;
+    case ParquetValueKind::Binary:
+        return BindKind::Raw;
+    case ParquetValueKind::Date:
+        return BindKind::Date;
+    case ParquetValueKind::Timestamp:
+        return column.utc ? BindKind::TimestampTz : BindKind::Timestamp;
+    }
+    return BindKind::Text;
+}
+
+OracleVariable makeArray(OracleConnection& conn, BindKind kind, uint32_t valueSize, uint32_t numRows) {
+    OracleConnection::VariableOpts varopts;
+    varopts.opts = OracleConnection::VariableOpts::ByteBufferOpts{0, false};
+    switch (kind) {
+    case BindKind::Int64:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_NUMBER;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_INT64;
+        break;
+    case BindKind::Double:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_NATIVE_DOUBLE;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_DOUBLE;
+        break;
+    case BindKind::Text:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_VARCHAR;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+        varopts.opts = OracleConnection::VariableOpts::ByteBufferOpts{valueSize, true};
+        break;
+    case BindKind::Raw:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_RAW;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+        varopts.opts = OracleConnection::VariableOpts::ByteBufferOpts{valueSize, false};
+        break;
+    case BindKind::Date:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_DATE;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_TIMESTAMP;
+        break;
+    case BindKind::Timestamp:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_TIMESTAMP;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_TIMESTAMP;
+        break;
+    case BindKind::TimestampTz:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_TIMESTAMP_TZ;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_TIMESTAMP;
+        break;
+    }
+    varopts.maxArraySize = numRows;
+    return conn.newArrayVariable(varopts);
+}
+
+} // namespace
+
+void ParquetColumnValues::clear() {
+    present.clear();
+    ints.clear();
+    doubles.clear();
+    bytes.clear();
+    storage.reset();
+}
+
+ParquetReader::ParquetReader(const std::string& path) : _path(path), _file(path) {
+    const auto contents = _file.contents();
+    if (contents.size() < 12 || contents.substr(0, 4) != kMagic || contents.substr(contents.size() - 4) != kMagic) {
+        throw std::runtime_error(fmt::format("{} isn't a parquet file", path));
+    }
+    const auto footerSize = readLe32(contents.data() + contents.size() - 8);
+    if (footerSize > contents.size() - 12) {
+        corrupt("footer is bigger than the file");
+    }
+    ThriftCompactReader meta(contents.substr(contents.size() - 8 - footerSize, footerSize));
+
+    struct SchemaElement {
+        std::string name;
+        int32_t type = -1;
+        int32_t typeLength = 0;
+        int32_t repetition = 0;
+        int32_t numChildren = 0;
+        int32_t convertedType = -1;
+        int32_t scale = 0;
+        // From the logical type, which newer writers set instead of or as well as the
+        // converted type.
+        std::optional<ParquetValueKind> logicalKind;
+        int64_t unitsPerSecond = 1;
+        bool utc = false;
+    };
+    std::vector<SchemaElement> schema;
+    meta.readStruct([&](int16_t id, uint8_t type) {
+        switch (id) {
+        case 2:
+            meta.readList([&](uint8_t) {
+                auto& element = schema.emplace_back();
+                meta.readStruct([&](int16_t id, uint8_t type) {
+                    switch (id) {
+                    case 1: element.type = meta.i32(); break;
+                    case 2: element.typeLength = meta.i32(); break;
+                    case 3: element.repetition = meta.i32(); break;
+                    case 4: element.name = std::string(meta.binary()); break;
+                    case 5: element.numChildren = meta.i32(); break;
+                    case 6: element.convertedType = meta.i32(); break;
+                    case 7: element.scale = meta.i32(); break;
+                    case 10:
+                        meta.readStruct([&](int16_t id, uint8_t type) {
+                            switch (id) {
+                            case 1: case 4: case 12:
+                                element.logicalKind = ParquetValueKind::String;
+                                meta.skip(type);
+                                break;
+                            case 5:
+                                element.logicalKind = ParquetValueKind::Decimal;
+                                meta.readStruct([&](int16_t id, uint8_t type) {
+                                    if (id == 1) {
+                                        element.scale = meta.i32();
+                                    } else {
+                                        meta.skip(type);
+                                    }
+                                });
+                                break;
+                            case 6:
+                                element.logicalKind = ParquetValueKind::Date;
+                                meta.skip(type);
+                                break;
+                            case 8:
+                                element.logicalKind = ParquetValueKind::Timestamp;
+                                meta.readStruct([&](int16_t id, uint8_t type) {
+                                    if (id == 1) {
+                                        element.utc = type == ThriftCompactReader::kTrue;
+                                    } else if (id == 2) {
+                                        meta.readStruct([&](int16_t unit, uint8_t type) {
+                                            element.unitsPerSecond = unit == 1 ? 1000 : unit == 2 ? 1000000 : 1000000000;
+                                            meta.skip(type);
+                                        });
+                                    } else {
+                                        meta.skip(type);
+                                    }
+                                });
+                                break;
+                            case 10:
+                                meta.readStruct([&](int16_t id, uint8_t type) {
+                                    // INTEGER's isSigned, which only matters for 64 bits.
+                                    if (id == 2 && type == ThriftCompactReader::kFalse) {
+                                        element.convertedType = element.type == kInt64 ? kUint64 : kUint32;
+                                    }
+                                    meta.skip(type);
+                                });
+                                break;
+                            default:
+                                meta.skip(type);
+                                break;
+                            }
+                        });
+                        break;
+                    default:
+                        meta.skip(type);
+                        break;
+                    }
+                });
+            });
+            break;
+        case 3:
+            _numRows = static_cast<uint64_t>(meta.i64());
+            break;
+        case 4:
+            meta.readList([&](uint8_t) {
+                auto& rowGroup = _rowGroups.emplace_back();
+                rowGroup.numRows = 0;
+                meta.readStruct([&](int16_t id, uint8_t type) {
+                    if (id == 1) {
+                        meta.readList([&](uint8_t) {
+                            auto& chunk = rowGroup.columns.emplace_back();
+                            chunk = ColumnChunk{kUncompressed, 0, 0, 0};
+                            uint64_t dataOffset = 0;
+                            uint64_t dictionaryOffset = 0;
+                            meta.readStruct([&](int16_t id, uint8_t type) {
+                                if (id == 1) {
+                                    throw std::runtime_error(fmt::format(
+                                            "{} keeps its columns in other files, which can't be read", path));
+                                }
+                                if (id != 3) {
+                                    meta.skip(type);
+                                    return;
+                                }
+                                meta.readStruct([&](int16_t id, uint8_t type) {
+                                    switch (id) {
+                                    case 4: chunk.codec = meta.i32(); break;
+                                    case 5: chunk.numValues = static_cast<uint64_t>(meta.i64()); break;
+                                    case 7: chunk.size = static_cast<uint64_t>(meta.i64()); break;
+                                    case 9: dataOffset = static_cast<uint64_t>(meta.i64()); break;
+                                    case 11: dictionaryOffset = static_cast<uint64_t>(meta.i64()); break;
+                                    default: meta.skip(type); break;
+                                    }
+                                });
+                            });
+                            // Some writers leave a dictionary offset of 0 when there isn't one.
+                            chunk.offset = dictionaryOffset != 0 && dictionaryOffset < dataOffset
+                                ? dictionaryOffset : dataOffset;
+                        });
+                    } else if (id == 3) {
+                        rowGroup.numRows = static_cast<uint64_t>(meta.i64());
+                    } else {
+                        meta.skip(type);
+                    }
+                });
+            });
+            break;
+        default:
+            meta.skip(type);
+            break;
+        }
+    });
+
+    if (schema.empty()) {
+        corrupt("schema is empty");
+    }
+    for (size_t idx = 1; idx < schema.size(); ++idx) {
+        const auto& element = schema[idx];
+        if (element.numChildren > 0 || element.type < 0 || element.repetition == kRepetitionRepeated) {
+            throw std::runtime_error(fmt::format(
+                    "{} has nested or repeated column {}, which can't be loaded", path, element.name));
+        }
+        ParquetFileColumn column;
+        column.name = element.name;
+        column.scale = element.scale;
+        column.unitsPerSecond = element.unitsPerSecond;
+        column.utc = element.utc;
+        const auto converted = element.convertedType;
+        if (element.type == kInt96) {
+            column.kind = ParquetValueKind::Timestamp;
+            column.unitsPerSecond = 1000000000;
+        } else if (element.logicalKind) {
+            column.kind = *element.logicalKind;
+        } else if (converted == kDecimal) {
+            column.kind = ParquetValueKind::Decimal;
+        } else if (converted == kDate) {
+            column.kind = ParquetValueKind::Date;
+        } else if (converted == kTimestampMillis || converted == kTimestampMicros) {
+            // The converted types are UTC.
+            column.kind = ParquetValueKind::Timestamp;
+            column.unitsPerSecond = converted == kTimestampMillis ? 1000 : 1000000;
+            column.utc = true;
+        } else if (converted == kUtf8 || converted == kEnum || converted == kJson) {
+            column.kind = ParquetValueKind::String;
+        } else {
+            switch (element.type) {
+            case kFloat:
+            case kDouble:
+                column.kind = ParquetValueKind::Double;
+                break;
+            case kByteArray:
+            case kFixedLenByteArray:
+                column.kind = ParquetValueKind::Binary;
+                break;
+            default:
+                column.kind = converted == kUint64 ? ParquetValueKind::UnsignedInteger : ParquetValueKind::Integer;
+                break;
+            }
+        }
+        _columns.push_back(std::move(column));
+        const bool zeroExtend = converted == kUint8 || converted == kUint16 || converted == kUint32;
+        _leaves.push_back({element.type, element.typeLength, element.repetition == kRepetitionOptional, zeroExtend});
+    }
+    for (const auto& rowGroup : _rowGroups) {
+        if (rowGroup.columns.size() != _columns.size()) {
+            corrupt("row group doesn't match the schema");
+        }
+        for (const auto& chunk : rowGroup.columns) {
+            if (chunk.offset > contents.size() || chunk.size > contents.size() - chunk.offset) {
+                corrupt("column chunk runs past the end of the file");
+            }
+        }
+    }
+}
+
+void ParquetReader::readColumn(size_t rowGroup, size_t column, ParquetColumnValues& values) const {
+    values.clear();
+    const auto& chunk = _rowGroups.at(rowGroup).columns.at(column);
+    const auto& leaf = _leaves.at(column);
+    const auto contents = _file.contents().substr(chunk.offset, chunk.size);
+
+    std::optional<DecodedValues> dictionary;
+    DecodedValues decoded;
+    std::vector<uint32_t> indices;
+    size_t pos = 0;
+    uint64_t valuesRead = 0;
+    while (valuesRead < chunk.numValues) {
+        if (pos >= contents.size()) {
+            corrupt(fmt::format("column {} ends before its values do", _columns[column].name));
+        }
+        ThriftCompactReader header(contents.substr(pos));
+        int32_t pageType = -1;
+        int32_t uncompressedSize = 0;
+        int32_t compressedSize = 0;
+        int32_t numValues = 0;
+        int32_t encoding = kPlain;
+        int32_t defLevelsSize = 0;
+        int32_t repLevelsSize = 0;
+        bool compressed = true;
+        header.readStruct([&](int16_t id, uint8_t type) {
+            switch (id) {
+            case 1: pageType = header.i32(); break;
+            case 2: uncompressedSize = header.i32(); break;
+            case 3: compressedSize = header.i32(); break;
+            case 5:
+            case 7:
+                // The data page and dictionary page headers start alike.
+                header.readStruct([&](int16_t id, uint8_t type) {
+                    switch (id) {
+                    case 1: numValues = header.i32(); break;
+                    case 2: encoding = header.i32(); break;
+                    default: header.skip(type); break;
+                    }
+                });
+                break;
+            case 8:
+                header.readStruct([&](int16_t id, uint8_t type) {
+                    switch (id) {
+                    case 1: numValues = header.i32(); break;
+                    case 4: encoding = header.i32(); break;
+                    case 5: defLevelsSize = header.i32(); break;
+                    case 6: repLevelsSize = header.i32(); break;
+                    case 7: compressed = type == ThriftCompactReader::kTrue; break;
+                    default: header.skip(type); break;
+                    }
+                });
+                break;
+            default:
+                header.skip(type);
+                break;
+            }
+        });
+        pos += header.position();
+        if (compressedSize < 0 || uncompressedSize < 0 || numValues < 0 ||
+                static_cast<size_t>(compressedSize) > contents.size() - pos) {
+            corrupt(fmt::format("page of column {} runs past its chunk", _columns[column].name));
+        }
+        const auto body = contents.substr(pos, static_cast<size_t>(compressedSize));
+        pos += static_cast<size_t>(compressedSize);
+
+        if (pageType == kDictionaryPage) {
+            const auto page = decompress(body, chunk.codec, static_cast<size_t>(uncompressedSize), values.storage);
+            dictionary.emplace();
+            decodePlain(page, leaf.physicalType, leaf.typeLength, leaf.zeroExtend, static_cast<size_t>(numValues), *dictionary);
+            continue;
+        }
+        if (pageType != kDataPage && pageType != kDataPageV2) {
+            continue;
+        }
+
+        // Definition levels are 1 for a value and 0 for a null, with a bit width of 1.
+        const auto numRows = static_cast<size_t>(numValues);
+        const auto start = values.present.size();
+        std::string_view valueData;
+        if (pageType == kDataPage) {
+            const auto page = decompress(body, chunk.codec, static_cast<size_t>(uncompressedSize), values.storage);
+            size_t levelsEnd = 0;
+            if (leaf.optional) {
+                if (page.size() < 4 || readLe32(page.data()) > page.size() - 4) {
+                    corrupt("definition levels run past their page");
+                }
+                levelsEnd = 4 + readLe32(page.data());
+                decodeHybrid(page.substr(4, levelsEnd - 4), 1, numRows, values.present);
+            } else {
+                values.present.insert(values.present.end(), numRows, 1);
+            }
+            valueData = page.substr(levelsEnd);
+        } else {
+            if (repLevelsSize < 0 || defLevelsSize < 0 ||
+                    static_cast<size_t>(repLevelsSize) + static_cast<size_t>(defLevelsSize) > body.size() ||
+                    repLevelsSize + defLevelsSize > uncompressedSize) {
+                corrupt("levels run past their page");
+            }
+            if (leaf.optional) {
+                decodeHybrid(body.substr(static_cast<size_t>(repLevelsSize), static_cast<size_t>(defLevelsSize)),
+                             1, numRows, values.present);
+            } else {
+                values.present.insert(values.present.end(), numRows, 1);
+            }
+            // Only the values of a v2 page are compressed.
+            const auto levelsSize = static_cast<size_t>(repLevelsSize + defLevelsSize);
+            valueData = body.substr(levelsSize);
+            if (compressed) {
+                valueData = decompress(valueData, chunk.codec, static_cast<size_t>(uncompressedSize) - levelsSize, values.storage);
+            }
+        }
+        size_t numPresent = 0;
+        for (size_t row = start; row < values.present.size(); ++row) {
+            numPresent += values.present[row] != 0;
+        }
+        decoded = DecodedValues{};
+        decodeValues(valueData, encoding, leaf.physicalType, leaf.typeLength, leaf.zeroExtend, numPresent,
+                     dictionary, indices, decoded);
+        const auto* present = values.present.data() + start;
+        switch (leaf.physicalType) {
+        case kFloat:
+        case kDouble:
+            spread(values.doubles, start, decoded.doubles, present, numRows);
+            break;
+        case kByteArray:
+        case kFixedLenByteArray:
+            spread(values.bytes, start, decoded.bytes, present, numRows);
+            break;
+        default:
+            spread(values.ints, start, decoded.ints, present, numRows);
+            break;
+        }
+        valuesRead += numRows;
+    }
+}
+
+CsvLoadResult loadParquet(OracleConnection& conn,
+                          const std::string& path,
+                          std::string_view tableName,
+                          const CsvLoadOptions& opts) {
+    ParquetReader reader(path);
+    const auto& columns = reader.columns();
+    const auto numColumns = static_cast<uint32_t>(columns.size());
+    if (numColumns == 0) {
+        throw std::runtime_error(fmt::format("{} has no columns", path));
+    }
+    const auto table = opts.partition.empty()
+        ? normalizeIdentifier(tableName, true)
+        : fmt::format("{} PARTITION (\"{}\")", normalizeIdentifier(tableName, true), opts.partition);
+    fmt::memory_buffer sqlBuffer;
+    fmt::format_to(sqlBuffer, "insert {}into {} (", opts.directPath ? "/*+ APPEND_VALUES */ " : "", table);
+    for (uint32_t col = 0; col < numColumns; ++col) {
+        fmt::format_to(sqlBuffer, "{}{}", col == 0 ? "" : ", ", normalizeIdentifier(columns[col].name, false));
+    }
+    fmt::format_to(sqlBuffer, ") values (");
+    for (uint32_t col = 0; col < numColumns; ++col) {
+        fmt::format_to(sqlBuffer, "{}:{}", col == 0 ? "" : ", ", col + 1);
+    }
+    fmt::format_to(sqlBuffer, ")");
+    auto stmt = conn.prepareStatement(std::string_view(sqlBuffer.data(), sqlBuffer.size()));
+
+    std::vector<BindKind> kinds;
+    for (const auto& column : columns) {
+        kinds.push_back(bindKindFor(column, false));
+    }
+
+    const auto batchSize = std::max<uint32_t>(opts.batchSize, 1);
+    std::optional<BatchSizer> sizer;
+    if (opts.adaptiveBatchSize && !opts.directPath) {
+        BatchSizer::Options sizerOpts;
+        sizerOpts.initialRows = batchSize;
+        sizerOpts.maxRows = std::max(opts.maxBatchSize, batchSize);
+        sizerOpts.commitRows = opts.commitInterval;
+        sizer.emplace(sizerOpts);
+    }
+    struct Batch {
+        std::vector<std::optional<OracleVariable>> vars;
+        std::vector<uint32_t> valueSizes;
+        // Rows the variables were made for.
+        uint32_t capacity = 0;
+        uint32_t numRows = 0;
+        uint64_t firstRow = 0;
+        // Bytes of the batch's values, for the BatchSizer.
+        uint64_t bytes = 0;
+    };
+    struct BatchOutcome {
+        uint32_t numRows = 0;
+        uint64_t bytes = 0;
+        double seconds = 0;
+        uint64_t rowsLoaded = 0;
+        std::vector<CsvLoadError> errors;
+    };
+    std::array<Batch, 2> batches;
+    for (auto& batch : batches) {
+        batch.vars.resize(numColumns);
+        batch.valueSizes.resize(numColumns, 0);
+    }
+
+    CsvLoadResult result;
+    uint64_t rowsSinceCommit = 0;
+    // Runs on the executor; one insert at a time, so the statement isn't shared.
+    auto insertBatch = [&](Batch& batch) {
+        for (uint32_t col = 0; col < numColumns; ++col) {
+            stmt.bindByPos(col + 1, *batch.vars[col]);
+        }
+        const auto start = std::chrono::steady_clock::now();
+        stmt.executeMany(batch.numRows, static_cast<dpiExecMode>(
+            DPI_MODE_EXEC_BATCH_ERRORS | DPI_MODE_EXEC_ARRAY_DML_ROWCOUNTS));
+        BatchOutcome outcome;
+        outcome.numRows = batch.numRows;
+        outcome.bytes = batch.bytes;
+        outcome.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (auto count : stmt.rowCounts()) {
+            outcome.rowsLoaded += count;
+        }
+        for (auto& error : stmt.batchErrors()) {
+            outcome.errors.push_back(CsvLoadError{batch.firstRow + error.offset + 1, std::move(error.message)});
+        }
+        rowsSinceCommit += batch.numRows;
+        if (opts.directPath || (opts.commitInterval != 0 && rowsSinceCommit >= opts.commitInterval)) {
+            conn.commit();
+            rowsSinceCommit = 0;
+        }
+        return outcome;
+    };
+    auto collect = [&](std::future<BatchOutcome>& inFlight) {
+        auto outcome = inFlight.get();
+        if (sizer) {
+            sizer->record(outcome.numRows, outcome.bytes, outcome.seconds, outcome.errors.size());
+        }
+        result.rowsLoaded += outcome.rowsLoaded;
+        result.rowsRejected += outcome.errors.size();
+        for (auto& error : outcome.errors) {
+            if (result.errors.size() < opts.maxReportedErrors) {
+                result.errors.push_back(std::move(error));
+            }
+        }
+    };
+
+    std::vector<ParquetColumnValues> values(numColumns);
+    std::vector<std::string_view> texts;
+    StringArena formatted;
+    std::array<std::future<BatchOutcome>, 2> inFlight;
+    size_t current = 0;
+    // Declared after everything its tasks touch, so it's done with them before they go.
+    SessionExecutor executor;
+    try {
+        for (size_t rowGroup = 0; rowGroup < reader.numRowGroups(); ++rowGroup) {
+            const auto numRows = reader.rowGroupRows(rowGroup);
+            for (uint32_t col = 0; col < numColumns; ++col) {
+                reader.readColumn(rowGroup, col, values[col]);
+                if (values[col].present.size() != numRows) {
+                    throw std::runtime_error(fmt::format("column {} of {} has {} values in a row group of {} rows",
+                            columns[col].name, path, values[col].present.size(), numRows));
+                }
+            }
+            // Only a UINT_64 column with every value in range binds as a number.
+            for (uint32_t col = 0; col < numColumns; ++col) {
+                if (columns[col].kind != ParquetValueKind::UnsignedInteger) {
+                    continue;
+                }
+                const auto& ints = values[col].ints;
+                const bool narrow = std::all_of(ints.begin(), ints.end(), [](auto value) { return value >= 0; });
+                const auto kind = bindKindFor(columns[col], narrow);
+                if (kind == kinds[col]) {
+                    continue;
+                }
+                // The inserts in flight are still binding the variables that go.
+                for (auto& pending : inFlight) {
+                    if (pending.valid()) {
+                        collect(pending);
+                    }
+                }
+                kinds[col] = kind;
+                for (auto& batch : batches) {
+                    batch.vars[col].reset();
+                    batch.valueSizes[col] = 0;
+                }
+            }
+
+            for (uint64_t first = 0; first < numRows;) {
+                auto& batch = batches[current];
+                // The insert that last used this set has to be done with it first.
+                if (inFlight[current].valid()) {
+                    collect(inFlight[current]);
+                }
+                const auto batchRows = sizer ? sizer->rows() : batchSize;
+                if (batchRows > batch.capacity) {
+                    for (auto& var : batch.vars) {
+                        var.reset();
+                    }
+                    batch.capacity = batchRows;
+                }
+                batch.numRows = static_cast<uint32_t>(std::min<uint64_t>(batchRows, numRows - first));
+                batch.firstRow = result.rowsRead;
+                batch.bytes = 0;
+                for (uint32_t col = 0; col < numColumns; ++col) {
+                    const auto& column = columns[col];
+                    const auto& colValues = values[col];
+                    const auto kind = kinds[col];
+                    auto& var = batch.vars[col];
+
+                    if (kind == BindKind::Text || kind == BindKind::Raw) {
+                        texts.clear();
+                        formatted.reset();
+                        size_t longest = 0;
+                        for (uint32_t row = 0; row < batch.numRows; ++row) {
+                            const auto idx = first + row;
+                            std::string_view text;
+                            if (!colValues.present[idx]) {
+                                texts.push_back(text);
+                                continue;
+                            }
+                            if (column.kind == ParquetValueKind::Decimal) {
+                                const auto unscaled = colValues.bytes.empty()
+                                    ? static_cast<__int128>(colValues.ints[idx])
+                                    : unscaledFromBytes(colValues.bytes[idx], column.name);
+                                text = decimalText(unscaled, column.scale, formatted);
+                            } else if (column.kind == ParquetValueKind::UnsignedInteger) {
+                                text = decimalText(static_cast<uint64_t>(colValues.ints[idx]), 0, formatted);
+                            } else {
+                                text = colValues.bytes[idx];
+                            }
+                            texts.push_back(text);
+                            longest = std::max(longest, text.size());
+                            batch.bytes += text.size();
+                        }
+                        if (longest > kMaxValueSize) {
+                            throw std::runtime_error(fmt::format(
+                                "a value in column {} is longer than {} bytes", column.name, kMaxValueSize));
+                        }
+                        if (!var || longest > batch.valueSizes[col]) {
+                            auto size = std::max(batch.valueSizes[col], kMinValueSize);
+                            while (size < longest) {
+                                size = std::min(size * 2, kMaxValueSize);
+                            }
+                            var = makeArray(conn, kind, size, batch.capacity);
+                            batch.valueSizes[col] = size;
+                        }
+                        for (uint32_t row = 0; row < batch.numRows; ++row) {
+                            if (colValues.present[first + row]) {
+                                var->setFrom(row, texts[row]);
+                            } else {
+                                var->setNull(row);
+                            }
+                        }
+                        continue;
+                    }
+
+                    if (!var) {
+                        var = makeArray(conn, kind, 0, batch.capacity);
+                    }
+                    batch.bytes += static_cast<uint64_t>(batch.numRows) * sizeof(int64_t);
+                    for (uint32_t row = 0; row < batch.numRows; ++row) {
+                        const auto idx = first + row;
+                        if (!colValues.present[idx]) {
+                            var->setNull(row);
+                            continue;
+                        }
+                        switch (kind) {
+                        case BindKind::Int64:
+                            var->setFrom(row, colValues.ints[idx]);
+                            break;
+                        case BindKind::Double:
+                            var->setFrom(row, colValues.doubles[idx]);
+                            break;
+                        case BindKind::Date:
+                            var->setFrom(row, timestampFrom(colValues.ints[idx] * 86400, 1));
+                            break;
+                        default:
+                            var->setFrom(row, timestampFrom(colValues.ints[idx], column.unitsPerSecond));
+                            break;
+                        }
+                    }
+                }
+                result.rowsRead += batch.numRows;
+                inFlight[current] = executor.submit([&insertBatch, &batch] { return insertBatch(batch); });
+                first += batch.numRows;
+                current ^= 1;
+            }
+        }
+        for (auto& pending : inFlight) {
+            if (pending.valid()) {
+                collect(pending);
+            }
+        }
+    } catch (...) {
+        for (auto& pending : inFlight) {
+            if (pending.valid()) {
+                pending.wait();
+            }
+        }
+        throw;
+    }
+    conn.commit();
+    return result;
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "arena.h"
+#include "csv_load.h"
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+class OracleConnection;
+
+// What a Parquet column's values are, from its physical type and its logical or
+// converted type annotation.
+enum class ParquetValueKind {
+    Integer,         // BOOLEAN, INT32 and INT64 that aren't one of the below
+    UnsignedInteger, // UINT_64; narrower unsigned types are Integer
+    Decimal,         // DECIMAL over INT32, INT64, BYTE_ARRAY or FIXED_LEN_BYTE_ARRAY
+    Double,          // FLOAT and DOUBLE
+    String,          // BYTE_ARRAY annotated UTF8, ENUM or JSON
+    Binary,          // any other BYTE_ARRAY or FIXED_LEN_BYTE_ARRAY
+    Date,            // DATE, days since 1970-01-01
+    Timestamp,       // TIMESTAMP of any unit, and INT96
+};
+
+struct ParquetFileColumn {
+    std::string name;
+    ParquetValueKind kind;
+    // Digits after the point of a Decimal.
+    int32_t scale = 0;
+    // Ticks per second of a Timestamp's values; INT96 ones are read as nanoseconds.
+    int64_t unitsPerSecond = 1;
+    // Whether a Timestamp is UTC rather than a local time of no particular zone.
+    bool utc = false;
+};
+
+// The decoded values of one column of a row group, a slot per row in whichever of ints,
+// doubles and bytes the column's physical type goes into; nulls are 0 or empty there.
+// INT96 timestamps are converted to nanoseconds since the epoch, FLOAT to double and
+// BOOLEAN to 0 or 1. Views in bytes point into the file or into storage, so they last
+// until the file is closed or the values are read into again.
+struct ParquetColumnValues {
+    std::vector<uint8_t> present;
+    std::vector<int64_t> ints;
+    std::vector<double> doubles;
+    std::vector<std::string_view> bytes;
+    // Pages that had to be decompressed.
+    StringArena storage;
+
+    void clear();
+};
+
+// Reads flat Parquet files, like the ones writeParquetResults() writes, a column of a row
+// group at a time. Pages can be PLAIN or dictionary encoded, v1 or v2, and uncompressed,
+// Snappy or gzip compressed; nested and repeated columns aren't supported. The file is
+// memory mapped, so uncompressed byte arrays are never copied. Throws std::runtime_error
+// for a file that isn't Parquet, is corrupt or uses what the reader doesn't support.
+class ParquetReader {
+public:
+    explicit ParquetReader(const std::string& path);
+
+    const std::vector<ParquetFileColumn>& columns() const noexcept {
+        return _columns;
+    }
+    uint64_t numRows() const noexcept {
+        return _numRows;
+    }
+    size_t numRowGroups() const noexcept {
+        return _rowGroups.size();
+    }
+    uint64_t rowGroupRows(size_t rowGroup) const {
+        return _rowGroups.at(rowGroup).numRows;
+    }
+
+    // Decodes column of rowGroup into values, replacing what they held.
+    void readColumn(size_t rowGroup, size_t column, ParquetColumnValues& values) const;
+
+private:
+    struct Leaf {
+        int32_t physicalType;
+        int32_t typeLength;
+        bool optional;
+        // UINT_32 and narrower unsigned INT32s read zero extended.
+        bool zeroExtend;
+    };
+    struct ColumnChunk {
+        int32_t codec;
+        uint64_t numValues;
+        uint64_t offset;
+        uint64_t size;
+    };
+    struct RowGroup {
+        std::vector<ColumnChunk> columns;
+        uint64_t numRows;
+    };
+
+    std::string _path;
+    MappedFile _file;
+    std::vector<ParquetFileColumn> _columns;
+    std::vector<Leaf> _leaves;
+    std::vector<RowGroup> _rowGroups;
+    uint64_t _numRows = 0;
+};
+
+// Inserts the rows of a Parquet file into tableName, into the columns the file's columns
+// are named after. Values are bound in arrays of their own type rather than as text:
+// integers as NUMBER, FLOAT and DOUBLE as BINARY_DOUBLE, dates as DATE, timestamps as
+// TIMESTAMP, or TIMESTAMP WITH TIME ZONE in UTC for UTC ones, strings as VARCHAR2 and
+// binary as RAW. Decimals and UINT_64s go as their exact text. Each row group is decoded
+// a column at a time and inserted in batches of opts.batchSize rows, the inserts running
+// on a SessionExecutor while the next batch is filled.
+//
+// Loads run on conn alone; opts' commit interval, error limit, partition and direct path
+// apply as with loadCsv(), and the lines of rejected rows are their row numbers in the
+// file, counting from 1.
+CsvLoadResult loadParquet(OracleConnection& conn,
+                          const std::string& path,
+                          std::string_view tableName,
+                          const CsvLoadOptions& opts);
+
+} // namespace sqlplusplus
@@ -0,0 +1,586 @@
+#include "parquet_writer.h"
+
+#include "oracle_helpers.h"
+#include "result_metadata.h"
+#include "trace_recorder.h"
+#include "value_format.h"
+#include "work_stealing.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sqlplusplus {
+namespace {
+
+constexpr std::string_view kMagic = "PAR1";
+// A row group is cut early once its buffered values reach this size.
+constexpr size_t kMaxRowGroupBytes = 128 * 1024 * 1024;
+
+// Values from parquet.thrift.
+enum PhysicalType : int32_t {
+    kBoolean = 0,
+    kInt64 = 2,
+    kFloat = 4,
+    kDouble = 5,
+    kByteArray = 6,
+};
+enum ConvertedType : int32_t {
+    kUtf8 = 0,
+    kTimestampMicros = 10,
+    kUint64 = 14,
+};
+constexpr int32_t kRepetitionOptional = 1;
+constexpr int32_t kEncodingPlain = 0;
+constexpr int32_t kEncodingRle = 3;
+constexpr int32_t kCodecUncompressed = 0;
+constexpr int32_t kPageTypeData = 0;
+
+// Just enough of Thrift's compact protocol to write Parquet's page headers and footer.
+class ThriftCompactWriter {
+public:
+    enum Type : uint8_t {
+        kI32 = 5,
+        kI64 = 6,
+        kBinary = 8,
+        kList = 9,
+        kStruct = 12,
+    };
+
+    explicit ThriftCompactWriter(std::string& out) : _out(out) {}
+
+    void i32(int16_t id, int32_t value) {
+        _fieldHeader(id, kI32);
+        _varint(_zigzag(value));
+    }
+    void i64(int16_t id, int64_t value) {
+        _fieldHeader(id, kI64);
+        _varint(_zigzag(value));
+    }
+    void binary(int16_t id, std::string_view value) {
+        _fieldHeader(id, kBinary);
+        _binary(value);
+    }
+    void beginStruct(int16_t id) {
+        _fieldHeader(id, kStruct);
+        _lastFieldIds.push_back(0);
+    }
+    void endStruct() {
+        _out.push_back(0);
+        _lastFieldIds.pop_back();
+    }
+    void beginList(int16_t id, Type elementType, size_t size) {
+        _fieldHeader(id, kList);
+        if (size < 15) {
+            _out.push_back(static_cast<char>((size << 4) | elementType));
+        } else {
+            _out.push_back(static_cast<char>(0xf0 | elementType));
+            _varint(size);
+        }
+    }
+    // Elements of a list of structs are written between these.
+    void beginListStruct() {
+        _lastFieldIds.push_back(0);
+    }
+    void listI32(int32_t value) {
+        _varint(_zigzag(value));
+    }
+    void listBinary(std::string_view value) {
+        _binary(value);
+    }
+    // Ends the outermost struct.
+    void finish() {
+        _out.push_back(0);
+    }
+
+private:
+    static uint64_t _zigzag(int64_t value) {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    void _varint(uint64_t value) {
+        while (value >= 0x80) {
+            _out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        _out.push_back(static_cast<char>(value));
+    }
+
+    void _binary(std::string_view value) {
+        _varint(value.size());
+        _out.append(value.data(), value.size());
+    }
+
+    void _fieldHeader(int16_t id, Type type) {
+        auto delta = id - _lastFieldIds.back();
+        if (delta > 0 && delta <= 15) {
+            _out.push_back(static_cast<char>((delta << 4) | type));
+        } else {
+            _out.push_back(static_cast<char>(type));
+            _varint(_zigzag(id));
+        }
+        _lastFieldIds.back() = id;
+    }
+
+    std::string& _out;
+    std::vector<int16_t> _lastFieldIds{0};
+};
+
+int32_t physicalType(ParquetColumnType type) {
+    switch (type) {
+    case ParquetColumnType::Boolean:
+        return kBoolean;
+    case ParquetColumnType::Int64:
+    case ParquetColumnType::UInt64:
+    case ParquetColumnType::TimestampMicros:
+        return kInt64;
+    case ParquetColumnType::Float:
+        return kFloat;
+    case ParquetColumnType::Double:
+        return kDouble;
+    case ParquetColumnType::String:
+        return kByteArray;
+    }
+    return kByteArray;
+}
+
+// Definition levels as runs of the RLE/bit-packed hybrid encoding with a bit width of 1,
+// prefixed with their length as the v1 data page format wants.
+void encodeDefinitionLevels(const std::vector<uint8_t>& levels, std::string& out) {
+    const auto lengthPos = out.size();
+    out.append(4, '\0');
+    for (size_t pos = 0; pos < levels.size();) {
+        auto runEnd = pos + 1;
+        while (runEnd < levels.size() && levels[runEnd] == levels[pos]) {
+            ++runEnd;
+        }
+        uint64_t header = static_cast<uint64_t>(runEnd - pos) << 1;
+        while (header >= 0x80) {
+            out.push_back(static_cast<char>((header & 0x7f) | 0x80));
+            header >>= 7;
+        }
+        out.push_back(static_cast<char>(header));
+        out.push_back(static_cast<char>(levels[pos]));
+        pos = runEnd;
+    }
+    const auto length = static_cast<uint32_t>(out.size() - lengthPos - 4);
+    for (int i = 0; i < 4; ++i) {
+        out[lengthPos + i] = static_cast<char>((length >> (8 * i)) & 0xff);
+    }
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date.
+int64_t daysFromCivil(int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const auto yoe = static_cast<unsigned>(year - era * 400);
+    const unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+int64_t timestampMicros(const dpiTimestamp& ts) {
+    const auto days = daysFromCivil(ts.year, ts.month, ts.day);
+    const int64_t offsetMinutes = ts.tzHourOffset * 60 + ts.tzMinuteOffset;
+    const int64_t seconds = days * 86400 + ts.hour * 3600 + ts.minute * 60 + ts.second - offsetMinutes * 60;
+    return seconds * 1000000 + ts.fsecond / 1000;
+}
+
+ParquetColumnType columnTypeFor(dpiNativeTypeNum nativeType) {
+    switch (nativeType) {
+    case DPI_NATIVE_TYPE_BOOLEAN:
+        return ParquetColumnType::Boolean;
+    case DPI_NATIVE_TYPE_INT64:
+        return ParquetColumnType::Int64;
+    case DPI_NATIVE_TYPE_UINT64:
+        return ParquetColumnType::UInt64;
+    case DPI_NATIVE_TYPE_FLOAT:
+        return ParquetColumnType::Float;
+    case DPI_NATIVE_TYPE_DOUBLE:
+        return ParquetColumnType::Double;
+    case DPI_NATIVE_TYPE_TIMESTAMP:
+        return ParquetColumnType::TimestampMicros;
+    default:
+        return ParquetColumnType::String;
+    }
+}
+
+} // namespace
+
+void ParquetColumnBuffer::_appendRaw(const void* data, size_t size) {
+    const auto start = _values.size();
+    _values.resize(start + size);
+    std::memcpy(_values.data() + start, data, size);
+}
+
+void ParquetColumnBuffer::appendBool(bool value) {
+    _defLevels.push_back(1);
+    _values.push_back(value ? 1 : 0);
+}
+
+// PLAIN encoding is little-endian, which is what every platform ODPI runs on stores.
+void ParquetColumnBuffer::appendInt64(int64_t value) {
+    _defLevels.push_back(1);
+    _appendRaw(&value, sizeof(value));
+}
+
+void ParquetColumnBuffer::appendFloat(float value) {
+    _defLevels.push_back(1);
+    _appendRaw(&value, sizeof(value));
+}
+
+void ParquetColumnBuffer::appendDouble(double value) {
+    _defLevels.push_back(1);
+    _appendRaw(&value, sizeof(value));
+}
+
+void ParquetColumnBuffer::appendString(std::string_view value) {
+    _defLevels.push_back(1);
+    const auto length = static_cast<uint32_t>(value.size());
+    _appendRaw(&length, sizeof(length));
+    _appendRaw(value.data(), value.size());
+}
+
+void ParquetColumnBuffer::clear() noexcept {
+    _defLevels.clear();
+    _values.clear();
+}
+
+ParquetWriter::ParquetWriter(const std::string& path, std::vector<ParquetColumn> columns) :
+    _columns(std::move(columns))
+{
+    _fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (_fd == -1) {
+        throw std::system_error(errno, std::generic_category(), "error opening " + path);
+    }
+    _write(kMagic);
+}
+
+ParquetWriter::~ParquetWriter() {
+    if (_fd != -1) {
+        // Without a footer the file isn't readable anyway; close() reports errors.
+        ::close(_fd);
+    }
+}
+
+void ParquetWriter::_write(std::string_view data) {
+    while (!data.empty()) {
+        auto rc = ::write(_fd, data.data(), data.size());
+        if (rc == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "error writing parquet file");
+        }
+        data.remove_prefix(static_cast<size_t>(rc));
+        _offset += static_cast<uint64_t>(rc);
+    }
+}
+
+void ParquetWriter::writeRowGroup(const std::vector<ParquetColumnBuffer>& buffers) {
+    if (buffers.size() != _columns.size()) {
+        throw std::logic_error("parquet row group doesn't match the schema");
+    }
+    const auto numRows = buffers.empty() ? 0 : buffers.front().numValues();
+    if (numRows == 0) {
+        return;
+    }
+
+    RowGroupInfo rowGroup;
+    rowGroup.numRows = numRows;
+    rowGroup.byteSize = 0;
+    std::string page;
+    for (const auto& buffer : buffers) {
+        page.clear();
+        encodeDefinitionLevels(buffer._defLevels, page);
+        if (buffer._type == ParquetColumnType::Boolean) {
+            const auto& bits = buffer._values;
+            for (size_t pos = 0; pos < bits.size(); pos += 8) {
+                uint8_t packed = 0;
+                for (size_t bit = 0; bit < 8 && pos + bit < bits.size(); ++bit) {
+                    packed |= static_cast<uint8_t>((bits[pos + bit] & 1) << bit);
+                }
+                page.push_back(static_cast<char>(packed));
+            }
+        } else {
+            page.append(buffer._values.data(), buffer._values.size());
+        }
+
+        _scratch.clear();
+        ThriftCompactWriter header(_scratch);
+        header.i32(1, kPageTypeData);
+        header.i32(2, static_cast<int32_t>(page.size()));
+        header.i32(3, static_cast<int32_t>(page.size()));
+        header.beginStruct(5);
+        header.i32(1, static_cast<int32_t>(buffer.numValues()));
+        header.i32(2, kEncodingPlain);
+        header.i32(3, kEncodingRle);
+        header.i32(4, kEncodingRle);
+        header.endStruct();
+        header.finish();
+
+        ColumnChunkInfo chunk;
+        chunk.offset = _offset;
+        chunk.numValues = buffer.numValues();
+        _write(_scratch);
+        _write(page);
+        chunk.size = _offset - chunk.offset;
+        rowGroup.byteSize += chunk.size;
+        rowGroup.columns.push_back(chunk);
+    }
+
+    _numRows += numRows;
+    _rowGroups.push_back(std::move(rowGroup));
+}
+
+void ParquetWriter::close() {
+    if (_fd == -1) {
+        return;
+    }
+
+    std::string footer;
+    ThriftCompactWriter meta(footer);
+    meta.i32(1, 1);
+    meta.beginList(2, ThriftCompactWriter::kStruct, _columns.size() + 1);
+    meta.beginListStruct();
+    meta.binary(4, "schema");
+    meta.i32(5, static_cast<int32_t>(_columns.size()));
+    meta.endStruct();
+    for (const auto& column : _columns) {
+        meta.beginListStruct();
+        meta.i32(1, physicalType(column.type));
+        meta.i32(3, kRepetitionOptional);
+        meta.binary(4, column.name);
+        if (column.type == ParquetColumnType::String) {
+            meta.i32(6, kUtf8);
+        } else if (column.type == ParquetColumnType::TimestampMicros) {
+            meta.i32(6, kTimestampMicros);
+        } else if (column.type == ParquetColumnType::UInt64) {
+            meta.i32(6, kUint64);
+        }
+        meta.endStruct();
+    }
+    meta.i64(3, static_cast<int64_t>(_numRows));
+    meta.beginList(4, ThriftCompactWriter::kStruct, _rowGroups.size());
+    for (const auto& rowGroup : _rowGroups) {
+        meta.beginListStruct();
+        meta.beginList(1, ThriftCompactWriter::kStruct, rowGroup.columns.size());
+        for (size_t idx = 0; idx < rowGroup.columns.size(); ++idx) {
+            const auto& chunk = rowGroup.columns[idx];
+            const auto& column = _columns[idx];
+            meta.beginListStruct();
+            meta.i64(2, static_cast<int64_t>(chunk.offset));
+            meta.beginStruct(3);
+            meta.i32(1, physicalType(column.type));
+            meta.beginList(2, ThriftCompactWriter::kI32, 2);
+            meta.listI32(kEncodingPlain);
+            meta.listI32(kEncodingRle);
+            meta.beginList(3, ThriftCompactWriter::kBinary, 1);
+            meta.listBinary(column.name);
+            meta.i32(4, kCodecUncompressed);
+            meta.i64(5, static_cast<int64_t>(chunk.numValues));
+            meta.i64(6, static_cast<int64_t>(chunk.size));
+            meta.i64(7, static_cast<int64_t>(chunk.size));
+            meta.i64(9, static_cast<int64_t>(chunk.offset));
+            meta.endStruct();
+            meta.endStruct();
+        }
+        meta.i64(2, static_cast<int64_t>(rowGroup.byteSize));
+        meta.i64(3, static_cast<int64_t>(rowGroup.numRows));
+        meta.endStruct();
+    }
+    meta.binary(6, "sqlplusplus");
+    meta.finish();
+
+    const auto footerLength = static_cast<uint32_t>(footer.size());
+    for (int i = 0; i < 4; ++i) {
+        footer.push_back(static_cast<char>((footerLength >> (8 * i)) & 0xff));
+    }
+    footer.append(kMagic.data(), kMagic.size());
+    _write(footer);
+
+    auto fd = std::exchange(_fd, -1);
+    if (::close(fd) == -1) {
+        throw std::system_error(errno, std::generic_category(), "error closing parquet file");
+    }
+}
+
+uint64_t writeParquetResults(OracleResultSource& stmt, const std::string& path, uint32_t rowGroupRows) {
+    rowGroupRows = std::max<uint32_t>(rowGroupRows, 1);
+    const auto metadata = stmt.metadata();
+    const auto numColumns = metadata->numColumns();
+    std::vector<ParquetColumn> columns;
+    std::vector<dpiNativeTypeNum> nativeTypes;
+    std::vector<bool> binaryColumns;
+    for (const auto& info : metadata->columns()) {
+        // The formatter's type, which is text for NUMBERs fetched exactly.
+        auto nativeType = info.formatter.nativeType();
+        nativeTypes.push_back(nativeType);
+        binaryColumns.push_back(isBinaryType(info.typeInfo.oracleTypeNum));
+        columns.push_back(ParquetColumn{std::string(info.name), columnTypeFor(nativeType)});
+    }
+    auto formatters = metadata->formatters();
+
+    ParquetWriter writer(path, columns);
+    auto makeBuffers = [&] {
+        std::vector<ParquetColumnBuffer> buffers;
+        buffers.reserve(columns.size());
+        for (const auto& column : columns) {
+            buffers.emplace_back(column.type);
+        }
+        return buffers;
+    };
+
+    // The buffers of the row group being written come back from the worker emptied, to be
+    // filled again, so steady state is two sets of buffers and no reallocation.
+    auto buffers = makeBuffers();
+    auto spareBuffers = makeBuffers();
+    // Row groups are encoded and written on the shared executor while the next is filled.
+    auto& executor = WorkStealingExecutor::shared();
+    std::future<void> inFlight;
+    size_t rowGroupBytes = 0;
+    uint32_t rowGroupRowCount = 0;
+    auto writeRowGroup = [&] {
+        if (inFlight.valid()) {
+            executor.wait(inFlight);
+        }
+        std::swap(buffers, spareBuffers);
+        for (auto& buffer : buffers) {
+            buffer.clear();
+        }
+        inFlight = executor.submit([&writer, &spareBuffers] {
+            TraceSpan span("write row group");
+            writer.writeRowGroup(spareBuffers);
+        });
+        rowGroupBytes = 0;
+        rowGroupRowCount = 0;
+    };
+
+    fmt::memory_buffer text;
+    OracleLobReader lobReader(stmt.context());
+    uint64_t numRows = 0;
+    try {
+        for (;;) {
+            auto block = stmt.fetchBlock(stmt.fetchArraySize());
+            TraceSpan span("write");
+            span.setArg("rows", block.numRows());
+            for (uint32_t col = 1; col <= numColumns; ++col) {
+                if (block.numRows() == 0 || block.nativeType(col) == nativeTypes[col - 1]) {
+                    continue;
+                }
+                // LOB columns may switch to inline values after the first block; both
+                // end up as strings.
+                if (nativeTypes[col - 1] == DPI_NATIVE_TYPE_LOB && block.nativeType(col) == DPI_NATIVE_TYPE_BYTES) {
+                    nativeTypes[col - 1] = DPI_NATIVE_TYPE_BYTES;
+                } else {
+                    throw std::runtime_error(fmt::format(
+                        "column {} changed type during the export", columns[col - 1].name));
+                }
+            }
+
+            uint32_t row = 0;
+            while (row < block.numRows()) {
+                const auto chunkRows = std::min(block.numRows() - row, rowGroupRows - rowGroupRowCount);
+                for (uint32_t col = 1; col <= numColumns; ++col) {
+                    auto& buffer = buffers[col - 1];
+                    const auto columnData = block.columnData(col);
+                    const auto before = buffer.byteSize();
+                    for (uint32_t idx = row; idx < row + chunkRows; ++idx) {
+                        const auto& data = columnData[idx];
+                        if (data.isNull) {
+                            buffer.appendNull();
+                            continue;
+                        }
+                        switch (nativeTypes[col - 1]) {
+                        case DPI_NATIVE_TYPE_BOOLEAN:
+                            buffer.appendBool(data.value.asBoolean != 0);
+                            break;
+                        case DPI_NATIVE_TYPE_INT64:
+                            buffer.appendInt64(data.value.asInt64);
+                            break;
+                        case DPI_NATIVE_TYPE_UINT64:
+                            buffer.appendInt64(static_cast<int64_t>(data.value.asUint64));
+                            break;
+                        case DPI_NATIVE_TYPE_FLOAT:
+                            buffer.appendFloat(data.value.asFloat);
+                            break;
+                        case DPI_NATIVE_TYPE_DOUBLE:
+                            buffer.appendDouble(data.value.asDouble);
+                            break;
+                        case DPI_NATIVE_TYPE_TIMESTAMP:
+                            buffer.appendInt64(timestampMicros(data.value.asTimestamp));
+                            break;
+                        case DPI_NATIVE_TYPE_BYTES:
+                            if (binaryColumns[col - 1]) {
+                                text.resize(data.value.asBytes.length * 2);
+                                writeHex(std::string_view(data.value.asBytes.ptr, data.value.asBytes.length), text.data());
+                                buffer.appendString(std::string_view(text.data(), text.size()));
+                            } else {
+                                buffer.appendString(std::string_view(data.value.asBytes.ptr, data.value.asBytes.length));
+                            }
+                            break;
+                        case DPI_NATIVE_TYPE_LOB:
+                            // A value has to go into the column buffer whole, so unlike the
+                            // text exports the LOB is read into memory, though still in
+                            // chunk sized pieces.
+                            text.clear();
+                            lobReader.open(data.value.asLOB);
+                            for (auto piece = lobReader.next(); !piece.empty(); piece = lobReader.next()) {
+                                if (binaryColumns[col - 1]) {
+                                    const auto start = text.size();
+                                    text.resize(start + piece.size() * 2);
+                                    writeHex(piece, text.data() + start);
+                                } else {
+                                    text.append(piece.data(), piece.data() + piece.size());
+                                }
+                            }
+                            buffer.appendString(std::string_view(text.data(), text.size()));
+                            break;
+                        default:
+                            text.clear();
+                            formatters[col - 1].format(data, text);
+                            buffer.appendString(std::string_view(text.data(), text.size()));
+                            break;
+                        }
+                    }
+                    rowGroupBytes += buffer.byteSize() - before;
+                }
+                row += chunkRows;
+                rowGroupRowCount += chunkRows;
+                if (rowGroupRowCount >= rowGroupRows || rowGroupBytes >= kMaxRowGroupBytes) {
+                    writeRowGroup();
+                }
+            }
+
+            numRows += block.numRows();
+            if (!block.moreRows()) {
+                break;
+            }
+        }
+        if (rowGroupRowCount > 0) {
+            writeRowGroup();
+        }
+        if (inFlight.valid()) {
+            executor.wait(inFlight);
+        }
+    } catch(...) {
+        if (inFlight.valid()) {
+            executor.waitReady(inFlight);
+        }
+        throw;
+    }
+
+    writer.close();
+    return numRows;
+}
+
+} // namespace sqlplusplus
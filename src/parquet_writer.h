@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+class OracleResultSource;
+
+// Column types the writer knows how to encode, and the Parquet physical and converted types
+// they're stored as.
+enum class ParquetColumnType {
+    Boolean,         // BOOLEAN
+    Int64,           // INT64
+    UInt64,          // INT64, UINT_64
+    Float,           // FLOAT
+    Double,          // DOUBLE
+    String,          // BYTE_ARRAY, UTF8
+    TimestampMicros, // INT64, TIMESTAMP_MICROS (UTC)
+};
+
+struct ParquetColumn {
+    std::string name;
+    ParquetColumnType type;
+};
+
+// One row group's worth of values for a column, already PLAIN encoded, plus a definition
+// level per row. Every column is OPTIONAL so nulls cost one definition level each.
+class ParquetColumnBuffer {
+public:
+    explicit ParquetColumnBuffer(ParquetColumnType type) : _type(type) {}
+
+    ParquetColumnType type() const noexcept {
+        return _type;
+    }
+
+    void appendNull() {
+        _defLevels.push_back(0);
+    }
+    void appendBool(bool value);
+    void appendInt64(int64_t value);
+    void appendFloat(float value);
+    void appendDouble(double value);
+    void appendString(std::string_view value);
+
+    size_t numValues() const noexcept {
+        return _defLevels.size();
+    }
+    size_t byteSize() const noexcept {
+        return _values.size() + _defLevels.size();
+    }
+
+    // Empties the buffer, keeping its allocations for the next row group.
+    void clear() noexcept;
+
+private:
+    friend class ParquetWriter;
+
+    void _appendRaw(const void* data, size_t size);
+
+    ParquetColumnType _type;
+    std::vector<uint8_t> _defLevels;
+    // Booleans are kept a byte each here and bit-packed when the page is encoded.
+    std::vector<char> _values;
+};
+
+// Streams a Parquet file: writeRowGroup() encodes and writes one row group (a single
+// uncompressed data page per column) and only keeps its offsets for the footer, which
+// close() writes. Throws std::system_error on I/O errors.
+class ParquetWriter {
+public:
+    ParquetWriter(const std::string& path, std::vector<ParquetColumn> columns);
+    ParquetWriter(const ParquetWriter&) = delete;
+    ParquetWriter& operator=(const ParquetWriter&) = delete;
+    ~ParquetWriter();
+
+    const std::vector<ParquetColumn>& columns() const noexcept {
+        return _columns;
+    }
+
+    // buffers holds one buffer per column, all with the same number of values.
+    void writeRowGroup(const std::vector<ParquetColumnBuffer>& buffers);
+    void close();
+
+private:
+    struct ColumnChunkInfo {
+        uint64_t offset;
+        uint64_t size;
+        uint64_t numValues;
+    };
+    struct RowGroupInfo {
+        std::vector<ColumnChunkInfo> columns;
+        uint64_t numRows;
+        uint64_t byteSize;
+    };
+
+    void _write(std::string_view data);
+
+    int _fd = -1;
+    uint64_t _offset = 0;
+    uint64_t _numRows = 0;
+    std::vector<ParquetColumn> _columns;
+    std::vector<RowGroupInfo> _rowGroups;
+    std::string _scratch;
+};
+
+// Writes every remaining row of an executed query to a Parquet file, with column types
+// mapped from the columns' native types; anything without a direct Parquet type is
+// written as text. Rows are gathered into row groups of rowGroupRows rows, and each full
+// row group is encoded and written on the shared executor while the next one is fetched.
+// Returns the number of rows written.
+uint64_t writeParquetResults(OracleResultSource& stmt, const std::string& path, uint32_t rowGroupRows);
+
+} // namespace sqlplusplus
@@ -0,0 +1,89 @@
+#include "piped_command.h"
+
+#include "buffered_writer.h"
+
+#include <cerrno>
+#include <ctime>
+#include <system_error>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace sqlplusplus {
+namespace {
+
+sigset_t pipeSignals() noexcept {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGPIPE);
+    return signals;
+}
+
+} // namespace
+
+PipedCommand::PipedCommand(const std::string& command) {
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) == -1) {
+        throw std::system_error(errno, std::generic_category(), "error creating pipe");
+    }
+    // Only a hint: past /proc/sys/fs/pipe-max-size the pipe keeps the default size.
+    (void)fcntl(fds[1], F_SETPIPE_SZ, static_cast<int>(BufferedFdWriter::kBufferSize));
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[0], STDIN_FILENO);
+    // The REPL blocks SIGINT in every thread for its interrupt watcher; the command gets
+    // its signals back, so Ctrl-C reaches it too.
+    posix_spawnattr_t attrs;
+    posix_spawnattr_init(&attrs);
+    sigset_t noSignals;
+    sigemptyset(&noSignals);
+    posix_spawnattr_setsigmask(&attrs, &noSignals);
+    posix_spawnattr_setflags(&attrs, POSIX_SPAWN_SETSIGMASK);
+    const char* argv[] = {"sh", "-c", command.c_str(), nullptr};
+    const auto rc = posix_spawn(&_pid, "/bin/sh", &actions, &attrs, const_cast<char**>(argv), environ);
+    posix_spawnattr_destroy(&attrs);
+    posix_spawn_file_actions_destroy(&actions);
+    ::close(fds[0]);
+    if (rc != 0) {
+        ::close(fds[1]);
+        throw std::system_error(rc, std::generic_category(), "error starting /bin/sh");
+    }
+    _fd = fds[1];
+
+    const auto signals = pipeSignals();
+    pthread_sigmask(SIG_BLOCK, &signals, &_previousMask);
+}
+
+PipedCommand::~PipedCommand() {
+    wait();
+}
+
+int PipedCommand::wait() {
+    if (_pid == -1) {
+        return _status;
+    }
+    ::close(_fd);
+    _fd = -1;
+    int status = 0;
+    while (waitpid(_pid, &status, 0) == -1 && errno == EINTR) {
+    }
+    _pid = -1;
+    _status = WIFSIGNALED(status) ? 128 + WTERMSIG(status) : WEXITSTATUS(status);
+
+    // A SIGPIPE raised by a failed write is still pending, and would go off as soon as it
+    // was unblocked.
+    const auto signals = pipeSignals();
+    const timespec noWait{0, 0};
+    while (sigtimedwait(&signals, nullptr, &noWait) > 0) {
+    }
+    pthread_sigmask(SIG_SETMASK, &_previousMask, nullptr);
+    return _status;
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+
+#include <signal.h>
+#include <sys/types.h>
+
+namespace sqlplusplus {
+
+// A shell command started with a pipe to its stdin, for streaming results into. The pipe
+// is widened to a BufferedFdWriter's buffer where the kernel allows it, and writes block
+// while the command is behind, so the writer, and the fetches feeding it, go at the
+// command's pace rather than piling rows up in memory.
+//
+// SIGPIPE is blocked in the constructing thread until wait(), so a command that exits
+// without reading everything makes writes fail with EPIPE instead of killing the REPL.
+// Throws std::system_error when the pipe can't be made or the shell can't be started.
+class PipedCommand {
+public:
+    explicit PipedCommand(const std::string& command);
+    PipedCommand(const PipedCommand&) = delete;
+    PipedCommand& operator=(const PipedCommand&) = delete;
+    // Waits for the command if wait() hasn't.
+    ~PipedCommand();
+
+    // The write end of the command's stdin.
+    int fd() const noexcept {
+        return _fd;
+    }
+
+    // Closes the command's stdin and waits for it to exit. Returns its status the way the
+    // shell reports it: the exit code, or 128 plus the signal that killed it.
+    int wait();
+
+private:
+    int _fd = -1;
+    pid_t _pid = -1;
+    sigset_t _previousMask;
+    int _status = 0;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,254 @@
+#include "plsql_call.h"
+
+#include "mapped_file.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace sqlplusplus {
+namespace {
+
+bool isIntegerLiteral(std::string_view value) {
+    int64_t parsed = 0;
+    auto res = std::from_chars(value.data(), value.data() + value.size(), parsed);
+    return res.ec == std::errc() && res.ptr == value.data() + value.size();
+}
+
+// [+-]digits[.digits][e[+-]digits], what TO_NUMBER takes without a format.
+bool isNumberLiteral(std::string_view value) {
+    size_t pos = 0;
+    auto digits = [&] {
+        const auto start = pos;
+        while (pos < value.size() && std::isdigit(static_cast<unsigned char>(value[pos]))) {
+            ++pos;
+        }
+        return pos - start;
+    };
+    if (pos < value.size() && (value[pos] == '+' || value[pos] == '-')) {
+        ++pos;
+    }
+    auto mantissa = digits();
+    if (pos < value.size() && value[pos] == '.') {
+        ++pos;
+        mantissa += digits();
+    }
+    if (mantissa == 0) {
+        return false;
+    }
+    if (pos < value.size() && (value[pos] == 'e' || value[pos] == 'E')) {
+        ++pos;
+        if (pos < value.size() && (value[pos] == '+' || value[pos] == '-')) {
+            ++pos;
+        }
+        if (digits() == 0) {
+            return false;
+        }
+    }
+    return pos == value.size();
+}
+
+bool isNullWord(std::string_view word) {
+    return word.size() == 4 && std::equal(word.begin(), word.end(), "null", [](char left, char right) {
+        return std::tolower(static_cast<unsigned char>(left)) == right;
+    });
+}
+
+class ArgumentParser {
+public:
+    explicit ArgumentParser(std::string_view text) : _text(text) {}
+
+    bool atEnd() {
+        _skipSpaces();
+        return _pos == _text.size();
+    }
+
+    std::string_view word() {
+        _skipSpaces();
+        const auto start = _pos;
+        while (_pos < _text.size() && !std::isspace(static_cast<unsigned char>(_text[_pos]))) {
+            ++_pos;
+        }
+        return _text.substr(start, _pos - start);
+    }
+
+    ProcedureArgument argument() {
+        _skipSpaces();
+        ProcedureArgument arg;
+        if (_text[_pos] == '@') {
+            ++_pos;
+            const auto path = word();
+            if (path.empty()) {
+                throw std::runtime_error("@ needs a file name");
+            }
+            arg.isArray = true;
+            MappedFile file{std::string(path)};
+            auto contents = file.contents();
+            while (!contents.empty()) {
+                const auto end = std::min(contents.find('\n'), contents.size());
+                auto line = contents.substr(0, end);
+                contents.remove_prefix(std::min(end + 1, contents.size()));
+                if (!line.empty() && line.back() == '\r') {
+                    line.remove_suffix(1);
+                }
+                if (line.empty()) {
+                    arg.values.emplace_back();
+                } else {
+                    arg.values.emplace_back(std::string(line));
+                }
+            }
+        } else if (_text[_pos] == '[') {
+            ++_pos;
+            arg.isArray = true;
+            _skipSpaces();
+            if (_pos < _text.size() && _text[_pos] == ']') {
+                ++_pos;
+                return arg;
+            }
+            for (;;) {
+                arg.values.push_back(_value(",]"));
+                _skipSpaces();
+                if (_pos == _text.size()) {
+                    throw std::runtime_error("array is missing its closing ]");
+                }
+                if (_text[_pos++] == ']') {
+                    break;
+                }
+            }
+        } else {
+            arg.values.push_back(_value(""));
+        }
+        return arg;
+    }
+
+private:
+    void _skipSpaces() {
+        while (_pos < _text.size() && std::isspace(static_cast<unsigned char>(_text[_pos]))) {
+            ++_pos;
+        }
+    }
+
+    // A 'quoted' string, null or a number, ending at a space or one of terminators.
+    std::optional<std::string> _value(std::string_view terminators) {
+        _skipSpaces();
+        if (_pos < _text.size() && _text[_pos] == '\'') {
+            std::string value;
+            for (++_pos;; ++_pos) {
+                if (_pos == _text.size()) {
+                    throw std::runtime_error("string is missing its closing quote");
+                }
+                if (_text[_pos] == '\'') {
+                    if (_pos + 1 < _text.size() && _text[_pos + 1] == '\'') {
+                        ++_pos;
+                    } else {
+                        ++_pos;
+                        return value;
+                    }
+                }
+                value.push_back(_text[_pos]);
+            }
+        }
+        const auto start = _pos;
+        while (_pos < _text.size() && !std::isspace(static_cast<unsigned char>(_text[_pos])) &&
+               terminators.find(_text[_pos]) == std::string_view::npos) {
+            ++_pos;
+        }
+        const auto literal = _text.substr(start, _pos - start);
+        if (literal.empty()) {
+            throw std::runtime_error("expected a number, 'string' or null");
+        }
+        if (isNullWord(literal)) {
+            return std::nullopt;
+        }
+        if (!isNumberLiteral(literal)) {
+            throw std::runtime_error(fmt::format("\"{}\" isn't a number, 'string' or null", literal));
+        }
+        return std::string(literal);
+    }
+
+    std::string_view _text;
+    size_t _pos = 0;
+};
+
+} // namespace
+
+ProcedureCall ProcedureCall::parse(std::string_view text) {
+    ArgumentParser parser(text);
+    const auto procedure = parser.word();
+    const bool validName = !procedure.empty() && std::all_of(procedure.begin(), procedure.end(), [](unsigned char ch) {
+        return std::isalnum(ch) || ch == '_' || ch == '$' || ch == '#' || ch == '.' || ch == '"';
+    });
+    if (!validName) {
+        throw std::runtime_error("usage: .call <procedure> [number | 'string' | null | [v1, ...] | @file] ...");
+    }
+    std::vector<ProcedureArgument> arguments;
+    while (!parser.atEnd()) {
+        arguments.push_back(parser.argument());
+    }
+    return ProcedureCall(std::string(procedure), std::move(arguments));
+}
+
+ProcedureCall::ProcedureCall(std::string procedure, std::vector<ProcedureArgument> arguments)
+    : _procedure(std::move(procedure)),
+      _arguments(std::move(arguments))
+{}
+
+OracleStatement ProcedureCall::execute(OracleConnection& conn) const {
+    std::string sql = fmt::format("BEGIN {}(", _procedure);
+    for (size_t idx = 0; idx < _arguments.size(); ++idx) {
+        fmt::format_to(std::back_inserter(sql), "{}:{}", idx == 0 ? "" : ", ", idx + 1);
+    }
+    sql += "); END;";
+    auto stmt = conn.prepareStatement(sql);
+
+    // The variables only need to live until the block has run.
+    std::vector<OracleVariable> variables;
+    for (size_t idx = 0; idx < _arguments.size(); ++idx) {
+        const auto& arg = _arguments[idx];
+        bool integers = true;
+        bool numbers = true;
+        uint32_t maxSize = 1;
+        for (const auto& value : arg.values) {
+            if (value) {
+                integers = integers && isIntegerLiteral(*value);
+                numbers = numbers && isNumberLiteral(*value);
+                maxSize = std::max(maxSize, static_cast<uint32_t>(value->size()));
+            }
+        }
+
+        OracleConnection::VariableOpts opts;
+        opts.dbTypeNum = numbers ? DPI_ORACLE_TYPE_NUMBER : DPI_ORACLE_TYPE_VARCHAR;
+        opts.nativeTypeNum = integers ? DPI_NATIVE_TYPE_INT64 : DPI_NATIVE_TYPE_BYTES;
+        opts.maxArraySize = std::max<uint32_t>(static_cast<uint32_t>(arg.values.size()), 1);
+        opts.isArray = arg.isArray;
+        opts.opts = OracleConnection::VariableOpts::ByteBufferOpts{maxSize, true};
+        auto& var = variables.emplace_back(conn.newArrayVariable(opts));
+        for (uint32_t pos = 0; pos < arg.values.size(); ++pos) {
+            const auto& value = arg.values[pos];
+            if (!value) {
+                var.setNull(pos);
+            } else if (integers) {
+                int64_t parsed = 0;
+                std::from_chars(value->data(), value->data() + value->size(), parsed);
+                var.setFrom(pos, parsed);
+            } else {
+                var.setFrom(pos, std::string_view(*value));
+            }
+        }
+        if (arg.isArray) {
+            var.setNumElementsInArray(static_cast<uint32_t>(arg.values.size()));
+        } else if (arg.values.empty()) {
+            var.setNull(0);
+        }
+        stmt.bindByPos(static_cast<uint32_t>(idx + 1), var);
+    }
+    stmt.execute();
+    return stmt;
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+// One argument of a .call: a single value, or a whole array of them bound to a PL/SQL
+// index-by table parameter. Null values are nullopt.
+struct ProcedureArgument {
+    bool isArray = false;
+    std::vector<std::optional<std::string>> values;
+};
+
+// A stored procedure run once with typed binds, so an array of thousands of ids is one
+// round trip rather than a call each. Arguments whose values are all integers are bound as
+// int64 numbers, other numbers as NUMBER text the client converts, and anything else as
+// VARCHAR2.
+class ProcedureCall {
+public:
+    // Parses "<procedure> [argument ...]" where each argument is a number, a 'quoted'
+    // string, null, [v1, v2, ...] for an array, or @file for an array of the file's lines,
+    // an empty line being a null. Throws std::runtime_error on bad syntax and
+    // std::system_error when a file can't be read.
+    static ProcedureCall parse(std::string_view text);
+
+    ProcedureCall(std::string procedure, std::vector<ProcedureArgument> arguments);
+
+    const std::string& procedure() const noexcept {
+        return _procedure;
+    }
+    const std::vector<ProcedureArgument>& arguments() const noexcept {
+        return _arguments;
+    }
+
+    // BEGIN procedure(:1, ...); END; with every argument bound. The executed block is
+    // returned for its implicit results.
+    OracleStatement execute(OracleConnection& conn) const;
+
+private:
+    std::string _procedure;
+    std::vector<ProcedureArgument> _arguments;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,215 @@
+#include "progress_monitor.h"
+
+#include "client_counters.h"
+#include "terminal.h"
+#include "typed_bind.h"
+#include "typed_rows.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <tuple>
+
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace sqlplusplus {
+namespace {
+
+// The width of the terminal stderr is, or 0 when it isn't one.
+uint32_t stderrColumns() noexcept {
+    winsize size{};
+    if (::ioctl(STDERR_FILENO, TIOCGWINSZ, &size) != 0) {
+        return 0;
+    }
+    return size.ws_col;
+}
+
+// e.g. "1h02m", "3m20s", "45s".
+std::string shortDuration(int64_t seconds) {
+    if (seconds >= 3600) {
+        return fmt::format("{}h{:02}m", seconds / 3600, seconds % 3600 / 60);
+    }
+    if (seconds >= 60) {
+        return fmt::format("{}m{:02}s", seconds / 60, seconds % 60);
+    }
+    return fmt::format("{}s", seconds);
+}
+
+} // namespace
+
+ProgressMonitor::~ProgressMonitor() {
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _stopping = true;
+    }
+    _changed.notify_all();
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+void ProgressMonitor::begin(OracleConnection& watched, std::function<OracleConnection()> newConnection,
+                            std::chrono::milliseconds interval) {
+    std::optional<std::pair<int64_t, int64_t>> identity;
+    if (!_watched || !_watched->isSameSession(watched)) {
+        auto stmt = watched.prepareStatement(
+                "SELECT sid, serial# FROM v$session WHERE sid = SYS_CONTEXT('USERENV', 'SID')");
+        stmt.execute();
+        forEachRow<int64_t, int64_t>(stmt, [&](int64_t sid, int64_t serial) {
+            identity.emplace(sid, serial);
+        });
+        _watched = watched.share();
+    }
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (identity) {
+        std::tie(_sid, _serial) = *identity;
+        ++_watchedGeneration;
+    }
+    _newConnection = std::move(newConnection);
+    _active = true;
+    _interval = std::max(interval, std::chrono::milliseconds(1));
+    _statementStart = std::chrono::steady_clock::now();
+    _rowsAtStart = clientCounters.value(ClientCounter::RowsFetched);
+    _bytesAtStart = clientCounters.value(ClientCounter::BytesDecoded);
+    if (!_thread.joinable()) {
+        _thread = std::thread([this] { _run(); });
+    }
+}
+
+void ProgressMonitor::finish() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    _active = false;
+    _clearLine();
+}
+
+ProgressMonitor::Active::Active(ProgressMonitor* monitor) : _monitor(monitor) {
+    if (_monitor) {
+        std::lock_guard<std::mutex> lk(_monitor->_mutex);
+        if (!_monitor->_active) {
+            _monitor = nullptr;
+            return;
+        }
+        ++_monitor->_shown;
+        ++_monitor->_shownGeneration;
+    }
+    if (_monitor) {
+        _monitor->_changed.notify_all();
+    }
+}
+
+ProgressMonitor::Active::~Active() {
+    if (_monitor) {
+        std::lock_guard<std::mutex> lk(_monitor->_mutex);
+        --_monitor->_shown;
+        _monitor->_clearLine();
+    }
+}
+
+void ProgressMonitor::_clearLine() {
+    if (_lineShown) {
+        std::cerr << "\r\033[K" << std::flush;
+        _lineShown = false;
+    }
+}
+
+std::optional<ProgressMonitor::LongOperation> ProgressMonitor::_longOperation(
+        OracleConnection& conn, int64_t sid, int64_t serial, double secondsRunning) {
+    // The most recently updated operation that's still going and started after the
+    // statement did, give or take a second of clock.
+    auto stmt = conn.prepareStatement(R"(
+SELECT *
+  FROM (SELECT opname || NVL2(target, ' ' || target, ''),
+               CAST(sofar AS NUMBER(18)), CAST(totalwork AS NUMBER(18)),
+               CAST(time_remaining AS NUMBER(18))
+          FROM v$session_longops
+         WHERE sid = :1 AND serial# = :2
+           AND totalwork > 0 AND sofar < totalwork
+           AND start_time >= SYSDATE - (:3 + 1) / 86400
+         ORDER BY last_update_time DESC)
+ WHERE ROWNUM = 1)");
+    bind(stmt, sid, serial, secondsRunning);
+    stmt.execute();
+    std::optional<LongOperation> operation;
+    forEachRow<std::string, int64_t, int64_t, std::optional<int64_t>>(stmt,
+            [&](std::string description, int64_t sofar, int64_t totalWork, std::optional<int64_t> remaining) {
+        operation.emplace(LongOperation{std::move(description), sofar, totalWork, remaining});
+    });
+    return operation;
+}
+
+void ProgressMonitor::_run() {
+    std::optional<OracleConnection> conn;
+    uint64_t connGeneration = 0;
+    std::unique_lock<std::mutex> lk(_mutex);
+    for (;;) {
+        _changed.wait(lk, [this] { return _stopping || (_active && _shown > 0); });
+        if (_stopping) {
+            return;
+        }
+        const auto generation = _shownGeneration;
+        if (_changed.wait_for(lk, _interval, [&] {
+                return _stopping || _shown == 0 || _shownGeneration != generation; })) {
+            continue;
+        }
+        const std::chrono::duration<double> running = std::chrono::steady_clock::now() - _statementStart;
+        const auto rows = clientCounters.value(ClientCounter::RowsFetched) - _rowsAtStart;
+        const auto bytes = clientCounters.value(ClientCounter::BytesDecoded) - _bytesAtStart;
+        const auto sid = _sid;
+        const auto serial = _serial;
+        const auto newConnection = _newConnection;
+        if (connGeneration != _watchedGeneration) {
+            connGeneration = _watchedGeneration;
+            conn.reset();
+            _longOpsUnavailable = false;
+        }
+        const bool pollLongOps = !_longOpsUnavailable;
+        lk.unlock();
+
+        std::optional<LongOperation> operation;
+        if (pollLongOps) {
+            try {
+                if (!conn) {
+                    conn.emplace(newConnection());
+                }
+                operation = _longOperation(*conn, sid, serial, running.count());
+            } catch (const std::exception&) {
+                // No access to V$SESSION_LONGOPS, or no second session to be had: the line
+                // goes on with what the client knows.
+                conn.reset();
+                _longOpsUnavailable = true;
+            }
+        }
+        fmt::memory_buffer line;
+        fmt::format_to(line, "[{}]", shortDuration(static_cast<int64_t>(running.count())));
+        if (rows > 0) {
+            const auto seconds = std::max(running.count(), 1e-3);
+            fmt::format_to(line, " {} rows, {:.0f} rows/s, {:.1f} MB/s", rows, rows / seconds,
+                    bytes / seconds / 1e6);
+        }
+        if (operation) {
+            fmt::format_to(line, "; {} {:.0f}%", operation->description,
+                    100.0 * operation->sofar / operation->totalWork);
+            if (operation->secondsRemaining) {
+                fmt::format_to(line, ", ETA {}", shortDuration(*operation->secondsRemaining));
+            }
+        }
+
+        lk.lock();
+        if (!_active || _shown == 0 || _shownGeneration != generation) {
+            continue;
+        }
+        std::string text = "\r\033[K";
+        const auto columns = stderrColumns();
+        // Kept to one row, or the carriage return would only take it back to the last.
+        appendCell(text, std::string_view(line.data(), line.size()),
+                   columns > 1 ? columns - 1 : static_cast<uint32_t>(line.size()));
+        std::cerr << text << std::flush;
+        _lineShown = true;
+    }
+}
+
+} // namespace sqlplusplus
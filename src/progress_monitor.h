@@ -0,0 +1,96 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace sqlplusplus {
+
+// Draws a progress line on stderr for a statement that runs long: the rows fetched so far
+// with their rate in rows and bytes a second, from clientCounters, and the long operation
+// the server reports the session is part way through in V$SESSION_LONGOPS, such as a full
+// scan or a sort, with how far along it is and how long the server expects it to take.
+// A thread of its own redraws it every interval, polling V$SESSION_LONGOPS from a second
+// connection, so the fetch loop itself never does more than it did; nothing is drawn or
+// polled until a statement has run for a whole interval.
+//
+// The line is only drawn while an Active is alive, around the calls it can show progress
+// for without landing in the middle of a result, and is cleared before the call returns.
+class ProgressMonitor {
+public:
+    ProgressMonitor() = default;
+    ProgressMonitor(const ProgressMonitor&) = delete;
+    ProgressMonitor& operator=(const ProgressMonitor&) = delete;
+    ~ProgressMonitor();
+
+    // Starts timing a statement about to run on watched, redrawing every interval and
+    // polling from a connection newConnection makes to the same database. The first
+    // statement on a session looks up its SID, a round trip, and has the polling connection
+    // made again, since the REPL may have moved to another target.
+    void begin(OracleConnection& watched, std::function<OracleConnection()> newConnection,
+               std::chrono::milliseconds interval);
+    void finish();
+
+    // Lets the line be drawn for its lifetime. A null monitor, or one that isn't timing a
+    // statement, makes it a no-op.
+    class Active {
+    public:
+        explicit Active(ProgressMonitor* monitor);
+        Active(const Active&) = delete;
+        Active& operator=(const Active&) = delete;
+        ~Active();
+
+    private:
+        ProgressMonitor* _monitor;
+    };
+
+private:
+    struct LongOperation {
+        std::string description;
+        int64_t sofar = 0;
+        int64_t totalWork = 0;
+        std::optional<int64_t> secondsRemaining;
+    };
+
+    void _run();
+    std::optional<LongOperation> _longOperation(OracleConnection& conn, int64_t sid, int64_t serial,
+                                                double secondsRunning);
+    void _clearLine();
+
+    // The watched session, kept to tell when the REPL's session has been replaced.
+    std::optional<OracleConnection> _watched;
+
+    // Guarded by _mutex, like everything after it.
+    std::mutex _mutex;
+    std::condition_variable _changed;
+    std::function<OracleConnection()> _newConnection;
+    // Bumped whenever the watched session changes, so the polling thread drops the
+    // connection it made for the last one.
+    uint64_t _watchedGeneration = 0;
+    int64_t _sid = 0;
+    int64_t _serial = 0;
+    bool _active = false;
+    // Active scopes alive; the REPL only has the one thread, so it's 0 or 1.
+    uint32_t _shown = 0;
+    // Bumped by every Active, so a poll that finishes after its call has returned is
+    // dropped rather than drawn.
+    uint64_t _shownGeneration = 0;
+    bool _stopping = false;
+    bool _lineShown = false;
+    std::chrono::milliseconds _interval{0};
+    std::chrono::steady_clock::time_point _statementStart;
+    uint64_t _rowsAtStart = 0;
+    uint64_t _bytesAtStart = 0;
+    // Only used by the polling thread, and reset with its connection: a session that can't
+    // read V$SESSION_LONGOPS just gets the client side.
+    bool _longOpsUnavailable = false;
+    std::thread _thread;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,343 @@
+#include "result_cache.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <utility>
+
+namespace sqlplusplus {
+namespace {
+
+// Words that make a query's result depend on when, where or by whom it's run, or that
+// change state as it runs.
+constexpr std::array<std::string_view, 11> kVolatileWords = {
+    "current_date",
+    "current_timestamp",
+    "currval",
+    "dbms_random",
+    "localtimestamp",
+    "nextval",
+    "sys_context",
+    "sys_guid",
+    "sysdate",
+    "systimestamp",
+    "userenv",
+};
+
+bool isWordChar(char ch) {
+    return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_' || ch == '$' || ch == '#';
+}
+
+// The closing delimiter of a q'<open>...<close>' literal.
+char qQuoteClose(char open) {
+    switch (open) {
+    case '[':
+        return ']';
+    case '{':
+        return '}';
+    case '(':
+        return ')';
+    case '<':
+        return '>';
+    default:
+        return open;
+    }
+}
+
+} // namespace
+
+void CachedResult::addRow(const std::string_view* cells) {
+    for (size_t col = 0; col < _columnNames.size(); ++col) {
+        _values.append(cells[col]);
+        _ends.push_back(_values.size());
+    }
+}
+
+ResultCache::~ResultCache() {
+    stop();
+}
+
+void ResultCache::start(ConnectionFactory newConnection) {
+    stop();
+    _newConnection = std::move(newConnection);
+    try {
+        _subscribe();
+    } catch (...) {
+        _newConnection = nullptr;
+        throw;
+    }
+}
+
+void ResultCache::stop() {
+    // Unsubscribing waits out a callback in progress, so it happens without the lock.
+    _subscription.reset();
+    _conn.reset();
+    _newConnection = nullptr;
+    std::lock_guard<std::mutex> lk(_mutex);
+    _clearLocked();
+    _pending.clear();
+    _changedWhilePending.clear();
+    _unregistrable.clear();
+    _subscriptionLost = false;
+}
+
+void ResultCache::_subscribe() {
+    _subscription.reset();
+    _conn.reset();
+    _conn.emplace(_newConnection());
+    _subscription.emplace(_conn->subscribeQueryChanges(
+            [this](const dpiSubscrMessage& message) { _onChange(message); }));
+    std::lock_guard<std::mutex> lk(_mutex);
+    _subscriptionLost = false;
+}
+
+void ResultCache::setBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    _budget = bytes;
+    while (_bytes > _budget && !_lru.empty()) {
+        _eraseLocked(_entries.find(_lru.back()));
+    }
+}
+
+std::string ResultCache::cacheKey(std::string_view sql) {
+    std::string key;
+    key.reserve(sql.size());
+    std::string word;
+    bool volatileWord = false;
+    bool remote = false;
+    bool bound = false;
+    auto endWord = [&] {
+        if (!word.empty()) {
+            volatileWord = volatileWord ||
+                std::find(kVolatileWords.begin(), kVolatileWords.end(), word) != kVolatileWords.end();
+            word.clear();
+        }
+    };
+    auto space = [&] {
+        endWord();
+        if (!key.empty() && key.back() != ' ') {
+            key += ' ';
+        }
+    };
+    // Copies a literal or quoted identifier from pos through its closing quote.
+    auto copyQuoted = [&](size_t pos, char close) {
+        const auto end = sql.find(close, pos);
+        const auto stop = end == std::string_view::npos ? sql.size() : end + 1;
+        key.append(sql, pos, stop - pos);
+        return stop;
+    };
+
+    size_t pos = 0;
+    while (pos < sql.size()) {
+        const auto ch = sql[pos];
+        if (ch == '-' && pos + 1 < sql.size() && sql[pos + 1] == '-') {
+            pos = std::min(sql.find('\n', pos), sql.size());
+            space();
+        } else if (ch == '/' && pos + 1 < sql.size() && sql[pos + 1] == '*') {
+            auto end = sql.find("*/", pos + 2);
+            end = end == std::string_view::npos ? sql.size() : end + 2;
+            // Hints change the plan, not the rows, but keep them so a hinted and an
+            // unhinted query stay apart.
+            if (pos + 2 < sql.size() && sql[pos + 2] == '+') {
+                endWord();
+                key.append(sql, pos, end - pos);
+            }
+            pos = end;
+            space();
+        } else if (std::isspace(static_cast<unsigned char>(ch))) {
+            space();
+            ++pos;
+        } else if (word.empty() && (ch == 'n' || ch == 'N' || ch == 'q' || ch == 'Q') &&
+                   sql.find('\'', pos) <= pos + 2 &&
+                   std::all_of(sql.begin() + pos, sql.begin() + sql.find('\'', pos),
+                               [](char prefix) { return std::strchr("nNqQ", prefix) != nullptr; })) {
+            // N'...', q'<...>' and Nq'<...>' literals.
+            const auto quote = sql.find('\'', pos);
+            for (; pos < quote; ++pos) {
+                key += static_cast<char>(std::tolower(static_cast<unsigned char>(sql[pos])));
+            }
+            key += '\'';
+            if ((key[key.size() - 2] == 'q') && quote + 1 < sql.size()) {
+                const auto open = sql[quote + 1];
+                const char closing[] = {qQuoteClose(open), '\'', '\0'};
+                auto end = sql.find(closing, quote + 2);
+                end = end == std::string_view::npos ? sql.size() : end + 2;
+                key.append(sql, quote + 1, end - quote - 1);
+                pos = end;
+            } else {
+                pos = copyQuoted(quote + 1, '\'');
+            }
+        } else if (ch == '\'' || ch == '"') {
+            endWord();
+            key += ch;
+            pos = copyQuoted(pos + 1, ch);
+        } else {
+            const auto lower = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+            if (isWordChar(ch)) {
+                word += lower;
+            } else {
+                endWord();
+                remote = remote || ch == '@';
+                bound = bound || ch == ':';
+            }
+            key += lower;
+            ++pos;
+        }
+    }
+    endWord();
+    while (!key.empty() && (key.back() == ' ' || key.back() == ';')) {
+        key.pop_back();
+    }
+
+    auto startsWith = [&](std::string_view prefix) {
+        return key.compare(0, prefix.size(), prefix) == 0 &&
+            (key.size() == prefix.size() || !isWordChar(key[prefix.size()]));
+    };
+    const bool isQuery = startsWith("select") || startsWith("with");
+    // Database links can't be registered for notification, FOR UPDATE takes locks a
+    // cached result wouldn't, and the same text with bind variables reads different rows
+    // as their values change.
+    if (!isQuery || volatileWord || remote || bound || key.find(" for update") != std::string::npos) {
+        return {};
+    }
+    return key;
+}
+
+std::shared_ptr<const CachedResult> ResultCache::find(const std::string& key) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (_subscriptionLost) {
+        return nullptr;
+    }
+    auto it = _entries.find(key);
+    if (it == _entries.end()) {
+        return nullptr;
+    }
+    _lru.splice(_lru.begin(), _lru, it->second.lruPos);
+    return it->second.result;
+}
+
+uint64_t ResultCache::registerQuery(const std::string& key, std::string_view sql) {
+    bool lost = false;
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        if (!_newConnection || _unregistrable.count(key) != 0) {
+            return 0;
+        }
+        lost = _subscriptionLost;
+    }
+    try {
+        if (lost) {
+            _subscribe();
+        }
+    } catch (const std::exception&) {
+        // Try again with the next query; until then nothing is cached.
+        return 0;
+    }
+
+    uint64_t queryId = 0;
+    try {
+        queryId = _subscription->registerQuery(sql);
+    } catch (const OracleException&) {
+        // Usually something query change notification doesn't support, like a view
+        // with an analytic function, so there's no point trying it again.
+    }
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (queryId == 0) {
+        _unregistrable.insert(key);
+    } else {
+        _pending.insert(queryId);
+    }
+    return queryId;
+}
+
+void ResultCache::insert(const std::string& key, uint64_t queryId, CachedResult result) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    const bool changed = _changedWhilePending.erase(queryId) != 0;
+    if (_pending.erase(queryId) == 0 || changed || result.bytes() > _budget) {
+        return;
+    }
+    auto existing = _entries.find(key);
+    if (existing != _entries.end()) {
+        _eraseLocked(existing);
+    }
+    _lru.push_front(key);
+    Entry entry;
+    entry.queryId = queryId;
+    entry.lruPos = _lru.begin();
+    _bytes += result.bytes();
+    entry.result = std::make_shared<const CachedResult>(std::move(result));
+    _entries.emplace(key, std::move(entry));
+    _keysById[queryId] = key;
+    while (_bytes > _budget && _lru.size() > 1) {
+        _eraseLocked(_entries.find(_lru.back()));
+    }
+}
+
+void ResultCache::abandon(uint64_t queryId) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    _pending.erase(queryId);
+    _changedWhilePending.erase(queryId);
+}
+
+void ResultCache::clear() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    _clearLocked();
+}
+
+size_t ResultCache::numEntries() const {
+    std::lock_guard<std::mutex> lk(_mutex);
+    return _entries.size();
+}
+
+size_t ResultCache::bytes() const {
+    std::lock_guard<std::mutex> lk(_mutex);
+    return _bytes;
+}
+
+void ResultCache::_eraseLocked(std::map<std::string, Entry, std::less<>>::iterator it) {
+    _bytes -= it->second.result->bytes();
+    _keysById.erase(it->second.queryId);
+    _lru.erase(it->second.lruPos);
+    _entries.erase(it);
+}
+
+void ResultCache::_clearLocked() {
+    _entries.clear();
+    _keysById.clear();
+    _lru.clear();
+    _bytes = 0;
+}
+
+void ResultCache::_onChange(const dpiSubscrMessage& message) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (message.eventType == DPI_EVENT_DEREG) {
+        // Nothing is being watched any more. The subscription can't be replaced from its
+        // own callback, so that waits for the next registration.
+        _subscriptionLost = true;
+        _clearLocked();
+        for (auto queryId : _pending) {
+            _changedWhilePending.insert(queryId);
+        }
+        return;
+    }
+    if (message.eventType != DPI_EVENT_QUERYCHANGE) {
+        return;
+    }
+    for (uint32_t idx = 0; idx < message.numQueries; ++idx) {
+        const auto queryId = message.queries[idx].id;
+        if (_pending.count(queryId) != 0) {
+            _changedWhilePending.insert(queryId);
+        }
+        auto keyIt = _keysById.find(queryId);
+        if (keyIt == _keysById.end()) {
+            continue;
+        }
+        auto it = _entries.find(keyIt->second);
+        if (it != _entries.end()) {
+            _eraseLocked(it);
+        }
+    }
+}
+
+} // namespace sqlplusplus
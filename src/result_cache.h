@@ -0,0 +1,137 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+// The rows of a query result as the table shows them.
+class CachedResult {
+public:
+    explicit CachedResult(std::vector<std::string> columnNames) :
+        _columnNames(std::move(columnNames))
+    {}
+
+    const std::vector<std::string>& columnNames() const noexcept {
+        return _columnNames;
+    }
+    uint32_t numRows() const noexcept {
+        return _columnNames.empty() ? 0 : static_cast<uint32_t>(_ends.size() / _columnNames.size());
+    }
+    std::string_view cell(uint32_t row, uint32_t col) const noexcept {
+        const auto idx = static_cast<size_t>(row) * _columnNames.size() + col;
+        const auto begin = idx == 0 ? 0 : _ends[idx - 1];
+        return std::string_view(_values).substr(begin, _ends[idx] - begin);
+    }
+    // Takes columnNames().size() cells.
+    void addRow(const std::string_view* cells);
+
+    size_t bytes() const noexcept {
+        return _values.size() + _ends.size() * sizeof(size_t);
+    }
+
+private:
+    std::vector<std::string> _columnNames;
+    std::string _values;
+    std::vector<size_t> _ends;
+};
+
+// Client-side cache of query results, kept fresh by query change notification: every
+// cached query is registered with a subscription on a connection of its own, and the
+// server's notification that a commit changed its result drops the entry. Entries are
+// keyed by their normalized SQL text and evicted least recently used first once the cache
+// is past its byte budget.
+//
+// Only queries that read the same rows whenever they're run are cached; see cacheKey().
+// Notifications only come for committed changes, so the REPL has to clear() the cache
+// itself when its own session runs anything that might change data.
+class ResultCache {
+public:
+    using ConnectionFactory = std::function<OracleConnection()>;
+
+    ResultCache() = default;
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+    ~ResultCache();
+
+    // Connects and subscribes through newConnection, which has to make connections with
+    // events enabled. Throws OracleException when the subscription can't be made, usually
+    // for want of the CHANGE NOTIFICATION privilege.
+    void start(ConnectionFactory newConnection);
+    // Drops every entry along with the subscription and its connection.
+    void stop();
+    bool isStarted() const noexcept {
+        return static_cast<bool>(_newConnection);
+    }
+
+    void setBudget(size_t bytes);
+
+    // The key sql is cached under: its text with comments dropped, whitespace collapsed
+    // and everything outside quotes lower-cased. Empty when sql isn't worth caching: it
+    // isn't a SELECT or WITH, it locks rows, it has bind variables, or it calls something whose result depends
+    // on when or where it runs, like SYSDATE or SYS_CONTEXT.
+    static std::string cacheKey(std::string_view sql);
+
+    // nullptr when key isn't cached.
+    std::shared_ptr<const CachedResult> find(const std::string& key);
+
+    // Registers sql for notification ahead of running it, so a commit that lands between
+    // running it and insert() still gets the result thrown away. Returns the query's id,
+    // or 0 when the server won't register it, in which case it's never tried again.
+    uint64_t registerQuery(const std::string& key, std::string_view sql);
+    // Caches result under key, unless queryId's result has changed since it was registered.
+    void insert(const std::string& key, uint64_t queryId, CachedResult result);
+    // Forgets a registered query that won't be inserted, e.g. since its result was too big.
+    void abandon(uint64_t queryId);
+
+    // Drops every entry, keeping the subscription.
+    void clear();
+
+    size_t numEntries() const;
+    size_t bytes() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const CachedResult> result;
+        uint64_t queryId = 0;
+        std::list<std::string>::iterator lruPos;
+    };
+
+    void _subscribe();
+    void _onChange(const dpiSubscrMessage& message);
+    void _eraseLocked(std::map<std::string, Entry, std::less<>>::iterator it);
+    void _clearLocked();
+
+    ConnectionFactory _newConnection;
+    std::optional<OracleConnection> _conn;
+    std::optional<OracleSubscription> _subscription;
+
+    // Everything below is shared with the notification thread.
+    mutable std::mutex _mutex;
+    std::map<std::string, Entry, std::less<>> _entries;
+    std::map<uint64_t, std::string> _keysById;
+    // Most recently used first.
+    std::list<std::string> _lru;
+    // Registered queries that haven't been inserted or abandoned yet, and the ones of
+    // those that were notified in the meantime.
+    std::set<uint64_t> _pending;
+    std::set<uint64_t> _changedWhilePending;
+    std::set<std::string, std::less<>> _unregistrable;
+    size_t _bytes = 0;
+    size_t _budget = 16 * 1024 * 1024;
+    bool _subscriptionLost = false;
+};
+
+} // namespace sqlplusplus
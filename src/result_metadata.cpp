@@ -0,0 +1,52 @@
+#include "result_metadata.h"
+
+#include "display_width.h"
+#include "oracle_helpers.h"
+
+namespace sqlplusplus {
+
+ResultMetadata::ResultMetadata(const OracleResultSource& source, bool exactNumbers) {
+    const auto numColumns = source.numColumns();
+    std::vector<size_t> nameEnds;
+    _columns.reserve(numColumns);
+    nameEnds.reserve(numColumns);
+    for (uint32_t pos = 1; pos <= numColumns; ++pos) {
+        const auto info = source.getColumnInfo(pos);
+        _names.append(info.name());
+        nameEnds.push_back(_names.size());
+        Column column;
+        column.nullable = info.nullOK();
+        column.typeInfo = info.typeInfo();
+        const auto nativeType = exactNumbers && fetchesNumberAsText(column.typeInfo)
+            ? DPI_NATIVE_TYPE_BYTES
+            : column.typeInfo.defaultNativeTypeNum;
+        column.formatter = ColumnFormatter(nativeType, column.typeInfo.oracleTypeNum, column.typeInfo.objectType);
+        _columns.push_back(std::move(column));
+    }
+    // The buffer is only pointed into once it's done growing.
+    for (size_t idx = 0; idx < _columns.size(); ++idx) {
+        const auto begin = idx == 0 ? 0 : nameEnds[idx - 1];
+        _columns[idx].name = std::string_view(_names).substr(begin, nameEnds[idx] - begin);
+        _columns[idx].nameWidth = static_cast<uint32_t>(displayWidth(_columns[idx].name));
+    }
+}
+
+std::vector<std::string> ResultMetadata::names() const {
+    std::vector<std::string> names;
+    names.reserve(_columns.size());
+    for (const auto& column : _columns) {
+        names.emplace_back(column.name);
+    }
+    return names;
+}
+
+std::vector<ColumnFormatter> ResultMetadata::formatters() const {
+    std::vector<ColumnFormatter> formatters;
+    formatters.reserve(_columns.size());
+    for (const auto& column : _columns) {
+        formatters.push_back(column.formatter);
+    }
+    return formatters;
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "dpi.h"
+#include "value_format.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+class OracleResultSource;
+
+// Whether a column is a NUMBER that OracleStatement::setExactNumbers() fetches as its
+// decimal text. ODPI fetches NUMBERs with no scale and up to 18 digits as int64, which
+// are exact already, and the rest as doubles.
+inline bool fetchesNumberAsText(const dpiDataTypeInfo& type) noexcept {
+    return type.oracleTypeNum == DPI_ORACLE_TYPE_NUMBER && type.defaultNativeTypeNum == DPI_NATIVE_TYPE_DOUBLE;
+}
+
+// A query's columns as described once it's executed, shared read-only by everything that
+// reads the result: the table and its .moreRows pages, the pager, exports and background
+// jobs. The names are copied out of ODPI's query info into one buffer, so the views stay
+// valid as long as the metadata does, whatever happens to the statement.
+class ResultMetadata {
+public:
+    struct Column {
+        std::string_view name;
+        // Terminal cells the name takes, for sizing the column.
+        uint32_t nameWidth = 0;
+        bool nullable = false;
+        dpiDataTypeInfo typeInfo{};
+        // For the type the column is fetched as to begin with; blocks that come back as
+        // another native type need a formatter of their own.
+        ColumnFormatter formatter{DPI_NATIVE_TYPE_BYTES};
+    };
+
+    // With exactNumbers, the columns fetchesNumberAsText() picks out are formatted as the
+    // text they'll be fetched as.
+    explicit ResultMetadata(const OracleResultSource& source, bool exactNumbers = false);
+    ResultMetadata(const ResultMetadata&) = delete;
+    ResultMetadata& operator=(const ResultMetadata&) = delete;
+
+    uint32_t numColumns() const noexcept {
+        return static_cast<uint32_t>(_columns.size());
+    }
+    // 1-based, like the statement's columns.
+    const Column& column(uint32_t pos) const noexcept {
+        return _columns[pos - 1];
+    }
+    const std::vector<Column>& columns() const noexcept {
+        return _columns;
+    }
+    std::vector<std::string> names() const;
+    // A copy to format with, since formatters are swapped as native types change.
+    std::vector<ColumnFormatter> formatters() const;
+
+private:
+    std::string _names;
+    std::vector<Column> _columns;
+};
+
+} // namespace sqlplusplus
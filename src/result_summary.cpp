@@ -0,0 +1,256 @@
+#include "result_summary.h"
+
+#include "describe_cache.h"
+#include "result_metadata.h"
+#include "value_format.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+namespace sqlplusplus {
+namespace {
+
+// Space-Saving counters per heavy hitter reported; more keeps the counts tighter.
+constexpr size_t kCountersPerHitter = 8;
+
+// FNV-1a over the bytes, then MurmurHash3's finalizer so every bit of the result depends on
+// every byte, which HyperLogLog's register choice and rank need.
+uint64_t hashBytes(std::string_view bytes) noexcept {
+    uint64_t hash = 14695981039346656037ull;
+    for (auto ch : bytes) {
+        hash = (hash ^ static_cast<unsigned char>(ch)) * 1099511628211ull;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+enum class Ordering { Number, Timestamp, Text };
+
+Ordering orderingFor(dpiNativeTypeNum nativeType) noexcept {
+    switch (nativeType) {
+    case DPI_NATIVE_TYPE_INT64:
+    case DPI_NATIVE_TYPE_UINT64:
+    case DPI_NATIVE_TYPE_DOUBLE:
+    case DPI_NATIVE_TYPE_FLOAT:
+        return Ordering::Number;
+    case DPI_NATIVE_TYPE_TIMESTAMP:
+        return Ordering::Timestamp;
+    default:
+        return Ordering::Text;
+    }
+}
+
+double numberValue(const dpiData& data, dpiNativeTypeNum nativeType) noexcept {
+    switch (nativeType) {
+    case DPI_NATIVE_TYPE_INT64:
+        return static_cast<double>(data.value.asInt64);
+    case DPI_NATIVE_TYPE_UINT64:
+        return static_cast<double>(data.value.asUint64);
+    case DPI_NATIVE_TYPE_FLOAT:
+        return data.value.asFloat;
+    default:
+        return data.value.asDouble;
+    }
+}
+
+auto timestampKey(const dpiTimestamp& ts) noexcept {
+    // Offsets are left out, so values in different zones compare by their local time.
+    return std::make_tuple(ts.year, ts.month, ts.day, ts.hour, ts.minute, ts.second, ts.fsecond);
+}
+
+// One column's running state.
+class ColumnProfile {
+public:
+    ColumnProfile(ColumnSummary summary, size_t topK) :
+        _summary(std::move(summary)),
+        _hitters(std::max<size_t>(topK, 1) * kCountersPerHitter),
+        _topK(topK)
+    {}
+
+    void add(const dpiData& data, dpiNativeTypeNum nativeType, std::string_view text) {
+        if (data.isNull) {
+            ++_summary.nulls;
+            return;
+        }
+        ++_values;
+        _distinct.add(hashBytes(text));
+        _hitters.add(text);
+        switch (orderingFor(nativeType)) {
+        case Ordering::Number: {
+            const auto value = numberValue(data, nativeType);
+            _mean += (value - _mean) / static_cast<double>(_values);
+            if (_values == 1 || value < _minNumber) {
+                _minNumber = value;
+                _summary.min = std::string(text);
+            }
+            if (_values == 1 || value > _maxNumber) {
+                _maxNumber = value;
+                _summary.max = std::string(text);
+            }
+            _numeric = true;
+            break;
+        }
+        case Ordering::Timestamp:
+            if (_values == 1 || timestampKey(data.value.asTimestamp) < timestampKey(_minTimestamp)) {
+                _minTimestamp = data.value.asTimestamp;
+                _summary.min = std::string(text);
+            }
+            if (_values == 1 || timestampKey(data.value.asTimestamp) > timestampKey(_maxTimestamp)) {
+                _maxTimestamp = data.value.asTimestamp;
+                _summary.max = std::string(text);
+            }
+            break;
+        case Ordering::Text:
+            if (!_summary.min || text < *_summary.min) {
+                _summary.min = std::string(text);
+            }
+            if (!_summary.max || text > *_summary.max) {
+                _summary.max = std::string(text);
+            }
+            break;
+        }
+    }
+
+    ColumnSummary finish() {
+        if (_numeric) {
+            _summary.mean = _mean;
+        }
+        _summary.distinct = _values == 0 ? 0 : std::min(_distinct.estimate(), static_cast<double>(_values));
+        _summary.top = _hitters.top(_topK);
+        return std::move(_summary);
+    }
+
+private:
+    ColumnSummary _summary;
+    HyperLogLog _distinct;
+    HeavyHitters _hitters;
+    size_t _topK;
+    uint64_t _values = 0;
+    bool _numeric = false;
+    double _mean = 0;
+    double _minNumber = 0;
+    double _maxNumber = 0;
+    dpiTimestamp _minTimestamp{};
+    dpiTimestamp _maxTimestamp{};
+};
+
+} // namespace
+
+HyperLogLog::HyperLogLog(uint8_t precision) :
+    _precision(std::clamp<uint8_t>(precision, 4, 18)),
+    _registers(size_t{1} << _precision, 0)
+{}
+
+void HyperLogLog::add(uint64_t hash) noexcept {
+    const auto idx = hash >> (64 - _precision);
+    // The rank is where the first set bit of what's left is; a guard bit caps it when
+    // the rest is all zeros.
+    const auto rest = (hash << _precision) | (uint64_t{1} << (_precision - 1));
+    const auto rank = static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+    _registers[idx] = std::max(_registers[idx], rank);
+}
+
+double HyperLogLog::estimate() const noexcept {
+    const auto m = static_cast<double>(_registers.size());
+    double sum = 0;
+    size_t zeros = 0;
+    for (auto reg : _registers) {
+        sum += std::ldexp(1.0, -reg);
+        zeros += reg == 0;
+    }
+    const double alpha = 0.7213 / (1 + 1.079 / m);
+    const double raw = alpha * m * m / sum;
+    // Below about 2.5m the raw estimate is biased, and linear counting of the empty
+    // registers does better.
+    if (raw <= 2.5 * m && zeros > 0) {
+        return m * std::log(m / static_cast<double>(zeros));
+    }
+    return raw;
+}
+
+HeavyHitters::HeavyHitters(size_t capacity) : _capacity(std::max<size_t>(capacity, 1)) {
+    // Reserved up front so the index's views into the values never move.
+    _items.reserve(_capacity);
+}
+
+void HeavyHitters::add(std::string_view value) {
+    if (auto it = _index.find(value); it != _index.end()) {
+        ++_items[it->second].count;
+        return;
+    }
+    if (_items.size() < _capacity) {
+        _items.push_back(Item{std::string(value), 1, 0});
+        _index.emplace(_items.back().value, _items.size() - 1);
+        return;
+    }
+    const auto smallest = static_cast<size_t>(std::min_element(_items.begin(), _items.end(),
+            [](const auto& a, const auto& b) { return a.count < b.count; }) - _items.begin());
+    auto& item = _items[smallest];
+    _index.erase(item.value);
+    item.value.assign(value.data(), value.size());
+    item.error = item.count;
+    ++item.count;
+    _index.emplace(item.value, smallest);
+}
+
+std::vector<HeavyHitters::Item> HeavyHitters::top(size_t k) const {
+    auto items = _items;
+    std::sort(items.begin(), items.end(), [](const auto& a, const auto& b) { return a.count > b.count; });
+    if (items.size() > k) {
+        items.resize(k);
+    }
+    return items;
+}
+
+ResultSummary summarizeResults(OracleResultSource& source, size_t topK) {
+    const auto metadata = source.metadata();
+    auto formatters = metadata->formatters();
+    std::vector<ColumnProfile> profiles;
+    for (const auto& column : metadata->columns()) {
+        const auto& typeInfo = column.typeInfo;
+        ColumnSummary summary;
+        summary.name = std::string(column.name);
+        summary.type = columnTypeName(ColumnMetadata{
+            summary.name, column.nullable, typeInfo.oracleTypeNum, typeInfo.dbSizeInBytes, typeInfo.sizeInChars,
+            typeInfo.precision, typeInfo.scale, typeInfo.fsPrecision});
+        profiles.emplace_back(std::move(summary), topK);
+    }
+
+    ResultSummary result;
+    fmt::memory_buffer text;
+    for (;;) {
+        auto block = source.fetchBlock(source.fetchArraySize());
+        for (uint32_t col = 1; col <= block.numColumns(); ++col) {
+            auto& formatter = formatters[col - 1];
+            const auto nativeType = block.nativeType(col);
+            if (formatter.nativeType() != nativeType) {
+                formatter = ColumnFormatter(nativeType, formatter.oracleType());
+            }
+            const auto* data = block.columnData(col);
+            for (uint32_t row = 0; row < block.numRows(); ++row) {
+                text.clear();
+                if (!data[row].isNull) {
+                    formatter.format(data[row], text);
+                }
+                profiles[col - 1].add(data[row], nativeType, std::string_view(text.data(), text.size()));
+            }
+        }
+        result.rows += block.numRows();
+        if (!block.moreRows()) {
+            break;
+        }
+    }
+    for (auto& profile : profiles) {
+        result.columns.push_back(profile.finish());
+    }
+    return result;
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace sqlplusplus {
+
+// Approximate count of distinct values in a fixed 2^precision bytes, from 64-bit hashes of
+// them. The standard error is about 1.04 / sqrt(2^precision), under 1% at the default.
+class HyperLogLog {
+public:
+    explicit HyperLogLog(uint8_t precision = 14);
+
+    void add(uint64_t hash) noexcept;
+    double estimate() const noexcept;
+
+private:
+    uint8_t _precision;
+    std::vector<uint8_t> _registers;
+};
+
+// The most frequent values of a stream, by the Space-Saving algorithm: capacity counters,
+// where a value that isn't counted yet takes over the smallest counter and starts from its
+// count. Any value more frequent than 1/capacity of the stream is kept, and a count is
+// never off by more than its error.
+class HeavyHitters {
+public:
+    struct Item {
+        std::string value;
+        // At most error more than the value's real count.
+        uint64_t count = 0;
+        uint64_t error = 0;
+    };
+
+    explicit HeavyHitters(size_t capacity);
+
+    void add(std::string_view value);
+    // Up to k of the values counted most often, most frequent first.
+    std::vector<Item> top(size_t k) const;
+
+private:
+    size_t _capacity;
+    std::vector<Item> _items;
+    // Into _items; keys view the items' values.
+    std::unordered_map<std::string_view, size_t> _index;
+};
+
+struct ColumnSummary {
+    std::string name;
+    // As DDL would write it, e.g. VARCHAR2(30).
+    std::string type;
+    uint64_t nulls = 0;
+    // Formatted the way the table shows them; numbers and timestamps compare as such,
+    // everything else by its text. Unset when every value is null.
+    std::optional<std::string> min;
+    std::optional<std::string> max;
+    // Only for numeric columns.
+    std::optional<double> mean;
+    double distinct = 0;
+    std::vector<HeavyHitters::Item> top;
+};
+
+struct ResultSummary {
+    uint64_t rows = 0;
+    std::vector<ColumnSummary> columns;
+};
+
+// Profiles the rest of an executed query in one pass: per column its nulls, smallest and
+// largest values, mean, approximate distinct count and topK most frequent values. Memory
+// is fixed per column, a HyperLogLog and a Space-Saving counter each, whatever the number
+// of rows.
+ResultSummary summarizeResults(OracleResultSource& source, size_t topK);
+
+} // namespace sqlplusplus
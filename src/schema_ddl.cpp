@@ -0,0 +1,289 @@
+#include "schema_ddl.h"
+
+#include "typed_bind.h"
+#include "typed_rows.h"
+#include "work_stealing.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <filesystem>
+#include <future>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <utility>
+
+namespace sqlplusplus {
+namespace {
+
+// Indexes that back a constraint are created by their table's DDL, and a materialized
+// view's container table by the view's.
+constexpr std::string_view kObjectsSql = R"(
+SELECT o.object_type, o.object_name
+  FROM all_objects o
+ WHERE o.owner = :1
+   AND o.object_type IN ('SEQUENCE', 'TYPE', 'TABLE', 'INDEX', 'VIEW', 'MATERIALIZED VIEW', 'SYNONYM',
+                         'FUNCTION', 'PROCEDURE', 'PACKAGE', 'TYPE BODY', 'PACKAGE BODY', 'TRIGGER')
+   AND o.generated = 'N'
+   AND o.secondary = 'N'
+   AND o.object_name NOT LIKE 'BIN$%'
+   AND NOT (o.object_type = 'INDEX' AND EXISTS (
+           SELECT 1 FROM all_constraints c WHERE c.owner = o.owner AND c.index_name = o.object_name))
+   AND NOT (o.object_type = 'TABLE' AND EXISTS (
+           SELECT 1 FROM all_mviews m WHERE m.owner = o.owner AND m.mview_name = o.object_name))
+ ORDER BY CASE o.object_type
+              WHEN 'SEQUENCE' THEN 1 WHEN 'TYPE' THEN 2 WHEN 'TABLE' THEN 3 WHEN 'INDEX' THEN 4
+              WHEN 'VIEW' THEN 5 WHEN 'MATERIALIZED VIEW' THEN 6 WHEN 'SYNONYM' THEN 7
+              WHEN 'FUNCTION' THEN 8 WHEN 'PROCEDURE' THEN 9 WHEN 'PACKAGE' THEN 10
+              WHEN 'TYPE BODY' THEN 11 WHEN 'PACKAGE BODY' THEN 12 ELSE 13
+          END, o.object_name)";
+
+constexpr std::string_view kDependenciesSql = R"(
+SELECT type, name, referenced_type, referenced_name
+  FROM all_dependencies
+ WHERE owner = :1
+   AND referenced_owner = :2)";
+
+// Statements end in ; or /, so the output runs as a script.
+constexpr std::string_view kTransformSql = R"(
+BEGIN
+    DBMS_METADATA.SET_TRANSFORM_PARAM(DBMS_METADATA.SESSION_TRANSFORM, 'SQLTERMINATOR', TRUE);
+    DBMS_METADATA.SET_TRANSFORM_PARAM(DBMS_METADATA.SESSION_TRANSFORM, 'PRETTY', TRUE);
+END;)";
+
+constexpr std::string_view kDdlSql = "SELECT DBMS_METADATA.GET_DDL(:1, :2, :3) FROM dual";
+
+// What GET_DDL calls an ALL_OBJECTS type; a bare PACKAGE or TYPE would have the body too.
+std::string metadataType(const std::string& type) {
+    if (type == "PACKAGE" || type == "TYPE") {
+        return type + "_SPEC";
+    }
+    auto name = type;
+    std::replace(name.begin(), name.end(), ' ', '_');
+    return name;
+}
+
+std::string ddlFileName(const SchemaObject& object) {
+    auto name = object.name;
+    std::replace(name.begin(), name.end(), '/', '_');
+    auto type = object.type;
+    std::replace(type.begin(), type.end(), ' ', '_');
+    return fmt::format("{}.{}.sql", type, name);
+}
+
+// Runs GET_DDL for each object on parallelism connections at once, the objects handed
+// out in order, and calls consume(idx, reader) with a reader over its CLOB on the
+// worker's thread; consume returns the bytes it read. Objects whose DDL can't be
+// generated are passed to failed(idx, error) instead. Anything else that's thrown, a
+// lost session included, stops the workers and is rethrown.
+SchemaDdlResult forEachDdl(const std::function<OracleConnection()>& newConnection, std::string_view owner,
+                           const std::vector<SchemaObject>& objects, uint32_t parallelism,
+                           const std::function<uint64_t(size_t idx, OracleLobReader& reader)>& consume,
+                           const std::function<void(size_t idx, const std::string& error)>& failed) {
+    std::atomic<size_t> nextObject{0};
+    std::atomic<bool> stopping{false};
+    std::mutex resultMutex;
+    SchemaDdlResult result;
+
+    auto work = [&] {
+        auto conn = newConnection();
+        conn.prepareStatement(kTransformSql).execute();
+        auto stmt = conn.prepareStatement(kDdlSql);
+        for (auto idx = nextObject++; idx < objects.size() && !stopping; idx = nextObject++) {
+            const auto& object = objects[idx];
+            uint64_t bytes = 0;
+            std::optional<std::string> error;
+            try {
+                bind(stmt, metadataType(object.type), object.name, owner);
+                stmt.execute();
+                if (stmt.fetch() && !stmt.getColumnValue(1).isNull()) {
+                    OracleLobReader reader(stmt.context());
+                    reader.open(stmt.getColumnValue(1).as<dpiLob*>());
+                    bytes = consume(idx, reader);
+                } else {
+                    error = "no DDL generated";
+                }
+            } catch(const OracleException& e) {
+                if (e.isSessionLost()) {
+                    stopping = true;
+                    throw;
+                }
+                error = e.what();
+            } catch(...) {
+                stopping = true;
+                throw;
+            }
+            if (error) {
+                const auto message = fmt::format("{} {}: {}", object.type, object.name, *error);
+                failed(idx, message);
+                std::lock_guard<std::mutex> lk(resultMutex);
+                result.errors.push_back(message);
+                continue;
+            }
+            std::lock_guard<std::mutex> lk(resultMutex);
+            ++result.objects;
+            result.bytes += bytes;
+        }
+    };
+
+    const auto numWorkers = std::clamp<size_t>(parallelism, 1, std::max<size_t>(objects.size(), 1));
+    // An affinity each, so every worker's session gets a thread of its own while the I/O
+    // budget allows.
+    auto& executor = WorkStealingExecutor::sharedIo();
+    std::vector<std::future<void>> workers;
+    for (size_t idx = 0; idx < numWorkers; ++idx) {
+        workers.push_back(executor.submit(executor.newAffinity(), work));
+    }
+    std::exception_ptr firstError;
+    for (auto& worker : workers) {
+        try {
+            executor.wait(worker);
+        } catch(...) {
+            if (!firstError) {
+                firstError = std::current_exception();
+            }
+        }
+    }
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+    return result;
+}
+
+} // namespace
+
+std::vector<SchemaObject> schemaObjects(OracleConnection& conn, std::string_view owner) {
+    std::vector<SchemaObject> objects;
+    std::map<std::pair<std::string_view, std::string_view>, size_t> positions;
+    {
+        auto stmt = conn.prepareStatement(kObjectsSql);
+        bind(stmt, owner);
+        stmt.execute();
+        forEachRow<std::string_view, std::string_view>(stmt, [&](std::string_view type, std::string_view name) {
+            objects.push_back({std::string(type), std::string(name)});
+        });
+    }
+    for (size_t idx = 0; idx < objects.size(); ++idx) {
+        positions.emplace(std::make_pair(std::string_view(objects[idx].type), std::string_view(objects[idx].name)),
+                          idx);
+    }
+
+    std::vector<std::vector<size_t>> dependents(objects.size());
+    std::vector<size_t> blockers(objects.size());
+    {
+        auto stmt = conn.prepareStatement(kDependenciesSql);
+        bind(stmt, owner, owner);
+        stmt.execute();
+        forEachRow<std::string_view, std::string_view, std::string_view, std::string_view>(stmt,
+                [&](std::string_view type, std::string_view name, std::string_view refType, std::string_view refName) {
+                    const auto dependent = positions.find({type, name});
+                    const auto referenced = positions.find({refType, refName});
+                    if (dependent == positions.end() || referenced == positions.end() ||
+                            dependent->second == referenced->second) {
+                        return;
+                    }
+                    dependents[referenced->second].push_back(dependent->second);
+                    ++blockers[dependent->second];
+                });
+    }
+
+    // Everything whose references are out of the way goes in listed order; when a cycle
+    // leaves nothing ready, the first of what's left goes regardless.
+    std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> ready;
+    for (size_t idx = 0; idx < objects.size(); ++idx) {
+        if (blockers[idx] == 0) {
+            ready.push(idx);
+        }
+    }
+    std::vector<bool> placed(objects.size());
+    std::vector<SchemaObject> ordered;
+    ordered.reserve(objects.size());
+    size_t firstUnplaced = 0;
+    while (ordered.size() < objects.size()) {
+        if (ready.empty()) {
+            while (placed[firstUnplaced]) {
+                ++firstUnplaced;
+            }
+            blockers[firstUnplaced] = 0;
+            ready.push(firstUnplaced);
+        }
+        const auto idx = ready.top();
+        ready.pop();
+        if (placed[idx]) {
+            continue;
+        }
+        placed[idx] = true;
+        ordered.push_back(objects[idx]);
+        for (const auto dependent : dependents[idx]) {
+            if (!placed[dependent] && blockers[dependent] > 0 && --blockers[dependent] == 0) {
+                ready.push(dependent);
+            }
+        }
+    }
+    return ordered;
+}
+
+SchemaDdlResult writeSchemaDdl(const std::function<OracleConnection()>& newConnection, std::string_view owner,
+                               const std::vector<SchemaObject>& objects, uint32_t parallelism,
+                               BufferedFdWriter& out) {
+    // Finished objects wait here until everything before them has been written.
+    std::mutex outMutex;
+    std::vector<std::optional<std::string>> finished(objects.size());
+    size_t nextToWrite = 0;
+    auto finish = [&](size_t idx, std::string text) {
+        if (!text.empty() && text.back() != '\n') {
+            text += '\n';
+        }
+        std::lock_guard<std::mutex> lk(outMutex);
+        finished[idx] = std::move(text);
+        for (; nextToWrite < finished.size() && finished[nextToWrite]; ++nextToWrite) {
+            out.append(*finished[nextToWrite]);
+            finished[nextToWrite].reset();
+        }
+    };
+
+    auto result = forEachDdl(newConnection, owner, objects, parallelism,
+            [&](size_t idx, OracleLobReader& reader) -> uint64_t {
+                std::string text;
+                for (auto piece = reader.next(); !piece.empty(); piece = reader.next()) {
+                    text.append(piece);
+                }
+                const auto bytes = text.size();
+                finish(idx, std::move(text));
+                return bytes;
+            },
+            [&](size_t idx, const std::string& error) {
+                finish(idx, fmt::format("\n-- {}\n", error));
+            });
+    out.flush();
+    return result;
+}
+
+SchemaDdlResult writeSchemaDdlFiles(const std::function<OracleConnection()>& newConnection, std::string_view owner,
+                                    const std::vector<SchemaObject>& objects, uint32_t parallelism,
+                                    const std::string& directory) {
+    std::filesystem::create_directories(directory);
+    return forEachDdl(newConnection, owner, objects, parallelism,
+            [&](size_t idx, OracleLobReader& reader) -> uint64_t {
+                auto out = BufferedFdWriter::open((std::filesystem::path(directory) / ddlFileName(objects[idx])).string());
+                uint64_t bytes = 0;
+                char last = '\n';
+                for (auto piece = reader.next(); !piece.empty(); piece = reader.next()) {
+                    out.append(piece);
+                    bytes += piece.size();
+                    last = piece.back();
+                }
+                if (last != '\n') {
+                    out.append('\n');
+                }
+                out.flush();
+                return bytes;
+            },
+            [](size_t, const std::string&) {});
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "buffered_writer.h"
+#include "oracle_helpers.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+struct SchemaObject {
+    // As ALL_OBJECTS has it, e.g. PACKAGE BODY.
+    std::string type;
+    std::string name;
+};
+
+// The objects of owner that DBMS_METADATA.GET_DDL generates DDL for on their own, in an
+// order they can be created in: what another object refers to, per ALL_DEPENDENCIES,
+// comes before it, and otherwise sequences, types and tables come before the indexes,
+// views and code over them, then by name. Partitions, LOB segments, indexes and the like
+// that come with their table's DDL are left out, as are dropped tables in the recycle
+// bin. Objects in a dependency cycle, like packages that call each other, keep that
+// order among themselves.
+std::vector<SchemaObject> schemaObjects(OracleConnection& conn, std::string_view owner);
+
+struct SchemaDdlResult {
+    uint64_t objects = 0;
+    uint64_t bytes = 0;
+    // "TYPE NAME: message" for each object DBMS_METADATA couldn't generate DDL for, e.g.
+    // for want of SELECT_CATALOG_ROLE; the rest are written regardless.
+    std::vector<std::string> errors;
+};
+
+// Generates the DDL of the objects of owner with DBMS_METADATA.GET_DDL, each statement
+// terminated so the output runs as a script, on parallelism connections from
+// newConnection at once, each reading its CLOBs a piece at a time. Objects are handed
+// out in order, and written to out in that order as soon as everything before them has
+// been.
+SchemaDdlResult writeSchemaDdl(const std::function<OracleConnection()>& newConnection, std::string_view owner,
+                               const std::vector<SchemaObject>& objects, uint32_t parallelism,
+                               BufferedFdWriter& out);
+
+// The same, but each object's DDL goes into a file of its own in directory, named for its
+// type and name, e.g. PACKAGE_BODY.BILLING.sql, and is streamed there as it's read.
+SchemaDdlResult writeSchemaDdlFiles(const std::function<OracleConnection()>& newConnection, std::string_view owner,
+                                    const std::vector<SchemaObject>& objects, uint32_t parallelism,
+                                    const std::string& directory);
+
+} // namespace sqlplusplus
@@ -0,0 +1,544 @@
+#include "schema_index.h"
+
+#include "cache_file.h"
+#include "mapped_file.h"
+#include "trace_recorder.h"
+#include "typed_bind.h"
+#include "typed_rows.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cctype>
+#include <optional>
+#include <set>
+
+namespace sqlplusplus {
+namespace {
+
+// Rows per round trip for the catalog queries; these can return tens of thousands of
+// columns for a big schema.
+constexpr uint32_t kCatalogFetchArraySize = 1000;
+// LAST_DDL_TIME lower bound that makes the incremental queries load everything.
+constexpr std::string_view kFullLoadDdlTime = "00010101000000";
+// Tables registered for change notification per registration query. Each query is a round
+// trip, and one query can name many tables.
+constexpr size_t kTablesPerRegistration = 32;
+
+constexpr auto kCurrentSchemaQuery = "select sys_context('userenv', 'current_schema') from dual";
+
+constexpr auto kObjectsQuery =
+    "select object_name, object_type, to_char(last_ddl_time, 'YYYYMMDDHH24MISS') "
+    "from all_objects "
+    "where owner = :1 and subobject_name is null "
+    "and object_type in ('TABLE', 'VIEW', 'SYNONYM', 'SEQUENCE', 'PACKAGE', "
+    "'PROCEDURE', 'FUNCTION', 'TYPE') "
+    "and last_ddl_time > to_date(:2, 'YYYYMMDDHH24MISS')";
+
+constexpr auto kColumnsQuery =
+    "select c.table_name, c.column_name "
+    "from all_tab_columns c join all_objects o "
+    "on o.owner = c.owner and o.object_name = c.table_name and o.subobject_name is null "
+    "and o.object_type in ('TABLE', 'VIEW') "
+    "where c.owner = :1 and o.last_ddl_time > to_date(:2, 'YYYYMMDDHH24MISS')";
+
+constexpr auto kPackageMembersQuery =
+    "select p.object_name, p.procedure_name "
+    "from all_procedures p join all_objects o "
+    "on o.owner = p.owner and o.object_name = p.object_name and o.object_type = 'PACKAGE' "
+    "where p.owner = :1 and p.procedure_name is not null "
+    "and o.last_ddl_time > to_date(:2, 'YYYYMMDDHH24MISS')";
+
+SchemaObjectKind objectKindFromType(std::string_view objectType) {
+    if (objectType == "TABLE") {
+        return SchemaObjectKind::Table;
+    } else if (objectType == "VIEW") {
+        return SchemaObjectKind::View;
+    } else if (objectType == "SYNONYM") {
+        return SchemaObjectKind::Synonym;
+    } else if (objectType == "SEQUENCE") {
+        return SchemaObjectKind::Sequence;
+    } else if (objectType == "PACKAGE") {
+        return SchemaObjectKind::Package;
+    } else if (objectType == "PROCEDURE") {
+        return SchemaObjectKind::Procedure;
+    } else if (objectType == "FUNCTION") {
+        return SchemaObjectKind::Function;
+    }
+    return SchemaObjectKind::Type;
+}
+
+void appendLower(std::string& out, std::string_view in) {
+    std::transform(in.begin(), in.end(), std::back_inserter(out), [](const auto ch) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+    });
+}
+
+std::string qualifiedKey(std::string_view qualifier, std::string_view name) {
+    std::string key;
+    key.reserve(qualifier.size() + name.size() + 1);
+    appendLower(key, qualifier);
+    key.push_back('.');
+    appendLower(key, name);
+    return key;
+}
+
+std::string lowerKey(std::string_view name) {
+    std::string key;
+    key.reserve(name.size());
+    appendLower(key, name);
+    return key;
+}
+
+constexpr std::string_view kSchemaCacheMagic = "SQLPPSC1";
+
+// One schema's entries as another process left them.
+struct SchemaCacheFile {
+    // LAST_DDL_TIME of the newest object in it.
+    std::string lastDdlTime;
+    // Upper case, as registered for change notification.
+    std::vector<std::string> tables;
+    tsl::htrie_map<char, SchemaObjectKind> entries;
+};
+
+std::string fnvHex(std::string_view bytes) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const auto ch : bytes) {
+        hash = (hash ^ static_cast<unsigned char>(ch)) * 1099511628211ull;
+    }
+    return fmt::format("{:016x}", hash);
+}
+
+// nullopt when there's no file, it can't be read, or it's too old to trust.
+std::optional<SchemaCacheFile> loadSchemaCache(const std::filesystem::path& path) {
+    try {
+        const auto age = std::filesystem::file_time_type::clock::now() - std::filesystem::last_write_time(path);
+        if (age > SchemaIndex::kSharedCacheMaxAge) {
+            return std::nullopt;
+        }
+        MappedFile file(path.string());
+        const auto contents = file.contents();
+        if (contents.substr(0, kSchemaCacheMagic.size()) != kSchemaCacheMagic) {
+            return std::nullopt;
+        }
+        CacheDeserializer deserializer(contents.substr(kSchemaCacheMagic.size()));
+        auto readString = [&deserializer] {
+            std::string text(deserializer.operator()<uint16_t>(), '\0');
+            deserializer(text.data(), text.size());
+            return text;
+        };
+        SchemaCacheFile cache;
+        cache.lastDdlTime = readString();
+        const auto numTables = deserializer.operator()<uint32_t>();
+        for (uint32_t idx = 0; idx < numTables; ++idx) {
+            cache.tables.push_back(readString());
+        }
+        cache.entries = tsl::htrie_map<char, SchemaObjectKind>::deserialize(deserializer);
+        return cache;
+    } catch (const std::exception&) {
+        // Missing, unreadable or corrupt: the schema is queried as if there were no cache.
+        return std::nullopt;
+    }
+}
+
+void saveSchemaCache(const std::filesystem::path& path, const SchemaCacheFile& cache) {
+    CacheSerializer serializer;
+    serializer(kSchemaCacheMagic.data(), kSchemaCacheMagic.size());
+    auto writeString = [&serializer](std::string_view text) {
+        serializer(static_cast<uint16_t>(text.size()));
+        serializer(text.data(), text.size());
+    };
+    writeString(cache.lastDdlTime);
+    serializer(static_cast<uint32_t>(cache.tables.size()));
+    for (const auto& table : cache.tables) {
+        writeString(table);
+    }
+    cache.entries.serialize(serializer);
+    replaceCacheFile(path, serializer.data());
+}
+
+// Runs one of the catalog queries for owner and hands each row's columns to fn.
+template <typename... Columns, typename Fn>
+void forEachCatalogRow(OracleConnection& conn,
+                       const char* sql,
+                       const std::string& owner,
+                       std::string_view sinceDdlTime,
+                       Fn&& fn) {
+    auto stmt = conn.prepareStatement(sql);
+    stmt.setFetchArraySize(kCatalogFetchArraySize);
+    bind(stmt, owner, sinceDdlTime);
+    stmt.execute();
+
+    forEachRow<Columns...>(stmt, fn);
+}
+
+} // namespace
+
+SchemaIndex::SchemaIndex(ConnectionFactory connectionFactory, std::chrono::seconds refreshInterval) :
+    _connectionFactory(std::move(connectionFactory)),
+    _refreshInterval(refreshInterval),
+    _worker([this] { _run(); })
+{}
+
+SchemaIndex::~SchemaIndex() {
+    {
+        std::lock_guard<std::mutex> lk(_stateMutex);
+        _stopping = true;
+    }
+    _stateCv.notify_all();
+    _worker.join();
+}
+
+std::string SchemaIndex::_normalizeOwner(std::string_view owner) {
+    std::string ret;
+    ret.reserve(owner.size());
+    std::transform(owner.begin(), owner.end(), std::back_inserter(ret), [](const auto ch) {
+        return static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+    });
+    return ret;
+}
+
+void SchemaIndex::requestSchema(std::string_view owner) {
+    auto normalized = _normalizeOwner(owner);
+    {
+        std::lock_guard<std::mutex> lk(_stateMutex);
+        if (!normalized.empty()) {
+            if (_schemas.find(normalized) != _schemas.end()) {
+                return;
+            }
+            _schemas.emplace(normalized, SchemaState{});
+        }
+        _pending.push_back(std::move(normalized));
+    }
+    _stateCv.notify_one();
+}
+
+void SchemaIndex::requestRefresh() {
+    {
+        std::lock_guard<std::mutex> lk(_stateMutex);
+        _refreshRequested = true;
+    }
+    _stateCv.notify_one();
+}
+
+bool SchemaIndex::isSchemaKnown(std::string_view owner) const {
+    auto normalized = _normalizeOwner(owner);
+    std::lock_guard<std::mutex> lk(_stateMutex);
+    return _schemas.find(normalized) != _schemas.end();
+}
+
+void SchemaIndex::addColumns(std::string_view tableName, const std::vector<std::string_view>& columnNames) {
+    if (auto dot = tableName.rfind('.'); dot != std::string_view::npos) {
+        tableName = tableName.substr(dot + 1);
+    }
+    std::unique_lock<std::shared_mutex> indexLk(_indexMutex);
+    for (auto column : columnNames) {
+        _index[lowerKey(column)] = SchemaObjectKind::Column;
+        _index[qualifiedKey(tableName, column)] = SchemaObjectKind::Column;
+    }
+}
+
+void SchemaIndex::setSharedCache(std::filesystem::path directory, std::string databaseKey) {
+    std::lock_guard<std::mutex> lk(_stateMutex);
+    _cacheDirectory = std::move(directory);
+    _cacheKey = std::move(databaseKey);
+}
+
+std::filesystem::path SchemaIndex::_sharedCachePath(const std::string& owner) const {
+    std::lock_guard<std::mutex> lk(_stateMutex);
+    if (_cacheDirectory.empty()) {
+        return {};
+    }
+    return _cacheDirectory / fmt::format("schema-{}", fnvHex(fmt::format("{}\n{}", _cacheKey, owner)));
+}
+
+void SchemaIndex::setInvalidationListener(InvalidationListener listener) {
+    std::lock_guard<std::mutex> lk(_stateMutex);
+    _invalidationListener = std::move(listener);
+}
+
+void SchemaIndex::_run() {
+    traceRecorder.nameThread("schema index");
+    std::optional<OracleConnection> conn;
+    // Declared after conn so it's always torn down first.
+    std::optional<OracleSubscription> subscription;
+    bool subscriptionUnavailable = false;
+
+    std::unique_lock<std::mutex> lk(_stateMutex);
+    while (!_stopping) {
+        auto hasWork = [&] {
+            return _stopping || _refreshRequested || _subscriptionLost || !_pending.empty();
+        };
+        bool timedOut = false;
+        if (subscription) {
+            _stateCv.wait(lk, hasWork);
+        } else {
+            timedOut = !_stateCv.wait_for(lk, _refreshInterval, hasWork);
+        }
+        if (_stopping) {
+            break;
+        }
+
+        if (_subscriptionLost) {
+            // The server dropped the registration; fall back to polling for this connection.
+            _subscriptionLost = false;
+            _registeredTables.clear();
+            lk.unlock();
+            subscription.reset();
+            lk.lock();
+            subscriptionUnavailable = true;
+        }
+
+        std::vector<std::string> toLoad;
+        if (timedOut || _refreshRequested) {
+            _refreshRequested = false;
+            for (const auto& schema : _schemas) {
+                toLoad.push_back(schema.first);
+            }
+        }
+        while (!_pending.empty()) {
+            toLoad.push_back(std::move(_pending.front()));
+            _pending.pop_front();
+        }
+        if (toLoad.empty()) {
+            continue;
+        }
+
+        lk.unlock();
+        try {
+            if (!conn) {
+                conn.emplace(_connectionFactory());
+                subscriptionUnavailable = false;
+            }
+            if (!subscription && !subscriptionUnavailable) {
+                try {
+                    subscription.emplace(conn->subscribeObjectChanges(
+                            DPI_OPCODE_ALTER | DPI_OPCODE_DROP,
+                            [this](const dpiSubscrMessage& message) { _onObjectChange(message); }));
+                } catch(const OracleException&) {
+                    // Usually a missing CHANGE NOTIFICATION privilege; poll instead.
+                    subscriptionUnavailable = true;
+                }
+            }
+            for (auto& owner : toLoad) {
+                if (owner.empty()) {
+                    auto stmt = conn->prepareStatement(kCurrentSchemaQuery);
+                    stmt.execute();
+                    if (!stmt.fetch()) {
+                        continue;
+                    }
+                    owner = std::string(stmt.getColumnValue(1).as<std::string_view>());
+                    std::lock_guard<std::mutex> stateLk(_stateMutex);
+                    _schemas.emplace(owner, SchemaState{});
+                }
+                std::vector<std::string> loadedTables;
+                _loadSchema(*conn, owner, loadedTables);
+                if (subscription) {
+                    _registerTables(*subscription, owner, loadedTables);
+                }
+            }
+        } catch(const std::exception&) {
+            // Keep whatever has been indexed already. The connection may be what broke, so
+            // start over with a fresh one at the next refresh.
+            subscription.reset();
+            conn.reset();
+            std::lock_guard<std::mutex> stateLk(_stateMutex);
+            _registeredTables.clear();
+        }
+        lk.lock();
+    }
+
+    lk.unlock();
+    subscription.reset();
+}
+
+void SchemaIndex::_registerTables(OracleSubscription& subscription,
+                                  const std::string& owner,
+                                  const std::vector<std::string>& tables) {
+    std::vector<std::string> toRegister;
+    {
+        std::lock_guard<std::mutex> lk(_stateMutex);
+        for (const auto& table : tables) {
+            auto name = fmt::format("{}.{}", owner, table);
+            if (_registeredTables.find(name) == _registeredTables.end()) {
+                toRegister.push_back(table);
+            }
+        }
+    }
+
+    fmt::memory_buffer sql;
+    for (size_t first = 0; first < toRegister.size(); first += kTablesPerRegistration) {
+        auto last = std::min(toRegister.size(), first + kTablesPerRegistration);
+        sql.clear();
+        fmt::format_to(sql, "select 1 from ");
+        for (auto i = first; i < last; ++i) {
+            fmt::format_to(sql, "{}\"{}\".\"{}\"", i == first ? "" : ", ", owner, toRegister[i]);
+        }
+        fmt::format_to(sql, " where 1 = 0");
+        subscription.registerQuery(std::string_view(sql.data(), sql.size()));
+
+        std::lock_guard<std::mutex> lk(_stateMutex);
+        for (auto i = first; i < last; ++i) {
+            _registeredTables.insert(fmt::format("{}.{}", owner, toRegister[i]));
+        }
+    }
+}
+
+void SchemaIndex::_onObjectChange(const dpiSubscrMessage& message) {
+    if (message.eventType == DPI_EVENT_DEREG) {
+        {
+            std::lock_guard<std::mutex> lk(_stateMutex);
+            _subscriptionLost = true;
+        }
+        _stateCv.notify_one();
+        return;
+    }
+    if (message.eventType != DPI_EVENT_OBJCHANGE) {
+        return;
+    }
+
+    InvalidationListener listener;
+    {
+        std::lock_guard<std::mutex> lk(_stateMutex);
+        listener = _invalidationListener;
+    }
+
+    for (uint32_t i = 0; i < message.numTables; ++i) {
+        const auto& table = message.tables[i];
+        if ((table.operation & (DPI_OPCODE_ALTER | DPI_OPCODE_DROP)) == 0) {
+            continue;
+        }
+        auto fullName = std::string_view(table.name, table.nameLength);
+        auto dot = fullName.find('.');
+        if (dot == std::string_view::npos) {
+            continue;
+        }
+        auto owner = fullName.substr(0, dot);
+        auto name = fullName.substr(dot + 1);
+        bool dropped = (table.operation & DPI_OPCODE_DROP) != 0;
+
+        {
+            // Columns are re-read by the refresh queued below, since the DDL moved the
+            // table's LAST_DDL_TIME.
+            std::unique_lock<std::shared_mutex> indexLk(_indexMutex);
+            _index.erase_prefix(lowerKey(name) + ".");
+            if (dropped) {
+                _index.erase(qualifiedKey(owner, name));
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lk(_stateMutex);
+            if (dropped) {
+                auto it = _registeredTables.find(fullName);
+                if (it != _registeredTables.end()) {
+                    _registeredTables.erase(it);
+                }
+            }
+            _pending.emplace_back(owner);
+        }
+        _stateCv.notify_one();
+
+        if (listener) {
+            listener(owner, name);
+        }
+    }
+}
+
+void SchemaIndex::_loadSchema(OracleConnection& conn, const std::string& owner, std::vector<std::string>& loadedTables) {
+    std::string sinceDdlTime;
+    {
+        std::lock_guard<std::mutex> lk(_stateMutex);
+        auto it = _schemas.find(owner);
+        if (it != _schemas.end()) {
+            sinceDdlTime = it->second.lastDdlTime;
+        }
+    }
+    // Only a first load reads the shared cache; after that this process's own index is
+    // the newer of the two.
+    const auto cachePath = _sharedCachePath(owner);
+    std::optional<SchemaCacheFile> cached;
+    if (sinceDdlTime.empty() && !cachePath.empty()) {
+        cached = loadSchemaCache(cachePath);
+    }
+    if (cached) {
+        TraceSpan span("schema cache load");
+        {
+            std::unique_lock<std::shared_mutex> indexLk(_indexMutex);
+            std::string key;
+            for (auto it = cached->entries.begin(); it != cached->entries.end(); ++it) {
+                it.key(key);
+                _index[key] = it.value();
+            }
+        }
+        loadedTables.insert(loadedTables.end(), cached->tables.begin(), cached->tables.end());
+        sinceDdlTime = cached->lastDdlTime;
+    }
+    const bool fullLoad = sinceDdlTime.empty();
+    if (fullLoad) {
+        sinceDdlTime = std::string(kFullLoadDdlTime);
+    }
+
+    // Build the whole batch before taking the index lock so completion never waits on a
+    // round trip.
+    std::vector<std::pair<std::string, SchemaObjectKind>> batch;
+    const auto firstNewTable = loadedTables.size();
+    std::string newestDdlTime = sinceDdlTime;
+    forEachCatalogRow<std::string_view, std::string_view, std::string_view>(
+        conn, kObjectsQuery, owner, sinceDdlTime, [&](std::string_view name, std::string_view type, std::string_view ddlTime) {
+        auto kind = objectKindFromType(type);
+        batch.emplace_back(lowerKey(name), kind);
+        batch.emplace_back(qualifiedKey(owner, name), kind);
+        if (kind == SchemaObjectKind::Table) {
+            loadedTables.emplace_back(name);
+        }
+        if (ddlTime > newestDdlTime) {
+            newestDdlTime = std::string(ddlTime);
+        }
+    });
+    if (!batch.empty()) {
+        forEachCatalogRow<std::string_view, std::string_view>(
+            conn, kColumnsQuery, owner, sinceDdlTime, [&](std::string_view table, std::string_view column) {
+            batch.emplace_back(lowerKey(column), SchemaObjectKind::Column);
+            batch.emplace_back(qualifiedKey(table, column), SchemaObjectKind::Column);
+        });
+        forEachCatalogRow<std::string_view, std::string_view>(
+            conn, kPackageMembersQuery, owner, sinceDdlTime, [&](std::string_view package, std::string_view member) {
+            batch.emplace_back(lowerKey(member), SchemaObjectKind::PackageMember);
+            batch.emplace_back(qualifiedKey(package, member), SchemaObjectKind::PackageMember);
+        });
+
+        std::unique_lock<std::shared_mutex> indexLk(_indexMutex);
+        for (auto& entry : batch) {
+            _index[entry.first] = entry.second;
+        }
+    }
+
+    // Written when this process is the first to see what changed since the file was, or
+    // when there was no file to use.
+    if (!cachePath.empty() && (fullLoad || !batch.empty())) {
+        SchemaCacheFile updated;
+        if (cached) {
+            updated = std::move(*cached);
+        }
+        for (auto& entry : batch) {
+            updated.entries[entry.first] = entry.second;
+        }
+        std::set<std::string> tables(updated.tables.begin(), updated.tables.end());
+        tables.insert(loadedTables.begin() + static_cast<std::ptrdiff_t>(firstNewTable), loadedTables.end());
+        updated.tables.assign(tables.begin(), tables.end());
+        updated.lastDdlTime = newestDdlTime;
+        try {
+            saveSchemaCache(cachePath, updated);
+        } catch (const std::exception&) {
+            // Not being able to write it just means the next process queries for itself.
+        }
+    }
+
+    if (fullLoad && batch.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lk(_stateMutex);
+    _schemas[owner].lastDdlTime = std::move(newestDdlTime);
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include "tsl/htrie_map.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace sqlplusplus {
+
+enum class SchemaObjectKind : uint8_t {
+    Table,
+    View,
+    Synonym,
+    Sequence,
+    Package,
+    Procedure,
+    Function,
+    Type,
+    Column,
+    PackageMember,
+};
+
+// Completion index of the schema objects a user works with: tables, views and other named
+// objects, their columns and package members. Keys are lower-cased and stored both bare
+// ("employees", "salary") and qualified ("hr.employees", "employees.salary"), so every
+// lookup is a prefix walk of the trie, O(prefix length).
+//
+// Schemas are loaded on a background thread with its own connection the first time they're
+// requested, then refreshed incrementally: only objects whose LAST_DDL_TIME moved since the
+// previous load are re-read. Dropped objects stay in the index for the rest of the session.
+// Lookups never wait on the loader; while it's merging a batch they just find nothing.
+//
+// When the server allows it, loaded tables are also registered for object change
+// notification, so ALTER and DROP invalidate just the affected entries and queue their
+// schema for a refresh; the periodic refresh only runs when notifications aren't available.
+//
+// With a shared cache, each schema's entries are also kept in a file that every process on
+// the host maps in rather than running the catalog queries again; see setSharedCache().
+class SchemaIndex {
+public:
+    using ConnectionFactory = std::function<OracleConnection()>;
+    using InvalidationListener = std::function<void(std::string_view owner, std::string_view objectName)>;
+
+    explicit SchemaIndex(ConnectionFactory connectionFactory,
+            std::chrono::seconds refreshInterval = std::chrono::minutes(5));
+    SchemaIndex(const SchemaIndex&) = delete;
+    SchemaIndex& operator=(const SchemaIndex&) = delete;
+    ~SchemaIndex();
+
+    // Files older than this are loaded in full again, which is when dropped objects leave.
+    static constexpr std::chrono::hours kSharedCacheMaxAge{24};
+
+    // Keeps each schema's entries in a file under directory, keyed by databaseKey and the
+    // owner; the key should name the login as well as the database, since what ALL_OBJECTS
+    // shows depends on who's asking. A schema that's there is loaded from the file, then
+    // only the objects whose DDL moved since it was written are queried, and the process
+    // that finds any writes the file again for the rest. Set it before the first
+    // requestSchema().
+    void setSharedCache(std::filesystem::path directory, std::string databaseKey);
+
+    // Queues a schema to be loaded if it hasn't been already; an empty owner means the
+    // session's current schema. Never blocks on the database.
+    void requestSchema(std::string_view owner);
+    // Queues an incremental refresh of every loaded schema.
+    void requestRefresh();
+
+    // Called from the notification thread with the upper-case owner and name of every
+    // object that was altered or dropped, so other caches of its metadata can drop it too.
+    void setInvalidationListener(InvalidationListener listener);
+
+    // Indexes columns learned some other way, e.g. from a describe. tableName may be
+    // qualified with its owner.
+    void addColumns(std::string_view tableName, const std::vector<std::string_view>& columnNames);
+
+    // True if the schema has been loaded or is queued to be.
+    bool isSchemaKnown(std::string_view owner) const;
+
+    static constexpr uint32_t kindBit(SchemaObjectKind kind) noexcept {
+        return 1u << static_cast<uint32_t>(kind);
+    }
+    static constexpr uint32_t kAllKinds = ~0u;
+
+    // Calls fn(key, kind) for up to limit entries whose key starts with prefix and whose
+    // kind is one of the kindBit()s in kinds. Entries of other kinds don't count towards
+    // limit, but no more than kScanFactor times limit entries are looked at, so a lookup
+    // takes a bounded time however the kinds are mixed. Returns false without calling fn
+    // if the index is being updated right now.
+    template <typename Fn>
+    bool forEachPrefixMatch(std::string_view prefix, size_t limit, uint32_t kinds, Fn&& fn) const {
+        constexpr size_t kScanFactor = 4;
+        std::shared_lock<std::shared_mutex> lock(_indexMutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return false;
+        }
+        auto range = _index.equal_prefix_range(prefix);
+        std::string keyBuffer;
+        size_t count = 0;
+        size_t scanned = 0;
+        for (auto it = range.first; it != range.second && count < limit && scanned < limit * kScanFactor;
+             ++it, ++scanned) {
+            if ((kindBit(it.value()) & kinds) == 0) {
+                continue;
+            }
+            it.key(keyBuffer);
+            fn(std::string_view(keyBuffer), it.value());
+            ++count;
+        }
+        return true;
+    }
+    template <typename Fn>
+    bool forEachPrefixMatch(std::string_view prefix, size_t limit, Fn&& fn) const {
+        return forEachPrefixMatch(prefix, limit, kAllKinds, std::forward<Fn>(fn));
+    }
+
+private:
+    struct SchemaState {
+        // Newest LAST_DDL_TIME seen, as YYYYMMDDHH24MISS. Empty until the first load.
+        std::string lastDdlTime;
+    };
+
+    void _run();
+    // Loads or refreshes owner, appending the tables it (re)indexed to loadedTables.
+    void _loadSchema(OracleConnection& conn, const std::string& owner, std::vector<std::string>& loadedTables);
+    void _registerTables(OracleSubscription& subscription,
+                         const std::string& owner,
+                         const std::vector<std::string>& tables);
+    void _onObjectChange(const dpiSubscrMessage& message);
+    static std::string _normalizeOwner(std::string_view owner);
+    // Empty without a shared cache.
+    std::filesystem::path _sharedCachePath(const std::string& owner) const;
+
+    ConnectionFactory _connectionFactory;
+    std::chrono::seconds _refreshInterval;
+
+    mutable std::shared_mutex _indexMutex;
+    tsl::htrie_map<char, SchemaObjectKind> _index;
+
+    mutable std::mutex _stateMutex;
+    std::condition_variable _stateCv;
+    std::deque<std::string> _pending;
+    std::map<std::string, SchemaState, std::less<>> _schemas;
+    // "OWNER.TABLE" names already registered with the subscription.
+    std::set<std::string, std::less<>> _registeredTables;
+    InvalidationListener _invalidationListener;
+    std::filesystem::path _cacheDirectory;
+    std::string _cacheKey;
+    bool _subscriptionLost = false;
+    bool _refreshRequested = false;
+    bool _stopping = false;
+    std::thread _worker;
+};
+
+} // namespace sqlplusplus
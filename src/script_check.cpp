@@ -0,0 +1,103 @@
+#include "script_check.h"
+
+#include "sql_splitter.h"
+#include "work_stealing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <future>
+#include <mutex>
+
+namespace sqlplusplus {
+namespace {
+
+// The server's offset into text as a line of the script, text starting on firstLine.
+uint64_t errorLine(std::string_view text, uint64_t firstLine, uint32_t offset) {
+    const auto before = text.substr(0, std::min<size_t>(offset, text.size()));
+    return firstLine + static_cast<uint64_t>(std::count(before.begin(), before.end(), '\n'));
+}
+
+} // namespace
+
+ScriptCheckResult checkScript(const std::function<OracleConnection()>& newConnection, std::string_view script,
+                              uint32_t parallelism) {
+    ScriptCheckResult result;
+    std::vector<SqlStatement> statements;
+    SqlSplitter splitter(script);
+    for (SqlStatement stmt; splitter.next(stmt);) {
+        if (stmt.isDirective) {
+            continue;
+        }
+        if (!stmt.complete) {
+            result.errors.push_back({stmt.line, "the script ends before this statement does"});
+        } else if (stmt.isCommand) {
+            ++result.skipped;
+        } else {
+            statements.push_back(stmt);
+        }
+    }
+
+    std::atomic<size_t> nextStatement{0};
+    std::atomic<bool> stopping{false};
+    std::mutex resultMutex;
+
+    auto work = [&] {
+        auto conn = newConnection();
+        for (auto idx = nextStatement++; idx < statements.size() && !stopping; idx = nextStatement++) {
+            const auto& statement = statements[idx];
+            try {
+                auto stmt = conn.prepareStatement(statement.text);
+                const auto info = stmt.info();
+                if (!info.isQuery && !info.isDML && !info.isPLSQL) {
+                    std::lock_guard<std::mutex> lk(resultMutex);
+                    ++result.skipped;
+                    continue;
+                }
+                stmt.execute(info.isQuery ? DPI_MODE_EXEC_DESCRIBE_ONLY : DPI_MODE_EXEC_PARSE_ONLY);
+            } catch(const OracleException& e) {
+                if (e.isSessionLost()) {
+                    stopping = true;
+                    throw;
+                }
+                std::lock_guard<std::mutex> lk(resultMutex);
+                ++result.checked;
+                result.errors.push_back({errorLine(statement.text, statement.line, e.info().offset), e.what()});
+                continue;
+            } catch(...) {
+                stopping = true;
+                throw;
+            }
+            std::lock_guard<std::mutex> lk(resultMutex);
+            ++result.checked;
+        }
+    };
+
+    const auto numWorkers = std::clamp<size_t>(parallelism, 1, std::max<size_t>(statements.size(), 1));
+    // An affinity each, so every worker's session gets a thread of its own while the I/O
+    // budget allows.
+    auto& executor = WorkStealingExecutor::sharedIo();
+    std::vector<std::future<void>> workers;
+    for (size_t idx = 0; idx < numWorkers; ++idx) {
+        workers.push_back(executor.submit(executor.newAffinity(), work));
+    }
+    std::exception_ptr firstError;
+    for (auto& worker : workers) {
+        try {
+            executor.wait(worker);
+        } catch(...) {
+            if (!firstError) {
+                firstError = std::current_exception();
+            }
+        }
+    }
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+    std::stable_sort(result.errors.begin(), result.errors.end(), [](const auto& left, const auto& right) {
+        return left.line < right.line;
+    });
+    return result;
+}
+
+} // namespace sqlplusplus
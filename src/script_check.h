@@ -0,0 +1,42 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+struct ScriptCheckError {
+    // One-based line of the script the error is on: where the server says parsing stopped,
+    // or the statement's first line when it doesn't say.
+    uint64_t line = 0;
+    std::string message;
+};
+
+struct ScriptCheckResult {
+    // Statements the server parsed or described.
+    uint64_t checked = 0;
+    // DDL, transaction control, ALTER SESSION and the like, which the server would run on
+    // parsing them, and client commands, none of which are sent.
+    uint64_t skipped = 0;
+    // In script order.
+    std::vector<ScriptCheckError> errors;
+};
+
+// Has the server check every statement of a script without running any of them: queries
+// are described and DML, PL/SQL blocks and CALLs parsed, on parallelism connections from
+// newConnection at once, the statements handed out in order. Only the statements the
+// server parses without running are sent, so nothing is changed; since the DDL isn't run
+// either, a statement that uses an object the script creates before it is reported as
+// an error on a database that doesn't have the object yet.
+//
+// A statement the script ends before the end of is an error. Anything thrown other than
+// a statement's error, a lost session included, stops the workers and is rethrown.
+ScriptCheckResult checkScript(const std::function<OracleConnection()>& newConnection, std::string_view script,
+                              uint32_t parallelism);
+
+} // namespace sqlplusplus
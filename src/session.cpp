@@ -0,0 +1,518 @@
+#include "session.h"
+
+#include "trace_recorder.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace sqlplusplus {
+namespace {
+
+std::string_view trim(std::string_view text) {
+    const auto first = text.find_first_not_of(" \t");
+    if (first == std::string_view::npos) {
+        return {};
+    }
+    return text.substr(first, text.find_last_not_of(" \t") - first + 1);
+}
+
+// One ALTER SESSION SET per NAME=value pair of a session tag. Values are quoted as string
+// literals, except for the parameters that name a schema or edition.
+std::vector<std::string> sessionTagStatements(std::string_view tag) {
+    std::vector<std::string> statements;
+    while (!tag.empty()) {
+        const auto end = std::min(tag.find(';'), tag.size());
+        const auto property = trim(tag.substr(0, end));
+        tag.remove_prefix(std::min(end + 1, tag.size()));
+        if (property.empty()) {
+            continue;
+        }
+        const auto equals = property.find('=');
+        const auto name = trim(property.substr(0, std::min(equals, property.size())));
+        const auto value = equals == std::string_view::npos ? std::string_view{} : trim(property.substr(equals + 1));
+        const bool validName = !name.empty() && std::all_of(name.begin(), name.end(), [](unsigned char ch) {
+            return std::isalnum(ch) || ch == '_';
+        });
+        if (!validName || value.empty()) {
+            throw std::runtime_error(fmt::format("invalid session tag property \"{}\"", property));
+        }
+
+        std::string upperName(name);
+        std::transform(upperName.begin(), upperName.end(), upperName.begin(),
+                       [](unsigned char ch) { return static_cast<char>(std::toupper(ch)); });
+        if (upperName == "CURRENT_SCHEMA" || upperName == "EDITION") {
+            const bool validValue = std::all_of(value.begin(), value.end(), [](unsigned char ch) {
+                return std::isalnum(ch) || ch == '_' || ch == '$' || ch == '#';
+            });
+            if (!validValue) {
+                throw std::runtime_error(fmt::format("invalid session tag property \"{}\"", property));
+            }
+            statements.push_back(fmt::format("ALTER SESSION SET {} = {}", upperName, value));
+            continue;
+        }
+        std::string quoted;
+        for (auto ch : value) {
+            quoted.push_back(ch);
+            if (ch == '\'') {
+                quoted.push_back(ch);
+            }
+        }
+        statements.push_back(fmt::format("ALTER SESSION SET {} = '{}'", upperName, quoted));
+    }
+    return statements;
+}
+
+} // namespace
+
+Session::~Session() {
+    {
+        std::lock_guard<std::mutex> lk(_healthMutex);
+        _stopping = true;
+    }
+    _healthWake.notify_all();
+    if (_backgroundTask.valid()) {
+        _backgroundTask.wait();
+    }
+    if (_healthThread.joinable()) {
+        _healthThread.join();
+    }
+}
+
+void Session::connectAsync(OracleConnectionOptions opts, ConnectedCallback onConnected) {
+    {
+        std::lock_guard<std::mutex> lk(_deferredMutex);
+        _deferred.reset();
+        _deferredPending.store(false, std::memory_order_release);
+    }
+    auto connectedPromise = std::make_shared<std::promise<void>>();
+    _connected = connectedPromise->get_future().share();
+    _startConnect(std::move(opts), std::move(onConnected), std::move(connectedPromise));
+}
+
+void Session::deferConnect(OracleConnectionOptions opts, ConnectedCallback onConnected, PrepareCallback prepare) {
+    auto connectedPromise = std::make_shared<std::promise<void>>();
+    // Valid up front, so anything waiting before the connect starts waits for it.
+    _connected = connectedPromise->get_future().share();
+    std::lock_guard<std::mutex> lk(_deferredMutex);
+    _deferred.emplace(DeferredConnect{std::move(opts), std::move(onConnected), std::move(prepare),
+                                      std::move(connectedPromise)});
+    _deferredPending.store(true, std::memory_order_release);
+}
+
+void Session::_startDeferredConnect() {
+    std::optional<DeferredConnect> deferred;
+    {
+        std::lock_guard<std::mutex> lk(_deferredMutex);
+        if (!_deferred) {
+            // Another thread got here first; its connect is what _wait() waits for.
+            return;
+        }
+        deferred = std::move(_deferred);
+        _deferred.reset();
+        _deferredPending.store(false, std::memory_order_release);
+    }
+    if (deferred->prepare) {
+        try {
+            deferred->prepare(deferred->opts);
+        } catch (...) {
+            deferred->connected->set_exception(std::current_exception());
+            return;
+        }
+    }
+    _startConnect(std::move(deferred->opts), std::move(deferred->onConnected), std::move(deferred->connected));
+}
+
+void Session::_startConnect(OracleConnectionOptions opts, ConnectedCallback onConnected,
+                            std::shared_ptr<std::promise<void>> connectedPromise) {
+    // Events mode has the client hear of a failed RAC instance from FAN rather than wait
+    // out a TCP timeout, and lets a pool drop the sessions it had there.
+    opts.events = true;
+    _opts = opts;
+    _statementCache.clear();
+    _statementCache.setCapacity(opts.stmtCacheSize.value_or(kDefaultStatementCacheSize));
+    _standbyStatementCache.setCapacity(opts.stmtCacheSize.value_or(kDefaultStatementCacheSize));
+    _backgroundTask = std::async(std::launch::async,
+            [this, connectedPromise = std::move(connectedPromise), opts = std::move(opts), onConnected = std::move(onConnected)] {
+        try {
+            traceRecorder.nameThread("connect");
+            TraceSpan span("connect");
+            _ctx = OracleContext::make(opts.clientConfigDir);
+            if (opts.pool) {
+                auto poolOpts = opts;
+                poolOpts.events = true;
+                // Just the REPL's session to start with; _fillPool() opens the rest in
+                // parallel instead of the pool opening them one after another here.
+                poolOpts.pool->minSessions = std::min<uint32_t>(poolOpts.pool->minSessions, 1);
+                _pool.emplace(OracleConnectionPool::make(_ctx.get(), poolOpts));
+                _conn.emplace(_acquireFromPool(opts.shardingKey));
+            } else {
+                _conn.emplace(OracleConnection::make(_ctx.get(), opts));
+                _applySessionTag(*_conn);
+            }
+        } catch (...) {
+            connectedPromise->set_exception(std::current_exception());
+            return;
+        }
+        connectedPromise->set_value();
+        if (_pool) {
+            try {
+                _fillPool();
+            } catch (const std::exception&) {
+                // The pool opens sessions on demand anyway.
+            }
+        }
+        if (_healthCheckInterval.count() > 0) {
+            _healthThread = std::thread([this] { _healthCheckLoop(); });
+        }
+        if (onConnected) {
+            onConnected(*_conn);
+        }
+    });
+}
+
+void Session::_fillPool() {
+    TraceSpan span("pool warm-up");
+    const auto open = _pool->openCount();
+    const auto wanted = _opts.pool->minSessions;
+    if (open >= wanted) {
+        return;
+    }
+    // Each task holds its session until all of them have one, so they're all new sessions
+    // rather than the same idle one acquired over and over.
+    std::vector<std::future<OracleConnection>> acquiring;
+    for (auto idx = open; idx < wanted; ++idx) {
+        acquiring.push_back(std::async(std::launch::async, [this] { return _acquireFromPool(); }));
+    }
+    std::vector<OracleConnection> acquired;
+    std::exception_ptr error;
+    for (auto& task : acquiring) {
+        try {
+            acquired.push_back(task.get());
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void Session::_healthCheckLoop() {
+    traceRecorder.nameThread("health check");
+    std::unique_lock<std::mutex> lk(_healthMutex);
+    while (!_healthWake.wait_for(lk, _healthCheckInterval, [this] { return _stopping; })) {
+        lk.unlock();
+        try {
+            _checkConnection();
+            if (_pool) {
+                _checkPool();
+            }
+        } catch (const std::exception&) {
+            // Whatever failed is tried again on the next pass.
+        }
+        lk.lock();
+    }
+}
+
+void Session::_checkConnection() {
+    const auto idle = std::chrono::steady_clock::now().time_since_epoch() -
+        std::chrono::nanoseconds(_lastUsed.load(std::memory_order_relaxed));
+    if (idle < _healthCheckInterval || _replacementReady.load(std::memory_order_acquire)) {
+        return;
+    }
+    // A share, so the REPL can swap in a replacement while this one is being pinged.
+    std::optional<OracleConnection> conn;
+    {
+        std::lock_guard<std::mutex> lk(_connMutex);
+        conn.emplace(_conn->share());
+    }
+    try {
+        TraceSpan span("health check ping");
+        conn->ping();
+        return;
+    } catch (const OracleException&) {
+        // Reconnected below; the dead session is dropped when its last reference goes.
+    }
+
+    auto replacement = _replacementConnection();
+    std::lock_guard<std::mutex> lk(_connMutex);
+    _replacement.emplace(std::move(replacement));
+    _replacementReady.store(true, std::memory_order_release);
+}
+
+OracleConnection Session::_replacementConnection() {
+    // setShardingKey() may change it while the health thread is here.
+    OracleShardingKey shardingKey;
+    {
+        std::lock_guard<std::mutex> lk(_connMutex);
+        shardingKey = _opts.shardingKey;
+    }
+    if (!_pool) {
+        auto opts = _opts;
+        opts.shardingKey = std::move(shardingKey);
+        auto conn = OracleConnection::make(_ctx.get(), opts);
+        _applySessionTag(conn);
+        return conn;
+    }
+    // Idle sessions on a failed instance are dropped once FAN reports it down, but one
+    // borrowed before that would fail the same way, so each is pinged first. Dead ones
+    // are dropped as they go, and by the last try the pool has to open a new one.
+    const auto tries = _opts.pool->maxSessions + 1;
+    for (uint32_t attempt = 1;; ++attempt) {
+        auto conn = _acquireFromPool(shardingKey);
+        if (attempt == tries || conn.isNewSession()) {
+            return conn;
+        }
+        try {
+            conn.ping();
+            return conn;
+        } catch (const OracleException& e) {
+            if (!e.isSessionLost()) {
+                throw;
+            }
+        }
+    }
+}
+
+void Session::setShardingKey(OracleShardingKey key) {
+    _wait();
+    {
+        std::lock_guard<std::mutex> lk(_connMutex);
+        _opts.shardingKey = std::move(key);
+    }
+    replaceLostConnection();
+}
+
+OracleShardingKey Session::shardingKey() {
+    std::lock_guard<std::mutex> lk(_connMutex);
+    return _opts.shardingKey;
+}
+
+void Session::replaceLostConnection() {
+    _wait();
+    auto replacement = _replacementConnection();
+    std::lock_guard<std::mutex> lk(_connMutex);
+    _conn = std::move(replacement);
+    _replacement.reset();
+    _replacementReady.store(false, std::memory_order_relaxed);
+    _statementCache.clear();
+}
+
+void Session::dropStandbyConnection() {
+    std::lock_guard<std::mutex> lk(_standbyMutex);
+    _standbyStatementCache.clear();
+    _standbyConn.reset();
+}
+
+void Session::_checkPool() {
+    TraceSpan span("pool health check");
+    const auto idle = _pool->openCount() - std::min(_pool->openCount(), _pool->busyCount());
+    std::vector<OracleConnection> held;
+    for (uint32_t idx = 0; idx < idle; ++idx) {
+        // Any tag, so tagged sessions are checked too; they're released with the tag they had.
+        if (_opts.pool->homogeneous) {
+            held.push_back(_pool->acquireConnection({}, {}, {}, true));
+        } else if (!_opts.proxyUser.empty()) {
+            held.push_back(_pool->acquireConnection(_opts.proxyUser, {}, {}, true));
+        } else {
+            held.push_back(_pool->acquireConnection(_opts.username, _opts.password, {}, true));
+        }
+        if (held.back().isNewSession()) {
+            // The pool had fewer idle sessions than it reported by now.
+            break;
+        }
+    }
+    for (auto& conn : held) {
+        try {
+            conn.ping();
+        } catch (const OracleException&) {
+            try {
+                conn.drop();
+            } catch (const OracleException&) {
+                // Released, and dropped as dead, with the rest.
+            }
+        }
+    }
+    held.clear();
+    _fillPool();
+}
+
+void Session::_wait() {
+    if (_deferredPending.load(std::memory_order_acquire)) {
+        _startDeferredConnect();
+    }
+    if (!_connected.valid()) {
+        throw OracleException("not connected to a database");
+    }
+    // Rethrows whatever the background connect threw.
+    _connected.get();
+}
+
+OracleConnection& Session::connection() {
+    _wait();
+    if (_replacementReady.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lk(_connMutex);
+        _conn = std::move(_replacement);
+        _replacement.reset();
+        _replacementReady.store(false, std::memory_order_relaxed);
+        // What was cached was prepared on the dead session.
+        _statementCache.clear();
+    }
+    _lastUsed.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    return *_conn;
+}
+
+OracleContext* Session::context() {
+    _wait();
+    return _ctx.get();
+}
+
+OracleConnection Session::newConnection(bool events) {
+    _wait();
+    if (_pool) {
+        return _acquireFromPool();
+    }
+    auto opts = _opts;
+    opts.events = events;
+    // The sharding key routes the REPL's own session; background work spans shards.
+    opts.shardingKey = {};
+    auto conn = OracleConnection::make(_ctx.get(), opts);
+    _applySessionTag(conn);
+    return conn;
+}
+
+OracleConnection Session::newConnectionAs(std::string_view proxyUser) {
+    _wait();
+    if (_pool) {
+        return _acquireFrom(*_pool, _opts.pool->homogeneous, {}, proxyUser);
+    }
+    auto opts = _opts;
+    opts.proxyUser = std::string(proxyUser);
+    opts.shardingKey = {};
+    auto conn = OracleConnection::make(_ctx.get(), opts);
+    _applySessionTag(conn);
+    return conn;
+}
+
+OracleConnection Session::newConnectionTo(std::string_view connString) {
+    _wait();
+    auto opts = _opts;
+    opts.connString = std::string(connString);
+    opts.shardingKey = {};
+    opts.pool.reset();
+    opts.events = false;
+    auto conn = OracleConnection::make(_ctx.get(), opts);
+    _applySessionTag(conn);
+    return conn;
+}
+
+OracleConnection& Session::standbyConnection() {
+    _wait();
+    if (_standbyConnString.empty()) {
+        throw std::runtime_error("no standby is configured; start with --standby");
+    }
+    if (!_standbyConn) {
+        auto opts = _opts;
+        opts.connString = _standbyConnString;
+        opts.events = false;
+        opts.shardingKey = {};
+        if (!opts.pool) {
+            opts.pool.emplace();
+        }
+        auto pool = OracleConnectionPool::make(_ctx.get(), opts);
+        auto conn = _acquireFrom(pool, opts.pool->homogeneous, {}, _opts.proxyUser);
+        std::lock_guard<std::mutex> lk(_standbyMutex);
+        _standbyPool.emplace(std::move(pool));
+        _standbyConn.emplace(std::move(conn));
+    }
+    return *_standbyConn;
+}
+
+OracleConnection Session::_acquireFromPool(const OracleShardingKey& shardingKey) {
+    return _acquireFrom(*_pool, _opts.pool->homogeneous, shardingKey, _opts.proxyUser);
+}
+
+OracleConnection Session::_acquireFrom(OracleConnectionPool& pool, bool homogeneous,
+                                       const OracleShardingKey& shardingKey, std::string_view proxyUser) {
+    if (homogeneous && !proxyUser.empty()) {
+        throw std::runtime_error("proxy authentication needs a heterogeneous pool; start with --poolHeterogeneous");
+    }
+    // Proxy sessions are acquired with the end user's name and no password.
+    auto conn = homogeneous ? pool.acquireConnection({}, {}, _opts.sessionTag, false, shardingKey)
+        : !proxyUser.empty() ? pool.acquireConnection(proxyUser, {}, _opts.sessionTag, false, shardingKey)
+        : pool.acquireConnection(_opts.username, _opts.password, _opts.sessionTag, false, shardingKey);
+    // Pooled sessions may have been tagged by whoever had them last.
+    conn.applyTags(_opts);
+    if (!_opts.sessionTag.empty() && conn.sessionTag() != _opts.sessionTag) {
+        // With a fixup procedure the server has set the session up as it was acquired.
+        if (!_opts.pool || _opts.pool->plsqlFixupCallback.empty()) {
+            _applySessionTag(conn);
+        }
+        conn.setReleaseTag(_opts.sessionTag);
+    }
+    return conn;
+}
+
+void Session::_applySessionTag(OracleConnection& conn) const {
+    for (const auto& sql : sessionTagStatements(_opts.sessionTag)) {
+        conn.prepareStatement(sql).execute();
+    }
+}
+
+OracleStatement Session::prepareStatement(std::string_view sql) {
+    return _statementCache.prepare(connection(), sql);
+}
+
+OracleStatement Session::prepareScrollableStatement(std::string_view sql) {
+    return connection().prepareStatement(sql, true);
+}
+
+OracleStatement Session::prepareStandbyStatement(std::string_view sql, bool scrollable) {
+    auto& conn = standbyConnection();
+    return scrollable ? conn.prepareStatement(sql, true) : _standbyStatementCache.prepare(conn, sql);
+}
+
+void Session::breakExecution() {
+    if (isReady()) {
+        _conn->breakExecution();
+    }
+    std::lock_guard<std::mutex> lk(_standbyMutex);
+    if (_standbyConn) {
+        _standbyConn->breakExecution();
+    }
+}
+
+bool Session::isReady() const {
+    return _connected.valid() &&
+        _connected.wait_for(std::chrono::seconds(0)) == std::future_status::ready &&
+        !hasFailed();
+}
+
+std::optional<Session::PoolUsage> Session::poolUsage() const {
+    if (!isReady() || !_pool) {
+        return std::nullopt;
+    }
+    return PoolUsage{_pool->openCount(), _pool->busyCount(), _opts.pool->maxSessions};
+}
+
+bool Session::hasFailed() const {
+    if (!_connected.valid() ||
+            _connected.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return false;
+    }
+    try {
+        _connected.get();
+    } catch (...) {
+        return true;
+    }
+    return false;
+}
+
+} // namespace sqlplusplus
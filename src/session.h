@@ -0,0 +1,223 @@
+#pragma once
+
+#include "oracle_helpers.h"
+#include "statement_cache.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace sqlplusplus {
+
+// The REPL's database session. connectAsync() creates the Oracle context and connection on
+// a background thread, so the prompt comes up while the client libraries load and the
+// login round trips happen. Anything that needs the database calls connection(), which
+// waits for the connect to finish and rethrows the connect error if there was one.
+// deferConnect() puts even that off until something first needs the database, so --help
+// and offline work like .open never load the client libraries or ask for a password.
+// ODPI serializes calls on a connection, so the connected callback can keep using it
+// while the REPL runs statements.
+//
+// If the options ask for a pool, the REPL's connection and every newConnection() are
+// sessions borrowed from it, so background work doesn't pay for a fresh login. The pool
+// is created in events mode so borrowed sessions can host change notifications. With the
+// options' proxyUser set, every session is that user's through the login's proxy
+// authentication, and newConnectionAs() gets one for any other user the login may proxy
+// for, so a heterogeneous pool's sessions can be shared by many users under their own
+// identities.
+//
+// Every connection is set up with the options' sessionTag. Pooled sessions are requested
+// with it as their tag, and only the ones that come back without it run its ALTER SESSION
+// statements, after which they're released with it for the next acquire. When the pool has
+// a PL/SQL fixup callback, the server runs that instead as part of the acquire, and the
+// client sends nothing of its own.
+//
+// A pool is created with one session, for the REPL's connection, and the rest of its
+// minimum is opened in parallel once that's up. With health checks on, a background thread
+// pings the REPL's connection once it's been idle an interval and quietly reconnects it if
+// the session is gone, e.g. to a firewall's idle timeout, so the next statement doesn't
+// stall on a dead socket. The pool's idle sessions are pinged on the same schedule, dead
+// ones dropped, and the pool topped back up to its minimum.
+//
+// With a standby set, read-only work can go to an Active Data Guard standby instead: it
+// gets a pool of its own, with the primary's pool settings and the same credentials and
+// tags, created the first time standbyConnection() is called.
+class Session {
+public:
+    // Runs on the background thread once the connection is up, e.g. to warm caches. It
+    // must handle its own errors.
+    using ConnectedCallback = std::function<void(OracleConnection&)>;
+    // Runs on the thread that first needs the database, before a deferred connect starts,
+    // e.g. to prompt for the password. What it throws is the connect error.
+    using PrepareCallback = std::function<void(OracleConnectionOptions&)>;
+
+    Session() = default;
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+    ~Session();
+
+    // Zero, the default, turns health checks off. Takes effect on the next connectAsync().
+    void setHealthCheckInterval(std::chrono::seconds interval) noexcept {
+        _healthCheckInterval = interval;
+    }
+
+    // The standby's connect string; empty, the default, has no standby. Set it before
+    // connectAsync().
+    void setStandby(std::string connString) {
+        _standbyConnString = std::move(connString);
+    }
+    bool hasStandby() const noexcept {
+        return !_standbyConnString.empty();
+    }
+
+    void connectAsync(OracleConnectionOptions opts, ConnectedCallback onConnected = nullptr);
+    // Like connectAsync(), but nothing happens until the first call that waits for the
+    // connect, which runs prepare and then starts it. Until then isReady() and hasFailed()
+    // are both false.
+    void deferConnect(OracleConnectionOptions opts, ConnectedCallback onConnected = nullptr,
+                      PrepareCallback prepare = nullptr);
+
+    OracleConnection& connection();
+    OracleContext* context();
+
+    // Opens another connection with the same credentials, for work that shouldn't queue
+    // behind the REPL's statements, borrowing it from the pool if there is one. Waits for
+    // the initial connect like connection(). Pass events to get a connection that can host
+    // change notification subscriptions.
+    OracleConnection newConnection(bool events = false);
+    // Like newConnection(), but logged in as proxyUser through the session's login's proxy
+    // authentication, e.g. for a broker client with a database user of their own. Pooled
+    // sessions come from the same pool, which has to be heterogeneous; throws
+    // std::runtime_error if it isn't.
+    OracleConnection newConnectionAs(std::string_view proxyUser);
+    // Opens a standalone connection to another database with the session's credentials and
+    // tags. Waits for the initial connect, whose context it shares.
+    OracleConnection newConnectionTo(std::string_view connString);
+    // The REPL's session on the standby, borrowed from the standby's pool the first time
+    // it's needed and kept after. Throws std::runtime_error when there's no standby.
+    OracleConnection& standbyConnection();
+
+    // Prepares sql on the session's connection through the statement cache, which is sized
+    // like OCI's from OracleConnectionOptions::stmtCacheSize.
+    OracleStatement prepareStatement(std::string_view sql);
+    // Scrollable statements hold server-side cursor state, so they're prepared fresh rather
+    // than coming from the statement cache.
+    OracleStatement prepareScrollableStatement(std::string_view sql);
+    // Prepares sql on the standby, through a statement cache of its own unless it's
+    // scrollable.
+    OracleStatement prepareStandbyStatement(std::string_view sql, bool scrollable = false);
+    const StatementCache& statementCache() const noexcept {
+        return _statementCache;
+    }
+    // Takes stmt out of the statement cache, for results that are kept open while the same
+    // SQL may be run again.
+    void detachStatement(const OracleStatement& stmt) {
+        _statementCache.detach(stmt);
+        _standbyStatementCache.detach(stmt);
+    }
+
+    // Swaps in a new session for the REPL's connection once a statement has failed with an
+    // error that lost it (OracleException::isSessionLost()), rather than waiting for the
+    // health check, and clears the statement cache prepared on it. Whatever the old session
+    // hadn't committed is gone with it.
+    void replaceLostConnection();
+    // Routes the REPL's connection by key from now on, replacing its session with one on
+    // the shard that owns the key like replaceLostConnection(); an empty key goes back to
+    // connecting through the shard catalog. Background connections never take the key.
+    void setShardingKey(OracleShardingKey key);
+    OracleShardingKey shardingKey();
+    // Forgets a lost standby session, so the next standbyConnection() borrows another.
+    void dropStandbyConnection();
+
+    // Interrupts the statement running on the session's connection, and on its standby
+    // connection, if they're connected.
+    // Doesn't wait, so it can be called while another thread is blocked in that statement.
+    void breakExecution();
+
+    // Non-blocking checks on the state of the background connect.
+    bool isReady() const;
+    bool hasFailed() const;
+
+    struct PoolUsage {
+        uint32_t open = 0;
+        uint32_t busy = 0;
+        uint32_t max = 0;
+    };
+    // How much of the pool is in use right now, or nullopt without one or before the
+    // connect is done. Safe to call from any thread once connectAsync() has returned.
+    std::optional<PoolUsage> poolUsage() const;
+
+private:
+    // The REPL's own sessions pass the options' sharding key; the rest go without.
+    OracleConnection _acquireFromPool(const OracleShardingKey& shardingKey = {});
+    // As proxyUser through the login, if it's not empty.
+    OracleConnection _acquireFrom(OracleConnectionPool& pool, bool homogeneous,
+                                  const OracleShardingKey& shardingKey, std::string_view proxyUser);
+    // A session to replace the REPL's with, checked to be alive when it's from the pool.
+    OracleConnection _replacementConnection();
+    // Runs the ALTER SESSION statements of _opts.sessionTag on conn.
+    void _applySessionTag(OracleConnection& conn) const;
+    // Opens pool sessions in parallel until it has its minimum.
+    void _fillPool();
+    void _healthCheckLoop();
+    void _checkConnection();
+    void _checkPool();
+
+    // Matches OCI's default statement cache size.
+    static constexpr size_t kDefaultStatementCacheSize = 20;
+
+    struct DeferredConnect {
+        OracleConnectionOptions opts;
+        ConnectedCallback onConnected;
+        PrepareCallback prepare;
+        std::shared_ptr<std::promise<void>> connected;
+    };
+
+    // Starts the deferred connect, if it hasn't been, then waits for the connect.
+    void _wait();
+    void _startDeferredConnect();
+    void _startConnect(OracleConnectionOptions opts, ConnectedCallback onConnected,
+                       std::shared_ptr<std::promise<void>> connected);
+
+    OracleConnectionOptions _opts;
+    std::unique_ptr<OracleContext> _ctx;
+    std::optional<OracleConnectionPool> _pool;
+    std::optional<OracleConnection> _conn;
+    // Ready as soon as the connection is up; the connected callback may still be running.
+    std::shared_future<void> _connected;
+    std::future<void> _backgroundTask;
+    // Set by deferConnect() until the first _wait() takes it.
+    std::mutex _deferredMutex;
+    std::optional<DeferredConnect> _deferred;
+    std::atomic<bool> _deferredPending{false};
+    StatementCache _statementCache{kDefaultStatementCacheSize};
+
+    std::chrono::seconds _healthCheckInterval{0};
+    // Steady clock nanoseconds of the last connection() call.
+    std::atomic<int64_t> _lastUsed{0};
+    // Guards swapping in a replacement for _conn against the health thread copying it.
+    std::mutex _connMutex;
+    std::optional<OracleConnection> _replacement;
+    std::atomic<bool> _replacementReady{false};
+    std::mutex _healthMutex;
+    std::condition_variable _healthWake;
+    bool _stopping = false;
+    std::thread _healthThread;
+
+    std::string _standbyConnString;
+    // Guards setting up the standby connection against breakExecution() reading it.
+    std::mutex _standbyMutex;
+    std::optional<OracleConnectionPool> _standbyPool;
+    std::optional<OracleConnection> _standbyConn;
+    StatementCache _standbyStatementCache{kDefaultStatementCacheSize};
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,52 @@
+#include "session_executor.h"
+
+#include <utility>
+
+namespace sqlplusplus {
+
+SessionExecutor::SessionExecutor() {
+    _thread = std::thread([this] { _run(); });
+}
+
+SessionExecutor::~SessionExecutor() {
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _stopping = true;
+    }
+    _cv.notify_one();
+    _thread.join();
+}
+
+void SessionExecutor::_push(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _tasks.push_back(std::move(task));
+    }
+    _cv.notify_one();
+}
+
+void SessionExecutor::_run() {
+    std::unique_lock<std::mutex> lk(_mutex);
+    for (;;) {
+        _cv.wait(lk, [this] { return _stopping || !_tasks.empty(); });
+        if (_tasks.empty()) {
+            return;
+        }
+        auto task = std::move(_tasks.front());
+        _tasks.pop_front();
+        lk.unlock();
+        // Errors land in the task's future.
+        task();
+        lk.lock();
+    }
+}
+
+std::future<void> executeAsync(SessionExecutor& executor, OracleStatement& stmt) {
+    return executor.submit([&stmt] { stmt.execute(); });
+}
+
+std::future<OracleFetchBlock> fetchBlockAsync(SessionExecutor& executor, OracleStatement& stmt, uint32_t maxRows) {
+    return executor.submit([&stmt, maxRows] { return stmt.fetchBlock(maxRows); });
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+namespace sqlplusplus {
+
+// A thread of its own for one session's blocking ODPI calls, which run one at a time and
+// in the order they were submitted, as calls on a connection have to. The caller gets a
+// future for each and carries on, so whatever drives several sessions (fan-out, parallel
+// exports, benchmarks) can have them all in flight from one thread instead of a thread
+// of its own per session each time.
+//
+// The destructor finishes what's queued before it returns.
+class SessionExecutor {
+public:
+    SessionExecutor();
+    SessionExecutor(const SessionExecutor&) = delete;
+    SessionExecutor& operator=(const SessionExecutor&) = delete;
+    ~SessionExecutor();
+
+    // Runs fn on the session's thread; the future has its result or what it threw.
+    template <typename Fn>
+    std::future<std::invoke_result_t<Fn&>> submit(Fn fn) {
+        auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Fn&>()>>(std::move(fn));
+        auto result = task->get_future();
+        _push([task] { (*task)(); });
+        return result;
+    }
+
+private:
+    void _push(std::function<void()> task);
+    void _run();
+
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::deque<std::function<void()>> _tasks;
+    bool _stopping = false;
+    std::thread _thread;
+};
+
+// The statement's round trips on its session's executor. stmt has to outlive the future,
+// and a block's values stay valid until the next fetch, as they do fetching directly.
+std::future<void> executeAsync(SessionExecutor& executor, OracleStatement& stmt);
+std::future<OracleFetchBlock> fetchBlockAsync(SessionExecutor& executor, OracleStatement& stmt, uint32_t maxRows);
+
+} // namespace sqlplusplus
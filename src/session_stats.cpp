@@ -0,0 +1,99 @@
+#include "session_stats.h"
+
+#include "session.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <ostream>
+#include <string>
+
+namespace sqlplusplus {
+namespace {
+
+const std::string& statsQuery() {
+    static const std::string query = [] {
+        fmt::memory_buffer sql;
+        fmt::format_to(sql,
+                "select n.name, cast(s.value as number(18)) from v$mystat s "
+                "join v$statname n on n.statistic# = s.statistic# where n.name in (");
+        for (size_t idx = 0; idx < SessionStats::kNames.size(); ++idx) {
+            fmt::format_to(sql, "{}'{}'", idx == 0 ? "" : ", ", SessionStats::kNames[idx]);
+        }
+        fmt::format_to(sql, ")");
+        return fmt::to_string(sql);
+    }();
+    return query;
+}
+
+// A process's sessions share its cache, whose id is the sessions' CLIENT_REGID.
+constexpr std::string_view kClientResultCacheSql = R"(
+SELECT st.name, CAST(st.value AS NUMBER(18))
+  FROM v$client_result_cache_stats st
+ WHERE st.cache_id = (SELECT MAX(ci.client_regid)
+                        FROM v$session_connect_info ci
+                       WHERE ci.sid = SYS_CONTEXT('USERENV', 'SID'))
+   AND st.name IN ('Find Count', 'Create Count Success', 'Invalidation Count'))";
+
+} // namespace
+
+std::optional<ClientResultCacheStats> ClientResultCacheStats::snapshot(Session& session) {
+    auto stmt = session.prepareStatement(kClientResultCacheSql);
+    stmt.setPrefetchRows(4);
+    stmt.setFetchArraySize(4);
+    stmt.execute();
+
+    std::optional<ClientResultCacheStats> stats;
+    while (stmt.fetch()) {
+        if (!stats) {
+            stats.emplace();
+        }
+        const auto name = stmt.getColumnValue(1).as<std::string_view>();
+        const auto value = stmt.getColumnValue(2).as<int64_t>();
+        if (name == "Find Count") {
+            stats->hits = value;
+        } else if (name == "Create Count Success") {
+            stats->created = value;
+        } else if (name == "Invalidation Count") {
+            stats->invalidated = value;
+        }
+    }
+    return stats;
+}
+
+SessionStats SessionStats::snapshot(Session& session) {
+    auto stmt = session.prepareStatement(statsQuery());
+    // Everything comes back with the execute.
+    stmt.setPrefetchRows(kNames.size() + 1);
+    stmt.setFetchArraySize(kNames.size() + 1);
+    stmt.execute();
+
+    SessionStats stats;
+    while (stmt.fetch()) {
+        auto name = stmt.getColumnValue(1).as<std::string_view>();
+        auto it = std::find(kNames.begin(), kNames.end(), name);
+        if (it != kNames.end()) {
+            stats._values[static_cast<size_t>(it - kNames.begin())] = stmt.getColumnValue(2).as<int64_t>();
+        }
+    }
+    return stats;
+}
+
+SessionStats SessionStats::since(const SessionStats& before, const SessionStats& overhead) const {
+    SessionStats delta;
+    for (size_t idx = 0; idx < _values.size(); ++idx) {
+        delta._values[idx] = std::max<int64_t>(_values[idx] - before._values[idx] - overhead._values[idx], 0);
+    }
+    return delta;
+}
+
+void printSessionStats(std::ostream& out, const SessionStats& stats) {
+    fmt::memory_buffer buf;
+    fmt::format_to(buf, "Statistics\n----------------------------------------------------------\n");
+    for (size_t idx = 0; idx < SessionStats::kNames.size(); ++idx) {
+        fmt::format_to(buf, "{:>12}  {}\n", stats.value(idx), SessionStats::kNames[idx]);
+    }
+    out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+}
+
+} // namespace sqlplusplus
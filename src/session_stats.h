@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <string_view>
+
+namespace sqlplusplus {
+
+class Session;
+
+// The session's own V$MYSTAT counters that autotrace reports on.
+class SessionStats {
+public:
+    static constexpr std::array<std::string_view, 10> kNames = {
+        "recursive calls",
+        "db block gets",
+        "consistent gets",
+        "physical reads",
+        "redo size",
+        "bytes sent via SQL*Net to client",
+        "bytes received via SQL*Net from client",
+        "SQL*Net roundtrips to/from client",
+        "sorts (memory)",
+        "sorts (disk)",
+    };
+
+    // Reads the counters on the session's own connection, since V$MYSTAT only describes
+    // the session querying it. The query comes from the statement cache and is fetched in
+    // one round trip. Throws OracleException without access to V$MYSTAT and V$STATNAME.
+    static SessionStats snapshot(Session& session);
+
+    // The counters' growth from before to this snapshot, less overhead (e.g. the growth
+    // between two back to back snapshots), clamped at zero.
+    SessionStats since(const SessionStats& before, const SessionStats& overhead) const;
+
+    int64_t value(size_t idx) const noexcept {
+        return _values[idx];
+    }
+
+private:
+    std::array<int64_t, kNames.size()> _values{};
+};
+
+// What this process's client result cache has reported to the server, from
+// V$CLIENT_RESULT_CACHE_STATS. The client sends them every CLIENT_RESULT_CACHE_LAG
+// milliseconds, so they trail the cache by up to that.
+struct ClientResultCacheStats {
+    // Executes answered from the cache.
+    int64_t hits = 0;
+    // Results put in the cache.
+    int64_t created = 0;
+    // Results dropped because a table they came from changed.
+    int64_t invalidated = 0;
+
+    // nullopt when the session has no client result cache, e.g. with the server's
+    // CLIENT_RESULT_CACHE_SIZE at 0 and nothing in the client's sqlnet.ora. Throws
+    // OracleException without access to the V$ views.
+    static std::optional<ClientResultCacheStats> snapshot(Session& session);
+};
+
+// Writes stats in sqlplus's autotrace layout: a right-aligned value and the name, one per
+// line.
+void printSessionStats(std::ostream& out, const SessionStats& stats);
+
+} // namespace sqlplusplus
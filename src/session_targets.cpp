@@ -0,0 +1,74 @@
+#include "session_targets.h"
+
+#include "fmt/format.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace sqlplusplus {
+
+SessionTarget& SessionTargets::add(std::unique_ptr<SessionTarget> target) {
+    if (find(target->name) != nullptr) {
+        throw std::runtime_error(fmt::format("there's already a connection named {}", target->name));
+    }
+    std::lock_guard<std::mutex> lk(_mutex);
+    auto& added = *_targets.emplace_back(std::move(target));
+    if (_current == nullptr) {
+        _current = &added;
+        _currentSession.store(added.session, std::memory_order_release);
+    }
+    return added;
+}
+
+SessionTarget* SessionTargets::find(std::string_view name) noexcept {
+    for (auto& target : _targets) {
+        if (target->name == name) {
+            return target.get();
+        }
+    }
+    return nullptr;
+}
+
+SessionTarget& SessionTargets::use(std::string_view name) {
+    auto* target = find(name);
+    if (target == nullptr) {
+        throw std::runtime_error(fmt::format("no connection named {}; .connect {} <connect string> first",
+                                             name, name));
+    }
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (target == _current) {
+        return *target;
+    }
+    // The current target's parked entries are empty, so this parks its descriptions and
+    // leaves the active cache empty for the new target's.
+    _current->parkedDescriptions.swapEntries(_activeDescriptions);
+    target->parkedDescriptions.swapEntries(_activeDescriptions);
+    _current = target;
+    _currentSession.store(target->session, std::memory_order_release);
+    return *target;
+}
+
+void SessionTargets::invalidate(SessionTarget& target, std::string_view owner, std::string_view name) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (&target == _current) {
+        _activeDescriptions.invalidate(owner, name);
+    } else {
+        target.parkedDescriptions.invalidate(owner, name);
+    }
+}
+
+void SessionTargets::clear() {
+    std::vector<std::unique_ptr<SessionTarget>> targets;
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        targets.swap(_targets);
+        _current = nullptr;
+        _currentSession.store(nullptr, std::memory_order_release);
+    }
+    // Schema indexes load on connections from their sessions, so they go first.
+    for (auto& target : targets) {
+        target->schemaIndex.reset();
+    }
+}
+
+} // namespace sqlplusplus
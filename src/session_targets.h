@@ -0,0 +1,82 @@
+#pragma once
+
+#include "describe_cache.h"
+#include "schema_index.h"
+#include "session.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+// A database the REPL keeps a session, and that session's pool, open to under a name,
+// along with the metadata cached for it.
+struct SessionTarget {
+    std::string name;
+    // As it was connected to, for listing.
+    std::string username;
+    std::string connString;
+    // Null for the session the REPL started with, which main owns.
+    std::unique_ptr<Session> ownedSession;
+    Session* session = nullptr;
+    std::unique_ptr<SchemaIndex> schemaIndex;
+    // Whether the current schema has been asked of schemaIndex yet.
+    bool schemaRequested = false;
+    // This target's describe cache entries while another target's are in use.
+    DescribeCache parkedDescriptions;
+};
+
+// The named targets the REPL can switch between with .use, every one connected and warm
+// while another is in use, so switching costs no more than swapping which one statements
+// go to. Only the current target's descriptions are in the active describe cache; the
+// rest are set aside in their own targets until they're switched back to.
+class SessionTargets {
+public:
+    explicit SessionTargets(DescribeCache& activeDescriptions) : _activeDescriptions(activeDescriptions) {}
+    SessionTargets(const SessionTargets&) = delete;
+    SessionTargets& operator=(const SessionTargets&) = delete;
+
+    // The first target added becomes the current one. Throws std::runtime_error if there's
+    // already a target named target->name.
+    SessionTarget& add(std::unique_ptr<SessionTarget> target);
+    SessionTarget* find(std::string_view name) noexcept;
+
+    // Null until a target's been added, and after clear().
+    SessionTarget* current() noexcept {
+        return _current;
+    }
+    // The current target's session. Safe to call from any thread, e.g. to cancel what's
+    // running on it.
+    Session* currentSession() const noexcept {
+        return _currentSession.load(std::memory_order_acquire);
+    }
+    // Makes name the current target, exchanging the describe cache entries. Throws
+    // std::runtime_error if there's no such target.
+    SessionTarget& use(std::string_view name);
+
+    // Drops owner.name from target's describe cache entries, wherever they are at the
+    // time. Safe to call from any thread.
+    void invalidate(SessionTarget& target, std::string_view owner, std::string_view name);
+
+    // In the order they were added.
+    const std::vector<std::unique_ptr<SessionTarget>>& targets() const noexcept {
+        return _targets;
+    }
+
+    // Closes every target's session and schema index but the session main owns.
+    void clear();
+
+private:
+    DescribeCache& _activeDescriptions;
+    // Held while the describe cache entries move between targets.
+    std::mutex _mutex;
+    std::vector<std::unique_ptr<SessionTarget>> _targets;
+    SessionTarget* _current = nullptr;
+    std::atomic<Session*> _currentSession{nullptr};
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,142 @@
+#include "spill_file.h"
+
+#include "fmt/format.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace sqlplusplus {
+namespace {
+
+uint32_t readU32(const char* ptr) noexcept {
+    uint32_t value;
+    std::memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+} // namespace
+
+void SpillBatchBuilder::addRow(const std::string_view* cells) {
+    for (uint32_t col = 0; col < _numColumns; ++col) {
+        if (_values.data().size() + cells[col].size() > UINT32_MAX) {
+            throw std::runtime_error("spill batch is too big");
+        }
+        _ids.push_back(_values.add(cells[col]));
+    }
+}
+
+SpilledBatch::SpilledBatch(void* mapping, size_t mappingSize, const char* batch)
+    : _mapping(mapping),
+      _mappingSize(mappingSize),
+      _numRows(readU32(batch)),
+      _numColumns(readU32(batch + sizeof(uint32_t)))
+{
+    const auto numValues = readU32(batch + 2 * sizeof(uint32_t));
+    _ids = batch + SpillBatchBuilder::kHeaderBytes;
+    _ends = _ids + static_cast<size_t>(_numRows) * _numColumns * sizeof(uint32_t);
+    _data = _ends + static_cast<size_t>(numValues) * sizeof(uint32_t);
+}
+
+SpilledBatch::SpilledBatch(SpilledBatch&& other) noexcept
+    : _mapping(std::exchange(other._mapping, nullptr)),
+      _mappingSize(std::exchange(other._mappingSize, 0)),
+      _ids(other._ids),
+      _ends(other._ends),
+      _data(other._data),
+      _numRows(std::exchange(other._numRows, 0)),
+      _numColumns(std::exchange(other._numColumns, 0))
+{}
+
+SpilledBatch& SpilledBatch::operator=(SpilledBatch&& other) noexcept {
+    if (this != &other) {
+        if (_mapping != nullptr) {
+            ::munmap(_mapping, _mappingSize);
+        }
+        _mapping = std::exchange(other._mapping, nullptr);
+        _mappingSize = std::exchange(other._mappingSize, 0);
+        _ids = other._ids;
+        _ends = other._ends;
+        _data = other._data;
+        _numRows = std::exchange(other._numRows, 0);
+        _numColumns = std::exchange(other._numColumns, 0);
+    }
+    return *this;
+}
+
+SpilledBatch::~SpilledBatch() {
+    if (_mapping != nullptr) {
+        ::munmap(_mapping, _mappingSize);
+    }
+}
+
+std::string_view SpilledBatch::cell(uint32_t row, uint32_t col) const noexcept {
+    const auto id = readU32(_ids + (static_cast<size_t>(row) * _numColumns + col) * sizeof(uint32_t));
+    const auto begin = id == 0 ? 0 : readU32(_ends + (id - 1) * sizeof(uint32_t));
+    const auto end = readU32(_ends + id * sizeof(uint32_t));
+    return std::string_view(_data + begin, end - begin);
+}
+
+SpillFile::SpillFile(std::string_view purpose) {
+    const char* dir = std::getenv("TMPDIR");
+    std::string path = fmt::format("{}/sqlplusplus-{}-XXXXXX", dir != nullptr && *dir != '\0' ? dir : "/tmp", purpose);
+    _fd = ::mkstemp(path.data());
+    if (_fd == -1) {
+        throw std::system_error(errno, std::generic_category(), "error creating spill file in " + path);
+    }
+    // The open fd keeps the file around until it's closed, however that happens.
+    ::unlink(path.c_str());
+}
+
+SpillFile::~SpillFile() {
+    ::close(_fd);
+}
+
+void SpillFile::_write(const char* data, size_t size) {
+    while (size > 0) {
+        auto rc = ::write(_fd, data, size);
+        if (rc == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "error writing spill file");
+        }
+        data += rc;
+        size -= static_cast<size_t>(rc);
+        _size += static_cast<uint64_t>(rc);
+    }
+}
+
+SpillFile::Extent SpillFile::append(const SpillBatchBuilder& batch) {
+    Extent extent;
+    extent.offset = _size;
+    extent.numRows = batch.numRows();
+    const auto& values = batch._values;
+    const uint32_t header[] = {extent.numRows, batch.numColumns(), values.size()};
+    _write(reinterpret_cast<const char*>(header), sizeof(header));
+    _write(reinterpret_cast<const char*>(batch._ids.data()), batch._ids.size() * sizeof(uint32_t));
+    _write(reinterpret_cast<const char*>(values.ends().data()), values.ends().size() * sizeof(uint32_t));
+    _write(values.data().data(), values.data().size());
+    extent.length = _size - extent.offset;
+    return extent;
+}
+
+SpilledBatch SpillFile::map(const Extent& extent) const {
+    // Mappings start on a page boundary, so the batch sits some way into its mapping.
+    static const auto pageSize = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+    const auto start = extent.offset - extent.offset % pageSize;
+    const auto size = static_cast<size_t>(extent.offset + extent.length - start);
+    auto mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, _fd, static_cast<off_t>(start));
+    if (mapping == MAP_FAILED) {
+        throw std::system_error(errno, std::generic_category(), "error mapping spill file");
+    }
+    return SpilledBatch(mapping, size, static_cast<const char*>(mapping) + (extent.offset - start));
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "string_dictionary.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+// Rows of formatted cells laid out the way they're spilled: the row, column and value
+// counts, the id of every cell's value in row order, the end offset of every value, then
+// the bytes of the values back to back. Repeated values are stored once per batch, and any
+// cell can be found from a mapping of the batch without decoding the ones before it.
+class SpillBatchBuilder {
+public:
+    explicit SpillBatchBuilder(uint32_t numColumns) :
+        _numColumns(numColumns)
+    {}
+
+    // Takes numColumns cells.
+    void addRow(const std::string_view* cells);
+
+    uint32_t numColumns() const noexcept {
+        return _numColumns;
+    }
+    uint32_t numRows() const noexcept {
+        return _numColumns == 0 ? 0 : static_cast<uint32_t>(_ids.size() / _numColumns);
+    }
+    // Of the batch as it's written out.
+    size_t bytes() const noexcept {
+        return kHeaderBytes + _ids.size() * sizeof(uint32_t) + _values.ends().size() * sizeof(uint32_t) +
+            _values.data().size();
+    }
+    bool empty() const noexcept {
+        return _ids.empty();
+    }
+    void clear() noexcept {
+        _ids.clear();
+        _values.clear();
+    }
+
+    static constexpr size_t kHeaderBytes = 3 * sizeof(uint32_t);
+
+private:
+    friend class SpillFile;
+
+    // Distinct values interned per batch, and the longest one looked up.
+    static constexpr uint32_t kMaxInternedValues = 64 * 1024;
+    static constexpr size_t kMaxInternedValueBytes = 64;
+
+    uint32_t _numColumns;
+    std::vector<uint32_t> _ids;
+    StringDictionary _values{kMaxInternedValues, kMaxInternedValueBytes};
+};
+
+// A spilled batch mapped back into memory. The cells point into the mapping, which is
+// backed by the page cache rather than the heap, so the kernel can drop it again under
+// memory pressure.
+class SpilledBatch {
+public:
+    SpilledBatch(const SpilledBatch&) = delete;
+    SpilledBatch& operator=(const SpilledBatch&) = delete;
+    SpilledBatch(SpilledBatch&& other) noexcept;
+    SpilledBatch& operator=(SpilledBatch&& other) noexcept;
+    ~SpilledBatch();
+
+    uint32_t numRows() const noexcept {
+        return _numRows;
+    }
+    uint32_t numColumns() const noexcept {
+        return _numColumns;
+    }
+    std::string_view cell(uint32_t row, uint32_t col) const noexcept;
+
+private:
+    friend class SpillFile;
+    SpilledBatch(void* mapping, size_t mappingSize, const char* batch);
+
+    void* _mapping = nullptr;
+    size_t _mappingSize = 0;
+    const char* _ids = nullptr;
+    const char* _ends = nullptr;
+    const char* _data = nullptr;
+    uint32_t _numRows = 0;
+    uint32_t _numColumns = 0;
+};
+
+// An append-only temporary file of row batches, for results buffered past their memory
+// budget. The file is unlinked as soon as it's created, so it goes away with the process
+// however that ends. Throws std::system_error when the file can't be created, written or
+// mapped.
+class SpillFile {
+public:
+    // Where a batch went, for mapping it back.
+    struct Extent {
+        uint64_t offset = 0;
+        uint64_t length = 0;
+        uint32_t numRows = 0;
+    };
+
+    // Created under $TMPDIR, or /tmp; purpose goes into the file name.
+    explicit SpillFile(std::string_view purpose);
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+    ~SpillFile();
+
+    Extent append(const SpillBatchBuilder& batch);
+    SpilledBatch map(const Extent& extent) const;
+
+    // Written so far.
+    uint64_t bytes() const noexcept {
+        return _size;
+    }
+
+private:
+    void _write(const char* data, size_t size);
+
+    int _fd = -1;
+    uint64_t _size = 0;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,64 @@
+#include "sql_keywords.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace sqlplusplus {
+namespace {
+
+// Sorted byte-wise, so a prefix's matches are one contiguous range.
+constexpr std::string_view kKeywords[] = {
+    "access", "add", "all", "alter", "analyze", "and", "any", "apply", "as", "asc", "audit", "avg",
+    "begin", "between", "binary_double", "binary_float", "blob", "body", "boolean", "bulk", "by",
+    "cache", "cascade", "case", "cast", "char", "check", "clob", "cluster", "coalesce", "collect",
+    "column", "comment", "commit", "compress", "compute", "connect", "connect_by_root",
+    "constraint", "constraints", "count", "create", "cross", "current", "currval", "date", "day",
+    "decimal", "declare", "decode", "default", "deferrable", "deferred", "delete", "dense_rank",
+    "desc", "disable", "distinct", "drop", "else", "elsif", "enable", "end", "escape", "exception",
+    "exclusive", "execute", "exists", "explain", "extract", "fetch", "file", "first", "flashback",
+    "float", "for", "forall", "force", "foreign", "from", "full", "function", "gather", "global",
+    "grant", "group", "hash", "having", "hour", "identified", "if", "ignore", "immediate", "in",
+    "increment", "index", "initial", "initially", "inner", "insert", "instr", "integer",
+    "intersect", "interval", "into", "is", "join", "json_arrayagg", "json_object", "json_query",
+    "json_table", "json_value", "keep", "key", "lag", "last", "lateral", "lead", "left", "length",
+    "level", "like", "limit", "list", "listagg", "local", "lock", "logging", "long", "loop",
+    "lower", "matched", "materialized", "max", "maxextents", "merge", "min", "minus", "minute",
+    "mlslabel", "mode", "model", "modify", "month", "natural", "nchar", "nclob", "next", "nextval",
+    "noaudit", "nocache", "nocompress", "nocycle", "nologging", "noparallel", "not", "novalidate",
+    "nowait", "null", "nulls", "number", "nvarchar2", "nvl", "nvl2", "of", "offline", "offset",
+    "on", "online", "only", "option", "or", "order", "outer", "over", "package", "parallel",
+    "partition", "pctfree", "percent", "pivot", "plan", "pls_integer", "preserve", "primary",
+    "prior", "procedure", "public", "purge", "range", "rank", "raw", "recyclebin", "references",
+    "regexp_like", "regexp_replace", "regexp_substr", "rely", "rename", "replace", "resource",
+    "respect", "return", "returning", "revoke", "right", "rollback", "row", "row_number", "rowid",
+    "rownum", "rows", "rowtype", "savepoint", "second", "select", "sequence", "session", "set",
+    "share", "siblings", "size", "smallint", "start", "statistics", "storage", "subpartition",
+    "substr", "successful", "sum", "synonym", "sys_connect_by_path", "sysdate", "table",
+    "tablespace", "temporary", "then", "ties", "time", "timestamp", "to", "to_char", "to_date",
+    "to_number", "to_timestamp", "trigger", "trim", "truncate", "type", "uid", "union", "unique",
+    "unpivot", "update", "upper", "user", "using", "validate", "values", "varchar", "varchar2",
+    "view", "when", "whenever", "where", "while", "with", "within", "xmltable", "year", "zone",
+};
+
+constexpr bool isStrictlySorted() {
+    for (size_t idx = 1; idx < std::size(kKeywords); ++idx) {
+        if (!(kKeywords[idx - 1] < kKeywords[idx])) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(isStrictlySorted(), "kKeywords must be sorted with no duplicates");
+
+} // namespace
+
+std::pair<const std::string_view*, const std::string_view*> builtinKeywordsWithPrefix(
+        std::string_view prefix) noexcept {
+    const auto first = std::lower_bound(std::begin(kKeywords), std::end(kKeywords), prefix);
+    const auto last = std::find_if(first, std::end(kKeywords), [prefix](std::string_view keyword) {
+        return keyword.substr(0, prefix.size()) != prefix;
+    });
+    return {first, last};
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string_view>
+#include <utility>
+
+namespace sqlplusplus {
+
+// Oracle's reserved words and the SQL and PL/SQL keywords typed most, lower case and built
+// into the client, so completion offers them from the first keystroke, before there's a
+// session to ask. V$RESERVED_WORDS fills in the rest once the connection is up. Returns
+// those starting with prefix, in order, as [first, last).
+std::pair<const std::string_view*, const std::string_view*> builtinKeywordsWithPrefix(
+        std::string_view prefix) noexcept;
+
+} // namespace sqlplusplus
@@ -0,0 +1,291 @@
+#include "sql_splitter.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace sqlplusplus {
+namespace {
+
+bool isSpace(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == '\f' || ch == '\v';
+}
+
+bool isWordChar(char ch) {
+    return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_' || ch == '$' || ch == '#';
+}
+
+// The only characters that can start a quote, a comment or a terminator. Newlines aren't
+// among them: lines are counted in bulk, and a terminating slash is checked for its line
+// when it's found.
+constexpr char kSpecials[] = {'\'', '"', '-', '/', ';'};
+
+constexpr std::array<bool, 256> makeSpecialTable() {
+    std::array<bool, 256> table{};
+    for (auto ch : kSpecials) {
+        table[static_cast<unsigned char>(ch)] = true;
+    }
+    return table;
+}
+constexpr auto kSpecialTable = makeSpecialTable();
+
+// Offset of the first special character at or after pos, or script.size().
+size_t findSpecial(std::string_view script, size_t pos) {
+    const auto size = script.size();
+#if defined(__SSE2__)
+    const auto data = script.data();
+    const __m128i quote = _mm_set1_epi8('\'');
+    const __m128i doubleQuote = _mm_set1_epi8('"');
+    const __m128i dash = _mm_set1_epi8('-');
+    const __m128i slash = _mm_set1_epi8('/');
+    const __m128i semicolon = _mm_set1_epi8(';');
+    for (; pos + 16 <= size; pos += 16) {
+        const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        auto hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, doubleQuote));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, dash));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, slash));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, semicolon));
+        if (const auto mask = _mm_movemask_epi8(hits); mask != 0) {
+            return pos + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+    }
+#endif
+    for (; pos < size; ++pos) {
+        if (kSpecialTable[static_cast<unsigned char>(script[pos])]) {
+            return pos;
+        }
+    }
+    return size;
+}
+
+std::string_view trimTrailing(std::string_view text) {
+    while (!text.empty() && isSpace(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// Reads the word starting at pos, after any whitespace, and moves pos past it.
+std::string_view nextWord(std::string_view script, size_t& pos) {
+    while (pos < script.size() && isSpace(script[pos])) {
+        ++pos;
+    }
+    const auto start = pos;
+    while (pos < script.size() && isWordChar(script[pos])) {
+        ++pos;
+    }
+    return script.substr(start, pos - start);
+}
+
+bool equalsIgnoreCase(std::string_view word, std::string_view keyword) {
+    if (word.size() != keyword.size()) {
+        return false;
+    }
+    for (size_t idx = 0; idx < word.size(); ++idx) {
+        if (std::tolower(static_cast<unsigned char>(word[idx])) != keyword[idx]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool isQuotePrefix(char ch, char upper) {
+    return ch == upper || ch == std::tolower(static_cast<unsigned char>(upper));
+}
+
+} // namespace
+
+size_t SqlSplitter::_lineEnd(size_t pos) const {
+    auto end = _script.find('\n', pos);
+    return end == std::string_view::npos ? _script.size() : end;
+}
+
+uint64_t SqlSplitter::_lineAt(size_t pos) {
+    if (pos > _linePos) {
+        _line += std::count(_script.begin() + _linePos, _script.begin() + pos, '\n');
+        _linePos = pos;
+    }
+    return _line;
+}
+
+bool SqlSplitter::_isSlashLine(size_t pos, size_t& lineEnd) const {
+    for (auto idx = pos; idx > 0 && _script[idx - 1] != '\n'; --idx) {
+        if (!isSpace(_script[idx - 1])) {
+            return false;
+        }
+    }
+    lineEnd = _lineEnd(pos);
+    for (auto idx = pos + 1; idx < lineEnd; ++idx) {
+        if (!isSpace(_script[idx])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t SqlSplitter::_quoteEnd(size_t pos) const {
+    const auto ch = _script[pos];
+    // Q'[...]' and its N'...' national form take any closing character followed by a quote.
+    const bool qQuote = ch == '\'' && pos > 0 && isQuotePrefix(_script[pos - 1], 'Q') &&
+        (pos < 2 || !isWordChar(_script[pos - 2]) ||
+         (isQuotePrefix(_script[pos - 2], 'N') && (pos < 3 || !isWordChar(_script[pos - 3]))));
+    if (qQuote && pos + 1 < _script.size() && !isSpace(_script[pos + 1])) {
+        auto close = _script[pos + 1];
+        switch (close) {
+        case '[': close = ']'; break;
+        case '{': close = '}'; break;
+        case '<': close = '>'; break;
+        case '(': close = ')'; break;
+        default: break;
+        }
+        for (auto idx = _script.find(close, pos + 2); idx != std::string_view::npos;
+             idx = _script.find(close, idx + 1)) {
+            if (idx + 1 < _script.size() && _script[idx + 1] == '\'') {
+                return idx + 2;
+            }
+        }
+        return std::string_view::npos;
+    }
+    // Doubled quotes inside a literal read as closing and reopening it.
+    auto end = _script.find(ch, pos + 1);
+    return end == std::string_view::npos ? end : end + 1;
+}
+
+bool SqlSplitter::_isDirective(size_t pos, size_t& textStart) const {
+    textStart = pos + 2;
+    while (textStart < _script.size() && (_script[textStart] == ' ' || _script[textStart] == '\t')) {
+        ++textStart;
+    }
+    return textStart + 1 < _script.size() && _script[textStart] == '@' &&
+        std::isalpha(static_cast<unsigned char>(_script[textStart + 1]));
+}
+
+bool SqlSplitter::_skipBlankAndComments() {
+    while (_pos < _script.size()) {
+        const auto ch = _script[_pos];
+        size_t directiveStart = 0;
+        if (isSpace(ch)) {
+            ++_pos;
+        } else if (_script.compare(_pos, 2, "--") == 0) {
+            if (_isDirective(_pos, directiveStart)) {
+                return true;
+            }
+            _pos = _lineEnd(_pos);
+        } else if (_script.compare(_pos, 2, "/*") == 0) {
+            auto end = _script.find("*/", _pos + 2);
+            if (end == std::string_view::npos) {
+                _pos = _script.size();
+                return false;
+            }
+            _pos = end + 2;
+        } else {
+            return true;
+        }
+    }
+    return true;
+}
+
+bool SqlSplitter::_isPlsqlStart(size_t pos) const {
+    auto word = nextWord(_script, pos);
+    if (equalsIgnoreCase(word, "begin") || equalsIgnoreCase(word, "declare")) {
+        return true;
+    }
+    if (!equalsIgnoreCase(word, "create")) {
+        return false;
+    }
+    word = nextWord(_script, pos);
+    if (equalsIgnoreCase(word, "or")) {
+        nextWord(_script, pos);
+        word = nextWord(_script, pos);
+    }
+    if (equalsIgnoreCase(word, "editionable") || equalsIgnoreCase(word, "noneditionable")) {
+        word = nextWord(_script, pos);
+    }
+    for (auto keyword : {"function", "procedure", "package", "trigger", "type", "library"}) {
+        if (equalsIgnoreCase(word, keyword)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SqlSplitter::next(SqlStatement& out) {
+    if (_sawIncomplete) {
+        return false;
+    }
+    for (;;) {
+        if (!_skipBlankAndComments()) {
+            return false;
+        }
+        if (_pos >= _script.size()) {
+            _consumed = _pos;
+            return false;
+        }
+        // A slash with nothing before it would rerun the last statement in sqlplus; there's
+        // nothing buffered here, so it's skipped.
+        size_t lineEnd = 0;
+        if (_script[_pos] == '/' && _isSlashLine(_pos, lineEnd)) {
+            _pos = _consumed = lineEnd;
+            continue;
+        }
+        break;
+    }
+
+    const auto start = _pos;
+    out.line = _lineAt(start);
+    out.complete = true;
+    out.isDirective = false;
+    if (size_t textStart = 0; _script.compare(start, 2, "--") == 0 && _isDirective(start, textStart)) {
+        out.isCommand = false;
+        out.isDirective = true;
+        _pos = _consumed = _lineEnd(start);
+        out.text = trimTrailing(_script.substr(textStart, _pos - textStart));
+        return true;
+    }
+    out.isCommand = _script[start] == '.' || _script[start] == '@';
+    if (out.isCommand) {
+        _pos = _consumed = _lineEnd(start);
+        out.text = trimTrailing(_script.substr(start, _pos - start));
+        return true;
+    }
+
+    const bool plsql = _isPlsqlStart(start);
+    while ((_pos = findSpecial(_script, _pos)) < _script.size()) {
+        const auto ch = _script[_pos];
+        if (ch == '\'' || ch == '"') {
+            _pos = _quoteEnd(_pos);
+            if (_pos == std::string_view::npos) {
+                break;
+            }
+        } else if (ch == '-' && _script.compare(_pos, 2, "--") == 0) {
+            _pos = _lineEnd(_pos);
+        } else if (ch == '/' && _script.compare(_pos, 2, "/*") == 0) {
+            auto end = _script.find("*/", _pos + 2);
+            if (end == std::string_view::npos) {
+                break;
+            }
+            _pos = end + 2;
+        } else if (size_t lineEnd = 0; ch == '/' && _pos > start && _isSlashLine(_pos, lineEnd)) {
+            out.text = trimTrailing(_script.substr(start, _pos - start));
+            _pos = _consumed = lineEnd;
+            return true;
+        } else if (ch == ';' && !plsql) {
+            out.text = trimTrailing(_script.substr(start, _pos - start));
+            _pos = _consumed = _pos + 1;
+            return true;
+        } else {
+            ++_pos;
+        }
+    }
+    _pos = _script.size();
+    out.text = trimTrailing(_script.substr(start));
+    out.complete = false;
+    _sawIncomplete = true;
+    return true;
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace sqlplusplus {
+
+// One statement or client command cut out of a script. text is a view into the script, with
+// the surrounding whitespace and the terminating ; or / left off.
+struct SqlStatement {
+    std::string_view text;
+    // One-based line of the script the statement starts on.
+    uint64_t line = 0;
+    // A line starting with . or @, which is passed to the client rather than the server.
+    bool isCommand = false;
+    // A "-- @<word> ..." comment on a line of its own between statements, which tells the
+    // client how to run the statements around it; text is what follows the --.
+    bool isDirective = false;
+    // False when the script ran out before the statement's terminator, or inside one of its
+    // quotes or comments.
+    bool complete = true;
+};
+
+// Splits a script into statements the way sqlplus reads them. SQL ends at a semicolon
+// outside of quotes, q-quotes and comments. PL/SQL blocks and stored program units (BEGIN,
+// DECLARE, CREATE ... PROCEDURE and the like), which have semicolons of their own, end at a
+// line holding just a slash, which also ends plain SQL. Client commands and directives take
+// up one line.
+//
+// The splitter never copies the script: it jumps between the few characters that can change
+// its state 16 bytes at a time, and finds the ends of quotes and comments with memchr.
+class SqlSplitter {
+public:
+    explicit SqlSplitter(std::string_view script) : _script(script) {}
+
+    // Fills out with the next statement. Returns false at the end of the script.
+    bool next(SqlStatement& out);
+
+    // Offset just past the last complete statement returned, where input that's still
+    // being typed resumes.
+    size_t consumed() const noexcept {
+        return _consumed;
+    }
+
+private:
+    // Stops at a directive. Returns false if the script ends inside a comment.
+    bool _skipBlankAndComments();
+    // Whether the -- comment at pos is a directive; sets textStart to its @.
+    bool _isDirective(size_t pos, size_t& textStart) const;
+    bool _isPlsqlStart(size_t pos) const;
+    // Whether the slash at pos is alone on its line; sets lineEnd past the line.
+    bool _isSlashLine(size_t pos, size_t& lineEnd) const;
+    size_t _lineEnd(size_t pos) const;
+    uint64_t _lineAt(size_t pos);
+    // Offset just past the quote opened at pos, or npos if the script ends inside it.
+    size_t _quoteEnd(size_t pos) const;
+
+    std::string_view _script;
+    size_t _pos = 0;
+    size_t _consumed = 0;
+    bool _sawIncomplete = false;
+    // Line numbers are counted lazily, up to _linePos.
+    size_t _linePos = 0;
+    uint64_t _line = 1;
+};
+
+} // namespace sqlplusplus
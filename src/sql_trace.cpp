@@ -0,0 +1,227 @@
+#include "sql_trace.h"
+
+#include <algorithm>
+#include <charconv>
+
+namespace sqlplusplus {
+namespace {
+
+constexpr std::string_view kParsingInCursor = "PARSING IN CURSOR #";
+constexpr std::string_view kEndOfStmt = "END OF STMT";
+
+uint64_t number(std::string_view text) noexcept {
+    uint64_t value = 0;
+    std::from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+}
+
+// The cursor number after the # at the start of text, e.g. 140234 of "#140234:c=0".
+uint64_t cursorNumber(std::string_view text) noexcept {
+    return text.empty() || text.front() != '#' ? 0 : number(text.substr(1));
+}
+
+// The value of name in a list of name=value pairs separated by any of separators, with
+// quotes left on: "12" for name e of "c=3,e=12,p=0".
+std::string_view fieldValue(std::string_view fields, std::string_view name, std::string_view separators) {
+    for (size_t start = 0; start < fields.size();) {
+        const auto end = std::min(fields.find_first_of(separators, start), fields.size());
+        const auto field = fields.substr(start, end - start);
+        if (field.size() > name.size() && field.substr(0, name.size()) == name && field[name.size()] == '=') {
+            return field.substr(name.size() + 1);
+        }
+        start = end + 1;
+    }
+    return {};
+}
+
+std::string_view unquoted(std::string_view value) noexcept {
+    if (value.size() >= 2 && value.front() == '\'' && value.back() == '\'') {
+        return value.substr(1, value.size() - 2);
+    }
+    return value;
+}
+
+TraceCallTotals callTotals(std::string_view fields) {
+    TraceCallTotals totals;
+    totals.count = 1;
+    totals.cpuMicros = number(fieldValue(fields, "c", ","));
+    totals.elapsedMicros = number(fieldValue(fields, "e", ","));
+    totals.disk = number(fieldValue(fields, "p", ","));
+    totals.query = number(fieldValue(fields, "cr", ","));
+    totals.current = number(fieldValue(fields, "cu", ","));
+    totals.rows = number(fieldValue(fields, "r", ","));
+    totals.misses = number(fieldValue(fields, "mis", ","));
+    return totals;
+}
+
+void addWait(std::unordered_map<std::string, TraceWaitTotals>& waits, std::string_view event, uint64_t micros) {
+    auto [it, added] = waits.try_emplace(std::string(event));
+    auto& totals = it->second;
+    if (added) {
+        totals.event = it->first;
+    }
+    ++totals.count;
+    totals.maxMicros = std::max(totals.maxMicros, micros);
+    totals.totalMicros += micros;
+}
+
+std::vector<TraceWaitTotals> sortedWaits(const std::unordered_map<std::string, TraceWaitTotals>& waits) {
+    std::vector<TraceWaitTotals> sorted;
+    sorted.reserve(waits.size());
+    for (const auto& [event, totals] : waits) {
+        sorted.push_back(totals);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const auto& left, const auto& right) {
+        return left.totalMicros != right.totalMicros ? left.totalMicros > right.totalMicros : left.event < right.event;
+    });
+    return sorted;
+}
+
+} // namespace
+
+void TraceCallTotals::add(const TraceCallTotals& other) noexcept {
+    count += other.count;
+    cpuMicros += other.cpuMicros;
+    elapsedMicros += other.elapsedMicros;
+    disk += other.disk;
+    query += other.query;
+    current += other.current;
+    rows += other.rows;
+    misses += other.misses;
+}
+
+TraceCallTotals TracedStatement::total() const noexcept {
+    TraceCallTotals totals;
+    for (const auto& call : calls) {
+        totals.add(call);
+    }
+    return totals;
+}
+
+void SqlTraceSummary::addLine(std::string_view line) {
+    for (auto end = line.find('\n'); end != std::string_view::npos; end = line.find('\n')) {
+        _addSingleLine(line.substr(0, end));
+        line.remove_prefix(end + 1);
+    }
+    if (!line.empty()) {
+        _addSingleLine(line);
+    }
+}
+
+void SqlTraceSummary::_addSingleLine(std::string_view line) {
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    if (_inText) {
+        if (line == kEndOfStmt) {
+            _inText = false;
+            _textOf = nullptr;
+        } else if (_textOf != nullptr) {
+            auto& text = _textOf->statement.text;
+            if (!text.empty()) {
+                text += '\n';
+            }
+            text.append(line);
+        }
+        return;
+    }
+
+    if (line.substr(0, kParsingInCursor.size()) == kParsingInCursor) {
+        const auto fields = line.substr(kParsingInCursor.size() - 1);
+        const auto cursor = cursorNumber(fields);
+        auto id = std::string(unquoted(fieldValue(fields, "sqlid", " ")));
+        if (id.empty()) {
+            id = std::string(fieldValue(fields, "hv", " "));
+        }
+        auto [it, added] = _statements.try_emplace(id);
+        if (added) {
+            it->second.statement.id = id;
+            it->second.statement.depth = static_cast<uint32_t>(number(fieldValue(fields, "dep", " ")));
+        }
+        // A statement parsed again has the same text as the first time.
+        _inText = true;
+        _textOf = added ? &it->second : nullptr;
+        _cursors[cursor] = std::move(id);
+        return;
+    }
+
+    const auto space = line.find(' ');
+    if (space == std::string_view::npos) {
+        return;
+    }
+    const auto kind = line.substr(0, space);
+    auto rest = line.substr(space + 1);
+    if (kind == "WAIT") {
+        const auto cursor = cursorNumber(rest);
+        const auto nameStart = rest.find("nam='");
+        const auto nameEnd = nameStart == std::string_view::npos ? nameStart : rest.find('\'', nameStart + 5);
+        const auto elaStart = nameEnd == std::string_view::npos ? nameEnd : rest.find("ela=", nameEnd);
+        if (elaStart == std::string_view::npos) {
+            return;
+        }
+        const auto event = rest.substr(nameStart + 5, nameEnd - nameStart - 5);
+        auto ela = rest.substr(elaStart + 4);
+        ela.remove_prefix(std::min(ela.find_first_not_of(' '), ela.size()));
+        const auto micros = number(ela);
+        if (cursor == 0) {
+            addWait(_otherWaits, event, micros);
+        } else {
+            addWait(_statementOf(cursor).waits, event, micros);
+        }
+        return;
+    }
+    if (kind == "PARSE" && rest.substr(0, 6) == "ERROR ") {
+        ++_statementOf(cursorNumber(rest.substr(6))).statement.parseErrors;
+        return;
+    }
+
+    TracedStatement::Call call;
+    if (kind == "PARSE") {
+        call = TracedStatement::Parse;
+    } else if (kind == "EXEC") {
+        call = TracedStatement::Execute;
+    } else if (kind == "FETCH") {
+        call = TracedStatement::Fetch;
+    } else {
+        return;
+    }
+    const auto colon = rest.find(':');
+    if (colon == std::string_view::npos) {
+        return;
+    }
+    _statementOf(cursorNumber(rest)).statement.calls[call].add(callTotals(rest.substr(colon + 1)));
+}
+
+SqlTraceSummary::StatementTotals& SqlTraceSummary::_statementOf(uint64_t cursor) {
+    auto known = _cursors.find(cursor);
+    if (known == _cursors.end()) {
+        // Parsed before tracing began, so all there is to go by is the number.
+        known = _cursors.emplace(cursor, "#" + std::to_string(cursor)).first;
+    }
+    auto [it, added] = _statements.try_emplace(known->second);
+    if (added) {
+        it->second.statement.id = known->second;
+    }
+    return it->second;
+}
+
+std::vector<TracedStatement> SqlTraceSummary::statements() const {
+    std::vector<TracedStatement> sorted;
+    sorted.reserve(_statements.size());
+    for (const auto& [id, totals] : _statements) {
+        sorted.push_back(totals.statement);
+        sorted.back().waits = sortedWaits(totals.waits);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const auto& left, const auto& right) {
+        const auto leftElapsed = left.total().elapsedMicros;
+        const auto rightElapsed = right.total().elapsedMicros;
+        return leftElapsed != rightElapsed ? leftElapsed > rightElapsed : left.id < right.id;
+    });
+    return sorted;
+}
+
+std::vector<TraceWaitTotals> SqlTraceSummary::waitsOutsideCursors() const {
+    return sortedWaits(_otherWaits);
+}
+
+} // namespace sqlplusplus
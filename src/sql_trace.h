@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace sqlplusplus {
+
+// Totals of one kind of call on a traced statement, times in microseconds, as tkprof has
+// them.
+struct TraceCallTotals {
+    uint64_t count = 0;
+    uint64_t cpuMicros = 0;
+    uint64_t elapsedMicros = 0;
+    // Blocks read from disk, got consistently for the query and got current.
+    uint64_t disk = 0;
+    uint64_t query = 0;
+    uint64_t current = 0;
+    uint64_t rows = 0;
+    // Parses that had to hard parse, missing the library cache.
+    uint64_t misses = 0;
+
+    void add(const TraceCallTotals& other) noexcept;
+};
+
+struct TraceWaitTotals {
+    std::string event;
+    uint64_t count = 0;
+    uint64_t maxMicros = 0;
+    uint64_t totalMicros = 0;
+};
+
+struct TracedStatement {
+    enum Call { Parse, Execute, Fetch };
+
+    // The SQL_ID, or the hash value for traces without one, or for a cursor opened before
+    // tracing began, "#<cursor>".
+    std::string id;
+    // Empty for a cursor opened before tracing began.
+    std::string text;
+    // 0 for what the client sent, 1 and up for the recursive SQL run on its behalf.
+    uint32_t depth = 0;
+    std::array<TraceCallTotals, 3> calls;
+    // Parse calls that failed, e.g. on a syntax error.
+    uint64_t parseErrors = 0;
+    // By total time waited, most first.
+    std::vector<TraceWaitTotals> waits;
+
+    TraceCallTotals total() const noexcept;
+};
+
+// A tkprof-style summary of a SQL trace (event 10046, as DBMS_MONITOR writes it), built
+// one line of the trace file at a time so it can be read from wherever the file's
+// contents come from, e.g. V$DIAG_TRACE_FILE_CONTENTS. PARSE, EXEC and FETCH lines and
+// waits are totaled per statement, statements run more than once counted together.
+// Waits outside any cursor, like SQL*Net message from client between calls, are totaled
+// on their own.
+class SqlTraceSummary {
+public:
+    // line is without its newline; one with a newline in it is taken as that many lines.
+    void addLine(std::string_view line);
+
+    // By total elapsed time, most first.
+    std::vector<TracedStatement> statements() const;
+    std::vector<TraceWaitTotals> waitsOutsideCursors() const;
+
+private:
+    struct StatementTotals {
+        TracedStatement statement;
+        std::unordered_map<std::string, TraceWaitTotals> waits;
+    };
+
+    void _addSingleLine(std::string_view line);
+    StatementTotals& _statementOf(uint64_t cursor);
+
+    std::unordered_map<std::string, StatementTotals> _statements;
+    // Which statement each open cursor number has; numbers are reused once closed.
+    std::unordered_map<uint64_t, std::string> _cursors;
+    std::unordered_map<std::string, TraceWaitTotals> _otherWaits;
+    // Between a PARSING IN CURSOR and its END OF STMT, the text's lines go to _textOf,
+    // unless it's null because the statement has its text already.
+    bool _inText = false;
+    StatementTotals* _textOf = nullptr;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,353 @@
+#include "sqlite_offload.h"
+
+#include "oracle_helpers.h"
+#include "result_metadata.h"
+#include "trace_recorder.h"
+#include "value_format.h"
+#include "work_stealing.h"
+
+#include "fmt/format.h"
+
+#include <future>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <sqlite3.h>
+
+namespace sqlplusplus {
+namespace {
+
+constexpr uint32_t kRowsPerTransaction = 50000;
+// A transaction is cut early once its buffered values reach this size.
+constexpr size_t kMaxTransactionBytes = 64 * 1024 * 1024;
+
+enum class SqliteType { Integer, Real, Numeric, Text, Blob, Timestamp };
+
+std::string_view declaredType(SqliteType type) noexcept {
+    switch (type) {
+    case SqliteType::Integer:
+        return "INTEGER";
+    case SqliteType::Real:
+        return "REAL";
+    case SqliteType::Numeric:
+        return "NUMERIC";
+    case SqliteType::Blob:
+        return "BLOB";
+    case SqliteType::Text:
+    case SqliteType::Timestamp:
+        return "TEXT";
+    }
+    return "TEXT";
+}
+
+SqliteType sqliteTypeFor(const ResultMetadata::Column& column) noexcept {
+    if (isBinaryType(column.typeInfo.oracleTypeNum)) {
+        return SqliteType::Blob;
+    }
+    switch (column.formatter.nativeType()) {
+    case DPI_NATIVE_TYPE_BOOLEAN:
+    case DPI_NATIVE_TYPE_INT64:
+    case DPI_NATIVE_TYPE_UINT64:
+        return SqliteType::Integer;
+    case DPI_NATIVE_TYPE_FLOAT:
+    case DPI_NATIVE_TYPE_DOUBLE:
+        return SqliteType::Real;
+    case DPI_NATIVE_TYPE_TIMESTAMP:
+        return SqliteType::Timestamp;
+    case DPI_NATIVE_TYPE_BYTES:
+        return fetchesNumberAsText(column.typeInfo) ? SqliteType::Numeric : SqliteType::Text;
+    default:
+        return SqliteType::Text;
+    }
+}
+
+std::string quotedIdentifier(std::string_view name) {
+    std::string quoted = "\"";
+    for (const auto ch : name) {
+        quoted += ch;
+        if (ch == '"') {
+            quoted += '"';
+        }
+    }
+    quoted += '"';
+    return quoted;
+}
+
+// As SQLite's date and time functions read it, with the offset for the types that have one.
+void appendTimestamp(const dpiTimestamp& ts, bool withOffset, std::string& out) {
+    fmt::format_to(std::back_inserter(out), "{:04}-{:02}-{:02} {:02}:{:02}:{:02}", ts.year, ts.month, ts.day,
+                   ts.hour, ts.minute, ts.second);
+    if (ts.fsecond != 0) {
+        fmt::format_to(std::back_inserter(out), ".{:06}", ts.fsecond / 1000);
+    }
+    if (withOffset) {
+        const auto minutes = ts.tzHourOffset * 60 + ts.tzMinuteOffset;
+        const auto magnitude = minutes < 0 ? -minutes : minutes;
+        fmt::format_to(std::back_inserter(out), "{}{:02}:{:02}", minutes < 0 ? '-' : '+', magnitude / 60,
+                       magnitude % 60);
+    }
+}
+
+// One transaction's rows, copied out of the fetch buffers so the next fetch can reuse them.
+struct RowBatch {
+    enum class Kind : uint8_t { Null, Integer, Real, Text, Blob };
+    struct Value {
+        Kind kind = Kind::Null;
+        int64_t asInt = 0;
+        double asDouble = 0;
+        // Into bytes, for text and blobs.
+        size_t begin = 0;
+        size_t size = 0;
+    };
+
+    // Row major, a value a column.
+    std::vector<Value> values;
+    std::string bytes;
+    uint32_t numRows = 0;
+
+    void clear() noexcept {
+        values.clear();
+        bytes.clear();
+        numRows = 0;
+    }
+    size_t byteSize() const noexcept {
+        return values.size() * sizeof(Value) + bytes.size();
+    }
+};
+
+class SqliteDatabase {
+public:
+    explicit SqliteDatabase(const std::string& path) {
+        if (const auto rc = sqlite3_open_v2(path.c_str(), &_db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr);
+                rc != SQLITE_OK) {
+            const std::string message = _db != nullptr ? sqlite3_errmsg(_db) : sqlite3_errstr(rc);
+            sqlite3_close(_db);
+            throw std::runtime_error(fmt::format("can't open {}: {}", path, message));
+        }
+    }
+    SqliteDatabase(const SqliteDatabase&) = delete;
+    SqliteDatabase& operator=(const SqliteDatabase&) = delete;
+    ~SqliteDatabase() {
+        sqlite3_finalize(_insert);
+        sqlite3_close(_db);
+    }
+
+    void exec(const std::string& sql) {
+        char* error = nullptr;
+        if (sqlite3_exec(_db, sql.c_str(), nullptr, nullptr, &error) != SQLITE_OK) {
+            const std::string message = error != nullptr ? error : sqlite3_errmsg(_db);
+            sqlite3_free(error);
+            throw std::runtime_error(fmt::format("SQLite: {}", message));
+        }
+    }
+
+    void prepareInsert(const std::string& sql) {
+        _check(sqlite3_prepare_v3(_db, sql.c_str(), static_cast<int>(sql.size()), SQLITE_PREPARE_PERSISTENT,
+                                  &_insert, nullptr));
+    }
+
+    // Inserts batch's rows in a transaction of their own.
+    void insert(const RowBatch& batch, uint32_t numColumns) {
+        exec("BEGIN");
+        try {
+            auto value = batch.values.begin();
+            for (uint32_t row = 0; row < batch.numRows; ++row) {
+                for (int param = 1; param <= static_cast<int>(numColumns); ++param, ++value) {
+                    const auto data = batch.bytes.data() + value->begin;
+                    switch (value->kind) {
+                    case RowBatch::Kind::Null:
+                        _check(sqlite3_bind_null(_insert, param));
+                        break;
+                    case RowBatch::Kind::Integer:
+                        _check(sqlite3_bind_int64(_insert, param, value->asInt));
+                        break;
+                    case RowBatch::Kind::Real:
+                        _check(sqlite3_bind_double(_insert, param, value->asDouble));
+                        break;
+                    case RowBatch::Kind::Text:
+                        // The batch outlives the step, so SQLite needn't copy the value.
+                        _check(sqlite3_bind_text64(_insert, param, data, value->size, SQLITE_STATIC, SQLITE_UTF8));
+                        break;
+                    case RowBatch::Kind::Blob:
+                        _check(sqlite3_bind_blob64(_insert, param, data, value->size, SQLITE_STATIC));
+                        break;
+                    }
+                }
+                if (sqlite3_step(_insert) != SQLITE_DONE) {
+                    throw std::runtime_error(fmt::format("SQLite: {}", sqlite3_errmsg(_db)));
+                }
+                sqlite3_reset(_insert);
+            }
+            exec("COMMIT");
+        } catch(...) {
+            sqlite3_reset(_insert);
+            sqlite3_exec(_db, "ROLLBACK", nullptr, nullptr, nullptr);
+            throw;
+        }
+    }
+
+private:
+    void _check(int rc) {
+        if (rc != SQLITE_OK) {
+            throw std::runtime_error(fmt::format("SQLite: {}", sqlite3_errmsg(_db)));
+        }
+    }
+
+    sqlite3* _db = nullptr;
+    sqlite3_stmt* _insert = nullptr;
+};
+
+} // namespace
+
+uint64_t offloadToSqlite(OracleResultSource& stmt, const std::string& path, std::string_view table) {
+    const auto metadata = stmt.metadata();
+    const auto numColumns = metadata->numColumns();
+    std::vector<SqliteType> types;
+    std::vector<dpiNativeTypeNum> nativeTypes;
+    std::vector<bool> withOffset;
+    auto create = fmt::format("CREATE TABLE {} (", quotedIdentifier(table));
+    auto insert = fmt::format("INSERT INTO {} VALUES (", quotedIdentifier(table));
+    for (const auto& column : metadata->columns()) {
+        types.push_back(sqliteTypeFor(column));
+        nativeTypes.push_back(column.formatter.nativeType());
+        const auto oracleType = column.typeInfo.oracleTypeNum;
+        withOffset.push_back(oracleType == DPI_ORACLE_TYPE_TIMESTAMP_TZ || oracleType == DPI_ORACLE_TYPE_TIMESTAMP_LTZ);
+        const bool first = types.size() == 1;
+        fmt::format_to(std::back_inserter(create), "{}{} {}", first ? "" : ", ", quotedIdentifier(column.name),
+                       declaredType(types.back()));
+        insert += first ? "?" : ", ?";
+    }
+    create += ")";
+    insert += ")";
+    auto formatters = metadata->formatters();
+
+    SqliteDatabase db(path);
+    db.exec(fmt::format("DROP TABLE IF EXISTS {}", quotedIdentifier(table)));
+    db.exec(create);
+    db.prepareInsert(insert);
+
+    // As with Parquet row groups, the batch being inserted comes back to be filled again,
+    // so steady state is two batches and no reallocation.
+    RowBatch batch;
+    RowBatch spare;
+    auto& executor = WorkStealingExecutor::sharedIo();
+    std::future<void> inFlight;
+    auto insertBatch = [&] {
+        if (inFlight.valid()) {
+            executor.wait(inFlight);
+        }
+        std::swap(batch, spare);
+        batch.clear();
+        inFlight = executor.submit([&db, &spare, numColumns] {
+            TraceSpan span("sqlite insert");
+            db.insert(spare, numColumns);
+        });
+    };
+
+    fmt::memory_buffer text;
+    OracleLobReader lobReader(stmt.context());
+    uint64_t numRows = 0;
+    try {
+        for (;;) {
+            auto block = stmt.fetchBlock(stmt.fetchArraySize());
+            for (uint32_t col = 1; col <= numColumns; ++col) {
+                if (block.numRows() == 0 || block.nativeType(col) == nativeTypes[col - 1]) {
+                    continue;
+                }
+                // LOB columns may switch to inline values after the first block.
+                if (nativeTypes[col - 1] == DPI_NATIVE_TYPE_LOB && block.nativeType(col) == DPI_NATIVE_TYPE_BYTES) {
+                    nativeTypes[col - 1] = DPI_NATIVE_TYPE_BYTES;
+                } else {
+                    throw std::runtime_error(fmt::format("column {} changed type during the offload",
+                                                         metadata->column(col).name));
+                }
+            }
+
+            for (uint32_t row = 0; row < block.numRows(); ++row) {
+                for (uint32_t col = 1; col <= numColumns; ++col) {
+                    const auto& data = block.columnData(col)[row];
+                    auto& value = batch.values.emplace_back();
+                    if (data.isNull) {
+                        continue;
+                    }
+                    const bool binary = types[col - 1] == SqliteType::Blob;
+                    auto appendBytes = [&](std::string_view bytes) {
+                        value.kind = binary ? RowBatch::Kind::Blob : RowBatch::Kind::Text;
+                        value.begin = batch.bytes.size();
+                        batch.bytes.append(bytes);
+                        value.size = bytes.size();
+                    };
+                    switch (nativeTypes[col - 1]) {
+                    case DPI_NATIVE_TYPE_BOOLEAN:
+                        value.kind = RowBatch::Kind::Integer;
+                        value.asInt = data.value.asBoolean != 0;
+                        break;
+                    case DPI_NATIVE_TYPE_INT64:
+                        value.kind = RowBatch::Kind::Integer;
+                        value.asInt = data.value.asInt64;
+                        break;
+                    case DPI_NATIVE_TYPE_UINT64:
+                        value.kind = RowBatch::Kind::Integer;
+                        value.asInt = static_cast<int64_t>(data.value.asUint64);
+                        break;
+                    case DPI_NATIVE_TYPE_FLOAT:
+                        value.kind = RowBatch::Kind::Real;
+                        value.asDouble = data.value.asFloat;
+                        break;
+                    case DPI_NATIVE_TYPE_DOUBLE:
+                        value.kind = RowBatch::Kind::Real;
+                        value.asDouble = data.value.asDouble;
+                        break;
+                    case DPI_NATIVE_TYPE_TIMESTAMP:
+                        value.kind = RowBatch::Kind::Text;
+                        value.begin = batch.bytes.size();
+                        appendTimestamp(data.value.asTimestamp, withOffset[col - 1], batch.bytes);
+                        value.size = batch.bytes.size() - value.begin;
+                        break;
+                    case DPI_NATIVE_TYPE_BYTES:
+                        appendBytes(std::string_view(data.value.asBytes.ptr, data.value.asBytes.length));
+                        break;
+                    case DPI_NATIVE_TYPE_LOB:
+                        value.kind = binary ? RowBatch::Kind::Blob : RowBatch::Kind::Text;
+                        value.begin = batch.bytes.size();
+                        lobReader.open(data.value.asLOB);
+                        for (auto piece = lobReader.next(); !piece.empty(); piece = lobReader.next()) {
+                            batch.bytes.append(piece);
+                        }
+                        value.size = batch.bytes.size() - value.begin;
+                        break;
+                    default:
+                        text.clear();
+                        formatters[col - 1].format(data, text);
+                        appendBytes(std::string_view(text.data(), text.size()));
+                        break;
+                    }
+                }
+                if (++batch.numRows >= kRowsPerTransaction || batch.byteSize() >= kMaxTransactionBytes) {
+                    insertBatch();
+                }
+            }
+
+            numRows += block.numRows();
+            if (!block.moreRows()) {
+                break;
+            }
+        }
+        if (batch.numRows > 0) {
+            insertBatch();
+        }
+        if (inFlight.valid()) {
+            executor.wait(inFlight);
+        }
+    } catch(...) {
+        if (inFlight.valid()) {
+            executor.waitReady(inFlight);
+        }
+        throw;
+    }
+    return numRows;
+}
+
+} // namespace sqlplusplus
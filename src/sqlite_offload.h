@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace sqlplusplus {
+
+class OracleResultSource;
+
+// Writes every remaining row of an executed query into table in the SQLite database at
+// path, created if it isn't there, so the rows can be worked on locally without running
+// the query again. A table of that name is dropped first. Column types are mapped from
+// the columns' Oracle types: numbers fetched as integers or doubles become INTEGER and
+// REAL, exact NUMBERs NUMERIC, RAWs and BLOBs BLOB, dates and timestamps ISO 8601 TEXT
+// that SQLite's date functions read, and everything else TEXT as the table shows it.
+//
+// Rows go in through one prepared INSERT, kRowsPerTransaction to a transaction; each
+// transaction is inserted and committed on the I/O executor while the next one's rows are
+// fetched. Transactions committed before an error stay in the table. Returns the number
+// of rows written; throws std::runtime_error for SQLite's errors.
+uint64_t offloadToSqlite(OracleResultSource& stmt, const std::string& path, std::string_view table);
+
+} // namespace sqlplusplus
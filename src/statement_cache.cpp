@@ -0,0 +1,68 @@
+#include "statement_cache.h"
+
+namespace sqlplusplus {
+
+OracleStatement StatementCache::prepare(OracleConnection& conn, std::string_view sql) {
+    if (auto it = _index.find(sql); it != _index.end()) {
+        // A cursor closed through a copy, e.g. by a fetch limit, gets prepared again.
+        if (it->second->second.isOpen()) {
+            ++_hits;
+            _entries.splice(_entries.begin(), _entries, it->second);
+            return it->second->second.share();
+        }
+        auto entry = it->second;
+        _index.erase(it);
+        _entries.erase(entry);
+    }
+
+    ++_misses;
+    auto stmt = conn.prepareStatement(sql);
+    if (_capacity == 0) {
+        return stmt;
+    }
+
+    _entries.emplace_front(std::string(sql), stmt.share());
+    _index.emplace(std::string_view(_entries.front().first), _entries.begin());
+    _evictToCapacity();
+    return stmt;
+}
+
+void StatementCache::detach(const OracleStatement& stmt) {
+    for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+        if (it->second.isSameCursor(stmt)) {
+            _index.erase(std::string_view(it->first));
+            _entries.erase(it);
+            return;
+        }
+    }
+}
+
+void StatementCache::setCapacity(size_t capacity) {
+    _capacity = capacity;
+    _evictToCapacity();
+}
+
+void StatementCache::clear() {
+    _index.clear();
+    _entries.clear();
+}
+
+StatementCache::Stats StatementCache::stats() const {
+    Stats ret;
+    ret.hits = _hits;
+    ret.misses = _misses;
+    ret.evictions = _evictions;
+    ret.size = _entries.size();
+    ret.capacity = _capacity;
+    return ret;
+}
+
+void StatementCache::_evictToCapacity() {
+    while (_entries.size() > _capacity) {
+        _index.erase(std::string_view(_entries.back().first));
+        _entries.pop_back();
+        ++_evictions;
+    }
+}
+
+} // namespace sqlplusplus
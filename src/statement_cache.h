@@ -0,0 +1,58 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace sqlplusplus {
+
+// Prepared statements kept open between executions, keyed by their exact SQL text and
+// evicted least recently used first. A hit hands back the already-prepared cursor, so
+// re-running a line skips dpiConn_prepareStmt and the soft parse behind it. Statements
+// that fall out of here still go back to OCI's own statement cache, which is sized with
+// OracleConnectionOptions::stmtCacheSize.
+class StatementCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t size = 0;
+        size_t capacity = 0;
+    };
+
+    explicit StatementCache(size_t capacity) : _capacity(capacity) {}
+
+    // Returns the cached statement for sql, preparing it on conn if it isn't cached. With a
+    // capacity of zero every call prepares.
+    OracleStatement prepare(OracleConnection& conn, std::string_view sql);
+
+    // Drops the entry holding stmt's cursor if there is one, so the next prepare of its SQL
+    // gets a cursor of its own rather than re-executing this one.
+    void detach(const OracleStatement& stmt);
+
+    void setCapacity(size_t capacity);
+    void clear();
+
+    Stats stats() const;
+
+private:
+    using Entry = std::pair<std::string, OracleStatement>;
+
+    void _evictToCapacity();
+
+    size_t _capacity;
+    // Most recently used first. The index's keys point into these strings.
+    std::list<Entry> _entries;
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> _index;
+    uint64_t _hits = 0;
+    uint64_t _misses = 0;
+    uint64_t _evictions = 0;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,44 @@
+#include "statement_timing.h"
+
+#include "fmt/format.h"
+
+#include <string_view>
+
+namespace sqlplusplus {
+namespace {
+
+constexpr std::array<std::string_view, 5> kPhaseNames = {
+    "prepare", "execute", "fetch", "format", "render",
+};
+
+double milliseconds(StatementTiming::Clock::duration elapsed) {
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+} // namespace
+
+std::string StatementTiming::summary() const {
+    fmt::memory_buffer out;
+    auto total = Clock::duration::zero();
+    for (size_t phase = 0; phase < _elapsed.size(); ++phase) {
+        total += _elapsed[phase];
+        fmt::format_to(out, "{} {:.2f} ms", kPhaseNames[phase], milliseconds(_elapsed[phase]));
+        if (static_cast<Phase>(phase) == Phase::Fetch) {
+            fmt::format_to(out, " ({} round trip{})", _fetchRoundTrips, _fetchRoundTrips == 1 ? "" : "s");
+        }
+        fmt::format_to(out, ", ");
+    }
+    fmt::format_to(out, "total {:.2f} ms", milliseconds(total));
+    if (_defineBuffers.rowBytes != 0) {
+        const auto& define = _defineBuffers;
+        fmt::format_to(out, "; define buffers {:.1f} MB, {} rows of {:.1f} KB",
+                static_cast<double>(define.rowBytes) * define.arraySize / (1024 * 1024), define.arraySize,
+                static_cast<double>(define.rowBytes) / 1024);
+        if (define.arraySize < define.requestedArraySize) {
+            fmt::format_to(out, " (capped from {})", define.requestedArraySize);
+        }
+    }
+    return fmt::to_string(out);
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace sqlplusplus {
+
+// Wall-clock breakdown of one statement for .timing: how long it spent being prepared,
+// executed, fetched, formatted and rendered, and how many round trips its fetches took. It
+// tells server and network time apart from what the client spends turning rows into text.
+class StatementTiming {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Phase {
+        Prepare,
+        Execute,
+        Fetch,
+        Format,
+        Render,
+    };
+
+    void reset() noexcept {
+        _elapsed.fill(Clock::duration::zero());
+        _fetchRoundTrips = 0;
+        _defineBuffers = {};
+    }
+
+    void add(Phase phase, Clock::duration elapsed) noexcept {
+        _elapsed[static_cast<size_t>(phase)] += elapsed;
+    }
+
+    void addFetchRoundTrip() noexcept {
+        ++_fetchRoundTrips;
+    }
+
+    // Runs fn, adds the time it took to phase and returns whatever fn returns.
+    template <typename Fn>
+    decltype(auto) measure(Phase phase, Fn&& fn) {
+        Scope scope(*this, phase);
+        return fn();
+    }
+
+    Clock::duration total() const noexcept {
+        auto total = Clock::duration::zero();
+        for (auto elapsed : _elapsed) {
+            total += elapsed;
+        }
+        return total;
+    }
+
+    uint32_t fetchRoundTrips() const noexcept {
+        return _fetchRoundTrips;
+    }
+
+    // How a query's define buffers were laid out: arraySize rows of rowBytes each, cut down
+    // from requestedArraySize when the rows would have taken more than the define limit.
+    void setDefineBuffers(uint64_t rowBytes, uint32_t arraySize, uint32_t requestedArraySize) noexcept {
+        _defineBuffers = {rowBytes, arraySize, requestedArraySize};
+    }
+
+    // e.g. "prepare 0.05 ms, execute 12.31 ms, fetch 3.02 ms (2 round trips), ...", and the
+    // define buffers when they're set, e.g. "; define buffers 3.8 MB, 250 rows of 16.0 KB
+    // (capped from 1000)".
+    std::string summary() const;
+
+private:
+    class Scope {
+    public:
+        Scope(StatementTiming& timing, Phase phase) noexcept :
+            _timing(timing), _phase(phase), _start(Clock::now()) {}
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        ~Scope() {
+            _timing.add(_phase, Clock::now() - _start);
+        }
+
+    private:
+        StatementTiming& _timing;
+        Phase _phase;
+        Clock::time_point _start;
+    };
+
+    struct DefineBuffers {
+        uint64_t rowBytes = 0;
+        uint32_t arraySize = 0;
+        uint32_t requestedArraySize = 0;
+    };
+
+    std::array<Clock::duration, 5> _elapsed{};
+    uint32_t _fetchRoundTrips = 0;
+    DefineBuffers _defineBuffers;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,40 @@
+#include "string_dictionary.h"
+
+#include <stdexcept>
+
+namespace sqlplusplus {
+namespace {
+
+// What the trie takes for an entry besides its key, about.
+constexpr size_t kTrieEntryBytes = 2 * sizeof(uint32_t);
+
+} // namespace
+
+uint32_t StringDictionary::add(std::string_view value) {
+    const bool lookedUp = value.size() <= _maxValueBytes;
+    if (lookedUp) {
+        if (auto it = _ids.find_ks(value.data(), value.size()); it != _ids.end()) {
+            return it.value();
+        }
+    }
+    if (_data.size() + value.size() > UINT32_MAX) {
+        throw std::runtime_error("string dictionary is too big");
+    }
+    const auto id = static_cast<uint32_t>(_ends.size());
+    _data.append(value);
+    _ends.push_back(static_cast<uint32_t>(_data.size()));
+    if (lookedUp && _ids.size() < _maxEntries) {
+        _ids.insert_ks(value.data(), value.size(), id);
+        _internedBytes += value.size() + kTrieEntryBytes;
+    }
+    return id;
+}
+
+void StringDictionary::clear() noexcept {
+    _ids.clear();
+    _internedBytes = 0;
+    _ends.clear();
+    _data.clear();
+}
+
+} // namespace sqlplusplus
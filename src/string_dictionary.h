@@ -0,0 +1,62 @@
+#pragma once
+
+#include "tsl/htrie_map.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+// Numbers strings from 0 in the order they're added, keeping each distinct value's bytes
+// once: back to back, with the offset every value ends at, the way spill batches lay them
+// out. Results repeat the same few status codes and names over and over, so a cell can be
+// kept as an id into its column's dictionary rather than as its bytes.
+//
+// Only values up to maxValueBytes are looked up, and only until maxEntries of them have
+// been interned; anything past that is stored again under an id of its own. A column of
+// distinct values then costs about what storing them plainly would, and the lookup trie
+// stays bounded however many rows go by.
+class StringDictionary {
+public:
+    StringDictionary(uint32_t maxEntries, size_t maxValueBytes) :
+        _maxEntries(maxEntries),
+        _maxValueBytes(maxValueBytes)
+    {}
+
+    // Returns value's id. Throws std::runtime_error once the values stop fitting in 4GB.
+    uint32_t add(std::string_view value);
+
+    std::string_view value(uint32_t id) const noexcept {
+        const auto begin = id == 0 ? 0 : _ends[id - 1];
+        return std::string_view(_data.data() + begin, _ends[id] - begin);
+    }
+
+    uint32_t size() const noexcept {
+        return static_cast<uint32_t>(_ends.size());
+    }
+    // Of the values and their offsets, plus roughly what the lookup trie takes.
+    size_t bytes() const noexcept {
+        return _data.size() + _ends.size() * sizeof(uint32_t) + _internedBytes;
+    }
+    const std::vector<uint32_t>& ends() const noexcept {
+        return _ends;
+    }
+    const std::string& data() const noexcept {
+        return _data;
+    }
+
+    void clear() noexcept;
+
+private:
+    uint32_t _maxEntries;
+    size_t _maxValueBytes;
+    tsl::htrie_map<char, uint32_t> _ids;
+    size_t _internedBytes = 0;
+    std::vector<uint32_t> _ends;
+    std::string _data;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,79 @@
+#include "substring_search.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace sqlplusplus {
+
+size_t findSubstring(std::string_view haystack, std::string_view needle, size_t from) noexcept {
+    const auto size = haystack.size();
+    const auto length = needle.size();
+    if (from > size || length > size - from) {
+        return std::string_view::npos;
+    }
+    if (length == 0) {
+        return from;
+    }
+    const auto data = haystack.data();
+    if (length == 1) {
+        const auto found = std::memchr(data + from, needle[0], size - from);
+        return found == nullptr ? std::string_view::npos : static_cast<size_t>(static_cast<const char*>(found) - data);
+    }
+    // The last position needle can start at.
+    const auto lastStart = size - length;
+    size_t pos = from;
+    // Bit i of a mask is set when position pos + i starts with needle's first byte and has its
+    // last byte length - 1 further on; the bytes in between are compared for those alone.
+#if defined(__AVX2__)
+    const __m256i first = _mm256_set1_epi8(needle.front());
+    const __m256i last = _mm256_set1_epi8(needle.back());
+    for (; pos + 32 <= lastStart + 1; pos += 32) {
+        const auto starts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        const auto ends = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + length - 1));
+        auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(starts, first), _mm256_cmpeq_epi8(ends, last))));
+        for (; mask != 0; mask &= mask - 1) {
+            const auto at = pos + static_cast<size_t>(__builtin_ctz(mask));
+            if (std::memcmp(data + at + 1, needle.data() + 1, length - 2) == 0) {
+                return at;
+            }
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i first = _mm_set1_epi8(needle.front());
+    const __m128i last = _mm_set1_epi8(needle.back());
+    for (; pos + 16 <= lastStart + 1; pos += 16) {
+        const auto starts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        const auto ends = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + length - 1));
+        auto mask = static_cast<uint32_t>(_mm_movemask_epi8(
+                _mm_and_si128(_mm_cmpeq_epi8(starts, first), _mm_cmpeq_epi8(ends, last))));
+        for (; mask != 0; mask &= mask - 1) {
+            const auto at = pos + static_cast<size_t>(__builtin_ctz(mask));
+            if (std::memcmp(data + at + 1, needle.data() + 1, length - 2) == 0) {
+                return at;
+            }
+        }
+    }
+#endif
+    // What's left, or all of it without SSE2: memchr to each first byte.
+    while (pos <= lastStart) {
+        const auto found = static_cast<const char*>(std::memchr(data + pos, needle[0], lastStart + 1 - pos));
+        if (found == nullptr) {
+            break;
+        }
+        const auto at = static_cast<size_t>(found - data);
+        if (std::memcmp(data + at + 1, needle.data() + 1, length - 1) == 0) {
+            return at;
+        }
+        pos = at + 1;
+    }
+    return std::string_view::npos;
+}
+
+} // namespace sqlplusplus
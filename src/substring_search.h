@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace sqlplusplus {
+
+// Where needle first occurs in haystack at or after from, or std::string_view::npos. An
+// empty needle is found at from. Candidates are found 16 bytes at a time, or 32 with AVX2,
+// by comparing every position with needle's first and last bytes at once; only positions
+// where both match get compared in full, so a scan costs about what a memchr does even
+// when needle's first byte is common. Compared byte for byte, so case matters.
+size_t findSubstring(std::string_view haystack, std::string_view needle, size_t from = 0) noexcept;
+
+} // namespace sqlplusplus
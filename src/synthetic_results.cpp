@@ -0,0 +1,114 @@
+#include "synthetic_results.h"
+
+#include "result_metadata.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace sqlplusplus {
+
+SyntheticResultSource::SyntheticResultSource(std::vector<Column> columns, uint64_t numRows, uint32_t fetchArraySize) :
+    _columns(std::move(columns)),
+    _buffers(_columns.size()),
+    _numRows(numRows),
+    _fetchArraySize(std::max<uint32_t>(fetchArraySize, 1))
+{
+    for (size_t idx = 0; idx < _columns.size(); ++idx) {
+        auto& buffer = _buffers[idx];
+        buffer.data.resize(_fetchArraySize);
+        if (_columns[idx].nativeType == DPI_NATIVE_TYPE_BYTES) {
+            buffer.bytes.resize(static_cast<size_t>(_columns[idx].valueBytes) * _fetchArraySize);
+        }
+    }
+    _generateBuffers();
+    _metadata = std::make_shared<const ResultMetadata>(*this);
+}
+
+OracleColumnInfo SyntheticResultSource::getColumnInfo(uint32_t pos) const {
+    const auto& column = _columns.at(pos - 1);
+    dpiQueryInfo info;
+    std::memset(&info, 0, sizeof(info));
+    info.name = column.name.c_str();
+    info.nameLength = static_cast<uint32_t>(column.name.size());
+    info.nullOk = column.nullEvery != 0;
+    info.typeInfo.oracleTypeNum = column.oracleType;
+    info.typeInfo.defaultNativeTypeNum = column.nativeType;
+    info.typeInfo.dbSizeInBytes = column.valueBytes;
+    info.typeInfo.sizeInChars = column.valueBytes;
+    return OracleColumnInfo(info);
+}
+
+void SyntheticResultSource::_generateBuffers() {
+    for (size_t idx = 0; idx < _columns.size(); ++idx) {
+        const auto& column = _columns[idx];
+        auto& buffer = _buffers[idx];
+        for (uint32_t row = 0; row < _fetchArraySize; ++row) {
+            const uint64_t rowNum = row;
+            auto& data = buffer.data[row];
+            data.isNull = column.nullEvery != 0 && rowNum % column.nullEvery == column.nullEvery - 1;
+            auto& value = data.value;
+            switch (column.nativeType) {
+            case DPI_NATIVE_TYPE_INT64:
+                value.asInt64 = static_cast<int64_t>(rowNum * 2654435761u % 2000000000) - 1000000000;
+                break;
+            case DPI_NATIVE_TYPE_UINT64:
+                value.asUint64 = rowNum * 2654435761u;
+                break;
+            case DPI_NATIVE_TYPE_DOUBLE:
+                value.asDouble = static_cast<double>(rowNum) / 7.0;
+                break;
+            case DPI_NATIVE_TYPE_FLOAT:
+                value.asFloat = static_cast<float>(rowNum) / 7.0f;
+                break;
+            case DPI_NATIVE_TYPE_BOOLEAN:
+                value.asBoolean = rowNum % 2;
+                break;
+            case DPI_NATIVE_TYPE_TIMESTAMP:
+                value.asTimestamp = dpiTimestamp{static_cast<int16_t>(2000 + rowNum % 30),
+                    static_cast<uint8_t>(1 + rowNum % 12), static_cast<uint8_t>(1 + rowNum % 28),
+                    static_cast<uint8_t>(rowNum % 24), static_cast<uint8_t>(rowNum % 60),
+                    static_cast<uint8_t>(rowNum % 60), static_cast<uint32_t>(rowNum % 1000) * 1000000, 0, 0};
+                break;
+            case DPI_NATIVE_TYPE_BYTES: {
+                auto ptr = buffer.bytes.data() + static_cast<size_t>(row) * column.valueBytes;
+                for (uint32_t pos = 0; pos < column.valueBytes; ++pos) {
+                    ptr[pos] = static_cast<char>('a' + (rowNum + pos) % 26);
+                }
+                value.asBytes.ptr = ptr;
+                value.asBytes.length = column.valueBytes;
+                break;
+            }
+            default:
+                throw std::invalid_argument("unsupported native type for synthetic results");
+            }
+        }
+    }
+}
+
+OracleFetchBlock SyntheticResultSource::fetchBlock(uint32_t maxRows) {
+    if (_bufferPos == _bufferRows) {
+        if (_nextRow == _numRows) {
+            return OracleFetchBlock();
+        }
+        _bufferRows = static_cast<uint32_t>(std::min<uint64_t>(_fetchArraySize, _numRows - _nextRow));
+        _bufferPos = 0;
+        _nextRow += _bufferRows;
+    }
+    const auto bufferRowIndex = _bufferPos;
+    const auto numRows = std::min(maxRows, _bufferRows - _bufferPos);
+    std::vector<OracleFetchBlock::Column> columns;
+    columns.reserve(_columns.size());
+    for (size_t idx = 0; idx < _columns.size(); ++idx) {
+        columns.push_back({_columns[idx].nativeType, _buffers[idx].data.data() + bufferRowIndex});
+    }
+    _bufferPos += numRows;
+    const bool moreRows = _bufferPos < _bufferRows || _nextRow < _numRows;
+    return OracleFetchBlock(std::move(columns), numRows, bufferRowIndex, moreRows);
+}
+
+const dpiJsonNode& SyntheticResultSource::jsonValue(const dpiData&, uint32_t) const {
+    throw std::logic_error("synthetic results have no JSON columns");
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sqlplusplus {
+
+// A stand-in for an executed query that hands out generated rows, so the fetch, decode and
+// render paths can be measured without a database. Like the real thing, values live in
+// per-column define buffers of fetchArraySize() rows and blocks point straight into them.
+// The buffers are generated once and handed out again for every "round trip", so none of
+// the time measured goes into making up values.
+class SyntheticResultSource : public OracleResultSource {
+public:
+    struct Column {
+        std::string name;
+        // One of INT64, UINT64, DOUBLE, FLOAT, BOOLEAN, BYTES or TIMESTAMP.
+        dpiNativeTypeNum nativeType = DPI_NATIVE_TYPE_INT64;
+        dpiOracleTypeNum oracleType = DPI_ORACLE_TYPE_NUMBER;
+        // Length of generated BYTES values.
+        uint32_t valueBytes = 16;
+        // Every nullEvery'th value is null; 0 means none are.
+        uint32_t nullEvery = 0;
+    };
+
+    SyntheticResultSource(std::vector<Column> columns, uint64_t numRows, uint32_t fetchArraySize = 100);
+
+    uint32_t numColumns() const override {
+        return static_cast<uint32_t>(_columns.size());
+    }
+    OracleColumnInfo getColumnInfo(uint32_t pos) const override;
+    std::shared_ptr<const ResultMetadata> metadata() const override {
+        return _metadata;
+    }
+    uint32_t fetchArraySize() const override {
+        return _fetchArraySize;
+    }
+    OracleFetchBlock fetchBlock(uint32_t maxRows) override;
+    // There are no JSON columns; throws std::logic_error.
+    const dpiJsonNode& jsonValue(const dpiData& data, uint32_t options) const override;
+    const OracleContext* context() const noexcept override {
+        return nullptr;
+    }
+
+    // Starts the rows over from the beginning.
+    void rewind() noexcept {
+        _nextRow = 0;
+        _bufferRows = 0;
+        _bufferPos = 0;
+    }
+
+private:
+    struct ColumnBuffer {
+        std::vector<dpiData> data;
+        // Backing storage for BYTES values.
+        std::string bytes;
+    };
+
+    void _generateBuffers();
+
+    std::vector<Column> _columns;
+    std::vector<ColumnBuffer> _buffers;
+    uint64_t _numRows;
+    uint32_t _fetchArraySize;
+    std::shared_ptr<const ResultMetadata> _metadata;
+    uint64_t _nextRow = 0;
+    uint32_t _bufferRows = 0;
+    uint32_t _bufferPos = 0;
+};
+
+} // namespace sqlplusplus
@@ -1,11 +1,35 @@
 #include "table.h"
 
+#include "client_counters.h"
+#include "display_width.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
 #include <iostream>
-#include <map>
+#include <limits>
 
 #include "fmt/format.h"
 
 namespace sqlplusplus {
+namespace {
+// Display width of a cell is the width of its widest line.
+size_t maxLineWidth(std::string_view value) {
+    size_t widest = 0;
+    const char* pos = value.data();
+    const char* end = pos + value.size();
+    while (pos != end) {
+        auto newLine = static_cast<const char*>(std::memchr(pos, '\n', static_cast<size_t>(end - pos)));
+        auto lineEnd = newLine ? newLine : end;
+        widest = std::max(widest, displayWidth(std::string_view(pos, static_cast<size_t>(lineEnd - pos))));
+        if (newLine == nullptr) {
+            break;
+        }
+        pos = newLine + 1;
+    }
+    return widest;
+}
+} // namespace
 
 Table::Table(Width numColumns) :
     columns(numColumns)
@@ -13,7 +37,11 @@ Table::Table(Width numColumns) :
 
 Table::RowIndex Table::addRow() {
     auto rowIndex = numRows++;
-    values.resize((rowIndex * columns.size()) + columns.size());
+    const auto capacity = cells.capacity();
+    cells.resize((rowIndex * columns.size()) + columns.size());
+    if (cells.capacity() != capacity) {
+        ++_cellGrowths;
+    }
     return rowIndex;
 }
 
@@ -32,96 +60,337 @@ size_t Table::_resolveValueIdx(RowIndex row, Width column) const {
     return (row * columns.size()) + column;
 }
 
-const std::string& Table::columnValue(RowIndex row, Width column) const {
-    return values.at(_resolveValueIdx(row, column));
+std::string_view Table::columnValue(RowIndex row, Width column) const {
+    const auto& cell = cells[_resolveValueIdx(row, column)];
+    return std::string_view(cell.data, cell.length);
 }
 
-void Table::setColumnValue(RowIndex row, Width column, std::string value) {
-    if (value.size() > std::numeric_limits<Width>::max()) {
+void Table::_checkValueSize(size_t size) {
+    if (size > std::numeric_limits<Width>::max()) {
         throw std::runtime_error("table value width over flow");
     }
+}
 
-    auto& strValue = values.at(_resolveValueIdx(row, column));
-    strValue = std::move(value);
-    auto& colInfo = columns.at(column);
-    colInfo.minValueWidth = std::min(colInfo.minValueWidth, static_cast<Width>(strValue.size()));
-    colInfo.maxValueWidth = std::max(colInfo.maxValueWidth, static_cast<Width>(strValue.size()));
+void Table::setColumnValue(RowIndex row, Width column, std::string_view value) {
+    _checkValueSize(value.size());
+    _storeCell(row, column, cellStorage.append(value));
 }
 
-void Table::render(std::ostream& out) {
-    if (numRows == 0 || columns.size() == 0) {
-        return;
+void Table::setColumnView(RowIndex row, Width column, std::string_view value) {
+    _checkValueSize(value.size());
+    _storeCell(row, column, value);
+}
+
+void Table::_storeCell(RowIndex row, Width column, std::string_view stored) {
+    auto& cell = cells[_resolveValueIdx(row, column)];
+    cell.data = stored.data();
+    cell.length = static_cast<Width>(stored.size());
+    const auto width = static_cast<Width>(maxLineWidth(stored));
+    auto& colInfo = columns[column];
+    colInfo.minValueWidth = std::min(colInfo.minValueWidth, width);
+    colInfo.maxValueWidth = std::max(colInfo.maxValueWidth, width);
+}
+
+Table::Width Table::_columnWidth(Width column) const {
+    return _frozenWidths[column];
+}
+
+void Table::setColumnWidthLimit(Width width) {
+    for (auto& column : columns) {
+        column.configuredWidth = width;
     }
+}
 
-    for (RowIndex rowIndex = 0; rowIndex < numRows; ++rowIndex) {
-        const auto& borders = (rowIndex == 0) ? firstRowBorders : otherRowBorders;
-        out << borders.left;
+void Table::_fixWidths() {
+    _frozenWidths.resize(columns.size());
+    uint64_t total = 0;
+    for (Width colIndex = 0; colIndex < columns.size(); ++colIndex) {
+        const auto& columnInfo = columns[colIndex];
+        auto width = std::max<Width>(columnInfo.maxValueWidth, 1);
+        if (columnInfo.configuredWidth != 0) {
+            width = std::min(width, columnInfo.configuredWidth);
+        }
+        _frozenWidths[colIndex] = width;
+    }
+    if (_carriedWidths) {
+        auto& carried = *_carriedWidths;
+        if (carried.size() != columns.size()) {
+            carried = _frozenWidths;
+        }
         for (Width colIndex = 0; colIndex < columns.size(); ++colIndex) {
-            const auto& columnInfo = columns.at(colIndex);
-            const auto columnWidth = std::max(columnInfo.configuredWidth, columnInfo.maxValueWidth);
-            if (colIndex != 0) {
-                out << borders.divider;
-            }
-            for (Width idx = 0; idx < columnWidth + (padding * 2); ++idx) {
-                out << borders.rowBorder;
+            auto& width = _frozenWidths[colIndex];
+            if (width > carried[colIndex]) {
+                auto grown = width + width / 4;
+                if (columns[colIndex].configuredWidth != 0) {
+                    grown = std::min(grown, columns[colIndex].configuredWidth);
+                }
+                carried[colIndex] = grown;
             }
+            width = carried[colIndex];
+        }
+    }
+    for (auto width : _frozenWidths) {
+        total += width;
+    }
+    if (maxTableWidth == 0) {
+        return;
+    }
+
+    // Everything on a line that isn't a value: a border either side of every column and
+    // the padding inside them.
+    const auto numColumns = static_cast<uint64_t>(columns.size());
+    const uint64_t overhead = (numColumns + 1) * displayWidth(otherRowBorders.cellBorder) +
+            numColumns * padding * 2;
+    if (total + overhead <= maxTableWidth) {
+        return;
+    }
+    const uint64_t available = maxTableWidth > overhead ? maxTableWidth - overhead : 0;
+
+    // Find the widest any column can be for the rest to fit, taking the widest columns
+    // down to it: with the widths sorted widest first, capping the first n at cap leaves
+    // the sum of the others plus n * cap.
+    std::vector<Width> sorted(_frozenWidths);
+    std::sort(sorted.begin(), sorted.end(), std::greater<Width>());
+    uint64_t rest = total;
+    uint64_t cap = kMinFittedWidth;
+    for (size_t capped = 1; capped <= sorted.size(); ++capped) {
+        rest -= sorted[capped - 1];
+        const auto next = capped < sorted.size() ? sorted[capped] : 0;
+        if (rest + capped * static_cast<uint64_t>(next) <= available) {
+            cap = std::max<uint64_t>((available - rest) / capped, kMinFittedWidth);
+            break;
         }
-        out << borders.right << "\n";
-
-        std::map<Width, std::string> remainingFromCurrentRow;
-        bool hasIncompleteRows;
-        do {
-            hasIncompleteRows = false;
-            for (Width colIndex = 0; colIndex < columns.size(); ++colIndex) {
-                const auto& columnInfo = columns.at(colIndex);
-                const auto columnWidth = std::max(columnInfo.configuredWidth, columnInfo.maxValueWidth);
-                std::string ownedCurrentWrappedSegment;
-                const auto& value = [&]{
-                    if (remainingFromCurrentRow.find(colIndex) == remainingFromCurrentRow.end()) {
-                        const auto& fullValue = columnValue(rowIndex, colIndex);
-                        auto newLineAt = fullValue.find_first_of("\n");
-                        if (newLineAt == std::string::npos) {
-                            remainingFromCurrentRow[colIndex] = "";
-                            return fullValue;
-                        }
-
-                        ownedCurrentWrappedSegment = fullValue.substr(0, newLineAt);
-                        remainingFromCurrentRow.insert({colIndex, fullValue.substr(newLineAt + 1)});
-                        hasIncompleteRows = true;
-                    } else {
-                        const auto& remaining = remainingFromCurrentRow[colIndex];
-                        auto newlineAt = remaining.find_first_of("\n");
-                        if (newlineAt != std::string::npos) {
-                            ownedCurrentWrappedSegment = remaining.substr(0, newlineAt);
-                            remainingFromCurrentRow[colIndex] = remaining.substr(newlineAt + 1);
-                            hasIncompleteRows = true;
-                        } else {
-                            ownedCurrentWrappedSegment = remaining;
-                            remainingFromCurrentRow[colIndex] = "";
-                        }
-                    }
-                    
-                    return ownedCurrentWrappedSegment;
-                }();
-                fmt::print("{0}{1: >{2}}{3}{1: >{4}}",
-                        borders.cellBorder, "", padding, value, (columnWidth - value.size()) + padding);
+    }
+    for (auto& width : _frozenWidths) {
+        width = static_cast<Width>(std::min<uint64_t>(width, cap));
+    }
+}
+
+namespace {
+// Rendered lines are collected in a memory buffer and handed to the stream in chunks of
+// about this size, rather than one operator<< per glyph.
+constexpr size_t kOutputChunkSize = 64 * 1024;
+
+void appendRepeated(fmt::memory_buffer& buf, std::string_view str, size_t count) {
+    if (str.size() == 1) {
+        buf.resize(buf.size() + count);
+        std::fill_n(buf.data() + buf.size() - count, count, str.front());
+        return;
+    }
+    for (size_t idx = 0; idx < count; ++idx) {
+        buf.append(str.data(), str.data() + str.size());
+    }
+}
+
+void append(fmt::memory_buffer& buf, std::string_view str) {
+    buf.append(str.data(), str.data() + str.size());
+}
+
+void writeBuffer(std::ostream& out, fmt::memory_buffer& buf) {
+    out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    buf.clear();
+}
+
+constexpr std::string_view kEllipsis = "…";
+
+// Splits value into lines at each newline, and wherever a line gets wider than maxWidth
+// columns if maxWidth is non-zero. Always produces at least one (possibly empty) line.
+template <typename Span>
+void splitLines(std::string_view value, size_t maxWidth, std::vector<Span>& out) {
+    const char* pos = value.data();
+    const char* end = pos + value.size();
+    for (;;) {
+        auto newLine = static_cast<const char*>(
+                pos == end ? nullptr : std::memchr(pos, '\n', static_cast<size_t>(end - pos)));
+        std::string_view line(pos, static_cast<size_t>((newLine ? newLine : end) - pos));
+        size_t width = 0;
+        while (maxWidth > 0 && !line.empty()) {
+            const auto length = prefixForWidth(line, maxWidth, width);
+            if (length == line.size()) {
+                break;
             }
-            out << borders.cellBorder << "\n";
-        } while(hasIncompleteRows);
+            out.push_back({line.substr(0, length), width});
+            line.remove_prefix(length);
+            width = 0;
+        }
+        if (maxWidth == 0 || line.empty()) {
+            width = displayWidth(line);
+        }
+        out.push_back({line, width});
+        if (newLine == nullptr) {
+            return;
+        }
+        pos = newLine + 1;
+    }
+}
+
+// Just the first line of value, cut to end in an ellipsis if it, or the value, goes on
+// past maxWidth columns.
+template <typename Span>
+void truncateLine(std::string_view value, size_t maxWidth, std::vector<Span>& out) {
+    const auto newLine = value.find('\n');
+    auto line = value.substr(0, newLine);
+    size_t width = 0;
+    auto length = prefixForWidth(line, maxWidth, width);
+    if (length == line.size() && newLine == std::string_view::npos) {
+        out.push_back({line, width});
+        return;
+    }
+    // The ellipsis takes a column of its own.
+    length = maxWidth > 1 ? prefixForWidth(line, maxWidth - 1, width) : 0;
+    if (length == 0) {
+        width = 0;
     }
-   
-    out << lastRowBorders.left;
+    out.push_back({line.substr(0, length), width + 1, true});
+}
+} // namespace
+
+std::string Table::_borderLine(const CellBorder& borders) const {
+    fmt::memory_buffer buf;
+    append(buf, borders.left);
     for (Width colIndex = 0; colIndex < columns.size(); ++colIndex) {
         if (colIndex != 0) {
-            std::cout << lastRowBorders.divider;
+            append(buf, borders.divider);
+        }
+        appendRepeated(buf, borders.rowBorder, _columnWidth(colIndex) + (padding * 2));
+    }
+    append(buf, borders.right);
+    append(buf, "\n");
+    return fmt::to_string(buf);
+}
+
+void Table::_renderRow(fmt::memory_buffer& buf, RowIndex rowIndex, const CellBorder& borders) const {
+    // Lay the row out once up front: every cell is split into line spans at each newline
+    // and wherever it's wider than its column, then the output lines are just walks over
+    // the spans. The spans point into the cell arena, nothing is copied.
+    _lineSpans.clear();
+    _cellLineStart.resize(columns.size() + 1);
+    size_t numLines = 0;
+    for (Width colIndex = 0; colIndex < columns.size(); ++colIndex) {
+        _cellLineStart[colIndex] = _lineSpans.size();
+        if (truncate) {
+            truncateLine(columnValue(rowIndex, colIndex), _columnWidth(colIndex), _lineSpans);
+        } else {
+            splitLines(columnValue(rowIndex, colIndex), _columnWidth(colIndex), _lineSpans);
+        }
+        numLines = std::max(numLines, _lineSpans.size() - _cellLineStart[colIndex]);
+    }
+    _cellLineStart[columns.size()] = _lineSpans.size();
+
+    for (size_t lineIndex = 0; lineIndex < numLines; ++lineIndex) {
+        for (Width colIndex = 0; colIndex < columns.size(); ++colIndex) {
+            const auto columnWidth = _columnWidth(colIndex);
+            const auto spanIndex = _cellLineStart[colIndex] + lineIndex;
+            LineSpan value{};
+            if (spanIndex < _cellLineStart[colIndex + 1]) {
+                value = _lineSpans[spanIndex];
+            }
+
+            append(buf, borders.cellBorder);
+            appendRepeated(buf, " ", padding);
+            append(buf, value.text);
+            if (value.cut) {
+                append(buf, kEllipsis);
+            }
+            // A wide character alone on its line can be wider than a one column column.
+            appendRepeated(buf, " ", (columnWidth - std::min<size_t>(value.width, columnWidth)) + padding);
+        }
+        append(buf, borders.cellBorder);
+        append(buf, "\n");
+    }
+}
+
+void Table::render(std::ostream& out) {
+    if (numRows == 0 || columns.size() == 0) {
+        return;
+    }
+
+    _fixWidths();
+    const auto firstBorderLine = _borderLine(firstRowBorders);
+    const auto otherBorderLine = _borderLine(otherRowBorders);
+    auto& buf = _renderBuffer;
+    buf.clear();
+    for (RowIndex rowIndex = 0; rowIndex < numRows; ++rowIndex) {
+        append(buf, (rowIndex == 0) ? firstBorderLine : otherBorderLine);
+        _renderRow(buf, rowIndex, (rowIndex == 0) ? firstRowBorders : otherRowBorders);
+        if (buf.size() >= kOutputChunkSize) {
+            writeBuffer(out, buf);
         }
-        const auto& columnInfo = columns.at(colIndex);
-        const auto columnWidth = std::max(columnInfo.configuredWidth, columnInfo.maxValueWidth);
-        for (Width idx = 0; idx < columnWidth + (padding * 2); ++idx) {
-            out << lastRowBorders.rowBorder;
+    }
+
+    append(buf, _borderLine(lastRowBorders));
+    writeBuffer(out, buf);
+    out << std::flush;
+    _reportCounters(numRows);
+    _frozenWidths.clear();
+}
+
+void Table::beginStreaming(std::ostream& out, std::vector<Width>* carriedWidths) {
+    _streamOut = &out;
+    _carriedWidths = carriedWidths;
+    _frozenWidths.clear();
+    _flushedRows = 0;
+    // Whatever a table streamed before left unflushed, if it stopped short.
+    _clearRows();
+    for (auto& column : columns) {
+        column.minValueWidth = 0;
+        column.maxValueWidth = 0;
+    }
+}
+
+void Table::flush() {
+    if (_streamOut == nullptr || columns.size() == 0) {
+        return;
+    }
+
+    if (_frozenWidths.empty()) {
+        _fixWidths();
+        _firstBorderLine = _borderLine(firstRowBorders);
+        _otherBorderLine = _borderLine(otherRowBorders);
+    }
+
+    auto& buf = _renderBuffer;
+    buf.clear();
+    for (RowIndex rowIndex = 0; rowIndex < numRows; ++rowIndex) {
+        const bool isFirst = _flushedRows == 0;
+        append(buf, isFirst ? _firstBorderLine : _otherBorderLine);
+        _renderRow(buf, rowIndex, isFirst ? firstRowBorders : otherRowBorders);
+        ++_flushedRows;
+        if (buf.size() >= kOutputChunkSize) {
+            writeBuffer(*_streamOut, buf);
         }
     }
-    out << lastRowBorders.right << std::endl;
+    writeBuffer(*_streamOut, buf);
+    _reportCounters(numRows);
+    _clearRows();
+    *_streamOut << std::flush;
+}
+
+void Table::endStreaming() {
+    if (_streamOut == nullptr) {
+        return;
+    }
+    flush();
+    if (_flushedRows != 0) {
+        *_streamOut << _borderLine(lastRowBorders) << std::flush;
+    }
+    _streamOut = nullptr;
+    _carriedWidths = nullptr;
+    _frozenWidths.clear();
+}
+
+void Table::_reportCounters(RowIndex renderedRows) {
+    const auto arenaBlocks = cellStorage.blocksAllocated();
+    clientCounters.add(ClientCounter::RowsRendered, renderedRows);
+    clientCounters.add(ClientCounter::TableAllocations, _cellGrowths + arenaBlocks - _reportedArenaBlocks);
+    _cellGrowths = 0;
+    _reportedArenaBlocks = arenaBlocks;
+}
+
+void Table::_clearRows() {
+    cells.clear();
+    cellStorage.reset();
+    numRows = 0;
 }
 
 } // namespace sqlplusplus
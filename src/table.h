@@ -1,6 +1,13 @@
 #pragma once
 
+#include "arena.h"
+
+#include "fmt/format.h"
+
+#include <cstdint>
+#include <iosfwd>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace sqlplusplus {
@@ -12,19 +19,41 @@ public:
     struct Column {
         Width minValueWidth = 0;
         Width maxValueWidth = 0;
+        // The widest the column is drawn, whatever its values; 0 is no limit. Wider values
+        // are wrapped or cut, see truncate.
         Width configuredWidth = 0;
     };
 
     explicit Table(Width numColumns);
 
     RowIndex addRow();
-    const std::string& columnValue(RowIndex row, Width column) const;
-    void setColumnValue(RowIndex row, Width column, std::string value);
-    void setColumnValue(RowIndex row, Width column, std::string_view value) {
-        setColumnValue(row, column, std::string(value));
+    std::string_view columnValue(RowIndex row, Width column) const;
+    // Copies value into the table's cell arena.
+    void setColumnValue(RowIndex row, Width column, std::string_view value);
+    // Points the cell at value where it is, which has to outlive the table.
+    void setColumnView(RowIndex row, Width column, std::string_view value);
+
+    // Writes a value straight into the cell arena instead of copying it in. write(char*)
+    // gets at least sizeBound bytes of storage and returns the end of what it wrote.
+    template <typename WriteFn>
+    void emplaceColumnValue(RowIndex row, Width column, size_t sizeBound, WriteFn&& write) {
+        _checkValueSize(sizeBound);
+        auto ptr = cellStorage.allocate(sizeBound);
+        auto end = write(ptr);
+        const auto size = static_cast<size_t>(end - ptr);
+        cellStorage.shrinkLast(sizeBound - size);
+        _storeCell(row, column, std::string_view(ptr, size));
     }
 
-    std::vector<std::string> values;
+    // Cells point into cellStorage, so they're a row-major list of (pointer, length) pairs
+    // rather than one heap allocated string per cell.
+    struct Cell {
+        const char* data = nullptr;
+        Width length = 0;
+    };
+
+    std::vector<Cell> cells;
+    StringArena cellStorage;
     std::vector<Column> columns;
     RowIndex numRows = 0;
 
@@ -41,9 +70,86 @@ public:
     CellBorder lastRowBorders = { "└", "┴", "┘" };
     Width padding = 1;
 
+    // The widest a whole line of the table may be, borders included, e.g. the terminal's
+    // width; 0 is no limit. The widest columns give up width first, but none is shrunk
+    // below kMinFittedWidth, so a table with many columns can still be wider.
+    Width maxTableWidth = 0;
+    static constexpr Width kMinFittedWidth = 8;
+    // Values wider than their column are wrapped onto continuation lines, or with truncate
+    // shown as the first line cut to fit and ending in an ellipsis, so a row is one line
+    // however long its values are.
+    bool truncate = false;
+
+    // Sets every column's configuredWidth.
+    void setColumnWidthLimit(Width width);
+
     void render(std::ostream& out);
 
+    // Streaming output. Rows added after beginStreaming() are buffered until flush() is
+    // called. The first flush() freezes the column widths from the rows buffered so far
+    // (the sample window) and every flush writes out and discards the buffered rows, so
+    // memory only ever holds one batch. Values wider than a frozen column are wrapped onto
+    // continuation lines. endStreaming() flushes and writes the closing border.
+    //
+    // With carriedWidths, the widths are carried over from the tables streamed with it
+    // before, e.g. the earlier pages of a result: a column is never drawn narrower than
+    // it was, and one that has to widen takes a quarter again as much room, so a page or
+    // two of slightly longer values don't shift the layout every time. The table's value
+    // widths start over, so one table can be streamed again and again, keeping its storage.
+    void beginStreaming(std::ostream& out, std::vector<Width>* carriedWidths = nullptr);
+    void flush();
+    void endStreaming();
+    bool isStreaming() const noexcept {
+        return _streamOut != nullptr;
+    }
+
 private:
     size_t _resolveValueIdx(RowIndex row, Width column) const;
+    static void _checkValueSize(size_t size);
+    void _storeCell(RowIndex row, Width column, std::string_view stored);
+    Width _columnWidth(Width column) const;
+    // Lays the columns out from the values added so far, the limits and maxTableWidth.
+    void _fixWidths();
+    std::string _borderLine(const CellBorder& borders) const;
+    void _renderRow(fmt::memory_buffer& buf, RowIndex rowIndex, const CellBorder& borders) const;
+    void _clearRows();
+    // Adds the rows just written out and the allocations made since the last report to the
+    // client counters.
+    void _reportCounters(RowIndex renderedRows);
+
+    std::ostream* _streamOut = nullptr;
+    std::vector<Width>* _carriedWidths = nullptr;
+    // Set by render() for its duration, and by the first flush() until endStreaming().
+    std::vector<Width> _frozenWidths;
+    RowIndex _flushedRows = 0;
+    // One line of a cell as it's laid out, with its display width.
+    struct LineSpan {
+        std::string_view text;
+        size_t width;
+        // The line was cut short, and is drawn with an ellipsis after it.
+        bool cut = false;
+    };
+    // Scratch space for _renderRow's line layout, kept to reuse its capacity across rows.
+    mutable std::vector<LineSpan> _lineSpans;
+    mutable std::vector<size_t> _cellLineStart;
+    // What render() and flush() write out, kept so a streamed table stops allocating once
+    // it has grown to an output chunk.
+    fmt::memory_buffer _renderBuffer;
+    uint64_t _cellGrowths = 0;
+    size_t _reportedArenaBlocks = 0;
+    std::string _firstBorderLine;
+    std::string _otherBorderLine;
 };
+
+// What the pages of one result, streamed one after another, share: a table whose storage
+// each page reuses, and the column widths so far.
+struct PagedTable {
+    explicit PagedTable(Table::Width numColumns) : table(numColumns) {}
+
+    Table table;
+    std::vector<Table::Width> widths;
+    // Rows printed so far, which the vertical layout numbers its records on from.
+    uint64_t records = 0;
+};
+
 } // namespace sqlplusplus
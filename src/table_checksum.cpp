@@ -0,0 +1,96 @@
+#include "table_checksum.h"
+
+#include "parallel_export.h"
+#include "typed_bind.h"
+#include "typed_rows.h"
+#include "work_stealing.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <mutex>
+#include <optional>
+
+namespace sqlplusplus {
+namespace {
+
+// Ranges per worker, so one that lands on a dense part of the table doesn't hold up the rest.
+constexpr uint32_t kChunksPerWorker = 4;
+
+// What a column contributes to its row's hash, or nothing for a type ORA_HASH can't take.
+std::optional<std::string> columnHashExpr(const OracleColumnInfo& info) {
+    const auto name = fmt::format("\"{}\"", info.name());
+    switch (info.typeInfo().oracleTypeNum) {
+    case DPI_ORACLE_TYPE_CLOB:
+    case DPI_ORACLE_TYPE_NCLOB:
+    case DPI_ORACLE_TYPE_BLOB:
+        return fmt::format("ORA_HASH(DBMS_LOB.SUBSTR({0}, 1000, 1)) || '/' || DBMS_LOB.GETLENGTH({0})", name);
+    case DPI_ORACLE_TYPE_LONG_VARCHAR:
+    case DPI_ORACLE_TYPE_LONG_RAW:
+    case DPI_ORACLE_TYPE_OBJECT:
+    case DPI_ORACLE_TYPE_BFILE:
+        return std::nullopt;
+    default:
+        return fmt::format("ORA_HASH({})", name);
+    }
+}
+
+} // namespace
+
+TableChecksum checksumTable(OracleConnection& conn,
+                            const std::function<OracleConnection()>& newConnection,
+                            std::string_view table,
+                            uint32_t parallelism) {
+    const auto name = normalizeIdentifier(table, true);
+    TableChecksum checksum;
+
+    std::string rowExpr;
+    {
+        auto stmt = conn.prepareStatement(fmt::format("SELECT * FROM {}", name));
+        stmt.describe();
+        for (uint32_t col = 1; col <= stmt.numColumns(); ++col) {
+            const auto info = stmt.getColumnInfo(col);
+            auto expr = columnHashExpr(info);
+            if (!expr) {
+                checksum.skippedColumns.emplace_back(info.name());
+                continue;
+            }
+            fmt::format_to(std::back_inserter(rowExpr), "{}{}", rowExpr.empty() ? "" : " || ',' || ", *expr);
+        }
+    }
+    if (rowExpr.empty()) {
+        rowExpr = "NULL";
+    }
+
+    const auto ranges = rowidRanges(conn, name, std::max<uint32_t>(parallelism, 1) * kChunksPerWorker);
+    // A table without a segment has no ranges, and is summed in one go.
+    const auto sql = fmt::format(
+            "SELECT TO_CHAR(COUNT(*)), TO_CHAR(MOD(NVL(SUM(ORA_HASH({})), 0), 18446744073709551616)) FROM {}{}",
+            rowExpr, name, ranges.empty() ? "" : " WHERE ROWID BETWEEN CHARTOROWID(:1) AND CHARTOROWID(:2)");
+    checksum.chunks = std::max<size_t>(ranges.size(), 1);
+
+    std::mutex mutex;
+    const auto numWorkers = std::max<uint32_t>(parallelism, 1);
+    std::vector<std::optional<OracleConnection>> connections(numWorkers);
+    runLongestFirst(std::vector<uint64_t>(checksum.chunks, 1), numWorkers, [&](uint32_t worker, size_t idx) {
+        auto& workerConn = connections[worker];
+        if (!workerConn) {
+            workerConn = newConnection();
+        }
+        auto stmt = workerConn->prepareStatement(sql);
+        if (!ranges.empty()) {
+            bind(stmt, ranges[idx].first, ranges[idx].last);
+        }
+        stmt.execute();
+        forEachRow<std::string_view, std::string_view>(stmt, [&](std::string_view rows, std::string_view sum) {
+            const auto numRows = std::stoull(std::string(rows));
+            const auto hashSum = std::stoull(std::string(sum));
+            std::lock_guard<std::mutex> lk(mutex);
+            checksum.rows += numRows;
+            checksum.fingerprint += hashSum;
+        });
+    });
+    return checksum;
+}
+
+} // namespace sqlplusplus
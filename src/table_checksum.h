@@ -0,0 +1,36 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+struct TableChecksum {
+    uint64_t rows = 0;
+    // The sum of every row's hash, modulo 2^64. Sums don't depend on the order rows are
+    // added in, so the same rows give the same fingerprint however each database happens
+    // to lay them out and chunk them.
+    uint64_t fingerprint = 0;
+    size_t chunks = 0;
+    // Columns of types ORA_HASH can't take, like LONG or an object type, left out of the rows' hashes.
+    std::vector<std::string> skippedColumns;
+};
+
+// Fingerprints the rows of table from the server side, so no more than a row per chunk
+// comes back however big it is. Each row is hashed with ORA_HASH over the ORA_HASH of
+// every column's value; LOBs by their length and first 1000 characters or bytes. The
+// table is split into ROWID ranges like rowidRanges(), a few per worker, and the ranges'
+// counts and hash sums are computed on up to parallelism connections from newConnection
+// at once, then added up. Values are hashed in their stored form rather than as text, so
+// the sessions' NLS settings don't matter.
+TableChecksum checksumTable(OracleConnection& conn,
+                            const std::function<OracleConnection()>& newConnection,
+                            std::string_view table,
+                            uint32_t parallelism);
+
+} // namespace sqlplusplus
@@ -0,0 +1,197 @@
+#include "table_copy.h"
+
+#include "result_metadata.h"
+#include "session_executor.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <array>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace sqlplusplus {
+namespace {
+
+// UROWIDs run up to this many bytes of text.
+constexpr uint32_t kMaxRowidBytes = 4000;
+
+// How a column is fetched from the source and bound on the target. Both sides use the
+// same, since copyFrom() only moves values between variables of one native type.
+OracleConnection::VariableOpts variableOptsFor(const ResultMetadata::Column& column, uint32_t numRows) {
+    using ByteBufferOpts = OracleConnection::VariableOpts::ByteBufferOpts;
+    const auto& info = column.typeInfo;
+    OracleConnection::VariableOpts opts;
+    opts.dbTypeNum = info.oracleTypeNum;
+    opts.nativeTypeNum = info.defaultNativeTypeNum;
+    opts.maxArraySize = numRows;
+    opts.opts = ByteBufferOpts{0, false};
+    switch (info.oracleTypeNum) {
+    case DPI_ORACLE_TYPE_NUMBER:
+        if (fetchesNumberAsText(info)) {
+            opts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+        }
+        break;
+    case DPI_ORACLE_TYPE_VARCHAR:
+    case DPI_ORACLE_TYPE_NVARCHAR:
+    case DPI_ORACLE_TYPE_CHAR:
+    case DPI_ORACLE_TYPE_NCHAR:
+    case DPI_ORACLE_TYPE_RAW:
+        opts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+        opts.opts = ByteBufferOpts{std::max<uint32_t>(info.clientSizeInBytes, 1), true};
+        break;
+    case DPI_ORACLE_TYPE_ROWID:
+        // A rowid handle belongs to its session, so rowids go across as their text.
+        opts.dbTypeNum = DPI_ORACLE_TYPE_VARCHAR;
+        opts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+        opts.opts = ByteBufferOpts{kMaxRowidBytes, true};
+        break;
+    case DPI_ORACLE_TYPE_LONG_VARCHAR:
+    case DPI_ORACLE_TYPE_LONG_RAW:
+        opts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+        break;
+    // Locators belong to their session too, so LOBs are fetched and bound as long values.
+    case DPI_ORACLE_TYPE_CLOB:
+    case DPI_ORACLE_TYPE_NCLOB:
+        opts.dbTypeNum = DPI_ORACLE_TYPE_LONG_VARCHAR;
+        opts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+        break;
+    case DPI_ORACLE_TYPE_BLOB:
+        opts.dbTypeNum = DPI_ORACLE_TYPE_LONG_RAW;
+        opts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+        break;
+    case DPI_ORACLE_TYPE_DATE:
+    case DPI_ORACLE_TYPE_TIMESTAMP:
+    case DPI_ORACLE_TYPE_TIMESTAMP_TZ:
+    case DPI_ORACLE_TYPE_TIMESTAMP_LTZ:
+    case DPI_ORACLE_TYPE_INTERVAL_DS:
+    case DPI_ORACLE_TYPE_INTERVAL_YM:
+    case DPI_ORACLE_TYPE_NATIVE_FLOAT:
+    case DPI_ORACLE_TYPE_NATIVE_DOUBLE:
+        break;
+    default:
+        throw std::runtime_error(fmt::format("can't copy column {}: its type isn't supported", column.name));
+    }
+    return opts;
+}
+
+std::string insertSql(const std::string& table, const ResultMetadata& metadata) {
+    fmt::memory_buffer sql;
+    fmt::format_to(sql, "INSERT INTO {} (", table);
+    for (uint32_t pos = 1; pos <= metadata.numColumns(); ++pos) {
+        fmt::format_to(sql, "{}\"{}\"", pos == 1 ? "" : ", ", metadata.column(pos).name);
+    }
+    fmt::format_to(sql, ") VALUES (");
+    for (uint32_t pos = 1; pos <= metadata.numColumns(); ++pos) {
+        fmt::format_to(sql, "{}:{}", pos == 1 ? "" : ", ", pos);
+    }
+    fmt::format_to(sql, ")");
+    return std::string(sql.data(), sql.size());
+}
+
+} // namespace
+
+TableCopyResult copyTable(OracleConnection& source,
+                          OracleConnection& target,
+                          std::string_view table,
+                          std::string_view where,
+                          const TableCopyOptions& opts) {
+    const auto name = normalizeIdentifier(table, true);
+    const auto batchRows = std::max<uint32_t>(opts.batchRows, 1);
+    auto query = source.prepareStatement(where.empty()
+            ? fmt::format("SELECT * FROM {}", name)
+            : fmt::format("SELECT * FROM {} WHERE {}", name, where));
+    query.setFetchArraySize(batchRows);
+    query.execute();
+    const auto metadata = query.metadata();
+    const auto numColumns = metadata->numColumns();
+
+    std::vector<OracleVariable> sourceVars;
+    // Two sets, so one is filled from the next block while the other is being inserted.
+    std::array<std::vector<OracleVariable>, 2> targetVars;
+    for (uint32_t pos = 1; pos <= numColumns; ++pos) {
+        const auto varOpts = variableOptsFor(metadata->column(pos), batchRows);
+        sourceVars.push_back(source.newArrayVariable(varOpts));
+        query.defineVariable(pos, sourceVars.back());
+        for (auto& vars : targetVars) {
+            vars.push_back(target.newArrayVariable(varOpts));
+        }
+    }
+    auto insert = target.prepareStatement(insertSql(name, *metadata));
+
+    TableCopyResult result;
+    uint64_t uncommittedRows = 0;
+    std::array<std::future<void>, 2> inserts;
+    // Declared after everything its tasks touch, so it's done with them before they go.
+    SessionExecutor executor;
+    try {
+        size_t current = 0;
+        for (;;) {
+            auto block = query.fetchBlock(batchRows);
+            const auto numRows = block.numRows();
+            if (numRows > 0) {
+                // The insert that last used this set has to be done with it first.
+                if (inserts[current].valid()) {
+                    inserts[current].get();
+                }
+                auto& vars = targetVars[current];
+                for (uint32_t col = 0; col < numColumns; ++col) {
+                    for (uint32_t row = 0; row < numRows; ++row) {
+                        vars[col].copyFrom(sourceVars[col], row, block.bufferRowIndex() + row);
+                    }
+                }
+                result.rows += numRows;
+                ++result.batches;
+                uncommittedRows += numRows;
+                const bool commit = !block.moreRows() || (opts.commitRows != 0 && uncommittedRows >= opts.commitRows);
+                if (commit) {
+                    uncommittedRows = 0;
+                }
+                inserts[current] = executor.submit([&insert, &vars, numRows, commit] {
+                    for (uint32_t pos = 1; pos <= vars.size(); ++pos) {
+                        insert.bindByPos(pos, vars[pos - 1]);
+                    }
+                    insert.executeMany(numRows, commit ? DPI_MODE_EXEC_COMMIT_ON_SUCCESS : DPI_MODE_EXEC_DEFAULT);
+                });
+                if (opts.onBatch) {
+                    opts.onBatch(result.rows);
+                }
+                current ^= 1;
+            }
+            if (!block.moreRows()) {
+                break;
+            }
+        }
+        for (auto& pending : inserts) {
+            if (pending.valid()) {
+                pending.get();
+            }
+        }
+        // The last block came back full and the one after it empty, so nothing committed
+        // with it.
+        if (uncommittedRows > 0) {
+            target.commit();
+        }
+    } catch (...) {
+        // Whatever's still in flight finishes before the rollback; its own error, if it
+        // has one, is beside the point by now.
+        for (auto& pending : inserts) {
+            if (pending.valid()) {
+                try {
+                    pending.get();
+                } catch (...) {
+                }
+            }
+        }
+        try {
+            target.rollback();
+        } catch (...) {
+        }
+        throw;
+    }
+    return result;
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+namespace sqlplusplus {
+
+struct TableCopyOptions {
+    // Rows fetched from the source per round trip, and inserted into the target per
+    // executeMany.
+    uint32_t batchRows = 1000;
+    // The target commits every time this many more rows have gone in, and once at the
+    // end; 0 only commits at the end.
+    uint64_t commitRows = 0;
+    // Called on the fetching thread with the rows copied so far, after each batch.
+    std::function<void(uint64_t)> onBatch;
+};
+
+struct TableCopyResult {
+    uint64_t rows = 0;
+    uint32_t batches = 0;
+};
+
+// Copies the rows of table on source, those matching where if it isn't empty, into the
+// table of the same name on target, column by column by name. Values never turn into
+// text on the way: each column is fetched into a variable of its own type, the rows of
+// a block are copied with OracleVariable::copyFrom() into variables on target of the
+// same type, and those are inserted with one executeMany. Inserts run on a
+// SessionExecutor of target's while the next block is fetched, into a second set of
+// target variables, so the source and target round trips overlap.
+//
+// NUMBERs that aren't integers go across as their exact decimal text and LOBs as long
+// values, which have to fit in memory a block at a time. Throws std::runtime_error for
+// a column of a type that can't be copied this way, e.g. an object or a BFILE. On an
+// error what the target hasn't committed yet is rolled back.
+TableCopyResult copyTable(OracleConnection& source,
+                          OracleConnection& target,
+                          std::string_view table,
+                          std::string_view where,
+                          const TableCopyOptions& opts);
+
+} // namespace sqlplusplus
@@ -0,0 +1,476 @@
+#include "table_dump.h"
+
+#include "mapped_file.h"
+#include "work_stealing.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace sqlplusplus {
+namespace {
+
+constexpr std::string_view kMagic = "SQPPDMP1";
+// Bind arrays for text start this big and double until the longest value fits.
+constexpr uint32_t kMinValueSize = 64;
+// Past this a value has to be bound as LONG or LONG RAW, which insert into LOBs.
+constexpr uint32_t kMaxShortValueSize = 32767;
+
+template <typename T>
+void put(std::string& out, T value) {
+    static_assert(std::is_integral_v<T>, "put() writes integers");
+    const auto bits = static_cast<std::make_unsigned_t<T>>(value);
+    for (size_t idx = 0; idx < sizeof(T); ++idx) {
+        out.push_back(static_cast<char>((bits >> (idx * 8)) & 0xff));
+    }
+}
+
+void putDouble(std::string& out, double value) {
+    uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    put(out, bits);
+}
+
+void putTimestamp(std::string& out, const dpiTimestamp& ts) {
+    put(out, ts.year);
+    put(out, ts.month);
+    put(out, ts.day);
+    put(out, ts.hour);
+    put(out, ts.minute);
+    put(out, ts.second);
+    put(out, ts.fsecond);
+    put(out, ts.tzHourOffset);
+    put(out, ts.tzMinuteOffset);
+}
+
+// Reads the dump format back out of a mapped file, throwing if it runs off the end.
+class DumpReader {
+public:
+    explicit DumpReader(std::string_view data) : _data(data) {}
+
+    template <typename T>
+    T get() {
+        static_assert(std::is_integral_v<T>, "get() reads integers");
+        const auto raw = bytes(sizeof(T));
+        std::make_unsigned_t<T> bits = 0;
+        for (size_t idx = 0; idx < sizeof(T); ++idx) {
+            bits |= static_cast<std::make_unsigned_t<T>>(static_cast<unsigned char>(raw[idx])) << (idx * 8);
+        }
+        return static_cast<T>(bits);
+    }
+
+    double getDouble() {
+        const auto bits = get<uint64_t>();
+        double value = 0;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    dpiTimestamp getTimestamp() {
+        dpiTimestamp ts = {};
+        ts.year = get<int16_t>();
+        ts.month = get<uint8_t>();
+        ts.day = get<uint8_t>();
+        ts.hour = get<uint8_t>();
+        ts.minute = get<uint8_t>();
+        ts.second = get<uint8_t>();
+        ts.fsecond = get<uint32_t>();
+        ts.tzHourOffset = get<int8_t>();
+        ts.tzMinuteOffset = get<int8_t>();
+        return ts;
+    }
+
+    std::string_view bytes(size_t size) {
+        if (_data.size() - _pos < size) {
+            throw std::runtime_error("dump file is cut short");
+        }
+        auto out = _data.substr(_pos, size);
+        _pos += size;
+        return out;
+    }
+
+private:
+    std::string_view _data;
+    size_t _pos = 0;
+};
+
+bool isVariableLength(DumpValueType type) noexcept {
+    return type == DumpValueType::Number || type == DumpValueType::Text || type == DumpValueType::Raw;
+}
+
+// How a column of the query is dumped, redefining it first if it needs to come back in
+// another form.
+DumpValueType dumpTypeFor(OracleStatement& stmt, uint32_t pos, const OracleColumnInfo& info) {
+    const auto& type = info.typeInfo();
+    switch (type.oracleTypeNum) {
+    case DPI_ORACLE_TYPE_NUMBER:
+        if (type.defaultNativeTypeNum == DPI_NATIVE_TYPE_INT64) {
+            return DumpValueType::Int64;
+        }
+        stmt.defineColumn(pos, DPI_ORACLE_TYPE_NUMBER, DPI_NATIVE_TYPE_BYTES);
+        return DumpValueType::Number;
+    case DPI_ORACLE_TYPE_NATIVE_DOUBLE:
+    case DPI_ORACLE_TYPE_NATIVE_FLOAT:
+        return DumpValueType::Double;
+    case DPI_ORACLE_TYPE_VARCHAR:
+    case DPI_ORACLE_TYPE_NVARCHAR:
+    case DPI_ORACLE_TYPE_CHAR:
+    case DPI_ORACLE_TYPE_NCHAR:
+    case DPI_ORACLE_TYPE_LONG_VARCHAR:
+    case DPI_ORACLE_TYPE_CLOB:
+    case DPI_ORACLE_TYPE_NCLOB:
+        return DumpValueType::Text;
+    case DPI_ORACLE_TYPE_RAW:
+    case DPI_ORACLE_TYPE_LONG_RAW:
+    case DPI_ORACLE_TYPE_BLOB:
+        return DumpValueType::Raw;
+    case DPI_ORACLE_TYPE_DATE:
+    case DPI_ORACLE_TYPE_TIMESTAMP:
+    case DPI_ORACLE_TYPE_TIMESTAMP_TZ:
+    case DPI_ORACLE_TYPE_TIMESTAMP_LTZ:
+        return DumpValueType::Timestamp;
+    default:
+        throw std::runtime_error(fmt::format("column {} is of a type that can't be dumped", info.name()));
+    }
+}
+
+// The bind array for a column's values: numRows of them, none longer than valueSize.
+OracleVariable makeBindArray(OracleConnection& conn, const DumpColumn& column, uint32_t valueSize, uint32_t numRows) {
+    OracleConnection::VariableOpts varopts;
+    varopts.maxArraySize = numRows;
+    varopts.opts = OracleConnection::VariableOpts::ByteBufferOpts{valueSize, true};
+    const bool isLong = valueSize > kMaxShortValueSize;
+    switch (column.type) {
+    case DumpValueType::Int64:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_NUMBER;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_INT64;
+        break;
+    case DumpValueType::Double:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_NATIVE_DOUBLE;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_DOUBLE;
+        break;
+    case DumpValueType::Number:
+        varopts.dbTypeNum = DPI_ORACLE_TYPE_NUMBER;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+        break;
+    case DumpValueType::Text:
+        varopts.dbTypeNum = isLong ? DPI_ORACLE_TYPE_LONG_VARCHAR : DPI_ORACLE_TYPE_VARCHAR;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+        break;
+    case DumpValueType::Raw:
+        varopts.dbTypeNum = isLong ? DPI_ORACLE_TYPE_LONG_RAW : DPI_ORACLE_TYPE_RAW;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+        break;
+    case DumpValueType::Timestamp:
+        varopts.dbTypeNum = column.oracleType;
+        varopts.nativeTypeNum = DPI_NATIVE_TYPE_TIMESTAMP;
+        break;
+    }
+    return conn.newArrayVariable(varopts);
+}
+
+struct Batch {
+    uint32_t numRows = 0;
+    // The dump's row number of the batch's first row.
+    uint64_t firstRow = 0;
+    std::vector<OracleVariable> vars;
+    std::vector<uint32_t> valueSizes;
+    uint32_t capacity = 0;
+};
+
+struct BatchOutcome {
+    uint64_t rowsLoaded = 0;
+    std::vector<DumpRestoreError> errors;
+};
+
+} // namespace
+
+uint64_t writeDumpResults(OracleStatement& stmt, BufferedFdWriter& out) {
+    const auto numColumns = stmt.numColumns();
+    std::vector<DumpValueType> types;
+    std::string buffer(kMagic);
+    put(buffer, numColumns);
+    for (uint32_t col = 1; col <= numColumns; ++col) {
+        const auto info = stmt.getColumnInfo(col);
+        const auto& typeInfo = info.typeInfo();
+        types.push_back(dumpTypeFor(stmt, col, info));
+        put(buffer, static_cast<uint16_t>(info.name().size()));
+        buffer.append(info.name());
+        put(buffer, static_cast<uint8_t>(types.back()));
+        put(buffer, static_cast<uint32_t>(typeInfo.oracleTypeNum));
+        put(buffer, typeInfo.sizeInChars != 0 ? typeInfo.sizeInChars : typeInfo.dbSizeInBytes);
+        put(buffer, typeInfo.precision);
+        put(buffer, typeInfo.scale);
+        put(buffer, static_cast<uint8_t>(info.nullOK()));
+    }
+    out.append(buffer);
+
+    OracleLobReader lobReader(stmt.context());
+    std::vector<uint32_t> lengths;
+    std::string values;
+    uint64_t numRows = 0;
+    for (;;) {
+        auto block = stmt.fetchBlock(stmt.fetchArraySize());
+        if (block.numRows() > 0) {
+            buffer.clear();
+            put(buffer, block.numRows());
+            for (uint32_t col = 1; col <= numColumns; ++col) {
+                const auto type = types[col - 1];
+                const auto data = block.columnData(col);
+                const auto nativeType = block.nativeType(col);
+
+                const auto bitmapStart = buffer.size();
+                buffer.resize(bitmapStart + (block.numRows() + 7) / 8, '\0');
+                for (uint32_t row = 0; row < block.numRows(); ++row) {
+                    if (data[row].isNull) {
+                        buffer[bitmapStart + row / 8] |= static_cast<char>(1 << (row % 8));
+                    }
+                }
+
+                lengths.clear();
+                values.clear();
+                for (uint32_t row = 0; row < block.numRows(); ++row) {
+                    const auto& value = data[row];
+                    if (value.isNull) {
+                        continue;
+                    }
+                    switch (type) {
+                    case DumpValueType::Int64:
+                        put(buffer, value.value.asInt64);
+                        break;
+                    case DumpValueType::Double:
+                        putDouble(buffer, nativeType == DPI_NATIVE_TYPE_FLOAT ? value.value.asFloat : value.value.asDouble);
+                        break;
+                    case DumpValueType::Timestamp:
+                        putTimestamp(buffer, value.value.asTimestamp);
+                        break;
+                    case DumpValueType::Number:
+                    case DumpValueType::Text:
+                    case DumpValueType::Raw: {
+                        const auto start = values.size();
+                        if (nativeType == DPI_NATIVE_TYPE_LOB) {
+                            lobReader.open(value.value.asLOB);
+                            for (auto piece = lobReader.next(); !piece.empty(); piece = lobReader.next()) {
+                                values.append(piece);
+                            }
+                        } else {
+                            values.append(value.value.asBytes.ptr, value.value.asBytes.length);
+                        }
+                        lengths.push_back(static_cast<uint32_t>(values.size() - start));
+                        break;
+                    }
+                    }
+                }
+                if (isVariableLength(type)) {
+                    for (const auto length : lengths) {
+                        put(buffer, length);
+                    }
+                    buffer.append(values);
+                }
+            }
+            out.append(buffer);
+            numRows += block.numRows();
+        }
+        if (!block.moreRows()) {
+            break;
+        }
+    }
+    buffer.clear();
+    put(buffer, uint32_t{0});
+    out.append(buffer);
+    out.flush();
+    return numRows;
+}
+
+DumpRestoreResult restoreDump(OracleConnection& conn,
+                              const std::string& path,
+                              std::string_view tableName,
+                              const DumpRestoreOptions& opts) {
+    const auto table = normalizeIdentifier(tableName, true);
+    MappedFile file(path);
+    file.adviseSequential();
+    DumpReader reader(file.contents());
+    if (file.contents().substr(0, kMagic.size()) != kMagic) {
+        throw std::runtime_error(fmt::format("{} isn't a dump file", path));
+    }
+    reader.bytes(kMagic.size());
+
+    DumpRestoreResult result;
+    const auto numColumns = reader.get<uint32_t>();
+    for (uint32_t col = 0; col < numColumns; ++col) {
+        DumpColumn column;
+        column.name = std::string(reader.bytes(reader.get<uint16_t>()));
+        const auto type = reader.get<uint8_t>();
+        if (type < static_cast<uint8_t>(DumpValueType::Int64) || type > static_cast<uint8_t>(DumpValueType::Timestamp)) {
+            throw std::runtime_error(fmt::format("column {} of {} has an unknown type", column.name, path));
+        }
+        column.type = static_cast<DumpValueType>(type);
+        column.oracleType = static_cast<dpiOracleTypeNum>(reader.get<uint32_t>());
+        column.size = reader.get<uint32_t>();
+        column.precision = reader.get<int16_t>();
+        column.scale = reader.get<int8_t>();
+        column.nullOk = reader.get<uint8_t>() != 0;
+        result.columns.push_back(std::move(column));
+    }
+    if (numColumns == 0) {
+        throw std::runtime_error(fmt::format("{} has no columns", path));
+    }
+
+    fmt::memory_buffer sqlBuffer;
+    fmt::format_to(sqlBuffer, "insert into {} (", table);
+    for (uint32_t col = 0; col < numColumns; ++col) {
+        fmt::format_to(sqlBuffer, "{}\"{}\"", col == 0 ? "" : ", ", result.columns[col].name);
+    }
+    fmt::format_to(sqlBuffer, ") values (");
+    for (uint32_t col = 0; col < numColumns; ++col) {
+        fmt::format_to(sqlBuffer, "{}:{}", col == 0 ? "" : ", ", col + 1);
+    }
+    fmt::format_to(sqlBuffer, ")");
+    auto stmt = conn.prepareStatement(std::string_view(sqlBuffer.data(), sqlBuffer.size()));
+
+    uint64_t rowsSinceCommit = 0;
+    // Runs on the insert thread, one batch at a time.
+    auto insertBatch = [&](Batch& batch) {
+        for (uint32_t col = 0; col < numColumns; ++col) {
+            stmt.bindByPos(col + 1, batch.vars[col]);
+        }
+        stmt.executeMany(batch.numRows, static_cast<dpiExecMode>(
+            DPI_MODE_EXEC_BATCH_ERRORS | DPI_MODE_EXEC_ARRAY_DML_ROWCOUNTS));
+
+        BatchOutcome outcome;
+        for (auto count : stmt.rowCounts()) {
+            outcome.rowsLoaded += count;
+        }
+        for (auto& error : stmt.batchErrors()) {
+            outcome.errors.push_back({batch.firstRow + error.offset, std::move(error.message)});
+        }
+        rowsSinceCommit += batch.numRows;
+        if (opts.commitInterval != 0 && rowsSinceCommit >= opts.commitInterval) {
+            conn.commit();
+            rowsSinceCommit = 0;
+        }
+        return outcome;
+    };
+
+    // Each batch is inserted on the I/O executor while the next is read.
+    auto& executor = WorkStealingExecutor::sharedIo();
+    auto collect = [&](std::future<BatchOutcome>& inFlight) {
+        auto outcome = executor.wait(inFlight);
+        result.rowsLoaded += outcome.rowsLoaded;
+        result.rowsRejected += outcome.errors.size();
+        for (auto& error : outcome.errors) {
+            if (result.errors.size() < opts.maxReportedErrors) {
+                result.errors.push_back(std::move(error));
+            }
+        }
+    };
+
+    Batch batches[2];
+    std::future<BatchOutcome> inFlight;
+    size_t current = 0;
+    std::vector<bool> nulls;
+    std::vector<uint32_t> lengths;
+    try {
+        for (;;) {
+            const auto numRows = reader.get<uint32_t>();
+            if (numRows == 0) {
+                break;
+            }
+            auto& batch = batches[current];
+            // The other batch may still be inserting, but never this one.
+            if (numRows > batch.capacity) {
+                batch.vars.clear();
+                batch.valueSizes.clear();
+                batch.capacity = numRows;
+            }
+            batch.numRows = numRows;
+            batch.firstRow = result.rowsRead + 1;
+
+            for (uint32_t col = 0; col < numColumns; ++col) {
+                const auto& column = result.columns[col];
+                const auto bitmap = reader.bytes((numRows + 7) / 8);
+                nulls.assign(numRows, false);
+                uint32_t numValues = 0;
+                for (uint32_t row = 0; row < numRows; ++row) {
+                    nulls[row] = (static_cast<unsigned char>(bitmap[row / 8]) >> (row % 8)) & 1;
+                    numValues += nulls[row] ? 0 : 1;
+                }
+
+                uint32_t longest = 0;
+                if (isVariableLength(column.type)) {
+                    lengths.clear();
+                    for (uint32_t idx = 0; idx < numValues; ++idx) {
+                        lengths.push_back(reader.get<uint32_t>());
+                        longest = std::max(longest, lengths.back());
+                    }
+                }
+                const bool firstUse = col >= batch.vars.size();
+                if (firstUse || longest > batch.valueSizes[col]) {
+                    auto size = firstUse ? kMinValueSize : batch.valueSizes[col];
+                    while (size < longest) {
+                        size = size > UINT32_MAX / 2 ? longest : size * 2;
+                    }
+                    auto var = makeBindArray(conn, column, size, batch.capacity);
+                    if (firstUse) {
+                        batch.vars.push_back(std::move(var));
+                        batch.valueSizes.push_back(size);
+                    } else {
+                        batch.vars[col] = std::move(var);
+                        batch.valueSizes[col] = size;
+                    }
+                }
+
+                auto& var = batch.vars[col];
+                size_t nextValue = 0;
+                for (uint32_t row = 0; row < numRows; ++row) {
+                    if (nulls[row]) {
+                        var.setNull(row);
+                        continue;
+                    }
+                    switch (column.type) {
+                    case DumpValueType::Int64:
+                        var.setFrom(row, reader.get<int64_t>());
+                        break;
+                    case DumpValueType::Double:
+                        var.setFrom(row, reader.getDouble());
+                        break;
+                    case DumpValueType::Timestamp:
+                        var.setFrom(row, reader.getTimestamp());
+                        break;
+                    case DumpValueType::Number:
+                    case DumpValueType::Text:
+                    case DumpValueType::Raw:
+                        var.setFrom(row, reader.bytes(lengths[nextValue++]));
+                        break;
+                    }
+                }
+            }
+            result.rowsRead += numRows;
+
+            if (inFlight.valid()) {
+                collect(inFlight);
+            }
+            inFlight = executor.submit([&insertBatch, &batch] { return insertBatch(batch); });
+            current ^= 1;
+        }
+        if (inFlight.valid()) {
+            collect(inFlight);
+        }
+    } catch(...) {
+        if (inFlight.valid()) {
+            executor.waitReady(inFlight);
+        }
+        throw;
+    }
+
+    conn.commit();
+    return result;
+}
+
+} // namespace sqlplusplus
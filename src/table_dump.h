@@ -0,0 +1,83 @@
+#pragma once
+
+#include "buffered_writer.h"
+#include "oracle_helpers.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+// How a dumped column's values are stored. Numbers, dates and binary values keep their
+// native form, so a table goes out and back in without being formatted as text and
+// parsed again on the way.
+enum class DumpValueType : uint8_t {
+    // 8 bytes; NUMBERs without a scale that fit in 18 digits.
+    Int64 = 1,
+    // 8 bytes; BINARY_DOUBLE, and BINARY_FLOAT widened.
+    Double = 2,
+    // The decimal text of any other NUMBER, which no native type holds exactly.
+    Number = 3,
+    // Bytes in the client character set; CHAR, VARCHAR2, their national kinds, LONG and CLOB.
+    Text = 4,
+    // RAW, LONG RAW and BLOB.
+    Raw = 5,
+    // DATE and TIMESTAMPs as dpiTimestamp's fields, time zone offset included.
+    Timestamp = 6,
+};
+
+// A dumped column as the query that dumped it described it.
+struct DumpColumn {
+    std::string name;
+    DumpValueType type;
+    dpiOracleTypeNum oracleType;
+    // In characters for text, bytes otherwise.
+    uint32_t size;
+    int16_t precision;
+    int8_t scale;
+    bool nullOk;
+};
+
+// Writes the rest of an executed query to out in the dump format: a header with every
+// column's metadata, then one columnar block per fetched block, each a null bitmap and
+// the non-null values packed back to back per column, all little-endian. NUMBER columns
+// that would be fetched as doubles are redefined to come back as text first. Throws
+// std::runtime_error for a column of a type the format doesn't hold, like ROWID, an
+// INTERVAL or an object. Returns the number of rows.
+uint64_t writeDumpResults(OracleStatement& stmt, BufferedFdWriter& out);
+
+struct DumpRestoreOptions {
+    // Commit after at least this many rows; 0 commits once at the end.
+    uint64_t commitInterval = 0;
+    // Rejected rows beyond this many are counted but not kept in the result.
+    size_t maxReportedErrors = 20;
+};
+
+struct DumpRestoreError {
+    // One-based, in dump order.
+    uint64_t row;
+    std::string message;
+};
+
+struct DumpRestoreResult {
+    std::vector<DumpColumn> columns;
+    uint64_t rowsRead = 0;
+    uint64_t rowsLoaded = 0;
+    uint64_t rowsRejected = 0;
+    std::vector<DumpRestoreError> errors;
+};
+
+// Inserts the rows of a dump into the columns of tableName with the same names. Each of
+// the dump's blocks is copied into bind arrays of the column's native type and inserted
+// with one executeMany, while the next block is decoded, like loadCsv() does for CSV.
+// Rows the server rejects are reported through the result. Throws std::runtime_error for
+// a file that isn't a dump or is cut short.
+DumpRestoreResult restoreDump(OracleConnection& conn,
+                              const std::string& path,
+                              std::string_view tableName,
+                              const DumpRestoreOptions& opts);
+
+} // namespace sqlplusplus
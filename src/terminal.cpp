@@ -0,0 +1,197 @@
+#include "terminal.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace sqlplusplus {
+
+void appendCell(std::string& out, std::string_view value, uint32_t width) {
+    size_t used = 0;
+    size_t pos = 0;
+    while (pos < value.size() && used < width) {
+        const auto start = pos;
+        const auto ch = static_cast<unsigned char>(value[pos]);
+        size_t charWidth = 0;
+        pos += nextCharacter(value.substr(pos), charWidth);
+        // The last column goes to an ellipsis when what's left doesn't fit in it.
+        if (used + charWidth >= width && pos < value.size() &&
+            (used + charWidth > width || displayWidth(value.substr(pos)) > 0)) {
+            out += "…";
+            ++used;
+            break;
+        }
+        used += charWidth;
+        if (ch == '\n') {
+            out += "↵";
+        } else if (ch < 0x20 || ch == 0x7f) {
+            out += ' ';
+        } else {
+            out.append(value, start, pos - start);
+        }
+    }
+    if (used == width && pos < value.size() && displayWidth(value.substr(pos)) == 0) {
+        // Combining marks on the last character that fit.
+        out.append(value, pos, value.size() - pos);
+    }
+    out.append(width - std::min<size_t>(used, width), ' ');
+}
+
+RawTerminal::RawTerminal() {
+    if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO)) {
+        throw std::runtime_error("this needs a terminal");
+    }
+    if (tcgetattr(STDIN_FILENO, &_saved) == -1) {
+        throw std::system_error(errno, std::generic_category(), "error reading terminal mode");
+    }
+    auto raw = _saved;
+    raw.c_iflag &= ~static_cast<tcflag_t>(ICRNL | IXON);
+    raw.c_lflag &= ~static_cast<tcflag_t>(ECHO | ICANON | IEXTEN | ISIG);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) == -1) {
+        throw std::system_error(errno, std::generic_category(), "error setting terminal mode");
+    }
+    write("\x1b[?1049h\x1b[?25l");
+}
+
+RawTerminal::~RawTerminal() {
+    write("\x1b[?25h\x1b[?1049l");
+    tcsetattr(STDIN_FILENO, TCSANOW, &_saved);
+}
+
+uint32_t terminalColumns() noexcept {
+    winsize ws{};
+    if (!isatty(STDOUT_FILENO) || ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1) {
+        return 0;
+    }
+    return ws.ws_col;
+}
+
+std::pair<uint32_t, uint32_t> RawTerminal::size() const {
+    winsize ws{};
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || ws.ws_row == 0 || ws.ws_col == 0) {
+        return {24, 80};
+    }
+    return {ws.ws_row, ws.ws_col};
+}
+
+void RawTerminal::write(std::string_view data) const noexcept {
+    while (!data.empty()) {
+        auto rc = ::write(STDOUT_FILENO, data.data(), data.size());
+        if (rc == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data.remove_prefix(static_cast<size_t>(rc));
+    }
+}
+
+std::vector<Key> RawTerminal::readKeys(int wakeFd, int timeoutMs) const {
+    pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+    std::vector<Key> keys;
+    if (poll(fds, 2, timeoutMs) <= 0) {
+        return keys;
+    }
+    if (fds[1].revents & POLLIN) {
+        char drain[64];
+        while (::read(wakeFd, drain, sizeof(drain)) > 0) {
+        }
+    }
+    if (!(fds[0].revents & POLLIN)) {
+        return keys;
+    }
+
+    char buf[64];
+    auto rc = ::read(STDIN_FILENO, buf, sizeof(buf));
+    if (rc <= 0) {
+        return keys;
+    }
+    std::string_view input(buf, static_cast<size_t>(rc));
+    if (input == "\x1b") {
+        keys.push_back(Key::Quit);
+        return keys;
+    }
+    while (!input.empty()) {
+        _parseKey(input, keys);
+    }
+    return keys;
+}
+
+void RawTerminal::_parseKey(std::string_view& input, std::vector<Key>& keys) {
+    if (input.front() == '\x1b' && input.size() >= 3 && (input[1] == '[' || input[1] == 'O')) {
+        auto end = input.find_first_not_of("0123456789;", 2);
+        if (end == std::string_view::npos) {
+            input = {};
+            return;
+        }
+        auto sequence = input.substr(2, end - 1);
+        input.remove_prefix(end + 1);
+        if (sequence == "A") {
+            keys.push_back(Key::Up);
+        } else if (sequence == "B") {
+            keys.push_back(Key::Down);
+        } else if (sequence == "C") {
+            keys.push_back(Key::Right);
+        } else if (sequence == "D") {
+            keys.push_back(Key::Left);
+        } else if (sequence == "5~") {
+            keys.push_back(Key::PageUp);
+        } else if (sequence == "6~") {
+            keys.push_back(Key::PageDown);
+        } else if (sequence == "H" || sequence == "1~" || sequence == "7~") {
+            keys.push_back(Key::Home);
+        } else if (sequence == "F" || sequence == "4~" || sequence == "8~") {
+            keys.push_back(Key::End);
+        }
+        return;
+    }
+
+    const auto ch = input.front();
+    input.remove_prefix(1);
+    switch (ch) {
+    case 'q':
+    case 'Q':
+    case '\x03':
+        keys.push_back(Key::Quit);
+        break;
+    case 'k':
+        keys.push_back(Key::Up);
+        break;
+    case 'j':
+    case '\r':
+    case '\n':
+        keys.push_back(Key::Down);
+        break;
+    case 'b':
+        keys.push_back(Key::PageUp);
+        break;
+    case ' ':
+    case 'f':
+        keys.push_back(Key::PageDown);
+        break;
+    case 'g':
+        keys.push_back(Key::Home);
+        break;
+    case 'G':
+        keys.push_back(Key::End);
+        break;
+    case 'h':
+        keys.push_back(Key::Left);
+        break;
+    case 'l':
+        keys.push_back(Key::Right);
+        break;
+    default:
+        break;
+    }
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "display_width.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <termios.h>
+
+namespace sqlplusplus {
+
+inline bool isContinuationByte(char ch) {
+    return (static_cast<unsigned char>(ch) & 0xc0) == 0x80;
+}
+
+// Display width of value, up to maxWidth.
+inline uint32_t cappedDisplayWidth(std::string_view value, uint32_t maxWidth) {
+    return static_cast<uint32_t>(std::min<size_t>(displayWidth(value), maxWidth));
+}
+
+// The width of the terminal stdout is, or 0 when it isn't one.
+uint32_t terminalColumns() noexcept;
+
+// Appends value padded or cut to exactly width columns. Cut values end in an ellipsis, and
+// control characters are drawn as blanks so a cell can't move the cursor.
+void appendCell(std::string& out, std::string_view value, uint32_t width);
+
+enum class Key {
+    Quit,
+    Up,
+    Down,
+    PageUp,
+    PageDown,
+    Home,
+    End,
+    Left,
+    Right,
+};
+
+// Puts the terminal in raw mode on the alternate screen for the lifetime of the object.
+// Throws std::runtime_error when stdin or stdout isn't a terminal.
+class RawTerminal {
+public:
+    RawTerminal();
+    RawTerminal(const RawTerminal&) = delete;
+    RawTerminal& operator=(const RawTerminal&) = delete;
+    ~RawTerminal();
+
+    // Rows and columns.
+    std::pair<uint32_t, uint32_t> size() const;
+
+    void write(std::string_view data) const noexcept;
+
+    // Waits for keys, wakeFd becoming readable or timeoutMs passing, and returns whatever
+    // keys were pressed. A negative wakeFd is ignored. Ctrl-C comes back as Quit, since
+    // raw mode turns off the signal.
+    std::vector<Key> readKeys(int wakeFd, int timeoutMs = 250) const;
+
+private:
+    static void _parseKey(std::string_view& input, std::vector<Key>& keys);
+
+    termios _saved{};
+};
+
+} // namespace sqlplusplus
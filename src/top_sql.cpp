@@ -0,0 +1,323 @@
+#include "top_sql.h"
+
+#include "json_text.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+namespace sqlplusplus {
+namespace {
+
+// Values below this are a bucket each; above it each power of two gets kSubBuckets.
+constexpr uint64_t kExactLimit = 64;
+constexpr uint64_t kSubBuckets = 32;
+constexpr int kSubBucketBits = 5;
+constexpr int kExactBits = 6;
+
+size_t bucketFor(uint64_t micros) noexcept {
+    if (micros < kExactLimit) {
+        return static_cast<size_t>(micros);
+    }
+    const auto exponent = 63 - __builtin_clzll(micros);
+    const auto mantissa = micros >> (exponent - kSubBucketBits);
+    return static_cast<size_t>(kExactLimit + (exponent - kExactBits) * kSubBuckets + (mantissa - kSubBuckets));
+}
+
+uint64_t bucketUpperMicros(size_t bucket) noexcept {
+    if (bucket < kExactLimit) {
+        return bucket;
+    }
+    const auto exponent = static_cast<int>((bucket - kExactLimit) / kSubBuckets) + kExactBits;
+    const auto mantissa = (bucket - kExactLimit) % kSubBuckets + kSubBuckets;
+    return ((mantissa + 1) << (exponent - kSubBucketBits)) - 1;
+}
+
+bool isWordChar(char ch) noexcept {
+    const auto uch = static_cast<unsigned char>(ch);
+    return std::isalnum(uch) || ch == '_' || ch == '$' || ch == '#' || uch >= 0x80;
+}
+
+// Tokens are spaced the same however they were typed: one space apart, except none inside
+// parentheses, around a dot or before a comma.
+bool needsSpace(char last, char next) noexcept {
+    return last != '(' && last != '.' && next != ',' && next != ')' && next != '(' && next != '.';
+}
+
+bool isTwoCharOperator(std::string_view text) noexcept {
+    return text == "<=" || text == ">=" || text == "<>" || text == "!=" || text == "^=" || text == "||"
+        || text == ":=" || text == "=>";
+}
+
+// The closing delimiter of a q'<open>...<close>' literal.
+char quoteClose(char open) noexcept {
+    switch (open) {
+    case '[': return ']';
+    case '(': return ')';
+    case '{': return '}';
+    case '<': return '>';
+    default: return open;
+    }
+}
+
+} // namespace
+
+std::string sqlFingerprint(std::string_view sql) {
+    std::string out;
+    out.reserve(sql.size());
+    auto emit = [&](std::string_view token) {
+        if (!out.empty() && needsSpace(out.back(), token.front())) {
+            out.push_back(' ');
+        }
+        out.append(token);
+    };
+    auto emitLiteral = [&] {
+        // A list of literals is one ?, so IN lists of any length count together.
+        if (out.size() >= 2 && out.back() == ',' && out[out.size() - 2] == '?') {
+            out.pop_back();
+            return;
+        }
+        emit("?");
+    };
+
+    size_t pos = 0;
+    while (pos < sql.size()) {
+        const char ch = sql[pos];
+        const auto rest = sql.substr(pos);
+        if (std::isspace(static_cast<unsigned char>(ch))) {
+            ++pos;
+        } else if (rest.substr(0, 2) == "--") {
+            pos = std::min(sql.find('\n', pos), sql.size());
+        } else if (rest.substr(0, 2) == "/*") {
+            const auto end = std::min(sql.find("*/", pos + 2), sql.size());
+            const auto stop = std::min(end + 2, sql.size());
+            if (rest.substr(0, 3) == "/*+") {
+                // Hints change the plan, so they're part of the shape.
+                std::string hint;
+                bool space = false;
+                for (auto hc : sql.substr(pos, stop - pos)) {
+                    if (std::isspace(static_cast<unsigned char>(hc))) {
+                        space = true;
+                        continue;
+                    }
+                    if (space) {
+                        hint.push_back(' ');
+                        space = false;
+                    }
+                    hint.push_back(static_cast<char>(std::toupper(static_cast<unsigned char>(hc))));
+                }
+                emit(hint);
+            }
+            pos = stop;
+        } else if ((ch == 'q' || ch == 'Q') && rest.size() > 2 && rest[1] == '\'') {
+            // q'[...]'.
+            const auto close = quoteClose(rest[2]);
+            auto end = pos + 3;
+            while (end < sql.size() && !(sql[end] == close && end + 1 < sql.size() && sql[end + 1] == '\'')) {
+                ++end;
+            }
+            pos = std::min(end + 2, sql.size());
+            emitLiteral();
+        } else if (ch == '\'') {
+            // N'...' is a literal too; its N went out as a word.
+            if ((pos > 0 && (sql[pos - 1] == 'N' || sql[pos - 1] == 'n')) && (pos == 1 || !isWordChar(sql[pos - 2]))) {
+                out.pop_back();
+                if (!out.empty() && out.back() == ' ') {
+                    out.pop_back();
+                }
+            }
+            auto end = pos + 1;
+            while (end < sql.size()) {
+                if (sql[end] == '\'') {
+                    if (end + 1 < sql.size() && sql[end + 1] == '\'') {
+                        end += 2;
+                        continue;
+                    }
+                    break;
+                }
+                ++end;
+            }
+            pos = std::min(end + 1, sql.size());
+            emitLiteral();
+        } else if (ch == '"') {
+            const auto end = std::min(sql.find('"', pos + 1), sql.size());
+            const auto stop = std::min(end + 1, sql.size());
+            emit(sql.substr(pos, stop - pos));
+            pos = stop;
+        } else if (ch == ':' && pos + 1 < sql.size() && isWordChar(sql[pos + 1])) {
+            // Binds keep their names, :1 included.
+            auto end = pos + 1;
+            while (end < sql.size() && isWordChar(sql[end])) {
+                ++end;
+            }
+            std::string bind(sql.substr(pos, end - pos));
+            std::transform(bind.begin(), bind.end(), bind.begin(), [](char bc) {
+                return static_cast<char>(std::toupper(static_cast<unsigned char>(bc)));
+            });
+            emit(bind);
+            pos = end;
+        } else if (std::isdigit(static_cast<unsigned char>(ch))
+                   || (ch == '.' && pos + 1 < sql.size() && std::isdigit(static_cast<unsigned char>(sql[pos + 1])))) {
+            auto end = pos;
+            while (end < sql.size() && (std::isdigit(static_cast<unsigned char>(sql[end])) || sql[end] == '.')) {
+                ++end;
+            }
+            if (end < sql.size() && (sql[end] == 'e' || sql[end] == 'E')) {
+                auto exponent = end + 1;
+                if (exponent < sql.size() && (sql[exponent] == '+' || sql[exponent] == '-')) {
+                    ++exponent;
+                }
+                if (exponent < sql.size() && std::isdigit(static_cast<unsigned char>(sql[exponent]))) {
+                    end = exponent;
+                    while (end < sql.size() && std::isdigit(static_cast<unsigned char>(sql[end]))) {
+                        ++end;
+                    }
+                }
+            }
+            // 1.5f and 2d, BINARY_FLOAT and BINARY_DOUBLE literals.
+            if (end < sql.size() && (sql[end] == 'f' || sql[end] == 'F' || sql[end] == 'd' || sql[end] == 'D')
+                    && (end + 1 == sql.size() || !isWordChar(sql[end + 1]))) {
+                ++end;
+            }
+            pos = end;
+            emitLiteral();
+        } else if (isWordChar(ch)) {
+            auto end = pos;
+            while (end < sql.size() && isWordChar(sql[end])) {
+                ++end;
+            }
+            std::string word(sql.substr(pos, end - pos));
+            std::transform(word.begin(), word.end(), word.begin(), [](char wc) {
+                return static_cast<char>(std::toupper(static_cast<unsigned char>(wc)));
+            });
+            emit(word);
+            pos = end;
+        } else {
+            const auto length = isTwoCharOperator(rest.substr(0, 2)) ? 2 : 1;
+            emit(rest.substr(0, length));
+            pos += length;
+        }
+    }
+    // The terminator isn't part of the statement.
+    while (!out.empty() && (out.back() == ';' || out.back() == '/' || out.back() == ' ')) {
+        out.pop_back();
+    }
+    return out;
+}
+
+void HdrLatencyHistogram::record(uint64_t micros) {
+    const auto bucket = bucketFor(micros);
+    if (bucket >= _buckets.size()) {
+        _buckets.resize(bucket + 1, 0);
+    }
+    ++_buckets[bucket];
+    ++_count;
+}
+
+void HdrLatencyHistogram::add(const HdrLatencyHistogram& other) {
+    if (other._buckets.size() > _buckets.size()) {
+        _buckets.resize(other._buckets.size(), 0);
+    }
+    for (size_t bucket = 0; bucket < other._buckets.size(); ++bucket) {
+        _buckets[bucket] += other._buckets[bucket];
+    }
+    _count += other._count;
+}
+
+uint64_t HdrLatencyHistogram::quantileMicros(double quantile) const noexcept {
+    if (_count == 0) {
+        return 0;
+    }
+    const auto rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(_count))), 1);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < _buckets.size(); ++bucket) {
+        seen += _buckets[bucket];
+        if (seen >= rank) {
+            return bucketUpperMicros(bucket);
+        }
+    }
+    return bucketUpperMicros(_buckets.size() - 1);
+}
+
+void TopSql::record(std::string_view sql, std::chrono::steady_clock::duration elapsed, uint64_t rows,
+                    uint64_t roundTrips) {
+    auto fingerprint = sqlFingerprint(sql);
+    const auto micros = static_cast<uint64_t>(std::max<int64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count(), 0));
+    std::lock_guard<std::mutex> lk(_mutex);
+    auto& totals = _byFingerprint[std::move(fingerprint)];
+    ++totals.count;
+    totals.totalMicros += micros;
+    totals.maxMicros = std::max(totals.maxMicros, micros);
+    totals.rows += rows;
+    totals.roundTrips += roundTrips;
+    totals.latencies.record(micros);
+}
+
+void TopSql::clear() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    _byFingerprint.clear();
+}
+
+std::vector<TopSql::Entry> TopSql::top(size_t limit, SortKey key) const {
+    std::vector<Entry> entries;
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        entries.reserve(_byFingerprint.size());
+        for (const auto& [fingerprint, totals] : _byFingerprint) {
+            Entry entry;
+            entry.fingerprint = fingerprint;
+            entry.count = totals.count;
+            entry.totalMicros = totals.totalMicros;
+            entry.maxMicros = totals.maxMicros;
+            entry.rows = totals.rows;
+            entry.roundTrips = totals.roundTrips;
+            entry.p50Micros = totals.latencies.quantileMicros(0.50);
+            entry.p95Micros = totals.latencies.quantileMicros(0.95);
+            entry.p99Micros = totals.latencies.quantileMicros(0.99);
+            entries.push_back(std::move(entry));
+        }
+    }
+    auto sortValue = [key](const Entry& entry) -> double {
+        switch (key) {
+        case SortKey::Total: return static_cast<double>(entry.totalMicros);
+        case SortKey::Mean: return entry.meanMicros();
+        case SortKey::Max: return static_cast<double>(entry.maxMicros);
+        case SortKey::Count: return static_cast<double>(entry.count);
+        case SortKey::Rows: return static_cast<double>(entry.rows);
+        }
+        return 0;
+    };
+    std::sort(entries.begin(), entries.end(), [&](const Entry& a, const Entry& b) {
+        const auto va = sortValue(a);
+        const auto vb = sortValue(b);
+        return va != vb ? va > vb : a.fingerprint < b.fingerprint;
+    });
+    if (limit != 0 && entries.size() > limit) {
+        entries.resize(limit);
+    }
+    return entries;
+}
+
+std::string TopSql::toJson() const {
+    fmt::memory_buffer out;
+    fmt::format_to(out, "{{\"statements\":[");
+    std::string escaped;
+    bool first = true;
+    for (const auto& entry : top(0, SortKey::Total)) {
+        escaped.resize(jsonStringSizeBound(entry.fingerprint.size()));
+        const auto end = writeJsonString(entry.fingerprint, escaped.data());
+        fmt::format_to(out, "{}{{\"fingerprint\":{},\"count\":{},\"total_us\":{},\"mean_us\":{:.1f},\"max_us\":{},"
+                "\"p50_us\":{},\"p95_us\":{},\"p99_us\":{},\"rows\":{},\"round_trips\":{}}}",
+                first ? "" : ",", std::string_view(escaped.data(), end - escaped.data()), entry.count,
+                entry.totalMicros, entry.meanMicros(), entry.maxMicros, entry.p50Micros, entry.p95Micros,
+                entry.p99Micros, entry.rows, entry.roundTrips);
+        first = false;
+    }
+    fmt::format_to(out, "]}}");
+    return fmt::to_string(out);
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace sqlplusplus {
+
+// The shape of a statement, so runs of it that differ only in their values are counted
+// together: literals become ?, a list of them one ?, comments other than hints go, words
+// are upper-cased outside quoted identifiers, and tokens are spaced the same way however
+// they were typed. "select * from t where id in (1, 2,3) -- x" is
+// "SELECT * FROM T WHERE ID IN(?)".
+std::string sqlFingerprint(std::string_view sql);
+
+// Latencies in microseconds to within about 3%: exact below 64 us and 32 linear buckets
+// per power of two above, after HdrHistogram's layout, so percentiles of the slow tail
+// come out close to what they were rather than to the next power of two. Grows with the
+// largest value recorded.
+class HdrLatencyHistogram {
+public:
+    void record(uint64_t micros);
+    // Adds other's values, as if each had been recorded here too.
+    void add(const HdrLatencyHistogram& other);
+    // The value at quantile, 0 to 1, as the highest value of its bucket.
+    uint64_t quantileMicros(double quantile) const noexcept;
+    uint64_t count() const noexcept {
+        return _count;
+    }
+
+private:
+    std::vector<uint64_t> _buckets;
+    uint64_t _count = 0;
+};
+
+// Per fingerprint totals of the statements run, for .topsql. Thread safe, so replay
+// sessions can record into it along with the REPL.
+class TopSql {
+public:
+    enum class SortKey { Total, Mean, Max, Count, Rows };
+
+    struct Entry {
+        std::string fingerprint;
+        uint64_t count = 0;
+        uint64_t totalMicros = 0;
+        uint64_t maxMicros = 0;
+        uint64_t rows = 0;
+        uint64_t roundTrips = 0;
+        uint64_t p50Micros = 0;
+        uint64_t p95Micros = 0;
+        uint64_t p99Micros = 0;
+
+        double meanMicros() const noexcept {
+            return count == 0 ? 0 : static_cast<double>(totalMicros) / count;
+        }
+    };
+
+    // A run of sql that took elapsed, touched rows rows and took roundTrips round trips.
+    void record(std::string_view sql, std::chrono::steady_clock::duration elapsed, uint64_t rows,
+                uint64_t roundTrips);
+    void clear();
+
+    // The limit biggest by key, biggest first; 0 is all of them.
+    std::vector<Entry> top(size_t limit, SortKey key) const;
+    // Every fingerprint as a JSON object with an array of them, by total time.
+    std::string toJson() const;
+
+private:
+    struct Totals {
+        uint64_t count = 0;
+        uint64_t totalMicros = 0;
+        uint64_t maxMicros = 0;
+        uint64_t rows = 0;
+        uint64_t roundTrips = 0;
+        HdrLatencyHistogram latencies;
+    };
+
+    mutable std::mutex _mutex;
+    std::unordered_map<std::string, Totals> _byFingerprint;
+};
+
+} // namespace sqlplusplus
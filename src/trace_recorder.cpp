@@ -0,0 +1,94 @@
+#include "trace_recorder.h"
+
+#include "buffered_writer.h"
+#include "json_text.h"
+
+#include "fmt/format.h"
+
+#include <unistd.h>
+
+namespace sqlplusplus {
+
+TraceRecorder traceRecorder;
+
+namespace {
+
+uint32_t currentThreadId() {
+    static std::atomic<uint32_t> nextThreadId{1};
+    thread_local const uint32_t threadId = nextThreadId.fetch_add(1, std::memory_order_relaxed);
+    return threadId;
+}
+
+void appendJsonString(fmt::memory_buffer& out, std::string_view value) {
+    const auto start = out.size();
+    out.resize(start + jsonStringSizeBound(value.size()));
+    auto end = writeJsonString(value, out.data() + start);
+    out.resize(static_cast<size_t>(end - out.data()));
+}
+
+} // namespace
+
+void TraceRecorder::enable() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    _epoch = Clock::now();
+    _enabled.store(true, std::memory_order_relaxed);
+}
+
+void TraceRecorder::record(const char* name, Clock::time_point start, Clock::time_point end,
+        const char* argName, uint64_t argValue) {
+    const auto threadId = currentThreadId();
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (_events.size() >= kMaxEvents) {
+        ++_droppedEvents;
+        return;
+    }
+    _events.push_back(Event{name, argName, argValue, threadId, start, end - start});
+}
+
+void TraceRecorder::nameThread(std::string name) {
+    if (!enabled()) {
+        return;
+    }
+    const auto threadId = currentThreadId();
+    std::lock_guard<std::mutex> lk(_mutex);
+    _threadNames.emplace_back(threadId, std::move(name));
+}
+
+void TraceRecorder::write(const std::string& path) const {
+    auto out = BufferedFdWriter::open(path);
+    std::lock_guard<std::mutex> lk(_mutex);
+    const auto pid = ::getpid();
+    fmt::memory_buffer buf;
+    fmt::format_to(buf, "{{\"traceEvents\":[\n");
+    bool first = true;
+    auto separator = [&first] {
+        const char* ret = first ? "" : ",\n";
+        first = false;
+        return ret;
+    };
+    for (const auto& [threadId, name] : _threadNames) {
+        fmt::format_to(buf, "{}{{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":{},\"tid\":{},\"args\":{{\"name\":",
+                separator(), pid, threadId);
+        appendJsonString(buf, name);
+        fmt::format_to(buf, "}}}}");
+    }
+    for (const auto& event : _events) {
+        const auto startMicros = std::chrono::duration<double, std::micro>(event.start - _epoch).count();
+        const auto durationMicros = std::chrono::duration<double, std::micro>(event.duration).count();
+        fmt::format_to(buf, "{}{{\"ph\":\"X\",\"name\":\"{}\",\"pid\":{},\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}",
+                separator(), event.name, pid, event.threadId, startMicros, durationMicros);
+        if (event.argName != nullptr) {
+            fmt::format_to(buf, ",\"args\":{{\"{}\":{}}}", event.argName, event.argValue);
+        }
+        fmt::format_to(buf, "}}");
+        if (buf.size() >= BufferedFdWriter::kBufferSize) {
+            out.append(std::string_view(buf.data(), buf.size()));
+            buf.clear();
+        }
+    }
+    fmt::format_to(buf, "\n],\"otherData\":{{\"droppedEvents\":{}}}}}\n", _droppedEvents);
+    out.append(std::string_view(buf.data(), buf.size()));
+    out.flush();
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sqlplusplus {
+
+// Collects client-side spans (connect, prepare, execute, fetch batches, decode, render) from
+// every thread and writes them out as Chrome trace-event JSON, which chrome://tracing and
+// Perfetto show as one timeline per thread. It's off until enable() is called, and spans
+// cost a single relaxed load while it is.
+class TraceRecorder {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Spans past this many are dropped, so a long session can't grow without bound.
+    static constexpr size_t kMaxEvents = 1'000'000;
+
+    void enable();
+    bool enabled() const noexcept {
+        return _enabled.load(std::memory_order_relaxed);
+    }
+
+    // name and argName must be string literals, or otherwise outlive the recorder. argName
+    // may be null for a span without an argument.
+    void record(const char* name, Clock::time_point start, Clock::time_point end,
+            const char* argName, uint64_t argValue);
+    // Labels the calling thread's track in the timeline.
+    void nameThread(std::string name);
+
+    // Throws std::system_error if path can't be written.
+    void write(const std::string& path) const;
+
+private:
+    struct Event {
+        const char* name;
+        const char* argName;
+        uint64_t argValue;
+        uint32_t threadId;
+        Clock::time_point start;
+        Clock::duration duration;
+    };
+
+    std::atomic<bool> _enabled{false};
+    Clock::time_point _epoch;
+    mutable std::mutex _mutex;
+    std::vector<Event> _events;
+    std::vector<std::pair<uint32_t, std::string>> _threadNames;
+    uint64_t _droppedEvents = 0;
+};
+
+extern TraceRecorder traceRecorder;
+
+// Records the time from construction to destruction as a span, when tracing is enabled.
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name) noexcept : _name(name), _active(traceRecorder.enabled()) {
+        if (_active) {
+            _start = TraceRecorder::Clock::now();
+        }
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+    ~TraceSpan() {
+        if (_active) {
+            traceRecorder.record(_name, _start, TraceRecorder::Clock::now(), _argName, _argValue);
+        }
+    }
+
+    // Attaches a count, e.g. the rows in a fetch batch, shown with the span.
+    void setArg(const char* name, uint64_t value) noexcept {
+        _argName = name;
+        _argValue = value;
+    }
+
+private:
+    const char* _name;
+    const char* _argName = nullptr;
+    uint64_t _argValue = 0;
+    bool _active;
+    TraceRecorder::Clock::time_point _start;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,30 @@
+#include "typed_bind.h"
+
+#include <ctime>
+
+namespace sqlplusplus {
+
+dpiTimestamp utcTimestamp(std::chrono::system_clock::time_point value) {
+    using namespace std::chrono;
+    auto secs = time_point_cast<seconds>(value);
+    if (secs > value) {
+        // Before the epoch the cast rounds toward it; the fraction has to stay positive.
+        secs -= seconds(1);
+    }
+    const auto nanos = duration_cast<nanoseconds>(value - secs).count();
+    const std::time_t time = system_clock::to_time_t(secs);
+    std::tm civil{};
+    gmtime_r(&time, &civil);
+
+    dpiTimestamp ts{};
+    ts.year = static_cast<int16_t>(civil.tm_year + 1900);
+    ts.month = static_cast<uint8_t>(civil.tm_mon + 1);
+    ts.day = static_cast<uint8_t>(civil.tm_mday);
+    ts.hour = static_cast<uint8_t>(civil.tm_hour);
+    ts.minute = static_cast<uint8_t>(civil.tm_min);
+    ts.second = static_cast<uint8_t>(civil.tm_sec);
+    ts.fsecond = static_cast<uint32_t>(nanos);
+    return ts;
+}
+
+} // namespace sqlplusplus
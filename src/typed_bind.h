@@ -0,0 +1,141 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+namespace sqlplusplus {
+
+// How a C++ type is bound: the native type ODPI converts it from and how its value goes
+// into a dpiData. There's a BindTraits for every type bind() takes; anything else fails to
+// compile rather than being converted at runtime.
+template <typename T, typename Enable = void>
+struct BindTraits;
+
+template <typename T>
+struct BindTraits<T, std::enable_if_t<std::is_integral_v<T> && std::is_signed_v<T>>> {
+    static constexpr dpiNativeTypeNum kNativeType = DPI_NATIVE_TYPE_INT64;
+    static void set(dpiData& data, T value) {
+        dpiData_setInt64(&data, value);
+    }
+};
+
+template <typename T>
+struct BindTraits<T, std::enable_if_t<std::is_integral_v<T> && std::is_unsigned_v<T> && !std::is_same_v<T, bool>>> {
+    static constexpr dpiNativeTypeNum kNativeType = DPI_NATIVE_TYPE_UINT64;
+    static void set(dpiData& data, T value) {
+        dpiData_setUint64(&data, value);
+    }
+};
+
+// PL/SQL BOOLEAN, so only for blocks; SQL has no boolean binds before 23c.
+template <>
+struct BindTraits<bool> {
+    static constexpr dpiNativeTypeNum kNativeType = DPI_NATIVE_TYPE_BOOLEAN;
+    static void set(dpiData& data, bool value) {
+        dpiData_setBool(&data, value ? 1 : 0);
+    }
+};
+
+template <>
+struct BindTraits<double> {
+    static constexpr dpiNativeTypeNum kNativeType = DPI_NATIVE_TYPE_DOUBLE;
+    static void set(dpiData& data, double value) {
+        dpiData_setDouble(&data, value);
+    }
+};
+
+template <>
+struct BindTraits<float> {
+    static constexpr dpiNativeTypeNum kNativeType = DPI_NATIVE_TYPE_FLOAT;
+    static void set(dpiData& data, float value) {
+        dpiData_setFloat(&data, value);
+    }
+};
+
+template <>
+struct BindTraits<std::string_view> {
+    static constexpr dpiNativeTypeNum kNativeType = DPI_NATIVE_TYPE_BYTES;
+    static void set(dpiData& data, std::string_view value) {
+        // ODPI copies the bytes into the bind before bindValue() returns.
+        dpiData_setBytes(&data, const_cast<char*>(value.data()), static_cast<uint32_t>(value.size()));
+    }
+};
+
+template <>
+struct BindTraits<std::string> : BindTraits<std::string_view> {};
+
+template <>
+struct BindTraits<const char*> : BindTraits<std::string_view> {};
+
+// A time point's UTC wall clock time, with whatever fraction of a second it carries in
+// fsecond's nanoseconds.
+dpiTimestamp utcTimestamp(std::chrono::system_clock::time_point value);
+
+template <typename Duration>
+struct BindTraits<std::chrono::time_point<std::chrono::system_clock, Duration>> {
+    static constexpr dpiNativeTypeNum kNativeType = DPI_NATIVE_TYPE_TIMESTAMP;
+    static void set(dpiData& data, std::chrono::time_point<std::chrono::system_clock, Duration> value) {
+        const auto ts = utcTimestamp(std::chrono::time_point_cast<std::chrono::system_clock::duration>(value));
+        dpiData_setTimestamp(&data, ts.year, ts.month, ts.day, ts.hour, ts.minute, ts.second, ts.fsecond, 0, 0);
+    }
+};
+
+// Null when empty, bound with the native type of the value otherwise.
+template <typename T>
+struct BindTraits<std::optional<T>> {
+    static constexpr dpiNativeTypeNum kNativeType = BindTraits<T>::kNativeType;
+    static void set(dpiData& data, const std::optional<T>& value) {
+        if (value) {
+            BindTraits<T>::set(data, *value);
+        } else {
+            dpiData_setNull(&data);
+        }
+    }
+};
+
+template <>
+struct BindTraits<std::nullptr_t> {
+    static constexpr dpiNativeTypeNum kNativeType = DPI_NATIVE_TYPE_BYTES;
+    static void set(dpiData& data, std::nullptr_t) {
+        dpiData_setNull(&data);
+    }
+};
+
+// Binds value to the 1-based placeholder pos through dpiStmt_bindValueByPos, which needs no
+// OracleVariable: the value is copied into a bind ODPI keeps with the statement until it's
+// rebound.
+template <typename T>
+void bindValue(OracleStatement& stmt, uint32_t pos, const T& value) {
+    using Traits = BindTraits<std::decay_t<T>>;
+    dpiData data{};
+    Traits::set(data, value);
+    stmt.bindValueByPos(pos, Traits::kNativeType, data);
+}
+
+template <typename T>
+struct IsTuple : std::false_type {};
+template <typename... Args>
+struct IsTuple<std::tuple<Args...>> : std::true_type {};
+
+// bind(stmt, ownerName, int64_t{42}, std::nullopt...) binds each argument to the next
+// placeholder, starting at 1, and bind(stmt, tuple) binds the tuple's elements. The
+// arguments are forwarding references so this is a better match than std::bind, which
+// argument-dependent lookup finds as well whenever one of them is from std.
+template <typename... Args>
+void bind(OracleStatement& stmt, Args&&... args) {
+    if constexpr (sizeof...(Args) == 1 && (IsTuple<std::decay_t<Args>>::value && ...)) {
+        std::apply([&stmt](const auto&... values) { bind(stmt, values...); }, args...);
+    } else {
+        uint32_t pos = 1;
+        (bindValue(stmt, pos++, args), ...);
+    }
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,95 @@
+#include "typed_rows.h"
+
+#include "fmt/format.h"
+
+#include <ctime>
+#include <stdexcept>
+
+namespace sqlplusplus {
+namespace {
+
+const char* nativeTypeName(dpiNativeTypeNum type) {
+    switch (type) {
+    case DPI_NATIVE_TYPE_INT64:
+        return "int64";
+    case DPI_NATIVE_TYPE_UINT64:
+        return "uint64";
+    case DPI_NATIVE_TYPE_FLOAT:
+        return "float";
+    case DPI_NATIVE_TYPE_DOUBLE:
+        return "double";
+    case DPI_NATIVE_TYPE_BYTES:
+        return "bytes";
+    case DPI_NATIVE_TYPE_TIMESTAMP:
+        return "timestamp";
+    case DPI_NATIVE_TYPE_INTERVAL_DS:
+    case DPI_NATIVE_TYPE_INTERVAL_YM:
+        return "interval";
+    case DPI_NATIVE_TYPE_LOB:
+        return "LOB";
+    case DPI_NATIVE_TYPE_OBJECT:
+        return "object";
+    case DPI_NATIVE_TYPE_STMT:
+        return "cursor";
+    case DPI_NATIVE_TYPE_BOOLEAN:
+        return "boolean";
+    case DPI_NATIVE_TYPE_ROWID:
+        return "rowid";
+    case DPI_NATIVE_TYPE_JSON:
+        return "JSON";
+    default:
+        return "unknown";
+    }
+}
+
+} // namespace
+
+namespace detail {
+
+void throwColumnCountMismatch(const OracleResultSource& source, size_t expected) {
+    throw std::runtime_error(
+        fmt::format("query returns {} columns but {} types were given", source.numColumns(), expected));
+}
+
+void throwColumnTypeMismatch(const OracleResultSource& source,
+                             uint32_t pos,
+                             dpiNativeTypeNum actual,
+                             const char* expected) {
+    throw std::runtime_error(fmt::format("column {} ({}) is fetched as {} and can't be read as {}",
+                                         pos,
+                                         source.getColumnInfo(pos).name(),
+                                         nativeTypeName(actual),
+                                         expected));
+}
+
+void throwNullColumn(const OracleResultSource& source, uint32_t pos) {
+    throw std::runtime_error(fmt::format(
+        "column {} ({}) is null; read it as a std::optional", pos, source.getColumnInfo(pos).name()));
+}
+
+void throwReturnedTypeMismatch(dpiNativeTypeNum actual, const char* expected) {
+    throw std::runtime_error(fmt::format(
+        "returned values are bound as {} and can't be read as {}", nativeTypeName(actual), expected));
+}
+
+void throwNullReturned(uint32_t iteration) {
+    throw std::runtime_error(fmt::format(
+        "iteration {} returned a null; read it as a std::optional", iteration));
+}
+
+} // namespace detail
+
+std::chrono::system_clock::time_point timePointFromTimestamp(const dpiTimestamp& ts) {
+    std::tm civil{};
+    civil.tm_year = ts.year - 1900;
+    civil.tm_mon = ts.month - 1;
+    civil.tm_mday = ts.day;
+    civil.tm_hour = ts.hour;
+    civil.tm_min = ts.minute;
+    civil.tm_sec = ts.second;
+    const auto offset = std::chrono::hours(ts.tzHourOffset) + std::chrono::minutes(ts.tzMinuteOffset);
+    return std::chrono::system_clock::from_time_t(timegm(&civil)) - offset +
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(ts.fsecond));
+}
+
+} // namespace sqlplusplus
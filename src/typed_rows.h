@@ -0,0 +1,315 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sqlplusplus {
+
+// How a fetched column becomes a C++ value: whether a column of a native type can be read as
+// T, and reading it straight out of the dpiData union. The types are checked once a block,
+// not per value, so decoding a row is a load per column with no calls into ODPI.
+template <typename T>
+struct ColumnTraits;
+
+template <>
+struct ColumnTraits<int64_t> {
+    static constexpr const char* kTypeName = "int64_t";
+    static bool accepts(dpiNativeTypeNum type) noexcept {
+        return type == DPI_NATIVE_TYPE_INT64;
+    }
+    static int64_t decode(const dpiData& data) noexcept {
+        return data.value.asInt64;
+    }
+};
+
+template <>
+struct ColumnTraits<uint64_t> {
+    static constexpr const char* kTypeName = "uint64_t";
+    static bool accepts(dpiNativeTypeNum type) noexcept {
+        return type == DPI_NATIVE_TYPE_UINT64 || type == DPI_NATIVE_TYPE_INT64;
+    }
+    static uint64_t decode(const dpiData& data) noexcept {
+        return data.value.asUint64;
+    }
+};
+
+template <>
+struct ColumnTraits<double> {
+    static constexpr const char* kTypeName = "double";
+    static bool accepts(dpiNativeTypeNum type) noexcept {
+        return type == DPI_NATIVE_TYPE_DOUBLE || type == DPI_NATIVE_TYPE_FLOAT;
+    }
+    // The type is per column rather than per value, but it's one compare against a load
+    // that happens anyway.
+    static double decode(const dpiData& data, dpiNativeTypeNum type) noexcept {
+        return type == DPI_NATIVE_TYPE_FLOAT ? data.value.asFloat : data.value.asDouble;
+    }
+};
+
+template <>
+struct ColumnTraits<float> {
+    static constexpr const char* kTypeName = "float";
+    static bool accepts(dpiNativeTypeNum type) noexcept {
+        return type == DPI_NATIVE_TYPE_FLOAT;
+    }
+    static float decode(const dpiData& data) noexcept {
+        return data.value.asFloat;
+    }
+};
+
+template <>
+struct ColumnTraits<bool> {
+    static constexpr const char* kTypeName = "bool";
+    static bool accepts(dpiNativeTypeNum type) noexcept {
+        return type == DPI_NATIVE_TYPE_BOOLEAN;
+    }
+    static bool decode(const dpiData& data) noexcept {
+        return data.value.asBoolean != 0;
+    }
+};
+
+// Points into the fetch buffers, so it's only valid until the next block is fetched.
+// ROWID columns read as their text, converted only for the values that are read.
+template <>
+struct ColumnTraits<std::string_view> {
+    static constexpr const char* kTypeName = "string_view";
+    static bool accepts(dpiNativeTypeNum type) noexcept {
+        return type == DPI_NATIVE_TYPE_BYTES || type == DPI_NATIVE_TYPE_ROWID;
+    }
+    static std::string_view decode(const dpiData& data, dpiNativeTypeNum type) noexcept {
+        if (type == DPI_NATIVE_TYPE_ROWID) {
+            return rowidText(data.value.asRowid);
+        }
+        return std::string_view(data.value.asBytes.ptr, data.value.asBytes.length);
+    }
+};
+
+template <>
+struct ColumnTraits<std::string> {
+    static constexpr const char* kTypeName = "string";
+    static bool accepts(dpiNativeTypeNum type) noexcept {
+        return ColumnTraits<std::string_view>::accepts(type);
+    }
+    static std::string decode(const dpiData& data, dpiNativeTypeNum type) {
+        return std::string(ColumnTraits<std::string_view>::decode(data, type));
+    }
+};
+
+template <>
+struct ColumnTraits<dpiTimestamp> {
+    static constexpr const char* kTypeName = "dpiTimestamp";
+    static bool accepts(dpiNativeTypeNum type) noexcept {
+        return type == DPI_NATIVE_TYPE_TIMESTAMP;
+    }
+    static dpiTimestamp decode(const dpiData& data) noexcept {
+        return data.value.asTimestamp;
+    }
+};
+
+// The instant a TIMESTAMP names, taking its time zone offset into account; one without a
+// time zone is taken to be UTC, the inverse of how bind() sends time points.
+std::chrono::system_clock::time_point timePointFromTimestamp(const dpiTimestamp& ts);
+
+template <>
+struct ColumnTraits<std::chrono::system_clock::time_point> {
+    static constexpr const char* kTypeName = "system_clock::time_point";
+    static bool accepts(dpiNativeTypeNum type) noexcept {
+        return type == DPI_NATIVE_TYPE_TIMESTAMP;
+    }
+    static std::chrono::system_clock::time_point decode(const dpiData& data) {
+        return timePointFromTimestamp(data.value.asTimestamp);
+    }
+};
+
+// Only an optional column may be null; reading a null into anything else throws.
+template <typename T>
+struct ColumnTraits<std::optional<T>> : ColumnTraits<T> {};
+
+namespace detail {
+
+template <typename T>
+struct IsOptional : std::false_type {};
+template <typename T>
+struct IsOptional<std::optional<T>> : std::true_type {};
+
+template <typename T>
+struct ContainsView : std::is_same<T, std::string_view> {};
+template <typename T>
+struct ContainsView<std::optional<T>> : ContainsView<T> {};
+
+[[noreturn]] void throwColumnCountMismatch(const OracleResultSource& source, size_t expected);
+[[noreturn]] void throwColumnTypeMismatch(const OracleResultSource& source,
+                                          uint32_t pos,
+                                          dpiNativeTypeNum actual,
+                                          const char* expected);
+[[noreturn]] void throwNullColumn(const OracleResultSource& source, uint32_t pos);
+[[noreturn]] void throwReturnedTypeMismatch(dpiNativeTypeNum actual, const char* expected);
+[[noreturn]] void throwNullReturned(uint32_t iteration);
+
+template <typename T>
+T decodeColumn(const OracleResultSource& source, const OracleFetchBlock::Column& column, uint32_t pos, uint32_t row) {
+    using Traits = ColumnTraits<T>;
+    const auto& data = column.data[row];
+    if (data.isNull) {
+        if constexpr (IsOptional<T>::value) {
+            return std::nullopt;
+        } else {
+            throwNullColumn(source, pos);
+        }
+    }
+    if constexpr (std::is_invocable_v<decltype(&Traits::decode), const dpiData&, dpiNativeTypeNum>) {
+        return T(Traits::decode(data, column.typeNum));
+    } else {
+        return T(Traits::decode(data));
+    }
+}
+
+// Checks a block's columns against Ts, and decodes its rows as them.
+template <typename... Ts>
+class RowDecoder {
+public:
+    explicit RowDecoder(const OracleResultSource& source) : _source(source) {
+        if (source.numColumns() != sizeof...(Ts)) {
+            throwColumnCountMismatch(source, sizeof...(Ts));
+        }
+    }
+
+    // Throws std::runtime_error when a column's values can't be read as its type. The
+    // native types are checked per block because the statement may redefine columns
+    // between blocks, see OracleStatement::setLobInlineThreshold().
+    void start(const OracleFetchBlock& block) {
+        _check(block, std::index_sequence_for<Ts...>{});
+    }
+
+    template <typename Fn>
+    void apply(uint32_t row, Fn& fn) const {
+        _apply(row, fn, std::index_sequence_for<Ts...>{});
+    }
+
+private:
+    template <size_t... Is>
+    void _check(const OracleFetchBlock& block, std::index_sequence<Is...>) {
+        (_checkColumn<Ts>(block, static_cast<uint32_t>(Is + 1)), ...);
+    }
+
+    template <typename T>
+    void _checkColumn(const OracleFetchBlock& block, uint32_t pos) {
+        const auto type = block.nativeType(pos);
+        if (!ColumnTraits<T>::accepts(type)) {
+            throwColumnTypeMismatch(_source, pos, type, ColumnTraits<T>::kTypeName);
+        }
+        _columns[pos - 1] = {type, block.columnData(pos)};
+    }
+
+    template <typename Fn, size_t... Is>
+    void _apply(uint32_t row, Fn& fn, std::index_sequence<Is...>) const {
+        fn(decodeColumn<Ts>(_source, _columns[Is], static_cast<uint32_t>(Is + 1), row)...);
+    }
+
+    const OracleResultSource& _source;
+    OracleFetchBlock::Column _columns[sizeof...(Ts)] = {};
+};
+
+} // namespace detail
+
+// Fetches the rest of an executed query and calls fn with each row's columns decoded as
+// Ts..., e.g. forEachRow<int64_t, std::string_view, std::optional<double>>(stmt, fn). The
+// column count and types are checked against Ts before the first row is decoded; a
+// mismatch, or a null in a column that isn't optional, throws std::runtime_error. Views
+// are only valid for the call they're passed to. Returns the number of rows.
+template <typename... Ts, typename Fn>
+uint64_t forEachRow(OracleResultSource& source, Fn&& fn) {
+    static_assert(sizeof...(Ts) > 0, "forEachRow needs a type per column");
+    detail::RowDecoder<Ts...> decoder(source);
+    uint64_t numRows = 0;
+    for (;;) {
+        auto block = source.fetchBlock(source.fetchArraySize());
+        if (block.numRows() > 0) {
+            decoder.start(block);
+            for (uint32_t row = 0; row < block.numRows(); ++row) {
+                decoder.apply(row, fn);
+            }
+            numRows += block.numRows();
+        }
+        if (!block.moreRows()) {
+            return numRows;
+        }
+    }
+}
+
+// Calls fn(iteration, value) for each value a RETURNING ... INTO bind returned over the
+// first numIters iterations of an executeMany, decoded as T, e.g. the ids an array
+// insert generated with forEachReturned<int64_t>(idVar, numRows, fn). An iteration
+// that touched no rows, like a row rejected with DPI_MODE_EXEC_BATCH_ERRORS, calls fn
+// for none. Throws std::runtime_error when the values can't be read as T, or for a
+// null when T isn't optional. Returns the number of values.
+template <typename T, typename Fn>
+uint64_t forEachReturned(const OracleVariable& var, uint32_t numIters, Fn&& fn) {
+    using Traits = ColumnTraits<T>;
+    uint64_t numValues = 0;
+    for (uint32_t iter = 0; iter < numIters; ++iter) {
+        const auto returned = var.returnedData(iter);
+        if (returned.empty()) {
+            continue;
+        }
+        if (!Traits::accepts(returned.nativeType())) {
+            detail::throwReturnedTypeMismatch(returned.nativeType(), Traits::kTypeName);
+        }
+        for (uint32_t idx = 0; idx < returned.size(); ++idx) {
+            const auto& data = returned.data()[idx];
+            if (data.isNull) {
+                if constexpr (detail::IsOptional<T>::value) {
+                    fn(iter, T());
+                    continue;
+                } else {
+                    detail::throwNullReturned(iter);
+                }
+            }
+            if constexpr (std::is_invocable_v<decltype(&Traits::decode), const dpiData&, dpiNativeTypeNum>) {
+                fn(iter, T(Traits::decode(data, returned.nativeType())));
+            } else {
+                fn(iter, T(Traits::decode(data)));
+            }
+        }
+        numValues += returned.size();
+    }
+    return numValues;
+}
+
+namespace detail {
+
+template <typename Tuple>
+struct TupleFetcher;
+
+template <typename... Ts>
+struct TupleFetcher<std::tuple<Ts...>> {
+    static_assert(!(ContainsView<Ts>::value || ...),
+                  "fetchInto rows outlive the fetch buffers; use std::string rather than string_view");
+
+    static std::vector<std::tuple<Ts...>> fetch(OracleResultSource& source) {
+        std::vector<std::tuple<Ts...>> rows;
+        forEachRow<Ts...>(source, [&rows](Ts... values) { rows.emplace_back(std::move(values)...); });
+        return rows;
+    }
+};
+
+} // namespace detail
+
+// Fetches the rest of an executed query as tuples, e.g.
+// fetchInto<std::tuple<int64_t, std::string>>(stmt). Checked like forEachRow(); the types
+// have to own their values, so string_view isn't allowed.
+template <typename Tuple>
+std::vector<Tuple> fetchInto(OracleResultSource& source) {
+    return detail::TupleFetcher<Tuple>::fetch(source);
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,284 @@
+#include "uring_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace sqlplusplus {
+namespace {
+
+// There's no liburing to call through, so the ring is set up and driven with its two
+// system calls directly.
+int ioUringSetup(unsigned entries, io_uring_params* params) noexcept {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags) noexcept {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+void* mapRing(int ringFd, size_t size, off_t offset) noexcept {
+    auto ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, offset);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+}
+
+template <typename T>
+T* ringField(void* ring, uint32_t offset) noexcept {
+    return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+}
+
+// Turns O_DIRECT off on fd for its lifetime, for writes that aren't aligned for it.
+class BufferedWrites {
+public:
+    explicit BufferedWrites(int fd) : _fd(fd), _flags(::fcntl(fd, F_GETFL)) {
+        if (_flags != -1) {
+            ::fcntl(_fd, F_SETFL, _flags & ~O_DIRECT);
+        }
+    }
+    BufferedWrites(const BufferedWrites&) = delete;
+    BufferedWrites& operator=(const BufferedWrites&) = delete;
+    ~BufferedWrites() {
+        if (_flags != -1) {
+            ::fcntl(_fd, F_SETFL, _flags);
+        }
+    }
+
+private:
+    int _fd;
+    int _flags;
+};
+
+} // namespace
+
+UringFileWriter::UringFileWriter(int fd, uint32_t queueDepth, bool direct) :
+    _fd(fd),
+    _direct(direct),
+    _queueDepth(std::max<uint32_t>(queueDepth, 1)),
+    _slots(_queueDepth)
+{
+    for (size_t slot = _queueDepth; slot > 0; --slot) {
+        _freeSlots.push_back(slot - 1);
+    }
+    _setUpRing(_queueDepth);
+}
+
+UringFileWriter::~UringFileWriter() {
+    try {
+        finish();
+    } catch(const std::exception&) {
+        // Nowhere to report it from a destructor.
+    }
+    _tearDownRing();
+}
+
+UringFileWriter::Buffer UringFileWriter::allocate(size_t capacity) {
+    Buffer buffer;
+    buffer.storage = std::make_unique<char[]>(capacity + kAlignment);
+    const auto address = reinterpret_cast<uintptr_t>(buffer.storage.get());
+    buffer.data = buffer.storage.get() + ((kAlignment - address % kAlignment) % kAlignment);
+    buffer.capacity = capacity;
+    return buffer;
+}
+
+bool UringFileWriter::_setUpRing(uint32_t entries) noexcept {
+    io_uring_params params{};
+    const int ringFd = ioUringSetup(entries, &params);
+    if (ringFd < 0) {
+        return false;
+    }
+    // IORING_OP_WRITE came with the kernels that report this.
+    if ((params.features & IORING_FEAT_RW_CUR_POS) == 0) {
+        ::close(ringFd);
+        return false;
+    }
+    _ringFd = ringFd;
+    _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap) {
+        _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+    }
+    _sqRing = mapRing(_ringFd, _sqRingSize, IORING_OFF_SQ_RING);
+    _cqRing = singleMap ? _sqRing : mapRing(_ringFd, _cqRingSize, IORING_OFF_CQ_RING);
+    _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    _sqes = mapRing(_ringFd, _sqesSize, IORING_OFF_SQES);
+    if (_sqRing == nullptr || _cqRing == nullptr || _sqes == nullptr) {
+        _tearDownRing();
+        return false;
+    }
+    _sqTail = ringField<unsigned>(_sqRing, params.sq_off.tail);
+    _sqMask = ringField<unsigned>(_sqRing, params.sq_off.ring_mask);
+    _sqArray = ringField<unsigned>(_sqRing, params.sq_off.array);
+    _cqHead = ringField<unsigned>(_cqRing, params.cq_off.head);
+    _cqTail = ringField<unsigned>(_cqRing, params.cq_off.tail);
+    _cqMask = ringField<unsigned>(_cqRing, params.cq_off.ring_mask);
+    _cqes = ringField<void>(_cqRing, params.cq_off.cqes);
+    return true;
+}
+
+void UringFileWriter::_tearDownRing() noexcept {
+    if (_sqes != nullptr) {
+        ::munmap(_sqes, _sqesSize);
+    }
+    if (_cqRing != nullptr && _cqRing != _sqRing) {
+        ::munmap(_cqRing, _cqRingSize);
+    }
+    if (_sqRing != nullptr) {
+        ::munmap(_sqRing, _sqRingSize);
+    }
+    _sqes = _cqRing = _sqRing = nullptr;
+    if (_ringFd != -1) {
+        ::close(_ringFd);
+        _ringFd = -1;
+    }
+}
+
+UringFileWriter::Buffer UringFileWriter::submit(Buffer buffer, size_t minCapacity) {
+    _rethrow();
+    while (_inFlight >= _queueDepth) {
+        _waitForCompletion();
+    }
+    _rethrow();
+
+    Buffer next;
+    auto spare = std::find_if(_spare.begin(), _spare.end(), [minCapacity](const Buffer& candidate) {
+        return candidate.capacity >= minCapacity;
+    });
+    if (spare != _spare.end()) {
+        next = std::move(*spare);
+        _spare.erase(spare);
+    } else {
+        next = allocate(minCapacity);
+    }
+    next.size = 0;
+
+    auto length = buffer.size;
+    if (_direct) {
+        length -= length % kAlignment;
+        next.size = buffer.size - length;
+        std::memcpy(next.data, buffer.data + length, next.size);
+    }
+    if (length > 0 && usingUring()) {
+        const auto slot = _freeSlots.back();
+        _freeSlots.pop_back();
+        _slots[slot] = InFlight{std::move(buffer), _offset, 0, length};
+        ++_inFlight;
+        _queueWrite(slot);
+    } else if (length > 0) {
+        _writeSync(buffer.data, length, _offset);
+        _spare.push_back(std::move(buffer));
+    } else {
+        _spare.push_back(std::move(buffer));
+    }
+    _offset += length;
+
+    if (next.size > 0) {
+        // The ragged end goes through the page cache now, so the file is whole as of this
+        // submit; the next buffer writes it again from the boundary, aligned.
+        while (_inFlight > 0) {
+            _waitForCompletion();
+        }
+        _rethrow();
+        BufferedWrites buffered(_fd);
+        _writeSync(next.data, next.size, _offset);
+    }
+    return next;
+}
+
+void UringFileWriter::finish() {
+    while (_inFlight > 0) {
+        _waitForCompletion();
+    }
+    _rethrow();
+}
+
+void UringFileWriter::_queueWrite(size_t slot) {
+    auto& write = _slots[slot];
+    const auto tail = *_sqTail;
+    const auto index = tail & *_sqMask;
+    auto* sqe = static_cast<io_uring_sqe*>(_sqes) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = _fd;
+    sqe->addr = reinterpret_cast<uint64_t>(write.buffer.data + write.written);
+    sqe->len = static_cast<uint32_t>(write.length - write.written);
+    sqe->off = write.offset + write.written;
+    sqe->user_data = slot;
+    _sqArray[index] = index;
+    __atomic_store_n(_sqTail, tail + 1, __ATOMIC_RELEASE);
+    for (;;) {
+        if (ioUringEnter(_ringFd, 1, 0, 0) >= 0) {
+            return;
+        }
+        if (errno != EINTR && errno != EAGAIN) {
+            throw std::system_error(errno, std::generic_category(), "error submitting write");
+        }
+    }
+}
+
+void UringFileWriter::_waitForCompletion() {
+    if (ioUringEnter(_ringFd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+        throw std::system_error(errno, std::generic_category(), "error waiting for writes");
+    }
+    auto head = *_cqHead;
+    const auto tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+    std::vector<size_t> resubmit;
+    for (; head != tail; ++head) {
+        const auto& cqe = static_cast<const io_uring_cqe*>(_cqes)[head & *_cqMask];
+        const auto slot = static_cast<size_t>(cqe.user_data);
+        auto& write = _slots[slot];
+        if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+            resubmit.push_back(slot);
+            continue;
+        }
+        if (cqe.res < 0 || (cqe.res == 0 && write.written < write.length)) {
+            if (_error == 0) {
+                _error = cqe.res < 0 ? -cqe.res : EIO;
+            }
+        } else {
+            write.written += static_cast<size_t>(cqe.res);
+            // The kernel took less than all of it: the rest goes again.
+            if (write.written < write.length) {
+                resubmit.push_back(slot);
+                continue;
+            }
+        }
+        _spare.push_back(std::move(write.buffer));
+        _freeSlots.push_back(slot);
+        --_inFlight;
+    }
+    __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+    for (const auto slot : resubmit) {
+        _queueWrite(slot);
+    }
+}
+
+void UringFileWriter::_writeSync(const char* data, size_t size, uint64_t offset) {
+    size_t written = 0;
+    while (written < size) {
+        const auto rc = ::pwrite(_fd, data + written, size - written, static_cast<off_t>(offset + written));
+        if (rc == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "error writing output");
+        }
+        written += static_cast<size_t>(rc);
+    }
+}
+
+void UringFileWriter::_rethrow() {
+    if (_error != 0) {
+        throw std::system_error(std::exchange(_error, 0), std::generic_category(), "error writing output");
+    }
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace sqlplusplus {
+
+// Writes a file's buffers through io_uring, one after another at increasing offsets, with
+// up to queueDepth of them in flight, so filling the next buffer overlaps with writing the
+// last few rather than waiting in write(2) for each. Where io_uring isn't available, e.g.
+// an old kernel or a seccomp profile that blocks it, each buffer is written with pwrite(2)
+// as it's submitted instead.
+//
+// With direct the fd is expected to have been opened with O_DIRECT: buffers are aligned
+// for it, and a buffer that doesn't end on an alignment boundary, like the last one, has
+// its ragged end written through the page cache and carried over to the start of the
+// next, which is written from the boundary again.
+//
+// Errors, like a full disk, are rethrown from the next submit() or finish() as a
+// std::system_error.
+class UringFileWriter {
+public:
+    // What O_DIRECT needs buffers, offsets and lengths aligned to on the disks this is for.
+    static constexpr size_t kAlignment = 4096;
+
+    struct Buffer {
+        std::unique_ptr<char[]> storage;
+        // The aligned start of storage.
+        char* data = nullptr;
+        size_t capacity = 0;
+        // Bytes in it.
+        size_t size = 0;
+    };
+
+    UringFileWriter(int fd, uint32_t queueDepth, bool direct);
+    UringFileWriter(const UringFileWriter&) = delete;
+    UringFileWriter& operator=(const UringFileWriter&) = delete;
+    // Waits for what's in flight; errors are dropped, so callers that care finish() first.
+    ~UringFileWriter();
+
+    // An empty buffer of at least capacity bytes.
+    static Buffer allocate(size_t capacity);
+
+    // Queues buffer to be written after everything submitted before it, and returns one
+    // to fill next of at least minCapacity bytes, which starts with whatever of buffer
+    // had to be carried over.
+    Buffer submit(Buffer buffer, size_t minCapacity);
+    // Waits until everything submitted is written.
+    void finish();
+
+    // False when writes fall back to pwrite(2).
+    bool usingUring() const noexcept {
+        return _ringFd != -1;
+    }
+
+private:
+    struct InFlight {
+        Buffer buffer;
+        uint64_t offset = 0;
+        // Written so far, for when the kernel takes less than all of it.
+        size_t written = 0;
+        // How much of buffer, from its start, this write is for.
+        size_t length = 0;
+    };
+
+    bool _setUpRing(uint32_t entries) noexcept;
+    void _tearDownRing() noexcept;
+    void _queueWrite(size_t slot);
+    // Reaps at least one completion, resubmitting short writes.
+    void _waitForCompletion();
+    void _writeSync(const char* data, size_t size, uint64_t offset);
+    void _rethrow();
+
+    const int _fd;
+    const bool _direct;
+    const uint32_t _queueDepth;
+    uint64_t _offset = 0;
+    int _error = 0;
+
+    // Slots by index are the user_data of their writes.
+    std::vector<InFlight> _slots;
+    std::vector<size_t> _freeSlots;
+    std::vector<Buffer> _spare;
+    uint32_t _inFlight = 0;
+
+    int _ringFd = -1;
+    void* _sqRing = nullptr;
+    size_t _sqRingSize = 0;
+    void* _cqRing = nullptr;
+    size_t _cqRingSize = 0;
+    void* _sqes = nullptr;
+    size_t _sqesSize = 0;
+    unsigned* _sqTail = nullptr;
+    unsigned* _sqMask = nullptr;
+    unsigned* _sqArray = nullptr;
+    unsigned* _cqHead = nullptr;
+    unsigned* _cqTail = nullptr;
+    unsigned* _cqMask = nullptr;
+    void* _cqes = nullptr;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,388 @@
+#include "value_format.h"
+
+#include "datetime_format.h"
+#include "json_text.h"
+#include "object_format.h"
+#include "oracle_helpers.h"
+#include "result_metadata.h"
+
+#include <array>
+#include <charconv>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace sqlplusplus {
+namespace {
+
+constexpr std::array<char, 512> makeHexPairs() {
+    constexpr char kDigits[] = "0123456789abcdef";
+    std::array<char, 512> pairs{};
+    for (int value = 0; value < 256; ++value) {
+        pairs[value * 2] = kDigits[value >> 4];
+        pairs[value * 2 + 1] = kDigits[value & 0xf];
+    }
+    return pairs;
+}
+
+constexpr auto kHexPairs = makeHexPairs();
+
+char* append(char* out, std::string_view str) {
+    return std::copy(str.begin(), str.end(), out);
+}
+
+template <dpiNativeTypeNum NativeType>
+struct ValueFormat;
+
+template <>
+struct ValueFormat<DPI_NATIVE_TYPE_BOOLEAN> {
+    static size_t sizeBound(const dpiData&) {
+        return 5;
+    }
+    static char* format(const dpiData& data, char* out) {
+        return append(out, data.value.asBoolean ? "TRUE" : "FALSE");
+    }
+};
+
+template <>
+struct ValueFormat<DPI_NATIVE_TYPE_BYTES> {
+    static size_t sizeBound(const dpiData& data) {
+        return data.value.asBytes.length + 2;
+    }
+    static char* format(const dpiData& data, char* out) {
+        const auto& bytes = data.value.asBytes;
+        *out++ = '"';
+        out = std::copy(bytes.ptr, bytes.ptr + bytes.length, out);
+        *out++ = '"';
+        return out;
+    }
+};
+
+// NUMBERs fetched as text are already in the form Oracle shows them, and go out bare.
+struct NumberTextFormat {
+    static size_t sizeBound(const dpiData& data) {
+        return data.value.asBytes.length;
+    }
+    static char* format(const dpiData& data, char* out) {
+        const auto& bytes = data.value.asBytes;
+        return std::copy(bytes.ptr, bytes.ptr + bytes.length, out);
+    }
+};
+
+// Shortest round-trip output for floating point is fmt's, written through a raw pointer.
+// 32 bytes covers the longest double ("-1.7976931348623157e+308").
+template <>
+struct ValueFormat<DPI_NATIVE_TYPE_DOUBLE> {
+    static size_t sizeBound(const dpiData&) {
+        return 32;
+    }
+    static char* format(const dpiData& data, char* out) {
+        return fmt::format_to(out, "{}", data.value.asDouble);
+    }
+};
+
+template <>
+struct ValueFormat<DPI_NATIVE_TYPE_FLOAT> {
+    static size_t sizeBound(const dpiData&) {
+        return 32;
+    }
+    static char* format(const dpiData& data, char* out) {
+        return fmt::format_to(out, "{}", data.value.asFloat);
+    }
+};
+
+template <>
+struct ValueFormat<DPI_NATIVE_TYPE_INT64> {
+    static size_t sizeBound(const dpiData&) {
+        return 20;
+    }
+    static char* format(const dpiData& data, char* out) {
+        return std::to_chars(out, out + 20, data.value.asInt64).ptr;
+    }
+};
+
+template <>
+struct ValueFormat<DPI_NATIVE_TYPE_UINT64> {
+    static size_t sizeBound(const dpiData&) {
+        return 20;
+    }
+    static char* format(const dpiData& data, char* out) {
+        return std::to_chars(out, out + 20, data.value.asUint64).ptr;
+    }
+};
+
+// Dates and timestamps are written through the session's mask for their kind, a field at
+// a time from a digit table rather than through fmt.
+template <DateTimeKind Kind>
+struct DateTimeFormat {
+    static size_t sizeBound(const dpiData&) {
+        return dateTimeMask(Kind).sizeBound();
+    }
+    static char* format(const dpiData& data, char* out) {
+        return dateTimeMask(Kind).format(data.value.asTimestamp, out);
+    }
+};
+
+template <>
+struct ValueFormat<DPI_NATIVE_TYPE_INTERVAL_DS> {
+    static size_t sizeBound(const dpiData&) {
+        return kIntervalDSSizeBound;
+    }
+    static char* format(const dpiData& data, char* out) {
+        return formatIntervalDS(data.value.asIntervalDS, out);
+    }
+};
+
+template <>
+struct ValueFormat<DPI_NATIVE_TYPE_INTERVAL_YM> {
+    static size_t sizeBound(const dpiData&) {
+        return kIntervalYMSizeBound;
+    }
+    static char* format(const dpiData& data, char* out) {
+        return formatIntervalYM(data.value.asIntervalYM, out);
+    }
+};
+
+// Native JSON columns are shown as compact JSON text. There's no error context to report a
+// decoding failure through here, so a document ODPI can't decode is shown as such.
+template <>
+struct ValueFormat<DPI_NATIVE_TYPE_JSON> {
+    static constexpr std::string_view kInvalidText = "<invalid json>";
+    static const dpiJsonNode* node(const dpiData& data) {
+        dpiJsonNode* node = nullptr;
+        if (dpiJson_getValue(data.value.asJson, DPI_JSON_OPT_NUMBER_AS_STRING, &node) != DPI_SUCCESS) {
+            return nullptr;
+        }
+        return node;
+    }
+    static size_t sizeBound(const dpiData& data) {
+        auto top = node(data);
+        return top ? jsonNodeSizeBound(*top) : kInvalidText.size();
+    }
+    static char* format(const dpiData& data, char* out) {
+        auto top = node(data);
+        return top ? writeJsonNode(*top, out) : append(out, kInvalidText);
+    }
+};
+
+// A LOB is shown by its first kLobPreviewChars characters, or its first bytes in hex for a
+// BLOB, read in one round trip, with the rest elided. Short LOBs, which is most of them,
+// are told apart without asking for the LOB's size. As with JSON there's no error context
+// to report through, so a LOB that can't be read is shown as such.
+constexpr uint64_t kLobPreviewChars = 1000;
+// UTF-8 takes up to four bytes a character.
+constexpr uint64_t kMaxBytesPerChar = 4;
+constexpr std::string_view kUnreadableLobText = "<unreadable lob>";
+constexpr std::string_view kElidedText = "...";
+
+bool lobIsLonger(dpiLob* lob, uint64_t size) {
+    uint64_t lobSize = 0;
+    return dpiLob_getSize(lob, &lobSize) == DPI_SUCCESS && lobSize > size;
+}
+
+struct ClobPreviewFormat {
+    static size_t sizeBound(const dpiData&) {
+        return kLobPreviewChars * kMaxBytesPerChar + 2 + kElidedText.size();
+    }
+    static char* format(const dpiData& data, char* out) {
+        auto lob = data.value.asLOB;
+        uint64_t length = kLobPreviewChars * kMaxBytesPerChar;
+        if (dpiLob_readBytes(lob, 1, kLobPreviewChars, out + 1, &length) != DPI_SUCCESS) {
+            return append(out, kUnreadableLobText);
+        }
+        *out = '"';
+        out += length + 1;
+        *out++ = '"';
+        // Every character is at least a byte, so fewer bytes than characters asked for
+        // means the whole value was read.
+        if (length >= kLobPreviewChars && lobIsLonger(lob, kLobPreviewChars)) {
+            out = append(out, kElidedText);
+        }
+        return out;
+    }
+};
+
+struct BlobPreviewFormat {
+    static constexpr uint64_t kPreviewBytes = kLobPreviewChars / 2;
+    static size_t sizeBound(const dpiData&) {
+        return std::max(kPreviewBytes * 2 + kElidedText.size(), kUnreadableLobText.size());
+    }
+    static char* format(const dpiData& data, char* out) {
+        auto lob = data.value.asLOB;
+        char bytes[kPreviewBytes];
+        uint64_t length = kPreviewBytes;
+        if (dpiLob_readBytes(lob, 1, kPreviewBytes, bytes, &length) != DPI_SUCCESS) {
+            return append(out, kUnreadableLobText);
+        }
+        out = writeHex(std::string_view(bytes, length), out);
+        if (length == kPreviewBytes && lobIsLonger(lob, kPreviewBytes)) {
+            out = append(out, kElidedText);
+        }
+        return out;
+    }
+};
+
+// RAW and LONG RAW values, and BLOBs fetched inline, which read like their previews.
+struct HexBytesFormat {
+    static size_t sizeBound(const dpiData& data) {
+        return data.value.asBytes.length * 2;
+    }
+    static char* format(const dpiData& data, char* out) {
+        const auto& bytes = data.value.asBytes;
+        return writeHex(std::string_view(bytes.ptr, bytes.length), out);
+    }
+};
+
+// ROWIDs and UROWIDs are shown bare, as their base 64 text. ODPI works the text out the
+// first time it's asked for and keeps it with the rowid, so a value that's never shown is
+// never converted, and sizing one and then writing it converts it once.
+constexpr std::string_view kUnreadableRowidText = "<unreadable rowid>";
+
+struct RowidFormat {
+    static std::string_view text(const dpiData& data) {
+        const auto text = rowidText(data.value.asRowid);
+        return text.empty() ? kUnreadableRowidText : text;
+    }
+    static size_t sizeBound(const dpiData& data) {
+        return text(data).size();
+    }
+    static char* format(const dpiData& data, char* out) {
+        return append(out, text(data));
+    }
+};
+
+struct UnsupportedFormat {
+    static constexpr std::string_view kText = "unsupported type";
+    static size_t sizeBound(const dpiData&) {
+        return kText.size();
+    }
+    static char* format(const dpiData&, char* out) {
+        return append(out, kText);
+    }
+};
+
+template <typename Format>
+std::pair<ValueFormatFn, ValueSizeBoundFn> formatFns() {
+    return {Format::format, Format::sizeBound};
+}
+
+std::pair<ValueFormatFn, ValueSizeBoundFn> formatterFor(dpiNativeTypeNum nativeType, dpiOracleTypeNum oracleType) {
+    switch (nativeType) {
+    case DPI_NATIVE_TYPE_BOOLEAN:
+        return formatFns<ValueFormat<DPI_NATIVE_TYPE_BOOLEAN>>();
+    case DPI_NATIVE_TYPE_BYTES:
+        if (isBinaryType(oracleType)) {
+            return formatFns<HexBytesFormat>();
+        }
+        if (oracleType == DPI_ORACLE_TYPE_NUMBER) {
+            return formatFns<NumberTextFormat>();
+        }
+        return formatFns<ValueFormat<DPI_NATIVE_TYPE_BYTES>>();
+    case DPI_NATIVE_TYPE_DOUBLE:
+        return formatFns<ValueFormat<DPI_NATIVE_TYPE_DOUBLE>>();
+    case DPI_NATIVE_TYPE_FLOAT:
+        return formatFns<ValueFormat<DPI_NATIVE_TYPE_FLOAT>>();
+    case DPI_NATIVE_TYPE_INT64:
+        return formatFns<ValueFormat<DPI_NATIVE_TYPE_INT64>>();
+    case DPI_NATIVE_TYPE_UINT64:
+        return formatFns<ValueFormat<DPI_NATIVE_TYPE_UINT64>>();
+    case DPI_NATIVE_TYPE_TIMESTAMP:
+        if (oracleType == DPI_ORACLE_TYPE_DATE) {
+            return formatFns<DateTimeFormat<DateTimeKind::Date>>();
+        }
+        if (oracleType == DPI_ORACLE_TYPE_TIMESTAMP_TZ) {
+            return formatFns<DateTimeFormat<DateTimeKind::TimestampTz>>();
+        }
+        return formatFns<DateTimeFormat<DateTimeKind::Timestamp>>();
+    case DPI_NATIVE_TYPE_INTERVAL_DS:
+        return formatFns<ValueFormat<DPI_NATIVE_TYPE_INTERVAL_DS>>();
+    case DPI_NATIVE_TYPE_INTERVAL_YM:
+        return formatFns<ValueFormat<DPI_NATIVE_TYPE_INTERVAL_YM>>();
+    case DPI_NATIVE_TYPE_JSON:
+        return formatFns<ValueFormat<DPI_NATIVE_TYPE_JSON>>();
+    case DPI_NATIVE_TYPE_LOB:
+        if (isBinaryLob(oracleType)) {
+            return formatFns<BlobPreviewFormat>();
+        }
+        return formatFns<ClobPreviewFormat>();
+    case DPI_NATIVE_TYPE_ROWID:
+        return formatFns<RowidFormat>();
+    default:
+        return formatFns<UnsupportedFormat>();
+    }
+}
+
+} // namespace
+
+ColumnFormatter::ColumnFormatter(dpiNativeTypeNum nativeType, dpiOracleTypeNum oracleType, dpiObjectType* objectType)
+    : _nativeType(nativeType),
+      _oracleType(oracleType)
+{
+    std::tie(_format, _sizeBound) = formatterFor(nativeType, oracleType);
+    if (nativeType == DPI_NATIVE_TYPE_OBJECT) {
+        _object = ObjectLayout::forType(objectType);
+    }
+}
+
+size_t ColumnFormatter::_objectSizeBound(const dpiData& data) const {
+    return _object->sizeBound(data.value.asObject);
+}
+
+char* ColumnFormatter::_formatObject(const dpiData& data, char* out) const {
+    return _object->format(data.value.asObject, out);
+}
+
+// RAW(16) GUIDs and RAW(32) hashes are one or two vector iterations; the table covers the
+// tail and machines without vectors.
+char* writeHex(std::string_view bytes, char* out) {
+    const auto size = bytes.size();
+    size_t idx = 0;
+#if defined(__SSE2__)
+    const auto data = bytes.data();
+    const __m128i lowNibble = _mm_set1_epi8(0x0f);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i letterGap = _mm_set1_epi8('a' - '0' - 10);
+    auto toDigits = [&](__m128i nibbles) {
+        const auto letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, nine), letterGap);
+        return _mm_add_epi8(_mm_add_epi8(nibbles, zero), letters);
+    };
+    for (; idx + 16 <= size; idx += 16) {
+        const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + idx));
+        const auto high = toDigits(_mm_and_si128(_mm_srli_epi16(chunk, 4), lowNibble));
+        const auto low = toDigits(_mm_and_si128(chunk, lowNibble));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi8(high, low));
+        out += 32;
+    }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    const auto data = reinterpret_cast<const uint8_t*>(bytes.data());
+    const uint8x16_t digits = vld1q_u8(reinterpret_cast<const uint8_t*>("0123456789abcdef"));
+    for (; idx + 16 <= size; idx += 16) {
+        const auto chunk = vld1q_u8(data + idx);
+        uint8x16x2_t pairs;
+        pairs.val[0] = vqtbl1q_u8(digits, vshrq_n_u8(chunk, 4));
+        pairs.val[1] = vqtbl1q_u8(digits, vandq_u8(chunk, vdupq_n_u8(0x0f)));
+        vst2q_u8(reinterpret_cast<uint8_t*>(out), pairs);
+        out += 32;
+    }
+#endif
+    for (; idx < size; ++idx) {
+        const auto pair = kHexPairs.data() + static_cast<unsigned char>(bytes[idx]) * 2;
+        *out++ = pair[0];
+        *out++ = pair[1];
+    }
+    return out;
+}
+
+std::vector<ColumnFormatter> makeColumnFormatters(const OracleResultSource& stmt) {
+    return stmt.metadata()->formatters();
+}
+
+} // namespace sqlplusplus
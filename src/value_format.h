@@ -0,0 +1,98 @@
+#pragma once
+
+#include "dpi.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+class ObjectLayout;
+class OracleResultSource;
+
+// Writes the text of a non-null value starting at out and returns the end of what was written.
+using ValueFormatFn = char* (*)(const dpiData& data, char* out);
+// Upper bound on the number of bytes the matching ValueFormatFn writes for a value.
+using ValueSizeBoundFn = size_t (*)(const dpiData& data);
+
+// Text formatting for one result column. The formatting function is chosen once from the
+// column's native type, so formatting a cell is a null check plus a direct call into a
+// routine that reads the dpiData union without any further type checks. Objects and
+// collections are the exception, formatted through their type's ObjectLayout.
+//
+// Values are written straight into caller provided storage: callers reserve sizeBound()
+// bytes wherever the text should end up (a table arena, an output buffer), format into it
+// and give back the unused tail, so each value is materialized exactly once.
+class ColumnFormatter {
+public:
+    static constexpr std::string_view kNullText = "<null>";
+
+    // The Oracle type only matters for LOBs, whose previews are text for CLOBs and hex
+    // for BLOBs, for RAWs and BLOBs fetched inline, which are hex too, for NUMBERs
+    // fetched as text, which aren't quoted, and for telling DATEs and TIMESTAMP WITH TIME
+    // ZONEs from other timestamps. Objects need their type to be shown at all.
+    explicit ColumnFormatter(dpiNativeTypeNum nativeType,
+                             dpiOracleTypeNum oracleType = DPI_ORACLE_TYPE_NONE,
+                             dpiObjectType* objectType = nullptr);
+
+    dpiNativeTypeNum nativeType() const noexcept {
+        return _nativeType;
+    }
+    dpiOracleTypeNum oracleType() const noexcept {
+        return _oracleType;
+    }
+
+    size_t sizeBound(const dpiData& data) const {
+        if (data.isNull) {
+            return kNullText.size();
+        }
+        return _object ? _objectSizeBound(data) : _sizeBound(data);
+    }
+
+    char* format(const dpiData& data, char* out) const {
+        if (data.isNull) {
+            return std::copy(kNullText.begin(), kNullText.end(), out);
+        }
+        return _object ? _formatObject(data, out) : _format(data, out);
+    }
+
+    void format(const dpiData& data, fmt::memory_buffer& out) const {
+        const auto start = out.size();
+        out.resize(start + sizeBound(data));
+        auto end = format(data, out.data() + start);
+        out.resize(static_cast<size_t>(end - out.data()));
+    }
+
+private:
+    size_t _objectSizeBound(const dpiData& data) const;
+    char* _formatObject(const dpiData& data, char* out) const;
+
+    dpiNativeTypeNum _nativeType;
+    dpiOracleTypeNum _oracleType;
+    ValueFormatFn _format;
+    ValueSizeBoundFn _sizeBound;
+    std::shared_ptr<const ObjectLayout> _object;
+};
+
+// Whether LOBs of oracleType hold bytes rather than text; they're written out as hex.
+inline bool isBinaryLob(dpiOracleTypeNum oracleType) noexcept {
+    return oracleType == DPI_ORACLE_TYPE_BLOB || oracleType == DPI_ORACLE_TYPE_BFILE;
+}
+
+// Whether values of oracleType are bytes rather than text, as RAW and LONG RAW values are
+// as well as binary LOBs; they're written out as hex too.
+inline bool isBinaryType(dpiOracleTypeNum oracleType) noexcept {
+    return isBinaryLob(oracleType) || oracleType == DPI_ORACLE_TYPE_RAW || oracleType == DPI_ORACLE_TYPE_LONG_RAW;
+}
+
+// Writes bytes as two lowercase hex digits each and returns the end of what was written.
+char* writeHex(std::string_view bytes, char* out);
+
+// Builds a formatter for every column of an executed query from its described metadata.
+std::vector<ColumnFormatter> makeColumnFormatters(const OracleResultSource& stmt);
+
+} // namespace sqlplusplus
@@ -0,0 +1,60 @@
+#include "vertical_layout.h"
+
+#include "display_width.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace sqlplusplus {
+namespace {
+
+constexpr std::string_view kSeparator = " : ";
+
+void appendText(fmt::memory_buffer& out, std::string_view text) {
+    out.append(text.data(), text.data() + text.size());
+}
+
+void appendSpaces(fmt::memory_buffer& out, size_t count) {
+    for (size_t idx = 0; idx < count; ++idx) {
+        out.push_back(' ');
+    }
+}
+
+} // namespace
+
+VerticalLayout::VerticalLayout(std::vector<std::string> names, uint64_t firstRecord)
+    : _names(std::move(names)), _nextRecord(firstRecord) {
+    _nameWidths.reserve(_names.size());
+    for (const auto& name : _names) {
+        _nameWidths.push_back(displayWidth(name));
+        _labelWidth = std::max(_labelWidth, _nameWidths.back());
+    }
+}
+
+void VerticalLayout::writeRecord(const std::string_view* cells, std::ostream& out) {
+    _buffer.clear();
+    const auto heading = fmt::format("-[ RECORD {} ]", _nextRecord++);
+    appendText(_buffer, heading);
+    // The rule runs out to where the values start, or a little past the heading.
+    const auto ruleWidth = std::max(_labelWidth + kSeparator.size(), heading.size() + 4);
+    for (size_t idx = heading.size(); idx < ruleWidth; ++idx) {
+        _buffer.push_back('-');
+    }
+    _buffer.push_back('\n');
+    for (size_t col = 0; col < _names.size(); ++col) {
+        appendText(_buffer, _names[col]);
+        appendSpaces(_buffer, _labelWidth - _nameWidths[col]);
+        appendText(_buffer, kSeparator);
+        auto value = cells[col];
+        for (auto lineEnd = value.find('\n'); lineEnd != std::string_view::npos; lineEnd = value.find('\n')) {
+            appendText(_buffer, value.substr(0, lineEnd + 1));
+            appendSpaces(_buffer, _labelWidth + kSeparator.size());
+            value.remove_prefix(lineEnd + 1);
+        }
+        appendText(_buffer, value);
+        _buffer.push_back('\n');
+    }
+    out.write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+}
+
+} // namespace sqlplusplus
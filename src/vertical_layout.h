@@ -0,0 +1,53 @@
+#pragma once
+
+#include "fmt/format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+// Lays rows out a block each, one "column : value" line per column, for results too wide
+// to read across. Every record is written as it's handed over: nothing depends on the
+// values of other rows, so unlike a Table there's no measuring pass and nothing kept
+// between records but the names.
+//
+//   -[ RECORD 1 ]----------
+//   EMPLOYEE_ID : 100
+//   FIRST_NAME  : "Steven"
+//
+// A value with line breaks in it carries on under the first line.
+class VerticalLayout {
+public:
+    // firstRecord is the number the first record is headed with.
+    explicit VerticalLayout(std::vector<std::string> names, uint64_t firstRecord = 1);
+
+    // Writes a record of names().size() cells to out.
+    void writeRecord(const std::string_view* cells, std::ostream& out);
+
+    const std::vector<std::string>& names() const noexcept {
+        return _names;
+    }
+    // The number the next record will be headed with.
+    uint64_t nextRecord() const noexcept {
+        return _nextRecord;
+    }
+    // Numbers the next record as if count more had been written first.
+    void skipRecords(uint64_t count) noexcept {
+        _nextRecord += count;
+    }
+
+private:
+    std::vector<std::string> _names;
+    // Display widths of the names, and of the widest.
+    std::vector<size_t> _nameWidths;
+    size_t _labelWidth = 0;
+    uint64_t _nextRecord;
+    fmt::memory_buffer _buffer;
+};
+
+} // namespace sqlplusplus
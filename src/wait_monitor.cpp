@@ -0,0 +1,211 @@
+#include "wait_monitor.h"
+
+#include "typed_bind.h"
+#include "typed_rows.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <tuple>
+
+namespace sqlplusplus {
+
+WaitMonitor::~WaitMonitor() {
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        _stopping = true;
+    }
+    _changed.notify_all();
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+void WaitMonitor::begin(OracleConnection& watched, std::function<OracleConnection()> newConnection,
+                        std::chrono::milliseconds interval, bool statusLine) {
+    std::optional<std::pair<int64_t, int64_t>> identity;
+    if (!_watched || !_watched->isSameSession(watched)) {
+        auto stmt = watched.prepareStatement(
+                "SELECT sid, serial# FROM v$session WHERE sid = SYS_CONTEXT('USERENV', 'SID')");
+        stmt.execute();
+        forEachRow<int64_t, int64_t>(stmt, [&](int64_t sid, int64_t serial) {
+            identity.emplace(sid, serial);
+        });
+        _watched = watched.share();
+    }
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (identity) {
+        std::tie(_sid, _serial) = *identity;
+        ++_watchedGeneration;
+    }
+    _newConnection = std::move(newConnection);
+    _active = true;
+    _interval = std::max(interval, std::chrono::milliseconds(1));
+    _statusLine = statusLine;
+    _statementStart = std::chrono::steady_clock::now();
+    _eventSamples.clear();
+    _samples = 0;
+    _error.clear();
+    if (!_thread.joinable()) {
+        _thread = std::thread([this] { _run(); });
+    }
+}
+
+WaitMonitor::Summary WaitMonitor::finish() {
+    std::lock_guard<std::mutex> lk(_mutex);
+    _active = false;
+    _clearStatusLine();
+    Summary summary;
+    summary.samples = _samples;
+    summary.error = std::move(_error);
+    for (const auto& [event, samples] : _eventSamples) {
+        summary.events.push_back(EventSamples{event, samples});
+    }
+    std::stable_sort(summary.events.begin(), summary.events.end(), [](const auto& a, const auto& b) {
+        return a.samples > b.samples;
+    });
+    return summary;
+}
+
+WaitMonitor::Blocked::Blocked(WaitMonitor* monitor) : _monitor(monitor) {
+    if (_monitor) {
+        std::lock_guard<std::mutex> lk(_monitor->_mutex);
+        if (!_monitor->_active) {
+            _monitor = nullptr;
+            return;
+        }
+        _monitor->_blocked = true;
+        ++_monitor->_blockedGeneration;
+    }
+    if (_monitor) {
+        _monitor->_changed.notify_all();
+    }
+}
+
+WaitMonitor::Blocked::~Blocked() {
+    if (_monitor) {
+        std::lock_guard<std::mutex> lk(_monitor->_mutex);
+        _monitor->_blocked = false;
+        _monitor->_clearStatusLine();
+    }
+}
+
+void WaitMonitor::_clearStatusLine() {
+    if (_lineShown) {
+        std::cerr << "\r\033[K" << std::flush;
+        _lineShown = false;
+    }
+}
+
+WaitMonitor::Sample WaitMonitor::_sample(OracleConnection& conn, int64_t sid, int64_t serial, double secondsRunning) {
+    Sample sample;
+    auto stmt = conn.prepareStatement(R"(
+SELECT CASE WHEN state = 'WAITING' THEN event ELSE 'ON CPU' END,
+       CASE WHEN state = 'WAITING' THEN wait_class END,
+       CAST(NVL(wait_time_micro, 0) AS NUMBER(18))
+  FROM v$session
+ WHERE sid = :1 AND serial# = :2)");
+    bind(stmt, sid, serial);
+    stmt.execute();
+    forEachRow<std::string, std::optional<std::string>, int64_t>(stmt,
+            [&](std::string event, std::optional<std::string> waitClass, int64_t waitMicros) {
+        sample.event = std::move(event);
+        sample.waitClass = waitClass.value_or("");
+        sample.waitMicros = waitMicros;
+    });
+    if (sample.event.empty()) {
+        throw std::runtime_error(fmt::format("session {},{} isn't in v$session", sid, serial));
+    }
+    if (_ashUnavailable) {
+        return sample;
+    }
+    try {
+        auto ash = conn.prepareStatement(R"(
+SELECT *
+  FROM (SELECT CAST(sql_plan_line_id AS NUMBER(10)), TRIM(sql_plan_operation || ' ' || sql_plan_options)
+          FROM v$active_session_history
+         WHERE session_id = :1 AND session_serial# = :2
+           AND sample_time > SYSTIMESTAMP - NUMTODSINTERVAL(:3, 'SECOND')
+           AND sql_plan_line_id IS NOT NULL
+         ORDER BY sample_id DESC)
+ WHERE ROWNUM = 1)");
+        bind(ash, sid, serial, secondsRunning);
+        ash.execute();
+        forEachRow<int64_t, std::optional<std::string>>(ash, [&](int64_t line, std::optional<std::string> operation) {
+            sample.planLine = line;
+            sample.planOperation = operation.value_or("");
+        });
+    } catch (const std::exception&) {
+        // Without access to ASH, or the pack it needs, the status just goes without
+        // plan lines.
+        _ashUnavailable = true;
+    }
+    return sample;
+}
+
+void WaitMonitor::_run() {
+    std::optional<OracleConnection> conn;
+    uint64_t connGeneration = 0;
+    std::unique_lock<std::mutex> lk(_mutex);
+    for (;;) {
+        _changed.wait(lk, [this] { return _stopping || (_active && _blocked && _error.empty()); });
+        if (_stopping) {
+            return;
+        }
+        // Only a call still blocked a whole interval later is sampled.
+        const auto generation = _blockedGeneration;
+        const auto interval = _interval;
+        if (_changed.wait_for(lk, interval, [&] {
+                return _stopping || !_blocked || _blockedGeneration != generation; })) {
+            continue;
+        }
+        const std::chrono::duration<double> running = std::chrono::steady_clock::now() - _statementStart;
+        const auto sid = _sid;
+        const auto serial = _serial;
+        const auto newConnection = _newConnection;
+        if (connGeneration != _watchedGeneration) {
+            connGeneration = _watchedGeneration;
+            conn.reset();
+            _ashUnavailable = false;
+        }
+        lk.unlock();
+        std::optional<Sample> sample;
+        std::string error;
+        try {
+            if (!conn) {
+                conn.emplace(newConnection());
+            }
+            sample = _sample(*conn, sid, serial, running.count());
+        } catch (const std::exception& e) {
+            error = e.what();
+            conn.reset();
+        }
+        lk.lock();
+        if (!_active) {
+            continue;
+        }
+        if (!sample) {
+            _error = std::move(error);
+            continue;
+        }
+        ++_samples;
+        ++_eventSamples[sample->event];
+        if (_statusLine && _blocked && _blockedGeneration == generation) {
+            fmt::memory_buffer line;
+            fmt::format_to(line, "\r\033[K[{:.1f}s] {}", running.count(), sample->event);
+            if (!sample->waitClass.empty()) {
+                fmt::format_to(line, " ({}), {:.1f} ms in wait", sample->waitClass, sample->waitMicros / 1000.0);
+            }
+            if (sample->planLine) {
+                fmt::format_to(line, "; plan line {} {}", *sample->planLine, sample->planOperation);
+            }
+            std::cerr << std::string_view(line.data(), line.size()) << std::flush;
+            _lineShown = true;
+        }
+    }
+}
+
+} // namespace sqlplusplus
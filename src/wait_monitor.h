@@ -0,0 +1,114 @@
+#pragma once
+
+#include "oracle_helpers.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sqlplusplus {
+
+// Watches what a session's statement is waiting on while the client is blocked in its
+// execute or fetches: a thread of its own polls V$SESSION for the session from a second
+// connection, and, where the account can read it, V$ACTIVE_SESSION_HISTORY for the plan
+// line the last sample was on. Each poll can redraw a status line on stderr, which is
+// cleared before the blocked call returns, so it never lands in the middle of a result;
+// the polls of a statement add up to a summary of where its time went.
+//
+// Nothing is sampled until a call has been blocked for a whole interval, so statements
+// that come back quickly cost nothing beyond a flag. Polling errors, like an account that
+// can't read V$SESSION, stop sampling for the statement and are reported in its summary.
+class WaitMonitor {
+public:
+    struct EventSamples {
+        std::string event;
+        uint32_t samples = 0;
+    };
+
+    struct Summary {
+        uint32_t samples = 0;
+        // Most sampled first.
+        std::vector<EventSamples> events;
+        // Why sampling stopped early, when it did.
+        std::string error;
+    };
+
+    WaitMonitor() = default;
+    WaitMonitor(const WaitMonitor&) = delete;
+    WaitMonitor& operator=(const WaitMonitor&) = delete;
+    ~WaitMonitor();
+
+    // Starts watching a statement about to run on watched, polling every interval while
+    // it's blocked from a connection newConnection makes to the same database. The first
+    // statement on a session looks up its SID, a round trip, and has the polling connection
+    // made again, since the REPL may have moved to another target.
+    void begin(OracleConnection& watched, std::function<OracleConnection()> newConnection,
+               std::chrono::milliseconds interval, bool statusLine);
+    // Stops watching and returns what the polls saw.
+    Summary finish();
+
+    // Marks the calling thread as blocked on the watched statement for its lifetime; the
+    // line it drew is gone by the time it's destroyed. A null monitor, or one that isn't
+    // watching a statement, makes it a no-op.
+    class Blocked {
+    public:
+        explicit Blocked(WaitMonitor* monitor);
+        Blocked(const Blocked&) = delete;
+        Blocked& operator=(const Blocked&) = delete;
+        ~Blocked();
+
+    private:
+        WaitMonitor* _monitor;
+    };
+
+private:
+    struct Sample {
+        std::string event;
+        std::string waitClass;
+        int64_t waitMicros = 0;
+        std::optional<int64_t> planLine;
+        std::string planOperation;
+    };
+
+    void _run();
+    Sample _sample(OracleConnection& conn, int64_t sid, int64_t serial, double secondsRunning);
+    void _clearStatusLine();
+
+    // The watched session, kept to tell when the REPL's session has been replaced.
+    std::optional<OracleConnection> _watched;
+
+    // Guarded by _mutex, like everything after it.
+    std::mutex _mutex;
+    std::condition_variable _changed;
+    std::function<OracleConnection()> _newConnection;
+    // Bumped whenever the watched session changes, so the polling thread drops the
+    // connection it made for the last one.
+    uint64_t _watchedGeneration = 0;
+    int64_t _sid = 0;
+    int64_t _serial = 0;
+    bool _active = false;
+    bool _blocked = false;
+    // Bumped by every Blocked, so a poll that finishes after its call has returned is
+    // dropped rather than drawn.
+    uint64_t _blockedGeneration = 0;
+    bool _stopping = false;
+    bool _statusLine = false;
+    bool _lineShown = false;
+    std::chrono::milliseconds _interval{0};
+    std::chrono::steady_clock::time_point _statementStart;
+    std::map<std::string, uint32_t> _eventSamples;
+    uint32_t _samples = 0;
+    std::string _error;
+    // Only used by the polling thread, and reset with its connection.
+    bool _ashUnavailable = false;
+    std::thread _thread;
+};
+
+} // namespace sqlplusplus
@@ -0,0 +1,133 @@
+#include "watch_view.h"
+
+#include "terminal.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace sqlplusplus {
+namespace {
+
+// Header, header underline and status line.
+constexpr uint32_t kChromeRows = 3;
+constexpr std::string_view kColumnSeparator = " │ ";
+constexpr uint32_t kSeparatorWidth = 3;
+
+void moveTo(std::string& frame, uint32_t line, uint32_t column) {
+    fmt::format_to(std::back_inserter(frame), "\x1b[{};{}H", line, column);
+}
+
+} // namespace
+
+WatchView::WatchView(std::vector<std::string> columnNames, uint32_t keyColumn) :
+    _columnNames(std::move(columnNames)),
+    _keyColumn(keyColumn)
+{}
+
+uint32_t WatchView::viewRows(uint32_t screenRows) noexcept {
+    return screenRows > kChromeRows + 1 ? screenRows - kChromeRows : 1;
+}
+
+void WatchView::_layout(const std::vector<std::vector<std::string>>& rows, uint32_t screenColumns) {
+    if (_widths.empty()) {
+        for (const auto& name : _columnNames) {
+            _widths.push_back(cappedDisplayWidth(name, kMaxColumnWidth));
+        }
+        for (const auto& row : rows) {
+            for (size_t col = 0; col < row.size(); ++col) {
+                _widths[col] = std::max(_widths[col], cappedDisplayWidth(row[col], kMaxColumnWidth));
+            }
+        }
+    }
+
+    // As many columns as fit; the first one always shows, cut to the screen if it has to be.
+    _visible.clear();
+    uint32_t x = 1;
+    for (uint32_t col = 0; col < _widths.size(); ++col) {
+        const auto separator = _visible.empty() ? 0 : kSeparatorWidth;
+        if (x - 1 + separator + _widths[col] > screenColumns) {
+            if (_visible.empty()) {
+                _visible.push_back({col, screenColumns, 1});
+            }
+            break;
+        }
+        _visible.push_back({col, _widths[col], x + separator});
+        x += separator + _widths[col];
+    }
+}
+
+void WatchView::_appendLine(std::string& frame, const std::vector<std::string>& row) const {
+    for (size_t idx = 0; idx < _visible.size(); ++idx) {
+        if (idx > 0) {
+            frame += kColumnSeparator;
+        }
+        appendCell(frame, row[_visible[idx].column], _visible[idx].width);
+    }
+    frame += "\x1b[K";
+}
+
+std::string WatchView::update(std::vector<std::vector<std::string>> rows, std::string_view status,
+                              uint32_t screenRows, uint32_t screenColumns) {
+    const auto maxRows = viewRows(screenRows);
+    if (rows.size() > maxRows) {
+        rows.resize(maxRows);
+    }
+
+    std::string frame;
+    const bool redraw = screenRows != _screenRows || screenColumns != _screenColumns;
+    if (redraw) {
+        _screenRows = screenRows;
+        _screenColumns = screenColumns;
+        _layout(rows, screenColumns);
+        _shown.clear();
+
+        frame += "\x1b[H\x1b[2J\x1b[1m";
+        _appendLine(frame, _columnNames);
+        frame += "\x1b[0m\r\n";
+        for (size_t idx = 0; idx < _visible.size(); ++idx) {
+            if (idx > 0) {
+                frame += "─┼─";
+            }
+            for (uint32_t pos = 0; pos < _visible[idx].width; ++pos) {
+                frame += "─";
+            }
+        }
+    }
+
+    // Lines are 1-based, and rows start under the header and its underline.
+    constexpr uint32_t kFirstRowLine = 3;
+    const auto lines = std::max(rows.size(), _shown.size());
+    for (size_t idx = 0; idx < lines; ++idx) {
+        const auto line = kFirstRowLine + static_cast<uint32_t>(idx);
+        if (idx >= rows.size()) {
+            moveTo(frame, line, 1);
+            frame += "\x1b[K";
+            continue;
+        }
+        const auto& row = rows[idx];
+        if (idx >= _shown.size() || _shown[idx][_keyColumn] != row[_keyColumn]) {
+            moveTo(frame, line, 1);
+            _appendLine(frame, row);
+            continue;
+        }
+        const auto& shown = _shown[idx];
+        for (const auto& visible : _visible) {
+            if (shown[visible.column] != row[visible.column]) {
+                moveTo(frame, line, visible.x);
+                appendCell(frame, row[visible.column], visible.width);
+            }
+        }
+    }
+
+    moveTo(frame, screenRows, 1);
+    frame += "\x1b[7m";
+    appendCell(frame, status, screenColumns);
+    frame += "\x1b[0m\x1b[K";
+    _shown = std::move(rows);
+    return frame;
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+// The screen of a query that's run again and again, as .watch shows it. Each update()
+// turns a new set of rows into only the terminal output that changes the last frame into
+// it: the cells that changed in rows that stayed where they were, whole lines where a
+// different row took a line over, and cleared lines where rows went away. Rows are told
+// apart by their key column, so a row that moves is redrawn rather than diffed against
+// whatever was on its line before.
+//
+// Column widths are settled from the first rows and stay put, so cells can be rewritten
+// where they are; wider values are cut.
+class WatchView {
+public:
+    static constexpr uint32_t kMaxColumnWidth = 48;
+
+    WatchView(std::vector<std::string> columnNames, uint32_t keyColumn);
+
+    // How many rows fit on a screen of screenRows lines, under the header and above the
+    // status line. Rows past that aren't shown.
+    static uint32_t viewRows(uint32_t screenRows) noexcept;
+
+    // Each row holds a value per column. Everything is drawn again when the screen size
+    // changes.
+    std::string update(std::vector<std::vector<std::string>> rows, std::string_view status,
+                       uint32_t screenRows, uint32_t screenColumns);
+
+private:
+    void _layout(const std::vector<std::vector<std::string>>& rows, uint32_t screenColumns);
+    void _appendLine(std::string& frame, const std::vector<std::string>& row) const;
+
+    std::vector<std::string> _columnNames;
+    uint32_t _keyColumn;
+    std::vector<uint32_t> _widths;
+    // The columns that fit on screen, with the width and 1-based screen column each is drawn at.
+    struct VisibleColumn {
+        uint32_t column;
+        uint32_t width;
+        uint32_t x;
+    };
+    std::vector<VisibleColumn> _visible;
+    std::vector<std::vector<std::string>> _shown;
+    uint32_t _screenRows = 0;
+    uint32_t _screenColumns = 0;
+};
+
+} // namespace sqlplusplus
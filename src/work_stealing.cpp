@@ -0,0 +1,375 @@
+#include "work_stealing.h"
+
+#include "trace_recorder.h"
+
+#include <algorithm>
+#include <exception>
+#include <numeric>
+
+namespace sqlplusplus {
+namespace {
+
+// Which executor's worker the current thread is, if any.
+thread_local const WorkStealingExecutor* tExecutor = nullptr;
+thread_local uint32_t tWorker = 0;
+
+std::atomic<uint32_t> sharedThreads{0};
+std::atomic<uint32_t> sharedIoThreadCount{0};
+
+// A worker's queue of jobs, biggest at the front, and the total size still in it.
+struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<size_t> jobs;
+    uint64_t queued = 0;
+};
+
+// What runLongestFirst()'s tasks share; they hold on to it, so the last one can finish
+// after the caller has returned.
+struct LongestFirstRun {
+    LongestFirstRun(const std::vector<uint64_t>& sizes, uint32_t numWorkers,
+                    const std::function<void(uint32_t, size_t)>& run) :
+        sizes(sizes), run(run), queues(numWorkers), running(numWorkers) {}
+
+    bool take(WorkerQueue& queue, size_t& job) {
+        std::lock_guard<std::mutex> lk(queue.mutex);
+        if (queue.jobs.empty()) {
+            return false;
+        }
+        job = queue.jobs.front();
+        queue.jobs.pop_front();
+        queue.queued -= sizes[job];
+        return true;
+    }
+
+    // The victim may be emptied between picking it and taking from it, in which case it's
+    // picked again from what's left.
+    bool steal(size_t& job) {
+        for (;;) {
+            WorkerQueue* victim = nullptr;
+            uint64_t most = 0;
+            for (auto& queue : queues) {
+                std::lock_guard<std::mutex> lk(queue.mutex);
+                if (!queue.jobs.empty() && (!victim || queue.queued > most)) {
+                    victim = &queue;
+                    most = queue.queued;
+                }
+            }
+            if (!victim) {
+                return false;
+            }
+            if (take(*victim, job)) {
+                return true;
+            }
+        }
+    }
+
+    const std::vector<uint64_t>& sizes;
+    const std::function<void(uint32_t, size_t)>& run;
+    std::vector<WorkerQueue> queues;
+    std::vector<WorkStealingExecutor::Affinity> affinities;
+    std::atomic<bool> failed{false};
+    std::atomic<uint32_t> running;
+    std::mutex errorMutex;
+    std::exception_ptr firstError;
+    std::promise<void> finished;
+};
+
+// Runs worker's next job, then queues the one after on the worker's affinity. sizes and
+// run are the caller's, so they're left alone once the worker has nothing left to do.
+void runNextJob(const std::shared_ptr<LongestFirstRun>& state, uint32_t worker) {
+    size_t job = 0;
+    if (!state->failed.load(std::memory_order_relaxed) && (state->take(state->queues[worker], job) || state->steal(job))) {
+        try {
+            state->run(worker, job);
+        } catch(...) {
+            state->failed = true;
+            std::lock_guard<std::mutex> lk(state->errorMutex);
+            if (!state->firstError) {
+                state->firstError = std::current_exception();
+            }
+        }
+        WorkStealingExecutor::sharedIo().submit(state->affinities[worker], [state, worker] { runNextJob(state, worker); });
+        return;
+    }
+    if (--state->running == 0) {
+        state->finished.set_value();
+    }
+}
+
+} // namespace
+
+WorkStealingExecutor::WorkStealingExecutor(uint32_t numThreads) {
+    numThreads = std::max<uint32_t>(numThreads, 1);
+    _workers.reserve(numThreads);
+    for (uint32_t idx = 0; idx < numThreads; ++idx) {
+        _workers.push_back(std::make_unique<Worker>());
+    }
+    // Started once they're all there, since each may steal from any of the others.
+    for (uint32_t idx = 0; idx < numThreads; ++idx) {
+        _workers[idx]->thread = std::thread([this, idx] { _run(idx); });
+    }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+    _stopping = true;
+    for (auto& worker : _workers) {
+        {
+            std::lock_guard<std::mutex> lk(worker->mutex);
+            worker->woken = true;
+        }
+        worker->wake.notify_one();
+    }
+    for (auto& worker : _workers) {
+        worker->thread.join();
+    }
+}
+
+WorkStealingExecutor& WorkStealingExecutor::shared() {
+    static WorkStealingExecutor executor(sharedExecutorThreads());
+    return executor;
+}
+
+WorkStealingExecutor& WorkStealingExecutor::sharedIo() {
+    static WorkStealingExecutor executor(sharedIoThreads());
+    return executor;
+}
+
+WorkStealingExecutor::Affinity WorkStealingExecutor::newAffinity() noexcept {
+    return Affinity(static_cast<uint32_t>(_nextAffinity++ % _workers.size()));
+}
+
+std::optional<uint32_t> WorkStealingExecutor::_currentWorker() const noexcept {
+    if (tExecutor != this) {
+        return std::nullopt;
+    }
+    return tWorker;
+}
+
+void WorkStealingExecutor::_push(std::optional<uint32_t> pinnedTo, std::function<void()> task) {
+    if (pinnedTo) {
+        auto& worker = *_workers[*pinnedTo];
+        {
+            std::lock_guard<std::mutex> lk(worker.mutex);
+            worker.pinned.push_back(std::move(task));
+            worker.woken = true;
+        }
+        worker.wake.notify_one();
+        return;
+    }
+    const auto self = _currentWorker();
+    const auto target = self ? *self : static_cast<uint32_t>(_nextWorker++ % _workers.size());
+    {
+        auto& worker = *_workers[target];
+        std::lock_guard<std::mutex> lk(worker.mutex);
+        if (self) {
+            worker.tasks.push_front(std::move(task));
+        } else {
+            worker.tasks.push_back(std::move(task));
+        }
+    }
+    _wakeSleeper(target);
+}
+
+// A worker sets its sleeping flag before it looks for work one last time, and a task is
+// queued before the flags are checked, so either the worker finds the task or it's woken
+// for it.
+void WorkStealingExecutor::_wakeSleeper(uint32_t preferred) {
+    const auto numWorkers = _workers.size();
+    for (size_t offset = 0; offset < numWorkers; ++offset) {
+        auto& worker = *_workers[(preferred + offset) % numWorkers];
+        if (worker.sleeping.load()) {
+            {
+                std::lock_guard<std::mutex> lk(worker.mutex);
+                worker.woken = true;
+            }
+            worker.wake.notify_one();
+            return;
+        }
+    }
+}
+
+bool WorkStealingExecutor::_take(uint32_t worker, std::function<void()>& task) {
+    {
+        auto& own = *_workers[worker];
+        std::lock_guard<std::mutex> lk(own.mutex);
+        if (!own.pinned.empty()) {
+            task = std::move(own.pinned.front());
+            own.pinned.pop_front();
+            return true;
+        }
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    const auto numWorkers = _workers.size();
+    for (size_t offset = 1; offset < numWorkers; ++offset) {
+        auto& victim = *_workers[(worker + offset) % numWorkers];
+        std::lock_guard<std::mutex> lk(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingExecutor::_run(uint32_t index) {
+    tExecutor = this;
+    tWorker = index;
+    traceRecorder.nameThread("executor");
+    auto& worker = *_workers[index];
+    std::function<void()> task;
+    for (;;) {
+        if (_take(index, task)) {
+            // Errors land in the task's future.
+            task();
+            task = nullptr;
+            continue;
+        }
+        worker.sleeping = true;
+        if (_take(index, task)) {
+            worker.sleeping = false;
+            task();
+            task = nullptr;
+            continue;
+        }
+        if (_stopping) {
+            return;
+        }
+        std::unique_lock<std::mutex> lk(worker.mutex);
+        worker.wake.wait(lk, [&] { return worker.woken; });
+        worker.woken = false;
+        worker.sleeping = false;
+    }
+}
+
+void WorkStealingExecutor::_helpUntil(const std::function<bool()>& done) {
+    const auto index = tWorker;
+    auto& worker = *_workers[index];
+    std::function<void()> task;
+    while (!done()) {
+        if (_take(index, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> lk(worker.mutex);
+        worker.wake.wait_for(lk, std::chrono::milliseconds(1), [&] { return worker.woken; });
+        worker.woken = false;
+    }
+}
+
+void WorkStealingExecutor::runAll(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) {
+        return;
+    }
+    // Helpers that start after every index has been taken find nothing to do, and leave fn
+    // alone, since it may be gone by then.
+    struct State {
+        const std::function<void(size_t)>* fn = nullptr;
+        size_t count = 0;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::mutex errorMutex;
+        std::exception_ptr firstError;
+        std::promise<void> finished;
+    };
+    auto state = std::make_shared<State>();
+    state->fn = &fn;
+    state->count = count;
+    auto finished = state->finished.get_future();
+    auto runIndices = [state] {
+        for (auto idx = state->next++; idx < state->count; idx = state->next++) {
+            try {
+                (*state->fn)(idx);
+            } catch(...) {
+                std::lock_guard<std::mutex> lk(state->errorMutex);
+                if (!state->firstError) {
+                    state->firstError = std::current_exception();
+                }
+            }
+            if (++state->done == state->count) {
+                state->finished.set_value();
+            }
+        }
+    };
+    const auto helpers = std::min<size_t>(count - 1, _workers.size());
+    for (size_t idx = 0; idx < helpers; ++idx) {
+        _push(std::nullopt, runIndices);
+    }
+    runIndices();
+    wait(finished);
+    if (state->firstError) {
+        std::rethrow_exception(state->firstError);
+    }
+}
+
+void setSharedExecutorThreads(uint32_t numThreads) {
+    sharedThreads = numThreads;
+}
+
+uint32_t sharedExecutorThreads() noexcept {
+    if (const auto threads = sharedThreads.load(); threads != 0) {
+        return threads;
+    }
+    return std::max<uint32_t>(std::thread::hardware_concurrency(), 1);
+}
+
+void setSharedIoThreads(uint32_t numThreads) {
+    sharedIoThreadCount = numThreads;
+}
+
+uint32_t sharedIoThreads() noexcept {
+    if (const auto threads = sharedIoThreadCount.load(); threads != 0) {
+        return threads;
+    }
+    return kDefaultIoThreads;
+}
+
+void runLongestFirst(const std::vector<uint64_t>& sizes,
+                     uint32_t numWorkers,
+                     const std::function<void(uint32_t worker, size_t job)>& run) {
+    if (sizes.empty()) {
+        return;
+    }
+    numWorkers = static_cast<uint32_t>(std::clamp<size_t>(numWorkers, 1, sizes.size()));
+
+    std::vector<size_t> order(sizes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+    // One worker has nothing to overlap with, and a nested one, like a single file's load
+    // in a load of files, mustn't queue behind whatever another thread is blocked in.
+    if (numWorkers == 1) {
+        for (const auto job : order) {
+            run(0, job);
+        }
+        return;
+    }
+
+    auto& executor = WorkStealingExecutor::sharedIo();
+    auto state = std::make_shared<LongestFirstRun>(sizes, numWorkers, run);
+    for (const auto job : order) {
+        auto& queue = *std::min_element(state->queues.begin(), state->queues.end(), [](const auto& a, const auto& b) {
+            return a.queued < b.queued;
+        });
+        queue.jobs.push_back(job);
+        queue.queued += sizes[job];
+    }
+    for (uint32_t worker = 0; worker < numWorkers; ++worker) {
+        state->affinities.push_back(executor.newAffinity());
+    }
+
+    auto finished = state->finished.get_future();
+    for (uint32_t worker = 0; worker < numWorkers; ++worker) {
+        executor.submit(state->affinities[worker], [state, worker] { runNextJob(state, worker); });
+    }
+    executor.wait(finished);
+    if (state->firstError) {
+        std::rethrow_exception(state->firstError);
+    }
+}
+
+} // namespace sqlplusplus
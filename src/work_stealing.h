@@ -0,0 +1,170 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace sqlplusplus {
+
+// A fixed set of threads shared by the features that run work in parallel, so several of
+// them running at once share a budget instead of each starting threads of its own. There
+// are two: shared() for work that keeps a core busy, like formatting wide results, and
+// sharedIo() for work that mostly waits on the database, like exports, loads, checksums,
+// DDL extraction and parallel blocks, whose workers each hold a connection. Each thread has a deque of
+// tasks: it runs its own newest first and, with nothing of its own left, steals the oldest
+// from another's. A task submitted from one of the threads goes on that thread's deque;
+// one from anywhere else on the next thread's in turn, and a sleeping thread is woken to
+// take it.
+//
+// A thread that waits for tasks it submitted should do it with wait() or runAll(), which
+// run queued tasks meanwhile, so even a budget of one thread can't deadlock on a task
+// waiting for the tasks queued behind it. Tasks shouldn't wait on anything else that only
+// another task can bring about.
+//
+// Some threads stay their own: a session's SessionExecutor, whose calls are pipelined
+// with whatever drives it, like fan-out targets that block on the reader's backpressure;
+// fetch pipelines and pagers, a thread per open cursor; and the load generator, workload
+// bench and workload replay, whose sessions all have to be running at once to keep to
+// their schedule. So do monitors, background jobs and servers, which run for as long as
+// the session does.
+//
+// The destructor finishes every queued task before it returns.
+class WorkStealingExecutor {
+public:
+    // Tasks submitted with the same affinity all run on one of the threads, in the order
+    // they were submitted, and are never stolen, so a series of calls on an
+    // OracleConnection stays on the thread that holds it. Affinities are dealt out across
+    // the threads in turn.
+    class Affinity {
+    public:
+        uint32_t thread() const noexcept {
+            return _thread;
+        }
+
+    private:
+        friend class WorkStealingExecutor;
+        explicit Affinity(uint32_t thread) noexcept : _thread(thread) {}
+
+        uint32_t _thread;
+    };
+
+    explicit WorkStealingExecutor(uint32_t numThreads);
+    WorkStealingExecutor(const WorkStealingExecutor&) = delete;
+    WorkStealingExecutor& operator=(const WorkStealingExecutor&) = delete;
+    ~WorkStealingExecutor();
+
+    // The ones the features share, started on first use with sharedExecutorThreads() and
+    // sharedIoThreads() threads.
+    static WorkStealingExecutor& shared();
+    static WorkStealingExecutor& sharedIo();
+
+    uint32_t numThreads() const noexcept {
+        return static_cast<uint32_t>(_workers.size());
+    }
+
+    // Runs fn on whichever thread gets to it first; the future has its result or what it
+    // threw.
+    template <typename Fn>
+    std::future<std::invoke_result_t<Fn&>> submit(Fn fn) {
+        auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Fn&>()>>(std::move(fn));
+        auto result = task->get_future();
+        _push(std::nullopt, [task] { (*task)(); });
+        return result;
+    }
+    Affinity newAffinity() noexcept;
+    template <typename Fn>
+    std::future<std::invoke_result_t<Fn&>> submit(const Affinity& affinity, Fn fn) {
+        auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Fn&>()>>(std::move(fn));
+        auto result = task->get_future();
+        _push(affinity.thread(), [task] { (*task)(); });
+        return result;
+    }
+
+    // future.get(), running queued tasks while it waits when called on one of the threads.
+    template <typename T>
+    T wait(std::future<T>& future) {
+        waitReady(future);
+        return future.get();
+    }
+    // The same without taking the result, so nothing's thrown: for unwinding past a task
+    // that refers to what's being unwound.
+    template <typename T>
+    void waitReady(std::future<T>& future) {
+        if (_currentWorker()) {
+            _helpUntil([&future] { return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; });
+        }
+        future.wait();
+    }
+
+    // Runs fn(0) to fn(count - 1) on as many of the threads as are free, this one
+    // included, and returns once they've all finished. Each index runs even if another
+    // threw; the first exception is rethrown at the end.
+    void runAll(size_t count, const std::function<void(size_t)>& fn);
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::condition_variable wake;
+        // Tasks with an affinity for this thread, oldest first.
+        std::deque<std::function<void()>> pinned;
+        // The rest: this thread's own newest at the front, stolen from the back.
+        std::deque<std::function<void()>> tasks;
+        bool woken = false;
+        std::atomic<bool> sleeping{false};
+        std::thread thread;
+    };
+
+    std::optional<uint32_t> _currentWorker() const noexcept;
+    void _push(std::optional<uint32_t> pinnedTo, std::function<void()> task);
+    // Takes worker's next task, its own or stolen; false if there's none anywhere.
+    bool _take(uint32_t worker, std::function<void()>& task);
+    void _wakeSleeper(uint32_t preferred);
+    void _run(uint32_t worker);
+    // Runs tasks on the calling worker until done() is true, checking it at least every
+    // millisecond while there's nothing to run.
+    void _helpUntil(const std::function<bool()>& done);
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::atomic<uint64_t> _nextWorker{0};
+    std::atomic<uint64_t> _nextAffinity{0};
+    std::atomic<bool> _stopping{false};
+};
+
+// The shared executors' thread counts: the core budget, hardware_concurrency() unless set,
+// and the budget of workers blocked on the database at once, kDefaultIoThreads unless set.
+// Setting one has to happen before that executor's first use to take effect, e.g. from
+// --cores and --io-workers.
+constexpr uint32_t kDefaultIoThreads = 64;
+void setSharedExecutorThreads(uint32_t numThreads);
+uint32_t sharedExecutorThreads() noexcept;
+void setSharedIoThreads(uint32_t numThreads);
+uint32_t sharedIoThreads() noexcept;
+
+// Runs jobs of known sizes, like a table's partitions, on up to numWorkers workers, biggest
+// first so the long ones start early instead of being left to run alone at the end. The
+// jobs are dealt out up front, each to the worker with the least work so far, and a worker
+// that runs out takes the biggest job still waiting on whichever worker has the most left.
+// run(worker, job) gets a worker index below numWorkers, so a worker can keep a connection
+// of its own from one job to the next. Each worker runs its jobs on sharedIo() with an
+// affinity of its own, one task a job, so its connection stays on one thread while other
+// features' tasks can run between its jobs. Workers beyond sharedIoThreads() share
+// threads, so they add connections but not concurrency. A single worker runs the jobs on
+// the calling thread.
+//
+// Once a job throws no more are started; the first error is rethrown after the jobs
+// already running are done.
+void runLongestFirst(const std::vector<uint64_t>& sizes,
+                     uint32_t numWorkers,
+                     const std::function<void(uint32_t worker, size_t job)>& run);
+
+} // namespace sqlplusplus
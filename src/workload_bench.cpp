@@ -0,0 +1,866 @@
+#include "workload_bench.h"
+
+#include "load_generator.h"
+#include "mapped_file.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <deque>
+#include <future>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace sqlplusplus {
+namespace {
+
+struct YamlNode {
+    enum class Kind { Scalar, Map, List };
+
+    Kind kind = Kind::Scalar;
+    std::string scalar;
+    std::vector<std::pair<std::string, YamlNode>> entries;
+    std::vector<YamlNode> items;
+    uint64_t line = 0;
+};
+
+[[noreturn]] void fail(uint64_t line, std::string_view message) {
+    throw std::runtime_error(fmt::format("line {}: {}", line, message));
+}
+
+std::string_view trimmed(std::string_view text) {
+    const auto first = text.find_first_not_of(" \t");
+    if (first == std::string_view::npos) {
+        return {};
+    }
+    return text.substr(first, text.find_last_not_of(" \t") - first + 1);
+}
+
+// Where a quote opened at pos ends, just past it; npos if the text ends first.
+size_t quoteEnd(std::string_view text, size_t pos) {
+    const auto quote = text[pos];
+    for (auto at = pos + 1; at < text.size(); ++at) {
+        if (quote == '"' && text[at] == '\\') {
+            ++at;
+        } else if (text[at] == quote) {
+            if (quote == '\'' && at + 1 < text.size() && text[at + 1] == '\'') {
+                ++at;
+                continue;
+            }
+            return at + 1;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// The block style YAML a workload is written in, made into a tree a line at a time.
+class YamlParser {
+public:
+    explicit YamlParser(std::string_view text) {
+        for (;;) {
+            const auto end = std::min(text.find('\n'), text.size());
+            auto raw = text.substr(0, end);
+            if (!raw.empty() && raw.back() == '\r') {
+                raw.remove_suffix(1);
+            }
+            _raw.push_back(raw);
+            if (end == text.size()) {
+                break;
+            }
+            text.remove_prefix(end + 1);
+        }
+        for (size_t idx = 0; idx < _raw.size(); ++idx) {
+            const auto raw = _raw[idx];
+            const auto indent = raw.find_first_not_of(' ');
+            if (indent == std::string_view::npos) {
+                continue;
+            }
+            if (raw[indent] == '\t') {
+                fail(idx + 1, "indent with spaces, not tabs");
+            }
+            const auto content = trimmed(withoutComment(raw.substr(indent)));
+            if (content.empty() || content == "---") {
+                continue;
+            }
+            _lines.push_back({idx, indent, std::string(content)});
+        }
+    }
+
+    YamlNode parse() {
+        if (_lines.empty()) {
+            YamlNode empty;
+            empty.kind = YamlNode::Kind::Map;
+            return empty;
+        }
+        auto root = _block(_lines.front().indent);
+        if (_pos < _lines.size()) {
+            fail(_lineNumber(), "expected less indentation");
+        }
+        return root;
+    }
+
+private:
+    struct Line {
+        size_t raw = 0;
+        size_t indent = 0;
+        std::string text;
+    };
+
+    static std::string_view withoutComment(std::string_view text) {
+        for (size_t pos = 0; pos < text.size(); ++pos) {
+            if (text[pos] == '\'' || text[pos] == '"') {
+                const auto end = quoteEnd(text, pos);
+                if (end == std::string_view::npos) {
+                    break;
+                }
+                pos = end - 1;
+            } else if (text[pos] == '#' && (pos == 0 || text[pos - 1] == ' ')) {
+                return text.substr(0, pos);
+            }
+        }
+        return text;
+    }
+
+    static bool isListItem(std::string_view text) {
+        return text == "-" || text.substr(0, 2) == "- ";
+    }
+
+    // Where the colon of "key: value" or "key:" is, or npos if text isn't one.
+    static size_t keyColon(std::string_view text) {
+        if (text.empty() || text.front() == '\'' || text.front() == '"' || text.front() == '[') {
+            return std::string_view::npos;
+        }
+        for (auto pos = text.find(':'); pos != std::string_view::npos; pos = text.find(':', pos + 1)) {
+            if (pos + 1 == text.size() || text[pos + 1] == ' ') {
+                return pos;
+            }
+        }
+        return std::string_view::npos;
+    }
+
+    uint64_t _lineNumber() const {
+        return _pos < _lines.size() ? _lines[_pos].raw + 1 : _raw.size();
+    }
+
+    YamlNode _block(size_t indent) {
+        return isListItem(_lines[_pos].text) ? _list(indent) : _map(indent);
+    }
+
+    YamlNode _map(size_t indent) {
+        YamlNode map;
+        map.kind = YamlNode::Kind::Map;
+        map.line = _lineNumber();
+        while (_pos < _lines.size() && _lines[_pos].indent == indent && !isListItem(_lines[_pos].text)) {
+            const auto line = _lines[_pos];
+            const auto colon = keyColon(line.text);
+            if (colon == std::string_view::npos) {
+                fail(line.raw + 1, "expected key: value");
+            }
+            const auto key = std::string(trimmed(std::string_view(line.text).substr(0, colon)));
+            const auto value = trimmed(std::string_view(line.text).substr(colon + 1));
+            for (const auto& entry : map.entries) {
+                if (entry.first == key) {
+                    fail(line.raw + 1, fmt::format("{} is given twice", key));
+                }
+            }
+            ++_pos;
+            YamlNode child;
+            if (!value.empty() && (value.front() == '|' || value.front() == '>')) {
+                child = _blockScalar(line, value.front() == '>');
+            } else if (!value.empty()) {
+                child = scalarNode(value, line.raw + 1);
+            } else if (_pos < _lines.size() && _lines[_pos].indent > indent) {
+                child = _block(_lines[_pos].indent);
+            } else if (_pos < _lines.size() && _lines[_pos].indent == indent && isListItem(_lines[_pos].text)) {
+                child = _list(indent);
+            } else {
+                child.line = line.raw + 1;
+            }
+            map.entries.emplace_back(key, std::move(child));
+        }
+        if (_pos < _lines.size() && _lines[_pos].indent > indent) {
+            fail(_lineNumber(), "expected less indentation");
+        }
+        return map;
+    }
+
+    YamlNode _list(size_t indent) {
+        YamlNode list;
+        list.kind = YamlNode::Kind::List;
+        list.line = _lineNumber();
+        while (_pos < _lines.size() && _lines[_pos].indent == indent && isListItem(_lines[_pos].text)) {
+            auto& line = _lines[_pos];
+            const auto rest = line.text.find_first_not_of(' ', 1);
+            if (rest == std::string::npos) {
+                ++_pos;
+                if (_pos < _lines.size() && _lines[_pos].indent > indent) {
+                    list.items.push_back(_block(_lines[_pos].indent));
+                } else {
+                    list.items.emplace_back().line = line.raw + 1;
+                }
+            } else if (keyColon(std::string_view(line.text).substr(rest)) != std::string_view::npos) {
+                // "- key: value" starts a map whose keys line up with key.
+                line.indent += rest;
+                line.text.erase(0, rest);
+                list.items.push_back(_map(line.indent));
+            } else {
+                const auto raw = line.raw;
+                const auto value = line.text.substr(rest);
+                ++_pos;
+                list.items.push_back(scalarNode(value, raw + 1));
+            }
+        }
+        return list;
+    }
+
+    // The lines indented past key's after a | or >, kept as they are, less their indent.
+    YamlNode _blockScalar(const Line& key, bool folded) {
+        YamlNode node;
+        node.line = key.raw + 1;
+        std::vector<std::string_view> lines;
+        size_t blockIndent = std::string_view::npos;
+        auto raw = key.raw + 1;
+        for (; raw < _raw.size(); ++raw) {
+            const auto text = _raw[raw];
+            const auto indent = text.find_first_not_of(' ');
+            if (indent == std::string_view::npos) {
+                lines.emplace_back();
+                continue;
+            }
+            if (indent <= key.indent) {
+                break;
+            }
+            blockIndent = std::min(blockIndent, indent);
+            lines.push_back(text);
+        }
+        while (!lines.empty() && lines.back().empty()) {
+            lines.pop_back();
+        }
+        for (size_t idx = 0; idx < lines.size(); ++idx) {
+            if (idx > 0) {
+                node.scalar += folded ? ' ' : '\n';
+            }
+            node.scalar.append(lines[idx].substr(std::min(blockIndent, lines[idx].size())));
+        }
+        while (_pos < _lines.size() && _lines[_pos].raw < raw) {
+            ++_pos;
+        }
+        return node;
+    }
+
+    static std::string unquoted(std::string_view text, uint64_t line) {
+        if (text.empty() || (text.front() != '\'' && text.front() != '"')) {
+            return std::string(text);
+        }
+        if (quoteEnd(text, 0) != text.size()) {
+            fail(line, "a quoted value has to end with its quote");
+        }
+        std::string value;
+        for (size_t pos = 1; pos + 1 < text.size(); ++pos) {
+            if (text.front() == '\'' && text[pos] == '\'') {
+                ++pos;
+            } else if (text.front() == '"' && text[pos] == '\\') {
+                ++pos;
+                value += text[pos] == 'n' ? '\n' : text[pos] == 't' ? '\t' : text[pos];
+                continue;
+            }
+            value += text[pos];
+        }
+        return value;
+    }
+
+    static YamlNode scalarNode(std::string_view text, uint64_t line) {
+        YamlNode node;
+        node.line = line;
+        if (text.front() != '[') {
+            node.scalar = unquoted(text, line);
+            return node;
+        }
+        if (text.back() != ']') {
+            fail(line, "a [list] has to end with ]");
+        }
+        node.kind = YamlNode::Kind::List;
+        auto items = text.substr(1, text.size() - 2);
+        for (size_t start = 0; start < items.size();) {
+            auto end = start;
+            while (end < items.size() && items[end] != ',') {
+                if (items[end] == '\'' || items[end] == '"') {
+                    end = std::min(quoteEnd(items, end), items.size());
+                } else {
+                    ++end;
+                }
+            }
+            const auto item = trimmed(items.substr(start, end - start));
+            if (!item.empty()) {
+                auto& child = node.items.emplace_back();
+                child.line = line;
+                child.scalar = unquoted(item, line);
+            }
+            start = end + 1;
+        }
+        return node;
+    }
+
+    std::vector<std::string_view> _raw;
+    std::vector<Line> _lines;
+    size_t _pos = 0;
+};
+
+const std::string& scalarOf(const YamlNode& node, std::string_view key) {
+    if (node.kind != YamlNode::Kind::Scalar) {
+        fail(node.line, fmt::format("{} has to be a single value", key));
+    }
+    return node.scalar;
+}
+
+template <typename T>
+T numberOf(const YamlNode& node, std::string_view key) {
+    const auto& text = scalarOf(node, key);
+    T value{};
+    const auto parsed = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (text.empty() || parsed.ec != std::errc() || parsed.ptr != text.data() + text.size()) {
+        fail(node.line, fmt::format("{} has to be a number, not \"{}\"", key, text));
+    }
+    return value;
+}
+
+double realOf(const YamlNode& node, std::string_view key) {
+    const auto& text = scalarOf(node, key);
+    char* end = nullptr;
+    const auto value = std::strtod(text.c_str(), &end);
+    if (text.empty() || end != text.c_str() + text.size() || !std::isfinite(value) || value < 0) {
+        fail(node.line, fmt::format("{} has to be a number, not \"{}\"", key, text));
+    }
+    return value;
+}
+
+std::chrono::microseconds durationOf(const YamlNode& node, std::string_view key) {
+    const auto& text = scalarOf(node, key);
+    char* end = nullptr;
+    const auto value = std::strtod(text.c_str(), &end);
+    const std::string_view unit = trimmed(std::string_view(end, text.c_str() + text.size() - end));
+    double micros = 0;
+    if (unit.empty() || unit == "s") {
+        micros = value * 1e6;
+    } else if (unit == "ms") {
+        micros = value * 1e3;
+    } else if (unit == "us") {
+        micros = value;
+    } else if (unit == "m") {
+        micros = value * 60e6;
+    } else {
+        micros = -1;
+    }
+    if (end == text.c_str() || !(micros >= 0) || !std::isfinite(micros)) {
+        fail(node.line, fmt::format("{} has to be a duration like 500ms, 30s or 5m, not \"{}\"", key, text));
+    }
+    return std::chrono::microseconds(static_cast<int64_t>(micros));
+}
+
+bool flagOf(const YamlNode& node, std::string_view key) {
+    const auto& text = scalarOf(node, key);
+    if (text == "true" || text == "yes" || text == "on") {
+        return true;
+    }
+    if (text == "false" || text == "no" || text == "off") {
+        return false;
+    }
+    fail(node.line, fmt::format("{} has to be true or false, not \"{}\"", key, text));
+}
+
+const std::vector<YamlNode>& itemsOf(const YamlNode& node, std::string_view key) {
+    if (node.kind != YamlNode::Kind::List) {
+        fail(node.line, fmt::format("{} has to be a list", key));
+    }
+    return node.items;
+}
+
+const std::vector<std::pair<std::string, YamlNode>>& entriesOf(const YamlNode& node, std::string_view key) {
+    if (node.kind != YamlNode::Kind::Map) {
+        fail(node.line, fmt::format("{} has to be a map of keys to values", key));
+    }
+    return node.entries;
+}
+
+WorkloadBind parseBind(const std::string& name, const YamlNode& node) {
+    WorkloadBind bind;
+    bind.name = !name.empty() && name.front() == ':' ? name.substr(1) : name;
+    if (node.kind == YamlNode::Kind::List) {
+        bind.kind = WorkloadBind::Kind::Choice;
+        for (const auto& item : node.items) {
+            bind.values.push_back(scalarOf(item, name));
+        }
+        if (bind.values.empty()) {
+            fail(node.line, fmt::format("bind {} has nothing to choose from", name));
+        }
+        return bind;
+    }
+    const auto& spec = scalarOf(node, name);
+    std::vector<std::string> words;
+    for (size_t start = 0; start < spec.size();) {
+        const auto end = std::min(spec.find(' ', start), spec.size());
+        if (end > start) {
+            words.push_back(spec.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    auto number = [&](size_t idx) {
+        int64_t value = 0;
+        const auto& word = words[idx];
+        const auto parsed = std::from_chars(word.data(), word.data() + word.size(), value);
+        if (parsed.ec != std::errc() || parsed.ptr != word.data() + word.size()) {
+            fail(node.line, fmt::format("bind {}: \"{}\" has to be a whole number", name, word));
+        }
+        return value;
+    };
+    const auto kind = words.empty() ? std::string() : words.front();
+    const auto numArgs = words.size() - std::min<size_t>(words.size(), 1);
+    if (kind == "int" && numArgs == 2) {
+        bind.kind = WorkloadBind::Kind::Int;
+        bind.low = number(1);
+        bind.high = number(2);
+    } else if (kind == "sequence" && numArgs <= 1) {
+        bind.kind = WorkloadBind::Kind::Sequence;
+        bind.low = numArgs == 1 ? number(1) : 1;
+        bind.high = bind.low;
+    } else if (kind == "decimal" && (numArgs == 2 || numArgs == 3)) {
+        bind.kind = WorkloadBind::Kind::Decimal;
+        bind.low = number(1);
+        bind.high = number(2);
+        bind.scale = numArgs == 3 ? static_cast<uint32_t>(std::clamp<int64_t>(number(3), 0, 9)) : 2;
+    } else if (kind == "string" && numArgs == 2) {
+        bind.kind = WorkloadBind::Kind::String;
+        bind.low = std::max<int64_t>(number(1), 0);
+        bind.high = number(2);
+    } else if (kind == "choice" && numArgs >= 1) {
+        bind.kind = WorkloadBind::Kind::Choice;
+        bind.values.assign(words.begin() + 1, words.end());
+    } else if (kind == "csv" && (numArgs == 1 || numArgs == 2)) {
+        bind.kind = WorkloadBind::Kind::Choice;
+        const auto column = numArgs == 2 ? number(2) : 1;
+        if (column < 1) {
+            fail(node.line, fmt::format("bind {}: columns are numbered from 1", name));
+        }
+        for (auto& row : loadBindRows(words[1])) {
+            if (static_cast<size_t>(column) > row.size()) {
+                fail(node.line, fmt::format("bind {}: {} has a row without column {}", name, words[1], column));
+            }
+            bind.values.push_back(std::move(row[column - 1]));
+        }
+    } else {
+        fail(node.line, fmt::format("bind {}: \"{}\" isn't int <low> <high>, sequence [<start>], decimal <low> "
+                                    "<high> [<scale>], string <min> <max>, choice <value>... or csv <file> "
+                                    "[<column>]", name, spec));
+    }
+    if (bind.high < bind.low) {
+        fail(node.line, fmt::format("bind {}: {} is less than {}", name, bind.high, bind.low));
+    }
+    return bind;
+}
+
+bool isBlock(std::string_view sql) {
+    std::string first;
+    for (const auto ch : sql.substr(0, sql.find_first_of(" \t\n("))) {
+        first += static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+    }
+    return first == "BEGIN" || first == "DECLARE";
+}
+
+WorkloadStatement parseStatement(const YamlNode& node) {
+    WorkloadStatement statement;
+    if (node.kind == YamlNode::Kind::Scalar) {
+        statement.sql = node.scalar;
+    } else {
+        for (const auto& [key, value] : entriesOf(node, "a statement")) {
+            if (key == "sql") {
+                statement.sql = scalarOf(value, key);
+            } else if (key == "binds") {
+                for (const auto& [name, spec] : entriesOf(value, key)) {
+                    statement.binds.push_back(parseBind(name, spec));
+                }
+            } else {
+                fail(value.line, fmt::format("a statement has sql and binds, not {}", key));
+            }
+        }
+    }
+    auto sql = trimmed(statement.sql);
+    // A block keeps the ; after its END; anything else can't have one.
+    if (!sql.empty() && sql.back() == ';' && !isBlock(sql)) {
+        sql.remove_suffix(1);
+    }
+    statement.sql = std::string(sql);
+    if (statement.sql.empty()) {
+        fail(node.line, "a statement needs its sql");
+    }
+    return statement;
+}
+
+WorkloadTransaction parseTransaction(const YamlNode& node) {
+    WorkloadTransaction transaction;
+    for (const auto& [key, value] : entriesOf(node, "a transaction")) {
+        if (key == "name") {
+            transaction.name = scalarOf(value, key);
+        } else if (key == "weight") {
+            transaction.weight = numberOf<uint32_t>(value, key);
+        } else if (key == "think") {
+            transaction.think = durationOf(value, key);
+        } else if (key == "commit") {
+            transaction.commit = flagOf(value, key);
+        } else if (key == "statements") {
+            for (const auto& item : itemsOf(value, key)) {
+                transaction.statements.push_back(parseStatement(item));
+            }
+        } else {
+            fail(value.line, fmt::format("a transaction has name, weight, think, commit and statements, not {}", key));
+        }
+    }
+    if (transaction.name.empty()) {
+        fail(node.line, "a transaction needs a name");
+    }
+    if (transaction.statements.empty()) {
+        fail(node.line, fmt::format("transaction {} has no statements", transaction.name));
+    }
+    return transaction;
+}
+
+// SplitMix64, which is plenty for picking transactions and making up values.
+class Random {
+public:
+    explicit Random(uint64_t seed) noexcept : _state(seed) {}
+
+    uint64_t next() noexcept {
+        auto z = (_state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+    // From low to high, both included.
+    int64_t between(int64_t low, int64_t high) noexcept {
+        const auto span = static_cast<uint64_t>(high) - static_cast<uint64_t>(low);
+        const auto offset = span == UINT64_MAX ? next() : next() % (span + 1);
+        return static_cast<int64_t>(static_cast<uint64_t>(low) + offset);
+    }
+
+private:
+    uint64_t _state;
+};
+
+void makeValue(const WorkloadBind& bind, Random& random, std::atomic<int64_t>* sequence, std::string& out) {
+    constexpr std::string_view kAlphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+    out.clear();
+    switch (bind.kind) {
+    case WorkloadBind::Kind::Int:
+        fmt::format_to(std::back_inserter(out), "{}", random.between(bind.low, bind.high));
+        break;
+    case WorkloadBind::Kind::Sequence:
+        fmt::format_to(std::back_inserter(out), "{}", sequence->fetch_add(1, std::memory_order_relaxed));
+        break;
+    case WorkloadBind::Kind::Decimal: {
+        int64_t scale = 1;
+        for (uint32_t digit = 0; digit < bind.scale; ++digit) {
+            scale *= 10;
+        }
+        const auto value = random.between(bind.low * scale, bind.high * scale);
+        const auto magnitude = value < 0 ? -static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+        fmt::format_to(std::back_inserter(out), "{}{}", value < 0 ? "-" : "", magnitude / scale);
+        if (bind.scale > 0) {
+            fmt::format_to(std::back_inserter(out), ".{:0{}}", magnitude % scale, bind.scale);
+        }
+        break;
+    }
+    case WorkloadBind::Kind::String: {
+        const auto length = random.between(bind.low, bind.high);
+        for (int64_t idx = 0; idx < length; ++idx) {
+            out += kAlphabet[random.next() % kAlphabet.size()];
+        }
+        break;
+    }
+    case WorkloadBind::Kind::Choice:
+        out = bind.values[random.next() % bind.values.size()];
+        break;
+    }
+}
+
+uint32_t bindSize(const WorkloadBind& bind) {
+    switch (bind.kind) {
+    case WorkloadBind::Kind::Int:
+    case WorkloadBind::Kind::Sequence:
+        return 21;
+    case WorkloadBind::Kind::Decimal:
+        return 22 + bind.scale;
+    case WorkloadBind::Kind::String:
+        return static_cast<uint32_t>(std::max<int64_t>(bind.high, 1));
+    case WorkloadBind::Kind::Choice:
+        break;
+    }
+    size_t longest = 1;
+    for (const auto& value : bind.values) {
+        longest = std::max(longest, value.size());
+    }
+    return static_cast<uint32_t>(longest);
+}
+
+uint64_t toMicros(std::chrono::steady_clock::duration elapsed) {
+    return static_cast<uint64_t>(std::max<int64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count(), 0));
+}
+
+struct PreparedStatement {
+    OracleStatement stmt;
+    std::vector<OracleVariable> binds;
+    // Each bind's sequence, for the ones that are.
+    std::vector<std::atomic<int64_t>*> sequences;
+};
+
+struct PreparedSession {
+    OracleConnection conn;
+    std::vector<std::vector<PreparedStatement>> transactions;
+};
+
+struct SessionResult {
+    std::vector<TransactionBenchResult> transactions;
+    double maxLagMillis = 0;
+};
+
+} // namespace
+
+BenchWorkload parseBenchWorkload(std::string_view yaml) {
+    const auto root = YamlParser(yaml).parse();
+    BenchWorkload workload;
+    for (const auto& [key, value] : entriesOf(root, "the workload")) {
+        if (key == "sessions") {
+            workload.sessions = numberOf<uint32_t>(value, key);
+        } else if (key == "duration") {
+            workload.duration = durationOf(value, key);
+        } else if (key == "rate") {
+            workload.rate = realOf(value, key);
+        } else if (key == "seed") {
+            workload.seed = numberOf<uint64_t>(value, key);
+        } else if (key == "transactions") {
+            for (const auto& item : itemsOf(value, key)) {
+                workload.transactions.push_back(parseTransaction(item));
+            }
+        } else {
+            fail(value.line, fmt::format("a workload has sessions, duration, rate, seed and transactions, not {}", key));
+        }
+    }
+    if (workload.transactions.empty()) {
+        fail(root.line, "the workload has no transactions");
+    }
+    if (workload.sessions == 0) {
+        fail(root.line, "the workload needs at least 1 session");
+    }
+    uint64_t totalWeight = 0;
+    for (const auto& transaction : workload.transactions) {
+        totalWeight += transaction.weight;
+    }
+    if (totalWeight == 0) {
+        fail(root.line, "at least one transaction needs a weight above 0");
+    }
+    return workload;
+}
+
+BenchWorkload readBenchWorkload(const std::string& path) {
+    MappedFile file(path);
+    try {
+        return parseBenchWorkload(file.contents());
+    } catch(const std::runtime_error& e) {
+        throw std::runtime_error(fmt::format("{}, {}", path, e.what()));
+    }
+}
+
+WorkloadBenchResult runBenchWorkload(const std::function<OracleConnection()>& newConnection,
+                                     const BenchWorkload& workload) {
+    const auto& transactions = workload.transactions;
+    std::deque<std::atomic<int64_t>> sequenceValues;
+    std::unordered_map<const WorkloadBind*, std::atomic<int64_t>*> sequences;
+    for (const auto& transaction : transactions) {
+        for (const auto& statement : transaction.statements) {
+            for (const auto& bind : statement.binds) {
+                if (bind.kind == WorkloadBind::Kind::Sequence) {
+                    sequences.emplace(&bind, &sequenceValues.emplace_back(bind.low));
+                }
+            }
+        }
+    }
+    std::vector<uint64_t> cumulativeWeights;
+    uint64_t totalWeight = 0;
+    for (const auto& transaction : transactions) {
+        totalWeight += transaction.weight;
+        cumulativeWeights.push_back(totalWeight);
+    }
+
+    // Everyone's connected and prepared before the clock starts, so the first transactions
+    // aren't late by a logon.
+    std::vector<PreparedSession> sessions;
+    sessions.reserve(workload.sessions);
+    for (uint32_t idx = 0; idx < workload.sessions; ++idx) {
+        auto& session = sessions.emplace_back(PreparedSession{newConnection(), {}});
+        for (const auto& transaction : transactions) {
+            auto& prepared = session.transactions.emplace_back();
+            for (const auto& statement : transaction.statements) {
+                PreparedStatement entry{session.conn.prepareStatement(statement.sql), {}, {}};
+                for (const auto& bind : statement.binds) {
+                    OracleConnection::VariableOpts varopts;
+                    varopts.dbTypeNum = DPI_ORACLE_TYPE_VARCHAR;
+                    varopts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+                    varopts.opts = OracleConnection::VariableOpts::ByteBufferOpts{bindSize(bind), true};
+                    varopts.maxArraySize = 1;
+                    entry.binds.push_back(session.conn.newArrayVariable(varopts));
+                    uint32_t position = 0;
+                    const auto parsed = std::from_chars(bind.name.data(), bind.name.data() + bind.name.size(),
+                                                        position);
+                    if (parsed.ec == std::errc() && parsed.ptr == bind.name.data() + bind.name.size()) {
+                        entry.stmt.bindByPos(position, entry.binds.back());
+                    } else {
+                        entry.stmt.bindByName(bind.name, entry.binds.back());
+                    }
+                    const auto sequence = sequences.find(&bind);
+                    entry.sequences.push_back(sequence == sequences.end() ? nullptr : sequence->second);
+                }
+                prepared.push_back(std::move(entry));
+            }
+        }
+    }
+
+    const auto seed = workload.seed != 0 ? workload.seed : static_cast<uint64_t>(
+            std::chrono::steady_clock::now().time_since_epoch().count());
+    const bool openLoop = workload.rate > 0;
+    const auto interval = openLoop ? std::chrono::duration<double>(1 / workload.rate) : std::chrono::duration<double>(0);
+    std::atomic<uint64_t> nextArrival{0};
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+
+    auto worker = [&](uint32_t sessionIdx) {
+        auto& session = sessions[sessionIdx];
+        Random random(seed + sessionIdx * 0x9e3779b97f4a7c15ULL);
+        SessionResult result;
+        result.transactions.resize(transactions.size());
+        std::string value;
+        for (;;) {
+            auto due = std::chrono::steady_clock::now();
+            if (openLoop) {
+                const auto arrival = nextArrival.fetch_add(1, std::memory_order_relaxed);
+                due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        interval * static_cast<double>(arrival));
+                if (due >= end) {
+                    break;
+                }
+                std::this_thread::sleep_until(due);
+            } else if (due >= end) {
+                break;
+            }
+            const auto pick = static_cast<size_t>(std::upper_bound(cumulativeWeights.begin(), cumulativeWeights.end(),
+                                                                   random.next() % totalWeight) -
+                                                  cumulativeWeights.begin());
+            const auto& transaction = transactions[pick];
+            auto& totals = result.transactions[pick];
+            const auto began = std::chrono::steady_clock::now();
+            if (openLoop) {
+                const std::chrono::duration<double, std::milli> lag = began - due;
+                result.maxLagMillis = std::max(result.maxLagMillis, lag.count());
+            }
+            ++totals.count;
+            try {
+                for (size_t idx = 0; idx < transaction.statements.size(); ++idx) {
+                    auto& prepared = session.transactions[pick][idx];
+                    const auto& binds = transaction.statements[idx].binds;
+                    for (size_t bind = 0; bind < binds.size(); ++bind) {
+                        makeValue(binds[bind], random, prepared.sequences[bind], value);
+                        prepared.binds[bind].setFrom(0, value);
+                    }
+                    prepared.stmt.execute();
+                    if (prepared.stmt.numColumns() > 0) {
+                        for (;;) {
+                            auto block = prepared.stmt.fetchBlock(prepared.stmt.fetchArraySize());
+                            if (!block.moreRows()) {
+                                break;
+                            }
+                        }
+                    }
+                }
+                if (transaction.commit) {
+                    session.conn.commit();
+                } else {
+                    session.conn.rollback();
+                }
+            } catch(const std::exception& e) {
+                if (totals.failures++ == 0) {
+                    totals.firstError = e.what();
+                }
+                try {
+                    session.conn.rollback();
+                } catch(const std::exception&) {
+                    // The next transaction fails on the same connection and says why.
+                }
+                std::this_thread::sleep_for(transaction.think);
+                continue;
+            }
+            const auto done = std::chrono::steady_clock::now();
+            const auto latency = toMicros(done - (openLoop ? due : began));
+            totals.latency.record(latency);
+            totals.service.record(toMicros(done - began));
+            totals.totalMicros += latency;
+            totals.maxMicros = std::max(totals.maxMicros, latency);
+            std::this_thread::sleep_for(transaction.think);
+        }
+        try {
+            session.conn.rollback();
+        } catch(const std::exception&) {
+            // The connection is going away either way.
+        }
+        return result;
+    };
+
+    start = std::chrono::steady_clock::now();
+    end = start + workload.duration;
+    std::vector<std::future<SessionResult>> workers;
+    for (uint32_t idx = 0; idx < workload.sessions; ++idx) {
+        workers.push_back(std::async(std::launch::async, worker, idx));
+    }
+
+    WorkloadBenchResult result;
+    result.transactions.resize(transactions.size());
+    for (size_t idx = 0; idx < transactions.size(); ++idx) {
+        result.transactions[idx].name = transactions[idx].name;
+    }
+    std::exception_ptr firstError;
+    for (auto& future : workers) {
+        try {
+            auto part = future.get();
+            result.maxLagMillis = std::max(result.maxLagMillis, part.maxLagMillis);
+            for (size_t idx = 0; idx < transactions.size(); ++idx) {
+                auto& totals = result.transactions[idx];
+                auto& partTotals = part.transactions[idx];
+                totals.count += partTotals.count;
+                totals.failures += partTotals.failures;
+                if (totals.firstError.empty()) {
+                    totals.firstError = std::move(partTotals.firstError);
+                }
+                totals.latency.add(partTotals.latency);
+                totals.service.add(partTotals.service);
+                totals.totalMicros += partTotals.totalMicros;
+                totals.maxMicros = std::max(totals.maxMicros, partTotals.maxMicros);
+            }
+        } catch(...) {
+            if (!firstError) {
+                firstError = std::current_exception();
+            }
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+    result.seconds = elapsed.count();
+    return result;
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "oracle_helpers.h"
+#include "top_sql.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqlplusplus {
+
+// How a bind's value is made up for each execution.
+struct WorkloadBind {
+    enum class Kind {
+        // A whole number from low to high, uniformly.
+        Int,
+        // low, low + 1, ... across every session, e.g. for new keys.
+        Sequence,
+        // From low to high, uniformly, with scale decimal places.
+        Decimal,
+        // Letters and digits, low to high characters long.
+        String,
+        // One of values, uniformly; for csv, a field of a row read from a file.
+        Choice,
+    };
+
+    // A name bound by name, or a number for a position.
+    std::string name;
+    Kind kind = Kind::Int;
+    int64_t low = 0;
+    int64_t high = 0;
+    uint32_t scale = 0;
+    std::vector<std::string> values;
+};
+
+struct WorkloadStatement {
+    std::string sql;
+    std::vector<WorkloadBind> binds;
+};
+
+struct WorkloadTransaction {
+    std::string name;
+    // Its share of the transactions run, against the others' weights.
+    uint32_t weight = 1;
+    // The session's pause after each one, before it takes on the next.
+    std::chrono::microseconds think{0};
+    // Rolled back instead, when false, so it can be run again and again unchanged.
+    bool commit = true;
+    std::vector<WorkloadStatement> statements;
+};
+
+struct BenchWorkload {
+    uint32_t sessions = 1;
+    std::chrono::microseconds duration{std::chrono::seconds(60)};
+    // Transactions a second to start across all the sessions, on a fixed schedule whether
+    // or not the last ones have finished (open loop); 0 has each session start the next one
+    // as soon as it's done and has thought (closed loop).
+    double rate = 0;
+    // Seeds the transaction picks and bind values; 0 takes one from the clock.
+    uint64_t seed = 0;
+    std::vector<WorkloadTransaction> transactions;
+};
+
+// Reads a workload from YAML, e.g.
+//
+//     sessions: 16
+//     duration: 5m
+//     rate: 400
+//     transactions:
+//       - name: new_order
+//         weight: 45
+//         think: 20ms
+//         statements:
+//           - sql: INSERT INTO orders (id, customer_id, total) VALUES (:id, :customer, :total)
+//             binds:
+//               id: sequence 1000000
+//               customer: int 1 100000
+//               total: decimal 1 500 2
+//       - name: lookup
+//         weight: 55
+//         commit: false
+//         statements:
+//           - sql: |
+//               SELECT * FROM orders
+//                WHERE customer_id = :1 AND status = :2
+//             binds:
+//               1: int 1 100000
+//               2: [NEW, PAID, SHIPPED]
+//
+// Durations are in us, ms, s or m, seconds if a number has none. A bind is int <low>
+// <high>, sequence [<start>], decimal <low> <high> [<scale>], string <min> <max>, choice
+// <value>..., a list to choose from, or csv <file> [<column>], a one-based column of a
+// random row of the file. The YAML is the block style subset that files like this are
+// written in: maps, lists, plain and quoted scalars, | and > blocks and [a, b] lists.
+// Throws std::runtime_error with the line of whatever doesn't fit.
+BenchWorkload parseBenchWorkload(std::string_view yaml);
+BenchWorkload readBenchWorkload(const std::string& path);
+
+struct TransactionBenchResult {
+    std::string name;
+    uint64_t count = 0;
+    uint64_t failures = 0;
+    // The first failure's message, when there were any.
+    std::string firstError;
+    // Of the successful ones, from their scheduled start in an open loop run, so time spent
+    // waiting for a session counts, and from their actual start in a closed loop one.
+    HdrLatencyHistogram latency;
+    // From their actual start, so without waiting for a session.
+    HdrLatencyHistogram service;
+    uint64_t totalMicros = 0;
+    uint64_t maxMicros = 0;
+};
+
+struct WorkloadBenchResult {
+    double seconds = 0;
+    // In the workload's order.
+    std::vector<TransactionBenchResult> transactions;
+    // Furthest behind its schedule a transaction started, in an open loop run.
+    double maxLagMillis = 0;
+};
+
+// Runs the workload on workload.sessions connections from newConnection, e.g. sessions of
+// an OracleConnectionPool, for its duration. Every session is connected and has every
+// statement prepared, with its binds, before the clock starts. Each transaction runs its
+// statements in order, fetching every row a query returns, then commits or rolls back;
+// one that fails is rolled back, counted, and the run carries on. Latencies of an open
+// loop run are measured from when each transaction was due, so a database that falls
+// behind shows up in them rather than slowing the schedule to match (coordinated
+// omission). Throws if a connection or prepare fails.
+WorkloadBenchResult runBenchWorkload(const std::function<OracleConnection()>& newConnection,
+                                     const BenchWorkload& workload);
+
+} // namespace sqlplusplus
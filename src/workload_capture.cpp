@@ -0,0 +1,342 @@
+#include "workload_capture.h"
+
+#include "mapped_file.h"
+#include "top_sql.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+namespace sqlplusplus {
+namespace {
+
+constexpr std::string_view kHeader = "sqlplusplus-workload 1\n";
+
+// Record types.
+constexpr char kStatementRecord = 'S';
+constexpr char kExecutionRecord = 'E';
+
+// Text binds are this big, so out binds have room for whatever they're given.
+constexpr uint32_t kBindSize = 4000;
+
+void appendVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void appendString(std::string& out, std::string_view value) {
+    appendVarint(out, value.size());
+    out.append(value);
+}
+
+// Reads the records of a capture; every read returns false at the end of the data, where a
+// capture cut short ends mid-record.
+class RecordReader {
+public:
+    explicit RecordReader(std::string_view data) : _data(data) {}
+
+    bool atEnd() const noexcept {
+        return _data.empty();
+    }
+
+    bool byte(char& value) noexcept {
+        if (_data.empty()) {
+            return false;
+        }
+        value = _data.front();
+        _data.remove_prefix(1);
+        return true;
+    }
+
+    bool varint(uint64_t& value) noexcept {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            char ch;
+            if (!byte(ch)) {
+                return false;
+            }
+            value |= static_cast<uint64_t>(ch & 0x7f) << shift;
+            if ((ch & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool string(std::string& value) {
+        uint64_t size;
+        if (!varint(size) || size > _data.size()) {
+            return false;
+        }
+        value.assign(_data.substr(0, size));
+        _data.remove_prefix(size);
+        return true;
+    }
+
+private:
+    std::string_view _data;
+};
+
+LatencyPercentiles percentiles(std::vector<uint64_t>& micros) {
+    LatencyPercentiles result;
+    if (micros.empty()) {
+        return result;
+    }
+    std::sort(micros.begin(), micros.end());
+    auto at = [&](double fraction) {
+        const auto rank = static_cast<size_t>(fraction * static_cast<double>(micros.size() - 1) + 0.5);
+        return static_cast<double>(micros[std::min(rank, micros.size() - 1)]);
+    };
+    result.p50Micros = at(0.50);
+    result.p95Micros = at(0.95);
+    result.p99Micros = at(0.99);
+    result.maxMicros = static_cast<double>(micros.back());
+    return result;
+}
+
+struct WorkerResult {
+    uint64_t failures = 0;
+    std::string firstError;
+    uint64_t rowsFetched = 0;
+    double maxLagMillis = 0;
+    // Indexes of the executions that succeeded, with their latencies.
+    std::vector<size_t> succeeded;
+    std::vector<uint64_t> latenciesMicros;
+};
+
+} // namespace
+
+WorkloadCapture::WorkloadCapture(const std::string& path) :
+    _out(BufferedFdWriter::open(path)),
+    _start(std::chrono::steady_clock::now())
+{
+    std::string header(kHeader);
+    appendVarint(header, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count()));
+    _out.append(header);
+    _out.flush();
+}
+
+void WorkloadCapture::record(std::string_view sql,
+                             const std::vector<CapturedBind>& binds,
+                             std::chrono::steady_clock::time_point start,
+                             std::chrono::steady_clock::duration elapsed) {
+    std::string record;
+    auto [it, added] = _statementIds.try_emplace(std::string(sql), static_cast<uint32_t>(_statementIds.size()));
+    if (added) {
+        record.push_back(kStatementRecord);
+        appendString(record, sql);
+    }
+    record.push_back(kExecutionRecord);
+    appendVarint(record, it->second);
+    const auto offset = std::max(start - _start, std::chrono::steady_clock::duration::zero());
+    appendVarint(record, std::chrono::duration_cast<std::chrono::microseconds>(offset).count());
+    appendVarint(record, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    appendVarint(record, binds.size());
+    for (const auto& bind : binds) {
+        appendString(record, bind.name);
+        record.push_back(bind.value ? 1 : 0);
+        if (bind.value) {
+            appendString(record, *bind.value);
+        }
+    }
+    _out.append(record);
+    _out.flush();
+}
+
+CapturedWorkload readWorkload(const std::string& path) {
+    MappedFile file(path);
+    auto data = file.contents();
+    if (data.substr(0, kHeader.size()) != kHeader) {
+        throw std::runtime_error(fmt::format("{} isn't a workload capture", path));
+    }
+    RecordReader reader(data.substr(kHeader.size()));
+    CapturedWorkload workload;
+    uint64_t startMicros;
+    if (!reader.varint(startMicros)) {
+        throw std::runtime_error(fmt::format("{} isn't a workload capture", path));
+    }
+    workload.startMicros = static_cast<int64_t>(startMicros);
+
+    char type;
+    while (reader.byte(type)) {
+        if (type == kStatementRecord) {
+            std::string sql;
+            if (!reader.string(sql)) {
+                break;
+            }
+            workload.statements.push_back(std::move(sql));
+            continue;
+        }
+        if (type != kExecutionRecord) {
+            throw std::runtime_error(fmt::format("{} has a record of unknown type {}", path, static_cast<int>(type)));
+        }
+        CapturedExecution execution;
+        uint64_t statement;
+        uint64_t numBinds;
+        if (!reader.varint(statement) || !reader.varint(execution.offsetMicros)
+                || !reader.varint(execution.elapsedMicros) || !reader.varint(numBinds)) {
+            break;
+        }
+        if (statement >= workload.statements.size()) {
+            throw std::runtime_error(fmt::format("{} refers to a statement it doesn't have", path));
+        }
+        execution.statement = static_cast<uint32_t>(statement);
+        bool complete = true;
+        for (uint64_t idx = 0; idx < numBinds && complete; ++idx) {
+            CapturedBind bind;
+            char hasValue;
+            complete = reader.string(bind.name) && reader.byte(hasValue);
+            if (complete && hasValue) {
+                bind.value.emplace();
+                complete = reader.string(*bind.value);
+            }
+            execution.binds.push_back(std::move(bind));
+        }
+        if (!complete) {
+            break;
+        }
+        workload.executions.push_back(std::move(execution));
+    }
+    return workload;
+}
+
+ReplayResult replayWorkload(const std::function<OracleConnection()>& newConnection,
+                            const CapturedWorkload& workload,
+                            const ReplayOptions& opts) {
+    const auto sessions = std::max<uint32_t>(opts.sessions, 1);
+    const auto& executions = workload.executions;
+    // Each session takes the next execution due, waits for its time and runs it, so up to
+    // sessions of them overlap.
+    std::atomic<size_t> next{0};
+    std::chrono::steady_clock::time_point start;
+    auto dueAt = [&](const CapturedExecution& execution) {
+        if (opts.speed <= 0) {
+            return start;
+        }
+        return start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::micro>(static_cast<double>(execution.offsetMicros) / opts.speed));
+    };
+
+    auto worker = [&](OracleConnection conn) {
+        WorkerResult result;
+        for (auto idx = next++; idx < executions.size(); idx = next++) {
+            const auto& execution = executions[idx];
+            const auto due = dueAt(execution);
+            std::this_thread::sleep_until(due);
+            const auto began = std::chrono::steady_clock::now();
+            const std::chrono::duration<double, std::milli> lag = began - due;
+            result.maxLagMillis = std::max(result.maxLagMillis, lag.count());
+            try {
+                auto stmt = conn.prepareStatement(workload.statements[execution.statement]);
+                const auto info = stmt.info();
+                if (info.statementType == DPI_STMT_TYPE_COMMIT || info.statementType == DPI_STMT_TYPE_ROLLBACK) {
+                    continue;
+                }
+                std::vector<OracleVariable> binds;
+                for (const auto& bind : execution.binds) {
+                    OracleConnection::VariableOpts varopts;
+                    varopts.dbTypeNum = DPI_ORACLE_TYPE_VARCHAR;
+                    varopts.nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+                    varopts.opts = OracleConnection::VariableOpts::ByteBufferOpts{
+                        std::max(kBindSize, static_cast<uint32_t>(bind.value ? bind.value->size() : 0)), true};
+                    varopts.maxArraySize = 1;
+                    binds.push_back(conn.newArrayVariable(varopts));
+                    if (bind.value) {
+                        binds.back().setFrom(0, *bind.value);
+                    } else {
+                        binds.back().setNull(0);
+                    }
+                    stmt.bindByName(bind.name, binds.back());
+                }
+                stmt.execute(info.isQuery ? DPI_MODE_EXEC_DEFAULT : DPI_MODE_EXEC_COMMIT_ON_SUCCESS);
+                uint64_t rows = info.isDML ? stmt.rowCount() : 0;
+                uint64_t roundTrips = 1;
+                if (stmt.numColumns() > 0) {
+                    for (;;) {
+                        auto block = stmt.fetchBlock(stmt.fetchArraySize());
+                        rows += block.numRows();
+                        ++roundTrips;
+                        if (!block.moreRows()) {
+                            break;
+                        }
+                    }
+                    result.rowsFetched += rows;
+                }
+                if (opts.topSql) {
+                    opts.topSql->record(workload.statements[execution.statement], std::chrono::steady_clock::now() - began,
+                                        rows, roundTrips);
+                }
+            } catch(const std::exception& e) {
+                if (result.failures++ == 0) {
+                    result.firstError = e.what();
+                }
+                continue;
+            }
+            result.succeeded.push_back(idx);
+            result.latenciesMicros.push_back(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - began).count()));
+        }
+        try {
+            conn.rollback();
+        } catch(const std::exception&) {
+            // The connection is going away either way.
+        }
+        return result;
+    };
+
+    // Everyone's connected before the clock starts, so the first executions aren't late
+    // by a logon.
+    std::vector<OracleConnection> conns;
+    for (uint32_t idx = 0; idx < sessions; ++idx) {
+        conns.push_back(newConnection());
+    }
+    start = std::chrono::steady_clock::now();
+    std::vector<std::future<WorkerResult>> workers;
+    for (auto& conn : conns) {
+        workers.push_back(std::async(std::launch::async, worker, std::move(conn)));
+    }
+
+    ReplayResult result;
+    std::vector<uint64_t> captured;
+    std::vector<uint64_t> replayed;
+    std::exception_ptr firstError;
+    for (auto& future : workers) {
+        try {
+            auto part = future.get();
+            result.failures += part.failures;
+            if (result.firstError.empty()) {
+                result.firstError = std::move(part.firstError);
+            }
+            result.rowsFetched += part.rowsFetched;
+            result.maxLagMillis = std::max(result.maxLagMillis, part.maxLagMillis);
+            for (auto idx : part.succeeded) {
+                captured.push_back(executions[idx].elapsedMicros);
+            }
+            replayed.insert(replayed.end(), part.latenciesMicros.begin(), part.latenciesMicros.end());
+        } catch(...) {
+            if (!firstError) {
+                firstError = std::current_exception();
+            }
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+    result.executions = replayed.size() + result.failures;
+    result.seconds = elapsed.count();
+    result.captured = percentiles(captured);
+    result.replayed = percentiles(replayed);
+    return result;
+}
+
+} // namespace sqlplusplus
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "buffered_writer.h"
+#include "oracle_helpers.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace sqlplusplus {
+
+class TopSql;
+
+struct CapturedBind {
+    std::string name;
+    // Null values are nullopt.
+    std::optional<std::string> value;
+};
+
+struct CapturedExecution {
+    // Index into CapturedWorkload::statements.
+    uint32_t statement = 0;
+    // When it started, from the start of the capture.
+    uint64_t offsetMicros = 0;
+    // How long it took the client, from the prepare to the end of the execute.
+    uint64_t elapsedMicros = 0;
+    std::vector<CapturedBind> binds;
+};
+
+struct CapturedWorkload {
+    // When the capture started, in microseconds since the epoch.
+    int64_t startMicros = 0;
+    // Each distinct statement text once.
+    std::vector<std::string> statements;
+    // In the order they started.
+    std::vector<CapturedExecution> executions;
+};
+
+// Records each statement the REPL runs, with its bind values and timing, to a binary log
+// for .replay: a header, then records a byte of type and varint fields each. A statement's
+// text is written the first time it runs and referred to by number after, so a workload
+// of a few statements run many times costs a few bytes an execution plus its binds. Each
+// record is written out as it's made, so a capture cut short by a crash is still readable
+// up to its last statement. Throws std::system_error if the file can't be written.
+class WorkloadCapture {
+public:
+    explicit WorkloadCapture(const std::string& path);
+
+    // Records an execution that started at start and took elapsed.
+    void record(std::string_view sql,
+                const std::vector<CapturedBind>& binds,
+                std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::duration elapsed);
+
+private:
+    BufferedFdWriter _out;
+    std::chrono::steady_clock::time_point _start;
+    std::unordered_map<std::string, uint32_t> _statementIds;
+};
+
+// Reads a capture back. Throws std::runtime_error for a file that isn't one; a truncated
+// last record is dropped.
+CapturedWorkload readWorkload(const std::string& path);
+
+struct ReplayOptions {
+    // Connections replaying at once.
+    uint32_t sessions = 1;
+    // How much faster than captured to replay: 2 starts each execution at half its
+    // captured offset. 0 runs them back to back as fast as the sessions allow.
+    double speed = 1;
+    // Where each replayed execution is also recorded, when set.
+    TopSql* topSql = nullptr;
+};
+
+struct LatencyPercentiles {
+    double p50Micros = 0;
+    double p95Micros = 0;
+    double p99Micros = 0;
+    double maxMicros = 0;
+};
+
+struct ReplayResult {
+    uint64_t executions = 0;
+    uint64_t failures = 0;
+    // The first failure's message, when there were any.
+    std::string firstError;
+    uint64_t rowsFetched = 0;
+    double seconds = 0;
+    // Furthest behind its scheduled start an execution began, when the sessions couldn't
+    // keep up.
+    double maxLagMillis = 0;
+    // Of the successful executions, as captured and as replayed; replayed latencies
+    // include fetching every row a query returns.
+    LatencyPercentiles captured;
+    LatencyPercentiles replayed;
+};
+
+// Runs a captured workload again on opts.sessions connections from newConnection, each
+// execution started at its captured offset scaled by opts.speed on whichever session is
+// free, so statements that overlapped in the capture overlap again. Binds are bound by
+// name as text. Changes are committed as each execution succeeds, since the statements of
+// one captured transaction may land on different sessions, and captured COMMITs and
+// ROLLBACKs are skipped. Failed executions are counted and the replay carries on.
+ReplayResult replayWorkload(const std::function<OracleConnection()>& newConnection,
+                            const CapturedWorkload& workload,
+                            const ReplayOptions& opts);
+
+} // namespace sqlplusplus
@@ -129,10 +129,22 @@ static int maskmode = 0; /* Show "***" instead of input. For passwords. */
 static int rawmode = 0; /* For atexit() function to check if restore is needed*/
 static int mlmode = 0;  /* Multi line mode. Default is single line. */
 static int atexit_registered = 0; /* Register atexit just 1 time. */
+static int bracketedpaste = 0; /* Ask the terminal to mark pastes (mode 2004). */
 static int history_max_len = LINENOISE_DEFAULT_HISTORY_MAX_LEN;
 static int history_len = 0;
 static char **history = NULL;
 
+/* Input read past the end of a bracketed paste, handed out before reading more. */
+#define LINENOISE_PASTE_CHUNK 4096
+static char inputbuf[LINENOISE_PASTE_CHUNK];
+static size_t inputpos = 0, inputlen = 0;
+/* A paste of several lines, returned by linenoise() in place of the edited line. */
+static char *pastedlines = NULL;
+/* What the next edit starts with, and where its cursor goes: the last line of a paste
+ * that didn't end with a newline, so it can be finished off. */
+static char *preload = NULL;
+static size_t preloadpos = 0;
+
 /* The linenoiseState structure represents the state during line editing.
  * We pass this state to functions implementing specific editing
  * functionalities. */
@@ -148,6 +160,7 @@ struct linenoiseState {
     size_t len;         /* Current edited line length. */
     size_t cols;        /* Number of columns in terminal. */
     size_t maxrows;     /* Maximum num of rows used so far (multiline mode) */
+    int hintshown;      /* Whether the last refresh left a hint after the line. */
     int history_index;  /* The history index we are currently editing. */
 };
 
@@ -211,6 +224,12 @@ void linenoiseMaskModeDisable(void) {
     maskmode = 0;
 }
 
+/* Enable terminal bracketed paste, so a paste is taken in one go rather than a key at a
+ * time. */
+void linenoiseSetBracketedPaste(int enable) {
+    bracketedpaste = enable;
+}
+
 /* Set if to use or not the multi line mode. */
 void linenoiseSetMultiLine(int ml) {
     mlmode = ml;
@@ -346,6 +365,15 @@ static void linenoiseBeep(void) {
 
 /* ============================== Completion ================================ */
 
+/* Read a byte of input, from what a paste read ahead first. */
+static ssize_t readInput(int fd, char *c) {
+    if (inputpos < inputlen) {
+        *c = inputbuf[inputpos++];
+        return 1;
+    }
+    return read(fd,c,1);
+}
+
 /* Free a list of completion option populated by linenoiseAddCompletion(). */
 static void freeCompletions(linenoiseCompletions *lc) {
     size_t i;
@@ -387,7 +415,7 @@ static int completeLine(struct linenoiseState *ls) {
                 refreshLine(ls);
             }
 
-            nread = read(ls->ifd,&c,1);
+            nread = readInput(ls->ifd,&c);
             if (nread <= 0) {
                 freeCompletions(&lc);
                 return -1;
@@ -489,6 +517,7 @@ static void abFree(struct abuf *ab) {
  * to the right of the prompt. */
 void refreshShowHints(struct abuf *ab, struct linenoiseState *l, int plen) {
     char seq[64];
+    l->hintshown = 0;
     if (hintsCallback && plen+l->len < l->cols) {
         int color = -1, bold = 0;
         char *hint = hintsCallback(l->buf,&color,&bold);
@@ -505,6 +534,7 @@ void refreshShowHints(struct abuf *ab, struct linenoiseState *l, int plen) {
             abAppend(ab,hint,hintlen);
             if (color != -1 || bold != 0)
                 abAppend(ab,"\033[0m",4);
+            l->hintshown = hintlen > 0;
             /* Call the function to free the hint returned. */
             if (freeHintsCallback) freeHintsCallback(hint);
         }
@@ -657,6 +687,57 @@ static void refreshLine(struct linenoiseState *l) {
         refreshSingleLine(l);
 }
 
+/* Refresh after a character was appended at the end of the line, by writing just it and
+ * the hint that follows, rather than redrawing the whole line: typing, or pasting
+ * without bracketed paste, at the end of a long line then costs the same as on a short
+ * one. Returns 0 without writing anything if the line has to be redrawn instead, since
+ * it scrolls or wraps. */
+static int refreshAppended(struct linenoiseState *l) {
+    char seq[64];
+    size_t end = l->plen+l->len;
+    struct abuf ab;
+    char *hint = NULL;
+    int hintlen = 0, color = -1, bold = 0;
+
+    if (mlmode ? end % l->cols == 0 : end >= l->cols) return 0;
+    /* Hints are only shown on the first row, the way refreshShowHints() has them. */
+    if (hintsCallback && end < l->cols) {
+        hint = hintsCallback(l->buf,&color,&bold);
+        if (hint) {
+            hintlen = strlen(hint);
+            if (hintlen > (int)(l->cols-end)) hintlen = l->cols-end;
+        }
+    }
+
+    abInit(&ab);
+    abAppend(&ab,maskmode == 1 ? "*" : l->buf+l->len-1,1);
+    if (hintlen > 0 || l->hintshown) {
+        if (hintlen > 0) {
+            if (bold == 1 && color == -1) color = 37;
+            if (color != -1 || bold != 0) {
+                snprintf(seq,64,"\033[%d;%d;49m",bold,color);
+                abAppend(&ab,seq,strlen(seq));
+            }
+            abAppend(&ab,hint,hintlen);
+            if (color != -1 || bold != 0)
+                abAppend(&ab,"\033[0m",4);
+        }
+        /* Erase what's left of the old hint and go back to just after the character. */
+        snprintf(seq,64,"\x1b[0K\r\x1b[%dC",(int)(end % l->cols));
+        abAppend(&ab,seq,strlen(seq));
+    }
+    if (hint && freeHintsCallback) freeHintsCallback(hint);
+    l->hintshown = hintlen > 0;
+    if (mlmode) {
+        size_t rows = (end+l->cols-1)/l->cols;
+        if (rows > l->maxrows) l->maxrows = rows;
+        l->oldpos = l->pos;
+    }
+    if (write(l->ofd,ab.b,ab.len) == -1) {} /* Can't recover from write error. */
+    abFree(&ab);
+    return 1;
+}
+
 /* Insert the character 'c' at cursor current position.
  *
  * On error writing to the terminal -1 is returned, otherwise 0. */
@@ -667,14 +748,9 @@ int linenoiseEditInsert(struct linenoiseState *l, char c) {
             l->pos++;
             l->len++;
             l->buf[l->len] = '\0';
-            if ((!mlmode && l->plen+l->len < l->cols && !hintsCallback)) {
-                /* Avoid a full update of the line in the
-                 * trivial case. */
-                char d = (maskmode==1) ? '*' : c;
-                if (write(l->ofd,&d,1) == -1) return -1;
-            } else {
-                refreshLine(l);
-            }
+            /* Avoid a full update of the line when only the end
+             * changed. */
+            if (!refreshAppended(l)) refreshLine(l);
         } else {
             memmove(l->buf+l->pos+1,l->buf+l->pos,l->len-l->pos);
             l->buf[l->pos] = c;
@@ -783,6 +859,140 @@ void linenoiseEditDeletePrevWord(struct linenoiseState *l) {
     refreshLine(l);
 }
 
+/* Read a bracketed paste, whose start marker ESC [ 200 ~ was just read, up to its end
+ * marker ESC [ 201 ~, in chunks rather than a byte at a time. Input read past the end
+ * marker is kept for readInput(). Line breaks come back as \n, whether the terminal
+ * sent \r, \n or both. Returns a malloc()ed string, or NULL when out of memory. */
+static char *readPaste(int fd, size_t *lenp) {
+    static const char endmarker[] = "\x1b[201~";
+    const size_t markerlen = sizeof(endmarker)-1;
+    size_t len = 0, cap = 2*LINENOISE_PASTE_CHUNK, i, j;
+    char *text = malloc(cap);
+
+    if (text == NULL) return NULL;
+    while(1) {
+        ssize_t nread;
+        size_t from;
+        int found = 0;
+
+        if (cap-len <= LINENOISE_PASTE_CHUNK) {
+            char *grown = realloc(text,cap*2);
+            if (grown == NULL) {
+                free(text);
+                return NULL;
+            }
+            text = grown;
+            cap *= 2;
+        }
+        if (inputpos < inputlen) {
+            nread = inputlen-inputpos;
+            memcpy(text+len,inputbuf+inputpos,nread);
+            inputpos = inputlen = 0;
+        } else {
+            nread = read(fd,text+len,LINENOISE_PASTE_CHUNK);
+        }
+        /* Input that ends inside a paste keeps what arrived of it. */
+        if (nread <= 0) break;
+        /* The marker can be split across reads. */
+        from = len > markerlen ? len-markerlen : 0;
+        len += nread;
+        for (i = from; i+markerlen <= len; i++) {
+            if (memcmp(text+i,endmarker,markerlen) == 0) {
+                inputpos = 0;
+                inputlen = len-(i+markerlen);
+                memcpy(inputbuf,text+i+markerlen,inputlen);
+                len = i;
+                found = 1;
+                break;
+            }
+        }
+        if (found) break;
+    }
+
+    for (i = j = 0; i < len; i++) {
+        if (text[i] == '\r') {
+            text[j++] = '\n';
+            if (i+1 < len && text[i+1] == '\n') i++;
+        } else {
+            text[j++] = text[i];
+        }
+    }
+    text[j] = '\0';
+    *lenp = j;
+    return text;
+}
+
+/* Take in a bracketed paste. Text without line breaks is inserted at the cursor with a
+ * single refresh. A paste of several lines ends the edit: the line up to the cursor and
+ * the pasted lines go to pastedlines, for linenoise() to return in one go, and the rest,
+ * from the paste's last line break on, is preloaded into the next edit. The pasted lines
+ * are written out once rather than refreshed a character at a time. Returns 1 when the
+ * edit is over. */
+static int linenoiseEditPaste(struct linenoiseState *l) {
+    size_t len, lines = 0, tail, rest, i;
+    char *text = readPaste(l->ifd,&len);
+    struct abuf ab;
+
+    if (text == NULL) return 0;
+    for (i = len; i > 0; i--) {
+        if (text[i-1] == '\n') {
+            lines = i;
+            break;
+        }
+    }
+    if (lines == 0) {
+        if (len > l->buflen-l->len) len = l->buflen-l->len;
+        memmove(l->buf+l->pos+len,l->buf+l->pos,l->len-l->pos);
+        memcpy(l->buf+l->pos,text,len);
+        l->pos += len;
+        l->len += len;
+        l->buf[l->len] = '\0';
+        free(text);
+        refreshLine(l);
+        return 0;
+    }
+
+    tail = len-lines;
+    rest = l->len-l->pos;
+    pastedlines = malloc(l->pos+lines);
+    preload = malloc(tail+rest+1);
+    if (pastedlines == NULL || preload == NULL) {
+        free(pastedlines);
+        free(preload);
+        pastedlines = preload = NULL;
+        free(text);
+        return 0;
+    }
+    memcpy(pastedlines,l->buf,l->pos);
+    memcpy(pastedlines+l->pos,text,lines-1);
+    pastedlines[l->pos+lines-1] = '\0';
+    memcpy(preload,text+lines,tail);
+    memcpy(preload+tail,l->buf+l->pos,rest);
+    preload[tail+rest] = '\0';
+    preloadpos = tail;
+
+    /* Leave the line as far as the cursor on screen, without hints, as Enter does. */
+    l->len = l->pos;
+    l->buf[l->len] = '\0';
+    {
+        linenoiseHintsCallback *hc = hintsCallback;
+        hintsCallback = NULL;
+        refreshLine(l);
+        hintsCallback = hc;
+    }
+    /* Then the pasted lines under it; raw mode needs the \r. The last line break is
+     * linenoiseRaw()'s. */
+    abInit(&ab);
+    for (i = 0; i+1 < lines; i++) {
+        if (text[i] == '\n') abAppend(&ab,"\r\n",2);
+        else abAppend(&ab,maskmode == 1 ? "*" : text+i,1);
+    }
+    if (write(l->ofd,ab.b,ab.len) == -1) {} /* Can't recover from write error. */
+    abFree(&ab);
+    free(text);
+    return 1;
+}
+
 /* This function is the core of the line editing capability of linenoise.
  * It expects 'fd' to be already in "raw mode" so that every key pressed
  * will be returned ASAP to read().
@@ -807,6 +1017,7 @@ static int linenoiseEdit(int stdin_fd, int stdout_fd, char *buf, size_t buflen,
     l.len = 0;
     l.cols = getColumns(stdin_fd, stdout_fd);
     l.maxrows = 0;
+    l.hintshown = 0;
     l.history_index = 0;
 
     /* Buffer starts empty. */
@@ -818,12 +1029,22 @@ static int linenoiseEdit(int stdin_fd, int stdout_fd, char *buf, size_t buflen,
     linenoiseHistoryAdd("");
 
     if (write(l.ofd,prompt,l.plen) == -1) return -1;
+    if (preload) {
+        l.len = strlen(preload);
+        if (l.len > l.buflen) l.len = l.buflen;
+        memcpy(buf,preload,l.len);
+        buf[l.len] = '\0';
+        l.pos = preloadpos < l.len ? preloadpos : l.len;
+        free(preload);
+        preload = NULL;
+        refreshLine(&l);
+    }
     while(1) {
         char c;
         int nread;
-        char seq[3];
+        char seq[5];
 
-        nread = read(l.ifd,&c,1);
+        nread = readInput(l.ifd,&c);
         if (nread <= 0) return l.len;
 
         /* Only autocomplete when the callback is set. It returns < 0 when
@@ -893,20 +1114,31 @@ static int linenoiseEdit(int stdin_fd, int stdout_fd, char *buf, size_t buflen,
             /* Read the next two bytes representing the escape sequence.
              * Use two calls to handle slow terminals returning the two
              * chars at different times. */
-            if (read(l.ifd,seq,1) == -1) break;
-            if (read(l.ifd,seq+1,1) == -1) break;
+            if (readInput(l.ifd,seq) == -1) break;
+            if (readInput(l.ifd,seq+1) == -1) break;
 
             /* ESC [ sequences. */
             if (seq[0] == '[') {
                 if (seq[1] >= '0' && seq[1] <= '9') {
                     /* Extended escape, read additional byte. */
-                    if (read(l.ifd,seq+2,1) == -1) break;
+                    if (readInput(l.ifd,seq+2) == -1) break;
                     if (seq[2] == '~') {
                         switch(seq[1]) {
                         case '3': /* Delete key. */
                             linenoiseEditDelete(&l);
                             break;
                         }
+                    } else if (seq[1] == '2' && seq[2] == '0') {
+                        /* ESC [ 200 ~, the start of a bracketed paste. */
+                        if (readInput(l.ifd,seq+3) == -1) break;
+                        if (readInput(l.ifd,seq+4) == -1) break;
+                        if (seq[3] == '0' && seq[4] == '~' &&
+                            linenoiseEditPaste(&l))
+                        {
+                            history_len--;
+                            free(history[history_len]);
+                            return (int)l.len;
+                        }
                     }
                 } else {
                     switch(seq[1]) {
@@ -1014,7 +1246,9 @@ static int linenoiseRaw(char *buf, size_t buflen, const char *prompt) {
     }
 
     if (enableRawMode(STDIN_FILENO) == -1) return -1;
+    if (bracketedpaste && write(STDOUT_FILENO,"\x1b[?2004h",8) == -1) {}
     count = linenoiseEdit(STDIN_FILENO, STDOUT_FILENO, buf, buflen, prompt);
+    if (bracketedpaste && write(STDOUT_FILENO,"\x1b[?2004l",8) == -1) {}
     disableRawMode(STDIN_FILENO);
     printf("\n");
     return count;
@@ -1083,6 +1317,11 @@ char *linenoise(const char *prompt) {
         return strdup(buf);
     } else {
         count = linenoiseRaw(buf,LINENOISE_MAX_LINE,prompt);
+        if (pastedlines) {
+            char *lines = pastedlines;
+            pastedlines = NULL;
+            return lines;
+        }
         if (count == -1) return NULL;
         return strdup(buf);
     }
@@ -1112,6 +1351,7 @@ static void freeHistory(void) {
 
 /* At exit we'll try to fix the terminal to the initial conditions. */
 static void linenoiseAtExit(void) {
+    if (rawmode && bracketedpaste && write(STDOUT_FILENO,"\x1b[?2004l",8) == -1) {}
     disableRawMode(STDIN_FILENO);
     freeHistory();
 }
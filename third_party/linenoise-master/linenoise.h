@@ -64,6 +64,9 @@ int linenoiseHistorySave(const char *filename);
 int linenoiseHistoryLoad(const char *filename);
 void linenoiseClearScreen(void);
 void linenoiseSetMultiLine(int ml);
+/* A paste of several lines is returned by one linenoise() call, with \n between them;
+ * whatever followed the last line break starts the next call's line. */
+void linenoiseSetBracketedPaste(int enable);
 void linenoisePrintKeyCodes(void);
 void linenoiseMaskModeEnable(void);
 void linenoiseMaskModeDisable(void);